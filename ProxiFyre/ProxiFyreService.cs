@@ -5,7 +5,9 @@ using NLog.Targets;
 using System;
 using System.Collections.Generic;
 using System.IO;
+using System.Linq;
 using System.Reflection;
+using System.Threading;
 
 // Aliases to avoid LogLevel ambiguity
 using SLogLevel = Socksifier.LogLevel;
@@ -20,6 +22,12 @@ namespace ProxiFyre
         private Socksifier.Socksifier _socksify;
         private SLogLevel _logLevel = SLogLevel.Info;
 
+        // Applies edits of app-config.json to the running router, see ReloadConfig
+        private readonly object _reloadLock = new object();
+        private FileSystemWatcher _configWatcher;
+        private Timer _reloadTimer;
+        private string _configPath;
+
         public void Start()
         {
             var exePath = Assembly.GetExecutingAssembly().Location;
@@ -57,6 +65,24 @@ namespace ProxiFyre
                 }
             }
 
+            // Pass busy unproxied flows in the driver if enabled
+            if (cfg.kernelBypass == true)
+            {
+                if (_socksify.SetKernelBypass(true))
+                {
+                    if (_logLevel >= SLogLevel.Info)
+                    {
+                        var msg = "Kernel bypass enabled - established unproxied flows will be passed by the driver.";
+                        FileLog.Info(msg);
+                        Console.WriteLine($"INFO: {msg}");
+                    }
+                }
+                else
+                {
+                    Console.WriteLine("WARN: Failed to enable kernel bypass.");
+                }
+            }
+
             var anyAssociation = false;
 
             foreach (var rule in (cfg.proxies ?? new List<ProxyRule>()))
@@ -69,6 +95,26 @@ namespace ProxiFyre
                 if (handle == IntPtr.Zero || handle.ToInt64() == -1)
                     Console.WriteLine($"WARN: AddSocks5Proxy({endpoint}) returned 0 handle during bootstrap.");
 
+                // Alternative endpoints, new sessions skip the failed ones
+                foreach (var alternative in (rule.socks5ProxyEndpoints ?? new List<string>()))
+                {
+                    if (!_socksify.AddSocks5ProxyEndpoint(handle, alternative))
+                        Console.WriteLine($"WARN: Failed to add endpoint {alternative} to proxy {endpoint}.");
+                }
+
+                if (string.Equals(rule.proxySelection, "sessions", StringComparison.OrdinalIgnoreCase) &&
+                    !_socksify.SetProxySelection(handle, true))
+                    Console.WriteLine($"WARN: Failed to set the endpoint selection of proxy {endpoint}.");
+
+                // Resolve the DNS queries of the associated apps through the proxy
+                if (!string.IsNullOrEmpty(rule.dnsResolver))
+                {
+                    if (_socksify.SetDnsForwarding(handle, rule.dnsResolver, rule.dnsOverTcp == true))
+                        Console.WriteLine($"INFO: DNS of {endpoint} apps is forwarded to {rule.dnsResolver} through the proxy.");
+                    else
+                        Console.WriteLine($"WARN: Failed to enable DNS forwarding to {rule.dnsResolver} for {endpoint}.");
+                }
+
                 foreach (var name in (rule.appNames ?? new List<string>()))
                 {
                     var ok = _socksify.AssociateProcessNameToProxy(name, handle);
@@ -85,14 +131,15 @@ namespace ProxiFyre
 
                 if (rule.ipRanges != null && rule.appNames != null)
                 {
+                    var cidrs = rule.ipRanges.ToArray();
                     foreach (var name in rule.appNames)
-                    foreach (var cidr in rule.ipRanges)
                     {
-                        var added = _socksify.IncludeProcessDestinationCidr(name, cidr);
-                        if (added)
-                            Console.WriteLine($"INFO: Added CIDR {cidr} for process {name}.");
+                        // One bulk call per process: the policy index is rebuilt once
+                        var added = _socksify.IncludeProcessDestinationCidrs(name, cidrs);
+                        if (added == cidrs.Length)
+                            Console.WriteLine($"INFO: Added {added} CIDR(s) for process {name}.");
                         else
-                            Console.WriteLine($"WARN: Failed to add CIDR {cidr} for process {name}.");
+                            Console.WriteLine($"WARN: Added {Math.Max(added, 0)} of {cidrs.Length} CIDR(s) for process {name}.");
                     }
                 }
             }
@@ -113,6 +160,8 @@ namespace ProxiFyre
             var started = _socksify.Start();
             if (!started)
                 Console.Error.WriteLine("ERROR: Failed to start native router.");
+            else
+                WatchConfig(configPath);
 
             FileLog.Info("ProxiFyre Service is running...");
         }
@@ -121,6 +170,14 @@ namespace ProxiFyre
         {
             try
             {
+                lock (_reloadLock)
+                {
+                    _configWatcher?.Dispose();
+                    _configWatcher = null;
+                    _reloadTimer?.Dispose();
+                    _reloadTimer = null;
+                }
+
                 if (_socksify != null)
                     _socksify.Stop();
             }
@@ -131,6 +188,81 @@ namespace ProxiFyre
             }
         }
 
+        private void WatchConfig(string configPath)
+        {
+            _configPath = configPath;
+
+            // Editors save by rewriting or by renaming a temporary file, several events per save
+            _reloadTimer = new Timer(_ => ReloadConfig(), null, Timeout.Infinite, Timeout.Infinite);
+            _configWatcher = new FileSystemWatcher(Path.GetDirectoryName(configPath) ?? ".", Path.GetFileName(configPath))
+            {
+                NotifyFilter = NotifyFilters.LastWrite | NotifyFilters.FileName | NotifyFilters.Size
+            };
+
+            FileSystemEventHandler changed = (sender, e) =>
+            {
+                lock (_reloadLock)
+                    _reloadTimer?.Change(500, Timeout.Infinite);
+            };
+
+            _configWatcher.Changed += changed;
+            _configWatcher.Created += changed;
+            _configWatcher.Renamed += (sender, e) => changed(sender, e);
+            _configWatcher.EnableRaisingEvents = true;
+        }
+
+        // Applies the proxies, appNames, excludes and bypassLan of the edited configuration without
+        // restarting the router; only sessions of changed or removed proxies are closed.
+        private void ReloadConfig()
+        {
+            lock (_reloadLock)
+            {
+                if (_configWatcher == null)
+                    return;
+
+                AppConfig cfg;
+                try
+                {
+                    cfg = JsonConvert.DeserializeObject<AppConfig>(File.ReadAllText(_configPath)) ?? new AppConfig();
+                }
+                catch (Exception ex)
+                {
+                    Console.WriteLine($"WARN: Failed to read {_configPath}, the running configuration is kept: {ex.Message}");
+                    return;
+                }
+
+                var rules = cfg.proxies ?? new List<ProxyRule>();
+                var proxies = rules.Select(rule => new Socksifier.Socks5ProxyConfiguration
+                {
+                    Endpoint = rule.socks5ProxyEndpoint ?? "",
+                    AlternativeEndpoints = rule.socks5ProxyEndpoints?.ToArray(),
+                    Username = rule.username,
+                    Password = rule.password,
+                    Protocols = ParseProtocols(rule.supportedProtocols),
+                    ProcessNames = rule.appNames?.ToArray()
+                }).ToArray();
+
+                var handles = _socksify.Reconfigure(proxies, cfg.excludes?.ToArray(), cfg.bypassLan == true);
+                if (handles == null)
+                {
+                    Console.WriteLine($"WARN: Failed to apply {_configPath}, the running configuration is kept.");
+                    return;
+                }
+
+                for (var i = 0; i < rules.Count; ++i)
+                {
+                    var leastSessions = string.Equals(rules[i].proxySelection, "sessions", StringComparison.OrdinalIgnoreCase);
+                    if (!_socksify.SetProxySelection(handles[i], leastSessions))
+                        Console.WriteLine($"WARN: Failed to set the endpoint selection of proxy {proxies[i].Endpoint}.");
+                }
+
+                var msg = $"Reloaded {_configPath}: {rules.Count} proxies. " +
+                          "Changes to logLevel, kernelBypass, ipRanges and dnsResolver take effect after a restart.";
+                FileLog.Info(msg);
+                Console.WriteLine($"INFO: {msg}");
+            }
+        }
+
         private void NativeLogToNLog(object sender, Socksifier.LogEventArgs e)
         {
             if (e?.Log == null) return;
@@ -217,16 +349,23 @@ namespace ProxiFyre
 
             [JsonProperty("bypassLan", NullValueHandling = NullValueHandling.Ignore)]
             public bool? bypassLan { get; set; } = false;
+
+            [JsonProperty("kernelBypass", NullValueHandling = NullValueHandling.Ignore)]
+            public bool? kernelBypass { get; set; } = false;
         }
 
         private class ProxyRule
         {
             public List<string> appNames { get; set; } = new List<string>();
             public string socks5ProxyEndpoint { get; set; }
+            public List<string> socks5ProxyEndpoints { get; set; }
+            public string proxySelection { get; set; }
             public string username { get; set; }
             public string password { get; set; }
             public List<string> supportedProtocols { get; set; } = new List<string>();
             public List<string> ipRanges { get; set; }
+            public string dnsResolver { get; set; }
+            public bool? dnsOverTcp { get; set; }
         }
     }
 }
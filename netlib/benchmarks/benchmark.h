@@ -0,0 +1,613 @@
+// --------------------------------------------------------------------------------
+/// <summary>
+/// Module Name:  benchmark.h
+/// Abstract: Timing helpers, synthetic packet generators and loopback sockets shared by the
+/// netlib benchmarks
+/// </summary>
+/// Includes the netlib headers in the order socksify/unmanaged.h does, so benchmarks can use
+/// any of them. Benchmarks including this header need the ms-gsl and ndisapi.lib dependencies
+/// of the socksify project, see the build lines of the benchmarks.
+// --------------------------------------------------------------------------------
+
+#pragma once
+
+#define NOMINMAX 1
+
+#include <WinSock2.h>
+#include <MSWSock.h>
+#include <ws2tcpip.h>
+#include <in6addr.h>
+#include <ws2ipdef.h>
+#include <IPHlpApi.h>
+#include <Mstcpip.h>
+#include <WinDNS.h>
+#include <winternl.h>
+#include <intrin.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <bitset>
+#include <cassert>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <queue>
+#include <random>
+#include <regex>
+#include <set>
+#include <shared_mutex>
+#include <span>
+#include <sstream>
+#include <stack>
+#include <string>
+#include <string_view>
+#include <syncstream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+#include <gsl/gsl>
+
+#include "../../include/Common.h"
+#include "../../include/ndisapi.h"
+#include "../src/tools/generic.h"
+#include "../src/tools/strings.h"
+#include "../src/tools/spsc_ring.h"
+#include "../src/tools/mpsc_queue.h"
+#include "../src/tools/flat_hash_map.h"
+#include "../src/tools/timing_wheel.h"
+#include "../src/tools/metrics.h"
+#include "../src/log/log.h"
+#include "../src/log/binary_trace.h"
+#include "../src/iphlp.h"
+#include "../src/winsys/object.h"
+#include "../src/winsys/event.h"
+#include "../src/winsys/numa_allocator.h"
+#include "../src/winsys/io_completion_port.h"
+#include "../src/winsys/io_completion_port_group.h"
+#include "../src/winsys/rio_receive_queue.h"
+#include "../src/net/mac_address.h"
+#include "../src/net/ip_address.h"
+#include "../src/net/ip_subnet.h"
+#include "../src/net/port_bitmap.h"
+#include "../src/net/port_activity_table.h"
+#include "../src/net/ip_endpoint.h"
+#include "../src/net/checksum.h"
+#include "../src/net/ipv6_helper.h"
+#include "../src/pcap/pcap.h"
+#include "../src/iphelper/network_adapter_info.h"
+#include "../src/ndisapi/network_adapter.h"
+#include "../src/ndisapi/intermediate_buffer.h"
+#include "../src/ndisapi/intermediate_buffer_pool.h"
+#include "../src/ndisapi/queued_multi_interface_packet_filter.h"
+#include "../src/ndisapi/static_filters.h"
+#include "../src/pcap/pcap_stream_logger.h"
+#include "../src/pcap/pcapng.h"
+#include "../src/pcap/pcap_async_writer.h"
+#include "../src/pcap/pcap_file_reader.h"
+#include "../src/ndisapi/tcp_local_redirect.h"
+#include "../src/proxy/proxy_common.h"
+#include "../src/proxy/socks5_common.h"
+#include "../src/proxy/socks5_connection_pool.h"
+#include "../src/ndisapi/socks5_udp_local_redirect.h"
+#include "../src/proxy/packet_pool.h"
+#include "../src/proxy/relay_buffer_pool.h"
+#include "../src/proxy/tcp_proxy_socket.h"
+#include "../src/proxy/socks5_tcp_proxy_socket.h"
+#include "../src/proxy/tcp_proxy_server.h"
+#include "../src/proxy/socks5_udp_proxy_socket.h"
+#include "../src/proxy/socks5_local_udp_proxy_server.h"
+#include "../src/proxy/flow_verdict_cache.h"
+#include "../src/proxy/flow_hold_table.h"
+#include "../src/proxy/tcp_port_map.h"
+#include "../src/proxy/app_name_matcher.h"
+#include "../src/iphelper/process_lookup.h"
+#include "../src/iphelper/interface_change_queue.h"
+#include "../src/proxy/pcap_capture_filter.h"
+#include "../src/proxy/kernel_bypass_table.h"
+#include "../src/proxy/dns_cache.h"
+#include "../src/proxy/socks5_dns_forwarder.h"
+#include "../src/proxy/proxy_group.h"
+#include "../src/proxy/socks_local_router.h"
+
+#pragma comment(lib, "ws2_32.lib")
+#pragma comment(lib, "iphlpapi.lib")
+#pragma comment(lib, "advapi32.lib")
+#pragma comment(lib, "dnsapi.lib")
+
+namespace benchmark
+{
+    using clock = std::chrono::steady_clock;
+
+    /// Keeps the compiler from optimizing away a computed value.
+    template <typename T>
+    void do_not_optimize(const T& value)
+    {
+        static volatile T sink;
+        sink = value;
+    }
+
+    /// Prints the mean time per operation of a measured run, returns it in nanoseconds.
+    inline double report(const std::string_view name, const std::size_t operations, const clock::duration elapsed)
+    {
+        const auto ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) /
+            static_cast<double>(std::max<std::size_t>(operations, 1));
+
+        std::cout << std::left << std::setw(56) << name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(10) << ns << " ns/op" << std::setw(10) << std::setprecision(2) << 1e3 / ns << " Mop/s\n";
+
+        return ns;
+    }
+
+    /// Runs body(i) for i in [0, iterations) after a warm-up of a tenth of that and reports the mean time.
+    template <typename F>
+    double run(const std::string_view name, const std::size_t iterations, F&& body)
+    {
+        for (std::size_t i = 0; i < iterations / 10; ++i)
+            body(i);
+
+        const auto start = clock::now();
+        for (std::size_t i = 0; i < iterations; ++i)
+            body(i);
+
+        return report(name, iterations, clock::now() - start);
+    }
+
+    /// Runs body(thread, i) on several threads at once and reports the mean time per operation of one thread.
+    template <typename F>
+    double run_parallel(const std::string_view name, const std::size_t threads, const std::size_t iterations, F&& body)
+    {
+        std::atomic<std::size_t> ready{ 0 };
+        std::atomic<bool> go{ false };
+        std::vector<clock::duration> elapsed(threads);
+        std::vector<std::thread> workers;
+
+        for (std::size_t t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t]
+            {
+                ready.fetch_add(1);
+                while (!go.load())
+                    std::this_thread::yield();
+
+                const auto start = clock::now();
+                for (std::size_t i = 0; i < iterations; ++i)
+                    body(t, i);
+                elapsed[t] = clock::now() - start;
+            });
+        }
+
+        while (ready.load() != threads)
+            std::this_thread::yield();
+        go.store(true);
+
+        for (auto& worker : workers)
+            worker.join();
+
+        return report(name, iterations, *std::ranges::max_element(elapsed));
+    }
+
+    /// Prints a section heading.
+    inline void section(const std::string_view title)
+    {
+        std::cout << '\n' << title << '\n' << std::string(title.size(), '-') << '\n';
+    }
+
+    /**
+     * @class latency_samples
+     * @brief Collects individual latencies and reports exact percentiles.
+     */
+    class latency_samples
+    {
+    public:
+        explicit latency_samples(const std::size_t expected = 0)
+        {
+            samples_.reserve(expected);
+        }
+
+        void add(const clock::duration sample)
+        {
+            samples_.push_back(sample);
+        }
+
+        /// Prints count, mean and the 50th, 90th, 99th and 99.9th percentiles in microseconds.
+        void report(const std::string_view name)
+        {
+            if (samples_.empty())
+            {
+                std::cout << std::left << std::setw(56) << name << " no samples\n";
+                return;
+            }
+
+            std::ranges::sort(samples_);
+
+            const auto us = [](const clock::duration d)
+            {
+                return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()) / 1e3;
+            };
+
+            const auto percentile = [&](const double fraction)
+            {
+                return us(samples_[static_cast<std::size_t>(fraction * static_cast<double>(samples_.size() - 1))]);
+            };
+
+            const auto total = std::accumulate(samples_.begin(), samples_.end(), clock::duration{});
+
+            std::cout << std::left << std::setw(56) << name << std::right << std::fixed << std::setprecision(3)
+                << " n=" << samples_.size()
+                << " mean=" << us(total) / static_cast<double>(samples_.size())
+                << " p50=" << percentile(0.5)
+                << " p90=" << percentile(0.9)
+                << " p99=" << percentile(0.99)
+                << " p99.9=" << percentile(0.999)
+                << " max=" << us(samples_.back()) << " us\n";
+        }
+
+    private:
+        std::vector<clock::duration> samples_;
+    };
+
+    /// A synthetic TCP or UDP flow, addresses and ports in network byte order.
+    struct flow_v4
+    {
+        in_addr client;
+        in_addr server;
+        uint16_t client_port;
+        uint16_t server_port;
+    };
+
+    /// Generates distinct flows from one client address to random public servers.
+    inline std::vector<flow_v4> make_flows_v4(const std::size_t count, const uint32_t seed = 42)
+    {
+        std::mt19937 generator{ seed };
+        std::vector<flow_v4> flows;
+        flows.reserve(count);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            flow_v4 flow{};
+            flow.client.S_un.S_addr = htonl(0xC0A80164); // 192.168.1.100
+            // Servers in 20.0.0.0/6, the client port alone does not identify the flow
+            flow.server.S_un.S_addr = htonl(0x14000000 | (generator() & 0x03ffffff));
+            flow.client_port = htons(static_cast<uint16_t>(1024 + i % 64000));
+            flow.server_port = htons(i % 4 == 0 ? 80 : 443);
+            flows.push_back(flow);
+        }
+
+        return flows;
+    }
+
+    /// Length of the Ethernet, IPv4 and TCP headers of the generated TCP packets.
+    constexpr std::size_t tcp_v4_headers_length = ETHER_HEADER_LENGTH + sizeof(iphdr) + sizeof(tcphdr);
+
+    /// Length of the Ethernet, IPv4 and UDP headers of the generated UDP packets.
+    constexpr std::size_t udp_v4_headers_length = ETHER_HEADER_LENGTH + sizeof(iphdr) + sizeof(udphdr);
+
+    /// Writes the Ethernet and IPv4 headers of a generated packet.
+    inline iphdr_ptr write_ipv4(INTERMEDIATE_BUFFER& packet, const in_addr source, const in_addr destination,
+                                const uint8_t protocol, const std::size_t ip_length)
+    {
+        auto* const eth_header = reinterpret_cast<ether_header_ptr>(packet.m_IBuffer);
+        constexpr unsigned char local_mac[ETH_ALEN]{ 0x00, 0x15, 0x5d, 0x01, 0x02, 0x03 };
+        constexpr unsigned char gateway_mac[ETH_ALEN]{ 0x00, 0x15, 0x5d, 0x0a, 0x0b, 0x0c };
+        std::memcpy(eth_header->h_source, local_mac, ETH_ALEN);
+        std::memcpy(eth_header->h_dest, gateway_mac, ETH_ALEN);
+        eth_header->h_proto = htons(ETH_P_IP);
+
+        auto* const ip_header = reinterpret_cast<iphdr_ptr>(packet.m_IBuffer + ETHER_HEADER_LENGTH);
+        std::memset(ip_header, 0, sizeof(iphdr));
+        ip_header->ip_v = 4;
+        ip_header->ip_hl = sizeof(iphdr) / sizeof(DWORD);
+        ip_header->ip_len = htons(static_cast<u_short>(ip_length));
+        ip_header->ip_id = htons(0x1234);
+        ip_header->ip_off = htons(IP_DF);
+        ip_header->ip_ttl = 128;
+        ip_header->ip_p = protocol;
+        ip_header->ip_src = source;
+        ip_header->ip_dst = destination;
+
+        packet.m_Length = static_cast<DWORD>(ETHER_HEADER_LENGTH + ip_length);
+        packet.m_dwDeviceFlags = PACKET_FLAG_ON_SEND;
+
+        return ip_header;
+    }
+
+    /// Builds a TCP packet of a flow with valid checksums, sent by the client unless from_server is set.
+    inline void build_tcp_v4(INTERMEDIATE_BUFFER& packet, const flow_v4& flow, const uint8_t flags,
+                             const std::size_t payload_length, const bool from_server = false)
+    {
+        auto* const ip_header = write_ipv4(packet, from_server ? flow.server : flow.client,
+                                           from_server ? flow.client : flow.server, IPPROTO_TCP,
+                                           sizeof(iphdr) + sizeof(tcphdr) + payload_length);
+
+        auto* const tcp_header = reinterpret_cast<tcphdr_ptr>(ip_header + 1);
+        std::memset(tcp_header, 0, sizeof(tcphdr));
+        tcp_header->th_sport = from_server ? flow.server_port : flow.client_port;
+        tcp_header->th_dport = from_server ? flow.client_port : flow.server_port;
+        tcp_header->th_seq = htonl(0x01020304);
+        tcp_header->th_ack = (flags & TH_ACK) ? htonl(0x05060708) : 0;
+        tcp_header->th_off = TCP_NO_OPTIONS;
+        tcp_header->th_flags = flags;
+        tcp_header->th_win = htons(65535);
+
+        auto* const payload = reinterpret_cast<uint8_t*>(tcp_header + 1);
+        for (std::size_t i = 0; i < payload_length; ++i)
+            payload[i] = static_cast<uint8_t>(i * 7);
+
+        net::ip_checksum::recalculate_ipv4_transport(packet);
+        net::ip_checksum::recalculate_ipv4_header(packet);
+    }
+
+    /// Builds a UDP datagram of a flow with valid checksums, sent by the client.
+    inline void build_udp_v4(INTERMEDIATE_BUFFER& packet, const flow_v4& flow, const std::size_t payload_length)
+    {
+        auto* const ip_header = write_ipv4(packet, flow.client, flow.server, IPPROTO_UDP,
+                                           sizeof(iphdr) + sizeof(udphdr) + payload_length);
+
+        auto* const udp_header = reinterpret_cast<udphdr_ptr>(ip_header + 1);
+        udp_header->th_sport = flow.client_port;
+        udp_header->th_dport = flow.server_port;
+        udp_header->length = htons(static_cast<u_short>(sizeof(udphdr) + payload_length));
+        udp_header->th_sum = 0;
+
+        auto* const payload = reinterpret_cast<uint8_t*>(udp_header + 1);
+        for (std::size_t i = 0; i < payload_length; ++i)
+            payload[i] = static_cast<uint8_t>(i * 7);
+
+        net::ip_checksum::recalculate_ipv4_transport(packet);
+        net::ip_checksum::recalculate_ipv4_header(packet);
+    }
+
+    /**
+     * @class header_templates
+     * @brief Pre-built packet headers of many flows, restored into a frame before every measured call.
+     *
+     * The code under test rewrites packets in place, restoring only the headers keeps the per-call
+     * copy small and the headers of a large flow table exercise the data cache like real traffic.
+     */
+    class header_templates
+    {
+    public:
+        /// Builds the headers of every flow with build(packet, flow).
+        template <typename F>
+        header_templates(const std::vector<flow_v4>& flows, const std::size_t header_length, F&& build)
+            : header_length_(header_length), headers_(flows.size() * header_length)
+        {
+            auto packet = std::make_unique<INTERMEDIATE_BUFFER>();
+
+            for (std::size_t i = 0; i < flows.size(); ++i)
+            {
+                build(*packet, flows[i]);
+                std::memcpy(headers_.data() + i * header_length_, packet->m_IBuffer, header_length_);
+                length_ = packet->m_Length;
+            }
+        }
+
+        /// Restores the headers of flow i into a frame built with the same payload length.
+        void restore(INTERMEDIATE_BUFFER& packet, const std::size_t i) const noexcept
+        {
+            std::memcpy(packet.m_IBuffer, headers_.data() + i * header_length_, header_length_);
+            packet.m_Length = length_;
+        }
+
+        [[nodiscard]] std::size_t size() const noexcept
+        {
+            return headers_.size() / header_length_;
+        }
+
+    private:
+        std::size_t header_length_;
+        std::vector<uint8_t> headers_;
+        DWORD length_{ 0 };
+    };
+
+    /// Returns a random permutation of [0, count), visiting flows out of order defeats the prefetchers.
+    inline std::vector<uint32_t> shuffled_indices(const std::size_t count, const uint32_t seed = 7)
+    {
+        std::vector<uint32_t> indices(count);
+        std::iota(indices.begin(), indices.end(), 0);
+        std::ranges::shuffle(indices, std::mt19937{ seed });
+        return indices;
+    }
+
+    /**
+     * @class winsock
+     * @brief Initializes Winsock for the lifetime of the object.
+     */
+    class winsock
+    {
+    public:
+        winsock()
+        {
+            WSADATA data{};
+            if (::WSAStartup(MAKEWORD(2, 2), &data) != 0)
+                throw std::runtime_error("WSAStartup failed");
+        }
+
+        winsock(const winsock&) = delete;
+        winsock& operator=(const winsock&) = delete;
+
+        ~winsock()
+        {
+            ::WSACleanup();
+        }
+    };
+
+    /// Returns the loopback socket address of a port in network byte order.
+    inline sockaddr_in loopback(const uint16_t port = 0)
+    {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = port;
+        return address;
+    }
+
+    /// Returns the port a socket is bound to, in network byte order.
+    inline uint16_t local_port(const SOCKET socket)
+    {
+        sockaddr_in address{};
+        int length = sizeof(address);
+        ::getsockname(socket, reinterpret_cast<sockaddr*>(&address), &length);
+        return address.sin_port;
+    }
+
+    /// Creates a loopback TCP listener on an ephemeral port.
+    inline SOCKET listen_loopback(const int backlog = SOMAXCONN)
+    {
+        const auto listener = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        const auto address = loopback();
+
+        if (listener == INVALID_SOCKET ||
+            ::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR ||
+            ::listen(listener, backlog) == SOCKET_ERROR)
+            throw std::runtime_error("failed to create the loopback listener");
+
+        return listener;
+    }
+
+    /// Connects a TCP socket to a loopback port (network byte order) with Nagle disabled.
+    inline SOCKET connect_loopback(const uint16_t port)
+    {
+        const auto socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        const auto address = loopback(port);
+
+        if (socket == INVALID_SOCKET ||
+            ::connect(socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR)
+        {
+            if (socket != INVALID_SOCKET)
+                ::closesocket(socket);
+            return INVALID_SOCKET;
+        }
+
+        constexpr BOOL no_delay = TRUE;
+        ::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&no_delay), sizeof(no_delay));
+
+        return socket;
+    }
+
+    /// Receives exactly length bytes, returns false if the connection was closed or failed first.
+    inline bool receive_all(const SOCKET socket, void* data, const std::size_t length)
+    {
+        auto* position = static_cast<char*>(data);
+
+        for (auto remaining = length; remaining != 0;)
+        {
+            const auto received = ::recv(socket, position, static_cast<int>(std::min<std::size_t>(remaining, INT_MAX)), 0);
+            if (received <= 0)
+                return false;
+
+            position += received;
+            remaining -= static_cast<std::size_t>(received);
+        }
+
+        return true;
+    }
+
+    /// Sends exactly length bytes, returns false on failure.
+    inline bool send_all(const SOCKET socket, const void* data, const std::size_t length)
+    {
+        const auto* position = static_cast<const char*>(data);
+
+        for (auto remaining = length; remaining != 0;)
+        {
+            const auto sent = ::send(socket, position, static_cast<int>(std::min<std::size_t>(remaining, INT_MAX)), 0);
+            if (sent <= 0)
+                return false;
+
+            position += sent;
+            remaining -= static_cast<std::size_t>(sent);
+        }
+
+        return true;
+    }
+
+    /**
+     * @class loopback_connections
+     * @brief Established loopback TCP connections owned by this process.
+     *
+     * Fills the system TCP table with real rows of this process, so the process lookup and the
+     * router resolve the flows built from them.
+     */
+    class loopback_connections
+    {
+    public:
+        explicit loopback_connections(const std::size_t count)
+        {
+            listener_ = listen_loopback();
+            const auto port = local_port(listener_);
+
+            clients_.reserve(count);
+            servers_.reserve(count);
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const auto client = connect_loopback(port);
+                if (client == INVALID_SOCKET)
+                    break;
+
+                clients_.push_back(client);
+                servers_.push_back(::accept(listener_, nullptr, nullptr));
+            }
+        }
+
+        loopback_connections(const loopback_connections&) = delete;
+        loopback_connections& operator=(const loopback_connections&) = delete;
+
+        ~loopback_connections()
+        {
+            for (const auto socket : clients_)
+                ::closesocket(socket);
+            for (const auto socket : servers_)
+                ::closesocket(socket);
+            ::closesocket(listener_);
+        }
+
+        /// Returns the client side flows, seen as leaving the client towards the listener.
+        [[nodiscard]] std::vector<flow_v4> flows() const
+        {
+            std::vector<flow_v4> result;
+            result.reserve(clients_.size());
+
+            const auto server_port = local_port(listener_);
+
+            for (const auto client : clients_)
+            {
+                flow_v4 flow{};
+                flow.client.S_un.S_addr = htonl(INADDR_LOOPBACK);
+                flow.server.S_un.S_addr = htonl(INADDR_LOOPBACK);
+                flow.client_port = local_port(client);
+                flow.server_port = server_port;
+                result.push_back(flow);
+            }
+
+            return result;
+        }
+
+        [[nodiscard]] std::size_t size() const noexcept
+        {
+            return clients_.size();
+        }
+
+    private:
+        SOCKET listener_{ INVALID_SOCKET };
+        std::vector<SOCKET> clients_;
+        std::vector<SOCKET> servers_;
+    };
+}
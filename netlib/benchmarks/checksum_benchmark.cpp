@@ -0,0 +1,113 @@
+// --------------------------------------------------------------------------------
+/// <summary>
+/// Module Name:  checksum_benchmark.cpp
+/// Abstract: Microbenchmark of the net::ip_checksum summing kernels
+/// </summary>
+/// Build (x64 Native Tools Command Prompt, from this directory):
+///   cl /O2 /std:c++20 /EHsc /I..\..\include checksum_benchmark.cpp ws2_32.lib
+/// Usage:
+///   checksum_benchmark [iterations]
+// --------------------------------------------------------------------------------
+
+#define NOMINMAX 1
+
+#include <WinSock2.h>
+#include <ws2tcpip.h>
+#include <in6addr.h>
+#include <intrin.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "../../include/Common.h"
+#include "../src/iphlp.h"
+#include "../src/net/checksum.h"
+
+namespace
+{
+    using kernel = net::ip_checksum::kernel;
+
+    constexpr std::array payload_sizes{ std::size_t{ 64 }, std::size_t{ 576 }, std::size_t{ 1500 }, std::size_t{ 9000 } };
+
+    constexpr std::array<std::pair<kernel, std::string_view>, 3> kernels{ {
+        { kernel::scalar, "scalar" },
+        { kernel::sse41, "sse4.1" },
+        { kernel::avx2, "avx2" }
+    } };
+
+    /// Returns true if a kernel can run on this CPU (kernels are ordered by the instruction set they need).
+    bool is_supported(const kernel implementation)
+    {
+        return static_cast<uint8_t>(implementation) <= static_cast<uint8_t>(net::ip_checksum::active_kernel());
+    }
+
+    /// Sums the buffer at every byte offset in [0, 8) so that unaligned heads and tails are covered too.
+    uint64_t run(const kernel implementation, const std::vector<uint8_t>& buffer, const std::size_t size,
+                 const std::size_t iterations)
+    {
+        uint64_t sink = 0;
+
+        for (std::size_t i = 0; i < iterations; ++i)
+            sink += net::ip_checksum::finish(net::ip_checksum::partial(implementation, buffer.data() + (i & 7), size));
+
+        return sink;
+    }
+}
+
+int main(const int argc, char* argv[])
+{
+    const std::size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2'000'000;
+
+    std::vector<uint8_t> buffer(payload_sizes.back() + 8);
+    std::mt19937 generator{ 42 };
+    std::ranges::generate(buffer, [&generator] { return static_cast<uint8_t>(generator()); });
+
+    std::cout << "active kernel: " << kernels[static_cast<std::size_t>(net::ip_checksum::active_kernel())].second
+        << ", iterations: " << iterations << '\n';
+
+    for (const auto size : payload_sizes)
+    {
+        // Every kernel must produce the scalar result
+        const auto reference = run(kernel::scalar, buffer, size, 64);
+        double scalar_ns = 0;
+
+        for (const auto& [implementation, name] : kernels)
+        {
+            if (!is_supported(implementation))
+            {
+                std::cout << size << " B\t" << name << "\tnot supported\n";
+                continue;
+            }
+
+            if (run(implementation, buffer, size, 64) != reference)
+            {
+                std::cerr << size << " B\t" << name << "\tresult mismatch\n";
+                return 1;
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            volatile auto sink = run(implementation, buffer, size, iterations);
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            static_cast<void>(sink);
+
+            const auto ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) /
+                static_cast<double>(iterations);
+
+            if (implementation == kernel::scalar)
+                scalar_ns = ns;
+
+            std::cout << size << " B\t" << name << '\t' << ns << " ns\t"
+                << static_cast<double>(size) / ns << " GB/s\t"
+                << "x" << scalar_ns / ns << '\n';
+        }
+    }
+
+    return 0;
+}
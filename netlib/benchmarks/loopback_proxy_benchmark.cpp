@@ -0,0 +1,633 @@
+// --------------------------------------------------------------------------------
+/// <summary>
+/// Module Name:  loopback_proxy_benchmark.cpp
+/// Abstract: End-to-end throughput and latency through tcp_proxy_server and
+/// socks5_local_udp_proxy_server against a local SOCKS5 echo server
+/// </summary>
+/// Build (x64 Native Tools Command Prompt, from this directory, after building the solution):
+///   cl /O2 /std:c++20 /EHsc /D_CRT_RAND_S /D_ENABLE_EXTENDED_ALIGNED_STORAGE
+///      /I%VCPKG_ROOT%\installed\x64-windows\include loopback_proxy_benchmark.cpp
+///      ..\..\bin\lib\x64\Release\ndisapi.lib
+/// Usage:
+///   loopback_proxy_benchmark [megabytes] [--fast-relay] [--registered-io]
+/// Clients connect to the local proxy servers directly, standing in for the connections the
+/// router redirects; UDP clients prepend the SOCKS5 UDP header the redirect would insert. The
+/// driver is not needed. Every test is also run directly against the echo server, the
+/// difference is the cost of the local proxy.
+// --------------------------------------------------------------------------------
+
+#include "benchmark.h"
+
+namespace
+{
+    using namespace benchmark;
+    using address_t = net::ip_address_v4;
+    using tcp_server_t = proxy::tcp_proxy_server<proxy::socks5_tcp_proxy_socket<address_t>>;
+    using udp_server_t = proxy::socks5_local_udp_proxy_server<proxy::socks5_udp_proxy_socket<address_t>>;
+
+    /// Destination requested from the echo server, it is never contacted.
+    constexpr uint16_t echo_destination_port = 7;
+
+    /// Returns the loopback address as a netlib address.
+    address_t loopback_address()
+    {
+        in_addr address{};
+        address.s_addr = htonl(INADDR_LOOPBACK);
+        return address_t{ address };
+    }
+
+    /**
+     * @class socks5_echo_server
+     * @brief Minimal SOCKS5 server on loopback that echoes instead of relaying.
+     *
+     * Only the no-authentication method is offered. CONNECT sessions echo every byte back to the
+     * client. UDP ASSOCIATE sessions are given a relay socket that returns every datagram to its
+     * sender unchanged, SOCKS5 header included: the header of a reply carries the address of the
+     * peer that sent it, which is the destination being echoed. One thread per session.
+     */
+    class socks5_echo_server
+    {
+    public:
+        socks5_echo_server()
+        {
+            listener_ = listen_loopback();
+
+            relay_ = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            const auto relay_address = loopback();
+
+            if (relay_ == INVALID_SOCKET ||
+                ::bind(relay_, reinterpret_cast<const sockaddr*>(&relay_address), sizeof(relay_address)) == SOCKET_ERROR)
+                throw std::runtime_error("failed to create the UDP relay socket");
+
+            // Datagrams to a closed client port must not fail the next receive
+            BOOL report_reset = FALSE;
+            DWORD returned = 0;
+            ::WSAIoctl(relay_, SIO_UDP_CONNRESET, &report_reset, sizeof(report_reset), nullptr, 0, &returned, nullptr, nullptr);
+
+            constexpr int buffer_size = 4 * 1024 * 1024;
+            ::setsockopt(relay_, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&buffer_size), sizeof(buffer_size));
+            ::setsockopt(relay_, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&buffer_size), sizeof(buffer_size));
+
+            accept_thread_ = std::thread([this] { accept_sessions(); });
+            relay_thread_ = std::thread([this] { relay_datagrams(); });
+        }
+
+        socks5_echo_server(const socks5_echo_server&) = delete;
+        socks5_echo_server& operator=(const socks5_echo_server&) = delete;
+
+        ~socks5_echo_server()
+        {
+            ::closesocket(listener_);
+            ::closesocket(relay_);
+            accept_thread_.join();
+            relay_thread_.join();
+
+            // Unblocks the sessions still waiting for their client
+            for (const auto session : sessions_)
+                ::shutdown(session, SD_BOTH);
+
+            for (auto& thread : threads_)
+                thread.join();
+
+            for (const auto session : sessions_)
+                ::closesocket(session);
+        }
+
+        /// Returns the SOCKS5 port in host byte order.
+        [[nodiscard]] uint16_t port() const
+        {
+            return ntohs(local_port(listener_));
+        }
+
+        /// Returns the UDP relay port in host byte order.
+        [[nodiscard]] uint16_t relay_port() const
+        {
+            return ntohs(local_port(relay_));
+        }
+
+    private:
+        void accept_sessions()
+        {
+            for (;;)
+            {
+                const auto session = ::accept(listener_, nullptr, nullptr);
+                if (session == INVALID_SOCKET)
+                    return;
+
+                constexpr BOOL no_delay = TRUE;
+                ::setsockopt(session, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&no_delay), sizeof(no_delay));
+
+                // Only this thread touches the session lists until the destructor joins it
+                sessions_.push_back(session);
+                threads_.emplace_back([this, session] { serve(session); });
+            }
+        }
+
+        void serve(const SOCKET session) const
+        {
+            // Greeting: VER NMETHODS METHODS
+            std::array<uint8_t, 255> buffer{};
+            if (!receive_all(session, buffer.data(), 2) || buffer[0] != 5 || !receive_all(session, buffer.data(), buffer[1]))
+                return;
+
+            constexpr std::array<uint8_t, 2> no_authentication{ 5, 0 };
+            if (!send_all(session, no_authentication.data(), no_authentication.size()))
+                return;
+
+            // Request: VER CMD RSV ATYP DST.ADDR DST.PORT
+            std::array<uint8_t, 4> request{};
+            if (!receive_all(session, request.data(), request.size()))
+                return;
+
+            std::size_t address_length = request[3] == 1 ? 4 : request[3] == 4 ? 16 : 0;
+            if (request[3] == 3)
+            {
+                uint8_t name_length = 0;
+                if (!receive_all(session, &name_length, 1))
+                    return;
+                address_length = name_length;
+            }
+
+            if (!receive_all(session, buffer.data(), address_length + 2))
+                return;
+
+            const auto command = request[1];
+
+            // Reply: VER REP RSV ATYP BND.ADDR BND.PORT, UDP ASSOCIATE returns the relay endpoint
+            std::array<uint8_t, 10> reply{ 5, 0, 0, 1, 127, 0, 0, 1, 0, 0 };
+            const auto bound_port = htons(command == 3 ? relay_port() : port());
+            std::memcpy(&reply[8], &bound_port, sizeof(bound_port));
+
+            if (command != 1 && command != 3)
+                reply[1] = 7; // command not supported
+
+            if (!send_all(session, reply.data(), reply.size()) || reply[1] != 0)
+                return;
+
+            std::vector<char> data(64 * 1024);
+
+            for (;;)
+            {
+                // An association lasts as long as its control connection
+                const auto received = ::recv(session, data.data(), static_cast<int>(data.size()), 0);
+                if (received <= 0 || (command == 1 && !send_all(session, data.data(), static_cast<std::size_t>(received))))
+                    return;
+            }
+        }
+
+        void relay_datagrams() const
+        {
+            std::vector<char> datagram(64 * 1024);
+
+            for (;;)
+            {
+                sockaddr_storage from{};
+                int from_length = sizeof(from);
+
+                const auto received = ::recvfrom(relay_, datagram.data(), static_cast<int>(datagram.size()), 0,
+                                                 reinterpret_cast<sockaddr*>(&from), &from_length);
+                if (received == SOCKET_ERROR)
+                {
+                    if (::WSAGetLastError() == WSAEMSGSIZE)
+                        continue;
+                    return;
+                }
+
+                ::sendto(relay_, datagram.data(), received, 0, reinterpret_cast<const sockaddr*>(&from), from_length);
+            }
+        }
+
+        SOCKET listener_{ INVALID_SOCKET };
+        SOCKET relay_{ INVALID_SOCKET };
+        std::thread accept_thread_;
+        std::thread relay_thread_;
+        std::vector<SOCKET> sessions_;
+        std::vector<std::thread> threads_;
+    };
+
+    /**
+     * @class local_proxies
+     * @brief The TCP and UDP proxy servers of one SOCKS5 proxy, as the router creates them.
+     *
+     * Every accepted connection and every new UDP client is relayed through the echo server.
+     */
+    class local_proxies
+    {
+    public:
+        local_proxies(const socks5_echo_server& upstream, const bool fast_relay, const bool registered_io)
+        {
+            if (!ports_.valid())
+                throw std::runtime_error("failed to create the I/O completion port");
+
+            ports_.start_thread_pool();
+
+            const auto upstream_port = upstream.port();
+
+            tcp_ = std::make_unique<tcp_server_t>(0, ports_, [upstream_port](const address_t&, uint16_t)
+            {
+                return std::make_tuple(loopback_address(), upstream_port,
+                    std::make_unique<tcp_server_t::negotiate_context_t>(loopback_address(), echo_destination_port,
+                                                                        std::nullopt, std::nullopt));
+            }, netlib::log::log_level::error, nullptr, fast_relay);
+
+            udp_ = std::make_unique<udp_server_t>(0, ports_, [upstream_port](const address_t&, uint16_t)
+            {
+                return std::make_tuple(loopback_address(), upstream_port,
+                    std::make_unique<udp_server_t::negotiate_context_t>(address_t{}, 0, std::nullopt, std::nullopt));
+            }, netlib::log::log_level::error, nullptr, registered_io);
+
+            if (!tcp_->start() || !udp_->start())
+                throw std::runtime_error("failed to start the local proxy servers");
+        }
+
+        local_proxies(const local_proxies&) = delete;
+        local_proxies& operator=(const local_proxies&) = delete;
+
+        ~local_proxies()
+        {
+            tcp_->stop();
+            udp_->stop();
+            ports_.stop_thread_pool();
+        }
+
+        /// Returns the TCP proxy port in network byte order.
+        [[nodiscard]] uint16_t tcp_port() const
+        {
+            return htons(tcp_->proxy_port());
+        }
+
+        /// Returns the UDP proxy port in network byte order.
+        [[nodiscard]] uint16_t udp_port() const
+        {
+            return htons(udp_->proxy_port());
+        }
+
+    private:
+        netlib::winsys::io_completion_port_group ports_;
+        std::unique_ptr<tcp_server_t> tcp_;
+        std::unique_ptr<udp_server_t> udp_;
+    };
+
+    /// Opens an echo session: through the local proxy, or straight to the echo server with the SOCKS5 handshake done here.
+    SOCKET open_tcp_session(const socks5_echo_server& echo, const local_proxies* proxies)
+    {
+        if (proxies)
+            return connect_loopback(proxies->tcp_port());
+
+        const auto socket = connect_loopback(htons(echo.port()));
+        if (socket == INVALID_SOCKET)
+            return INVALID_SOCKET;
+
+        constexpr std::array<uint8_t, 3> greeting{ 5, 1, 0 };
+        constexpr std::array<uint8_t, 10> connect{ 5, 1, 0, 1, 127, 0, 0, 1, 0, echo_destination_port };
+        std::array<uint8_t, 10> reply{};
+
+        if (!send_all(socket, greeting.data(), greeting.size()) || !receive_all(socket, reply.data(), 2) ||
+            !send_all(socket, connect.data(), connect.size()) || !receive_all(socket, reply.data(), reply.size()) ||
+            reply[1] != 0)
+        {
+            ::closesocket(socket);
+            return INVALID_SOCKET;
+        }
+
+        return socket;
+    }
+
+    /// Name suffix of a test run through the proxy or directly.
+    std::string_view path_name(const local_proxies* proxies)
+    {
+        return proxies ? "local proxy" : "direct";
+    }
+
+    void tcp_setup_benchmark(const socks5_echo_server& echo, const local_proxies* proxies)
+    {
+        constexpr std::size_t connections = 2'000;
+        latency_samples samples(connections);
+
+        const auto start = clock::now();
+
+        for (std::size_t i = 0; i < connections; ++i)
+        {
+            const auto begin = clock::now();
+            const auto socket = open_tcp_session(echo, proxies);
+
+            char byte = 'x';
+            if (socket == INVALID_SOCKET || !send_all(socket, &byte, 1) || !receive_all(socket, &byte, 1))
+                throw std::runtime_error("TCP session setup failed");
+
+            samples.add(clock::now() - begin);
+            ::closesocket(socket);
+        }
+
+        report(std::format("TCP connect + first echo, {}", path_name(proxies)), connections, clock::now() - start);
+        samples.report(std::format("TCP connect + first echo latency, {}", path_name(proxies)));
+    }
+
+    void tcp_round_trip_benchmark(const socks5_echo_server& echo, const local_proxies* proxies)
+    {
+        const auto socket = open_tcp_session(echo, proxies);
+        if (socket == INVALID_SOCKET)
+            throw std::runtime_error("TCP session setup failed");
+
+        for (const auto size : { std::size_t{ 64 }, std::size_t{ 16 * 1024 } })
+        {
+            constexpr std::size_t round_trips = 20'000;
+            std::vector<char> message(size, 'r');
+            latency_samples samples(round_trips);
+
+            for (std::size_t i = 0; i < round_trips; ++i)
+            {
+                const auto begin = clock::now();
+                if (!send_all(socket, message.data(), size) || !receive_all(socket, message.data(), size))
+                    throw std::runtime_error("TCP round trip failed");
+                samples.add(clock::now() - begin);
+            }
+
+            samples.report(std::format("TCP round trip {} B, {}", size, path_name(proxies)));
+        }
+
+        ::closesocket(socket);
+    }
+
+    void tcp_throughput_benchmark(const socks5_echo_server& echo, const local_proxies* proxies, const std::size_t megabytes)
+    {
+        for (const std::size_t streams : { 1, 8 })
+        {
+            std::vector<SOCKET> sockets;
+            for (std::size_t i = 0; i < streams; ++i)
+            {
+                sockets.push_back(open_tcp_session(echo, proxies));
+                if (sockets.back() == INVALID_SOCKET)
+                    throw std::runtime_error("TCP session setup failed");
+            }
+
+            const auto per_stream = megabytes * 1024 * 1024 / streams;
+            std::atomic<bool> failed{ false };
+            std::vector<std::thread> threads;
+
+            const auto start = clock::now();
+
+            for (const auto socket : sockets)
+            {
+                threads.emplace_back([socket, per_stream, &failed]
+                {
+                    std::vector<char> chunk(64 * 1024, 's');
+                    for (std::size_t sent = 0; sent < per_stream && !failed; sent += chunk.size())
+                    {
+                        if (!send_all(socket, chunk.data(), std::min(chunk.size(), per_stream - sent)))
+                            failed = true;
+                    }
+                });
+
+                threads.emplace_back([socket, per_stream, &failed]
+                {
+                    std::vector<char> chunk(64 * 1024);
+                    for (std::size_t received = 0; received < per_stream && !failed;)
+                    {
+                        const auto length = ::recv(socket, chunk.data(), static_cast<int>(chunk.size()), 0);
+                        if (length <= 0)
+                        {
+                            failed = true;
+                            break;
+                        }
+                        received += static_cast<std::size_t>(length);
+                    }
+                });
+            }
+
+            for (auto& thread : threads)
+                thread.join();
+
+            const auto elapsed = std::chrono::duration<double>(clock::now() - start).count();
+
+            for (const auto socket : sockets)
+                ::closesocket(socket);
+
+            if (failed)
+                throw std::runtime_error("TCP stream failed");
+
+            std::cout << std::left << std::setw(56) << std::format("TCP echo throughput, {} streams, {}", streams, path_name(proxies))
+                << std::right << std::fixed << std::setprecision(1) << std::setw(10)
+                << static_cast<double>(megabytes) / elapsed << " MiB/s each way\n";
+        }
+    }
+
+    /// Size of the SOCKS5 UDP header of an IPv4 destination.
+    constexpr std::size_t socks5_udp_header_length = 10;
+
+    /// Opens a UDP client: to the local proxy, its datagrams carrying the header the redirect inserts, or to the relay directly.
+    SOCKET open_udp_client(const socks5_echo_server& echo, const local_proxies* proxies)
+    {
+        const auto socket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        const auto peer = loopback(proxies ? proxies->udp_port() : htons(echo.relay_port()));
+
+        if (socket == INVALID_SOCKET ||
+            ::connect(socket, reinterpret_cast<const sockaddr*>(&peer), sizeof(peer)) == SOCKET_ERROR)
+            throw std::runtime_error("failed to create the UDP client");
+
+        constexpr int buffer_size = 4 * 1024 * 1024;
+        ::setsockopt(socket, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&buffer_size), sizeof(buffer_size));
+
+        return socket;
+    }
+
+    /// Builds a datagram of the given payload size with the SOCKS5 UDP header and a sequence number.
+    std::vector<char> make_datagram(const std::size_t payload)
+    {
+        std::vector<char> datagram(socks5_udp_header_length + std::max<std::size_t>(payload, sizeof(uint32_t)), 'u');
+        constexpr std::array<uint8_t, socks5_udp_header_length> header{ 0, 0, 0, 1, 127, 0, 0, 1, 0, echo_destination_port };
+        std::memcpy(datagram.data(), header.data(), header.size());
+        return datagram;
+    }
+
+    /// Sets the receive timeout of a socket.
+    void set_receive_timeout(const SOCKET socket, const DWORD milliseconds)
+    {
+        ::setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&milliseconds), sizeof(milliseconds));
+    }
+
+    /// Sends a datagram and waits for its echo, the first datagram of a session waits for the association.
+    bool udp_round_trip(const SOCKET socket, std::vector<char>& datagram, std::vector<char>& reply, const uint32_t sequence)
+    {
+        std::memcpy(datagram.data() + socks5_udp_header_length, &sequence, sizeof(sequence));
+
+        if (::send(socket, datagram.data(), static_cast<int>(datagram.size()), 0) == SOCKET_ERROR)
+            return false;
+
+        for (;;)
+        {
+            const auto received = ::recv(socket, reply.data(), static_cast<int>(reply.size()), 0);
+            if (received <= 0)
+                return false;
+
+            if (static_cast<std::size_t>(received) < socks5_udp_header_length + sizeof(sequence))
+                continue;
+
+            // Late echoes of lost round trips are skipped
+            uint32_t echoed = 0;
+            std::memcpy(&echoed, reply.data() + socks5_udp_header_length, sizeof(echoed));
+
+            if (echoed == sequence)
+                return true;
+        }
+    }
+
+    void udp_setup_benchmark(const socks5_echo_server& echo, const local_proxies* proxies)
+    {
+        constexpr std::size_t sessions = 200;
+        latency_samples samples(sessions);
+        auto datagram = make_datagram(64);
+        std::vector<char> reply(64 * 1024);
+
+        for (std::size_t i = 0; i < sessions; ++i)
+        {
+            const auto socket = open_udp_client(echo, proxies);
+            set_receive_timeout(socket, 2'000);
+
+            const auto begin = clock::now();
+            if (udp_round_trip(socket, datagram, reply, 0))
+                samples.add(clock::now() - begin);
+
+            ::closesocket(socket);
+        }
+
+        samples.report(std::format("UDP new session, first echo latency, {}", path_name(proxies)));
+    }
+
+    void udp_round_trip_benchmark(const socks5_echo_server& echo, const local_proxies* proxies)
+    {
+        const auto socket = open_udp_client(echo, proxies);
+        auto datagram = make_datagram(64);
+        std::vector<char> reply(64 * 1024);
+
+        set_receive_timeout(socket, 2'000);
+        if (!udp_round_trip(socket, datagram, reply, 0))
+            throw std::runtime_error("UDP session setup failed");
+
+        set_receive_timeout(socket, 200);
+
+        constexpr std::size_t round_trips = 20'000;
+        latency_samples samples(round_trips);
+        std::size_t lost = 0;
+
+        for (uint32_t i = 1; i <= round_trips; ++i)
+        {
+            const auto begin = clock::now();
+            if (udp_round_trip(socket, datagram, reply, i))
+                samples.add(clock::now() - begin);
+            else
+                ++lost;
+        }
+
+        samples.report(std::format("UDP round trip 64 B, {} ({} lost)", path_name(proxies), lost));
+        ::closesocket(socket);
+    }
+
+    void udp_throughput_benchmark(const socks5_echo_server& echo, const local_proxies* proxies)
+    {
+        // QUIC sized datagrams with a bounded number in flight, as a congestion controlled sender keeps it
+        constexpr std::size_t datagrams = 200'000;
+        constexpr std::size_t window = 128;
+        constexpr std::size_t payload = 1'200;
+
+        const auto socket = open_udp_client(echo, proxies);
+        auto datagram = make_datagram(payload);
+        std::vector<char> reply(64 * 1024);
+
+        set_receive_timeout(socket, 2'000);
+        if (!udp_round_trip(socket, datagram, reply, 0))
+            throw std::runtime_error("UDP session setup failed");
+
+        set_receive_timeout(socket, 500);
+
+        std::atomic<std::size_t> received{ 0 };
+        std::atomic<bool> sending{ true };
+
+        const auto start = clock::now();
+
+        std::thread receiver([&]
+        {
+            std::vector<char> buffer(64 * 1024);
+            while (received.load() < datagrams)
+            {
+                if (::recv(socket, buffer.data(), static_cast<int>(buffer.size()), 0) > 0)
+                    received.fetch_add(1);
+                else if (!sending.load())
+                    break;
+            }
+        });
+
+        for (std::size_t sent = 0; sent < datagrams; ++sent)
+        {
+            // A lost datagram must not stall the window forever
+            const auto wait_started = clock::now();
+            while (sent - received.load() >= window && clock::now() - wait_started < std::chrono::milliseconds(20))
+                std::this_thread::yield();
+
+            ::send(socket, datagram.data(), static_cast<int>(datagram.size()), 0);
+        }
+
+        sending = false;
+        receiver.join();
+
+        const auto elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        const auto delivered = received.load();
+
+        std::cout << std::left << std::setw(56) << std::format("UDP echo throughput, {} B datagrams, {}", payload, path_name(proxies))
+            << std::right << std::fixed << std::setprecision(1) << std::setw(10)
+            << static_cast<double>(delivered) / elapsed / 1e3 << " kdatagram/s"
+            << std::setw(8) << static_cast<double>(delivered * payload) / elapsed / (1024 * 1024) << " MiB/s"
+            << std::setw(8) << 100.0 * static_cast<double>(datagrams - delivered) / datagrams << " % lost\n";
+
+        ::closesocket(socket);
+    }
+}
+
+int main(const int argc, char* argv[])
+{
+    std::size_t megabytes = 1'024;
+    auto fast_relay = false;
+    auto registered_io = false;
+
+    for (auto i = 1; i < argc; ++i)
+    {
+        const std::string_view argument{ argv[i] };
+
+        if (argument == "--fast-relay")
+            fast_relay = true;
+        else if (argument == "--registered-io")
+            registered_io = true;
+        else
+            megabytes = std::strtoull(argv[i], nullptr, 10);
+    }
+
+    try
+    {
+        const winsock sockets;
+        const socks5_echo_server echo;
+        const local_proxies proxies(echo, fast_relay, registered_io);
+
+        std::cout << "stream size: " << megabytes << " MiB, fast relay: " << fast_relay
+            << ", registered I/O: " << registered_io << '\n';
+
+        for (const auto* path : { static_cast<const local_proxies*>(nullptr), &proxies })
+        {
+            section(std::format("TCP, {}", path_name(path)));
+            tcp_setup_benchmark(echo, path);
+            tcp_round_trip_benchmark(echo, path);
+            tcp_throughput_benchmark(echo, path, megabytes);
+
+            section(std::format("UDP, {}", path_name(path)));
+            udp_setup_benchmark(echo, path);
+            udp_round_trip_benchmark(echo, path);
+            udp_throughput_benchmark(echo, path);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "error: " << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
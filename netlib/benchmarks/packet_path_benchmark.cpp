@@ -0,0 +1,403 @@
+// --------------------------------------------------------------------------------
+/// <summary>
+/// Module Name:  packet_path_benchmark.cpp
+/// Abstract: Microbenchmarks of the per-packet work of the router: checksum recomputation,
+/// packet_pool, tcp_local_redirect, process_lookup, the destination inclusion policy and
+/// socks_local_router::filter_packet
+/// </summary>
+/// Build (x64 Native Tools Command Prompt, from this directory, after building the solution):
+///   cl /O2 /std:c++20 /EHsc /D_CRT_RAND_S /D_ENABLE_EXTENDED_ALIGNED_STORAGE /DPCH_H
+///      /I..\..\socksify /I%VCPKG_ROOT%\installed\x64-windows\include packet_path_benchmark.cpp
+///      ..\..\socksify\policy\dest_inclusion_policy.cpp ..\..\bin\lib\x64\Release\ndisapi.lib
+///   (/DPCH_H skips the C++/CLI precompiled header included by dest_inclusion_policy.cpp)
+/// Usage:
+///   packet_path_benchmark [iterations]
+/// The router runs in replay mode, it is never attached to the driver.
+// --------------------------------------------------------------------------------
+
+#include "benchmark.h"
+#include "../../socksify/policy/dest_inclusion_policy.h"
+
+namespace
+{
+    using namespace benchmark;
+
+    /// Connection table sizes of the redirect benchmarks.
+    constexpr std::array table_sizes{ std::size_t{ 1'024 }, std::size_t{ 16'384 }, std::size_t{ 65'536 } };
+
+    /// Numbers of real connections in the system TCP table for the process lookup benchmarks.
+    constexpr std::array connection_counts{ std::size_t{ 256 }, std::size_t{ 4'096 } };
+
+    /// Port of the local proxy the redirect benchmarks rewrite to (host byte order).
+    constexpr uint16_t local_proxy_port = 50'000;
+
+    void checksum_benchmarks(const std::size_t iterations)
+    {
+        section("Checksum recomputation (IPv4)");
+
+        const auto flow = make_flows_v4(1).front();
+        auto packet = std::make_unique<INTERMEDIATE_BUFFER>();
+
+        for (const auto payload : { std::size_t{ 0 }, std::size_t{ 536 }, std::size_t{ 1'460 } })
+        {
+            build_tcp_v4(*packet, flow, TH_ACK | TH_PSH, payload);
+
+            run(std::format("recalculate_ipv4_transport, TCP {} B payload", payload), iterations, [&](std::size_t)
+            {
+                net::ip_checksum::recalculate_ipv4_transport(*packet);
+                do_not_optimize(reinterpret_cast<tcphdr_ptr>(packet->m_IBuffer + ETHER_HEADER_LENGTH + sizeof(iphdr))->th_sum);
+            });
+        }
+
+        run("recalculate_ipv4_header", iterations, [&](std::size_t)
+        {
+            net::ip_checksum::recalculate_ipv4_header(*packet);
+            do_not_optimize(reinterpret_cast<iphdr_ptr>(packet->m_IBuffer + ETHER_HEADER_LENGTH)->ip_sum);
+        });
+
+        auto* const tcp_header = reinterpret_cast<tcphdr_ptr>(packet->m_IBuffer + ETHER_HEADER_LENGTH + sizeof(iphdr));
+
+        run("checksum_delta, port rewrite", iterations, [&](const std::size_t i)
+        {
+            net::checksum_delta delta;
+            const auto port = static_cast<uint16_t>(i);
+            delta.replace(tcp_header->th_dport, port);
+            tcp_header->th_dport = port;
+            delta.apply(tcp_header->th_sum);
+            do_not_optimize(tcp_header->th_sum);
+        });
+    }
+
+    void packet_pool_benchmarks(const std::size_t iterations)
+    {
+        section("packet_pool");
+
+        proxy::packet_pool pool;
+
+        run("allocate + free, 1514 B", iterations, [&](std::size_t)
+        {
+            auto packet = pool.allocate(1514);
+            do_not_optimize(packet.get());
+            pool.free(std::move(packet));
+        });
+
+        run("allocate + free, 64 KiB", iterations, [&](std::size_t)
+        {
+            auto packet = pool.allocate(65'536);
+            do_not_optimize(packet.get());
+            pool.free(std::move(packet));
+        });
+
+        // Bursts larger than a magazine exchange magazines with the depot
+        constexpr std::size_t burst = 256;
+        std::vector<std::unique_ptr<proxy::net_packet_t>> packets(burst);
+
+        run(std::format("allocate {0} then free {0}, 1514 B (per burst)", burst), iterations / burst, [&](std::size_t)
+        {
+            for (auto& packet : packets)
+                packet = pool.allocate(1514);
+            for (auto& packet : packets)
+                pool.free(std::move(packet));
+        });
+
+        const auto threads = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 2, 8);
+
+        run_parallel(std::format("allocate + free, 1514 B, {} threads", threads), threads, iterations,
+            [&](std::size_t, std::size_t)
+        {
+            auto packet = pool.allocate(1514);
+            do_not_optimize(packet.get());
+            pool.free(std::move(packet));
+        });
+
+        run("heap baseline, make_unique<net_packet_t>", iterations / 10, [&](std::size_t)
+        {
+            auto packet = std::make_unique<proxy::net_packet_t>();
+            do_not_optimize(packet.get());
+        });
+    }
+
+    void tcp_redirect_benchmarks(const std::size_t iterations)
+    {
+        section("tcp_local_redirect (IPv4)");
+
+        auto packet = std::make_unique<INTERMEDIATE_BUFFER>();
+
+        for (const auto size : table_sizes)
+        {
+            const auto flows = make_flows_v4(size);
+            const auto order = shuffled_indices(size);
+
+            const header_templates syn(flows, tcp_v4_headers_length, [](auto& p, const auto& f)
+            {
+                build_tcp_v4(p, f, TH_SYN, 0);
+            });
+
+            const header_templates client_to_server(flows, tcp_v4_headers_length, [](auto& p, const auto& f)
+            {
+                build_tcp_v4(p, f, TH_ACK | TH_PSH, 1'460);
+            });
+
+            // The local proxy answers from its port to the client port, towards the original server
+            const header_templates server_to_client(flows, tcp_v4_headers_length, [](auto& p, const auto& f)
+            {
+                build_tcp_v4(p, flow_v4{ f.client, f.server, htons(local_proxy_port), f.client_port }, TH_ACK, 0);
+            });
+
+            ndisapi::tcp_local_redirect<net::ip_address_v4> redirect(local_proxy_port);
+
+            // Every SYN creates a connection entry, so the table is filled once without a warm-up
+            const auto start = clock::now();
+            for (const auto i : order)
+            {
+                syn.restore(*packet, i);
+                do_not_optimize(redirect.process_client_to_server_packet(*packet));
+            }
+            report(std::format("new connection (SYN), {} connections", size), size, clock::now() - start);
+
+            run(std::format("header restore only (baseline), {} connections", size), iterations, [&](const std::size_t i)
+            {
+                client_to_server.restore(*packet, order[i % size]);
+                do_not_optimize(packet->m_IBuffer[ETHER_HEADER_LENGTH]);
+            });
+
+            run(std::format("client to server, {} connections", size), iterations, [&](const std::size_t i)
+            {
+                client_to_server.restore(*packet, order[i % size]);
+                do_not_optimize(redirect.process_client_to_server_packet(*packet));
+            });
+
+            run(std::format("server to client, {} connections", size), iterations, [&](const std::size_t i)
+            {
+                server_to_client.restore(*packet, order[i % size]);
+                do_not_optimize(redirect.process_server_to_client_packet(*packet));
+            });
+        }
+    }
+
+    void process_lookup_benchmarks(const std::size_t iterations)
+    {
+        section("process_lookup (IPv4 TCP)");
+
+        for (const auto count : connection_counts)
+        {
+            const loopback_connections connections(count);
+            const auto flows = connections.flows();
+            const auto unknown = make_flows_v4(flows.size(), 13);
+            const auto order = shuffled_indices(flows.size());
+
+            iphelper::process_lookup<net::ip_address_v4> lookup;
+
+            run(std::format("actualize (TCP table refresh), {} connections", flows.size()), 50, [&](std::size_t)
+            {
+                do_not_optimize(lookup.actualize(true, false));
+            });
+
+            run(std::format("lookup_process_for_tcp hit, {} connections", flows.size()), iterations, [&](const std::size_t i)
+            {
+                const auto& flow = flows[order[i % flows.size()]];
+                do_not_optimize(lookup.lookup_process_for_tcp<false>(net::ip_session<net::ip_address_v4>{
+                    net::ip_address_v4{ flow.client }, net::ip_address_v4{ flow.server },
+                    ntohs(flow.client_port), ntohs(flow.server_port) }) != nullptr);
+            });
+
+            run(std::format("lookup_process_for_tcp miss, {} connections", flows.size()), iterations, [&](const std::size_t i)
+            {
+                const auto& flow = unknown[order[i % unknown.size()]];
+                do_not_optimize(lookup.lookup_process_for_tcp<false>(net::ip_session<net::ip_address_v4>{
+                    net::ip_address_v4{ flow.client }, net::ip_address_v4{ flow.server },
+                    ntohs(flow.client_port), ntohs(flow.server_port) }) != nullptr);
+            });
+        }
+    }
+
+    void inclusion_policy_benchmarks(const std::size_t iterations)
+    {
+        section("dest_inclusion_policy");
+
+        std::mt19937 generator{ 5 };
+
+        for (const auto prefixes : { std::size_t{ 0 }, std::size_t{ 64 }, std::size_t{ 10'000 }, std::size_t{ 200'000 } })
+        {
+            // IPv4 /24 and IPv6 /48 prefixes in equal numbers, as a GeoIP export of one country would be
+            std::string list;
+            std::vector<sockaddr_storage> destinations(4'096);
+
+            for (std::size_t i = 0; i < prefixes; ++i)
+            {
+                const auto value = generator();
+                if (i % 2 == 0)
+                    list += std::format("{}.{}.{}.0/24\n", 1 + (value >> 24) % 223, (value >> 16) & 0xff, (value >> 8) & 0xff);
+                else
+                    list += std::format("2a{:02x}:{:x}:{:x}::/48\n", value >> 24, (value >> 8) & 0xffff, generator() & 0xffff);
+            }
+
+            // Half of the destinations fall into a prefix if there are any
+            for (auto& destination : destinations)
+            {
+                const auto value = generator();
+                if (value & 1)
+                {
+                    auto& address = reinterpret_cast<sockaddr_in&>(destination);
+                    address.sin_family = AF_INET;
+                    address.sin_port = htons(443);
+                    address.sin_addr.s_addr = htonl(value);
+                }
+                else
+                {
+                    auto& address = reinterpret_cast<sockaddr_in6&>(destination);
+                    address.sin6_family = AF_INET6;
+                    address.sin6_port = htons(443);
+                    address.sin6_addr.u.Byte[0] = 0x2a;
+                    for (std::size_t b = 1; b < 16; ++b)
+                        address.sin6_addr.u.Byte[b] = static_cast<uint8_t>(generator());
+                }
+            }
+
+            const auto name = std::format(L"packet_path_benchmark_{}", prefixes);
+            int rejected = 0;
+
+            if (prefixes != 0 &&
+                dip_add_process_list(name.c_str(), list.data(), list.size(), &rejected) != static_cast<int>(prefixes))
+            {
+                std::cout << "dip_add_process_list failed, " << rejected << " prefixes rejected\n";
+                continue;
+            }
+
+            const auto key = dip_process_key(name.c_str());
+
+            const auto length = [](const sockaddr_storage& address)
+            {
+                return address.ss_family == AF_INET ? static_cast<int>(sizeof(sockaddr_in)) : static_cast<int>(sizeof(sockaddr_in6));
+            };
+
+            run(std::format("dip_should_redirect_for_key, {} prefixes", prefixes), iterations, [&](const std::size_t i)
+            {
+                const auto& destination = destinations[i % destinations.size()];
+                do_not_optimize(dip_should_redirect_for_key(key, reinterpret_cast<const sockaddr*>(&destination),
+                                                            length(destination)));
+            });
+
+            run(std::format("dip_should_redirect_for (by name), {} prefixes", prefixes), iterations / 10,
+                [&](const std::size_t i)
+            {
+                const auto& destination = destinations[i % destinations.size()];
+                do_not_optimize(dip_should_redirect_for(name.c_str(), reinterpret_cast<const sockaddr*>(&destination),
+                                                        length(destination)));
+            });
+        }
+    }
+
+    /// Returns the executable name of this process without the extension.
+    std::wstring process_name()
+    {
+        std::wstring path(MAX_PATH, L'\0');
+        path.resize(::GetModuleFileNameW(nullptr, path.data(), static_cast<DWORD>(path.size())));
+        return std::filesystem::path(path).stem().wstring();
+    }
+
+    void router_benchmarks(const std::size_t iterations)
+    {
+        section("socks_local_router::filter_packet (IPv4 TCP)");
+
+        // The flows are built from real connections of this process, so the router resolves their owner
+        const loopback_connections connections(connection_counts.back());
+        const auto flows = connections.flows();
+        const auto order = shuffled_indices(flows.size());
+
+        // Takes the owners of the connections above from the system tables
+        const auto router = std::make_unique<proxy::socks_local_router>(proxy::socks_local_router::replay_mode);
+
+        const header_templates syn(flows, tcp_v4_headers_length, [](auto& p, const auto& f)
+        {
+            build_tcp_v4(p, f, TH_SYN, 0);
+        });
+
+        const header_templates established(flows, tcp_v4_headers_length, [](auto& p, const auto& f)
+        {
+            build_tcp_v4(p, f, TH_ACK | TH_PSH, 1'460);
+        });
+
+        // The router may take a deferred packet out of its buffer, which must come from the pool
+        auto packet = ndisapi::intermediate_buffer_pool::instance().allocate();
+        if (!packet)
+            throw std::runtime_error("failed to allocate a packet buffer");
+
+        const auto each_syn = [&](const std::string_view name)
+        {
+            const auto start = clock::now();
+            for (const auto i : order)
+            {
+                syn.restore(*packet, i);
+                do_not_optimize(router->filter_packet(*packet).action);
+            }
+            report(name, order.size(), clock::now() - start);
+        };
+
+        const auto established_flows = [&](const std::string_view name)
+        {
+            run(name, iterations, [&](const std::size_t i)
+            {
+                established.restore(*packet, order[i % order.size()]);
+                do_not_optimize(router->filter_packet(*packet).action);
+            });
+        };
+
+        each_syn(std::format("new flow (SYN), not proxied, {} flows", flows.size()));
+        established_flows(std::format("established flow, not proxied, {} flows", flows.size()));
+
+        // The proxy is never contacted, only its local listening port is needed for the redirect
+        const auto proxy_id = router->add_socks5_proxy("127.0.0.1:1080", proxy::socks_local_router::tcp, std::nullopt, true);
+
+        if (!proxy_id || !router->associate_process_name_to_proxy(process_name(), proxy_id.value()))
+        {
+            std::cout << "skipped the redirect benchmarks: failed to add the proxy\n";
+            return;
+        }
+
+        router->invalidate_flow_cache();
+
+        each_syn(std::format("new flow (SYN), redirected, {} flows", flows.size()));
+        established_flows(std::format("established flow, redirected, {} flows", flows.size()));
+
+        // Destination policy decider wired the way socksify does it, consulted on new flows
+        router->set_redirect_decider(
+            [](const std::wstring& process) -> uint32_t
+            {
+                return static_cast<uint32_t>(dip_process_key(process.c_str()));
+            },
+            [](const uint32_t key, const sockaddr* address, const int length) -> bool
+            {
+                return dip_should_redirect_for_key(static_cast<int>(key), address, length) == 1;
+            });
+
+        established_flows(std::format("established flow, redirected with decider, {} flows", flows.size()));
+    }
+}
+
+int main(const int argc, char* argv[])
+{
+    const std::size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2'000'000;
+
+    try
+    {
+        const winsock sockets;
+
+        std::cout << "iterations: " << iterations << ", checksum kernel: "
+            << static_cast<int>(net::ip_checksum::active_kernel()) << '\n';
+
+        checksum_benchmarks(iterations);
+        packet_pool_benchmarks(iterations);
+        tcp_redirect_benchmarks(iterations);
+        process_lookup_benchmarks(iterations);
+        inclusion_policy_benchmarks(iterations);
+        router_benchmarks(iterations);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "error: " << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
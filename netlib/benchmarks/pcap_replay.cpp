@@ -0,0 +1,605 @@
+// --------------------------------------------------------------------------------
+/// <summary>
+/// Module Name:  pcap_replay.cpp
+/// Abstract: Replays a capture through socks_local_router::filter_packet without the driver
+/// and reports the per-packet latency and the packet rate
+/// </summary>
+/// Build (x64 Native Tools Command Prompt, from this directory, after building the solution):
+///   cl /O2 /Zi /std:c++20 /EHsc /D_CRT_RAND_S /D_ENABLE_EXTENDED_ALIGNED_STORAGE
+///      /I%VCPKG_ROOT%\installed\x64-windows\include pcap_replay.cpp
+///      ..\..\bin\lib\x64\Release\ndisapi.lib
+/// Usage:
+///   pcap_replay capture [--proxy ip:port] [--owners file] [--owner process] [--proxied process]...
+///               [--local address]... [--repeat count] [--pause]
+///   --proxy     SOCKS5 proxy the owned flows are redirected to. Only its local proxy servers
+///               are started, it is never contacted.
+///   --owners    Process table: one "protocol local-address local-port remote-address
+///               remote-port process" rule per line, * matches anything, ports may be ranges
+///               (low-high), # starts a comment. The first matching rule owns a flow.
+///   --owner     Owner of the outbound flows no rule matches, by default they belong to SYSTEM.
+///   --proxied   Owners associated with the proxy, all named owners by default.
+///   --local     Local address, decides the direction of frames in libpcap captures. Without
+///               it the sources of connection attempts (SYN without ACK) are taken as local.
+///   --repeat    Number of passes over the capture, state carries over between passes.
+///   --pause     Waits for Enter before replaying, to attach a profiler or start an ETW session.
+/// The capture is read from a file written by the pcap log of the router (libpcap) or by
+/// pcap_async_writer (pcapng, which also records the direction of each frame). The owner of
+/// every outbound TCP session and UDP endpoint is set with socks_local_router::
+/// set_static_process_table(), so no packet waits for a process table refresh.
+// --------------------------------------------------------------------------------
+
+#include "benchmark.h"
+
+namespace
+{
+    using namespace benchmark;
+    using action_type = ndisapi::queued_multi_interface_packet_filter::packet_action::action_type;
+
+    /// Command line options.
+    struct options
+    {
+        std::string capture;
+        std::optional<std::string> proxy;
+        std::optional<std::string> owners;
+        std::optional<std::string> owner;
+        std::vector<std::string> proxied;
+        std::vector<std::string> local;
+        std::size_t repeat{ 1 };
+        bool pause{ false };
+    };
+
+    /// Inclusive port range.
+    using port_range = std::pair<uint16_t, uint16_t>;
+
+    /// A line of the process table.
+    struct owner_rule
+    {
+        std::optional<uint8_t> protocol;
+        std::optional<std::string> local_address;
+        port_range local_port{ 0, 65535 };
+        std::optional<std::string> remote_address;
+        port_range remote_port{ 0, 65535 };
+        std::string process;
+    };
+
+    /// A frame of the capture.
+    struct frame
+    {
+        std::vector<char> data;
+        pcap::pcap_file_reader::packet_direction direction;
+    };
+
+    /// Addresses and ports of a TCP or UDP frame, ports in host byte order.
+    template <net::ip_address T>
+    struct flow
+    {
+        T source;
+        T destination;
+        uint16_t source_port;
+        uint16_t destination_port;
+        uint8_t protocol;
+    };
+
+    /// Returns the TCP/UDP header of an IPv4 or IPv6 frame and its protocol, nullptr for other frames.
+    std::pair<const uint8_t*, uint8_t> transport_header(const frame& f)
+    {
+        if (f.data.size() < ETHER_HEADER_LENGTH + sizeof(iphdr))
+            return { nullptr, 0 };
+
+        const auto* const ethernet_header = reinterpret_cast<const ether_header*>(f.data.data());
+        const auto* const ip = reinterpret_cast<const uint8_t*>(f.data.data()) + ETHER_HEADER_LENGTH;
+        const auto ip_length = static_cast<unsigned>(f.data.size() - ETHER_HEADER_LENGTH);
+
+        const uint8_t* header = nullptr;
+        uint8_t protocol = 0;
+
+        switch (ntohs(ethernet_header->h_proto))
+        {
+        case ETH_P_IP:
+        {
+            const auto* const ip_header = reinterpret_cast<const iphdr*>(ip);
+            header = ip + sizeof(DWORD) * ip_header->ip_hl;
+            protocol = ip_header->ip_p;
+            break;
+        }
+        case ETH_P_IPV6:
+        {
+            if (ip_length < sizeof(ipv6hdr))
+                return { nullptr, 0 };
+
+            const auto [payload, next] = net::ipv6_helper::find_transport_header(
+                reinterpret_cast<const ipv6hdr*>(ip), ip_length);
+            header = static_cast<const uint8_t*>(payload);
+            protocol = next;
+            break;
+        }
+        default:
+            return { nullptr, 0 };
+        }
+
+        const auto end = reinterpret_cast<const uint8_t*>(f.data.data()) + f.data.size();
+
+        if (header == nullptr || (protocol != IPPROTO_TCP && protocol != IPPROTO_UDP) ||
+            header + (protocol == IPPROTO_TCP ? sizeof(tcphdr) : sizeof(udphdr)) > end)
+            return { nullptr, 0 };
+
+        return { header, protocol };
+    }
+
+    /// Returns true if a frame carries IPv6.
+    bool is_ipv6(const frame& f)
+    {
+        return ntohs(reinterpret_cast<const ether_header*>(f.data.data())->h_proto) == ETH_P_IPV6;
+    }
+
+    /// Parses the flow of a TCP or UDP frame of the given address family.
+    template <net::ip_address T>
+    std::optional<flow<T>> parse_flow(const frame& f)
+    {
+        const auto [header, protocol] = transport_header(f);
+        if (header == nullptr || is_ipv6(f) != std::is_same_v<T, net::ip_address_v6>)
+            return std::nullopt;
+
+        const auto* const ip = f.data.data() + ETHER_HEADER_LENGTH;
+        const auto* const ports = reinterpret_cast<const uint16_t*>(header);
+
+        if constexpr (std::is_same_v<T, net::ip_address_v4>)
+        {
+            const auto* const ip_header = reinterpret_cast<const iphdr*>(ip);
+            return flow<T>{ ip_header->ip_src, ip_header->ip_dst, ntohs(ports[0]), ntohs(ports[1]), protocol };
+        }
+        else
+        {
+            const auto* const ip_header = reinterpret_cast<const ipv6hdr*>(ip);
+            return flow<T>{ ip_header->ip6_src, ip_header->ip6_dst, ntohs(ports[0]), ntohs(ports[1]), protocol };
+        }
+    }
+
+    /// Returns the source address of a TCP or UDP frame if it opens a connection (SYN without ACK).
+    std::optional<std::string> connection_initiator(const frame& f)
+    {
+        const auto [header, protocol] = transport_header(f);
+        if (header == nullptr || protocol != IPPROTO_TCP)
+            return std::nullopt;
+
+        if (const auto flags = reinterpret_cast<const tcphdr*>(header)->th_flags; (flags & (TH_SYN | TH_ACK)) != TH_SYN)
+            return std::nullopt;
+
+        if (is_ipv6(f))
+            return std::string(parse_flow<net::ip_address_v6>(f)->source);
+
+        return std::string(parse_flow<net::ip_address_v4>(f)->source);
+    }
+
+    /// Returns the source and destination addresses of a TCP or UDP frame.
+    std::optional<std::pair<std::string, std::string>> frame_addresses(const frame& f)
+    {
+        const auto addresses = [](const auto& parsed) -> std::optional<std::pair<std::string, std::string>>
+        {
+            if (!parsed)
+                return std::nullopt;
+            return std::make_pair(std::string(parsed->source), std::string(parsed->destination));
+        };
+
+        return is_ipv6(f) ? addresses(parse_flow<net::ip_address_v6>(f)) : addresses(parse_flow<net::ip_address_v4>(f));
+    }
+
+    /// Parses a port rule field: *, a port or a low-high range.
+    std::optional<port_range> parse_port_range(const std::string& field)
+    {
+        if (field == "*")
+            return port_range{ 0, 65535 };
+
+        const auto dash = field.find('-');
+        const auto low = std::strtoul(field.substr(0, dash).c_str(), nullptr, 10);
+        const auto high = dash == std::string::npos ? low : std::strtoul(field.substr(dash + 1).c_str(), nullptr, 10);
+
+        if (low > high || high > 65535)
+            return std::nullopt;
+
+        return port_range{ static_cast<uint16_t>(low), static_cast<uint16_t>(high) };
+    }
+
+    /// Loads the process table.
+    std::vector<owner_rule> load_owner_rules(const std::string& path)
+    {
+        std::ifstream file(path);
+        if (!file)
+            throw std::runtime_error("cannot open the process table " + path);
+
+        std::vector<owner_rule> rules;
+        std::string line;
+
+        for (std::size_t number = 1; std::getline(file, line); ++number)
+        {
+            line = line.substr(0, line.find('#'));
+
+            std::istringstream fields(line);
+            std::string protocol, local_address, local_port, remote_address, remote_port, process;
+
+            if (!(fields >> protocol))
+                continue;
+
+            if (!(fields >> local_address >> local_port >> remote_address >> remote_port) || !std::getline(fields >> std::ws, process))
+                throw std::runtime_error(std::format("{}:{}: expected six fields", path, number));
+
+            owner_rule rule;
+
+            if (protocol == "tcp")
+                rule.protocol = IPPROTO_TCP;
+            else if (protocol == "udp")
+                rule.protocol = IPPROTO_UDP;
+            else if (protocol != "*")
+                throw std::runtime_error(std::format("{}:{}: unknown protocol {}", path, number, protocol));
+
+            const auto local_ports = parse_port_range(local_port);
+            const auto remote_ports = parse_port_range(remote_port);
+
+            if (!local_ports || !remote_ports)
+                throw std::runtime_error(std::format("{}:{}: invalid port", path, number));
+
+            if (local_address != "*")
+                rule.local_address = local_address;
+            if (remote_address != "*")
+                rule.remote_address = remote_address;
+
+            rule.local_port = local_ports.value();
+            rule.remote_port = remote_ports.value();
+            rule.process = process;
+
+            rules.push_back(std::move(rule));
+        }
+
+        return rules;
+    }
+
+    /**
+     * @class process_table
+     * @brief Owners of the outbound flows of the capture, built from the rules.
+     */
+    class process_table
+    {
+    public:
+        process_table(std::vector<owner_rule> rules, std::optional<std::string> fallback)
+            : rules_(std::move(rules)), fallback_(std::move(fallback))
+        {
+        }
+
+        /// Records the owner of the flow of an outbound frame.
+        template <net::ip_address T>
+        void add(const flow<T>& f)
+        {
+            const auto tcp = f.protocol == IPPROTO_TCP;
+
+            // The rules are evaluated once per session or endpoint
+            if (!(tcp ? per_family<T>(tcp_seen_v4_, tcp_seen_v6_) : per_family<T>(udp_seen_v4_, udp_seen_v6_))
+                .insert(flow_key(f, tcp)).second)
+                return;
+
+            const auto owner = owner_of(f);
+            if (!owner)
+                return;
+
+            if (tcp)
+                per_family<T>(tcp_v4_, tcp_v6_).emplace_back(
+                    net::ip_session<T>{ f.source, f.destination, f.source_port, f.destination_port }, owner);
+            else
+                per_family<T>(udp_v4_, udp_v6_).emplace_back(net::ip_endpoint<T>{ f.source, f.source_port }, owner);
+        }
+
+        /// Installs the table into the router.
+        void install(proxy::socks_local_router& router) const
+        {
+            router.set_static_process_table<net::ip_address_v4>(tcp_v4_, udp_v4_);
+            router.set_static_process_table<net::ip_address_v6>(tcp_v6_, udp_v6_);
+        }
+
+        /// Returns the names of the owners that own at least one flow.
+        [[nodiscard]] std::vector<std::string> owner_names() const
+        {
+            std::vector<std::string> names;
+            for (const auto& [name, process] : processes_)
+                names.push_back(name);
+            return names;
+        }
+
+        /// Returns the number of TCP sessions and UDP endpoints with an owner.
+        [[nodiscard]] std::pair<std::size_t, std::size_t> size() const
+        {
+            return { tcp_v4_.size() + tcp_v6_.size(), udp_v4_.size() + udp_v6_.size() };
+        }
+
+    private:
+        template <net::ip_address T, typename V4, typename V6>
+        static auto& per_family(V4& v4, V6& v6)
+        {
+            if constexpr (std::is_same_v<T, net::ip_address_v4>)
+                return v4;
+            else
+                return v6;
+        }
+
+        template <net::ip_address T>
+        static std::string flow_key(const flow<T>& f, const bool remote)
+        {
+            return remote
+                ? std::format("{}:{}>{}:{}", std::string(f.source), f.source_port, std::string(f.destination), f.destination_port)
+                : std::format("{}:{}", std::string(f.source), f.source_port);
+        }
+
+        static bool in_range(const port_range& range, const uint16_t port)
+        {
+            return port >= range.first && port <= range.second;
+        }
+
+        template <net::ip_address T>
+        std::shared_ptr<iphelper::network_process> owner_of(const flow<T>& f)
+        {
+            const auto local = std::string(f.source);
+            const auto remote = std::string(f.destination);
+
+            const auto rule = std::ranges::find_if(rules_, [&](const owner_rule& r)
+            {
+                return (!r.protocol || r.protocol == f.protocol) &&
+                    (!r.local_address || r.local_address == local) && in_range(r.local_port, f.source_port) &&
+                    (!r.remote_address || r.remote_address == remote) && in_range(r.remote_port, f.destination_port);
+            });
+
+            if (rule != rules_.end())
+                return process(rule->process);
+
+            return fallback_ ? process(fallback_.value()) : nullptr;
+        }
+
+        std::shared_ptr<iphelper::network_process> process(const std::string& name)
+        {
+            auto& process = processes_[name];
+
+            // Cached decisions are only kept for owners with a process ID
+            if (!process)
+            {
+                const auto wide_name = tools::strings::to_wstring(name);
+                process = std::make_shared<iphelper::network_process>(
+                    static_cast<unsigned long>(1000 + processes_.size()), wide_name, wide_name);
+            }
+
+            return process;
+        }
+
+        std::vector<owner_rule> rules_;
+        std::optional<std::string> fallback_;
+        std::map<std::string, std::shared_ptr<iphelper::network_process>> processes_;
+
+        std::unordered_set<std::string> tcp_seen_v4_, tcp_seen_v6_, udp_seen_v4_, udp_seen_v6_;
+        std::vector<std::pair<net::ip_session<net::ip_address_v4>, std::shared_ptr<iphelper::network_process>>> tcp_v4_;
+        std::vector<std::pair<net::ip_session<net::ip_address_v6>, std::shared_ptr<iphelper::network_process>>> tcp_v6_;
+        std::vector<std::pair<net::ip_endpoint<net::ip_address_v4>, std::shared_ptr<iphelper::network_process>>> udp_v4_;
+        std::vector<std::pair<net::ip_endpoint<net::ip_address_v6>, std::shared_ptr<iphelper::network_process>>> udp_v6_;
+    };
+
+    options parse_options(const int argc, char* argv[])
+    {
+        options result;
+
+        for (auto i = 1; i < argc; ++i)
+        {
+            const std::string_view argument{ argv[i] };
+            const auto value = [&]() -> std::string
+            {
+                if (i + 1 >= argc)
+                    throw std::runtime_error(std::format("{} needs a value", argument));
+                return argv[++i];
+            };
+
+            if (argument == "--proxy")
+                result.proxy = value();
+            else if (argument == "--owners")
+                result.owners = value();
+            else if (argument == "--owner")
+                result.owner = value();
+            else if (argument == "--proxied")
+                result.proxied.push_back(value());
+            else if (argument == "--local")
+                result.local.push_back(value());
+            else if (argument == "--repeat")
+                result.repeat = std::max<std::size_t>(1, std::strtoull(value().c_str(), nullptr, 10));
+            else if (argument == "--pause")
+                result.pause = true;
+            else if (result.capture.empty() && !argument.starts_with("--"))
+                result.capture = argument;
+            else
+                throw std::runtime_error(std::format("unknown argument {}", argument));
+        }
+
+        if (result.capture.empty())
+            throw std::runtime_error("usage: pcap_replay capture [--proxy ip:port] [--owners file] [--owner process] "
+                                     "[--proxied process]... [--local address]... [--repeat count] [--pause]");
+
+        return result;
+    }
+
+    /// Loads the frames of the capture that fit an intermediate buffer.
+    std::vector<frame> load_capture(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            throw std::runtime_error("cannot open " + path);
+
+        pcap::pcap_file_reader reader(file);
+        pcap::pcap_file_reader::packet packet;
+
+        std::vector<frame> frames;
+        std::size_t oversized = 0;
+
+        while (reader.read(packet))
+        {
+            // Large send offload frames exceed what the driver hands to the router
+            if (packet.data.size() > MAX_ETHER_FRAME || packet.data.size() < ETHER_HEADER_LENGTH)
+            {
+                ++oversized;
+                continue;
+            }
+
+            frames.push_back({ packet.data, packet.direction });
+        }
+
+        std::cout << "capture: " << path << (reader.is_pcapng() ? " (pcapng)" : " (libpcap)") << ", "
+            << frames.size() << " frames";
+        if (oversized != 0)
+            std::cout << ", " << oversized << " frames skipped (larger than " << MAX_ETHER_FRAME << " octets)";
+        std::cout << '\n';
+
+        return frames;
+    }
+
+    /// Sets the direction of the frames that do not record it from the local addresses.
+    void assign_directions(std::vector<frame>& frames, const std::vector<std::string>& local_addresses)
+    {
+        std::unordered_set<std::string> local(local_addresses.begin(), local_addresses.end());
+
+        if (local.empty())
+        {
+            for (const auto& f : frames)
+            {
+                if (f.direction == pcap::pcap_file_reader::packet_direction::unknown)
+                {
+                    if (const auto initiator = connection_initiator(f))
+                        local.insert(initiator.value());
+                }
+            }
+        }
+
+        std::size_t unknown = 0;
+
+        for (auto& f : frames)
+        {
+            if (f.direction != pcap::pcap_file_reader::packet_direction::unknown)
+                continue;
+
+            const auto addresses = frame_addresses(f);
+
+            if (addresses && local.contains(addresses->first))
+                f.direction = pcap::pcap_file_reader::packet_direction::outbound;
+            else if (addresses && local.contains(addresses->second))
+                f.direction = pcap::pcap_file_reader::packet_direction::inbound;
+            else
+                ++unknown;
+        }
+
+        if (unknown != 0)
+            std::cout << unknown << " frames of unknown direction are replayed as inbound\n";
+    }
+
+    /// Prints the count and share of an action.
+    void report_action(const std::string_view name, const std::size_t count, const std::size_t total)
+    {
+        std::cout << std::left << std::setw(12) << name << std::right << std::setw(12) << count
+            << std::fixed << std::setprecision(1) << std::setw(8) << 100.0 * static_cast<double>(count) / static_cast<double>(total)
+            << " %\n";
+    }
+
+    int replay(const options& opts)
+    {
+        auto frames = load_capture(opts.capture);
+        if (frames.empty())
+            return 0;
+
+        assign_directions(frames, opts.local);
+
+        process_table table(opts.owners ? load_owner_rules(opts.owners.value()) : std::vector<owner_rule>{}, opts.owner);
+
+        for (const auto& f : frames)
+        {
+            if (f.direction != pcap::pcap_file_reader::packet_direction::outbound)
+                continue;
+
+            if (const auto v4 = parse_flow<net::ip_address_v4>(f))
+                table.add(v4.value());
+            else if (const auto v6 = parse_flow<net::ip_address_v6>(f))
+                table.add(v6.value());
+        }
+
+        const auto [tcp_sessions, udp_endpoints] = table.size();
+        std::cout << "process table: " << tcp_sessions << " TCP sessions, " << udp_endpoints << " UDP endpoints owned\n";
+
+        proxy::socks_local_router router(proxy::socks_local_router::replay_mode);
+        table.install(router);
+
+        if (opts.proxy)
+        {
+            const auto proxy_id = router.add_socks5_proxy(opts.proxy.value(), proxy::socks_local_router::both, std::nullopt, true);
+            if (!proxy_id)
+                throw std::runtime_error("failed to add the proxy " + opts.proxy.value());
+
+            for (const auto& name : opts.proxied.empty() ? table.owner_names() : opts.proxied)
+            {
+                if (!router.associate_process_name_to_proxy(tools::strings::to_wstring(name), proxy_id.value()))
+                    throw std::runtime_error("failed to associate " + name + " with the proxy");
+            }
+        }
+
+        if (opts.pause)
+        {
+            std::cout << "process " << ::GetCurrentProcessId() << ", press Enter to replay" << std::endl;
+            std::cin.get();
+        }
+
+        // The router may take a deferred packet out of its buffer, which must come from the pool
+        auto buffer = ndisapi::intermediate_buffer_pool::instance().allocate();
+        if (!buffer)
+            throw std::runtime_error("failed to allocate a packet buffer");
+
+        latency_samples latencies(frames.size() * opts.repeat);
+        std::array<std::size_t, 3> actions{};
+
+        for (std::size_t pass = 0; pass < opts.repeat; ++pass)
+        {
+            auto busy = clock::duration{};
+
+            for (const auto& f : frames)
+            {
+                // Redirected frames are rewritten in place, each pass starts from the captured ones
+                std::memcpy(buffer->m_IBuffer, f.data.data(), f.data.size());
+                buffer->m_Length = static_cast<DWORD>(f.data.size());
+                buffer->m_dwDeviceFlags = f.direction == pcap::pcap_file_reader::packet_direction::outbound
+                                              ? PACKET_FLAG_ON_SEND
+                                              : PACKET_FLAG_ON_RECEIVE;
+
+                const auto start = clock::now();
+                const auto action = router.filter_packet(*buffer).action;
+                const auto elapsed = clock::now() - start;
+
+                busy += elapsed;
+                latencies.add(elapsed);
+                ++actions[static_cast<std::size_t>(action)];
+            }
+
+            report(std::format("pass {}: filter_packet", pass + 1), frames.size(), busy);
+        }
+
+        section("Per-packet latency");
+        latencies.report("filter_packet");
+
+        section("Actions");
+        const auto total = frames.size() * opts.repeat;
+        report_action("pass", actions[static_cast<std::size_t>(action_type::pass)], total);
+        report_action("drop", actions[static_cast<std::size_t>(action_type::drop)], total);
+        report_action("revert", actions[static_cast<std::size_t>(action_type::revert)], total);
+
+        return 0;
+    }
+}
+
+int main(const int argc, char* argv[])
+{
+    try
+    {
+        const winsock sockets;
+        return replay(parse_options(argc, argv));
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "error: " << e.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,288 @@
+#pragma once
+
+namespace iphelper
+{
+    /**
+     * @brief Coalesces IP interface change notifications into batches handled on a worker thread.
+     *
+     * NotifyIpInterfaceChange reports every parameter change of every interface, and VPN clients
+     * or Wi-Fi roaming produce bursts of dozens of notifications per second. The callback only
+     * records the LUID of the changed interface here; once notifications have stopped arriving for
+     * the quiet period (or max_delay after the first one of a burst at the latest), the handler is
+     * called once with the distinct interfaces that changed.
+     *
+     * A notification without an interface (the initial notification), or more distinct interfaces
+     * than max_interfaces in one batch, turn the batch into a full one: the handler should then
+     * re-read the whole configuration.
+     *
+     * post() may be called from any thread and never blocks for long; the handler is called on the
+     * worker thread only, never concurrently with itself.
+     */
+    class interface_change_queue
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        /**
+         * @brief Coalescing settings.
+         */
+        struct options
+        {
+            std::chrono::milliseconds quiet_period{ 250 };  ///< Time without notifications that ends a batch.
+            std::chrono::milliseconds max_delay{ 2000 };    ///< Longest delay of the first notification of a batch.
+            std::size_t max_interfaces{ 32 };               ///< Largest number of interfaces of a targeted batch.
+        };
+
+        /**
+         * @brief Changes collected since the previous batch.
+         */
+        struct batch
+        {
+            std::vector<uint64_t> interfaces;   ///< LUIDs (NET_LUID::Value) of the changed interfaces.
+            bool full{ false };                 ///< The whole configuration must be re-read, interfaces is empty.
+        };
+
+        /**
+         * @brief Counters of the queue.
+         */
+        struct statistics
+        {
+            uint64_t notifications;     ///< Notifications posted.
+            uint64_t batches;           ///< Batches handed to the handler.
+            uint64_t full_batches;      ///< Batches requiring a full re-read, included in batches.
+        };
+
+        using handler = std::function<void(const batch&)>;
+
+        /**
+         * @brief Constructs a stopped queue.
+         *
+         * @param settings Coalescing settings.
+         */
+        explicit interface_change_queue(const options& settings)
+            : options_(settings)
+        {
+        }
+
+        interface_change_queue(const interface_change_queue&) = delete;
+        interface_change_queue& operator=(const interface_change_queue&) = delete;
+        interface_change_queue(interface_change_queue&&) = delete;
+        interface_change_queue& operator=(interface_change_queue&&) = delete;
+
+        /**
+         * @brief Stops the worker thread.
+         */
+        ~interface_change_queue()
+        {
+            stop();
+        }
+
+        /**
+         * @brief Starts the worker thread calling the handler. No-op if running.
+         *
+         * Notifications posted while the queue was stopped are discarded.
+         *
+         * @param on_batch Called with every batch.
+         * @throws std::system_error if the thread cannot be created.
+         */
+        void start(handler on_batch)
+        {
+            std::scoped_lock lock(lock_);
+
+            if (worker_.joinable())
+                return;
+
+            handler_ = std::move(on_batch);
+            pending_ = {};
+            has_pending_ = false;
+            stop_ = false;
+            worker_ = std::thread(&interface_change_queue::worker_thread, this);
+        }
+
+        /**
+         * @brief Stops the worker thread, discarding the pending changes. Waits for a running handler.
+         */
+        void stop()
+        {
+            {
+                std::scoped_lock lock(lock_);
+                stop_ = true;
+            }
+
+            signal_.notify_all();
+
+            if (worker_.joinable())
+                worker_.join();
+
+            std::scoped_lock lock(lock_);
+            handler_ = nullptr;
+        }
+
+        /**
+         * @brief Records an interface change.
+         *
+         * @param row The changed interface, nullptr if unknown (forces a full batch).
+         */
+        void post(const MIB_IPINTERFACE_ROW* row) noexcept
+        {
+            const auto now = clock::now();
+
+            {
+                std::scoped_lock lock(lock_);
+
+                if (stop_)
+                    return;
+
+                ++notifications_;
+
+                if (!has_pending_)
+                {
+                    has_pending_ = true;
+                    first_posted_ = now;
+                }
+
+                last_posted_ = now;
+
+                if (!pending_.full)
+                {
+                    if (row == nullptr)
+                    {
+                        make_full();
+                    }
+                    else if (std::ranges::find(pending_.interfaces, row->InterfaceLuid.Value) == pending_.interfaces.end())
+                    {
+                        if (pending_.interfaces.size() >= options_.max_interfaces)
+                        {
+                            make_full();
+                        }
+                        else
+                        {
+                            try
+                            {
+                                pending_.interfaces.push_back(row->InterfaceLuid.Value);
+                            }
+                            catch (const std::bad_alloc&)
+                            {
+                                make_full();
+                            }
+                        }
+                    }
+                }
+            }
+
+            signal_.notify_one();
+        }
+
+        /**
+         * @brief Returns a snapshot of the queue counters.
+         */
+        [[nodiscard]] statistics get_statistics() const
+        {
+            std::scoped_lock lock(lock_);
+            return { notifications_, batches_, full_batches_ };
+        }
+
+    private:
+        /**
+         * @brief Turns the pending batch into a full one. Called under lock_.
+         */
+        void make_full() noexcept
+        {
+            pending_.full = true;
+            pending_.interfaces.clear();
+        }
+
+        /**
+         * @brief Waits for the end of each burst and hands its changes to the handler.
+         */
+        void worker_thread()
+        {
+            std::unique_lock lock(lock_);
+
+            while (!stop_)
+            {
+                if (!has_pending_)
+                {
+                    signal_.wait(lock);
+                    continue;
+                }
+
+                // Each notification extends the burst, up to max_delay after its first one
+                const auto due = std::min(last_posted_ + options_.quiet_period, first_posted_ + options_.max_delay);
+
+                if (clock::now() < due)
+                {
+                    signal_.wait_until(lock, due);
+                    continue;
+                }
+
+                auto changes = std::move(pending_);
+                pending_ = {};
+                has_pending_ = false;
+
+                ++batches_;
+                if (changes.full)
+                    ++full_batches_;
+
+                lock.unlock();
+
+                handler_(changes);
+
+                lock.lock();
+            }
+        }
+
+        /**
+         * @brief Coalescing settings.
+         */
+        options options_;
+
+        /**
+         * @brief Protects every member below.
+         */
+        mutable std::mutex lock_;
+
+        /**
+         * @brief Wakes the worker when a change is posted or the queue is stopped.
+         */
+        std::condition_variable signal_;
+
+        /**
+         * @brief Changes collected since the previous batch.
+         */
+        batch pending_;
+
+        /**
+         * @brief True if pending_ holds at least one change.
+         */
+        bool has_pending_{ false };
+
+        /**
+         * @brief Times of the first and the latest notification of the pending batch.
+         */
+        clock::time_point first_posted_;
+        clock::time_point last_posted_;
+
+        /**
+         * @brief Receives the batches, set while running.
+         */
+        handler handler_;
+
+        /**
+         * @brief True when the worker must exit and post() must discard the notifications.
+         */
+        bool stop_{ true };
+
+        /**
+         * @brief Worker thread calling the handler.
+         */
+        std::thread worker_;
+
+        /**
+         * @brief Queue counters.
+         */
+        uint64_t notifications_{ 0 };
+        uint64_t batches_{ 0 };
+        uint64_t full_batches_{ 0 };
+    };
+}
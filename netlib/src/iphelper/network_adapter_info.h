@@ -1617,6 +1617,53 @@ namespace iphelper
             return {};
         }
 
+        /// <summary>
+        /// Checks if the network interface with provided LUID would be returned by
+        /// get_external_network_connections, without enumerating the other interfaces
+        /// </summary>
+        /// <param name="luid">LUID to lookup</param>
+        /// <returns>true if the interface is operational, not software loopback and has
+        /// at least one unicast address assigned</returns>
+        static bool is_external_network_connection(const IF_LUID& luid)
+        {
+            SetLastError(ERROR_SUCCESS);
+
+            MIB_IF_ROW2 if_row{};
+            if_row.InterfaceLuid = luid;
+
+            if (const auto error_code = GetIfEntry2(&if_row); NO_ERROR != error_code)
+            {
+                SetLastError(error_code);
+                return false;
+            }
+
+            if ((if_row.OperStatus != IfOperStatusUp) || (if_row.Type == IF_TYPE_SOFTWARE_LOOPBACK))
+                return false;
+
+            PMIB_UNICASTIPADDRESS_TABLE address_table = nullptr;
+
+            if (const auto error_code = GetUnicastIpAddressTable(AF_UNSPEC, &address_table); NO_ERROR != error_code)
+            {
+                SetLastError(error_code);
+                return false;
+            }
+
+            auto result = false;
+
+            for (size_t i = 0; i < address_table->NumEntries; ++i)
+            {
+                if (address_table->Table[i].InterfaceLuid == luid)
+                {
+                    result = true;
+                    break;
+                }
+            }
+
+            FreeMibTable(address_table);
+
+            return result;
+        }
+
         /// <summary>
         /// Finds network interface by provided hardware address
         /// </summary>
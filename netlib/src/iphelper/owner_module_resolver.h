@@ -249,6 +249,29 @@ namespace iphelper {
             return { valid, total };
         }
 
+        /**
+         * @brief Obtains unique process identity (PID + creation time).
+         *
+         * @param pid Process ID
+         * @param identity [out] Process identity structure to fill
+         * @return true if process identity was successfully obtained
+         *
+         * @note Uses PROCESS_QUERY_LIMITED_INFORMATION access level
+         */
+        static bool get_process_identity(const DWORD pid, process_identity& identity) {
+            identity.pid = pid;
+
+            const HANDLE process_handle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+            if (!process_handle) return false;
+
+            FILETIME creation_time{}, exit_time{}, kernel_time{}, user_time{};
+            const BOOL ok = GetProcessTimes(process_handle, &creation_time, &exit_time, &kernel_time, &user_time);
+            if (ok) identity.creation_time = creation_time;
+
+            CloseHandle(process_handle);
+            return ok != 0;
+        }
+
         /**
          * @brief Checks if a PID represents a system process.
          * @param pid Process ID to check
@@ -407,29 +430,6 @@ namespace iphelper {
             }
         }
 
-        /**
-         * @brief Obtains unique process identity (PID + creation time).
-         *
-         * @param pid Process ID
-         * @param identity [out] Process identity structure to fill
-         * @return true if process identity was successfully obtained
-         *
-         * @note Uses PROCESS_QUERY_LIMITED_INFORMATION access level
-         */
-        static bool get_process_identity(const DWORD pid, process_identity& identity) {
-            identity.pid = pid;
-
-            const HANDLE process_handle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
-            if (!process_handle) return false;
-
-            FILETIME creation_time{}, exit_time{}, kernel_time{}, user_time{};
-            const BOOL ok = GetProcessTimes(process_handle, &creation_time, &exit_time, &kernel_time, &user_time);
-            if (ok) identity.creation_time = creation_time;
-
-            CloseHandle(process_handle);
-            return ok != 0;
-        }
-
         /**
          * @brief Uncached resolution that bypasses the cache system.
          *
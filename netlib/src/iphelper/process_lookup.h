@@ -114,9 +114,9 @@ namespace iphelper
         std::wstring device_path_name;      ///< Device path version of path_name (uppercase)
         std::optional<uint16_t> tcp_proxy_port = std::nullopt; // Optional TCP proxy port if the process is associated with a proxy
         std::optional<uint16_t> udp_proxy_port = std::nullopt; // Optional UDP proxy port if the process is associated with a proxy
-        bool excluded = false;          ///< Whether the process is excluded from proxying
-        bool bypass_tcp = false;        ///< Whether TCP connections should bypass proxying (no proxy configured)
-        bool bypass_udp = false;        ///< Whether UDP connections should bypass proxying (no proxy configured)
+        std::atomic<uint64_t> proxy_match{ 0 }; ///< Memoized proxy association (matcher generation << 32 | result), maintained by the router
+        std::atomic<uint64_t> redirected_flows{ 0 }; ///< Flows redirected since the last flow summary (UDP << 32 | TCP), maintained by the router
+        std::atomic<uint64_t> redirect_key{ 0 }; ///< Memoized redirect decider key (decider generation << 32 | key), maintained by the router
     };
 
     /**
@@ -150,33 +150,117 @@ namespace iphelper
         /// Initial buffer size for TCP/UDP table queries (128KB should handle most systems)
         static constexpr DWORD initial_buffer_size{ 131072 };
 
+        /// Period during which a cached owner is trusted without re-checking the process creation time
+        static constexpr std::chrono::seconds owner_validation_interval{ 1 };
+
+        /**
+         * @brief Shared owner instance of a (PID, service tag) pair.
+         */
+        struct cached_owner
+        {
+            owner_module_resolver::process_identity identity;   ///< PID and creation time of the resolved process
+            std::chrono::steady_clock::time_point validated;    ///< Last time identity was checked against the live process
+            std::shared_ptr<network_process> process;           ///< Shared owner instance
+        };
+
+        /// Owner cache type keyed by PID << 32 | service tag
+        using owner_cache_t = std::unordered_map<uint64_t, cached_owner>;
+
+        /**
+         * @brief Owner of a TCP session or UDP endpoint as of the last table refresh.
+         */
+        struct owner_entry
+        {
+            owner_entry(std::shared_ptr<network_process> process, const DWORD tag, const int64_t created,
+                        const uint32_t seen) noexcept
+                : process(std::move(process)), tag(tag), created(created), seen(seen)
+            {
+            }
+
+            std::shared_ptr<network_process> process;   ///< Owning process
+            DWORD tag;                                  ///< Service tag of the owning module
+            int64_t created;                            ///< Socket creation timestamp reported by the IP Helper table
+            uint32_t seen;                              ///< Last refresh pass the row was present in (only touched by the refreshing thread)
+        };
+
         /// Hash table type for TCP sessions
-        using tcp_hashtable_t = std::unordered_map<net::ip_session<T>, std::shared_ptr<network_process>>;
+        using tcp_hashtable_t = tools::generic::flat_hash_map<net::ip_session<T>, owner_entry>;
         /// Hash table type for UDP endpoints
-        using udp_hashtable_t = std::unordered_map<net::ip_endpoint<T>, std::shared_ptr<network_process>>;
+        using udp_hashtable_t = tools::generic::flat_hash_map<net::ip_endpoint<T>, owner_entry>;
+
+        /**
+         * @brief Last-seen timestamp of a protected (unresolvable) session or endpoint.
+         *
+         * The timestamp is atomic so lookups can refresh it while holding only the shared lock of the
+         * owning table; moves (performed by the table under its exclusive lock) copy the current value.
+         */
+        struct protected_entry
+        {
+            explicit protected_entry(const std::chrono::steady_clock::time_point time) noexcept
+                : last_seen(time.time_since_epoch().count())
+            {
+            }
+
+            protected_entry(protected_entry&& other) noexcept
+                : last_seen(other.last_seen.load(std::memory_order_relaxed))
+            {
+            }
+
+            protected_entry& operator=(protected_entry&& other) noexcept
+            {
+                last_seen.store(other.last_seen.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                return *this;
+            }
+
+            /**
+             * @brief Returns true if the entry has not been seen within protected_apps_cache_timeout.
+             */
+            [[nodiscard]] bool expired(const std::chrono::steady_clock::time_point now) const noexcept
+            {
+                return now - std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(
+                    last_seen.load(std::memory_order_relaxed))) > protected_apps_cache_timeout;
+            }
+
+            /**
+             * @brief Refreshes the timestamp.
+             */
+            void touch(const std::chrono::steady_clock::time_point now) const noexcept
+            {
+                last_seen.store(now.time_since_epoch().count(), std::memory_order_relaxed);
+            }
+
+            mutable std::atomic<std::chrono::steady_clock::rep> last_seen;  ///< steady_clock ticks of the last lookup
+        };
 
         /// Protected TCP sessions cache (sessions that couldn't be resolved)
-        using tcp_protected_t = std::unordered_map<net::ip_session<T>, std::chrono::time_point<std::chrono::steady_clock>>;
+        using tcp_protected_t = tools::generic::flat_hash_map<net::ip_session<T>, protected_entry>;
         /// Protected UDP sessions cache (endpoints that couldn't be resolved)
-        using udp_protected_t = std::unordered_map<net::ip_endpoint<T>, std::chrono::time_point<std::chrono::steady_clock>>;
+        using udp_protected_t = tools::generic::flat_hash_map<net::ip_endpoint<T>, protected_entry>;
 
     public:
         /**
          * @brief Constructs a process_lookup instance with specified logging configuration.
          *
          * Initializes the internal hash tables by querying the current TCP and UDP
-         * connection tables from the operating system.
+         * connection tables from the operating system, unless @p load_tables is false.
          *
          * @param log_level Minimum log level for output
          * @param log_stream Optional output stream for log messages
+         * @param load_tables If false, the tables stay empty until the first actualize(), e.g. for an
+         *        owner that fills them right before the lookups start
          */
         explicit process_lookup(const log_level log_level = log_level::error,
-            std::shared_ptr<std::ostream> log_stream = nullptr)
+            std::shared_ptr<std::ostream> log_stream = nullptr,
+            const bool load_tables = true)
             : netlib::log::logger<process_lookup>(log_level, std::move(log_stream))
         {
             default_process_ = std::make_shared<network_process>(0, L"SYSTEM", L"SYSTEM");
-            initialize_tcp_table();
-            initialize_udp_table();
+
+            if (load_tables)
+            {
+                initialize_tcp_table();
+                initialize_udp_table();
+            }
         }
 
         // Disable copy and move operations to ensure singleton-like behavior
@@ -194,14 +278,12 @@ namespace iphelper
         // Core data structures
         tcp_hashtable_t  tcp_to_app_;           ///< TCP sessions to process mapping
         udp_hashtable_t  udp_to_app_;           ///< UDP endpoints to process mapping
-        std::shared_mutex tcp_to_app_mutex_;    ///< Reader-writer lock for TCP hash table
-        std::shared_mutex udp_to_app_mutex_;    ///< Reader-writer lock for UDP hash table
+        std::shared_mutex tcp_to_app_mutex_;    ///< Reader-writer lock for TCP hash table and TCP protected apps
+        std::shared_mutex udp_to_app_mutex_;    ///< Reader-writer lock for UDP hash table and UDP protected apps
 
-        // Protected apps cache (for processes that couldn't be resolved)
-        tcp_protected_t tcp_protected_apps_;        ///< TCP sessions with unresolvable processes
-        udp_protected_t udp_protected_apps_;        ///< UDP endpoints with unresolvable processes
-        std::mutex      tcp_protected_apps_lock_;   ///< Mutex for TCP protected apps
-        std::mutex      udp_protected_apps_lock_;   ///< Mutex for UDP protected apps
+        // Protected apps cache (for processes that couldn't be resolved), guarded by the table locks above
+        tcp_protected_t tcp_protected_apps_;    ///< TCP sessions with unresolvable processes
+        udp_protected_t udp_protected_apps_;    ///< UDP endpoints with unresolvable processes
 
         /// Default process object for unresolvable processes
         std::shared_ptr<network_process> default_process_;
@@ -213,6 +295,22 @@ namespace iphelper
         std::mutex table_buffer_udp_lock_;                                                           ///< Mutex for UDP buffer access
         DWORD table_buffer_size_tcp_{ initial_buffer_size };                                         ///< Current TCP buffer size
         DWORD table_buffer_size_udp_{ initial_buffer_size };                                         ///< Current UDP buffer size
+        uint32_t tcp_refresh_pass_{ 0 };                                                             ///< TCP refresh counter (guarded by table_buffer_tcp_lock_)
+        uint32_t udp_refresh_pass_{ 0 };                                                             ///< UDP refresh counter (guarded by table_buffer_udp_lock_)
+
+        // Refresh metrics, see get_refresh_statistics()
+        std::atomic<uint64_t> tcp_refreshes_{ 0 };      ///< TCP refreshes requested
+        std::atomic<uint64_t> udp_refreshes_{ 0 };      ///< UDP refreshes requested
+        std::atomic<uint64_t> refresh_failures_{ 0 };   ///< actualize() calls that failed
+        tools::metrics::latency_histogram refresh_time_; ///< Duration of actualize() calls
+
+        // Owner cache shared by the TCP and UDP tables
+        owner_cache_t owner_cache_;         ///< Resolved owners by (PID, service tag)
+        std::mutex    owner_cache_lock_;    ///< Mutex for the owner cache
+
+        // Static table, see set_static_table()
+        std::atomic<bool> static_table_{ false };       ///< The tables are not refreshed from the system
+        std::shared_ptr<network_process> static_owner_; ///< Owner of unlisted sessions and endpoints (guarded by both table locks)
 
     public:
         /**
@@ -234,29 +332,23 @@ namespace iphelper
         template <bool SetToDefault, bool UpdateProtected = true>
         std::shared_ptr<network_process> lookup_process_for_tcp(const net::ip_session<T>& session)
         {
+            const auto now = std::chrono::steady_clock::now();
+
             {
                 std::shared_lock lock(tcp_to_app_mutex_);
                 if (auto it = tcp_to_app_.find(session); it != tcp_to_app_.end())
-                    return it->second;
-            }
-
-            const auto now = std::chrono::steady_clock::now();
-
-            std::unique_lock lock(tcp_protected_apps_lock_);
-            if (auto it = tcp_protected_apps_.find(session); it != tcp_protected_apps_.end()) {
-                if (now - it->second > protected_apps_cache_timeout) {
-                    tcp_protected_apps_.erase(it);
-                }
-                else {
-                    if constexpr (UpdateProtected) {
-                        it->second = now;
-                    }
+                    return it->second.process;
+                if (static_owner_)
+                    return static_owner_;
+                if (lookup_protected<UpdateProtected>(tcp_protected_apps_, session, now))
                     return default_process_;
-                }
             }
 
             if constexpr (SetToDefault) {
-                tcp_protected_apps_.try_emplace(session, now);
+                std::unique_lock lock(tcp_to_app_mutex_);
+                if (auto it = tcp_to_app_.find(session); it != tcp_to_app_.end())
+                    return it->second.process;
+                insert_protected(tcp_protected_apps_, session, now);
                 return default_process_;
             }
             else {
@@ -288,31 +380,27 @@ namespace iphelper
             auto zero_ip_endpoint = endpoint;
             zero_ip_endpoint.ip = T{};
 
+            const auto now = std::chrono::steady_clock::now();
+
             {
                 std::shared_lock lock(udp_to_app_mutex_);
                 if (auto it = udp_to_app_.find(endpoint); it != udp_to_app_.end())
-                    return it->second;
+                    return it->second.process;
                 if (auto it = udp_to_app_.find(zero_ip_endpoint); it != udp_to_app_.end())
-                    return it->second;
-            }
-
-            const auto now = std::chrono::steady_clock::now();
-
-            std::unique_lock lock(udp_protected_apps_lock_);
-            if (auto it = udp_protected_apps_.find(endpoint); it != udp_protected_apps_.end()) {
-                if (now - it->second > protected_apps_cache_timeout) {
-                    udp_protected_apps_.erase(it);
-                }
-                else {
-                    if constexpr (UpdateProtected) {
-                        it->second = now;
-                    }
+                    return it->second.process;
+                if (static_owner_)
+                    return static_owner_;
+                if (lookup_protected<UpdateProtected>(udp_protected_apps_, endpoint, now))
                     return default_process_;
-                }
             }
 
             if constexpr (SetToDefault) {
-                udp_protected_apps_.try_emplace(endpoint, now);
+                std::unique_lock lock(udp_to_app_mutex_);
+                if (auto it = udp_to_app_.find(endpoint); it != udp_to_app_.end())
+                    return it->second.process;
+                if (auto it = udp_to_app_.find(zero_ip_endpoint); it != udp_to_app_.end())
+                    return it->second.process;
+                insert_protected(udp_protected_apps_, endpoint, now);
                 return default_process_;
             }
             else {
@@ -331,40 +419,124 @@ namespace iphelper
          * @param udp Whether to update UDP connection table
          * @return true if all requested updates succeeded, false if any failed
          *
-         * @note This is an expensive operation that should not be called frequently
+         * @note Only rows that appeared or changed owner since the previous refresh are resolved,
+         *       so the cost is dominated by the IP Helper query itself
          * @note Automatically cleans up expired protected app cache entries
+         * @note Does nothing once set_static_table() was called
          */
         bool actualize(const bool tcp, const bool udp)
         {
+            if (static_table_.load(std::memory_order_acquire))
+                return true;
+
             auto ret_tcp = true, ret_udp = true;
 
+            const auto started = std::chrono::steady_clock::now();
+
             if (tcp) ret_tcp = initialize_tcp_table();
             if (udp) ret_udp = initialize_udp_table();
 
+            if (tcp) tcp_refreshes_.fetch_add(1, std::memory_order_relaxed);
+            if (udp) udp_refreshes_.fetch_add(1, std::memory_order_relaxed);
+            if (!ret_tcp || !ret_udp) refresh_failures_.fetch_add(1, std::memory_order_relaxed);
+            refresh_time_.record(std::chrono::steady_clock::now() - started);
+
+            evict_unreferenced_owners();
+
             const auto now = std::chrono::steady_clock::now();
 
             {
-                std::unique_lock lock(udp_protected_apps_lock_);
-                for (auto it = udp_protected_apps_.begin(); it != udp_protected_apps_.end(); ) {
-                    if (now - it->second > protected_apps_cache_timeout)
-                        it = udp_protected_apps_.erase(it);
-                    else
-                        ++it;
-                }
+                std::unique_lock lock(udp_to_app_mutex_);
+                udp_protected_apps_.erase_if([now](const auto& entry) {
+                    return entry.second.expired(now);
+                });
             }
             {
-                std::unique_lock lock(tcp_protected_apps_lock_);
-                for (auto it = tcp_protected_apps_.begin(); it != tcp_protected_apps_.end(); ) {
-                    if (now - it->second > protected_apps_cache_timeout)
-                        it = tcp_protected_apps_.erase(it);
-                    else
-                        ++it;
-                }
+                std::unique_lock lock(tcp_to_app_mutex_);
+                tcp_protected_apps_.erase_if([now](const auto& entry) {
+                    return entry.second.expired(now);
+                });
             }
 
             return (ret_udp && ret_tcp);
         }
 
+        /**
+         * @brief Replaces the system connection tables with a fixed set of owners.
+         *
+         * Lets the packet path be driven without the live IP Helper tables, for instance when
+         * replaying a capture (see netlib/benchmarks/pcap_replay.cpp). From then on actualize() does not
+         * query the system, and lookups that find no listed owner return @p fallback instead of
+         * nullptr, so no packet is ever deferred for a table refresh.
+         *
+         * @param tcp Owners of TCP sessions
+         * @param udp Owners of UDP endpoints, an unspecified address matches every local address
+         * @param fallback Owner of the sessions and endpoints not listed, the default SYSTEM process if null
+         *
+         * @note Thread-safe operation with write locks
+         */
+        void set_static_table(const std::vector<std::pair<net::ip_session<T>, std::shared_ptr<network_process>>>& tcp,
+                              const std::vector<std::pair<net::ip_endpoint<T>, std::shared_ptr<network_process>>>& udp,
+                              std::shared_ptr<network_process> fallback = nullptr)
+        {
+            static_table_.store(true, std::memory_order_release);
+
+            std::scoped_lock lock(tcp_to_app_mutex_, udp_to_app_mutex_);
+
+            tcp_to_app_.clear();
+            udp_to_app_.clear();
+            tcp_protected_apps_.clear();
+            udp_protected_apps_.clear();
+
+            for (const auto& [session, process] : tcp)
+                tcp_to_app_.insert_or_assign(session, owner_entry{ process, 0, 0, 0 });
+
+            for (const auto& [endpoint, process] : udp)
+                udp_to_app_.insert_or_assign(endpoint, owner_entry{ process, 0, 0, 0 });
+
+            static_owner_ = fallback ? std::move(fallback) : default_process_;
+        }
+
+        /**
+         * @brief Refresh counters and table sizes of the lookup.
+         */
+        struct refresh_statistics
+        {
+            uint64_t tcp_refreshes;     ///< TCP table refreshes requested from actualize()
+            uint64_t udp_refreshes;     ///< UDP table refreshes requested from actualize()
+            uint64_t failures;          ///< actualize() calls with at least one failed refresh
+            std::size_t tcp_entries;    ///< TCP sessions currently mapped
+            std::size_t udp_entries;    ///< UDP endpoints currently mapped
+            tools::metrics::latency_histogram::snapshot refresh_time; ///< Duration of actualize() calls
+        };
+
+        /**
+         * @brief Returns the refresh counters and the current table sizes.
+         *
+         * @note Thread-safe operation with read locks
+         */
+        [[nodiscard]] refresh_statistics get_refresh_statistics()
+        {
+            refresh_statistics statistics{
+                tcp_refreshes_.load(std::memory_order_relaxed),
+                udp_refreshes_.load(std::memory_order_relaxed),
+                refresh_failures_.load(std::memory_order_relaxed),
+                0, 0,
+                refresh_time_.get_snapshot()
+            };
+
+            {
+                std::shared_lock lock(tcp_to_app_mutex_);
+                statistics.tcp_entries = tcp_to_app_.size();
+            }
+            {
+                std::shared_lock lock(udp_to_app_mutex_);
+                statistics.udp_entries = udp_to_app_.size();
+            }
+
+            return statistics;
+        }
+
         /**
          * @brief Generates a string dump of the TCP connection table.
          *
@@ -383,8 +555,8 @@ namespace iphelper
             for (const auto& entry : tcp_to_app_) {
                 oss << std::string(entry.first.local.ip) << " : " << entry.first.local.port
                     << " <---> " << std::string(entry.first.remote.ip) << " : " << entry.first.remote.port
-                    << " : " << entry.second->id << " : "
-                    << tools::strings::to_string(entry.second->name) << '\n';
+                    << " : " << entry.second.process->id << " : "
+                    << tools::strings::to_string(entry.second.process->name) << '\n';
             }
             return oss.str();
         }
@@ -403,7 +575,7 @@ namespace iphelper
             std::vector<net::ip_session<T>> sessions;
             std::shared_lock lock(tcp_to_app_mutex_);
             for (const auto& entry : tcp_to_app_) {
-                if (std::regex_match(entry.second->name, process))
+                if (std::regex_match(entry.second.process->name, process))
                     sessions.push_back(entry.first);
             }
             return sessions;
@@ -447,8 +619,8 @@ namespace iphelper
             std::shared_lock lock(udp_to_app_mutex_);
             for (const auto& entry : udp_to_app_) {
                 oss << std::string(entry.first.ip) << " : " << entry.first.port
-                    << " : " << entry.second->id << " : "
-                    << tools::strings::to_string(entry.second->name) << '\n';
+                    << " : " << entry.second.process->id << " : "
+                    << tools::strings::to_string(entry.second.process->name) << '\n';
             }
             return oss.str();
         }
@@ -486,102 +658,87 @@ namespace iphelper
         }
 
         /**
-         * @brief Processes a TCPv4 table entry and resolves its owner process.
+         * @brief Resolves the owner of a table row, sharing one network_process per live process.
          *
-         * Uses the owner_module_resolver to determine the process and service information
-         * for a TCP connection entry from the system's connection table.
+         * Owners are cached by (PID, service tag) together with the creation time of the process
+         * they were resolved for. A cached owner is returned without any system call if it was
+         * validated within owner_validation_interval, otherwise the creation time of the live
+         * process is re-read and compared, which detects PID reuse. Only cache misses go through
+         * owner_module_resolver and allocate a new network_process, so all sockets of a process
+         * share a single instance (and its memoized routing decision).
          *
-         * @param row Pointer to MIB_TCPROW_OWNER_MODULE structure
+         * @param kind Row kind used in log messages (e.g. "TCPv4")
+         * @param pid Owning process ID
+         * @param owning_module_info OwningModuleInfo array of the row
          * @return Shared pointer to network_process if successful, nullptr otherwise
          *
          * @note Implements fallback from service tag to process image resolution
          * @note Logs resolution attempts and results for debugging
          */
-        std::shared_ptr<network_process>
-            process_tcp_entry_v4(const PMIB_TCPROW_OWNER_MODULE row) noexcept
+        std::shared_ptr<network_process> resolve_owner(const char* kind, const DWORD pid,
+                                                       const ULONGLONG owning_module_info[16]) noexcept
         {
-            const DWORD pid = row->dwOwningPid;
             if (is_system_process(pid)) {
                 NETLIB_DEBUG(
-                    "TCPv4 entry with system process PID = {} ({}) skipping resolution",
+                    "{} entry with system process PID = {} ({}) skipping resolution",
+                    kind,
                     pid,
                     pid == 0 ? "Idle" : "System");
                 return nullptr;
             }
-            const DWORD tag = owner_module_resolver::service_tag_from_owning_module_info(row->OwningModuleInfo);
-
-            const auto ext = owner_module_resolver::resolve_from_pid_and_tag_extended(pid, tag);
-            if (ext.error == owner_module_resolver::error_code::success) {
-                NETLIB_DEBUG(
-                    "Resolved TCPv4 owner: pid={} tag={} name=\"{}\" path=\"{}\"",
-                    pid,
-                    tag,
-                    tools::strings::to_string(ext.data.base_name),
-                    tools::strings::to_string(ext.data.full_path));
+            const DWORD tag = owner_module_resolver::service_tag_from_owning_module_info(owning_module_info);
+            const auto key = static_cast<uint64_t>(pid) << 32 | tag;
+            const auto now = std::chrono::steady_clock::now();
 
-                return std::make_shared<network_process>(
-                    pid,
-                    std::wstring{ ext.data.base_name },
-                    std::wstring{ ext.data.full_path }
-                );
-            }
+            try {
+                {
+                    std::scoped_lock lock(owner_cache_lock_);
+                    if (const auto it = owner_cache_.find(key);
+                        it != owner_cache_.end() && now - it->second.validated < owner_validation_interval)
+                        return it->second.process;
+                }
 
-            if (tag != 0 && ext.error == owner_module_resolver::error_code::service_not_found) {
-                if (owner_module_resolver::result img{}; owner_module_resolver::resolve_from_pid_and_tag(pid, 0, img)) {
-                    NETLIB_DEBUG(
-                        "Service tag not found; fell back to process image (TCPv4): pid={} tag={} name=\"{}\" path=\"{}\"",
-                        pid,
-                        tag,
-                        tools::strings::to_string(img.base_name),
-                        tools::strings::to_string(img.full_path));
+                owner_module_resolver::process_identity identity{};
+                const auto has_identity = owner_module_resolver::get_process_identity(pid, identity);
 
-                    return std::make_shared<network_process>(
-                        pid,
-                        std::move(img.base_name),
-                        std::move(img.full_path)
-                    );
+                if (has_identity) {
+                    std::scoped_lock lock(owner_cache_lock_);
+                    if (const auto it = owner_cache_.find(key);
+                        it != owner_cache_.end() && it->second.identity == identity) {
+                        it->second.validated = now;
+                        return it->second.process;
+                    }
                 }
-            }
 
-            NETLIB_DEBUG(
-                "Failed to resolve TCPv4 owner: pid={} tag={} error={}{}",
-                pid,
-                tag,
-                error_code_to_string(ext.error),
-                ext.error_message.empty() ? "" : std::format(" msg=\"{}\"", tools::strings::to_string(ext.error_message)));
+                auto process_ptr = resolve_owner_uncached(kind, pid, tag);
 
-            return nullptr;
+                if (process_ptr && has_identity) {
+                    std::scoped_lock lock(owner_cache_lock_);
+                    owner_cache_.insert_or_assign(key, cached_owner{ identity, now, process_ptr });
+                }
+
+                return process_ptr;
+            }
+            catch (...) {
+                return nullptr;
+            }
         }
 
         /**
-         * @brief Processes a TCPv6 table entry and resolves its owner process.
+         * @brief Resolves the owner of a (PID, service tag) pair through owner_module_resolver.
          *
-         * Uses the owner_module_resolver to determine the process and service information
-         * for a TCP connection entry from the system's IPv6 connection table.
-         *
-         * @param row Pointer to MIB_TCP6ROW_OWNER_MODULE structure
-         * @return Shared pointer to network_process if successful, nullptr otherwise
-         *
-         * @note Implements fallback from service tag to process image resolution
-         * @note Logs resolution attempts and results for debugging
+         * @param kind Row kind used in log messages (e.g. "TCPv4")
+         * @param pid Owning process ID
+         * @param tag Service tag of the owning module (0 if none)
+         * @return Newly allocated network_process if successful, nullptr otherwise
          */
-        std::shared_ptr<network_process>
-            process_tcp_entry_v6(const PMIB_TCP6ROW_OWNER_MODULE row) noexcept
+        std::shared_ptr<network_process> resolve_owner_uncached(const char* kind, const DWORD pid, const DWORD tag)
         {
-            const DWORD pid = row->dwOwningPid;
-            if (is_system_process(pid)) {
-                NETLIB_DEBUG(
-                    "TCPv6 entry with system process PID = {} ({}) skipping resolution",
-                    pid,
-                    pid == 0 ? "Idle" : "System");
-                return nullptr;
-            }
-            const DWORD tag = owner_module_resolver::service_tag_from_owning_module_info(row->OwningModuleInfo);
-
             const auto ext = owner_module_resolver::resolve_from_pid_and_tag_extended(pid, tag);
             if (ext.error == owner_module_resolver::error_code::success) {
                 NETLIB_DEBUG(
-                    "Resolved TCPv6 owner: pid={} tag={} name=\"{}\" path=\"{}\"",
+                    "Resolved {} owner: pid={} tag={} name=\"{}\" path=\"{}\"",
+                    kind,
                     pid,
                     tag,
                     tools::strings::to_string(ext.data.base_name),
@@ -597,7 +754,8 @@ namespace iphelper
             if (tag != 0 && ext.error == owner_module_resolver::error_code::service_not_found) {
                 if (owner_module_resolver::result img{}; owner_module_resolver::resolve_from_pid_and_tag(pid, 0, img)) {
                     NETLIB_DEBUG(
-                        "Service tag not found; fell back to process image (TCPv6): pid={} tag={} name=\"{}\" path=\"{}\"",
+                        "Service tag not found; fell back to process image ({}): pid={} tag={} name=\"{}\" path=\"{}\"",
+                        kind,
                         pid,
                         tag,
                         tools::strings::to_string(img.base_name),
@@ -612,7 +770,8 @@ namespace iphelper
             }
 
             NETLIB_DEBUG(
-                "Failed to resolve TCPv6 owner: pid={} tag={} error={}{}",
+                "Failed to resolve {} owner: pid={} tag={} error={}{}",
+                kind,
                 pid,
                 tag,
                 error_code_to_string(ext.error),
@@ -622,139 +781,208 @@ namespace iphelper
         }
 
         /**
-         * @brief Processes a UDPv4 table entry and resolves its owner process.
-         *
-         * Uses the owner_module_resolver to determine the process and service information
-         * for a UDP endpoint entry from the system's connection table.
+         * @brief Drops cached owners that no table entry refers to any more.
          *
-         * @param row Pointer to MIB_UDPROW_OWNER_MODULE structure
+         * An owner only referenced by the cache has no live socket left, which is the case once
+         * its process has exited and the refreshed tables no longer list its sockets.
+         */
+        void evict_unreferenced_owners() noexcept
+        {
+            std::scoped_lock lock(owner_cache_lock_);
+            std::erase_if(owner_cache_, [](const auto& item) { return item.second.process.use_count() == 1; });
+        }
+
+        /**
+         * @brief Processes a TCPv4 table entry and resolves its owner process.
+         * @param row Pointer to MIB_TCPROW_OWNER_MODULE structure
          * @return Shared pointer to network_process if successful, nullptr otherwise
-         *
-         * @note Implements fallback from service tag to process image resolution
-         * @note Logs resolution attempts and results for debugging
          */
         std::shared_ptr<network_process>
-            process_udp_entry_v4(const PMIB_UDPROW_OWNER_MODULE row) noexcept
+            process_tcp_entry_v4(const MIB_TCPROW_OWNER_MODULE* row) noexcept
         {
-            const DWORD pid = row->dwOwningPid;
-            if (is_system_process(pid)) {
-                NETLIB_DEBUG(
-                    "UDPv4 entry with system process PID = {} ({}) skipping resolution",
-                    pid,
-                    pid == 0 ? "Idle" : "System");
-                return nullptr;
-            }
-            const DWORD tag = owner_module_resolver::service_tag_from_owning_module_info(row->OwningModuleInfo);
+            return resolve_owner("TCPv4", row->dwOwningPid, row->OwningModuleInfo);
+        }
 
-            const auto ext = owner_module_resolver::resolve_from_pid_and_tag_extended(pid, tag);
-            if (ext.error == owner_module_resolver::error_code::success) {
-                NETLIB_DEBUG(
-                    "Resolved UDPv4 owner: pid={} tag={} name=\"{}\" path=\"{}\"",
-                    pid,
-                    tag,
-                    tools::strings::to_string(ext.data.base_name),
-                    tools::strings::to_string(ext.data.full_path));
+        /**
+         * @brief Processes a TCPv6 table entry and resolves its owner process.
+         * @param row Pointer to MIB_TCP6ROW_OWNER_MODULE structure
+         * @return Shared pointer to network_process if successful, nullptr otherwise
+         */
+        std::shared_ptr<network_process>
+            process_tcp_entry_v6(const MIB_TCP6ROW_OWNER_MODULE* row) noexcept
+        {
+            return resolve_owner("TCPv6", row->dwOwningPid, row->OwningModuleInfo);
+        }
 
-                return std::make_shared<network_process>(
-                    pid,
-                    std::wstring{ ext.data.base_name },
-                    std::wstring{ ext.data.full_path }
-                );
-            }
+        /**
+         * @brief Processes a UDPv4 table entry and resolves its owner process.
+         * @param row Pointer to MIB_UDPROW_OWNER_MODULE structure
+         * @return Shared pointer to network_process if successful, nullptr otherwise
+         */
+        std::shared_ptr<network_process>
+            process_udp_entry_v4(const MIB_UDPROW_OWNER_MODULE* row) noexcept
+        {
+            return resolve_owner("UDPv4", row->dwOwningPid, row->OwningModuleInfo);
+        }
 
-            if (tag != 0 && ext.error == owner_module_resolver::error_code::service_not_found) {
-                if (owner_module_resolver::result img{}; owner_module_resolver::resolve_from_pid_and_tag(pid, 0, img)) {
-                    NETLIB_DEBUG(
-                        "Service tag not found; fell back to process image (UDPv4): pid={} tag={} name=\"{}\" path=\"{}\"",
-                        pid,
-                        tag,
-                        tools::strings::to_string(img.base_name),
-                        tools::strings::to_string(img.full_path));
+        /**
+         * @brief Processes a UDPv6 table entry and resolves its owner process.
+         * @param row Pointer to MIB_UDP6ROW_OWNER_MODULE structure
+         * @return Shared pointer to network_process if successful, nullptr otherwise
+         */
+        std::shared_ptr<network_process>
+            process_udp_entry_v6(const MIB_UDP6ROW_OWNER_MODULE* row) noexcept
+        {
+            return resolve_owner("UDPv6", row->dwOwningPid, row->OwningModuleInfo);
+        }
 
-                    return std::make_shared<network_process>(
-                        pid,
-                        std::move(img.base_name),
-                        std::move(img.full_path)
-                    );
-                }
+        /**
+         * @brief Checks the protected apps cache for a live entry, optionally refreshing its timestamp.
+         *
+         * Expired entries are reported as absent but left in place for actualize() to sweep, so the
+         * lookup never needs more than the shared lock of the owning table.
+         *
+         * @tparam Update If true, refreshes the timestamp of a live entry
+         * @param table Protected apps cache
+         * @param key Session or endpoint to look up
+         * @param now Current time
+         * @return true if a live entry exists
+         *
+         * @note Must be called with the shared (or exclusive) lock of the owning table held
+         */
+        template <bool Update, typename Table, typename Key>
+        static bool lookup_protected(const Table& table, const Key& key, const std::chrono::steady_clock::time_point now) noexcept
+        {
+            const auto it = table.find(key);
+            if (it == table.end() || it->second.expired(now))
+                return false;
+
+            if constexpr (Update) {
+                it->second.touch(now);
             }
 
-            NETLIB_DEBUG(
-                "Failed to resolve UDPv4 owner: pid={} tag={} error={}{}",
-                pid,
-                tag,
-                error_code_to_string(ext.error),
-                ext.error_message.empty() ? "" : std::format(" msg=\"{}\"", tools::strings::to_string(ext.error_message)));
+            return true;
+        }
 
-            return nullptr;
+        /**
+         * @brief Adds an entry to the protected apps cache or revives an existing (possibly expired) one.
+         *
+         * @param table Protected apps cache
+         * @param key Session or endpoint to add
+         * @param now Current time
+         *
+         * @note Must be called with the exclusive lock of the owning table held
+         */
+        template <typename Table, typename Key>
+        static void insert_protected(Table& table, const Key& key, const std::chrono::steady_clock::time_point now)
+        {
+            if (auto [it, inserted] = table.try_emplace(key, now); !inserted)
+                it->second.touch(now);
         }
 
         /**
-         * @brief Processes a UDPv6 table entry and resolves its owner process.
+         * @brief Brings a session/endpoint hash table in line with a fresh IP Helper table.
          *
-         * Uses the owner_module_resolver to determine the process and service information
-         * for a UDP endpoint entry from the system's IPv6 connection table.
+         * Rows whose key, owning PID, service tag and creation timestamp are unchanged keep their
+         * existing entry and are only marked as seen under the shared lock; only new or changed rows
+         * are resolved (outside any table lock) and inserted, and entries of rows that disappeared
+         * are erased. The exclusive lock is held just for the inserts and, when some rows vanished,
+         * a sweep of the entries not marked in this pass.
          *
-         * @param row Pointer to MIB_UDP6ROW_OWNER_MODULE structure
-         * @return Shared pointer to network_process if successful, nullptr otherwise
+         * @param table Hash table to update
+         * @param table_mutex Reader-writer lock of the hash table
+         * @param pass Refresh counter of the table (guarded by the caller's buffer lock)
+         * @param rows Pointer to the first table row
+         * @param count Number of rows
+         * @param key_of Callable producing the hash table key of a row
+         * @param resolve Callable resolving the owning process of a row (may return nullptr)
          *
-         * @note Implements fallback from service tag to process image resolution
-         * @note Logs resolution attempts and results for debugging
+         * @note Must be called with the corresponding table buffer lock held
          */
-        std::shared_ptr<network_process>
-            process_udp_entry_v6(const PMIB_UDP6ROW_OWNER_MODULE row) noexcept
+        template <typename Table, typename Row, typename KeyOf, typename Resolve>
+        static void synchronize_table(Table& table, std::shared_mutex& table_mutex, uint32_t& pass,
+                                      const Row* rows, const size_t count, KeyOf key_of, Resolve resolve)
         {
-            const DWORD pid = row->dwOwningPid;
-            if (is_system_process(pid)) {
-                NETLIB_DEBUG(
-                    "UDPv6 entry with system process PID = {} ({}) skipping resolution",
-                    pid,
-                    pid == 0 ? "Idle" : "System");
-                return nullptr;
-            }
-            const DWORD tag = owner_module_resolver::service_tag_from_owning_module_info(row->OwningModuleInfo);
+            const auto current_pass = ++pass;
+            size_t marked = 0;
+            std::vector<std::pair<typename Table::key_type, const Row*>> changed;
 
-            const auto ext = owner_module_resolver::resolve_from_pid_and_tag_extended(pid, tag);
-            if (ext.error == owner_module_resolver::error_code::success) {
-                NETLIB_DEBUG(
-                    "Resolved UDPv6 owner: pid={} tag={} name=\"{}\" path=\"{}\"",
-                    pid,
-                    tag,
-                    tools::strings::to_string(ext.data.base_name),
-                    tools::strings::to_string(ext.data.full_path));
+            {
+                std::shared_lock lock(table_mutex);
 
-                return std::make_shared<network_process>(
-                    pid,
-                    std::wstring{ ext.data.base_name },
-                    std::wstring{ ext.data.full_path }
-                );
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const auto key = key_of(rows[i]);
+                    const auto tag = owner_module_resolver::service_tag_from_owning_module_info(rows[i].OwningModuleInfo);
+
+                    if (const auto it = table.find(key);
+                        it != table.end() &&
+                        it->second.process->id == rows[i].dwOwningPid &&
+                        it->second.tag == tag &&
+                        it->second.created == rows[i].liCreateTimestamp.QuadPart)
+                    {
+                        if (std::exchange(it->second.seen, current_pass) != current_pass)
+                            ++marked;
+                    }
+                    else
+                    {
+                        changed.emplace_back(key, &rows[i]);
+                    }
+                }
             }
 
-            if (tag != 0 && ext.error == owner_module_resolver::error_code::service_not_found) {
-                if (owner_module_resolver::result img{}; owner_module_resolver::resolve_from_pid_and_tag(pid, 0, img)) {
-                    NETLIB_DEBUG(
-                        "Service tag not found; fell back to process image (UDPv6): pid={} tag={} name=\"{}\" path=\"{}\"",
-                        pid,
-                        tag,
-                        tools::strings::to_string(img.base_name),
-                        tools::strings::to_string(img.full_path));
+            // Resolve new owners without blocking lookups
+            struct resolved_row
+            {
+                typename Table::key_type key;
+                std::shared_ptr<network_process> process;
+                DWORD tag;
+                int64_t created;
+            };
 
-                    return std::make_shared<network_process>(
-                        pid,
-                        std::move(img.base_name),
-                        std::move(img.full_path)
-                    );
+            std::vector<resolved_row> resolved;
+            resolved.reserve(changed.size());
+
+            for (const auto& [key, row] : changed)
+            {
+                if (auto process_ptr = resolve(row))
+                {
+                    resolved.push_back({ key, std::move(process_ptr),
+                        owner_module_resolver::service_tag_from_owning_module_info(row->OwningModuleInfo),
+                        row->liCreateTimestamp.QuadPart });
                 }
             }
 
-            NETLIB_DEBUG(
-                "Failed to resolve UDPv6 owner: pid={} tag={} error={}{}",
-                pid,
-                tag,
-                error_code_to_string(ext.error),
-                ext.error_message.empty() ? "" : std::format(" msg=\"{}\"", tools::strings::to_string(ext.error_message)));
+            std::unique_lock lock(table_mutex);
 
-            return nullptr;
+            // Bulk insert: rehash at most once
+            table.reserve(table.size() + resolved.size());
+
+            for (auto& [key, process, tag, created] : resolved)
+            {
+                if (const auto it = table.find(key); it != table.end())
+                {
+                    if (it->second.seen != current_pass)
+                        ++marked;
+
+                    it->second.process = std::move(process);
+                    it->second.tag = tag;
+                    it->second.created = created;
+                    it->second.seen = current_pass;
+                }
+                else
+                {
+                    table.try_emplace(key, std::move(process), tag, created, current_pass);
+                    ++marked;
+                }
+            }
+
+            // Every entry is marked unless some rows disappeared (or failed to resolve)
+            if (table.size() != marked)
+                table.erase_if([current_pass](const auto& item)
+                {
+                    return item.second.seen != current_pass;
+                });
         }
 
         /**
@@ -768,12 +996,11 @@ namespace iphelper
          *
          * @note Uses automatic buffer growth for large connection tables
          * @note Thread-safe buffer management with mutex protection
-         * @note Replaces the entire hash table atomically
+         * @note Updates the hash table incrementally, see synchronize_table()
          */
         bool initialize_tcp_table()
         {
             try {
-                tcp_hashtable_t tcp_to_app;
                 {
                     std::unique_lock lock(table_buffer_tcp_lock_);
 
@@ -798,36 +1025,35 @@ namespace iphelper
 
                     if constexpr (std::is_same_v<T, net::ip_address_v4>) {
                         auto* table = reinterpret_cast<PMIB_TCPTABLE_OWNER_MODULE>(table_buffer_tcp_.get());
-                        for (size_t i = 0; i < table->dwNumEntries; i++) {
-                            if (auto process_ptr = process_tcp_entry_v4(&table->table[i])) {
-                                tcp_to_app[net::ip_session<T>(
-                                    T{ table->table[i].dwLocalAddr },
-                                    T{ table->table[i].dwRemoteAddr },
-                                    ntohs(static_cast<uint16_t>(table->table[i].dwLocalPort)),
-                                    ntohs(static_cast<uint16_t>(table->table[i].dwRemotePort)))]
-                                    = std::move(process_ptr);
-                            }
-                        }
+                        synchronize_table(tcp_to_app_, tcp_to_app_mutex_, tcp_refresh_pass_, table->table, table->dwNumEntries,
+                            [](const MIB_TCPROW_OWNER_MODULE& row) {
+                                return net::ip_session<T>(
+                                    T{ row.dwLocalAddr },
+                                    T{ row.dwRemoteAddr },
+                                    ntohs(static_cast<uint16_t>(row.dwLocalPort)),
+                                    ntohs(static_cast<uint16_t>(row.dwRemotePort)));
+                            },
+                            [this](const MIB_TCPROW_OWNER_MODULE* row) {
+                                return process_tcp_entry_v4(row);
+                            });
                     }
                     else {
                         auto* table = reinterpret_cast<PMIB_TCP6TABLE_OWNER_MODULE>(table_buffer_tcp_.get());
-                        for (size_t i = 0; i < table->dwNumEntries; i++) {
-                            if (auto process_ptr = process_tcp_entry_v6(&table->table[i])) {
-                                tcp_to_app[net::ip_session<T>(
-                                    T{ table->table[i].ucLocalAddr },
-                                    T{ table->table[i].ucRemoteAddr },
-                                    ntohs(static_cast<uint16_t>(table->table[i].dwLocalPort)),
-                                    ntohs(static_cast<uint16_t>(table->table[i].dwRemotePort)),
-                                    table->table[i].dwLocalScopeId,
-                                    table->table[i].dwRemoteScopeId)]
-                                    = std::move(process_ptr);
-                            }
-                        }
+                        synchronize_table(tcp_to_app_, tcp_to_app_mutex_, tcp_refresh_pass_, table->table, table->dwNumEntries,
+                            [](const MIB_TCP6ROW_OWNER_MODULE& row) {
+                                return net::ip_session<T>(
+                                    T{ row.ucLocalAddr },
+                                    T{ row.ucRemoteAddr },
+                                    ntohs(static_cast<uint16_t>(row.dwLocalPort)),
+                                    ntohs(static_cast<uint16_t>(row.dwRemotePort)),
+                                    row.dwLocalScopeId,
+                                    row.dwRemoteScopeId);
+                            },
+                            [this](const MIB_TCP6ROW_OWNER_MODULE* row) {
+                                return process_tcp_entry_v6(row);
+                            });
                     }
                 }
-
-                std::unique_lock lock(tcp_to_app_mutex_);
-                tcp_to_app_ = std::move(tcp_to_app);
             }
             catch (...) {
                 return false;
@@ -847,12 +1073,11 @@ namespace iphelper
          *
          * @note Uses automatic buffer growth for large endpoint tables
          * @note Thread-safe buffer management with mutex protection
-         * @note Replaces the entire hash table atomically
+         * @note Updates the hash table incrementally, see synchronize_table()
          */
         bool initialize_udp_table()
         {
             try {
-                udp_hashtable_t udp_to_app;
                 {
                     std::unique_lock lock(table_buffer_udp_lock_);
 
@@ -877,31 +1102,30 @@ namespace iphelper
 
                     if constexpr (std::is_same_v<T, net::ip_address_v4>) {
                         auto* table = reinterpret_cast<PMIB_UDPTABLE_OWNER_MODULE>(table_buffer_udp_.get());
-                        for (size_t i = 0; i < table->dwNumEntries; i++) {
-                            if (auto process_ptr = process_udp_entry_v4(&table->table[i])) {
-                                udp_to_app[net::ip_endpoint<T>(
-                                    T{ table->table[i].dwLocalAddr },
-                                    ntohs(static_cast<uint16_t>(table->table[i].dwLocalPort)))]
-                                    = std::move(process_ptr);
-                            }
-                        }
+                        synchronize_table(udp_to_app_, udp_to_app_mutex_, udp_refresh_pass_, table->table, table->dwNumEntries,
+                            [](const MIB_UDPROW_OWNER_MODULE& row) {
+                                return net::ip_endpoint<T>(
+                                    T{ row.dwLocalAddr },
+                                    ntohs(static_cast<uint16_t>(row.dwLocalPort)));
+                            },
+                            [this](const MIB_UDPROW_OWNER_MODULE* row) {
+                                return process_udp_entry_v4(row);
+                            });
                     }
                     else {
                         auto* table = reinterpret_cast<PMIB_UDP6TABLE_OWNER_MODULE>(table_buffer_udp_.get());
-                        for (size_t i = 0; i < table->dwNumEntries; i++) {
-                            if (auto process_ptr = process_udp_entry_v6(&table->table[i])) {
-                                udp_to_app[net::ip_endpoint<T>(
-                                    T{ table->table[i].ucLocalAddr },
-                                    ntohs(static_cast<uint16_t>(table->table[i].dwLocalPort)),
-                                    0)]
-                                    = std::move(process_ptr);
-                            }
-                        }
+                        synchronize_table(udp_to_app_, udp_to_app_mutex_, udp_refresh_pass_, table->table, table->dwNumEntries,
+                            [](const MIB_UDP6ROW_OWNER_MODULE& row) {
+                                return net::ip_endpoint<T>(
+                                    T{ row.ucLocalAddr },
+                                    ntohs(static_cast<uint16_t>(row.dwLocalPort)),
+                                    0);
+                            },
+                            [this](const MIB_UDP6ROW_OWNER_MODULE* row) {
+                                return process_udp_entry_v6(row);
+                            });
                     }
                 }
-
-                std::unique_lock lock(udp_to_app_mutex_);
-                udp_to_app_ = std::move(udp_to_app);
             }
             catch (...) {
                 return false;
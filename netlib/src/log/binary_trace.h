@@ -0,0 +1,600 @@
+#pragma once
+
+/**
+ * @file binary_trace.h
+ * @brief Binary flight recorder for high-rate diagnostic tracing.
+ *
+ * The NETLIB_LOG family of macros writes a message to the text log if the logger has its level
+ * enabled. Otherwise, while binary tracing is enabled for the level, the message is not
+ * formatted at all, so debug tracing can stay on while the text log keeps its usual level.
+ * Every call site owns a static trace_site that is registered once in the trace file (format
+ * string, source location and argument types), and each call writes a fixed-size record holding the site ID, a timestamp, the thread ID and the
+ * raw argument bytes into a ring of the memory-mapped trace file. Formatting happens offline,
+ * in the trace_decode tool (netlib/tools/trace_decode.cpp).
+ *
+ * ## Cost per Event:
+ * - One relaxed load to test the trace level, one atomic increment to claim a ring slot
+ * - QueryPerformanceCounter() and a copy of the argument bytes into the mapped page
+ * - No formatting, no allocation, no lock and no system call
+ *
+ * ## Flight Recorder Semantics:
+ * The ring keeps the most recent records, older ones are overwritten. The file is a mapped
+ * view of the page cache, so it survives a crash of the process and can be decoded afterwards.
+ *
+ * ## Argument Types:
+ * Integers, bool, char, float, double, void pointers and strings are encoded by this header,
+ * net::ip_address_v4/v6 by net/ip_address.h. Other argument types specialize trace_arg; a call
+ * with any argument type that has no trace_arg is not traced. Strings are truncated to the
+ * room left in the record, arguments that do not fit at all are dropped and shown as such by
+ * the decoder.
+ *
+ * @since C++20
+ */
+
+namespace netlib::log {
+
+    /**
+     * @brief Layout of the trace file, shared with the decoder.
+     *
+     * All integers are little-endian as written by the traced process. Offsets are in bytes from
+     * the start of the file.
+     */
+    namespace trace_format {
+
+        /// "NLTR"
+        inline constexpr std::uint32_t magic = 0x52544C4E;
+        inline constexpr std::uint32_t version = 1;
+
+        /// Maximum number of arguments of a traced call.
+        inline constexpr std::size_t max_args = 16;
+
+        /**
+         * @brief Encoding of a traced argument.
+         */
+        enum class arg_type : std::uint8_t {
+            none = 0,
+            i8, i16, i32, i64,              ///< Signed integers, raw.
+            u8, u16, u32, u64,              ///< Unsigned integers, raw.
+            f32, f64,                       ///< Floating point, raw.
+            boolean,                        ///< One byte, 0 or 1.
+            character,                      ///< One byte.
+            pointer,                        ///< Eight bytes, formatted as std::format formats void pointers.
+            string,                         ///< Length byte followed by up to 255 bytes (truncated).
+            ipv4,                           ///< Four bytes, network order.
+            ipv6,                           ///< Sixteen bytes, network order.
+            ip_address                      ///< Family byte (4 or 6) followed by an ipv4 or ipv6 value.
+        };
+
+        /**
+         * @brief File header, occupies the first page of the file.
+         */
+        struct file_header {
+            std::uint32_t magic;            ///< trace_format::magic.
+            std::uint32_t version;          ///< trace_format::version.
+            std::uint32_t process_id;       ///< Traced process.
+            std::uint32_t site_capacity;    ///< Entries in the site table.
+            std::uint64_t sites_offset;     ///< Offset of the site table.
+            std::uint64_t records_offset;   ///< Offset of the record ring.
+            std::uint64_t record_capacity;  ///< Records in the ring (a power of two).
+            std::uint64_t qpc_frequency;    ///< QueryPerformanceFrequency().
+            std::uint64_t start_qpc;        ///< QueryPerformanceCounter() when the trace started.
+            std::uint64_t start_time;       ///< System time when the trace started (FILETIME, UTC).
+            std::uint32_t site_count;       ///< Site table entries in use (updated atomically).
+            std::uint32_t reserved;
+            alignas(64) std::uint64_t head; ///< Records ever written (updated atomically).
+        };
+
+        /**
+         * @brief Site table entry: one per traced call site.
+         */
+        struct site_entry {
+            std::uint32_t line;             ///< Source line, 0 if the entry is not (yet) valid.
+            std::uint8_t level;             ///< log_level of the call site.
+            std::uint8_t arg_count;         ///< Number of arguments.
+            std::uint8_t arg_types[max_args]; ///< arg_type of each argument.
+            std::uint16_t reserved;
+            char file[96];                  ///< Source file name (NUL-terminated, truncated).
+            char function[96];              ///< Function name (NUL-terminated, truncated).
+            char format[296];               ///< std::format format string (NUL-terminated, truncated).
+        };
+
+        /**
+         * @brief Ring record: one per traced event.
+         */
+        struct record {
+            std::uint64_t sequence;         ///< Ticket + 1 once the record is complete, 0 while it is written.
+            std::uint64_t timestamp;        ///< QueryPerformanceCounter().
+            std::uint32_t site;             ///< Site table index + 1.
+            std::uint32_t thread_id;        ///< GetCurrentThreadId().
+            std::uint8_t arg_count;         ///< Arguments encoded (fewer than the site has if the payload was full).
+            std::uint8_t size;              ///< Payload bytes used.
+            std::byte payload[38];          ///< Encoded arguments, in order.
+        };
+
+        inline constexpr std::uint64_t header_size = 4096;
+
+        static_assert(sizeof(file_header) <= header_size);
+        static_assert(sizeof(site_entry) == 512);
+        static_assert(sizeof(record) == 64);
+    }
+
+    /**
+     * @brief Encoding of an argument type for binary tracing.
+     *
+     * Specializations provide `static constexpr trace_format::arg_type type` and
+     * `static std::size_t encode(const T& value, std::byte* out, std::size_t capacity) noexcept`,
+     * which returns the number of bytes written, or 0 if the value does not fit into capacity.
+     * Types without a specialization are not traceable.
+     *
+     * @tparam T Argument type (decayed).
+     */
+    template <typename T>
+    struct trace_arg {};
+
+    /**
+     * @brief True for argument types with a trace_arg specialization.
+     */
+    template <typename T>
+    concept traceable = requires { trace_arg<T>::type; };
+
+    namespace detail {
+
+        /**
+         * @brief Copies a value's bytes into the payload if it fits.
+         */
+        inline std::size_t trace_encode_raw(const void* value, const std::size_t size, std::byte* out, const std::size_t capacity) noexcept {
+            if (size > capacity)
+                return 0;
+
+            std::memcpy(out, value, size);
+            return size;
+        }
+
+        /**
+         * @brief Encodes a string as a length byte and its (truncated) characters.
+         */
+        inline std::size_t trace_encode_string(const std::string_view value, std::byte* out, const std::size_t capacity) noexcept {
+            if (capacity == 0)
+                return 0;
+
+            const auto length = std::min({ value.size(), capacity - 1, std::size_t{ 255 } });
+            out[0] = static_cast<std::byte>(length);
+            std::memcpy(out + 1, value.data(), length);
+            return length + 1;
+        }
+
+        /**
+         * @brief Returns the arg_type of an integer type.
+         */
+        template <std::integral T>
+        constexpr trace_format::arg_type integer_arg_type() noexcept {
+            using enum trace_format::arg_type;
+
+            if constexpr (std::is_signed_v<T>)
+                return sizeof(T) == 1 ? i8 : sizeof(T) == 2 ? i16 : sizeof(T) == 4 ? i32 : i64;
+            else
+                return sizeof(T) == 1 ? u8 : sizeof(T) == 2 ? u16 : sizeof(T) == 4 ? u32 : u64;
+        }
+    }
+
+    template <std::integral T>
+    struct trace_arg<T> {
+        static constexpr auto type = detail::integer_arg_type<T>();
+
+        static std::size_t encode(const T value, std::byte* out, const std::size_t capacity) noexcept {
+            return detail::trace_encode_raw(&value, sizeof(value), out, capacity);
+        }
+    };
+
+    template <>
+    struct trace_arg<bool> {
+        static constexpr auto type = trace_format::arg_type::boolean;
+
+        static std::size_t encode(const bool value, std::byte* out, const std::size_t capacity) noexcept {
+            const auto byte = static_cast<std::uint8_t>(value ? 1 : 0);
+            return detail::trace_encode_raw(&byte, 1, out, capacity);
+        }
+    };
+
+    template <>
+    struct trace_arg<char> {
+        static constexpr auto type = trace_format::arg_type::character;
+
+        static std::size_t encode(const char value, std::byte* out, const std::size_t capacity) noexcept {
+            return detail::trace_encode_raw(&value, 1, out, capacity);
+        }
+    };
+
+    template <>
+    struct trace_arg<float> {
+        static constexpr auto type = trace_format::arg_type::f32;
+
+        static std::size_t encode(const float value, std::byte* out, const std::size_t capacity) noexcept {
+            return detail::trace_encode_raw(&value, sizeof(value), out, capacity);
+        }
+    };
+
+    template <>
+    struct trace_arg<double> {
+        static constexpr auto type = trace_format::arg_type::f64;
+
+        static std::size_t encode(const double value, std::byte* out, const std::size_t capacity) noexcept {
+            return detail::trace_encode_raw(&value, sizeof(value), out, capacity);
+        }
+    };
+
+    template <>
+    struct trace_arg<const void*> {
+        static constexpr auto type = trace_format::arg_type::pointer;
+
+        static std::size_t encode(const void* value, std::byte* out, const std::size_t capacity) noexcept {
+            const auto address = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(value));
+            return detail::trace_encode_raw(&address, sizeof(address), out, capacity);
+        }
+    };
+
+    template <>
+    struct trace_arg<void*> : trace_arg<const void*> {};
+
+    template <>
+    struct trace_arg<std::nullptr_t> : trace_arg<const void*> {};
+
+    template <>
+    struct trace_arg<std::string_view> {
+        static constexpr auto type = trace_format::arg_type::string;
+
+        static std::size_t encode(const std::string_view value, std::byte* out, const std::size_t capacity) noexcept {
+            return detail::trace_encode_string(value, out, capacity);
+        }
+    };
+
+    template <>
+    struct trace_arg<std::string> : trace_arg<std::string_view> {};
+
+    template <>
+    struct trace_arg<const char*> {
+        static constexpr auto type = trace_format::arg_type::string;
+
+        static std::size_t encode(const char* value, std::byte* out, const std::size_t capacity) noexcept {
+            return detail::trace_encode_string(value != nullptr ? std::string_view{ value } : std::string_view{}, out, capacity);
+        }
+    };
+
+    template <>
+    struct trace_arg<char*> : trace_arg<const char*> {};
+
+    /**
+     * @brief Static description of a traced call site, one per NETLIB_LOG expansion.
+     *
+     * The site is registered in the trace file on its first traced call; the registration is
+     * tied to the trace file it was made in, so a site is registered again after the trace
+     * has been restarted.
+     */
+    struct trace_site {
+        std::string_view format;                    ///< Format string.
+        const char* file;                           ///< Source file.
+        const char* function;                       ///< Function name.
+        std::uint32_t line;                         ///< Source line.
+        log_level level;                            ///< Level of the call site.
+        std::atomic<std::uint64_t> key{ 0 };        ///< Trace generation << 32 | site table index + 1, 0 if unregistered.
+
+        /**
+         * @brief Constructs the site of a call (format strings are string literals).
+         */
+        template <std::size_t N>
+        constexpr trace_site(const char(&format)[N], const log_level level, const char* file, const std::uint32_t line,
+            const char* function) noexcept
+            : format(format, N - 1), file(file), function(function), line(line), level(level) {
+        }
+
+        trace_site(const trace_site&) = delete;
+        trace_site& operator=(const trace_site&) = delete;
+    };
+
+    /**
+     * @brief Process-wide binary trace writer (see binary_trace.h).
+     *
+     * start() maps a new trace file and enables tracing up to a log level, stop() disables
+     * tracing and flushes the file. Calls racing with stop() may still be writing to the
+     * mapped view, so stopped trace files stay mapped (and open) until the writer is
+     * destroyed at process exit.
+     */
+    class binary_trace {
+    public:
+        /// Default ring size: 1M records (64 MB).
+        static constexpr std::size_t default_record_capacity = std::size_t{ 1 } << 20;
+        /// Call sites that can be registered in a trace file.
+        static constexpr std::uint32_t site_capacity = 2048;
+
+        /**
+         * @brief Accessor for the singleton instance.
+         */
+        static binary_trace& instance() noexcept {
+            static binary_trace trace; // NOLINT(clang-diagnostic-exit-time-destructors)
+            return trace;
+        }
+
+        binary_trace(const binary_trace&) = delete;
+        binary_trace& operator=(const binary_trace&) = delete;
+        binary_trace(binary_trace&&) = delete;
+        binary_trace& operator=(binary_trace&&) = delete;
+
+        /**
+         * @brief Stops tracing and releases all trace files.
+         */
+        ~binary_trace() {
+            stop();
+        }
+
+        /**
+         * @brief Creates (or truncates) a trace file and starts tracing into it.
+         *
+         * A running trace is stopped first.
+         *
+         * @param path Trace file path.
+         * @param level Highest log level traced (log_level::debug traces everything below too).
+         * @param record_capacity Records kept in the ring (rounded up to a power of two, at least 1024).
+         * @return true if tracing started, false if the file could not be created or mapped.
+         */
+        bool start(const std::wstring& path, const log_level level = log_level::debug,
+            const std::size_t record_capacity = default_record_capacity) noexcept {
+            std::scoped_lock lock(control_lock_);
+
+            stop_locked();
+
+            try {
+                auto file = std::make_unique<mapping>();
+                if (!file->create(path, std::bit_ceil(std::max<std::size_t>(record_capacity, 1024)), ++generation_))
+                    return false;
+
+                active_.store(file.get(), std::memory_order_release);
+                files_.push_back(std::move(file));
+            }
+            catch (...) {
+                return false;
+            }
+
+            threshold_.store(static_cast<int>(level), std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Stops tracing and flushes the trace file to disk.
+         */
+        void stop() noexcept {
+            std::scoped_lock lock(control_lock_);
+            stop_locked();
+        }
+
+        /**
+         * @brief Returns true if calls of the given level are traced.
+         */
+        [[nodiscard]] bool is_enabled(const log_level level) const noexcept {
+            return static_cast<int>(level) <= threshold_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Returns the number of records written to the current trace file.
+         */
+        [[nodiscard]] std::uint64_t get_record_count() const noexcept {
+            const auto* const file = active_.load(std::memory_order_acquire);
+            return file != nullptr ? std::atomic_ref(file->header->head).load(std::memory_order_relaxed) : 0;
+        }
+
+        /**
+         * @brief Writes a trace record for a call.
+         *
+         * @param site The call site.
+         * @param args Arguments of the call.
+         * @return false if the call was not traced (tracing stopped, an argument type is not
+         *         traceable or the site table is full).
+         */
+        template <typename... Args>
+        bool emit(trace_site& site, const Args&... args) noexcept {
+            if constexpr (sizeof...(Args) > trace_format::max_args || !(traceable<std::decay_t<Args>> && ...)) {
+                return false;
+            }
+            else {
+                auto* const file = active_.load(std::memory_order_acquire);
+                if (file == nullptr)
+                    return false;
+
+                auto key = site.key.load(std::memory_order_acquire);
+                if ((key >> 32) != file->generation) [[unlikely]] {
+                    key = register_site(*file, site, { trace_arg<std::decay_t<Args>>::type... });
+                    if (key == 0)
+                        return false;
+                }
+
+                const auto ticket = std::atomic_ref(file->header->head).fetch_add(1, std::memory_order_relaxed);
+                auto& entry = file->records[ticket & file->record_mask];
+                const std::atomic_ref sequence(entry.sequence);
+
+                // Marks the record as being written for a decoder reading a crashed process' file
+                sequence.store(0, std::memory_order_relaxed);
+
+                LARGE_INTEGER counter;
+                QueryPerformanceCounter(&counter);
+
+                entry.timestamp = static_cast<std::uint64_t>(counter.QuadPart);
+                entry.site = static_cast<std::uint32_t>(key);
+                entry.thread_id = GetCurrentThreadId();
+
+                std::size_t size = 0;
+                std::uint8_t count = 0;
+                bool fits = true;
+
+                // Encodes the arguments in order until one does not fit
+                ([&] {
+                    if (!fits)
+                        return;
+
+                    const auto written = trace_arg<std::decay_t<Args>>::encode(args, entry.payload + size, sizeof(entry.payload) - size);
+                    if (written == 0) {
+                        fits = false;
+                        return;
+                    }
+
+                    size += written;
+                    ++count;
+                    }(), ...);
+
+                entry.arg_count = count;
+                entry.size = static_cast<std::uint8_t>(size);
+
+                sequence.store(ticket + 1, std::memory_order_release);
+                return true;
+            }
+        }
+
+    private:
+        /**
+         * @brief A mapped trace file.
+         */
+        struct mapping {
+            HANDLE file{ INVALID_HANDLE_VALUE };            ///< Trace file.
+            HANDLE section{ nullptr };                      ///< File mapping object.
+            void* view{ nullptr };                          ///< Mapped view of the whole file.
+            std::uint64_t view_size{ 0 };                   ///< Size of the view.
+            trace_format::file_header* header{ nullptr };   ///< File header.
+            trace_format::site_entry* sites{ nullptr };     ///< Site table.
+            trace_format::record* records{ nullptr };       ///< Record ring.
+            std::uint64_t record_mask{ 0 };                 ///< Ring size minus one.
+            std::uint32_t generation{ 0 };                  ///< Trace generation of the file.
+
+            mapping() = default;
+            mapping(const mapping&) = delete;
+            mapping& operator=(const mapping&) = delete;
+
+            ~mapping() {
+                if (view != nullptr)
+                    UnmapViewOfFile(view);
+
+                if (section != nullptr)
+                    CloseHandle(section);
+
+                if (file != INVALID_HANDLE_VALUE)
+                    CloseHandle(file);
+            }
+
+            /**
+             * @brief Creates the file, maps it and writes the header.
+             */
+            bool create(const std::wstring& path, const std::size_t record_capacity, const std::uint32_t trace_generation) noexcept {
+                const auto sites_offset = trace_format::header_size;
+                const auto records_offset = sites_offset + std::uint64_t{ site_capacity } * sizeof(trace_format::site_entry);
+                const auto size = records_offset + std::uint64_t{ record_capacity } * sizeof(trace_format::record);
+
+                file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                    FILE_ATTRIBUTE_NORMAL, nullptr);
+                if (file == INVALID_HANDLE_VALUE)
+                    return false;
+
+                // The mapping extends the file to its full size, the new pages read as zero
+                section = CreateFileMappingW(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32),
+                    static_cast<DWORD>(size), nullptr);
+                if (section == nullptr)
+                    return false;
+
+                view = MapViewOfFile(section, FILE_MAP_WRITE, 0, 0, static_cast<SIZE_T>(size));
+                if (view == nullptr)
+                    return false;
+
+                view_size = size;
+                generation = trace_generation;
+
+                auto* const base = static_cast<std::byte*>(view);
+                header = reinterpret_cast<trace_format::file_header*>(base);
+                sites = reinterpret_cast<trace_format::site_entry*>(base + sites_offset);
+                records = reinterpret_cast<trace_format::record*>(base + records_offset);
+                record_mask = record_capacity - 1;
+
+                LARGE_INTEGER frequency;
+                LARGE_INTEGER counter;
+                FILETIME now;
+                QueryPerformanceFrequency(&frequency);
+                QueryPerformanceCounter(&counter);
+                GetSystemTimePreciseAsFileTime(&now);
+
+                header->version = trace_format::version;
+                header->process_id = GetCurrentProcessId();
+                header->site_capacity = site_capacity;
+                header->sites_offset = sites_offset;
+                header->records_offset = records_offset;
+                header->record_capacity = record_capacity;
+                header->qpc_frequency = static_cast<std::uint64_t>(frequency.QuadPart);
+                header->start_qpc = static_cast<std::uint64_t>(counter.QuadPart);
+                header->start_time = (static_cast<std::uint64_t>(now.dwHighDateTime) << 32) | now.dwLowDateTime;
+
+                // The magic goes last, a file without it was not completely initialized
+                std::atomic_ref(header->magic).store(trace_format::magic, std::memory_order_release);
+                return true;
+            }
+        };
+
+        binary_trace() = default;
+
+        /**
+         * @brief Disables tracing and flushes the current file, keeping it mapped.
+         */
+        void stop_locked() noexcept {
+            threshold_.store(-1, std::memory_order_release);
+
+            if (auto* const file = active_.exchange(nullptr, std::memory_order_acq_rel); file != nullptr) {
+                FlushViewOfFile(file->view, 0);
+                FlushFileBuffers(file->file);
+            }
+        }
+
+        /**
+         * @brief Adds a call site to the site table of a trace file.
+         * @return The site key, or 0 if the site table is full.
+         */
+        std::uint64_t register_site(mapping& file, trace_site& site,
+            const std::initializer_list<trace_format::arg_type> arg_types) noexcept {
+            std::scoped_lock lock(sites_lock_);
+
+            // Another thread may have registered the site while this one was waiting for the lock
+            if (const auto key = site.key.load(std::memory_order_acquire); (key >> 32) == file.generation)
+                return key;
+
+            const std::atomic_ref site_count(file.header->site_count);
+            const auto index = site_count.load(std::memory_order_relaxed);
+            if (index == site_capacity)
+                return 0;
+
+            auto& entry = file.sites[index];
+            entry.level = static_cast<std::uint8_t>(site.level);
+            entry.arg_count = static_cast<std::uint8_t>(arg_types.size());
+            std::ranges::transform(arg_types, entry.arg_types, [](const auto type) { return static_cast<std::uint8_t>(type); });
+            copy_string(entry.file, site.file);
+            copy_string(entry.function, site.function);
+            copy_string(entry.format, site.format);
+
+            // The line goes last, it marks the entry valid
+            std::atomic_ref(entry.line).store(std::max<std::uint32_t>(site.line, 1), std::memory_order_release);
+            site_count.store(index + 1, std::memory_order_release);
+
+            const auto key = (std::uint64_t{ file.generation } << 32) | (index + 1);
+            site.key.store(key, std::memory_order_release);
+            return key;
+        }
+
+        /**
+         * @brief Copies a string into a fixed-size NUL-terminated field, truncating it.
+         */
+        template <std::size_t N>
+        static void copy_string(char(&out)[N], const std::string_view value) noexcept {
+            const auto length = std::min(value.size(), N - 1);
+            std::memcpy(out, value.data(), length);
+            out[length] = '\0';
+        }
+
+        std::atomic<int> threshold_{ -1 };                          ///< Highest traced log_level, -1 while stopped.
+        std::atomic<mapping*> active_{ nullptr };                   ///< File being traced into.
+        std::mutex control_lock_;                                   ///< Serializes start() and stop().
+        std::mutex sites_lock_;                                     ///< Serializes site registration.
+        std::vector<std::unique_ptr<mapping>> files_;               ///< All files mapped so far.
+        std::uint32_t generation_{ 0 };                             ///< Generation of the latest file.
+    };
+}
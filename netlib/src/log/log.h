@@ -14,6 +14,17 @@
 #include <cstdint>
 #include <iomanip>
 #include <iterator>
+#include <array>
+#include <vector>
+#include <mutex>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+
+#include "../tools/spsc_ring.h"
 
 #if __has_include(<source_location>) && defined(__cpp_lib_source_location) && __cpp_lib_source_location >= 201907L
 #include <source_location>
@@ -44,6 +55,7 @@
  * - Performance-optimized string formatting with pre-allocation
  * - Multi-level fallback strategies for maximum reliability
  * - Global verbosity control for runtime output customization
+ * - Optional asynchronous backend that moves formatting and stream writes off the calling thread
  *
  * ## Source Location Architecture:
  * The logger implements a sophisticated source location capture system:
@@ -310,6 +322,807 @@ namespace netlib::log {
         return static_cast<std::uint8_t>(configured) >= static_cast<std::uint8_t>(msg);
     }
 
+    namespace detail {
+
+        /**
+         * @brief Generate a compact, readable thread ID for log output.
+         *
+         * This function creates a 24-bit hash of the current thread ID to provide
+         * a compact, hexadecimal representation that's more readable than the full
+         * thread ID while maintaining reasonable uniqueness within a process.
+         *
+         * @return uint32_t containing the lower 24 bits of the thread ID hash.
+         * @note Uses std::hash for consistent hashing across platforms.
+         * @note Returns only the lower 24 bits (6 hex digits) for readability.
+         */
+        [[nodiscard]] inline std::uint32_t compact_thread_id() noexcept {
+            return static_cast<std::uint32_t>(
+                std::hash<std::thread::id>{}(std::this_thread::get_id()) & 0xFFFFFF
+                );
+        }
+
+        /**
+         * @brief Formats a message into a string, never throwing.
+         *
+         * @param out String receiving the formatted message (appended to).
+         * @param fmt Format string compatible with std::format.
+         * @param args Arguments for format string substitution.
+         *
+         * @note On a formatting error the message is replaced by a "[formatting failed]" note.
+         */
+        template <typename... Args>
+        void format_message(std::string& out, std::format_string<Args...> fmt, Args&&... args) noexcept {
+            try {
+                // Estimate buffer size for optimal performance
+                const auto estimated_size = std::max<size_t>(128, fmt.get().size() * 2);
+                out.reserve(estimated_size);
+                std::format_to(std::back_inserter(out), fmt, std::forward<Args>(args)...);
+            }
+            catch (const std::exception& e) {
+                // Fallback for format errors - avoid recursive format calls
+                try {
+                    out.clear();
+                    out += "[formatting failed] ";
+                    out += e.what();
+                }
+                catch (...) {
+                    out.clear();
+                }
+            }
+            catch (...) {
+                // Ultimate fallback for unknown exceptions
+                try {
+                    out = "[formatting failed] unknown error";
+                }
+                catch (...) {
+                    out.clear();
+                }
+            }
+        }
+
+        /**
+         * @brief Appends a complete log line to a string, honoring the global verbosity settings.
+         *
+         * Used by both the synchronous path of logger and the asynchronous backend, so the
+         * output format is the same whichever writes the entry.
+         *
+         * ## Timestamp Handling:
+         * - Attempts local time via std::chrono::zoned_time and current_zone()
+         * - Falls back to UTC with 'Z' suffix if time zone database unavailable
+         * - Uses millisecond precision for high-resolution timing in ISO-8601 format
+         * - Caches time zone pointer for performance (stable across calls)
+         *
+         * @param out String receiving the line (appended to, including the trailing newline).
+         * @param level The log level of the message.
+         * @param time Time the message was logged.
+         * @param thread_id Compact ID of the logging thread (see compact_thread_id()).
+         * @param logger_name Name of the logger.
+         * @param message The formatted message content.
+         * @param loc Source location information (conditionally compiled).
+         *
+         * @throws std::bad_alloc if memory is exhausted.
+         */
+        inline void append_log_entry(std::string& out,
+            const log_level level,
+            const std::chrono::system_clock::time_point time,
+            const std::uint32_t thread_id,
+            const std::string_view logger_name,
+            const std::string_view message
+#if NETLIB_HAS_SOURCE_LOCATION
+            , const std::source_location& loc
+#endif
+        ) {
+            const auto verbosity = get_global_log_verbosity();
+            const auto inserter = std::back_inserter(out);
+            bool first_component = true;
+
+            // Helper to add component separator
+            auto add_separator = [&]() {
+                if (!first_component) out += ' ';
+                first_component = false;
+                };
+
+            // Conditionally include log level
+            if (has_verbosity_flag(verbosity, log_verbosity::level)) {
+                add_separator();
+                out += '[';
+                out += to_string(level);
+                out += ']';
+            }
+
+            // Conditionally include timestamp
+            if (has_verbosity_flag(verbosity, log_verbosity::timestamp)) {
+                add_separator();
+
+                using std::chrono::floor;
+                const auto tp_s = floor<std::chrono::seconds>(time);
+                const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    time.time_since_epoch()) % 1000;
+
+                try {
+                    // Cache the time zone pointer for performance (pointer is stable)
+                    static const std::chrono::time_zone* zone = std::chrono::current_zone();
+                    std::chrono::zoned_time zt{ zone, tp_s };
+                    std::format_to(inserter, "{:%Y-%m-%dT%H:%M:%S}.{:03}", zt, static_cast<int>(ms.count()));
+                }
+                catch (const std::bad_alloc&) {
+                    throw;
+                }
+                catch (...) {
+                    // Fallback: UTC with 'Z' suffix to clearly indicate time zone
+                    std::format_to(inserter, "{:%Y-%m-%dT%H:%M:%S}.{:03}Z", tp_s, static_cast<int>(ms.count()));
+                }
+            }
+
+            // Conditionally include thread ID
+            if (has_verbosity_flag(verbosity, log_verbosity::thread)) {
+                add_separator();
+                std::format_to(inserter, "[T {:06X}]", thread_id);
+            }
+
+            // Conditionally include logger name
+            if (has_verbosity_flag(verbosity, log_verbosity::logger)) {
+                add_separator();
+                out += '[';
+                out += logger_name;
+                out += ']';
+            }
+
+#if NETLIB_HAS_SOURCE_LOCATION
+            // Conditionally include source location
+            if (has_verbosity_flag(verbosity, log_verbosity::path)) {
+                add_separator();
+                const auto filename = std::string_view{ loc.file_name() };
+                const auto pos = filename.find_last_of("/\\");
+                const auto basename = (pos == std::string_view::npos) ? filename
+                    : filename.substr(pos + 1);
+                std::format_to(inserter, "[{}:{}:{}]", basename, loc.line(), loc.function_name());
+            }
+#endif
+
+            // Always add the message
+            if (!first_component) out += ' ';
+            out += message;
+            out += '\n';
+        }
+    }
+
+    /**
+     * @brief Process-wide asynchronous writer for logger output.
+     *
+     * While the backend is running, loggers neither format nor write on the calling thread. A
+     * message is captured into a record of the calling thread's own single-producer ring, and
+     * one background thread drains the rings, formats the records and writes them out in
+     * batches: a single synchronized write per batch and stream instead of one per message.
+     *
+     * ## Argument Capture:
+     * - Plain value arguments (trivially copyable, not pointers or string views) are copied into
+     *   the record as they are and formatted by the writer thread, e.g. addresses and ports
+     * - Any other argument (strings, C strings, views) could change or go away before the
+     *   writer gets to it, so for such argument lists the message is formatted on the calling
+     *   thread and only the stream write is deferred
+     *
+     * ## Overload Handling:
+     * A full ring drops the message instead of waiting and counts it; the writer reports the
+     * number of dropped messages in the log. Submitting a message costs a ring push and, only
+     * while the writer is idle, a wake-up of the writer.
+     *
+     * ## Ordering:
+     * Messages of one thread are written in order. Messages of different threads may be
+     * interleaved out of order, each line carries the timestamp of its submission.
+     *
+     * While the backend is stopped loggers use the synchronous path. Rings are registered on
+     * the first message of a thread and released by the writer once the thread has exited and
+     * its ring is drained.
+     *
+     * @note Messages submitted concurrently with stop() may stay in their ring until the
+     *       backend is started again.
+     */
+    class async_log_backend {
+    public:
+        /// Records per thread ring.
+        static constexpr std::size_t ring_capacity = 512;
+        /// Bytes of captured argument values per record.
+        static constexpr std::size_t payload_size = 128;
+
+        /**
+         * @brief True for argument types that are captured by value and formatted by the writer.
+         */
+        template <typename T>
+        static constexpr bool is_deferrable =
+            std::is_trivially_copyable_v<T> &&
+            !std::is_pointer_v<T> &&
+            !std::is_member_pointer_v<T> &&
+            !std::is_same_v<T, std::string_view> &&
+            alignof(T) <= alignof(std::max_align_t);
+
+        /**
+         * @brief Accessor for the singleton instance.
+         */
+        static async_log_backend& instance() noexcept {
+            static async_log_backend backend; // NOLINT(clang-diagnostic-exit-time-destructors)
+            return backend;
+        }
+
+        async_log_backend(const async_log_backend&) = delete;
+        async_log_backend& operator=(const async_log_backend&) = delete;
+        async_log_backend(async_log_backend&&) = delete;
+        async_log_backend& operator=(async_log_backend&&) = delete;
+
+        /**
+         * @brief Stops the writer thread, writing out the queued messages.
+         */
+        ~async_log_backend() {
+            stop();
+        }
+
+        /**
+         * @brief Starts the writer thread, routing all loggers through the backend.
+         * @return true if the backend is running, false if the thread could not be created.
+         */
+        bool start() noexcept {
+            std::scoped_lock lock(control_lock_);
+
+            if (writer_.joinable())
+                return true;
+
+            running_.store(true, std::memory_order_seq_cst);
+
+            try {
+                writer_ = std::thread(&async_log_backend::run, this);
+            }
+            catch (...) {
+                running_.store(false, std::memory_order_seq_cst);
+                return false;
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Writes out the queued messages and stops the writer thread.
+         *
+         * Loggers return to the synchronous path. Safe to call when not running.
+         */
+        void stop() noexcept {
+            std::scoped_lock lock(control_lock_);
+
+            if (!writer_.joinable())
+                return;
+
+            running_.store(false, std::memory_order_seq_cst);
+            wake_writer();
+            writer_.join();
+        }
+
+        /**
+         * @brief Returns true while messages are routed through the backend.
+         */
+        [[nodiscard]] bool is_running() const noexcept {
+            return running_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Returns the number of messages dropped because a ring was full.
+         */
+        [[nodiscard]] std::uint64_t get_dropped_count() const noexcept {
+            return dropped_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Returns the number of messages written by the backend.
+         */
+        [[nodiscard]] std::uint64_t get_written_count() const noexcept {
+            return written_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Queues a formatted message for the writer thread.
+         *
+         * @param level The log level of the message.
+         * @param logger_name Name of the logger (must have static storage duration).
+         * @param stream Output stream for the message.
+         * @param loc Source location information (conditionally compiled).
+         * @param fmt Format string compatible with std::format (must have static storage duration).
+         * @param args Arguments for format string substitution.
+         */
+        template <typename... Args>
+        void submit(const log_level level,
+            const std::string_view logger_name,
+            std::shared_ptr<std::ostream> stream,
+#if NETLIB_HAS_SOURCE_LOCATION
+            const std::source_location& loc,
+#endif
+            std::format_string<Args...> fmt,
+            Args&&... args) noexcept
+        {
+            auto* const ring = local_ring();
+            if (ring == nullptr) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            record entry;
+            entry.stream = std::move(stream);
+            entry.time = std::chrono::system_clock::now();
+            entry.logger_name = logger_name;
+            entry.thread_id = detail::compact_thread_id();
+            entry.level = level;
+#if NETLIB_HAS_SOURCE_LOCATION
+            entry.location = loc;
+#endif
+
+            if constexpr ((is_deferrable<std::decay_t<Args>> && ...) &&
+                layout<std::decay_t<Args>...>::size <= payload_size) {
+                capture(entry, std::index_sequence_for<Args...>{}, args...);
+                entry.format = fmt.get();
+                entry.render = &render<std::decay_t<Args>...>;
+            }
+            else {
+                detail::format_message(entry.text, fmt, std::forward<Args>(args)...);
+            }
+
+            push(*ring, std::move(entry));
+        }
+
+        /**
+         * @brief Queues a pre-formatted message for the writer thread.
+         *
+         * @param level The log level of the message.
+         * @param logger_name Name of the logger (must have static storage duration).
+         * @param stream Output stream for the message.
+         * @param message The message (copied).
+         * @param loc Source location information (conditionally compiled).
+         */
+        void submit(const log_level level,
+            const std::string_view logger_name,
+            std::shared_ptr<std::ostream> stream,
+            const std::string_view message
+#if NETLIB_HAS_SOURCE_LOCATION
+            , const std::source_location& loc
+#endif
+        ) noexcept
+        {
+            auto* const ring = local_ring();
+            if (ring == nullptr) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            record entry;
+
+            try {
+                entry.text.assign(message);
+            }
+            catch (...) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            entry.stream = std::move(stream);
+            entry.time = std::chrono::system_clock::now();
+            entry.logger_name = logger_name;
+            entry.thread_id = detail::compact_thread_id();
+            entry.level = level;
+#if NETLIB_HAS_SOURCE_LOCATION
+            entry.location = loc;
+#endif
+
+            push(*ring, std::move(entry));
+        }
+
+    private:
+        /// Records drained from one ring before moving on to the next.
+        static constexpr std::size_t drain_batch = 64;
+        /// Batch size that triggers a write before the drain pass completes.
+        static constexpr std::size_t flush_threshold = 64 * 1024;
+
+        /**
+         * @brief A queued message.
+         */
+        struct record {
+            /// Formats the captured argument values: render(out, format, payload).
+            using render_function = void (*)(std::string&, std::string_view, const std::byte*);
+
+            std::shared_ptr<std::ostream> stream;                 ///< Output stream.
+            std::chrono::system_clock::time_point time{};         ///< Submission time.
+            std::string_view logger_name;                         ///< Name of the logger.
+            std::string_view format;                              ///< Format string, if render is set.
+            render_function render{ nullptr };                    ///< Argument formatter, nullptr if text holds the message.
+            std::string text;                                     ///< Message formatted by the caller.
+#if NETLIB_HAS_SOURCE_LOCATION
+            std::source_location location;                        ///< Call site.
+#endif
+            std::uint32_t thread_id{ 0 };                         ///< Compact ID of the logging thread.
+            log_level level{ log_level::error };                  ///< Message level.
+            alignas(std::max_align_t) std::array<std::byte, payload_size> payload{}; ///< Captured argument values.
+        };
+
+        using ring_type = tools::concurrency::spsc_ring<record, ring_capacity>;
+
+        /**
+         * @brief Placement of captured argument values in the record payload.
+         */
+        template <typename... D>
+        struct layout {
+            static constexpr std::size_t align_up(const std::size_t offset, const std::size_t alignment) noexcept {
+                return (offset + alignment - 1) / alignment * alignment;
+            }
+
+            static constexpr std::array<std::size_t, sizeof...(D)> offsets = [] {
+                std::array<std::size_t, sizeof...(D)> result{};
+                [[maybe_unused]] std::size_t offset = 0;
+                [[maybe_unused]] std::size_t index = 0;
+                ((offset = align_up(offset, alignof(D)), result[index++] = offset, offset += sizeof(D)), ...);
+                return result;
+                }();
+
+            static constexpr std::size_t size = [] {
+                std::size_t offset = 0;
+                ((offset = align_up(offset, alignof(D)) + sizeof(D)), ...);
+                return offset;
+                }();
+        };
+
+        async_log_backend() = default;
+
+        /**
+         * @brief Copies the argument values into the record payload.
+         */
+        template <std::size_t... I, typename... Args>
+        static void capture(record& entry, std::index_sequence<I...>, const Args&... args) noexcept {
+            using values = layout<std::decay_t<Args>...>;
+            (std::memcpy(entry.payload.data() + values::offsets[I], std::addressof(args), sizeof(std::decay_t<Args>)), ...);
+        }
+
+        /**
+         * @brief Formats argument values captured by capture() (writer thread).
+         */
+        template <typename... D>
+        static void render(std::string& out, const std::string_view format, const std::byte* payload) {
+            render_values<D...>(out, format, payload, std::index_sequence_for<D...>{});
+        }
+
+        template <typename... D, std::size_t... I>
+        static void render_values(std::string& out, const std::string_view format, const std::byte* payload, std::index_sequence<I...>) {
+            using values = layout<D...>;
+
+            // Copying into local storage starts the lifetime of the (trivially copyable) values
+            alignas(std::max_align_t) std::byte storage[payload_size];
+            std::memcpy(storage, payload, values::size);
+
+            std::vformat_to(std::back_inserter(out), format,
+                std::make_format_args(*std::launder(reinterpret_cast<D*>(storage + values::offsets[I]))...));
+        }
+
+        /**
+         * @brief Returns the ring of the calling thread, registering it on first use.
+         * @return The ring, or nullptr if memory is exhausted.
+         */
+        ring_type* local_ring() noexcept {
+            thread_local std::shared_ptr<ring_type> ring;
+
+            if (!ring) [[unlikely]] {
+                try {
+                    auto created = std::make_shared<ring_type>();
+                    std::scoped_lock lock(rings_lock_);
+                    rings_.push_back(created);
+                    rings_generation_.fetch_add(1, std::memory_order_release);
+                    ring = std::move(created);
+                }
+                catch (...) {
+                    return nullptr;
+                }
+            }
+
+            return ring.get();
+        }
+
+        /**
+         * @brief Pushes a record into the ring of the calling thread, waking an idle writer.
+         */
+        void push(ring_type& ring, record&& entry) noexcept {
+            if (!ring.try_push(std::move(entry))) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            // The ring's tail store is seq_cst, so either the writer sees the record before it
+            // parks or this load sees the writer parked
+            if (writer_parked_.load(std::memory_order_seq_cst))
+                wake_writer();
+        }
+
+        /**
+         * @brief Wakes the writer thread if it is parked.
+         */
+        void wake_writer() noexcept {
+            signal_.fetch_add(1, std::memory_order_release);
+            signal_.notify_one();
+        }
+
+        /**
+         * @brief Writer thread: drains the rings until stopped and they are empty.
+         */
+        void run() noexcept {
+            std::vector<ring_type*> rings;
+            std::size_t generation = ~std::size_t{ 0 };
+
+            for (;;) {
+                const auto signal = signal_.load(std::memory_order_acquire);
+
+                if (rings_generation_.load(std::memory_order_acquire) != generation)
+                    refresh_rings(rings, generation);
+
+                if (drain(rings) != 0)
+                    continue;
+
+                if (!running_.load(std::memory_order_seq_cst))
+                    break;
+
+                // Idle: let rings of exited threads go before parking
+                collect_rings(rings);
+
+                writer_parked_.store(true, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                if (running_.load(std::memory_order_seq_cst) &&
+                    rings_generation_.load(std::memory_order_acquire) == generation &&
+                    std::ranges::all_of(rings, [](const ring_type* ring) { return ring->empty(); })) {
+                    signal_.wait(signal, std::memory_order_acquire);
+                }
+
+                writer_parked_.store(false, std::memory_order_relaxed);
+            }
+
+            stream_.reset();
+        }
+
+        /**
+         * @brief Copies the ring registry into the writer's snapshot.
+         *
+         * On allocation failure the previous snapshot is kept and the copy is retried later.
+         */
+        void refresh_rings(std::vector<ring_type*>& rings, std::size_t& generation) noexcept {
+            try {
+                std::scoped_lock lock(rings_lock_);
+
+                std::vector<ring_type*> snapshot;
+                snapshot.reserve(rings_.size());
+
+                for (const auto& ring : rings_)
+                    snapshot.push_back(ring.get());
+
+                rings.swap(snapshot);
+                generation = rings_generation_.load(std::memory_order_relaxed);
+            }
+            catch (...) {
+                // Rings registered since the last copy are picked up on a later pass
+            }
+        }
+
+        /**
+         * @brief Releases the drained rings of exited threads, removing them from the snapshot too.
+         */
+        void collect_rings(std::vector<ring_type*>& rings) noexcept {
+            std::scoped_lock lock(rings_lock_);
+
+            // A use count of one means the owning thread (and its thread_local reference) is gone
+            const auto released = std::erase_if(rings_, [&rings](const std::shared_ptr<ring_type>& ring) {
+                if (ring.use_count() != 1 || !ring->empty())
+                    return false;
+
+                std::erase(rings, ring.get());
+                return true;
+                });
+
+            if (released != 0)
+                rings_generation_.fetch_add(1, std::memory_order_release);
+        }
+
+        /**
+         * @brief Formats and writes out up to drain_batch records of every ring.
+         * @return Number of records written.
+         */
+        std::size_t drain(const std::vector<ring_type*>& rings) noexcept {
+            std::size_t written = 0;
+
+            for (auto* const ring : rings) {
+                for (std::size_t i = 0; i < drain_batch; ++i) {
+                    auto entry = ring->try_pop();
+                    if (!entry)
+                        break;
+
+                    append(*entry);
+                    ++written;
+                }
+            }
+
+            report_dropped();
+            flush();
+
+            written_.fetch_add(written, std::memory_order_relaxed);
+            return written;
+        }
+
+        /**
+         * @brief Formats a record into the pending batch.
+         */
+        void append(record& entry) noexcept {
+            if (entry.stream != stream_) {
+                flush();
+                stream_ = std::move(entry.stream);
+            }
+
+            try {
+                std::string_view message = entry.text;
+
+                if (entry.render != nullptr) {
+                    message_.clear();
+
+                    try {
+                        entry.render(message_, entry.format, entry.payload.data());
+                    }
+                    catch (const std::bad_alloc&) {
+                        throw;
+                    }
+                    catch (const std::exception& e) {
+                        message_ = "[formatting failed] ";
+                        message_ += e.what();
+                    }
+
+                    message = message_;
+                }
+
+                detail::append_log_entry(batch_, entry.level, entry.time, entry.thread_id, entry.logger_name, message
+#if NETLIB_HAS_SOURCE_LOCATION
+                    , entry.location
+#endif
+                );
+            }
+            catch (...) {
+                // Out of memory: the message is lost
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            if (batch_.size() >= flush_threshold)
+                flush();
+        }
+
+        /**
+         * @brief Appends a note about messages dropped since the last report to the pending batch.
+         */
+        void report_dropped() noexcept {
+            const auto dropped = dropped_.load(std::memory_order_relaxed);
+            if (dropped == reported_dropped_ || !stream_)
+                return;
+
+            try {
+                detail::append_log_entry(batch_, log_level::warning, std::chrono::system_clock::now(),
+                    detail::compact_thread_id(), "async_log_backend",
+                    std::format("{} log messages dropped, the log writer could not keep up", dropped - reported_dropped_)
+#if NETLIB_HAS_SOURCE_LOCATION
+                    , std::source_location::current()
+#endif
+                );
+
+                reported_dropped_ = dropped;
+            }
+            catch (...) {
+                // Reported with the next batch
+            }
+        }
+
+        /**
+         * @brief Writes the pending batch to its stream in one synchronized write.
+         */
+        void flush() noexcept {
+            if (!batch_.empty() && stream_) {
+                try {
+                    std::osyncstream out{ *stream_ };
+                    out.write(batch_.data(), static_cast<std::streamsize>(batch_.size()));
+                    out.emit();
+                    stream_->flush();
+                }
+                catch (...) {
+                    // Ignore write errors - logging should not crash the application
+                }
+            }
+
+            batch_.clear();
+        }
+
+        std::mutex control_lock_;                                 ///< Serializes start() and stop().
+        std::thread writer_;                                      ///< Writer thread.
+        std::atomic_bool running_{ false };                       ///< Set while loggers submit to the backend.
+
+        std::mutex rings_lock_;                                   ///< Guards rings_.
+        std::vector<std::shared_ptr<ring_type>> rings_;           ///< Rings of all threads that logged.
+        std::atomic<std::size_t> rings_generation_{ 0 };          ///< Bumped on every change of rings_.
+
+        alignas(tools::concurrency::cache_line_size) std::atomic<std::uint32_t> signal_{ 0 }; ///< Wake-up word the writer parks on.
+        std::atomic_bool writer_parked_{ false };                 ///< Set while the writer is (about to be) parked.
+
+        alignas(tools::concurrency::cache_line_size) std::atomic<std::uint64_t> dropped_{ 0 }; ///< Messages dropped.
+        std::atomic<std::uint64_t> written_{ 0 };                 ///< Messages written.
+
+        // Writer thread state
+        alignas(tools::concurrency::cache_line_size) std::shared_ptr<std::ostream> stream_; ///< Stream of the pending batch.
+        std::string batch_;                                       ///< Pending batch.
+        std::string message_;                                     ///< Scratch buffer for rendered messages.
+        std::uint64_t reported_dropped_{ 0 };                     ///< Value of dropped_ at the last report.
+    };
+
+    /**
+     * @brief Token bucket bounding the rate of a log statement.
+     *
+     * Lets through bursts of up to `burst` messages and, sustained, `per_second` messages per
+     * second; the rest are counted as suppressed. Implemented as a generic cell rate algorithm
+     * on a single atomic (the theoretical arrival time of the next message), so a check costs a
+     * clock read and one compare-exchange, or an increment of the suppressed counter when the
+     * bucket is empty, regardless of the message rate.
+     *
+     * Used by NETLIB_LOG_THROTTLED, which keeps one limiter per call site.
+     */
+    class log_rate_limiter {
+    public:
+        /**
+         * @brief Constructs a full bucket.
+         * @param per_second Sustained messages per second, 0 suppresses all messages.
+         * @param burst Messages let through back to back by a full bucket.
+         */
+        constexpr log_rate_limiter(const std::uint32_t per_second, const std::uint32_t burst) noexcept
+            : interval_(per_second != 0 ? 1'000'000'000 / static_cast<std::int64_t>(per_second) : 0),
+              tolerance_(interval_ * (burst > 1 ? static_cast<std::int64_t>(burst) - 1 : 0)),
+              enabled_(per_second != 0 && burst != 0) {
+        }
+
+        /**
+         * @brief Takes a token if one is available.
+         * @return true if the message may be logged, false if it is suppressed.
+         */
+        bool try_acquire() noexcept {
+            if (!enabled_) {
+                suppressed_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            const auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+            auto arrival = next_arrival_.load(std::memory_order_relaxed);
+
+            while (true) {
+                const auto base = std::max(arrival, now);
+
+                if (base - now > tolerance_) {
+                    suppressed_.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                if (next_arrival_.compare_exchange_weak(arrival, base + interval_, std::memory_order_relaxed))
+                    return true;
+            }
+        }
+
+        /**
+         * @brief Returns the number of messages suppressed since the previous call and resets it.
+         */
+        std::uint64_t take_suppressed() noexcept {
+            // Plain load first: the counter is zero unless the bucket has run empty
+            if (suppressed_.load(std::memory_order_relaxed) == 0)
+                return 0;
+
+            return suppressed_.exchange(0, std::memory_order_relaxed);
+        }
+
+    private:
+        const std::int64_t interval_;                       ///< Nanoseconds per token.
+        const std::int64_t tolerance_;                      ///< Nanoseconds of burst allowance.
+        const bool enabled_;                                ///< false if the bucket never fills.
+        std::atomic<std::int64_t> next_arrival_{ 0 };       ///< steady_clock nanoseconds at which the bucket is full again.
+        std::atomic<std::uint64_t> suppressed_{ 0 };        ///< Messages suppressed since take_suppressed().
+    };
+
     /**
      * @brief Base logger class template for thread-safe logging using CRTP pattern.
      *
@@ -351,6 +1164,10 @@ namespace netlib::log {
      * - Individual component enable/disable (timestamp, thread, logger, path, level)
      * - Dynamic reconfiguration without recompilation
      *
+     * ### Asynchronous Output:
+     * - While async_log_backend is running, messages are queued to its writer thread
+     *   instead of being formatted and written on the calling thread
+     *
      * ## Output Format Examples:
      *
      * Full verbosity: `[info] 2024-08-10T14:30:25.123 [T A1B2C3] [Logger] [file:line:func] Message`
@@ -422,24 +1239,6 @@ namespace netlib::log {
             }
         }
 
-        /**
-         * @brief Generate a compact, readable thread ID for log output.
-         *
-         * This function creates a 24-bit hash of the current thread ID to provide
-         * a compact, hexadecimal representation that's more readable than the full
-         * thread ID while maintaining reasonable uniqueness within a process.
-         *
-         * @return uint32_t containing the lower 24 bits of the thread ID hash.
-         * @note Uses std::hash for consistent hashing across platforms.
-         * @note Returns only the lower 24 bits (6 hex digits) for readability.
-         * @note [[nodiscard]] attribute prevents accidental unused calls.
-         */
-        [[nodiscard]] static std::uint32_t compact_thread_id() noexcept {
-            return static_cast<std::uint32_t>(
-                std::hash<std::thread::id>{}(std::this_thread::get_id()) & 0xFFFFFF
-                );
-        }
-
         /**
          * @brief Private constructor to enforce CRTP pattern and prevent direct instantiation.
          *
@@ -674,6 +1473,15 @@ namespace netlib::log {
             const auto stream = log_stream_;
             if (!stream || !is_enabled(log_level_.load(std::memory_order_relaxed), level)) return;
 
+            if (auto& backend = async_log_backend::instance(); backend.is_running()) {
+                backend.submit(level, derived_name(), stream, message
+#if NETLIB_HAS_SOURCE_LOCATION
+                    , loc
+#endif
+                );
+                return;
+            }
+
             // Direct delegation without format processing
             emit_log_entry(level, message, *stream
 #if NETLIB_HAS_SOURCE_LOCATION
@@ -778,28 +1586,19 @@ namespace netlib::log {
             std::format_string<Args...> fmt,
             Args&&... args) const noexcept
         {
-            const auto stream = log_stream_;
+            auto stream = log_stream_;
             if (!stream || !is_enabled(log_level_.load(std::memory_order_relaxed), level))
                 return;
 
-            std::string message;
-            try {
-                // Estimate buffer size for optimal performance
-                const auto estimated_size = std::max<size_t>(128, fmt.get().size() * 2);
-                message.reserve(estimated_size);
-                std::format_to(std::back_inserter(message), fmt, std::forward<Args>(args)...);
-            }
-            catch (const std::exception& e) {
-                // Fallback for format errors - avoid recursive format calls
-                message.clear();
-                message += "[formatting failed] ";
-                message += e.what();
-            }
-            catch (...) {
-                // Ultimate fallback for unknown exceptions
-                message = "[formatting failed] unknown error";
+            // Hand the message to the writer thread, capturing rather than formatting it
+            if (auto& backend = async_log_backend::instance(); backend.is_running()) {
+                backend.submit(level, derived_name(), std::move(stream), loc, fmt, std::forward<Args>(args)...);
+                return;
             }
 
+            std::string message;
+            detail::format_message(message, fmt, std::forward<Args>(args)...);
+
             // Delegate to the core output function with captured location
             emit_log_entry(level, message, *stream, loc);
         }
@@ -827,28 +1626,19 @@ namespace netlib::log {
             std::format_string<Args...> fmt,
             Args&&... args) const noexcept
         {
-            const auto stream = log_stream_;
+            auto stream = log_stream_;
             if (!stream || !is_enabled(log_level_.load(std::memory_order_relaxed), level))
                 return;
 
-            std::string message;
-            try {
-                // Estimate buffer size for optimal performance
-                const auto estimated_size = std::max<size_t>(128, fmt.get().size() * 2);
-                message.reserve(estimated_size);
-                std::format_to(std::back_inserter(message), fmt, std::forward<Args>(args)...);
-            }
-            catch (const std::exception& e) {
-                // Fallback for format errors - avoid recursive format calls
-                message.clear();
-                message += "[formatting failed] ";
-                message += e.what();
-            }
-            catch (...) {
-                // Ultimate fallback for unknown exceptions
-                message = "[formatting failed] unknown error";
+            // Hand the message to the writer thread, capturing rather than formatting it
+            if (auto& backend = async_log_backend::instance(); backend.is_running()) {
+                backend.submit(level, derived_name(), std::move(stream), fmt, std::forward<Args>(args)...);
+                return;
             }
 
+            std::string message;
+            detail::format_message(message, fmt, std::forward<Args>(args)...);
+
             // Delegate to the core output function without location
             emit_log_entry(level, message, *stream);
         }
@@ -862,18 +1652,8 @@ namespace netlib::log {
          * like timestamps, thread IDs, logger names, log levels, and source location
          * can be selectively enabled or disabled based on the current verbosity configuration.
          *
-         * ## Source Location Processing:
-         * When NETLIB_HAS_SOURCE_LOCATION is enabled, this function:
-         * - Safely extracts basename from full file paths using find_last_of()
-         * - Handles edge cases where no path separators exist
-         * - Includes function name and line number for enhanced debugging
-         * - Gracefully compiles without source location when not available
-         *
-         * ## Timestamp Handling:
-         * - Attempts local time via std::chrono::zoned_time and current_zone()
-         * - Falls back to UTC with 'Z' suffix if time zone database unavailable
-         * - Uses millisecond precision for high-resolution timing in ISO-8601 format
-         * - Caches time zone pointer for performance (stable across calls)
+         * The line itself is built by detail::append_log_entry(), shared with the
+         * asynchronous backend, and written with a single osyncstream emit.
          *
          * ## Error Recovery Strategy:
          * - Primary: Modern chrono formatting with local time
@@ -902,70 +1682,15 @@ namespace netlib::log {
             std::osyncstream out{ stream };
 
             try {
-                const auto verbosity = get_global_log_verbosity();
-                bool first_component = true;
-
-                // Helper to add component separator
-                auto add_separator = [&]() {
-                    if (!first_component) out << ' ';
-                    first_component = false;
-                    };
-
-                // Conditionally include log level
-                if (has_verbosity_flag(verbosity, log_verbosity::level)) {
-                    add_separator();
-                    out << '[' << to_string(level) << ']';
-                }
-
-                // Conditionally include timestamp
-                if (has_verbosity_flag(verbosity, log_verbosity::timestamp)) {
-                    add_separator();
-
-                    using std::chrono::floor;
-                    const auto now = std::chrono::system_clock::now();
-                    const auto tp_s = floor<std::chrono::seconds>(now);
-                    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        now.time_since_epoch()) % 1000;
-
-                    try {
-                        // Cache the time zone pointer for performance (pointer is stable)
-                        static const std::chrono::time_zone* zone = std::chrono::current_zone();
-                        std::chrono::zoned_time zt{ zone, tp_s };
-                        out << std::format("{:%Y-%m-%dT%H:%M:%S}.{:03}", zt, static_cast<int>(ms.count()));
-                    }
-                    catch (...) {
-                        // Fallback: UTC with 'Z' suffix to clearly indicate time zone
-                        out << std::format("{:%Y-%m-%dT%H:%M:%S}.{:03}Z", tp_s, static_cast<int>(ms.count()));
-                    }
-                }
-
-                // Conditionally include thread ID
-                if (has_verbosity_flag(verbosity, log_verbosity::thread)) {
-                    add_separator();
-                    out << "[T " << std::format("{:06X}", compact_thread_id()) << ']';
-                }
-
-                // Conditionally include logger name
-                if (has_verbosity_flag(verbosity, log_verbosity::logger)) {
-                    add_separator();
-                    out << '[' << derived_name() << ']';
-                }
-
+                std::string line;
+                detail::append_log_entry(line, level, std::chrono::system_clock::now(),
+                    detail::compact_thread_id(), derived_name(), message
 #if NETLIB_HAS_SOURCE_LOCATION
-                // Conditionally include source location
-                if (has_verbosity_flag(verbosity, log_verbosity::path)) {
-                    add_separator();
-                    const auto filename = std::string_view{ loc.file_name() };
-                    const auto pos = filename.find_last_of("/\\");
-                    const auto basename = (pos == std::string_view::npos) ? filename
-                        : filename.substr(pos + 1);
-                    out << std::format("[{}:{}:{}]", basename, loc.line(), loc.function_name());
-                }
+                    , loc
 #endif
+                );
 
-                // Always add the message
-                if (!first_component) out << ' ';
-                out << message << '\n';
+                out << line;
                 out.emit();
                 try {
                     stream.flush();  // Stream buffer -> OS/console (may throw)
@@ -978,7 +1703,7 @@ namespace netlib::log {
                 // Ultimate fallback for any formatting errors
                 out << "[timestamp-unavailable] [" << to_string(level) << "] [T ";
                 out << std::uppercase << std::hex << std::setw(6) << std::setfill('0')
-                    << compact_thread_id();
+                    << detail::compact_thread_id();
                 out << std::dec << std::setfill(' ') << "] [" << derived_name() << "] "
                     << message << '\n';
                 out.emit();
@@ -1003,12 +1728,22 @@ namespace netlib::log {
 
     // Enhanced logging macros that build on the existing NETLIB_LOG infrastructure
 
+// Records the call in the binary trace (see binary_trace.h) if tracing is enabled for the level and
+// all argument types are traceable. The NETLIB_LOG macros only trace the levels the text logger has
+// turned off, so text output and per-logger levels are unaffected by tracing.
+#define NETLIB_TRACE(level_, fmt_, ...) \
+    if (static ::netlib::log::trace_site netlib_trace_site_{ fmt_, (level_), __FILE__, __LINE__, __func__ }; \
+        ::netlib::log::binary_trace::instance().is_enabled(level_)) \
+        (void)::netlib::log::binary_trace::instance().emit(netlib_trace_site_, ##__VA_ARGS__)
+
 #if NETLIB_HAS_SOURCE_LOCATION
 // Core macros with source location support
 #define NETLIB_LOG(level_, fmt_, ...) \
     do { \
         if (this->get_log_level() >= (level_)) { \
             this->print_log_with_loc((level_), std::source_location::current(), (fmt_), ##__VA_ARGS__); \
+        } else { \
+            NETLIB_TRACE((level_), fmt_, ##__VA_ARGS__); \
         } \
     } while(0)
 
@@ -1016,6 +1751,8 @@ namespace netlib::log {
     do { \
         if ((logger_ptr_) && (logger_ptr_)->get_log_level() >= (level_)) { \
             (logger_ptr_)->print_log_with_loc((level_), std::source_location::current(), (fmt_), ##__VA_ARGS__); \
+        } else { \
+            NETLIB_TRACE((level_), fmt_, ##__VA_ARGS__); \
         } \
     } while(0)
 
@@ -1025,6 +1762,8 @@ namespace netlib::log {
     do { \
         if (this->get_log_level() >= (level_)) { \
             this->print_log((level_), (fmt_), ##__VA_ARGS__); \
+        } else { \
+            NETLIB_TRACE((level_), fmt_, ##__VA_ARGS__); \
         } \
     } while(0)
 
@@ -1032,6 +1771,8 @@ namespace netlib::log {
     do { \
         if ((logger_ptr_) && (logger_ptr_)->get_log_level() >= (level_)) { \
             (logger_ptr_)->print_log((level_), (fmt_), ##__VA_ARGS__); \
+        } else { \
+            NETLIB_TRACE((level_), fmt_, ##__VA_ARGS__); \
         } \
     } while(0)
 
@@ -1043,6 +1784,20 @@ namespace netlib::log {
 #define NETLIB_INFO(fmt_, ...)    NETLIB_LOG(::netlib::log::log_level::info, fmt_, ##__VA_ARGS__)
 #define NETLIB_DEBUG(fmt_, ...)   NETLIB_LOG(::netlib::log::log_level::debug, fmt_, ##__VA_ARGS__)
 
+// Rate-limited logging: at most burst_ messages back to back and per_second_ messages per second
+// from this call site, further messages are dropped (the limiter is only consulted while the level
+// is enabled). The next message let through is followed by the number of messages suppressed.
+#define NETLIB_LOG_THROTTLED(level_, per_second_, burst_, fmt_, ...) \
+    do { \
+        static ::netlib::log::log_rate_limiter netlib_rate_limiter_{ (per_second_), (burst_) }; \
+        if ((this->get_log_level() >= (level_) || ::netlib::log::binary_trace::instance().is_enabled(level_)) && \
+            netlib_rate_limiter_.try_acquire()) { \
+            NETLIB_LOG((level_), fmt_, ##__VA_ARGS__); \
+            if (const auto netlib_suppressed_ = netlib_rate_limiter_.take_suppressed(); netlib_suppressed_ != 0) \
+                NETLIB_LOG((level_), "{} similar message(s) suppressed", netlib_suppressed_); \
+        } \
+    } while(0)
+
 // Convenience macros for use with logger pointers
 #define NETLIB_ERROR_PTR(logger_ptr_, fmt_, ...)   NETLIB_LOG_PTR(logger_ptr_, ::netlib::log::log_level::error, fmt_, ##__VA_ARGS__)
 #define NETLIB_WARNING_PTR(logger_ptr_, fmt_, ...) NETLIB_LOG_PTR(logger_ptr_, ::netlib::log::log_level::warning, fmt_, ##__VA_ARGS__)
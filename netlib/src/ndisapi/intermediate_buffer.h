@@ -69,6 +69,39 @@ namespace ndisapi
             }
             return *this;
         }
+        /**
+         * @brief Tests whether the checksums of a packet are left to checksum offload.
+         *
+         * The driver interface carries no per-packet offload metadata. A stack that offloads
+         * checksum calculation to the NIC leaves the IPv4 header checksum zero, which a computed
+         * header checksum is only in rare corner cases. IPv6 has no header checksum, so IPv6
+         * packets are never reported as pending.
+         *
+         * @param buffer Packet to examine.
+         * @return true if the packet is IPv4 and its checksums are still to be computed by the NIC.
+         */
+        [[nodiscard]] static bool is_checksum_pending(const _INTERMEDIATE_BUFFER& buffer) noexcept {
+            const auto* const eth_header = reinterpret_cast<const ether_header*>(buffer.m_IBuffer);
+            if (ntohs(eth_header->h_proto) != ETH_P_IP)
+                return false;
+
+            const auto* const ip_header = reinterpret_cast<const iphdr*>(buffer.m_IBuffer + ETHER_HEADER_LENGTH);
+            return ip_header->ip_sum == 0;
+        }
+        /**
+         * @brief Tests whether the checksums of a packet are complete and may be updated incrementally.
+         *
+         * A packet received from the adapter carries the checksums it had on the wire. A packet sent
+         * by the stack may hold a partial checksum left to transmit offload, which is_checksum_pending
+         * cannot always detect (the stack may compute the IPv4 header checksum only, and IPv6 has
+         * none), so it is reported as incomplete.
+         *
+         * @param buffer Packet to examine.
+         * @return true if the packet was received from the adapter.
+         */
+        [[nodiscard]] static bool has_complete_checksum(const _INTERMEDIATE_BUFFER& buffer) noexcept {
+            return buffer.m_dwDeviceFlags == PACKET_FLAG_ON_RECEIVE;
+        }
     private:
         /**
          * @brief Helper method for copy operations.
@@ -1,14 +1,32 @@
 #pragma once
 
-#include <boost/pool/object_pool.hpp>
-
 namespace ndisapi
 {
     /// <summary>
     /// A singleton class that manages a pool of intermediate_buffer objects.
     /// </summary>
+    /// <remarks>
+    /// Buffers are carved out of slabs that are kept for the lifetime of the pool, free buffers are
+    /// linked into a lock-free list (SLIST), so allocate() and free() may be called concurrently
+    /// from any thread and only take a lock when a new slab has to be added.
+    ///
+    /// Besides free-standing buffers, the pool backs the packet slots of unsorted_packet_block: an
+    /// attached buffer remembers the block slot pointing to it, which lets steal() take a packet out
+    /// of its block without copying it, by putting a fresh buffer into the slot in its place.
+    /// </remarks>
     class intermediate_buffer_pool {
     public:
+        /// <summary>
+        /// Pool occupancy counters.
+        /// </summary>
+        struct statistics {
+            std::size_t capacity;       ///< Buffers in all slabs.
+            std::size_t in_use;         ///< Buffers allocated (including attached ones).
+            std::size_t peak_in_use;    ///< Highest value of in_use.
+            std::size_t attached;       ///< Buffers backing packet block slots.
+            std::size_t slabs;          ///< Number of slabs.
+        };
+
         /// <summary>
         /// Deleted copy constructor to prevent copying.
         /// </summary>
@@ -33,11 +51,11 @@ namespace ndisapi
         /// </summary>
         struct deleter {
             /// <summary>
-            /// Deletes the intermediate_buffer object.
+            /// Returns the intermediate_buffer object to the pool.
             /// </summary>
-            /// <param name="ptr">Pointer to the intermediate_buffer object to be deleted.</param>
-            void operator()(intermediate_buffer* ptr) const {
-                instance().pool_.destroy(ptr);
+            /// <param name="ptr">Pointer to the intermediate_buffer object to be released.</param>
+            void operator()(intermediate_buffer* ptr) const noexcept {
+                instance().release(slot_of(ptr));
             }
         };
 
@@ -46,34 +64,164 @@ namespace ndisapi
         /// <summary>
         /// Allocates a new intermediate_buffer object from the pool.
         /// </summary>
-        /// <returns>A unique_ptr to the allocated intermediate_buffer object, or nullptr if allocation fails.</returns>
-        intermediate_buffer_ptr allocate() {
-            try {
-                auto* raw_ptr = pool_.construct(); // This might throw
-                std::fill_n(reinterpret_cast<char*>(raw_ptr), offsetof(_INTERMEDIATE_BUFFER, m_IBuffer), 0);
-                return intermediate_buffer_ptr(raw_ptr, deleter{});
-            }
-            catch (...) {
-                return nullptr; // Return a null std::unique_ptr
-            }
+        /// <returns>A unique_ptr to the allocated intermediate_buffer object (with a zeroed header), or nullptr if allocation fails.</returns>
+        intermediate_buffer_ptr allocate() noexcept {
+            auto* const s = acquire();
+            if (s == nullptr)
+                return nullptr;
+
+            std::fill_n(reinterpret_cast<char*>(&s->buffer), offsetof(_INTERMEDIATE_BUFFER, m_IBuffer), 0);
+            return intermediate_buffer_ptr(&s->buffer);
         }
 
         /// <summary>
         /// Allocates a new intermediate_buffer object from the pool and initializes it with the provided source.
         /// </summary>
-        /// <param name="source">The source intermediate_buffer object to copy from.</param>
+        /// <param name="source">The source intermediate_buffer object to copy from (header and m_Length bytes of packet data).</param>
         /// <returns>A unique_ptr to the allocated and initialized intermediate_buffer object, or nullptr if allocation fails.</returns>
-        intermediate_buffer_ptr allocate(const intermediate_buffer& source) {
-            auto buffer = allocate(); // Allocate a new buffer
+        intermediate_buffer_ptr allocate(const intermediate_buffer& source) noexcept {
+            auto* const s = acquire();
+            if (s == nullptr)
+                return nullptr;
+
+            // The copy assignment covers the whole header, no need to zero it first
+            s->buffer = source;
+            return intermediate_buffer_ptr(&s->buffer);
+        }
+
+        /// <summary>
+        /// Allocates a batch of intermediate_buffer objects (with zeroed headers).
+        /// </summary>
+        /// <param name="buffers">Receives the buffers; entries already holding a buffer are released first.</param>
+        /// <returns>Number of buffers allocated; fewer than buffers.size() if the pool is exhausted.</returns>
+        std::size_t allocate(std::span<intermediate_buffer_ptr> buffers) noexcept {
+            std::size_t allocated = 0;
+
+            for (auto& buffer : buffers) {
+                buffer = allocate();
+                if (!buffer)
+                    break;
+
+                ++allocated;
+            }
+
+            return allocated;
+        }
+
+        /// <summary>
+        /// Returns a batch of intermediate_buffer objects to the pool with a single list operation.
+        /// </summary>
+        /// <param name="buffers">Buffers to release; left holding nullptr.</param>
+        void free(std::span<intermediate_buffer_ptr> buffers) noexcept {
+            slot* first = nullptr;
+            slot* last = nullptr;
+            ULONG count = 0;
+
+            for (auto& buffer : buffers) {
+                if (!buffer)
+                    continue;
+
+                auto* const s = slot_of(buffer.release());
+                s->link.Next = first != nullptr ? &first->link : nullptr;
+                first = s;
+
+                if (last == nullptr)
+                    last = s;
 
-            if (buffer) { // Check if allocation was successful
-                *buffer = source; // Use the copy assignment operator of intermediate_buffer
+                ++count;
             }
-            return buffer; // Return the allocated buffer or nullptr if allocation failed
+
+            if (count == 0)
+                return;
+
+            in_use_.fetch_sub(count, std::memory_order_relaxed);
+            InterlockedPushListSListEx(&free_, &first->link, &last->link, count);
+        }
+
+        /// <summary>
+        /// Allocates a buffer backing a packet block slot and stores it into the slot.
+        /// </summary>
+        /// <param name="home">The block slot; its address must stay valid until detach().</param>
+        /// <returns>false if the pool is exhausted (home is left unchanged).</returns>
+        bool attach(intermediate_buffer*& home) noexcept {
+            auto* const s = acquire();
+            if (s == nullptr)
+                return false;
+
+            s->home = &home;
+            home = &s->buffer;
+            attached_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        /// <summary>
+        /// Releases the buffer of a packet block slot obtained with attach().
+        /// </summary>
+        /// <param name="home">The block slot; left holding nullptr.</param>
+        void detach(intermediate_buffer*& home) noexcept {
+            if (home == nullptr)
+                return;
+
+            auto* const s = slot_of(std::exchange(home, nullptr));
+            s->home = nullptr;
+            attached_.fetch_sub(1, std::memory_order_relaxed);
+            release(s);
+        }
+
+        /// <summary>
+        /// Takes the buffer out of its packet block slot without copying it.
+        /// </summary>
+        /// <remarks>
+        /// Any buffer may be passed: one that was not handed out by this pool (e.g. allocated on the
+        /// heap or the stack) is recognized by its address and never touched, so the caller can fall
+        /// back to copying it with allocate(buffer). The check takes the slab lock.
+        /// </remarks>
+        /// <param name="buffer">A buffer, typically attached to a block slot (see attach()). If it is
+        /// attached, the caller must be the only thread accessing that slot.</param>
+        /// <returns>The buffer, now detached; or nullptr if it does not come from the pool, is not
+        /// attached or no replacement buffer could be allocated for the slot (the buffer stays in
+        /// the block).</returns>
+        intermediate_buffer_ptr steal(intermediate_buffer& buffer) noexcept {
+            if (!owns(&buffer))
+                return nullptr;
+
+            auto* const s = slot_of(&buffer);
+            if (s->home == nullptr)
+                return nullptr;
+
+            auto* const replacement = acquire();
+            if (replacement == nullptr)
+                return nullptr;
+
+            // The slot is refilled before the driver reads into it again, the header needn't be cleared
+            replacement->home = std::exchange(s->home, nullptr);
+            *replacement->home = &replacement->buffer;
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return intermediate_buffer_ptr(&s->buffer);
+        }
+
+        /// <summary>
+        /// Returns the pool occupancy counters.
+        /// </summary>
+        [[nodiscard]] statistics get_statistics() const noexcept {
+            return {
+                capacity_.load(std::memory_order_relaxed),
+                in_use_.load(std::memory_order_relaxed),
+                peak_in_use_.load(std::memory_order_relaxed),
+                attached_.load(std::memory_order_relaxed),
+                slab_count_.load(std::memory_order_relaxed)
+            };
+        }
+
+        /// <summary>
+        /// Returns the number of buffers taken out of packet blocks with steal().
+        /// </summary>
+        [[nodiscard]] std::uint64_t get_steal_count() const noexcept {
+            return steals_.load(std::memory_order_relaxed);
         }
 
         /// <summary>
-        /// Default destructor.
+        /// Default destructor. The slabs are released with the pool.
         /// </summary>
         ~intermediate_buffer_pool() = default;
 
@@ -88,14 +236,121 @@ namespace ndisapi
         intermediate_buffer_pool& operator=(intermediate_buffer_pool&&) noexcept = delete;
 
     private:
+        /// <summary>
+        /// Pool entry: free list link, owning block slot (if attached) and the buffer itself.
+        /// </summary>
+        struct alignas(MEMORY_ALLOCATION_ALIGNMENT) slot {
+            SLIST_ENTRY link;                       ///< Free list link, must stay the first member.
+            intermediate_buffer** home;             ///< Block slot pointing to the buffer, nullptr if not attached.
+            intermediate_buffer buffer;             ///< The buffer handed out.
+        };
+
+        /// <summary>
+        /// Number of buffers per slab (about 400 KB).
+        /// </summary>
+        static constexpr std::size_t slab_slots = 256;
+
         /// <summary>
         /// Private constructor for singleton.
         /// </summary>
-        /// <param name="initial_size">The initial size of the pool.</param>
-        explicit intermediate_buffer_pool(const size_t initial_size = 32)
-            : pool_(initial_size) {
+        intermediate_buffer_pool() {
+            InitializeSListHead(&free_);
+        }
+
+        /// <summary>
+        /// Returns the pool entry of a buffer handed out by the pool.
+        /// </summary>
+        static slot* slot_of(intermediate_buffer* buffer) noexcept {
+            return reinterpret_cast<slot*>(reinterpret_cast<char*>(buffer) - offsetof(slot, buffer));
+        }
+
+        /// <summary>
+        /// Tests whether a buffer is the buffer of an entry in one of the slabs.
+        /// </summary>
+        bool owns(const intermediate_buffer* buffer) noexcept {
+            const auto address = reinterpret_cast<std::uintptr_t>(buffer);
+
+            std::scoped_lock lock(slab_lock_);
+
+            for (const auto& slab : slabs_) {
+                const auto first = reinterpret_cast<std::uintptr_t>(&slab[0].buffer);
+
+                if (address >= first && address < first + slab_slots * sizeof(slot))
+                    return (address - first) % sizeof(slot) == 0;
+            }
+
+            return false;
+        }
+
+        /// <summary>
+        /// Takes a free entry, adding a slab if none is left.
+        /// </summary>
+        /// <returns>The entry (not attached), or nullptr if memory is exhausted.</returns>
+        slot* acquire() noexcept {
+            auto* entry = InterlockedPopEntrySList(&free_);
+
+            while (entry == nullptr) {
+                if (!add_slab())
+                    return nullptr;
+
+                entry = InterlockedPopEntrySList(&free_);
+            }
+
+            const auto in_use = in_use_.fetch_add(1, std::memory_order_relaxed) + 1;
+            auto peak = peak_in_use_.load(std::memory_order_relaxed);
+
+            while (in_use > peak && !peak_in_use_.compare_exchange_weak(peak, in_use, std::memory_order_relaxed)) {
+            }
+
+            auto* const s = reinterpret_cast<slot*>(entry);
+            s->home = nullptr;
+            return s;
+        }
+
+        /// <summary>
+        /// Returns an entry to the free list.
+        /// </summary>
+        void release(slot* s) noexcept {
+            in_use_.fetch_sub(1, std::memory_order_relaxed);
+            InterlockedPushEntrySList(&free_, &s->link);
+        }
+
+        /// <summary>
+        /// Adds a slab to the free list, unless another thread has just done so.
+        /// </summary>
+        /// <returns>false if memory is exhausted.</returns>
+        bool add_slab() noexcept {
+            std::scoped_lock lock(slab_lock_);
+
+            // Another thread may have added a slab while this one was waiting for the lock
+            if (QueryDepthSList(&free_) != 0)
+                return true;
+
+            try {
+                auto slab = std::make_unique<slot[]>(slab_slots);
+                slabs_.reserve(slabs_.size() + 1);
+
+                for (std::size_t i = slab_slots; i-- > 0;)
+                    InterlockedPushEntrySList(&free_, &slab[i].link);
+
+                slabs_.push_back(std::move(slab));
+                capacity_.fetch_add(slab_slots, std::memory_order_relaxed);
+                slab_count_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            catch (const std::bad_alloc&) {
+                return false;
+            }
         }
 
-        boost::object_pool<intermediate_buffer> pool_; ///< The pool of intermediate_buffer objects.
+        SLIST_HEADER free_{};                                        ///< Free entries.
+        std::mutex slab_lock_;                                       ///< Serializes slab growth.
+        std::vector<std::unique_ptr<slot[]>> slabs_;                 ///< Slabs backing all entries.
+        std::atomic<std::size_t> capacity_{ 0 };                     ///< Entries in all slabs.
+        std::atomic<std::size_t> slab_count_{ 0 };                   ///< Size of slabs_.
+        std::atomic<std::size_t> in_use_{ 0 };                       ///< Entries handed out.
+        std::atomic<std::size_t> peak_in_use_{ 0 };                  ///< Highest in_use_.
+        std::atomic<std::size_t> attached_{ 0 };                     ///< Entries attached to block slots.
+        std::atomic<std::uint64_t> steals_{ 0 };                     ///< Buffers taken out of blocks.
     };
-}
\ No newline at end of file
+}
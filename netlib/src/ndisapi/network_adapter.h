@@ -293,6 +293,24 @@ namespace ndisapi
         /// <returns></returns>
         // ********************************************************************************
         [[nodiscard]] ndis_wan_type get_ndis_wan_type() const { return ndis_wan_type_; }
+        // ********************************************************************************
+        /// <summary>
+        /// Enables or disables checksum offload for packets redirected on this adapter.
+        /// When enabled, a packet whose checksums the stack left to the NIC
+        /// (intermediate_buffer::is_checksum_pending) keeps them pending after
+        /// being rewritten instead of having them computed in software. Applies only
+        /// to packets sent out through this adapter, packets reverted to the stack
+        /// must carry complete checksums.
+        /// </summary>
+        /// <param name="enable">true to rely on the adapter for pending checksums</param>
+        // ********************************************************************************
+        void set_checksum_offload(const bool enable) { checksum_offload_ = enable; }
+        // ********************************************************************************
+        /// <summary>
+        /// Returns true if pending checksums are left to the adapter
+        /// </summary>
+        // ********************************************************************************
+        [[nodiscard]] bool get_checksum_offload() const { return checksum_offload_; }
 
     protected:
         /// <summary>
@@ -327,6 +345,10 @@ namespace ndisapi
         /// NDISWAN adapter type
         /// </summary>
         ndis_wan_type ndis_wan_type_{ ndis_wan_type::ndis_wan_none };
+        /// <summary>
+        /// Pending checksums of redirected packets are left to the adapter
+        /// </summary>
+        bool checksum_offload_{ false };
     };
 
     inline std::optional<std::vector<ndis_wan_link_info>> network_adapter::get_ras_links() const
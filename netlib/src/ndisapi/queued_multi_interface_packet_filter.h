@@ -25,8 +25,10 @@ namespace ndisapi
      * @tparam Size The number of packets in the block.
      *
      * @details
-     * - Each block contains an array of @ref intermediate_buffer objects, which hold the actual packet data.
-     * - The @c read_request_ array provides pointers to each buffer for use in batch read operations.
+     * - Each block owns @c Size @ref intermediate_buffer objects attached from the @ref intermediate_buffer_pool,
+     *   which hold the actual packet data. A packet can therefore be taken out of the block without a copy
+     *   (see @ref intermediate_buffer_pool::steal), the pool puts a fresh buffer into its slot.
+     * - The @c read_request_ array points to each buffer and is used for batch read operations and packet access.
      * - The @c write_adapter_request_ and @c write_mstcp_request_ vectors collect pointers to buffers
      *   that should be written to the network adapter or up to the protocol stack, respectively.
      * - The @c packets_success_ member tracks the number of packets successfully read into the block.
@@ -36,10 +38,8 @@ namespace ndisapi
     {
         /// Number of successfully read packets in this block.
         uint32_t packets_success_{ 0 };
-        /// Array of packet buffers.
-        std::array<intermediate_buffer, Size> packet_buffer_;
-        /// Array of pointers for batch reading packets.
-        std::array<intermediate_buffer*, Size> read_request_;
+        /// Array of pointers to the packet buffers (attached from intermediate_buffer_pool), used for batch reading packets.
+        std::array<intermediate_buffer*, Size> read_request_{};
         /// Vector of pointers to packets to be written to the adapter.
         std::vector<intermediate_buffer*> write_adapter_request_;
         /// Vector of pointers to packets to be written up to the protocol stack.
@@ -49,20 +49,39 @@ namespace ndisapi
         /**
          * @brief Constructs and initializes the packet block.
          *
-         * Reserves space in the write vectors and sets up the read pointer array
-         * to point to each buffer in @c packet_buffer_.
+         * Reserves space in the write vectors and attaches a pool buffer to every slot
+         * of the read pointer array.
+         *
+         * @throws std::bad_alloc if the buffers cannot be allocated.
          */
         explicit unsorted_packet_block()
         {
             write_adapter_request_.reserve(Size);
             write_mstcp_request_.reserve(Size);
 
-            for (unsigned i = 0; i < Size; ++i)
+            for (auto& slot : read_request_)
             {
-                read_request_[i] = &packet_buffer_[i];
+                if (!intermediate_buffer_pool::instance().attach(slot))
+                {
+                    release_buffers();
+                    throw std::bad_alloc();
+                }
             }
         }
 
+        unsorted_packet_block(const unsorted_packet_block&) = delete;
+        unsorted_packet_block& operator=(const unsorted_packet_block&) = delete;
+        unsorted_packet_block(unsorted_packet_block&&) = delete;
+        unsorted_packet_block& operator=(unsorted_packet_block&&) = delete;
+
+        /**
+         * @brief Returns the packet buffers to the pool.
+         */
+        ~unsorted_packet_block()
+        {
+            release_buffers();
+        }
+
         /**
          * @brief Returns the array of pointers for batch reading packets.
          * @return Const reference to the read pointer array.
@@ -97,7 +116,7 @@ namespace ndisapi
          */
         intermediate_buffer& operator[](const std::size_t idx)
         {
-            return packet_buffer_[idx];
+            return *read_request_[idx];
         }
 
         /**
@@ -107,7 +126,7 @@ namespace ndisapi
          */
         const intermediate_buffer& operator[](const std::size_t idx) const
         {
-            return packet_buffer_[idx];
+            return *read_request_[idx];
         }
 
         /**
@@ -118,6 +137,168 @@ namespace ndisapi
         {
             return packets_success_;
         }
+
+    private:
+        /**
+         * @brief Detaches the buffers of all slots.
+         */
+        void release_buffers() noexcept
+        {
+            for (auto& slot : read_request_)
+                intermediate_buffer_pool::instance().detach(slot);
+        }
+    };
+
+    /**
+     * @enum queue_mode
+     * @brief Selects the hand-off mechanism used between the pipeline stages.
+     *
+     * - locked:    Each stage queue is a std::queue guarded by a mutex and a condition variable.
+     *              Every hand-off takes the lock and signals the condition variable.
+     * - spsc_ring: Each stage queue is a bounded single-producer/single-consumer ring. A hand-off
+     *              costs a couple of atomic operations; an idle consumer spins briefly and then
+     *              parks on the ring's wake-up word, so the kernel is only entered when a stage
+     *              actually went to sleep.
+     */
+    enum class queue_mode : uint8_t
+    {
+        locked,     ///< Mutex and condition variable protected std::queue (default).
+        spsc_ring   ///< Lock-free SPSC ring with spin-then-park waiting.
+    };
+
+    /**
+     * @class packet_block_queue
+     * @brief Stage-to-stage queue of packet blocks with a selectable hand-off mechanism.
+     *
+     * In @ref queue_mode::spsc_ring mode at most one thread may push and at most one thread
+     * may pop at a time, which is exactly how the stages of @ref queued_multi_interface_packet_filter
+     * use their queues. In @ref queue_mode::locked mode there are no such restrictions.
+     *
+     * @tparam Block Packet block type.
+     * @tparam Capacity Ring capacity, must be a power of two not smaller than the number of blocks in flight.
+     */
+    template <typename Block, std::size_t Capacity>
+    class packet_block_queue
+    {
+    public:
+        /// Owning pointer to a packet block.
+        using block_ptr = std::unique_ptr<Block>;
+
+        /**
+         * @brief Constructs an empty queue.
+         * @param mode Hand-off mechanism to use.
+         * @param spin_count Number of empty polls before a ring consumer parks.
+         */
+        explicit packet_block_queue(const queue_mode mode = queue_mode::locked, const uint32_t spin_count = 1024)
+            : mode_(mode), ring_(spin_count)
+        {
+        }
+
+        /**
+         * @brief Enqueues a packet block and wakes the consumer if necessary.
+         * @param block Packet block to enqueue.
+         */
+        void push(block_ptr&& block)
+        {
+            if (mode_ == queue_mode::spsc_ring)
+            {
+                // Capacity covers all allocated blocks, so the ring can never be full here
+                [[maybe_unused]] const auto pushed = ring_.try_push(std::move(block));
+                assert(pushed);
+                return;
+            }
+
+            std::lock_guard lock(lock_);
+            queue_.push(std::move(block));
+            cv_.notify_one();
+        }
+
+        /**
+         * @brief Dequeues a packet block, waiting while the queue is empty.
+         * @return Packet block, or nullptr if the queue was closed and is empty.
+         */
+        block_ptr pop()
+        {
+            if (mode_ == queue_mode::spsc_ring)
+            {
+                auto block = ring_.pop();
+                return block ? std::move(block.value()) : nullptr;
+            }
+
+            std::unique_lock lock(lock_);
+
+            cv_.wait(lock, [this]
+                {
+                    return closed_ || !queue_.empty();
+                });
+
+            if (queue_.empty())
+                return nullptr;
+
+            auto block = std::move(queue_.front());
+            queue_.pop();
+            return block;
+        }
+
+        /**
+         * @brief Closes the queue and wakes any waiting consumer.
+         */
+        void close()
+        {
+            if (mode_ == queue_mode::spsc_ring)
+            {
+                ring_.close();
+                return;
+            }
+
+            std::lock_guard lock(lock_);
+            closed_ = true;
+            cv_.notify_all();
+        }
+
+        /**
+         * @brief Returns the number of queued blocks (approximate while the stages are running).
+         */
+        [[nodiscard]] std::size_t size() const
+        {
+            // Indices read by a third thread may be momentarily inconsistent
+            if (mode_ == queue_mode::spsc_ring)
+                return std::min(ring_.size(), Capacity);
+
+            std::lock_guard lock(lock_);
+            return queue_.size();
+        }
+
+        /**
+         * @brief Releases any queued blocks and re-opens the queue.
+         *
+         * Must only be called while no stage thread is using the queue.
+         */
+        void reset()
+        {
+            ring_.reset();
+
+            std::lock_guard lock(lock_);
+            while (!queue_.empty())
+            {
+                queue_.pop();
+            }
+            closed_ = false;
+        }
+
+    private:
+        /// Selected hand-off mechanism; fixed for the lifetime of the queue.
+        const queue_mode mode_;
+        /// Ring used in queue_mode::spsc_ring mode.
+        tools::concurrency::spsc_ring<block_ptr, Capacity> ring_;
+        /// Queue used in queue_mode::locked mode.
+        std::queue<block_ptr> queue_;
+        /// Mutex protecting queue_ and closed_.
+        mutable std::mutex lock_;
+        /// Condition variable signaled on push and close.
+        std::condition_variable cv_;
+        /// Set once the queue is closed for shutdown (queue_mode::locked only).
+        bool closed_{ false };
     };
 
     // --------------------------------------------------------------------------------
@@ -132,7 +313,8 @@ namespace ndisapi
      * scenarios and is suitable for advanced network applications, monitoring, and research.
      *
      * Key features:
-     * - Multi-threaded, lock-protected queues for each stage of packet processing.
+     * - Multi-threaded queues for each stage of packet processing, either lock-protected or
+     *   lock-free SPSC rings (see @ref filter_options).
      * - Batch processing of packets using @ref unsorted_packet_block for efficiency.
      * - Dynamic adapter filtering and runtime reconfiguration.
      * - User-supplied functors for custom packet handling logic.
@@ -204,6 +386,70 @@ namespace ndisapi
             }
         };
 
+        /// Stage hand-off mechanism.
+        using queue_mode = ndisapi::queue_mode;
+
+        /**
+         * @enum routing_mode
+         * @brief Selects how processed blocks travel to the writer stages.
+         *
+         * - pipelined: Every block visits the write-mstcp stage and then the write-adapter stage.
+         * - direct:    While the writer stages are idle, a block is handed straight to the writer that
+         *              has work for it (or back to the read stage if it has none), and small blocks are
+         *              written inline by the processing thread. Blocks only bypass a stage when every
+         *              stage behind it is empty, so packet order and the single producer per
+         *              queue are preserved.
+         */
+        enum class routing_mode : uint8_t
+        {
+            pipelined,  ///< Fixed process -> write-mstcp -> write-adapter -> read chain (default).
+            direct      ///< Skip writer stages without work, write small blocks inline.
+        };
+
+        /**
+         * @enum block_size_policy
+         * @brief Selects how many packet buffers of a block are offered to ReadPacketsUnsorted.
+         *
+         * - fixed:    Every read offers all @ref maximum_packet_block buffers of the block.
+         * - adaptive: The read size follows an exponentially weighted average of recent read sizes.
+         *             It doubles immediately after a read that filled the request and decays towards
+         *             the average otherwise, so low-rate traffic keeps reusing the same few (cache-hot)
+         *             buffers at the start of each block while bursts still get full batches.
+         */
+        enum class block_size_policy : uint8_t
+        {
+            fixed,      ///< Always read up to maximum_packet_block packets (default).
+            adaptive    ///< Size reads from recent queue depth.
+        };
+
+        /**
+         * @struct filter_options
+         * @brief Tuning options for the packet filter pipeline.
+         *
+         * Options are fixed at construction time.
+         */
+        struct filter_options
+        {
+            /// Hand-off mechanism between the read, process, write-mstcp and write-adapter stages.
+            queue_mode queue{ queue_mode::locked };
+            /// Number of empty polls a stage performs before parking (queue_mode::spsc_ring only).
+            uint32_t ring_spin_count{ 1024 };
+            /// Number of threads classifying packets of a block, including the processing thread itself.
+            /// Packets are sharded by a symmetric flow hash, so packets of one flow are always classified
+            /// by the same thread in their original order. With more than one worker the packet handlers
+            /// are invoked concurrently and must be thread-safe.
+            uint32_t processing_workers{ 1 };
+            /// Routing of processed blocks to the writer stages.
+            routing_mode routing{ routing_mode::pipelined };
+            /// Blocks with at most this number of packets are written by the processing thread itself
+            /// when the writer stages are idle (routing_mode::direct only, 0 disables inline writes).
+            uint32_t inline_write_threshold{ 0 };
+            /// Read sizing policy.
+            block_size_policy block_sizing{ block_size_policy::fixed };
+            /// Smallest read size used by block_size_policy::adaptive.
+            uint32_t minimum_read_size{ 16 };
+        };
+
     private:
         /**
          * @brief Maximum number of packets in a single processing block.
@@ -223,6 +469,17 @@ namespace ndisapi
          */
         static constexpr uint32_t maximum_block_num = 16;
 
+        /**
+         * @brief Upper bound for @ref filter_options::processing_workers.
+         */
+        static constexpr uint32_t maximum_processing_workers = 64;
+
+        /// Packet block type circulating through the pipeline.
+        using packet_block = unsorted_packet_block<maximum_packet_block>;
+
+        /// Stage queue type; the ring capacity covers every allocated block.
+        using block_queue = packet_block_queue<packet_block, std::bit_ceil(maximum_block_num)>;
+
         /**
          * @brief Constructs the filter and initializes internal resources.
          *
@@ -231,9 +488,15 @@ namespace ndisapi
          * monitor network adapter changes and initializes the list of available
          * network interfaces for filtering.
          *
+         * @param options Pipeline tuning options.
          * @throws std::runtime_error if the WinpkFilter driver is not loaded.
          */
-        queued_multi_interface_packet_filter()
+        explicit queued_multi_interface_packet_filter(const filter_options& options) :
+            options_(options),
+            packet_read_queue_(options.queue, options.ring_spin_count),
+            packet_process_queue_(options.queue, options.ring_spin_count),
+            packet_write_mstcp_queue_(options.queue, options.ring_spin_count),
+            packet_write_adapter_queue_(options.queue, options.ring_spin_count)
         {
             // Check if the Windows Packet Filter driver is loaded. If not, throw an exception.
             if (!IsDriverLoaded())
@@ -342,7 +605,25 @@ namespace ndisapi
          *       packet_action(HANDLE, intermediate_buffer&)
          */
         template <typename F1, typename F2>
-        queued_multi_interface_packet_filter(F1 in, F2 out) : queued_multi_interface_packet_filter()
+        queued_multi_interface_packet_filter(F1 in, F2 out) : queued_multi_interface_packet_filter(filter_options{})
+        {
+            filter_incoming_packet_ = in;
+            filter_outgoing_packet_ = out;
+        }
+
+        /**
+         * @brief Constructs a queued_multi_interface_packet_filter with user-defined packet handlers
+         *        and pipeline tuning options.
+         *
+         * @tparam F1 Type of the incoming packet handler functor.
+         * @tparam F2 Type of the outgoing packet handler functor.
+         * @param in  Functor or callable object for processing incoming packets.
+         * @param out Functor or callable object for processing outgoing packets.
+         * @param options Pipeline tuning options, see @ref filter_options.
+         */
+        template <typename F1, typename F2>
+        queued_multi_interface_packet_filter(F1 in, F2 out, const filter_options& options) :
+            queued_multi_interface_packet_filter(options)
         {
             filter_incoming_packet_ = in;
             filter_outgoing_packet_ = out;
@@ -393,6 +674,62 @@ namespace ndisapi
             return filter_state_.load();
         }
 
+        /**
+         * @brief Gets the pipeline tuning options the filter was constructed with.
+         * @return Reference to the filter options.
+         */
+        [[nodiscard]] const filter_options& get_filter_options() const
+        {
+            return options_;
+        }
+
+        /**
+         * @brief Gets the number of packet buffers currently offered to each ReadPacketsUnsorted call.
+         * @return Current read size; always maximum_packet_block with block_size_policy::fixed.
+         */
+        [[nodiscard]] uint32_t get_read_size() const
+        {
+            return read_size_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @struct pipeline_statistics
+         * @brief Snapshot of the pipeline state and counters.
+         */
+        struct pipeline_statistics
+        {
+            std::size_t read_queue;             ///< Free blocks waiting for the read stage.
+            std::size_t process_queue;          ///< Read blocks waiting for the processing stage.
+            std::size_t write_mstcp_queue;      ///< Blocks waiting for the write-mstcp stage.
+            std::size_t write_adapter_queue;    ///< Blocks waiting for the write-adapter stage.
+            uint32_t read_size;                 ///< Current read size, see get_read_size().
+            uint64_t blocks;                    ///< Blocks processed since construction.
+            uint64_t packets;                   ///< Packets processed since construction.
+            tools::metrics::latency_histogram::snapshot block_time;  ///< Processing time per block.
+        };
+
+        /**
+         * @brief Returns the depths of the stage queues and the processing counters.
+         *
+         * May be called at any time from any thread; the queue depths are approximate while the
+         * filter is running.
+         */
+        [[nodiscard]] pipeline_statistics get_pipeline_statistics() const
+        {
+            auto block_time = block_processing_time_.get_snapshot();
+
+            return {
+                packet_read_queue_.size(),
+                packet_process_queue_.size(),
+                packet_write_mstcp_queue_.size(),
+                packet_write_adapter_queue_.size(),
+                read_size_.load(std::memory_order_relaxed),
+                block_time.count,
+                processed_packets_.load(std::memory_order_relaxed),
+                block_time
+            };
+        }
+
     private:
         /**
          * @brief Thread procedure for reading packets from network adapters.
@@ -413,6 +750,68 @@ namespace ndisapi
          */
         void packet_process_thread();
 
+        /**
+         * @brief Thread procedure for a classification worker.
+         *
+         * Started by packet_process_thread() when more than one processing worker is configured.
+         * Waits for the processing thread to publish a block, classifies the packets of its shard
+         * and reports completion back to the processing thread.
+         *
+         * @param worker_index Index of the shard handled by this worker (1 based, shard 0 belongs
+         *        to the processing thread).
+         */
+        void packet_classification_worker(uint32_t worker_index);
+
+        /**
+         * @brief Runs the user-defined handler for a single packet.
+         * @param buffer Packet to classify.
+         * @return The action returned by the handler or pass if no handler is set for the packet direction.
+         */
+        packet_action classify_packet(intermediate_buffer& buffer) const;
+
+        /**
+         * @brief Applies a packet action and appends the packet to the matching write request.
+         * @param packet_block Block containing the packet.
+         * @param index Index of the packet in the block.
+         * @param action Action returned by classify_packet().
+         */
+        static void route_packet(packet_block& packet_block, std::size_t index, const packet_action& action);
+
+        /**
+         * @brief Classifies all packets of the shard assigned to the given worker.
+         * @param worker_index Shard index.
+         */
+        void classify_shard(uint32_t worker_index);
+
+        /**
+         * @brief Computes a direction independent flow hash of a packet.
+         *
+         * Both directions of a TCP/UDP flow (and of any other IP conversation) produce the same value,
+         * non-IP frames hash to zero.
+         *
+         * @param buffer Packet to hash.
+         * @return Symmetric flow hash.
+         */
+        static uint32_t flow_hash(const intermediate_buffer& buffer) noexcept;
+
+        /**
+         * @brief Hands a processed block to the next stage according to the routing mode.
+         * @param packet_block_ptr Processed packet block.
+         */
+        void dispatch_processed_block(block_queue::block_ptr&& packet_block_ptr);
+
+        /**
+         * @brief Sends the MSTCP bound packets of a block up to the protocol stack.
+         * @param packet_block Packet block.
+         */
+        void send_mstcp_request(packet_block& packet_block) const;
+
+        /**
+         * @brief Sends the adapter bound packets of a block to the network adapters.
+         * @param packet_block Packet block.
+         */
+        void send_adapter_request(packet_block& packet_block) const;
+
         /**
          * @brief Thread procedure for writing packets to the MSTCP stack.
          *
@@ -578,44 +977,98 @@ namespace ndisapi
         /// </remarks>
         std::shared_mutex lock_;
 
+        /// <summary>pipeline tuning options</summary>
+        /// <remarks>
+        /// Options supplied at construction time. They select the hand-off mechanism between the stages
+        /// and are immutable for the lifetime of the filter.
+        /// </remarks>
+        filter_options options_;
+
         /**
          * @brief Queues for managing packets at different stages of processing.
          *
          * These queues hold unique pointers to @ref unsorted_packet_block objects, which
          * represent batches of packets. Each queue corresponds to a specific stage in the
-         * packet processing pipeline:
+         * packet processing pipeline and has exactly one producer and one consumer thread:
          * - @c packet_read_queue_: Holds packet blocks ready to be filled with packets read from adapters.
          * - @c packet_process_queue_: Holds packet blocks that have been read and are ready for filtering/processing.
          * - @c packet_write_mstcp_queue_: Holds packet blocks ready to be written up to the MSTCP stack.
          * - @c packet_write_adapter_queue_: Holds packet blocks ready to be written out to network adapters.
          */
-        std::queue<std::unique_ptr<unsorted_packet_block<maximum_packet_block>>> packet_read_queue_;
-        std::queue<std::unique_ptr<unsorted_packet_block<maximum_packet_block>>> packet_process_queue_;
-        std::queue<std::unique_ptr<unsorted_packet_block<maximum_packet_block>>> packet_write_mstcp_queue_;
-        std::queue<std::unique_ptr<unsorted_packet_block<maximum_packet_block>>> packet_write_adapter_queue_;
+        block_queue packet_read_queue_;
+        block_queue packet_process_queue_;
+        block_queue packet_write_mstcp_queue_;
+        block_queue packet_write_adapter_queue_;
 
-        /**
-         * @brief Condition variables for synchronizing packet processing threads.
-         *
-         * Each condition variable is associated with a corresponding queue and is used to
-         * notify worker threads when new packet blocks are available for processing or when
-         * the state of the queue changes.
-         */
-        std::condition_variable packet_read_queue_cv_;
-        std::condition_variable packet_process_queue_cv_;
-        std::condition_variable packet_write_mstcp_queue_cv_;
-        std::condition_variable packet_write_adapter_queue_cv_;
+        /// <summary>current read size</summary>
+        /// <remarks>
+        /// Number of packet buffers offered to ReadPacketsUnsorted. Only updated by the read thread,
+        /// published for get_read_size().
+        /// </remarks>
+        std::atomic<uint32_t> read_size_{ maximum_packet_block };
 
-        /**
-         * @brief Mutexes for protecting access to the packet queues.
-         *
-         * Each mutex guards a specific queue to ensure thread-safe access and modification
-         * by multiple worker threads operating concurrently in the packet processing pipeline.
-         */
-        std::mutex packet_read_queue_lock_;
-        std::mutex packet_process_queue_lock_;
-        std::mutex packet_write_mstcp_queue_lock_;
-        std::mutex packet_write_adapter_queue_lock_;
+        /// <summary>processing time of each block</summary>
+        /// <remarks>
+        /// Measured by the processing thread from the dequeue of a block until it is dispatched to the
+        /// next stage, i.e. classification and routing of all its packets.
+        /// </remarks>
+        tools::metrics::latency_histogram block_processing_time_;
+
+        /// <summary>number of packets processed</summary>
+        /// <remarks>Only updated by the processing thread, once per block.</remarks>
+        std::atomic<uint64_t> processed_packets_{ 0 };
+
+        /// <summary>number of blocks owned by the write-mstcp stage</summary>
+        /// <remarks>
+        /// Incremented before a block is pushed into packet_write_mstcp_queue_ and decremented by the
+        /// write-mstcp stage after it has pushed the block onwards. A zero value observed with acquire
+        /// semantics means the stage is idle and its last push has completed, which lets the processing
+        /// thread take over the producer role of the downstream queues.
+        /// </remarks>
+        std::atomic<uint32_t> mstcp_stage_blocks_{ 0 };
+
+        /// <summary>number of blocks owned by the write-adapter stage</summary>
+        /// <remarks>
+        /// Same protocol as mstcp_stage_blocks_ for packet_write_adapter_queue_ and the write-adapter stage.
+        /// </remarks>
+        std::atomic<uint32_t> adapter_stage_blocks_{ 0 };
+
+        /// <summary>block currently being classified by the workers</summary>
+        /// <remarks>
+        /// Published by the processing thread before classification_generation_ is advanced and
+        /// only read by the workers until they report completion through classification_pending_.
+        /// </remarks>
+        packet_block* classification_block_{ nullptr };
+
+        /// <summary>packet indexes per classification shard</summary>
+        /// <remarks>
+        /// Filled by the processing thread for every block; shard 0 is classified by the processing thread itself.
+        /// </remarks>
+        std::vector<std::vector<uint32_t>> classification_shards_;
+
+        /// <summary>per-packet actions produced by the classification workers</summary>
+        /// <remarks>
+        /// Each element is written by exactly one worker and merged in packet order by the processing thread,
+        /// so the write requests keep the original packet order of the block.
+        /// </remarks>
+        std::array<packet_action, maximum_packet_block> packet_actions_;
+
+        /// <summary>classification round counter</summary>
+        /// <remarks>
+        /// Advanced by the processing thread to hand a new block (or the exit request) to the workers,
+        /// which park on it with std::atomic::wait.
+        /// </remarks>
+        std::atomic<uint32_t> classification_generation_{ 0 };
+
+        /// <summary>number of workers still classifying the current block</summary>
+        std::atomic<uint32_t> classification_pending_{ 0 };
+
+        /// <summary>classification worker exit request</summary>
+        /// <remarks>
+        /// Only set by the processing thread while no block is outstanding, so a worker never exits
+        /// with an unfinished shard.
+        /// </remarks>
+        std::atomic_bool classification_exit_{ false };
     };
 
     /// <summary>
@@ -658,19 +1111,22 @@ namespace ndisapi
     /// </remarks>
     inline bool queued_multi_interface_packet_filter::init_filter()
     {
+        mstcp_stage_blocks_ = 0;
+        adapter_stage_blocks_ = 0;
+
         // Allocate packets blocks
         try
         {
             for (uint32_t i = 0; i < maximum_block_num; ++i)
             {
-                auto packet_block_ptr = std::make_unique<unsorted_packet_block<maximum_packet_block>>();
+                auto packet_block_ptr = std::make_unique<packet_block>();
                 packet_read_queue_.push(std::move(packet_block_ptr));
             }
         }
         catch (const std::bad_alloc&)
         {
             // In case of bad_alloc, clear the queue to release already allocated blocks before returning false
-            while (!packet_read_queue_.empty()) packet_read_queue_.pop();
+            packet_read_queue_.reset();
             return false;
         }
 
@@ -682,9 +1138,9 @@ namespace ndisapi
     /// </summary>
     /// <remarks>
     /// This method signals all event objects to wake up any waiting threads, releases network interfaces,
-    /// and notifies all condition variables to ensure that all working threads can exit gracefully.
-    /// It then joins all threads to ensure they have finished execution. Finally, it clears all packet queues
-    /// to release any remaining resources.
+    /// and closes all stage queues to ensure that all working threads can exit gracefully.
+    /// It then joins all threads to ensure they have finished execution. Finally, it resets all packet queues
+    /// to release any remaining resources and make them ready for the next start_filter().
     /// </remarks>
     inline void queued_multi_interface_packet_filter::release_filter()
     {
@@ -698,10 +1154,10 @@ namespace ndisapi
             }
         }
 
-        packet_read_queue_cv_.notify_all();
-        packet_process_queue_cv_.notify_all();
-        packet_write_mstcp_queue_cv_.notify_all();
-        packet_write_adapter_queue_cv_.notify_all();
+        packet_read_queue_.close();
+        packet_process_queue_.close();
+        packet_write_mstcp_queue_.close();
+        packet_write_adapter_queue_.close();
 
         // Wait for working threads to exit
         if (packet_read_thread_.joinable())
@@ -713,25 +1169,10 @@ namespace ndisapi
         if (packet_write_adapter_thread_.joinable())
             packet_write_adapter_thread_.join();
 
-        while (!packet_read_queue_.empty())
-        {
-            packet_read_queue_.pop();
-        }
-
-        while (!packet_process_queue_.empty())
-        {
-            packet_process_queue_.pop();
-        }
-
-        while (!packet_write_mstcp_queue_.empty())
-        {
-            packet_write_mstcp_queue_.pop();
-        }
-
-        while (!packet_write_adapter_queue_.empty())
-        {
-            packet_write_adapter_queue_.pop();
-        }
+        packet_read_queue_.reset();
+        packet_process_queue_.reset();
+        packet_write_mstcp_queue_.reset();
+        packet_write_adapter_queue_.reset();
     }
 
     /// <summary>
@@ -936,52 +1377,71 @@ namespace ndisapi
     /// <remarks>
     /// This method runs in a dedicated thread and is responsible for continuously reading packets from the network adapters.
     /// It waits for packets to be available in the packet_read_queue_. When packets are available, it moves them to the
-    /// packet_process_queue_ for further processing. The method uses a condition variable to wait for packets efficiently
-    /// and exits gracefully if the filter state changes from running to another state.
+    /// packet_process_queue_ for further processing. The method blocks on the stage queue while it is empty
+    /// and exits gracefully once the queue is closed or the filter state changes from running to another state.
+    ///
+    /// With block_size_policy::adaptive only the first read_size_ buffers of a block are offered to the driver.
+    /// The read size tracks a moving average of recent read results (scaled by 16 to keep a fractional part):
+    /// a read that fills the request doubles the size right away, otherwise the size decays towards twice
+    /// the average. After a read that filled the request the driver queue is drained without waiting for
+    /// the packet event, since the event is not signaled again for packets that are already queued.
     /// </remarks>
     inline void queued_multi_interface_packet_filter::packet_read_thread()
     {
-        while (filter_state_ == filter_state::running)
-        {
-            std::unique_ptr<unsorted_packet_block<maximum_packet_block>> packet_block_ptr;
+        const auto adaptive = options_.block_sizing == block_size_policy::adaptive;
+        const auto minimum_read_size = std::clamp(options_.minimum_read_size, 1u, maximum_packet_block);
 
-            std::unique_lock lock(packet_read_queue_lock_);
+        uint32_t read_size = adaptive ? minimum_read_size : maximum_packet_block;
+        uint32_t average_read_x16 = read_size << 4;
+        bool drain_pending = false;
 
-            if (!packet_read_queue_.empty())
-            {
-                packet_block_ptr = std::move(packet_read_queue_.front());
-                packet_read_queue_.pop();
-            }
-            else
-            {
-                packet_read_queue_cv_.wait(lock, [this]
-                    {
-                        return filter_state_ != filter_state::running || !packet_read_queue_.
-                            empty();
-                    });
-
-                if (filter_state_ != filter_state::running)
-                    return;
+        read_size_.store(read_size, std::memory_order_relaxed);
 
-                packet_block_ptr = std::move(packet_read_queue_.front());
-                packet_read_queue_.pop();
-            }
+        while (filter_state_ == filter_state::running)
+        {
+            auto packet_block_ptr = packet_read_queue_.pop();
 
-            lock.unlock();
+            if (!packet_block_ptr || filter_state_ != filter_state::running)
+                return;
 
             auto& read_request = packet_block_ptr->get_read_request();
             do
             {
-                std::ignore = packet_event_.wait(INFINITE);
-                std::ignore = packet_event_.reset_event();
+                if (!drain_pending)
+                {
+                    std::ignore = packet_event_.wait(INFINITE);
+                    std::ignore = packet_event_.reset_event();
+                }
+                drain_pending = false;
             } while (!ReadPacketsUnsorted(reinterpret_cast<PINTERMEDIATE_BUFFER*>(const_cast<intermediate_buffer**>(read_request.data())),
-                (DWORD)read_request.size(),
+                static_cast<DWORD>(read_size),
                 reinterpret_cast<PDWORD>(&packet_block_ptr->get_packets_success())) &&
                 filter_state_ == filter_state::running);
 
-            std::lock_guard lk(packet_process_queue_lock_);
+            const auto packets_read = packet_block_ptr->get_packets_success();
+
+            drain_pending = packets_read == read_size;
+
+            if (adaptive)
+            {
+                average_read_x16 = average_read_x16 - (average_read_x16 >> 3) + (packets_read << 1);
+
+                if (drain_pending)
+                {
+                    read_size = std::min(read_size * 2, maximum_packet_block);
+                }
+                else
+                {
+                    const auto target = std::clamp(std::bit_ceil(std::max(average_read_x16 >> 3, 1u)),
+                        minimum_read_size, maximum_packet_block);
+                    if (target < read_size)
+                        read_size = std::max(read_size / 2, target);
+                }
+
+                read_size_.store(read_size, std::memory_order_relaxed);
+            }
+
             packet_process_queue_.push(std::move(packet_block_ptr));
-            packet_process_queue_cv_.notify_one();
         }
     }
 
@@ -993,124 +1453,405 @@ namespace ndisapi
     /// It waits for packets to be available in the packet_process_queue_. When packets are available, it processes them based on the
     /// filter rules defined by filter_incoming_packet_ and filter_outgoing_packet_ functors. Depending on the action determined by the
     /// filter rules, packets are routed to either the write_adapter_request or write_mstcp_request for further handling. The method
-    /// uses a condition variable to wait for packets efficiently and exits gracefully if the filter state changes from running to another state.
+    /// blocks on the stage queue while it is empty and exits gracefully once the queue is closed or the filter state changes
+    /// from running to another state.
     /// </remarks>
     inline void queued_multi_interface_packet_filter::packet_process_thread()
     {
-        while (filter_state_ == filter_state::running)
+        const auto workers = std::clamp(options_.processing_workers, 1u, maximum_processing_workers);
+
+        // Start the classification workers; shard 0 is handled by this thread
+        std::vector<std::thread> classification_workers;
+
+        classification_shards_.resize(workers);
+        for (auto& shard : classification_shards_)
+            shard.reserve(maximum_packet_block);
+
+        classification_exit_ = false;
+        classification_generation_ = 0;
+        classification_pending_ = 0;
+
+        for (uint32_t i = 1; i < workers; ++i)
         {
-            std::unique_lock lock(packet_process_queue_lock_);
+            classification_workers.emplace_back(&queued_multi_interface_packet_filter::packet_classification_worker, this, i);
+        }
 
-            packet_process_queue_cv_.wait(lock, [this]
-                {
-                    return filter_state_ != filter_state::running || !packet_process_queue_.
-                        empty();
-                });
+        // No block is outstanding whenever this runs, so the workers can exit safely
+        const auto stop_workers = gsl::finally([this, &classification_workers]
+            {
+                classification_exit_.store(true, std::memory_order_release);
+                classification_generation_.fetch_add(1, std::memory_order_release);
+                classification_generation_.notify_all();
 
-            if (filter_state_ != filter_state::running)
-                return;
+                for (auto& worker : classification_workers)
+                {
+                    if (worker.joinable())
+                        worker.join();
+                }
+            });
 
-            auto packet_block_ptr = std::move(packet_process_queue_.front());
-            packet_process_queue_.pop();
+        while (filter_state_ == filter_state::running)
+        {
+            auto packet_block_ptr = packet_process_queue_.pop();
 
-            lock.unlock();
+            if (!packet_block_ptr || filter_state_ != filter_state::running)
+                return;
 
-            auto& write_adapter_request = packet_block_ptr->get_write_adapter_request();
-            auto& write_mstcp_request = packet_block_ptr->get_write_mstcp_request();
+            const auto started = std::chrono::steady_clock::now();
+            const auto packets_success = packet_block_ptr->get_packets_success();
 
-            for (size_t i = 0; i < packet_block_ptr->get_packets_success(); ++i)
+            if (workers == 1 || packets_success == 1)
             {
-                auto action = packet_action(packet_action::action_type::pass);
-
-                if ((*packet_block_ptr)[i].m_dwDeviceFlags == PACKET_FLAG_ON_SEND)
+                for (size_t i = 0; i < packets_success; ++i)
                 {
-                    if (filter_outgoing_packet_ != nullptr)
-                        action = filter_outgoing_packet_((*packet_block_ptr)[i].m_hAdapter, (*packet_block_ptr)[i]);
+                    route_packet(*packet_block_ptr, i, classify_packet((*packet_block_ptr)[i]));
                 }
-                else
+            }
+            else
+            {
+                // Shard packets by flow so each flow is classified in order by a single thread
+                for (auto& shard : classification_shards_)
+                    shard.clear();
+
+                for (uint32_t i = 0; i < packets_success; ++i)
                 {
-                    if (filter_incoming_packet_ != nullptr)
-                        action = filter_incoming_packet_((*packet_block_ptr)[i].m_hAdapter, (*packet_block_ptr)[i]);
+                    classification_shards_[flow_hash((*packet_block_ptr)[i]) % workers].push_back(i);
                 }
 
-                // Alter target interface if requested
-                if (action.interface_handle)
+                classification_block_ = packet_block_ptr.get();
+                classification_pending_.store(workers - 1, std::memory_order_relaxed);
+                classification_generation_.fetch_add(1, std::memory_order_release);
+                classification_generation_.notify_all();
+
+                classify_shard(0);
+
+                for (auto pending = classification_pending_.load(std::memory_order_acquire); pending != 0;
+                    pending = classification_pending_.load(std::memory_order_acquire))
                 {
-                    (*packet_block_ptr)[i].m_hAdapter = action.interface_handle.value();
+                    classification_pending_.wait(pending, std::memory_order_acquire);
                 }
 
-                // Place packet back into the flow if was allowed to
-                if (action.action == packet_action::action_type::pass)
+                classification_block_ = nullptr;
+
+                // Merge in the original packet order
+                for (size_t i = 0; i < packets_success; ++i)
                 {
-                    if ((*packet_block_ptr)[i].m_dwDeviceFlags == PACKET_FLAG_ON_SEND)
-                    {
-                        write_adapter_request.push_back(&(*packet_block_ptr)[i]);
-                    }
-                    else
-                    {
-                        write_mstcp_request.push_back(&(*packet_block_ptr)[i]);
-                    }
+                    route_packet(*packet_block_ptr, i, packet_actions_[i]);
                 }
-                else if (action.action == packet_action::action_type::revert)
+            }
+
+            processed_packets_.fetch_add(packets_success, std::memory_order_relaxed);
+            block_processing_time_.record(std::chrono::steady_clock::now() - started);
+
+            dispatch_processed_block(std::move(packet_block_ptr));
+        }
+    }
+
+    /// <summary>
+    /// Hands a processed block to the next pipeline stage.
+    /// </summary>
+    /// <param name="packet_block_ptr">Processed packet block.</param>
+    /// <remarks>
+    /// In routing_mode::pipelined every block goes to the write-mstcp stage. In routing_mode::direct the
+    /// stage counters decide: if both writer stages are idle, small blocks (and blocks without anything to
+    /// write) are completed inline and returned to the read stage; if only the write-mstcp stage is idle
+    /// and the block has nothing for it, the block goes straight to the write-adapter stage. Otherwise the
+    /// block follows the regular chain so it cannot overtake blocks that are still being written.
+    /// </remarks>
+    inline void queued_multi_interface_packet_filter::dispatch_processed_block(block_queue::block_ptr&& packet_block_ptr)
+    {
+        if (options_.routing == routing_mode::direct &&
+            mstcp_stage_blocks_.load(std::memory_order_acquire) == 0)
+        {
+            const auto mstcp_packets = packet_block_ptr->get_write_mstcp_request().size();
+            const auto adapter_packets = packet_block_ptr->get_write_adapter_request().size();
+
+            if (adapter_stage_blocks_.load(std::memory_order_acquire) == 0 &&
+                mstcp_packets + adapter_packets <= options_.inline_write_threshold)
+            {
+                send_mstcp_request(*packet_block_ptr);
+                send_adapter_request(*packet_block_ptr);
+                packet_read_queue_.push(std::move(packet_block_ptr));
+                return;
+            }
+
+            if (mstcp_packets == 0)
+            {
+                if (adapter_packets == 0 && adapter_stage_blocks_.load(std::memory_order_acquire) == 0)
                 {
-                    if ((*packet_block_ptr)[i].m_dwDeviceFlags == PACKET_FLAG_ON_RECEIVE)
-                    {
-                        write_adapter_request.push_back(&(*packet_block_ptr)[i]);
-                    }
-                    else
-                    {
-                        write_mstcp_request.push_back(&(*packet_block_ptr)[i]);
-                    }
+                    packet_read_queue_.push(std::move(packet_block_ptr));
+                    return;
                 }
+
+                adapter_stage_blocks_.fetch_add(1, std::memory_order_relaxed);
+                packet_write_adapter_queue_.push(std::move(packet_block_ptr));
+                return;
             }
+        }
+
+        mstcp_stage_blocks_.fetch_add(1, std::memory_order_relaxed);
+        packet_write_mstcp_queue_.push(std::move(packet_block_ptr));
+    }
 
-            std::lock_guard lk(packet_write_mstcp_queue_lock_);
-            packet_write_mstcp_queue_.push(std::move(packet_block_ptr));
-            packet_write_mstcp_queue_cv_.notify_one();
+    /// <summary>
+    /// Sends the MSTCP bound packets of a block up to the protocol stack and clears the request.
+    /// </summary>
+    /// <param name="packet_block">Packet block.</param>
+    inline void queued_multi_interface_packet_filter::send_mstcp_request(packet_block& packet_block) const
+    {
+        if (auto& write_mstcp_request = packet_block.get_write_mstcp_request(); !write_mstcp_request.empty())
+        {
+            uint32_t packets_sent = 0;
+            SendPacketsToMstcpUnsorted(reinterpret_cast<PINTERMEDIATE_BUFFER*>(write_mstcp_request.data()),
+                static_cast<DWORD>(write_mstcp_request.size()), reinterpret_cast<PDWORD>(&packets_sent));
+            write_mstcp_request.clear();
         }
     }
 
+    /// <summary>
+    /// Sends the adapter bound packets of a block to the network adapters and clears the request.
+    /// </summary>
+    /// <param name="packet_block">Packet block.</param>
+    inline void queued_multi_interface_packet_filter::send_adapter_request(packet_block& packet_block) const
+    {
+        if (auto& write_adapter_request = packet_block.get_write_adapter_request(); !write_adapter_request.empty())
+        {
+            uint32_t packets_sent = 0;
+            SendPacketsToAdaptersUnsorted(reinterpret_cast<PINTERMEDIATE_BUFFER*>(write_adapter_request.data()),
+                static_cast<DWORD>(write_adapter_request.size()), reinterpret_cast<PDWORD>(&packets_sent));
+            write_adapter_request.clear();
+        }
+    }
+
+    /// <summary>
+    /// Executes the classification worker thread logic.
+    /// </summary>
+    /// <param name="worker_index">Index of the shard handled by this worker.</param>
+    /// <remarks>
+    /// The worker parks on classification_generation_ until the processing thread publishes a new block,
+    /// classifies the packets of its shard into packet_actions_ and decrements classification_pending_;
+    /// the last worker to finish wakes the processing thread. The worker exits once the processing thread
+    /// raises classification_exit_, which only happens while no block is outstanding.
+    /// </remarks>
+    inline void queued_multi_interface_packet_filter::packet_classification_worker(const uint32_t worker_index)
+    {
+        uint32_t generation = 0;
+
+        for (;;)
+        {
+            classification_generation_.wait(generation, std::memory_order_acquire);
+            generation = classification_generation_.load(std::memory_order_acquire);
+
+            if (classification_exit_.load(std::memory_order_acquire))
+                return;
+
+            classify_shard(worker_index);
+
+            if (classification_pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                classification_pending_.notify_one();
+        }
+    }
+
+    /// <summary>
+    /// Classifies the packets of a single shard of the current block.
+    /// </summary>
+    /// <param name="worker_index">Shard index.</param>
+    inline void queued_multi_interface_packet_filter::classify_shard(const uint32_t worker_index)
+    {
+        auto& packet_block = *classification_block_;
+
+        for (const auto i : classification_shards_[worker_index])
+        {
+            packet_actions_[i] = classify_packet(packet_block[i]);
+        }
+    }
+
+    /// <summary>
+    /// Runs the user-defined handler matching the packet direction.
+    /// </summary>
+    /// <param name="buffer">Packet to classify.</param>
+    /// <returns>The action returned by the handler or pass if no handler is set for the direction.</returns>
+    inline queued_multi_interface_packet_filter::packet_action queued_multi_interface_packet_filter::classify_packet(
+        intermediate_buffer& buffer) const
+    {
+        if (buffer.m_dwDeviceFlags == PACKET_FLAG_ON_SEND)
+        {
+            if (filter_outgoing_packet_ != nullptr)
+                return filter_outgoing_packet_(buffer.m_hAdapter, buffer);
+        }
+        else
+        {
+            if (filter_incoming_packet_ != nullptr)
+                return filter_incoming_packet_(buffer.m_hAdapter, buffer);
+        }
+
+        return packet_action(packet_action::action_type::pass);
+    }
+
+    /// <summary>
+    /// Applies the packet action and places the packet into the matching write request.
+    /// </summary>
+    /// <param name="packet_block">Block containing the packet.</param>
+    /// <param name="index">Index of the packet in the block.</param>
+    /// <param name="action">Action to apply.</param>
+    inline void queued_multi_interface_packet_filter::route_packet(packet_block& packet_block, const std::size_t index,
+        const packet_action& action)
+    {
+        auto& buffer = packet_block[index];
+
+        // Alter target interface if requested
+        if (action.interface_handle)
+        {
+            buffer.m_hAdapter = action.interface_handle.value();
+        }
+
+        // Place packet back into the flow if was allowed to
+        if (action.action == packet_action::action_type::pass)
+        {
+            if (buffer.m_dwDeviceFlags == PACKET_FLAG_ON_SEND)
+            {
+                packet_block.get_write_adapter_request().push_back(&buffer);
+            }
+            else
+            {
+                packet_block.get_write_mstcp_request().push_back(&buffer);
+            }
+        }
+        else if (action.action == packet_action::action_type::revert)
+        {
+            if (buffer.m_dwDeviceFlags == PACKET_FLAG_ON_RECEIVE)
+            {
+                packet_block.get_write_adapter_request().push_back(&buffer);
+            }
+            else
+            {
+                packet_block.get_write_mstcp_request().push_back(&buffer);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Computes a direction independent flow hash of a packet.
+    /// </summary>
+    /// <param name="buffer">Packet to hash.</param>
+    /// <returns>Symmetric flow hash, zero for non-IP frames.</returns>
+    /// <remarks>
+    /// Addresses and ports are ordered before mixing, so both directions of a conversation map to the same
+    /// classification shard. Ports are only taken into account for unfragmented (or first fragment) TCP and UDP.
+    /// </remarks>
+    inline uint32_t queued_multi_interface_packet_filter::flow_hash(const intermediate_buffer& buffer) noexcept
+    {
+        if (buffer.m_Length < sizeof(ether_header))
+            return 0;
+
+        const auto* const ethernet_header = reinterpret_cast<const ether_header*>(buffer.m_IBuffer);
+        const auto* const frame_end = buffer.m_IBuffer + buffer.m_Length;
+
+        uint32_t address_a = 0;
+        uint32_t address_b = 0;
+        uint8_t protocol = 0;
+        const uint8_t* transport = nullptr;
+
+        switch (ntohs(ethernet_header->h_proto))
+        {
+        case ETH_P_IP:
+        {
+            const auto* const ip_header = reinterpret_cast<const iphdr*>(ethernet_header + 1);
+            if (reinterpret_cast<const uint8_t*>(ip_header + 1) > frame_end)
+                return 0;
+
+            std::memcpy(&address_a, &ip_header->ip_src, sizeof(address_a));
+            std::memcpy(&address_b, &ip_header->ip_dst, sizeof(address_b));
+            protocol = ip_header->ip_p;
+
+            // Only the first fragment carries the transport header
+            if ((ntohs(ip_header->ip_off) & 0x1fff) == 0)
+                transport = reinterpret_cast<const uint8_t*>(ip_header) + sizeof(DWORD) * ip_header->ip_hl;
+            break;
+        }
+        case ETH_P_IPV6:
+        {
+            const auto* const ip_header = reinterpret_cast<const ipv6hdr*>(ethernet_header + 1);
+            if (reinterpret_cast<const uint8_t*>(ip_header + 1) > frame_end)
+                return 0;
+
+            // Fold the 128-bit addresses into 32 bits
+            std::array<uint32_t, 4> words{};
+            std::memcpy(words.data(), &ip_header->ip6_src, sizeof(words));
+            address_a = words[0] ^ words[1] ^ words[2] ^ words[3];
+            std::memcpy(words.data(), &ip_header->ip6_dst, sizeof(words));
+            address_b = words[0] ^ words[1] ^ words[2] ^ words[3];
+            protocol = ip_header->ip6_next;
+            transport = reinterpret_cast<const uint8_t*>(ip_header + 1);
+            break;
+        }
+        default:
+            return 0;
+        }
+
+        uint16_t port_a = 0;
+        uint16_t port_b = 0;
+
+        if ((protocol == IPPROTO_TCP || protocol == IPPROTO_UDP) &&
+            transport != nullptr && transport + 2 * sizeof(uint16_t) <= frame_end)
+        {
+            std::memcpy(&port_a, transport, sizeof(port_a));
+            std::memcpy(&port_b, transport + sizeof(port_a), sizeof(port_b));
+        }
+
+        if (address_a > address_b)
+            std::swap(address_a, address_b);
+        if (port_a > port_b)
+            std::swap(port_a, port_b);
+
+        uint64_t key = (static_cast<uint64_t>(address_a) << 32 | address_b) ^
+            ((static_cast<uint64_t>(port_a) << 24 | static_cast<uint64_t>(port_b) << 8 | protocol) * 0x9E3779B97F4A7C15ull);
+
+        // 64-bit finalizer (MurmurHash3 fmix64)
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdull;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ull;
+        key ^= key >> 33;
+
+        return static_cast<uint32_t>(key);
+    }
+
     /// <summary>
     /// Executes the packet writing to MSTCP stack thread logic.
     /// </summary>
     /// <remarks>
     /// This method runs in a dedicated thread and is responsible for writing packets back to the MSTCP stack.
     /// It waits for packets to be available in the packet_write_mstcp_queue_. When packets are available, it processes them by
-    /// sending them up the protocol stack using the SendPacketsToMstcpUnsorted function. The method uses a condition variable
-    /// to wait for packets efficiently and exits gracefully if the filter state changes from running to another state. After
-    /// packets are sent, they are moved to the packet_write_adapter_queue_ for further processing.
+    /// sending them up the protocol stack using the SendPacketsToMstcpUnsorted function. The method blocks on the stage queue
+    /// while it is empty and exits gracefully once the queue is closed or the filter state changes from running to another state. After
+    /// packets are sent, they are moved to the packet_write_adapter_queue_ for further processing. In routing_mode::direct a block
+    /// without adapter bound packets is returned to the packet_read_queue_ instead, provided the write-adapter stage is idle.
     /// </remarks>
     inline void queued_multi_interface_packet_filter::packet_write_mstcp_thread()
     {
         while (filter_state_ == filter_state::running)
         {
-            std::unique_lock lock(packet_write_mstcp_queue_lock_);
-
-            packet_write_mstcp_queue_cv_.wait(lock, [this]
-                {
-                    return filter_state_ != filter_state::running || !
-                        packet_write_mstcp_queue_.empty();
-                });
+            auto packet_block_ptr = packet_write_mstcp_queue_.pop();
 
-            if (filter_state_ != filter_state::running)
+            if (!packet_block_ptr || filter_state_ != filter_state::running)
                 return;
 
-            auto packet_block_ptr = std::move(packet_write_mstcp_queue_.front());
-            packet_write_mstcp_queue_.pop();
-
-            lock.unlock();
+            send_mstcp_request(*packet_block_ptr);
 
-            if (auto& write_mstcp_request = packet_block_ptr->get_write_mstcp_request(); !write_mstcp_request.empty())
+            if (options_.routing == routing_mode::direct &&
+                packet_block_ptr->get_write_adapter_request().empty() &&
+                adapter_stage_blocks_.load(std::memory_order_acquire) == 0)
             {
-                uint32_t packets_sent = 0;
-                SendPacketsToMstcpUnsorted(reinterpret_cast<PINTERMEDIATE_BUFFER*>(write_mstcp_request.data()),
-                    static_cast<DWORD>(write_mstcp_request.size()), reinterpret_cast<PDWORD>(&packets_sent));
-                write_mstcp_request.clear();
+                packet_read_queue_.push(std::move(packet_block_ptr));
+            }
+            else
+            {
+                adapter_stage_blocks_.fetch_add(1, std::memory_order_relaxed);
+                packet_write_adapter_queue_.push(std::move(packet_block_ptr));
             }
 
-            std::lock_guard lk(packet_write_adapter_queue_lock_);
-            packet_write_adapter_queue_.push(std::move(packet_block_ptr));
-            packet_write_adapter_queue_cv_.notify_one();
+            mstcp_stage_blocks_.fetch_sub(1, std::memory_order_release);
         }
     }
 
@@ -1120,41 +1861,24 @@ namespace ndisapi
     /// <remarks>
     /// This method runs in a dedicated thread and is responsible for writing packets to the network adapters.
     /// It waits for packets to be available in the packet_write_adapter_queue_. When packets are available, it processes them by
-    /// sending them to the network adapters using the SendPacketsToAdaptersUnsorted function. The method uses a condition variable
-    /// to wait for packets efficiently and exits gracefully if the filter state changes from running to another state. After
+    /// sending them to the network adapters using the SendPacketsToAdaptersUnsorted function. The method blocks on the stage queue
+    /// while it is empty and exits gracefully once the queue is closed or the filter state changes from running to another state. After
     /// packets are sent, they are moved to the packet_read_queue_ for further processing.
     /// </remarks>
     inline void queued_multi_interface_packet_filter::packet_write_adapter_thread()
     {
         while (filter_state_ == filter_state::running)
         {
-            std::unique_lock lock(packet_write_adapter_queue_lock_);
-
-            packet_write_adapter_queue_cv_.wait(lock, [this]
-                {
-                    return filter_state_ != filter_state::running || !
-                        packet_write_adapter_queue_.empty();
-                });
+            auto packet_block_ptr = packet_write_adapter_queue_.pop();
 
-            if (filter_state_ != filter_state::running)
+            if (!packet_block_ptr || filter_state_ != filter_state::running)
                 return;
 
-            auto packet_block_ptr = std::move(packet_write_adapter_queue_.front());
-            packet_write_adapter_queue_.pop();
-
-            lock.unlock();
-
-            if (auto& write_adapter_request = packet_block_ptr->get_write_adapter_request(); !write_adapter_request.empty())
-            {
-                uint32_t packets_sent = 0;
-                SendPacketsToAdaptersUnsorted(reinterpret_cast<PINTERMEDIATE_BUFFER*>(write_adapter_request.data()),
-                    static_cast<DWORD>(write_adapter_request.size()), reinterpret_cast<PDWORD>(&packets_sent));
-                write_adapter_request.clear();
-            }
+            send_adapter_request(*packet_block_ptr);
 
-            std::lock_guard lk(packet_read_queue_lock_);
             packet_read_queue_.push(std::move(packet_block_ptr));
-            packet_read_queue_cv_.notify_one();
+
+            adapter_stage_blocks_.fetch_sub(1, std::memory_order_release);
         }
     }
 }
@@ -8,8 +8,9 @@ namespace ndisapi
     *
     * This class manages UDP endpoint tracking and packet translation for redirecting
     * client UDP traffic to a local SOCKS5 proxy. It supports both IPv4 and IPv6 and
-    * provides NAT functionality for UDP source ports. Timed-out endpoints are cleaned
-    * up automatically in a background thread.
+    * provides NAT functionality for UDP source ports. Endpoints are tracked in a port-indexed
+    * table of atomic timestamps, so per-datagram processing takes no locks; timed-out endpoints
+    * are cleaned up automatically in a background thread.
     *
     * @tparam T IP address type (net::ip_address_v4 or net::ip_address_v6).
     */
@@ -24,18 +25,22 @@ namespace ndisapi
         using logger = netlib::log::logger<socks5_udp_local_redirect>;
 
         /// <summary>
-        /// Maps client UDP endpoint (port or endpoint) to the timestamp of last activity.
-        /// Used for tracking active UDP sessions.
+        /// Inactivity period after which a client UDP endpoint is removed.
         /// </summary>
-        std::unordered_map<uint16_t, std::chrono::steady_clock::time_point> endpoints_;
+        static constexpr std::chrono::minutes endpoint_timeout{ 15 };
         /// <summary>
-        /// Proxy port in network byte order.
+        /// Interval between two cleanup passes.
         /// </summary>
-        u_short proxy_port_{};
+        static constexpr std::chrono::seconds cleanup_interval{ 5 };
+        /// <summary>
+        /// Client UDP source ports (network byte order) with the timestamp of last activity.
+        /// A newly added port is pending until the local proxy claims it via take_pending_endpoint().
+        /// </summary>
+        net::port_activity_table endpoints_{ endpoint_timeout, cleanup_interval };
         /// <summary>
-        /// Mutex for synchronizing access to endpoints_.
+        /// Proxy port in network byte order.
         /// </summary>
-        std::mutex lock_;
+        u_short proxy_port_{};
         /// <summary>
         /// Thread for cleaning up timed-out UDP endpoints.
         /// </summary>
@@ -48,8 +53,8 @@ namespace ndisapi
         /**
          * @brief Starts the background cleanup thread.
          *
-         * The thread periodically scans the endpoints_ map and removes entries
-         * that have been inactive for more than 15 minutes.
+         * Every cleanup_interval the thread removes the endpoints that have been inactive
+         * for more than endpoint_timeout; only endpoints whose timeout is due are visited.
          */
         void start_cleanup_thread()
         {
@@ -57,29 +62,16 @@ namespace ndisapi
                 {
                     while (!terminate_)
                     {
-                        {
-                            auto current_time = std::chrono::steady_clock::now();
-                            std::lock_guard lock(lock_);
-
-                            tools::generic::erase_if(endpoints_, endpoints_.begin(), endpoints_.end(),
-                                [&current_time, this](auto&& a)
-                                {
-                                    using namespace std::chrono_literals;
-                                    if (current_time - a.second > 15min)
-                                    {
-                                        NETLIB_INFO(
-                                            "DELETE UDP client endpoint (timeout): : {}",
-                                            ntohs(a.first));
-
-                                        return true;
-                                    }
-                                    return false;
-                                });
-                        }
+                        endpoints_.expire([this](const uint16_t port)
+                            {
+                                NETLIB_INFO(
+                                    "DELETE UDP client endpoint (timeout): : {}",
+                                    ntohs(port));
+                            });
 
                         // Check terminate_ more frequently during sleep to allow faster shutdown
                         using namespace std::chrono_literals;
-                        for (int i = 0; i < 50 && !terminate_; ++i)
+                        for (int i = 0; i < cleanup_interval / 100ms && !terminate_; ++i)
                         {
                             std::this_thread::sleep_for(100ms);
                         }
@@ -203,14 +195,8 @@ namespace ndisapi
                     ip_header) +
                     sizeof(DWORD) * ip_header->ip_hl);
 
-                std::lock_guard lock(lock_);
-
-                if (const auto it = endpoints_.find(udp_header->th_sport); it
-                    == endpoints_.cend())
+                if (endpoints_.try_add(udp_header->th_sport))
                 {
-                    endpoints_[udp_header->th_sport] =
-                        std::chrono::steady_clock::now();
-
                     NETLIB_INFO(
                         "NEW client UDP endpoint: : {}",
                         ntohs(udp_header->th_sport));
@@ -234,13 +220,8 @@ namespace ndisapi
 
                 const auto* udp_header = static_cast<udphdr_ptr>(p_header);
 
-                std::lock_guard lock(lock_);
-
-                if (const auto it = endpoints_.find(udp_header->th_sport); it == endpoints_.cend())
+                if (endpoints_.try_add(udp_header->th_sport))
                 {
-                    endpoints_[udp_header->th_sport] =
-                        std::chrono::steady_clock::now();
-
                     NETLIB_INFO(
                         "NEW client UDP endpoint: : {}",
                         ntohs(udp_header->th_sport));
@@ -254,6 +235,20 @@ namespace ndisapi
             return false;
         }
 
+        /**
+         * @brief Claims a client endpoint recorded by is_new_endpoint() for the local proxy.
+         *
+         * Each endpoint can be claimed once per registration, so a second proxy association
+         * attempt from the same source port is rejected.
+         *
+         * @param port Client UDP source port (host byte order).
+         * @return True if the endpoint was registered and not yet claimed.
+         */
+        bool take_pending_endpoint(const uint16_t port) noexcept
+        {
+            return endpoints_.take_pending(htons(port));
+        }
+
         /**
          * @brief Redirects a C2S UDP packet to the local proxy and applies NAT to the source port.
          *
@@ -262,9 +257,12 @@ namespace ndisapi
          *
          * @param packet C2S network packet.
          * @param port Destination port to forward the packet to (network byte order). If 0, uses proxy_port_.
+         * @param checksum_offload True to leave checksums pending offload to the adapter (see network_adapter::set_checksum_offload).
+         * Only for a packet sent out through that adapter, a reverted packet needs complete checksums.
          * @return True if the packet was translated, false otherwise.
          */
-        bool process_client_to_server_packet(INTERMEDIATE_BUFFER& packet, uint16_t port = 0)
+        bool process_client_to_server_packet(INTERMEDIATE_BUFFER& packet, uint16_t port = 0,
+                                             const bool checksum_offload = false)
         {
             if (port == 0)
                 port = proxy_port_;
@@ -288,12 +286,8 @@ namespace ndisapi
                 auto* udp_header = reinterpret_cast<udphdr*>(reinterpret_cast<unsigned char*>(ip_header) +
                     sizeof(DWORD) * ip_header->ip_hl);
 
-                std::lock_guard lock(lock_);
-
                 // existing connection
-                const auto it = endpoints_.find(udp_header->th_sport);
-
-                if (it == endpoints_.cend())
+                if (!endpoints_.touch(udp_header->th_sport))
                 {
                     return false;
                 }
@@ -313,9 +307,20 @@ namespace ndisapi
                 memmove(udp_payload + sizeof(proxy::socks5_udp_header<T>), udp_payload,
                     std::min(udp_payload_size, udp_max_payload_size));
 
+                net::checksum_delta ip_delta;
+                net::checksum_delta udp_delta;
+                net::checksum_delta pseudo_header_delta;
+
                 packet.m_Length += sizeof(proxy::socks5_udp_header<T>);
-                ip_header->ip_len = htons(ntohs(ip_header->ip_len) + sizeof(proxy::socks5_udp_header<T>));
-                udp_header->length = htons(ntohs(udp_header->length) + sizeof(proxy::socks5_udp_header<T>));
+                const auto ip_length = htons(ntohs(ip_header->ip_len) + sizeof(proxy::socks5_udp_header<T>));
+                ip_delta.replace(ip_header->ip_len, ip_length);
+                ip_header->ip_len = ip_length;
+                const auto udp_length = htons(ntohs(udp_header->length) + sizeof(proxy::socks5_udp_header<T>));
+                // The UDP length is covered twice: in the header and in the pseudo-header
+                udp_delta.replace(udp_header->length, udp_length);
+                udp_delta.replace(udp_header->length, udp_length);
+                pseudo_header_delta.replace(udp_header->length, udp_length);
+                udp_header->length = udp_length;
                 auto* socks5_udp_header_ptr = reinterpret_cast<proxy::socks5_udp_header<T>*>(udp_payload);
 
                 socks5_udp_header_ptr->reserved = 0;
@@ -323,6 +328,7 @@ namespace ndisapi
                 socks5_udp_header_ptr->address_type = 1;
                 socks5_udp_header_ptr->dest_address = ip_header->ip_dst;
                 socks5_udp_header_ptr->dest_port = udp_header->th_dport;
+                udp_delta.add(socks5_udp_header_ptr, sizeof(proxy::socks5_udp_header<T>));
 
                 // Swap Ethernet addresses
                 std::swap(eth_header->h_dest, eth_header->h_source);
@@ -330,12 +336,27 @@ namespace ndisapi
                 // Swap IP addresses
                 std::swap(ip_header->ip_dst, ip_header->ip_src);
 
+                udp_delta.replace(udp_header->th_dport, port);
                 udp_header->th_dport = port;
 
-                CNdisApi::RecalculateUDPChecksum(&packet);
-                CNdisApi::RecalculateIPChecksum(&packet);
-
-                it->second = std::chrono::steady_clock::now();
+                // The payload moved by an even number of bytes, so its sum is unchanged. Checksums left
+                // to an offloading adapter only need their pseudo-header sum adjusted and complete ones
+                // are updated; otherwise, or if the payload had to be clipped, recalculate fully.
+                if (checksum_offload && intermediate_buffer::is_checksum_pending(packet))
+                {
+                    pseudo_header_delta.apply_pseudo_header(udp_header->th_sum);
+                }
+                else if (intermediate_buffer::has_complete_checksum(packet) &&
+                    udp_payload_size + sizeof(proxy::socks5_udp_header<T>) <= udp_max_payload_size)
+                {
+                    udp_delta.apply_udp(udp_header->th_sum);
+                    ip_delta.apply(ip_header->ip_sum);
+                }
+                else
+                {
+                    net::ip_checksum::recalculate_ipv4_transport(packet);
+                    net::ip_checksum::recalculate_ipv4_header(packet);
+                }
 
                 NETLIB_DEBUG(
                     "C2S: {}:{} -> {}:{}",
@@ -360,11 +381,7 @@ namespace ndisapi
 
                 auto* udp_header = static_cast<udphdr_ptr>(p_header);
 
-                std::lock_guard lock(lock_);
-
-                const auto it = endpoints_.find(udp_header->th_sport);
-
-                if (it == endpoints_.cend())
+                if (!endpoints_.touch(udp_header->th_sport))
                 {
                     return false;
                 }
@@ -385,9 +402,15 @@ namespace ndisapi
                 memmove(udp_payload + sizeof(proxy::socks5_udp_header<T>), udp_payload,
                     std::min(udp_payload_size, udp_max_payload_size));
 
+                net::checksum_delta udp_delta;
+
                 packet.m_Length += sizeof(proxy::socks5_udp_header<T>);
                 ip_header->ip6_len = htons(ntohs(ip_header->ip6_len) + sizeof(proxy::socks5_udp_header<T>));
-                udp_header->length = htons(ntohs(udp_header->length) + sizeof(proxy::socks5_udp_header<T>));
+                const auto udp_length = htons(ntohs(udp_header->length) + sizeof(proxy::socks5_udp_header<T>));
+                // The UDP length is covered twice: in the header and in the pseudo-header
+                udp_delta.replace(udp_header->length, udp_length);
+                udp_delta.replace(udp_header->length, udp_length);
+                udp_header->length = udp_length;
                 auto* socks5_udp_header_ptr = reinterpret_cast<proxy::socks5_udp_header<T>*>(udp_payload);
 
                 socks5_udp_header_ptr->reserved = 0;
@@ -395,6 +418,7 @@ namespace ndisapi
                 socks5_udp_header_ptr->address_type = 4; // For IPv6 address type is 4
                 socks5_udp_header_ptr->dest_address = ip_header->ip6_dst;
                 socks5_udp_header_ptr->dest_port = udp_header->th_dport;
+                udp_delta.add(socks5_udp_header_ptr, sizeof(proxy::socks5_udp_header<T>));
 
                 // Swap Ethernet addresses
                 std::swap(eth_header->h_dest, eth_header->h_source);
@@ -402,12 +426,20 @@ namespace ndisapi
                 // Swap IP addresses
                 std::swap(ip_header->ip6_dst, ip_header->ip6_src);
 
+                udp_delta.replace(udp_header->th_dport, port);
                 udp_header->th_dport = port;
 
-                // Recalculate checksum
-                net::ipv6_helper::recalculate_tcp_udp_checksum(&packet);
-
-                it->second = std::chrono::steady_clock::now();
+                // The payload moved by an even number of bytes, so its sum is unchanged. Recalculate fully
+                // unless the checksum is complete and present (mandatory over IPv6) and nothing was clipped.
+                if (intermediate_buffer::has_complete_checksum(packet) && udp_header->th_sum != 0 &&
+                    udp_payload_size + sizeof(proxy::socks5_udp_header<T>) <= udp_max_payload_size)
+                {
+                    udp_delta.apply_udp(udp_header->th_sum);
+                }
+                else
+                {
+                    net::ipv6_helper::recalculate_tcp_udp_checksum(&packet);
+                }
 
                 NETLIB_DEBUG(
                     "C2S: {}:{} -> {}:{}",
@@ -429,9 +461,11 @@ namespace ndisapi
          * addresses and ports as needed.
          *
          * @param packet S2C network packet.
+         * @param checksum_offload True to leave checksums pending offload to the adapter (see network_adapter::set_checksum_offload).
+         * Only for a packet sent out through that adapter, a reverted packet needs complete checksums.
          * @return True if the packet was translated, false otherwise.
          */
-        bool process_server_to_client_packet(INTERMEDIATE_BUFFER& packet)
+        bool process_server_to_client_packet(INTERMEDIATE_BUFFER& packet, const bool checksum_offload = false)
         {
             if constexpr (auto* const eth_header = reinterpret_cast<ether_header_ptr>(packet.m_IBuffer); std::is_same_v<
                 net::ip_address_v4, std::decay_t<T>>)
@@ -452,11 +486,7 @@ namespace ndisapi
                 auto* udp_header = reinterpret_cast<udphdr*>(reinterpret_cast<unsigned char*>(ip_header) +
                     sizeof(DWORD) * ip_header->ip_hl);
 
-                std::lock_guard lock(lock_);
-
-                const auto it = endpoints_.find(udp_header->th_dport);
-
-                if (it == endpoints_.cend())
+                if (!endpoints_.touch(udp_header->th_dport))
                     return false;
 
                 NETLIB_DEBUG(
@@ -475,6 +505,17 @@ namespace ndisapi
                 auto* udp_payload = reinterpret_cast<uint8_t*>(udp_header + 1);
                 auto* socks5_udp_header_ptr = reinterpret_cast<proxy::socks5_udp_header<T>*>(udp_payload);
 
+                net::checksum_delta ip_delta;
+                net::checksum_delta udp_delta;
+                net::checksum_delta pseudo_header_delta;
+
+                // The source address is covered by the IP header and by the UDP pseudo-header
+                ip_delta.replace(&ip_header->ip_src, &socks5_udp_header_ptr->dest_address, sizeof(ip_header->ip_src));
+                udp_delta.replace(&ip_header->ip_src, &socks5_udp_header_ptr->dest_address, sizeof(ip_header->ip_src));
+                pseudo_header_delta.replace(&ip_header->ip_src, &socks5_udp_header_ptr->dest_address, sizeof(ip_header->ip_src));
+                udp_delta.replace(udp_header->th_sport, socks5_udp_header_ptr->dest_port);
+                udp_delta.remove(socks5_udp_header_ptr, sizeof(proxy::socks5_udp_header<T>));
+
                 ip_header->ip_src = socks5_udp_header_ptr->dest_address;
                 udp_header->th_sport = socks5_udp_header_ptr->dest_port;
 
@@ -483,13 +524,31 @@ namespace ndisapi
                     udp_payload_size - sizeof(proxy::socks5_udp_header<T>));
 
                 packet.m_Length -= sizeof(proxy::socks5_udp_header<T>);
-                ip_header->ip_len = htons(ntohs(ip_header->ip_len) - sizeof(proxy::socks5_udp_header<T>));
-                udp_header->length = htons(ntohs(udp_header->length) - sizeof(proxy::socks5_udp_header<T>));
-
-                CNdisApi::RecalculateUDPChecksum(&packet);
-                CNdisApi::RecalculateIPChecksum(&packet);
-
-                it->second = std::chrono::steady_clock::now();
+                const auto ip_length = htons(ntohs(ip_header->ip_len) - sizeof(proxy::socks5_udp_header<T>));
+                ip_delta.replace(ip_header->ip_len, ip_length);
+                ip_header->ip_len = ip_length;
+                const auto udp_length = htons(ntohs(udp_header->length) - sizeof(proxy::socks5_udp_header<T>));
+                udp_delta.replace(udp_header->length, udp_length);
+                udp_delta.replace(udp_header->length, udp_length);
+                pseudo_header_delta.replace(udp_header->length, udp_length);
+                udp_header->length = udp_length;
+
+                // Checksums left to an offloading adapter only need their pseudo-header sum adjusted and
+                // complete ones are updated, any other checksum is computed fully
+                if (checksum_offload && intermediate_buffer::is_checksum_pending(packet))
+                {
+                    pseudo_header_delta.apply_pseudo_header(udp_header->th_sum);
+                }
+                else if (intermediate_buffer::has_complete_checksum(packet))
+                {
+                    udp_delta.apply_udp(udp_header->th_sum);
+                    ip_delta.apply(ip_header->ip_sum);
+                }
+                else
+                {
+                    net::ip_checksum::recalculate_ipv4_transport(packet);
+                    net::ip_checksum::recalculate_ipv4_header(packet);
+                }
 
                 NETLIB_DEBUG(
                     "S2C: {}:{} -> {}:{}",
@@ -514,11 +573,7 @@ namespace ndisapi
 
                 auto* udp_header = static_cast<udphdr_ptr>(p_header);
 
-                std::lock_guard lock(lock_);
-
-                const auto it = endpoints_.find(udp_header->th_dport);
-
-                if (it == endpoints_.cend())
+                if (!endpoints_.touch(udp_header->th_dport))
                     return false;
 
                 NETLIB_DEBUG(
@@ -538,6 +593,12 @@ namespace ndisapi
                 auto* udp_payload = reinterpret_cast<uint8_t*>(udp_header + 1);
                 auto* socks5_udp_header_ptr = reinterpret_cast<proxy::socks5_udp_header<T>*>(udp_payload);
 
+                net::checksum_delta udp_delta;
+
+                udp_delta.replace(&ip_header->ip6_src, &socks5_udp_header_ptr->dest_address, sizeof(ip_header->ip6_src));
+                udp_delta.replace(udp_header->th_sport, socks5_udp_header_ptr->dest_port);
+                udp_delta.remove(socks5_udp_header_ptr, sizeof(proxy::socks5_udp_header<T>));
+
                 ip_header->ip6_src = socks5_udp_header_ptr->dest_address;
                 udp_header->th_sport = socks5_udp_header_ptr->dest_port;
 
@@ -547,12 +608,21 @@ namespace ndisapi
 
                 packet.m_Length -= sizeof(proxy::socks5_udp_header<T>);
                 ip_header->ip6_len = htons(ntohs(ip_header->ip6_len) - sizeof(proxy::socks5_udp_header<T>));
-                udp_header->length = htons(ntohs(udp_header->length) - sizeof(proxy::socks5_udp_header<T>));
-
-                // Recalculate checksum
-                net::ipv6_helper::recalculate_tcp_udp_checksum(&packet);
-
-                it->second = std::chrono::steady_clock::now();
+                const auto udp_length = htons(ntohs(udp_header->length) - sizeof(proxy::socks5_udp_header<T>));
+                udp_delta.replace(udp_header->length, udp_length);
+                udp_delta.replace(udp_header->length, udp_length);
+                udp_header->length = udp_length;
+
+                // Only a complete checksum is updated, a zero UDP checksum is not allowed over IPv6 and
+                // any other is computed fully
+                if (intermediate_buffer::has_complete_checksum(packet) && udp_header->th_sum != 0)
+                {
+                    udp_delta.apply_udp(udp_header->th_sum);
+                }
+                else
+                {
+                    net::ipv6_helper::recalculate_tcp_udp_checksum(&packet);
+                }
 
                 NETLIB_DEBUG(
                     "S2C: {}:{} -> {}:{}",
@@ -57,6 +57,11 @@ namespace ndisapi
         /// </summary>
         filter() = default;
 
+        /// <summary>
+        /// Compares all the fields of two filters.
+        /// </summary>
+        bool operator==(const filter& other) const = default;
+
         /// <summary>
         /// Gets the direction of the packet.
         /// </summary>
@@ -278,11 +283,144 @@ namespace ndisapi
         }
     };
 
+    /// <summary>
+    /// Priority groups of the static filter table. The driver evaluates filters in table order,
+    /// static_filters keeps the groups in ascending order and the filters of a group in the order
+    /// they were added. Any value in between can be used for additional groups.
+    /// </summary>
+    namespace filter_group
+    {
+        /// <summary>evaluated before every other group</summary>
+        constexpr uint8_t high = 0;
+        /// <summary>group of add_filter_front(), add_filter_back() and loaded tables</summary>
+        constexpr uint8_t normal = 128;
+        /// <summary>evaluated after every other group, e.g. generated per-flow filters</summary>
+        constexpr uint8_t low = 255;
+    }
+
     class static_filters final : public CNdisApi, public netlib::log::logger<static_filters>
     {
         using log_level = netlib::log::log_level;
 
     public:
+        /// <summary>
+        /// Filter of either address family.
+        /// </summary>
+        using filter_type = std::variant<filter<net::ip_address_v4>, filter<net::ip_address_v6>>;
+
+    private:
+        /// <summary>
+        /// Filter of the table and its priority group.
+        /// </summary>
+        struct entry
+        {
+            /// <summary>the filter</summary>
+            filter_type filter;
+            /// <summary>priority group, see filter_group</summary>
+            uint8_t group;
+        };
+
+    public:
+        /// <summary>
+        /// Largest number of changes a commit applies filter by filter, larger batches replace the whole
+        /// table with a single SetPacketFilterTable call.
+        /// </summary>
+        static constexpr std::size_t max_incremental_changes = 8;
+
+        /// <summary>
+        /// Batch of filter table changes applied by a single commit().
+        /// </summary>
+        /// <remarks>
+        /// Removals apply to the filters in the table when commit() is called, additions are appended to
+        /// their group in the order they were added to the batch. commit() compares the resulting table to
+        /// the current one and either applies the difference with individual insert/remove calls or, for
+        /// more than max_incremental_changes changes, stores the whole table at once, so the driver table
+        /// lock is taken once per batch rather than once per filter. Not thread-safe, like static_filters.
+        /// </remarks>
+        class update
+        {
+            friend class static_filters;
+
+            explicit update(static_filters& owner) : owner_(owner)
+            {
+            }
+
+        public:
+            /// <summary>
+            /// Adds a filter at the end of a priority group.
+            /// </summary>
+            /// <typeparam name="T">The type of the IP address (IPv4 or IPv6).</typeparam>
+            /// <param name="filter">The filter to add.</param>
+            /// <param name="group">The priority group.</param>
+            /// <returns>A reference to the batch.</returns>
+            template <net::ip_address T>
+            update& add(const filter<T>& filter, const uint8_t group = filter_group::normal)
+            {
+                additions_.push_back(entry{ filter, group });
+                return *this;
+            }
+
+            /// <summary>
+            /// Removes the filters equal to the given one.
+            /// </summary>
+            /// <typeparam name="T">The type of the IP address (IPv4 or IPv6).</typeparam>
+            /// <param name="filter">The filter to remove.</param>
+            /// <returns>A reference to the batch.</returns>
+            template <net::ip_address T>
+            update& remove(const filter<T>& filter)
+            {
+                removals_.emplace_back(filter);
+                return *this;
+            }
+
+            /// <summary>
+            /// Removes the filters of the address family T matching a predicate.
+            /// </summary>
+            /// <typeparam name="T">The type of the IP address (IPv4 or IPv6).</typeparam>
+            /// <param name="predicate">A function that returns true for the filters to remove.</param>
+            /// <returns>A reference to the batch.</returns>
+            template <net::ip_address T>
+            update& remove_if(std::function<bool(const filter<T>&)> predicate)
+            {
+                predicates_.emplace_back([predicate = std::move(predicate)](const filter_type& candidate)
+                {
+                    const auto* const typed = std::get_if<filter<T>>(&candidate);
+                    return typed != nullptr && predicate(*typed);
+                });
+                return *this;
+            }
+
+            /// <summary>
+            /// Returns true if the batch holds no changes.
+            /// </summary>
+            [[nodiscard]] bool empty() const noexcept
+            {
+                return additions_.empty() && removals_.empty() && predicates_.empty();
+            }
+
+            /// <summary>
+            /// Applies the batch to the filter table and the driver and clears it.
+            /// </summary>
+            /// <returns>True if the driver table was updated; otherwise, false and the table is unchanged.</returns>
+            bool commit()
+            {
+                const auto result = owner_.apply(*this);
+                additions_.clear();
+                removals_.clear();
+                predicates_.clear();
+                return result;
+            }
+
+        private:
+            /// <summary>owner of the filter table</summary>
+            static_filters& owner_;
+            /// <summary>filters to add with their groups</summary>
+            std::vector<entry> additions_;
+            /// <summary>filters to remove</summary>
+            std::vector<filter_type> removals_;
+            /// <summary>predicates selecting filters to remove</summary>
+            std::vector<std::function<bool(const filter_type&)>> predicates_;
+        };
 
         /// <summary>
         /// Constructor for the static_filters class.
@@ -372,7 +510,7 @@ namespace ndisapi
         }
 
         /// <summary>
-        /// Adds a filter to the front of the filter list.
+        /// Adds a filter to the front of the filter_group::normal group of the filter list.
         /// </summary>
         /// <typeparam name="T">The type of the IP address (IPv4 or IPv6).</typeparam>
         /// <param name="filter">The filter to add.</param>
@@ -380,18 +518,20 @@ namespace ndisapi
         template <net::ip_address T>
         bool add_filter_front(const filter<T>& filter)
         {
+            const auto position = group_begin(filter_group::normal);
+
             STATIC_FILTER static_filter{};
             to_static_filter(filter, static_filter);
-            if (AddStaticFilterFront(&static_filter))
+            if (position == 0 ? AddStaticFilterFront(&static_filter) : InsertStaticFilter(&static_filter, position))
             {
-                filters_.emplace_front(filter);
+                filters_.insert(std::next(filters_.begin(), position), entry{ filter, filter_group::normal });
                 return true;
             }
             return false;
         }
 
         /// <summary>
-        /// Adds a filter to the back of the filter list.
+        /// Adds a filter to the back of the filter_group::normal group of the filter list.
         /// </summary>
         /// <typeparam name="T">The type of the IP address (IPv4 or IPv6).</typeparam>
         /// <param name="filter">The filter to add.</param>
@@ -399,11 +539,15 @@ namespace ndisapi
         template <net::ip_address T>
         bool add_filter_back(const filter<T>& filter)
         {
+            const auto position = group_end(filter_group::normal);
+
             STATIC_FILTER static_filter{};
             to_static_filter(filter, static_filter);
-            if (AddStaticFilterBack(&static_filter))
+            if (position == filters_.size()
+                    ? AddStaticFilterBack(&static_filter)
+                    : InsertStaticFilter(&static_filter, position))
             {
-                filters_.emplace_back(filter);
+                filters_.insert(std::next(filters_.begin(), position), entry{ filter, filter_group::normal });
                 return true;
             }
             return false;
@@ -416,6 +560,7 @@ namespace ndisapi
         /// <param name="filter">The filter to insert.</param>
         /// <param name="position">The position at which to insert the filter.</param>
         /// <returns>True if the filter was successfully inserted; otherwise, false.</returns>
+        /// <remarks>The filter joins the group of the filter currently at the position (or of the last filter).</remarks>
         template <net::ip_address T>
         bool insert_filter(const filter<T>& filter, const uint32_t position)
         {
@@ -431,7 +576,11 @@ namespace ndisapi
             {
                 auto it = filters_.begin();
                 std::advance(it, position); // Move the iterator to the desired position
-                filters_.insert(it, filter); // Insert the filter at the position
+
+                const auto group = it != filters_.end()
+                                       ? it->group
+                                       : filters_.empty() ? filter_group::normal : filters_.back().group;
+                filters_.insert(it, entry{ filter, group }); // Insert the filter at the position
                 return true;
             }
             return false;
@@ -466,6 +615,7 @@ namespace ndisapi
         /// </summary>
         /// <typeparam name="T">The type of the IP address (IPv4 or IPv6).</typeparam>
         /// <param name="predicate">A function that takes a filter and returns true if the filter should be removed.</param>
+        /// <remarks>Issues one driver call per removed filter, see begin_update() to batch removals.</remarks>
         template <net::ip_address T>
         void remove_filters_if(std::function<bool(const filter<T>&)> predicate)
         {
@@ -488,7 +638,7 @@ namespace ndisapi
                         }
                     }
                     return false;
-                }, *it))
+                }, it->filter))
                 {
                     it = filters_.erase(it); // Remove the filter from the list and move to the next
                     // Do not increment position since we removed an element
@@ -501,40 +651,30 @@ namespace ndisapi
             }
         }
 
+        /// <summary>
+        /// Starts a batch of filter table changes, see update.
+        /// </summary>
+        /// <returns>An empty batch bound to this filter table.</returns>
+        [[nodiscard]] update begin_update()
+        {
+            return update{ *this };
+        }
+
+        /// <summary>
+        /// Returns the number of filters in the table.
+        /// </summary>
+        [[nodiscard]] std::size_t size() const noexcept
+        {
+            return filters_.size();
+        }
+
         /// <summary>
         /// Stores the current filter table to the driver.
         /// </summary>
         /// <returns>True if the filter table was successfully stored; otherwise, false.</returns>
         bool store_table()
         {
-            try
-            {
-                const size_t filter_size = filters_.size();
-                const auto table_buffer = std::make_unique<uint8_t[]>(sizeof(STATIC_FILTER_TABLE) + sizeof(STATIC_FILTER) * (filter_size - 1));
-                auto* filter_list = reinterpret_cast<PSTATIC_FILTER_TABLE>(table_buffer.get());
-                memset(filter_list, 0, sizeof(STATIC_FILTER_TABLE) + sizeof(STATIC_FILTER) * (filter_size - 1));
-
-                filter_list->m_TableSize = static_cast<uint32_t>(filter_size);
-
-                size_t i = 0; // Initialize index counter outside the loop
-                for (auto it = filters_.begin(); it != filters_.end(); ++it, ++i)
-                {
-                    std::visit([this, &i, &filter_list](auto&& arg)
-                        {
-                            to_static_filter(arg, filter_list->m_StaticFilters[i]);
-                        }, *it);
-                }
-
-                SetPacketFilterTable(filter_list);
-
-                return true;
-            }
-            catch (const std::exception& e)
-            {
-                using namespace std::string_literals;
-                NETLIB_ERROR("Exception occured in store_table: {}", e.what());
-                return false;
-            }
+            return write_table(filters_);
         }
 
         /// <summary>
@@ -573,14 +713,14 @@ namespace ndisapi
                 {
                     filter<net::ip_address_v4> new_filter;
                     from_static_filter(static_filter, new_filter);
-                    filters_.emplace_back(std::move(new_filter));
+                    filters_.push_back(entry{ std::move(new_filter), filter_group::normal });
                     break;
                 }
                 case IPV6:
                 {
                     filter<net::ip_address_v6> new_filter;
                     from_static_filter(static_filter, new_filter);
-                    filters_.emplace_back(std::move(new_filter));
+                    filters_.push_back(entry{ std::move(new_filter), filter_group::normal });
                     break;
                 }
                 default:
@@ -602,6 +742,172 @@ namespace ndisapi
 
     private:
 
+        /// <summary>
+        /// Returns the position of the first filter of a group (where it would start if empty).
+        /// </summary>
+        [[nodiscard]] uint32_t group_begin(const uint8_t group) const
+        {
+            const auto it = std::ranges::find_if(filters_, [group](const entry& e) { return e.group >= group; });
+            return static_cast<uint32_t>(std::distance(filters_.begin(), it));
+        }
+
+        /// <summary>
+        /// Returns the position following the last filter of a group.
+        /// </summary>
+        [[nodiscard]] uint32_t group_end(const uint8_t group) const
+        {
+            const auto it = std::ranges::find_if(filters_, [group](const entry& e) { return e.group > group; });
+            return static_cast<uint32_t>(std::distance(filters_.begin(), it));
+        }
+
+        /// <summary>
+        /// Writes a whole filter table to the driver with a single call.
+        /// </summary>
+        /// <param name="filters">The filters in table order.</param>
+        /// <returns>True if the driver accepted the table; otherwise, false.</returns>
+        template <typename Range>
+        bool write_table(const Range& filters)
+        {
+            try
+            {
+                const size_t filter_size = std::ranges::distance(filters);
+                if (filter_size == 0)
+                {
+                    return ResetPacketFilterTable() != FALSE;
+                }
+
+                const auto table_buffer = std::make_unique<uint8_t[]>(sizeof(STATIC_FILTER_TABLE) + sizeof(STATIC_FILTER) * (filter_size - 1));
+                auto* filter_list = reinterpret_cast<PSTATIC_FILTER_TABLE>(table_buffer.get());
+                memset(filter_list, 0, sizeof(STATIC_FILTER_TABLE) + sizeof(STATIC_FILTER) * (filter_size - 1));
+
+                filter_list->m_TableSize = static_cast<uint32_t>(filter_size);
+
+                size_t i = 0; // Initialize index counter outside the loop
+                for (auto it = std::ranges::begin(filters); it != std::ranges::end(filters); ++it, ++i)
+                {
+                    std::visit([this, &i, &filter_list](auto&& arg)
+                        {
+                            to_static_filter(arg, filter_list->m_StaticFilters[i]);
+                        }, entry_of(*it).filter);
+                }
+
+                return SetPacketFilterTable(filter_list) != FALSE;
+            }
+            catch (const std::exception& e)
+            {
+                using namespace std::string_literals;
+                NETLIB_ERROR("Exception occured in write_table: {}", e.what());
+                return false;
+            }
+        }
+
+        /// <summary>
+        /// Filter of the resulting table while a batch is applied.
+        /// </summary>
+        struct staged_entry
+        {
+            /// <summary>the filter</summary>
+            const entry* staged;
+            /// <summary>true if the batch adds the filter</summary>
+            bool added;
+        };
+
+        /// <summary>
+        /// Returns the table entry of either list element type.
+        /// </summary>
+        static const entry& entry_of(const entry& e) noexcept { return e; }
+        static const entry& entry_of(const staged_entry& e) noexcept { return *e.staged; }
+
+        /// <summary>
+        /// Applies a batch: builds the resulting table and updates the driver with the cheaper of the
+        /// individual changes and a full table write.
+        /// </summary>
+        /// <param name="batch">The changes.</param>
+        /// <returns>True if the driver table was updated; otherwise, false and the table is unchanged.</returns>
+        bool apply(const update& batch)
+        {
+            if (batch.empty())
+                return true;
+
+            const auto removed = [&batch](const filter_type& candidate)
+            {
+                return std::ranges::find(batch.removals_, candidate) != batch.removals_.end() ||
+                    std::ranges::any_of(batch.predicates_, [&candidate](const auto& predicate)
+                    {
+                        return predicate(candidate);
+                    });
+            };
+
+            std::vector<staged_entry> next;
+            std::vector<uint32_t> removed_positions;
+            next.reserve(filters_.size() + batch.additions_.size());
+
+            uint32_t position = 0;
+            for (const auto& current : filters_)
+            {
+                if (removed(current.filter))
+                    removed_positions.push_back(position);
+                else
+                    next.push_back({ &current, false });
+                ++position;
+            }
+
+            // Additions go after the last filter of their group
+            for (const auto& addition : batch.additions_)
+            {
+                const auto it = std::ranges::find_if(next, [&addition](const staged_entry& e)
+                {
+                    return e.staged->group > addition.group;
+                });
+                next.insert(it, { &addition, true });
+            }
+
+            if (removed_positions.empty() && batch.additions_.empty())
+                return true;
+
+            auto written = false;
+
+            if (removed_positions.size() + batch.additions_.size() <= max_incremental_changes)
+            {
+                written = true;
+
+                // Backwards so the positions still to remove are not shifted
+                for (auto it = removed_positions.rbegin(); written && it != removed_positions.rend(); ++it)
+                    written = RemoveStaticFilter(*it) != FALSE;
+
+                // Forwards, each insertion lands at its final position in the resulting table
+                for (uint32_t i = 0; written && i < next.size(); ++i)
+                {
+                    if (!next[i].added)
+                        continue;
+
+                    STATIC_FILTER static_filter{};
+                    std::visit([this, &static_filter](auto&& arg) { to_static_filter(arg, static_filter); },
+                               next[i].staged->filter);
+                    written = InsertStaticFilter(&static_filter, i) != FALSE;
+                }
+
+                if (!written)
+                    NETLIB_ERROR("Incremental filter table update failed, writing the whole table");
+            }
+
+            if (!written && !write_table(next))
+            {
+                // Best effort to get the driver back in sync with filters_
+                NETLIB_ERROR("Failed to write the filter table, restoring the previous table");
+                std::ignore = write_table(filters_);
+                return false;
+            }
+
+            std::list<entry> table;
+            for (const auto& e : next)
+                table.push_back(*e.staged);
+            filters_ = std::move(table);
+
+            return true;
+        }
+
+
         /// <summary>
         /// Converts a filter object to a STATIC_FILTER structure.
         /// </summary>
@@ -918,6 +1224,6 @@ namespace ndisapi
         /// <summary>
         /// List of static filters.
         /// </summary>
-        std::list<std::variant<filter<net::ip_address_v4>, filter<net::ip_address_v6>>> filters_;
+        std::list<entry> filters_;
     };
 }
@@ -8,8 +8,9 @@ namespace ndisapi
      *
      * This class manages TCP endpoint tracking and packet translation for redirecting
      * client TCP traffic to a local proxy. It supports both IPv4 and IPv6 and
-     * provides NAT functionality for TCP source ports. Timed-out connections are cleaned
-     * up automatically in a background thread.
+     * provides NAT functionality for TCP source ports. The connection table is sharded by
+     * client port, each shard with its own lock, and timed-out connections are cleaned up
+     * incrementally in a background thread.
      *
      * @tparam T IP address type (net::ip_address_v4 or net::ip_address_v6).
      */
@@ -18,23 +19,50 @@ namespace ndisapi
     {
         using log_level = netlib::log::log_level;
         using logger = netlib::log::logger<tcp_local_redirect>;
-        using timestamp_endpoint = std::pair<uint16_t, std::chrono::steady_clock::time_point>;
+        /// Number of independently locked connection table shards, a power of two.
+        static constexpr std::size_t shard_count = 64;
+
+        /// Number of shards swept per cleanup tick; every shard is visited once per shard_count / shards_per_sweep ticks.
+        static constexpr std::size_t shards_per_sweep = 4;
+
+        /// Inactivity timeout in cleanup epochs (one epoch per second).
+        static constexpr uint32_t connection_timeout_epochs = 300;
 
         /**
-         * @brief Maps client TCP endpoint to a pair of (proxy port, last activity timestamp).
-         * Used for tracking active TCP connections.
+         * @struct redirected_connection
+         * @brief State of a redirected TCP connection.
          */
-        std::unordered_map<net::ip_endpoint<T>, timestamp_endpoint> redirected_connections_;
+        struct redirected_connection
+        {
+            uint16_t original_port;     ///< Original destination port (network byte order).
+            uint32_t last_epoch;        ///< Cleanup epoch of the last observed packet.
+        };
 
         /**
-         * @brief Proxy port in network byte order.
+         * @struct connection_shard
+         * @brief Part of the connection table holding the client ports that hash to it, with its own lock.
          */
-        u_short proxy_port_{};
+        struct alignas(tools::concurrency::cache_line_size) connection_shard
+        {
+            std::mutex lock;    ///< Protects connections.
+            tools::generic::flat_hash_map<net::ip_endpoint<T>, redirected_connection> connections;  ///< Client endpoint to connection state.
+        };
+
+        /**
+         * @brief Connection table mapping the client TCP endpoint to the connection state,
+         * sharded by client port so that packets of different connections rarely share a lock.
+         */
+        std::array<connection_shard, shard_count> shards_;
+
+        /**
+         * @brief Current cleanup epoch, advanced once per second by the cleanup thread.
+         */
+        std::atomic<uint32_t> epoch_{ 0 };
 
         /**
-         * @brief Mutex for synchronizing access to redirected_connections_.
+         * @brief Proxy port in network byte order.
          */
-        std::mutex lock_;
+        u_short proxy_port_{};
 
         /**
          * @brief Thread for cleaning up timed-out TCP connections.
@@ -46,34 +74,49 @@ namespace ndisapi
          */
         std::atomic_bool terminate_{ false };
 
+        /**
+         * @brief Returns the shard owning a client port.
+         * @param client_port Client TCP port (network byte order).
+         */
+        connection_shard& shard_of(const uint16_t client_port) noexcept
+        {
+            return shards_[ntohs(client_port) & (shard_count - 1)];
+        }
+
         /**
          * @brief Starts the background cleanup thread.
          *
-         * The thread periodically scans the redirected_connections_ map and removes entries
-         * that have been inactive for more than 5 minutes.
+         * Every second the thread advances the cleanup epoch and sweeps the next shards_per_sweep
+         * shards in round-robin order, removing entries whose last epoch is more than
+         * connection_timeout_epochs behind. Packet processing only stamps the current epoch into
+         * the entry, and a sweep holds one shard lock at a time instead of locking the whole table.
          */
         void start_cleanup_thread()
         {
             cleanup_thread_ = std::thread([this]()
                 {
+                    std::size_t next_shard = 0;
+
                     while (!terminate_)
                     {
+                        const auto current_epoch = epoch_.fetch_add(1, std::memory_order_relaxed) + 1;
+
+                        for (std::size_t i = 0; i < shards_per_sweep; ++i)
                         {
-                            auto current_time = std::chrono::steady_clock::now();
-                            std::lock_guard lock(lock_);
+                            auto& shard = shards_[next_shard];
+                            next_shard = (next_shard + 1) & (shard_count - 1);
+
+                            std::lock_guard lock(shard.lock);
 
-                            tools::generic::erase_if(redirected_connections_, redirected_connections_.begin(),
-                                redirected_connections_.end(),
-                                [&current_time, this](auto&& a)
+                            shard.connections.erase_if([current_epoch, this](auto&& a)
                                 {
-                                    using namespace std::chrono_literals;
-                                    if (current_time - a.second.second > 5min)
+                                    if (current_epoch - a.second.last_epoch > connection_timeout_epochs)
                                     {
                                         NETLIB_INFO(
                                             "DELETE TCP (timeout): {} -> {} : {}",
                                             ntohs(a.first.port),
                                             std::string{ a.first.ip },
-                                            ntohs(a.second.first));
+                                            ntohs(a.second.original_port));
                                         return true;
                                     }
                                     return false;
@@ -184,9 +227,12 @@ namespace ndisapi
         *
         * @param packet C2S network packet.
         * @param port Destination port to forward the packet to (network byte order). If 0, uses proxy_port_.
+        * @param checksum_offload True to leave checksums pending offload to the adapter (see network_adapter::set_checksum_offload).
+        * Only for a packet sent out through that adapter, a reverted packet needs complete checksums.
         * @return True if the packet was translated, false otherwise.
         */
-        bool process_client_to_server_packet(INTERMEDIATE_BUFFER& packet, uint16_t port = 0)
+        bool process_client_to_server_packet(INTERMEDIATE_BUFFER& packet, uint16_t port = 0,
+                                             const bool checksum_offload = false)
         {
             if (port == 0)
                 port = proxy_port_;
@@ -206,15 +252,16 @@ namespace ndisapi
                 auto* tcp_header = reinterpret_cast<tcphdr_ptr>(reinterpret_cast<PUCHAR>(ip_header) +
                     sizeof(DWORD) * ip_header->ip_hl);
 
-                std::lock_guard lock(lock_);
+                auto& shard = shard_of(tcp_header->th_sport);
+                std::lock_guard lock(shard.lock);
 
                 if ((tcp_header->th_flags & (TH_SYN | TH_ACK)) == TH_SYN)
                 {
-                    if (const auto [it, result] = redirected_connections_.emplace(
+                    if (const auto [it, result] = shard.connections.try_emplace(
                         net::ip_endpoint<T>{T{ ip_header->ip_dst }, tcp_header->th_sport},
-                        timestamp_endpoint{
+                        redirected_connection{
                             tcp_header->th_dport,
-                            std::chrono::steady_clock::now()
+                            epoch_.load(std::memory_order_relaxed)
                         }); !result)
                         return false;
 
@@ -228,10 +275,10 @@ namespace ndisapi
                 else
                 {
                     // existing connection
-                    const auto it = redirected_connections_.find(net::ip_endpoint<T>{
+                    const auto it = shard.connections.find(net::ip_endpoint<T>{
                         T{ ip_header->ip_dst }, tcp_header->th_sport
                     });
-                    if (it == redirected_connections_.cend())
+                    if (it == shard.connections.end())
                         return false;
 
                     if (tcp_header->th_flags & TH_RST || tcp_header->th_flags & TH_FIN)
@@ -241,13 +288,13 @@ namespace ndisapi
                             "DELETE TCP: {} -> {} : {}",
                             ntohs(it->first.port),
                             std::string{ it->first.ip },
-                            ntohs(it->second.first));
+                            ntohs(it->second.original_port));
 
-                        redirected_connections_.erase(it);
+                        shard.connections.erase(it);
                     }
                     else
                     {
-                        it->second.second = std::chrono::steady_clock::now();
+                        it->second.last_epoch = epoch_.load(std::memory_order_relaxed);
                     }
                 }
 
@@ -257,10 +304,22 @@ namespace ndisapi
                 // Swap IP addresses
                 std::swap(ip_header->ip_dst, ip_header->ip_src);
 
+                net::checksum_delta delta;
+                delta.replace(tcp_header->th_dport, port);
                 tcp_header->th_dport = port;
 
-                CNdisApi::RecalculateTCPChecksum(&packet);
-                CNdisApi::RecalculateIPChecksum(&packet);
+                // Swapping the addresses leaves both checksums intact, only the port rewrite is applied to
+                // a complete checksum. Others are computed fully unless the adapter completes them: the
+                // pseudo-header sum the NIC starts from does not cover the ports and stays valid.
+                if (intermediate_buffer::has_complete_checksum(packet))
+                {
+                    delta.apply(tcp_header->th_sum);
+                }
+                else if (!checksum_offload || !intermediate_buffer::is_checksum_pending(packet))
+                {
+                    net::ip_checksum::recalculate_ipv4_transport(packet);
+                    net::ip_checksum::recalculate_ipv4_header(packet);
+                }
 
                 return true;
             }
@@ -278,15 +337,16 @@ namespace ndisapi
 
                 auto* tcp_header = static_cast<tcphdr_ptr>(p_header);
 
-                std::lock_guard lock(lock_);
+                auto& shard = shard_of(tcp_header->th_sport);
+                std::lock_guard lock(shard.lock);
 
                 if ((tcp_header->th_flags & (TH_SYN | TH_ACK)) == TH_SYN)
                 {
-                    if (const auto [it, result] = redirected_connections_.emplace(
+                    if (const auto [it, result] = shard.connections.try_emplace(
                         net::ip_endpoint<T>{T{ ip_header->ip6_dst }, tcp_header->th_sport},
-                        timestamp_endpoint{
+                        redirected_connection{
                             tcp_header->th_dport,
-                            std::chrono::steady_clock::now()
+                            epoch_.load(std::memory_order_relaxed)
                         }); !result)
                         return false;
 
@@ -300,10 +360,10 @@ namespace ndisapi
                 else
                 {
                     // existing connection
-                    const auto it = redirected_connections_.find(net::ip_endpoint<T>{
+                    const auto it = shard.connections.find(net::ip_endpoint<T>{
                         T{ ip_header->ip6_dst }, tcp_header->th_sport
                     });
-                    if (it == redirected_connections_.cend())
+                    if (it == shard.connections.end())
                         return false;
 
                     if (tcp_header->th_flags & TH_RST || tcp_header->th_flags & TH_FIN)
@@ -314,13 +374,13 @@ namespace ndisapi
                             std::string{ it->first.ip },
                             ntohs(it->first.port),
                             std::string{ it->first.ip },
-                            ntohs(it->second.first));
+                            ntohs(it->second.original_port));
 
-                        redirected_connections_.erase(it);
+                        shard.connections.erase(it);
                     }
                     else
                     {
-                        it->second.second = std::chrono::steady_clock::now();
+                        it->second.last_epoch = epoch_.load(std::memory_order_relaxed);
                     }
                 }
 
@@ -330,10 +390,20 @@ namespace ndisapi
                 // Swap IP addresses
                 std::swap(ip_header->ip6_dst, ip_header->ip6_src);
 
+                net::checksum_delta delta;
+                delta.replace(tcp_header->th_dport, port);
                 tcp_header->th_dport = port;
 
-                // Recalculate checksum
-                net::ipv6_helper::recalculate_tcp_udp_checksum(&packet);
+                // Swapping the addresses leaves the checksum intact, only the port rewrite is applied to
+                // a complete checksum
+                if (intermediate_buffer::has_complete_checksum(packet))
+                {
+                    delta.apply(tcp_header->th_sum);
+                }
+                else
+                {
+                    net::ipv6_helper::recalculate_tcp_udp_checksum(&packet);
+                }
 
                 return true;
             }
@@ -347,9 +417,11 @@ namespace ndisapi
          * Modifies the packet in-place and updates the source/destination addresses and ports as needed.
          *
          * @param packet S2C network packet.
+         * @param checksum_offload True to leave checksums pending offload to the adapter (see network_adapter::set_checksum_offload).
+         * Only for a packet sent out through that adapter, a reverted packet needs complete checksums.
          * @return True if the packet was translated, false otherwise.
          */
-        bool process_server_to_client_packet(INTERMEDIATE_BUFFER& packet)
+        bool process_server_to_client_packet(INTERMEDIATE_BUFFER& packet, const bool checksum_offload = false)
         {
             if constexpr (auto* const eth_header = reinterpret_cast<ether_header_ptr>(packet.m_IBuffer); std::is_same_v<
                 net::ip_address_v4, std::decay_t<T>>)
@@ -366,15 +438,18 @@ namespace ndisapi
                 auto* tcp_header = reinterpret_cast<tcphdr_ptr>(reinterpret_cast<PUCHAR>(ip_header) +
                     sizeof(DWORD) * ip_header->ip_hl);
 
-                std::lock_guard lock(lock_);
+                auto& shard = shard_of(tcp_header->th_dport);
+                std::lock_guard lock(shard.lock);
 
-                const auto it = redirected_connections_.find(net::ip_endpoint<T>{
+                const auto it = shard.connections.find(net::ip_endpoint<T>{
                     T{ ip_header->ip_dst }, tcp_header->th_dport
                 });
-                if (it == redirected_connections_.cend())
+                if (it == shard.connections.end())
                     return false;
 
-                tcp_header->th_sport = it->second.first;
+                net::checksum_delta delta;
+                delta.replace(tcp_header->th_sport, it->second.original_port);
+                tcp_header->th_sport = it->second.original_port;
 
                 if (tcp_header->th_flags & TH_RST || tcp_header->th_flags & TH_FIN)
                 {
@@ -383,13 +458,13 @@ namespace ndisapi
                         "DELETE TCP: {} -> {} : {}",
                         ntohs(it->first.port),
                         std::string{ it->first.ip },
-                        ntohs(it->second.first));
+                        ntohs(it->second.original_port));
 
-                    redirected_connections_.erase(it);
+                    shard.connections.erase(it);
                 }
                 else
                 {
-                    it->second.second = std::chrono::steady_clock::now();
+                    it->second.last_epoch = epoch_.load(std::memory_order_relaxed);
                 }
 
                 // Swap Ethernet addresses
@@ -398,8 +473,18 @@ namespace ndisapi
                 // Swap IP addresses
                 std::swap(ip_header->ip_dst, ip_header->ip_src);
 
-                CNdisApi::RecalculateTCPChecksum(&packet);
-                CNdisApi::RecalculateIPChecksum(&packet);
+                // Swapping the addresses leaves both checksums intact, only the port rewrite is applied to
+                // a complete checksum. Others are computed fully unless the adapter completes them: the
+                // pseudo-header sum the NIC starts from does not cover the ports and stays valid.
+                if (intermediate_buffer::has_complete_checksum(packet))
+                {
+                    delta.apply(tcp_header->th_sum);
+                }
+                else if (!checksum_offload || !intermediate_buffer::is_checksum_pending(packet))
+                {
+                    net::ip_checksum::recalculate_ipv4_transport(packet);
+                    net::ip_checksum::recalculate_ipv4_header(packet);
+                }
 
                 return true;
             }
@@ -417,15 +502,18 @@ namespace ndisapi
 
                 auto* tcp_header = static_cast<tcphdr_ptr>(p_header);
 
-                std::lock_guard lock(lock_);
+                auto& shard = shard_of(tcp_header->th_dport);
+                std::lock_guard lock(shard.lock);
 
-                const auto it = redirected_connections_.find(net::ip_endpoint<T>{
+                const auto it = shard.connections.find(net::ip_endpoint<T>{
                     T{ ip_header->ip6_dst }, tcp_header->th_dport
                 });
-                if (it == redirected_connections_.cend())
+                if (it == shard.connections.end())
                     return false;
 
-                tcp_header->th_sport = it->second.first;
+                net::checksum_delta delta;
+                delta.replace(tcp_header->th_sport, it->second.original_port);
+                tcp_header->th_sport = it->second.original_port;
 
                 if (tcp_header->th_flags & TH_RST || tcp_header->th_flags & TH_FIN)
                 {
@@ -434,13 +522,13 @@ namespace ndisapi
                         "DELETE TCP: {} -> {} : {}",
                         ntohs(it->first.port),
                         std::string{ it->first.ip },
-                        ntohs(it->second.first));
+                        ntohs(it->second.original_port));
 
-                    redirected_connections_.erase(it);
+                    shard.connections.erase(it);
                 }
                 else
                 {
-                    it->second.second = std::chrono::steady_clock::now();
+                    it->second.last_epoch = epoch_.load(std::memory_order_relaxed);
                 }
 
                 // Swap Ethernet addresses
@@ -449,8 +537,16 @@ namespace ndisapi
                 // Swap IP addresses
                 std::swap(ip_header->ip6_dst, ip_header->ip6_src);
 
-                // Recalculate checksum
-                net::ipv6_helper::recalculate_tcp_udp_checksum(&packet);
+                // Swapping the addresses leaves the checksum intact, only the port rewrite is applied to
+                // a complete checksum
+                if (intermediate_buffer::has_complete_checksum(packet))
+                {
+                    delta.apply(tcp_header->th_sum);
+                }
+                else
+                {
+                    net::ipv6_helper::recalculate_tcp_udp_checksum(&packet);
+                }
 
                 return true;
             }
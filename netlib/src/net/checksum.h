@@ -0,0 +1,410 @@
+#pragma once
+
+namespace net
+{
+    /**
+     * @class ip_checksum
+     * @brief Internet checksum (RFC 1071) computation with vectorized kernels and runtime CPU dispatch.
+     *
+     * partial() accumulates the data as 32-bit words into a 64-bit sum, the result is folded and
+     * complemented by finish(). On x86/x64 the bulk of the data is summed by an AVX2 or SSE4.1
+     * kernel, selected once from the CPU features and the OS support for the YMM state; other
+     * targets and CPUs without SSE4.1 use the scalar kernel. All kernels return the same sum, so
+     * partial results of different kernels may be combined.
+     *
+     * Values are summed as stored in memory (network byte order); the one's complement sum is
+     * byte-order independent and finish() returns the checksum ready to be stored in the packet.
+     */
+    class ip_checksum
+    {
+    public:
+        /**
+         * @enum kernel
+         * @brief Summing kernel implementation.
+         */
+        enum class kernel : uint8_t
+        {
+            scalar,     ///< Portable 32-bit word loop.
+            sse41,      ///< 128-bit SSE4.1 kernel, 32 bytes per iteration.
+            avx2        ///< 256-bit AVX2 kernel, 64 bytes per iteration.
+        };
+
+        /**
+         * @brief Returns the fastest kernel supported by the executing CPU.
+         */
+        [[nodiscard]] static kernel active_kernel() noexcept
+        {
+            static const auto selected = detect_kernel();
+            return selected;
+        }
+
+        /**
+         * @brief Adds data to a partial checksum using the active kernel.
+         * @param data Data to sum; an odd trailing byte is padded with zero.
+         * @param length Length in bytes.
+         * @param sum Partial sum to continue.
+         * @return Updated partial sum.
+         */
+        [[nodiscard]] static uint64_t partial(const void* data, const std::size_t length, const uint64_t sum = 0) noexcept
+        {
+            return partial(active_kernel(), data, length, sum);
+        }
+
+        /**
+         * @brief Adds data to a partial checksum using a specific kernel.
+         *
+         * The kernel must be supported by the executing CPU (see active_kernel()).
+         */
+        [[nodiscard]] static uint64_t partial(const kernel implementation, const void* data, const std::size_t length,
+                                              const uint64_t sum = 0) noexcept
+        {
+#if defined(_M_X64) || defined(_M_IX86)
+            switch (implementation)
+            {
+            case kernel::avx2:
+                return partial_avx2(static_cast<const uint8_t*>(data), length, sum);
+            case kernel::sse41:
+                return partial_sse41(static_cast<const uint8_t*>(data), length, sum);
+            case kernel::scalar:
+                break;
+            }
+#endif
+            return partial_scalar(static_cast<const uint8_t*>(data), length, sum);
+        }
+
+        /**
+         * @brief Folds a partial sum and returns its complement, the checksum in network byte order.
+         */
+        [[nodiscard]] static uint16_t finish(uint64_t sum) noexcept
+        {
+            while (sum >> 16)
+                sum = (sum & 0xffff) + (sum >> 16);
+
+            return static_cast<uint16_t>(~sum);
+        }
+
+        /**
+         * @brief Recalculates the header checksum of an IPv4 packet.
+         * @param packet Ethernet frame carrying an IPv4 packet.
+         */
+        static void recalculate_ipv4_header(INTERMEDIATE_BUFFER& packet) noexcept
+        {
+            auto* const ip_header = reinterpret_cast<iphdr_ptr>(packet.m_IBuffer + ETHER_HEADER_LENGTH);
+
+            ip_header->ip_sum = 0;
+            ip_header->ip_sum = finish(partial(ip_header, sizeof(DWORD) * ip_header->ip_hl));
+        }
+
+        /**
+         * @brief Recalculates the TCP or UDP checksum of an IPv4 packet, including the pseudo-header.
+         *
+         * Packets of other protocols are left untouched. The transport length is taken from the IP
+         * total length and clipped to the frame.
+         *
+         * @param packet Ethernet frame carrying an IPv4 packet.
+         */
+        static void recalculate_ipv4_transport(INTERMEDIATE_BUFFER& packet) noexcept
+        {
+            auto* const ip_header = reinterpret_cast<iphdr_ptr>(packet.m_IBuffer + ETHER_HEADER_LENGTH);
+            const auto header_length = static_cast<uint32_t>(sizeof(DWORD) * ip_header->ip_hl);
+            auto* const transport = reinterpret_cast<uint8_t*>(ip_header) + header_length;
+
+            uint16_t* check;
+            if (ip_header->ip_p == IPPROTO_TCP)
+                check = &reinterpret_cast<tcphdr_ptr>(transport)->th_sum;
+            else if (ip_header->ip_p == IPPROTO_UDP)
+                check = &reinterpret_cast<udphdr_ptr>(transport)->th_sum;
+            else
+                return;
+
+            const auto length = static_cast<uint16_t>(std::min<uint32_t>(ntohs(ip_header->ip_len) - header_length,
+                packet.m_Length - ETHER_HEADER_LENGTH - header_length));
+
+            *check = 0;
+
+            // Pseudo-header: addresses, zero/protocol word and transport length
+            auto sum = partial(&ip_header->ip_src, 2 * sizeof(in_addr));
+            sum += htons(ip_header->ip_p);
+            sum += htons(length);
+
+            *check = finish(partial(transport, length, sum));
+
+            // A computed zero UDP checksum is transmitted as all ones (RFC 768)
+            if (*check == 0 && ip_header->ip_p == IPPROTO_UDP)
+                *check = 0xffff;
+        }
+
+    private:
+        /**
+         * @brief Scalar kernel: 32-bit words into a 64-bit accumulator.
+         */
+        static uint64_t partial_scalar(const uint8_t* data, std::size_t length, uint64_t sum) noexcept
+        {
+            for (; length >= sizeof(uint32_t); length -= sizeof(uint32_t), data += sizeof(uint32_t))
+            {
+                uint32_t word;
+                std::memcpy(&word, data, sizeof(word));
+                sum += word;
+            }
+
+            if (length >= sizeof(uint16_t))
+            {
+                uint16_t word;
+                std::memcpy(&word, data, sizeof(word));
+                sum += word;
+                length -= sizeof(uint16_t);
+                data += sizeof(uint16_t);
+            }
+
+            // RFC 1071: an odd trailing byte is padded with zero
+            if (length > 0)
+                sum += ntohs(static_cast<uint16_t>(*data << 8));
+
+            return sum;
+        }
+
+#if defined(_M_X64) || defined(_M_IX86)
+        /**
+         * @brief Selects the kernel from CPUID and the OS-enabled register state.
+         */
+        static kernel detect_kernel() noexcept
+        {
+            int info[4]{};
+
+            __cpuid(info, 0);
+            if (info[0] < 1)
+                return kernel::scalar;
+
+            const auto max_leaf = info[0];
+
+            __cpuid(info, 1);
+            const auto sse41 = (info[2] & (1 << 19)) != 0;
+            const auto osxsave = (info[2] & (1 << 27)) != 0;
+            const auto avx = (info[2] & (1 << 28)) != 0;
+
+            if (osxsave && avx && max_leaf >= 7 && (_xgetbv(0) & 0x6) == 0x6)
+            {
+                __cpuidex(info, 7, 0);
+                if (info[1] & (1 << 5))
+                    return kernel::avx2;
+            }
+
+            return sse41 ? kernel::sse41 : kernel::scalar;
+        }
+
+        /**
+         * @brief Adds the two 64-bit lanes of an accumulator (also available on 32-bit targets).
+         */
+        static uint64_t horizontal_sum(const __m128i acc) noexcept
+        {
+            alignas(16) uint64_t lanes[2];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+            return lanes[0] + lanes[1];
+        }
+
+        /**
+         * @brief SSE4.1 kernel: 32-bit lanes zero-extended into two 64-bit accumulators.
+         */
+        static uint64_t partial_sse41(const uint8_t* data, std::size_t length, uint64_t sum) noexcept
+        {
+            auto acc0 = _mm_setzero_si128();
+            auto acc1 = _mm_setzero_si128();
+
+            for (; length >= 32; length -= 32, data += 32)
+            {
+                const auto v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+                const auto v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16));
+
+                acc0 = _mm_add_epi64(acc0, _mm_cvtepu32_epi64(v0));
+                acc1 = _mm_add_epi64(acc1, _mm_cvtepu32_epi64(_mm_srli_si128(v0, 8)));
+                acc0 = _mm_add_epi64(acc0, _mm_cvtepu32_epi64(v1));
+                acc1 = _mm_add_epi64(acc1, _mm_cvtepu32_epi64(_mm_srli_si128(v1, 8)));
+            }
+
+            if (length >= 16)
+            {
+                const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+                acc0 = _mm_add_epi64(acc0, _mm_cvtepu32_epi64(v));
+                acc1 = _mm_add_epi64(acc1, _mm_cvtepu32_epi64(_mm_srli_si128(v, 8)));
+                length -= 16;
+                data += 16;
+            }
+
+            sum += horizontal_sum(_mm_add_epi64(acc0, acc1));
+
+            return partial_scalar(data, length, sum);
+        }
+
+        /**
+         * @brief AVX2 kernel: 32-bit lanes interleaved with zero into two 64-bit accumulators.
+         */
+        static uint64_t partial_avx2(const uint8_t* data, std::size_t length, uint64_t sum) noexcept
+        {
+            if (length < 32)
+                return partial_sse41(data, length, sum);
+
+            const auto zero = _mm256_setzero_si256();
+            auto acc0 = _mm256_setzero_si256();
+            auto acc1 = _mm256_setzero_si256();
+
+            for (; length >= 64; length -= 64, data += 64)
+            {
+                const auto v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+                const auto v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 32));
+
+                acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v0, zero));
+                acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v0, zero));
+                acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v1, zero));
+                acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v1, zero));
+            }
+
+            if (length >= 32)
+            {
+                const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+                acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v, zero));
+                acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v, zero));
+                length -= 32;
+                data += 32;
+            }
+
+            const auto acc = _mm256_add_epi64(acc0, acc1);
+            sum += horizontal_sum(_mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1)));
+
+            // Leave the upper YMM state clean before returning to SSE code
+            _mm256_zeroupper();
+
+            return partial_sse41(data, length, sum);
+        }
+#else
+        static kernel detect_kernel() noexcept
+        {
+            return kernel::scalar;
+        }
+#endif
+    };
+
+    /**
+     * @class checksum_delta
+     * @brief Accumulates header rewrites and applies them to Internet checksums incrementally (RFC 1624).
+     *
+     * Rewriting addresses and ports only changes a few 16-bit words covered by the IP header and
+     * TCP/UDP checksums, so instead of summing the whole segment again the old words are subtracted
+     * from and the new words added to the existing checksum: HC' = ~(~HC + ~m + m') (RFC 1624,
+     * equation 3). One delta can be applied to several checksums covering the same words, e.g. an
+     * IPv4 address change affects both the IP header checksum and the TCP/UDP pseudo-header.
+     *
+     * All values are taken as stored in the packet (network byte order); the one's complement sum
+     * is byte-order independent, so no conversion is needed. Byte ranges must have an even length
+     * and start at an even offset from the beginning of the checksummed data, which holds for all
+     * address, port and length fields and for inserted or removed SOCKS5 UDP headers.
+     *
+     * Moving data by an even number of bytes does not change its sum, so inserting or removing a
+     * header in front of a payload only adds or subtracts the header itself.
+     */
+    class checksum_delta
+    {
+    public:
+        /**
+         * @brief Records the replacement of a 16-bit field.
+         * @param old_value Previous field value (network byte order).
+         * @param new_value New field value (network byte order).
+         */
+        void replace(const uint16_t old_value, const uint16_t new_value) noexcept
+        {
+            sum_ += static_cast<uint16_t>(~old_value);
+            sum_ += new_value;
+        }
+
+        /**
+         * @brief Records the replacement of a byte range, e.g. an IP address.
+         * @param old_bytes Previous contents.
+         * @param new_bytes New contents.
+         * @param length Length in bytes, must be even.
+         */
+        void replace(const void* old_bytes, const void* new_bytes, const std::size_t length) noexcept
+        {
+            remove(old_bytes, length);
+            add(new_bytes, length);
+        }
+
+        /**
+         * @brief Records bytes that became covered by the checksum.
+         * @param bytes Added contents.
+         * @param length Length in bytes, must be even.
+         */
+        void add(const void* bytes, const std::size_t length) noexcept
+        {
+            const auto* data = static_cast<const uint8_t*>(bytes);
+
+            for (std::size_t i = 0; i < length; i += sizeof(uint16_t))
+            {
+                uint16_t word;
+                std::memcpy(&word, data + i, sizeof(word));
+                sum_ += word;
+            }
+        }
+
+        /**
+         * @brief Records bytes that are no longer covered by the checksum.
+         * @param bytes Removed contents.
+         * @param length Length in bytes, must be even.
+         */
+        void remove(const void* bytes, const std::size_t length) noexcept
+        {
+            const auto* data = static_cast<const uint8_t*>(bytes);
+
+            for (std::size_t i = 0; i < length; i += sizeof(uint16_t))
+            {
+                uint16_t word;
+                std::memcpy(&word, data + i, sizeof(word));
+                sum_ += static_cast<uint16_t>(~word);
+            }
+        }
+
+        /**
+         * @brief Applies the recorded changes to an IP header or TCP checksum field.
+         * @param check Checksum field as stored in the packet.
+         */
+        void apply(uint16_t& check) const noexcept
+        {
+            check = ip_checksum::finish(static_cast<uint16_t>(~check) + sum_);
+        }
+
+        /**
+         * @brief Applies the recorded changes to a pseudo-header sum awaiting checksum offload.
+         *
+         * With transmit checksum offload the stack leaves the uncomplemented pseudo-header sum in
+         * the TCP/UDP checksum field and the NIC adds the segment to it, so only pseudo-header
+         * changes (addresses, length) may be recorded in this delta.
+         *
+         * @param seed Checksum field holding the pseudo-header sum.
+         */
+        void apply_pseudo_header(uint16_t& seed) const noexcept
+        {
+            seed = static_cast<uint16_t>(~ip_checksum::finish(seed + sum_));
+        }
+
+        /**
+         * @brief Applies the recorded changes to a UDP checksum field.
+         *
+         * A zero UDP checksum means "no checksum" over IPv4 and is left untouched; a computed zero
+         * is transmitted as 0xffff (RFC 768).
+         *
+         * @param check Checksum field as stored in the packet.
+         */
+        void apply_udp(uint16_t& check) const noexcept
+        {
+            if (check == 0)
+                return;
+
+            apply(check);
+
+            if (check == 0)
+                check = 0xffff;
+        }
+
+    private:
+        /// One's complement sum of the recorded changes, folded on apply.
+        uint64_t sum_{ 0 };
+    };
+}
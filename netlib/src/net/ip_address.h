@@ -429,6 +429,20 @@ namespace net
             return (0 == memcmp(&this->u, &localhost.u, sizeof(this->u)));
         }
 
+        /// <summary>
+        /// Constructs the IPv4-mapped IPv6 address (::ffff:a.b.c.d) of an IPv4 address
+        /// </summary>
+        /// <param name="ip">IPv4 address</param>
+        /// <returns>IPv4-mapped IPv6 address</returns>
+        [[nodiscard]] static ip_address_v6 v4_mapped(const ip_address_v4& ip) noexcept
+        {
+            ip_address_v6 mapped;
+            mapped.u.Byte[10] = 0xFF;
+            mapped.u.Byte[11] = 0xFF;
+            memmove(&mapped.u.Byte[12], &ip, sizeof(in_addr));
+            return mapped;
+        }
+
         /// <summary>
         /// Char stream output operator
         /// </summary>
@@ -543,4 +557,59 @@ namespace std
     };
 }
 
+namespace netlib::log
+{
+    /// <summary>
+    /// Binary trace encoding of net::ip_address_v4 (four bytes, network order)
+    /// </summary>
+    template <>
+    struct trace_arg<net::ip_address_v4>
+    {
+        static constexpr auto type = trace_format::arg_type::ipv4;
+
+        static std::size_t encode(const net::ip_address_v4& value, std::byte* out, const std::size_t capacity) noexcept
+        {
+            return detail::trace_encode_raw(&value.S_un.S_addr, sizeof(value.S_un.S_addr), out, capacity);
+        }
+    };
+
+    /// <summary>
+    /// Binary trace encoding of net::ip_address_v6 (sixteen bytes, network order)
+    /// </summary>
+    template <>
+    struct trace_arg<net::ip_address_v6>
+    {
+        static constexpr auto type = trace_format::arg_type::ipv6;
+
+        static std::size_t encode(const net::ip_address_v6& value, std::byte* out, const std::size_t capacity) noexcept
+        {
+            return detail::trace_encode_raw(value.u.Byte, sizeof(value.u.Byte), out, capacity);
+        }
+    };
+
+    /// <summary>
+    /// Binary trace encoding of an IPv4 or IPv6 address (family byte followed by the address)
+    /// </summary>
+    template <>
+    struct trace_arg<std::variant<net::ip_address_v4, net::ip_address_v6>>
+    {
+        static constexpr auto type = trace_format::arg_type::ip_address;
+
+        static std::size_t encode(const std::variant<net::ip_address_v4, net::ip_address_v6>& value, std::byte* out,
+                                  const std::size_t capacity) noexcept
+        {
+            if (capacity == 0)
+                return 0;
+
+            const auto written = std::visit([out, capacity]<typename T>(const T& ip)
+            {
+                out[0] = static_cast<std::byte>(std::is_same_v<T, net::ip_address_v4> ? 4 : 6);
+                return trace_arg<T>::encode(ip, out + 1, capacity - 1);
+            }, value);
+
+            return written != 0 ? written + 1 : 0;
+        }
+    };
+}
+
 #pragma warning( pop )
\ No newline at end of file
@@ -162,31 +162,10 @@ namespace net
         /// <param name="len">length of data buffer</param>
         /// <param name="sum">pre-calculated checksum</param>
         /// <returns></returns>
-        static uint64_t ip_checksum_partial(const void* p, size_t len, uint64_t sum)
+        static uint64_t ip_checksum_partial(const void* p, const size_t len, const uint64_t sum)
         {
-            /* Main loop: 32 bits at a time.
-               We take advantage of Intel's ability to do unaligned memory
-               accesses with minimal additional cost. Other architectures
-               probably want to be more careful here. */
-
-            auto p32 = static_cast<const uint32_t*>(p);
-            for (; len >= sizeof(*p32); len -= sizeof(*p32))
-                sum += *p32++;
-
-            /* Handle un-32bit-aligned trailing bytes */
-            auto p16 = reinterpret_cast<const uint16_t*>(p32);
-            if (len >= 2)
-            {
-                sum += *p16++;
-                len -= sizeof(*p16);
-            }
-            if (len > 0)
-            {
-                const auto p8 = reinterpret_cast<const uint8_t*>(p16);
-                sum += ntohs(static_cast<uint16_t>(*p8) << 8); /* RFC says pad last byte */
-            }
-
-            return sum;
+            // Vectorized where the CPU supports it, see ip_checksum
+            return ip_checksum::partial(p, len, sum);
         }
 
         /// <summary>
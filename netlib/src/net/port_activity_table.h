@@ -0,0 +1,201 @@
+#pragma once
+
+namespace net
+{
+    /**
+     * @class port_activity_table
+     * @brief Port-indexed table of active 16-bit ports with last-activity timestamps and a pending flag.
+     *
+     * Each of the 65536 ports owns one 32-bit atomic word (256 KB in total) holding the time of
+     * the last activity in seconds (plus one, so that zero means "absent") and a pending flag that
+     * is raised when the port is added and cleared by take_pending(). Membership tests and
+     * activity updates are a load and, at most once per second per port, a compare-exchange, so
+     * per-packet operations never lock.
+     *
+     * Inactive ports are expired by expire() using a hashed timing wheel: a port is scheduled into
+     * the wheel bucket of its expiry tick when it is added, and when that bucket comes due the
+     * port is either removed (no activity since) or re-scheduled according to its latest activity.
+     * The wheel is touched only when a port is added and by expire(), never by activity updates,
+     * and expire() only visits ports whose expiry is due instead of scanning the whole table.
+     */
+    class port_activity_table
+    {
+        static constexpr std::size_t slot_count = 65536;
+
+        static constexpr uint32_t pending_flag = 0x80000000u;
+        static constexpr uint32_t stamp_mask = ~pending_flag;
+
+        /// Number of wheel buckets, must exceed the timeout in ticks.
+        static constexpr std::size_t bucket_count = 256;
+
+    public:
+        /**
+         * @brief Constructs an empty table.
+         * @param timeout Inactivity period after which a port is expired.
+         * @param tick Wheel granularity, the expected interval between expire() calls.
+         */
+        port_activity_table(const std::chrono::seconds timeout, const std::chrono::seconds tick)
+            : tick_(static_cast<uint32_t>(std::max<std::chrono::seconds::rep>(tick.count(), 1))),
+              timeout_ticks_(static_cast<uint32_t>((timeout.count() + tick_ - 1) / tick_)),
+              slots_(std::make_unique<std::atomic<uint32_t>[]>(slot_count))
+        {
+            assert(timeout_ticks_ < bucket_count && "port_activity_table timeout exceeds the wheel span");
+        }
+
+        port_activity_table(const port_activity_table&) = delete;
+        port_activity_table(port_activity_table&&) = delete;
+        port_activity_table& operator=(const port_activity_table&) = delete;
+        port_activity_table& operator=(port_activity_table&&) = delete;
+        ~port_activity_table() = default;
+
+        /**
+         * @brief Adds a port with the pending flag raised, unless it is already present.
+         * @param port Port number (any byte order, used as a plain index).
+         * @return true if the port was added, false if it was already present.
+         */
+        bool try_add(const uint16_t port)
+        {
+            const auto stamp = now();
+
+            if (auto expected = uint32_t{ 0 };
+                !slots_[port].compare_exchange_strong(expected, stamp | pending_flag, std::memory_order_acq_rel))
+                return false;
+
+            std::scoped_lock lock(wheel_lock_);
+            schedule(port, stamp);
+            return true;
+        }
+
+        /**
+         * @brief Records activity on a port if it is present.
+         * @param port Port number.
+         * @return true if the port is present.
+         */
+        bool touch(const uint16_t port) noexcept
+        {
+            auto& slot = slots_[port];
+            auto word = slot.load(std::memory_order_acquire);
+
+            if (word == 0)
+                return false;
+
+            // Refresh at most once per second per port; a lost race means another thread just did it
+            if (const auto stamp = now(); (word & stamp_mask) != stamp)
+                slot.compare_exchange_strong(word, (word & pending_flag) | stamp, std::memory_order_relaxed);
+
+            return true;
+        }
+
+        /**
+         * @brief Tests whether a port is present.
+         * @param port Port number.
+         * @return true if the port is present.
+         */
+        [[nodiscard]] bool contains(const uint16_t port) const noexcept
+        {
+            return slots_[port].load(std::memory_order_acquire) != 0;
+        }
+
+        /**
+         * @brief Clears the pending flag of a port.
+         * @param port Port number.
+         * @return true if the port was present with the pending flag raised.
+         */
+        bool take_pending(const uint16_t port) noexcept
+        {
+            return (slots_[port].fetch_and(~pending_flag, std::memory_order_acq_rel) & pending_flag) != 0;
+        }
+
+        /**
+         * @brief Removes the ports that have been inactive for longer than the timeout.
+         *
+         * Must not be called concurrently with itself.
+         *
+         * @param on_expired Callable invoked with every removed port.
+         */
+        template <typename OnExpired>
+        void expire(OnExpired on_expired)
+        {
+            const auto current_tick = now() / tick_;
+            std::vector<uint16_t> due;
+
+            for (;;)
+            {
+                {
+                    std::scoped_lock lock(wheel_lock_);
+                    if (next_tick_ > current_tick)
+                        break;
+
+                    // Advancing next_tick_ first keeps concurrent schedule() calls out of this bucket
+                    due.swap(wheel_[next_tick_++ % bucket_count]);
+                }
+
+                for (const auto port : due)
+                {
+                    auto& slot = slots_[port];
+                    auto word = slot.load(std::memory_order_acquire);
+
+                    // Removed earlier, or scheduled twice after being removed and re-added
+                    if (word == 0)
+                        continue;
+
+                    if (expiry_tick(word & stamp_mask) <= current_tick &&
+                        slot.compare_exchange_strong(word, 0, std::memory_order_acq_rel))
+                    {
+                        on_expired(port);
+                        continue;
+                    }
+
+                    // Active since it was scheduled (or refreshed concurrently): re-schedule
+                    std::scoped_lock lock(wheel_lock_);
+                    schedule(port, word & stamp_mask);
+                }
+
+                due.clear();
+            }
+        }
+
+    private:
+        /**
+         * @brief Returns the wheel tick at which a port last active at stamp expires.
+         */
+        [[nodiscard]] uint32_t expiry_tick(const uint32_t stamp) const noexcept
+        {
+            return stamp / tick_ + timeout_ticks_ + 1;
+        }
+
+        /**
+         * @brief Adds a port to the bucket of its expiry tick. wheel_lock_ must be held.
+         */
+        void schedule(const uint16_t port, const uint32_t stamp)
+        {
+            // A tick that has already been processed would never be visited again
+            const auto tick = std::max(expiry_tick(stamp), next_tick_);
+            wheel_[tick % bucket_count].push_back(port);
+        }
+
+        /**
+         * @brief Returns the current time in seconds since table construction, plus one.
+         */
+        [[nodiscard]] uint32_t now() const noexcept
+        {
+            return (static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::steady_clock::now() - epoch_).count()) + 1) & stamp_mask;
+        }
+
+        /// Wheel granularity in seconds.
+        const uint32_t tick_;
+        /// Inactivity timeout in ticks.
+        const uint32_t timeout_ticks_;
+        /// Reference point for the slot timestamps.
+        const std::chrono::steady_clock::time_point epoch_{ std::chrono::steady_clock::now() };
+        /// Slot storage indexed by port.
+        std::unique_ptr<std::atomic<uint32_t>[]> slots_;
+        /// Timing wheel buckets of ports due at tick % bucket_count.
+        std::array<std::vector<uint16_t>, bucket_count> wheel_;
+        /// Next tick expire() has to process.
+        uint32_t next_tick_{ 0 };
+        /// Protects wheel_ and next_tick_, taken by try_add() and expire() only.
+        std::mutex wheel_lock_;
+    };
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+namespace net
+{
+    /**
+     * @class port_bitmap
+     * @brief Set of 16-bit port numbers stored as a 65536-bit atomic bitmap (8 KB).
+     *
+     * Membership tests are a single relaxed load and a mask, with no locks or loops, which makes
+     * the bitmap suitable for per-packet checks. Updates are atomic per port and may run
+     * concurrently with tests.
+     */
+    class port_bitmap
+    {
+        static constexpr std::size_t bits_per_word = 64;
+        static constexpr std::size_t word_count = 65536 / bits_per_word;
+
+    public:
+        port_bitmap() = default;
+
+        port_bitmap(const port_bitmap&) = delete;
+        port_bitmap(port_bitmap&&) = delete;
+        port_bitmap& operator=(const port_bitmap&) = delete;
+        port_bitmap& operator=(port_bitmap&&) = delete;
+        ~port_bitmap() = default;
+
+        /**
+         * @brief Tests whether a port is in the set.
+         * @param port Port number (host byte order).
+         * @return True if the port is in the set.
+         */
+        [[nodiscard]] bool test(const uint16_t port) const noexcept
+        {
+            return (words_[port / bits_per_word].load(std::memory_order_relaxed) & mask(port)) != 0;
+        }
+
+        /**
+         * @brief Adds a port to the set.
+         * @param port Port number (host byte order).
+         */
+        void set(const uint16_t port) noexcept
+        {
+            words_[port / bits_per_word].fetch_or(mask(port), std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Removes a port from the set.
+         * @param port Port number (host byte order).
+         */
+        void reset(const uint16_t port) noexcept
+        {
+            words_[port / bits_per_word].fetch_and(~mask(port), std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Removes all ports from the set.
+         */
+        void clear() noexcept
+        {
+            for (auto& word : words_)
+                word.store(0, std::memory_order_relaxed);
+        }
+
+    private:
+        /**
+         * @brief Returns the bit mask of a port within its word.
+         */
+        static constexpr uint64_t mask(const uint16_t port) noexcept
+        {
+            return uint64_t{ 1 } << (port % bits_per_word);
+        }
+
+        /// Bitmap storage, bit N % 64 of word N / 64 represents port N.
+        std::array<std::atomic<uint64_t>, word_count> words_{};
+    };
+}
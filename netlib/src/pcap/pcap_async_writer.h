@@ -0,0 +1,761 @@
+#pragma once
+#include "pcap.h"
+#include "pcapng.h"
+
+namespace pcap
+{
+    /// <summary>
+    /// Asynchronous packet capture into pcap files or an output stream.
+    ///
+    /// The packet path only copies the packet (truncated to the snap length) into a slot of a
+    /// lock-free ring and returns; a background thread drains the ring into large buffers and
+    /// writes them out. A full ring drops the packet and counts it instead of blocking the caller.
+    ///
+    /// Files are written with unbuffered overlapped I/O in 1 MB blocks, double buffered so the
+    /// next block is filled while the previous one is being written. Data is flushed at least
+    /// every flush_interval so a running capture can be inspected, and the files are rotated
+    /// by size and/or age, keeping the most recent max_files of them.
+    ///
+    /// The output is either classic libpcap or pcapng. pcapng records carry the packet direction
+    /// and, for packets captured with a packet_annotation, a comment naming the owner process,
+    /// its proxy and the router's decision.
+    /// </summary>
+    class pcap_async_writer
+    {
+    public:
+        /// <summary>Packets the ring holds, about 7 MB.</summary>
+        static constexpr std::size_t ring_capacity = 4096;
+
+        /// <summary>Size of each of the two output buffers.</summary>
+        static constexpr std::size_t buffer_size = 1024 * 1024;
+
+        /// <summary>Characters of the process name kept with an annotated packet.</summary>
+        static constexpr std::size_t max_process_name = 64;
+
+        /// <summary>
+        /// Capture file format.
+        /// </summary>
+        enum class file_format : uint8_t
+        {
+            pcap,       ///< Classic libpcap records, annotations are ignored.
+            pcapng      ///< pcapng Enhanced Packet Blocks with direction flags and annotation comments.
+        };
+
+        /// <summary>
+        /// Output file settings.
+        /// </summary>
+        struct file_options
+        {
+            /// <summary>Capture file. With rotation enabled, files are named stem_00000.ext, stem_00001.ext, ...</summary>
+            std::filesystem::path path;
+            /// <summary>Starts a new file once the current one would exceed this size in bytes, 0 for no limit.</summary>
+            std::uint64_t max_file_size{ 0 };
+            /// <summary>Starts a new file once the current one is older than this, 0 for no limit.</summary>
+            std::chrono::seconds max_file_age{ 0 };
+            /// <summary>Number of most recent files kept on rotation, 0 keeps all of them.</summary>
+            std::uint32_t max_files{ 0 };
+            /// <summary>Bytes of each packet saved, at most MAX_ETHER_FRAME.</summary>
+            std::uint32_t snaplen{ MAX_ETHER_FRAME };
+            /// <summary>Longest time captured packets stay in memory.</summary>
+            std::chrono::milliseconds flush_interval{ 1000 };
+            /// <summary>Capture file format.</summary>
+            file_format format{ file_format::pcap };
+        };
+
+        /// <summary>
+        /// Capture counters.
+        /// </summary>
+        struct statistics
+        {
+            std::uint64_t written;          ///< Packets written out.
+            std::uint64_t dropped;          ///< Packets dropped because the ring was full.
+            std::uint64_t truncated;        ///< Packets written truncated to the snap length.
+            std::uint64_t bytes_written;    ///< Bytes of pcap data (file headers and records) produced.
+            std::uint64_t write_errors;     ///< Failed writes or file creations.
+            std::uint32_t files;            ///< Files created.
+        };
+
+        /// <summary>
+        /// Starts a capture into an output stream, written in batches by the background thread.
+        /// </summary>
+        /// <param name="output_stream">The output stream to write the pcap data to, must outlive the writer.</param>
+        /// <param name="snaplen">Bytes of each packet saved, at most MAX_ETHER_FRAME.</param>
+        /// <param name="format">Capture format.</param>
+        /// <exception cref="std::system_error">Thrown if the background thread cannot be created.</exception>
+        explicit pcap_async_writer(std::ostream& output_stream, const std::uint32_t snaplen = MAX_ETHER_FRAME,
+                                   const file_format format = file_format::pcap)
+            : stream_(&output_stream), snaplen_(std::clamp<std::uint32_t>(snaplen, 1, MAX_ETHER_FRAME))
+        {
+            options_.format = format;
+            start();
+        }
+
+        /// <summary>
+        /// Starts a capture into files.
+        /// </summary>
+        /// <param name="options">Output file settings.</param>
+        /// <exception cref="std::system_error">Thrown if the first file or the background thread cannot be created.</exception>
+        explicit pcap_async_writer(file_options options)
+            : options_(std::move(options)), snaplen_(std::clamp<std::uint32_t>(options_.snaplen, 1, MAX_ETHER_FRAME))
+        {
+            options_.flush_interval = std::max(options_.flush_interval, std::chrono::milliseconds(1));
+            start();
+        }
+
+        pcap_async_writer(const pcap_async_writer& other) = delete;
+        pcap_async_writer& operator=(const pcap_async_writer& other) = delete;
+        pcap_async_writer(pcap_async_writer&& other) noexcept = delete;
+        pcap_async_writer& operator=(pcap_async_writer&& other) noexcept = delete;
+
+        /// <summary>
+        /// Writes out the packets still in the ring and stops the background thread.
+        /// </summary>
+        ~pcap_async_writer()
+        {
+            exit_.store(true, std::memory_order_release);
+            std::ignore = wake_event_.signal();
+
+            if (thread_.joinable())
+                thread_.join();
+        }
+
+        /// <summary>
+        /// Captures a packet. Safe to call from any number of threads.
+        /// </summary>
+        /// <param name="buffer">The packet to capture.</param>
+        /// <param name="annotation">Attribution written with the packet in pcapng captures, may be nullptr.</param>
+        /// <returns>false if the packet was dropped because the ring is full.</returns>
+        bool capture(const INTERMEDIATE_BUFFER& buffer, const packet_annotation* annotation = nullptr) noexcept
+        {
+            const auto time = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            const auto length = static_cast<uint32_t>(buffer.m_Length);
+            const auto included = std::min(length, snaplen_);
+
+            if (options_.format == file_format::pcap)
+                annotation = nullptr;
+
+            if (!ring_.try_push_with([&](record& r) noexcept
+                {
+                    r.header = {
+                        static_cast<uint32_t>(time / 1'000'000), static_cast<uint32_t>(time % 1'000'000), included, length
+                    };
+                    r.device_flags = buffer.m_dwDeviceFlags;
+                    r.annotated = annotation != nullptr;
+
+                    if (annotation != nullptr)
+                    {
+                        r.name_length = static_cast<uint8_t>(std::min(annotation->process_name.size(), max_process_name));
+                        std::wmemcpy(r.process_name, annotation->process_name.data(), r.name_length);
+                        r.process_id = annotation->process_id;
+                        r.has_proxy = annotation->proxy_id.has_value();
+                        r.proxy_id = static_cast<uint32_t>(annotation->proxy_id.value_or(0));
+                        r.action = annotation->action;
+                        r.rewritten = annotation->rewritten;
+                    }
+
+                    std::memcpy(r.data, buffer.m_IBuffer, included);
+                }))
+            {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            // The writer sleeps until a good share of the ring is filled or the flush interval expires
+            if (ring_.size() >= wake_threshold)
+                wake_writer();
+
+            return true;
+        }
+
+        /// <summary>
+        /// Captures a packet, see capture().
+        /// </summary>
+        /// <param name="buffer">The packet to capture.</param>
+        /// <returns>A reference to the current pcap_async_writer instance.</returns>
+        pcap_async_writer& operator<<(const INTERMEDIATE_BUFFER& buffer) noexcept
+        {
+            capture(buffer);
+            return *this;
+        }
+
+        /// <summary>
+        /// Returns the capture file format.
+        /// </summary>
+        [[nodiscard]] file_format format() const noexcept
+        {
+            return options_.format;
+        }
+
+        /// <summary>
+        /// Returns the capture counters.
+        /// </summary>
+        [[nodiscard]] statistics get_statistics() const noexcept
+        {
+            return {
+                written_.load(std::memory_order_relaxed),
+                dropped_.load(std::memory_order_relaxed),
+                truncated_.load(std::memory_order_relaxed),
+                bytes_written_.load(std::memory_order_relaxed),
+                write_errors_.load(std::memory_order_relaxed),
+                files_.load(std::memory_order_relaxed)
+            };
+        }
+
+    private:
+        /// <summary>
+        /// A captured packet.
+        /// </summary>
+        struct record
+        {
+            pcaprec_hdr_t header;
+            ULONG device_flags;                                     ///< PACKET_FLAG_ON_SEND or PACKET_FLAG_ON_RECEIVE.
+            bool annotated;                                         ///< The fields below are set.
+            bool has_proxy;                                         ///< proxy_id is set.
+            bool rewritten;                                         ///< See packet_annotation.
+            packet_annotation::packet_action action;                ///< See packet_annotation.
+            uint8_t name_length;                                    ///< Characters in process_name.
+            uint32_t process_id;                                    ///< See packet_annotation.
+            uint32_t proxy_id;                                      ///< See packet_annotation.
+            wchar_t process_name[max_process_name];                 ///< Owner process name, not terminated.
+            char data[MAX_ETHER_FRAME];
+        };
+
+        /// <summary>
+        /// Enhanced Packet Block options of a record.
+        /// </summary>
+        struct packet_options
+        {
+            std::array<char, 512> data;                             ///< Encoded options including opt_endofopt.
+            std::size_t size{ 0 };                                  ///< Bytes used in data.
+
+            /// <summary>
+            /// Appends an option, padding its value to 32 bits.
+            /// </summary>
+            void add(const uint16_t code, const void* value, const std::size_t length) noexcept
+            {
+                const pcapng::option_header header{ code, static_cast<uint16_t>(length) };
+                std::memcpy(data.data() + size, &header, sizeof(header));
+
+                if (length != 0)
+                    std::memcpy(data.data() + size + sizeof(header), value, length);
+
+                std::memset(data.data() + size + sizeof(header) + length, 0, pcapng::padded(length) - length);
+                size += sizeof(header) + pcapng::padded(length);
+            }
+        };
+
+        /// <summary>
+        /// Releases the output buffers.
+        /// </summary>
+        struct virtual_free_deleter
+        {
+            void operator()(char* memory) const noexcept
+            {
+                VirtualFree(memory, 0, MEM_RELEASE);
+            }
+        };
+
+        /// <summary>Ring depth at which producers wake the writer.</summary>
+        static constexpr std::size_t wake_threshold = ring_capacity / 4;
+
+        /// <summary>Alignment of unbuffered writes, a multiple of the common sector sizes.</summary>
+        static constexpr std::size_t sector_size = 4096;
+
+        /// <summary>
+        /// Allocates the buffers, creates the first file and starts the background thread.
+        /// </summary>
+        void start()
+        {
+            buffers_.reset(static_cast<char*>(VirtualAlloc(nullptr, 2 * buffer_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE)));
+
+            if (!buffers_)
+                throw std::bad_alloc();
+
+            if (stream_ == nullptr && !open_file())
+                throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "Failed to create the pcap file");
+
+            if (stream_ != nullptr)
+                append_file_header();
+
+            thread_ = std::thread(&pcap_async_writer::run, this);
+        }
+
+        /// <summary>
+        /// Wakes the writer if it is parked, once per park.
+        ///
+        /// The fence pairs with the one the writer issues after setting parked_: either the writer
+        /// observes the ring depth before waiting, or this thread observes the parked flag.
+        /// </summary>
+        void wake_writer() noexcept
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (parked_.load(std::memory_order_relaxed) && parked_.exchange(false, std::memory_order_relaxed))
+                std::ignore = wake_event_.signal();
+        }
+
+        /// <summary>
+        /// Background thread: drains the ring, flushes and rotates files.
+        /// </summary>
+        void run()
+        {
+            auto next_flush = std::chrono::steady_clock::now() + options_.flush_interval;
+
+            while (!exit_.load(std::memory_order_acquire))
+            {
+                drain();
+
+                const auto now = std::chrono::steady_clock::now();
+
+                if (rotation_enabled() && options_.max_file_age.count() != 0 && file_records_ != 0 &&
+                    now - file_opened_ >= options_.max_file_age)
+                {
+                    rotate();
+                }
+
+                if (now >= next_flush)
+                {
+                    flush();
+                    next_flush = now + options_.flush_interval;
+                }
+
+                parked_.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                if (ring_.size() < wake_threshold && !exit_.load(std::memory_order_acquire))
+                {
+                    const auto timeout = std::chrono::ceil<std::chrono::milliseconds>(next_flush - std::chrono::steady_clock::now());
+                    std::ignore = wake_event_.wait(std::max(timeout, std::chrono::milliseconds(1)));
+                }
+
+                parked_.store(false, std::memory_order_relaxed);
+            }
+
+            drain();
+            flush();
+            close_file();
+        }
+
+        /// <summary>
+        /// Moves all published packets from the ring to the output buffers.
+        /// </summary>
+        void drain() noexcept
+        {
+            while (ring_.try_pop_with([this](const record& r) noexcept { append_record(r); }))
+            {
+            }
+        }
+
+        /// <summary>
+        /// Appends a packet record, starting a new file first if it would exceed max_file_size.
+        /// </summary>
+        void append_record(const record& r) noexcept
+        {
+            const auto pcapng = options_.format == file_format::pcapng;
+            packet_options options;
+
+            if (pcapng)
+                build_packet_options(r, options);
+
+            const auto size = pcapng
+                ? sizeof(pcapng::block_header) + sizeof(pcapng::enhanced_packet_body) + pcapng::padded(r.header.incl_len) +
+                options.size + sizeof(uint32_t)
+                : sizeof(pcaprec_hdr_t) + r.header.incl_len;
+
+            if (rotation_enabled() && options_.max_file_size != 0 && file_records_ != 0 &&
+                file_size_ + size > options_.max_file_size)
+            {
+                rotate();
+            }
+
+            if (pcapng)
+            {
+                const auto time = std::uint64_t{ r.header.ts_sec } * 1'000'000 + r.header.ts_usec;
+                const pcapng::block_header header{ pcapng::enhanced_packet_block, static_cast<uint32_t>(size) };
+                const pcapng::enhanced_packet_body body{
+                    0, static_cast<uint32_t>(time >> 32), static_cast<uint32_t>(time), r.header.incl_len, r.header.orig_len
+                };
+                constexpr uint32_t padding = 0;
+
+                append(&header, sizeof(header));
+                append(&body, sizeof(body));
+                append(r.data, r.header.incl_len);
+                append(&padding, pcapng::padded(r.header.incl_len) - r.header.incl_len);
+                append(options.data.data(), options.size);
+                append(&header.block_total_length, sizeof(uint32_t));
+            }
+            else
+            {
+                append(&r.header, sizeof(pcaprec_hdr_t));
+                append(r.data, r.header.incl_len);
+            }
+
+            file_size_ += size;
+            ++file_records_;
+            written_.fetch_add(1, std::memory_order_relaxed);
+
+            if (r.header.incl_len < r.header.orig_len)
+                truncated_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /// <summary>
+        /// Encodes the direction and the annotation of a record as Enhanced Packet Block options.
+        /// </summary>
+        static void build_packet_options(const record& r, packet_options& options) noexcept
+        {
+            static constexpr std::string_view action_names[] = { "none", "pass", "drop", "revert", "deferred" };
+
+            if (const uint32_t flags = (r.device_flags & PACKET_FLAG_ON_SEND) ? pcapng::epb_flags_outbound
+                    : (r.device_flags & PACKET_FLAG_ON_RECEIVE) ? pcapng::epb_flags_inbound : 0; flags != 0)
+            {
+                options.add(pcapng::epb_flags, &flags, sizeof(flags));
+            }
+
+            if (r.annotated)
+            {
+                char name[max_process_name * 3]{};
+                const auto name_length = r.name_length != 0
+                    ? WideCharToMultiByte(CP_UTF8, 0, r.process_name, r.name_length, name, sizeof(name), nullptr, nullptr)
+                    : 0;
+
+                char comment[256];
+                auto* out = std::format_to_n(comment, sizeof(comment), "process={} pid={}",
+                    name_length > 0 ? std::string_view(name, name_length) : std::string_view("unknown"), r.process_id).out;
+
+                if (r.has_proxy)
+                    out = std::format_to_n(out, comment + sizeof(comment) - out, " proxy={}", r.proxy_id).out;
+
+                out = std::format_to_n(out, comment + sizeof(comment) - out, " action={}{}",
+                    action_names[static_cast<std::size_t>(r.action)], r.rewritten ? " rewritten" : "").out;
+
+                options.add(pcapng::opt_comment, comment, static_cast<std::size_t>(out - comment));
+            }
+
+            if (options.size != 0)
+                options.add(pcapng::opt_endofopt, nullptr, 0);
+        }
+
+        /// <summary>
+        /// Appends the pcap file header, or the pcapng section header and interface description.
+        /// </summary>
+        void append_file_header() noexcept
+        {
+            if (options_.format == file_format::pcapng)
+            {
+                static constexpr char application[] = "netlib";
+                packet_options section_options;
+                section_options.add(pcapng::shb_userappl, application, sizeof(application) - 1);
+                section_options.add(pcapng::opt_endofopt, nullptr, 0);
+
+                const auto section_size = static_cast<uint32_t>(sizeof(pcapng::block_header) +
+                    sizeof(pcapng::section_header_body) + section_options.size + sizeof(uint32_t));
+                const pcapng::block_header section{ pcapng::section_header_block, section_size };
+                const pcapng::section_header_body section_body{ pcapng::byte_order_magic, 1, 0, -1 };
+
+                append(&section, sizeof(section));
+                append(&section_body, sizeof(section_body));
+                append(section_options.data.data(), section_options.size);
+                append(&section_size, sizeof(section_size));
+
+                constexpr auto interface_size = static_cast<uint32_t>(sizeof(pcapng::block_header) +
+                    sizeof(pcapng::interface_description_body) + sizeof(uint32_t));
+                const pcapng::block_header interface_header{ pcapng::interface_description_block, interface_size };
+                const pcapng::interface_description_body interface_body{ LINKTYPE_ETHERNET, 0, snaplen_ };
+
+                append(&interface_header, sizeof(interface_header));
+                append(&interface_body, sizeof(interface_body));
+                append(&interface_size, sizeof(interface_size));
+
+                file_size_ = section_size + interface_size;
+                return;
+            }
+
+            const pcap_hdr_t header{ 0xa1b2c3d4, 2, 4, 0, 0, snaplen_, LINKTYPE_ETHERNET };
+            append(&header, sizeof(header));
+            file_size_ = sizeof(header);
+        }
+
+        /// <summary>
+        /// Copies bytes into the current buffer, writing out every buffer that fills up.
+        /// </summary>
+        void append(const void* data, std::size_t size) noexcept
+        {
+            auto* source = static_cast<const char*>(data);
+
+            while (size != 0)
+            {
+                const auto chunk = std::min(size, buffer_size - fill_);
+                std::memcpy(current_buffer() + fill_, source, chunk);
+
+                fill_ += chunk;
+                source += chunk;
+                bytes_written_.fetch_add(chunk, std::memory_order_relaxed);
+                size -= chunk;
+                unflushed_ = true;
+
+                if (fill_ == buffer_size)
+                    write_full_buffer();
+            }
+        }
+
+        /// <summary>
+        /// Writes out the full current buffer and switches to the other one.
+        /// </summary>
+        void write_full_buffer() noexcept
+        {
+            if (stream_ != nullptr)
+            {
+                write_stream();
+                return;
+            }
+
+            // The previous write owns the other buffer until it completes
+            wait_pending();
+            begin_write(buffer_size);
+
+            file_offset_ += buffer_size;
+            current_ ^= 1;
+            fill_ = 0;
+        }
+
+        /// <summary>
+        /// Writes out the data appended since the last flush.
+        ///
+        /// An unbuffered write covers whole sectors: the last partial sector is written padded,
+        /// the file is then cut back to its real size, and the partial sector stays at the start
+        /// of the buffer to be written again with the data that follows.
+        /// </summary>
+        void flush() noexcept
+        {
+            if (stream_ != nullptr)
+            {
+                write_stream();
+
+                try
+                {
+                    stream_->flush();
+                }
+                catch (...)
+                {
+                    write_errors_.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                return;
+            }
+
+            if (!unflushed_)
+            {
+                wait_pending();
+                return;
+            }
+
+            const auto padded = (fill_ + sector_size - 1) / sector_size * sector_size;
+            std::memset(current_buffer() + fill_, 0, padded - fill_);
+
+            wait_pending();
+            begin_write(padded);
+            wait_pending();
+
+            FILE_END_OF_FILE_INFO end_of_file{};
+            end_of_file.EndOfFile.QuadPart = static_cast<LONGLONG>(file_offset_ + fill_);
+
+            if (file_ && !SetFileInformationByHandle(static_cast<HANDLE>(file_), FileEndOfFileInfo, &end_of_file, sizeof(end_of_file)))
+                write_errors_.fetch_add(1, std::memory_order_relaxed);
+
+            const auto tail = fill_ % sector_size;
+            std::memmove(current_buffer(), current_buffer() + fill_ - tail, tail);
+
+            file_offset_ += fill_ - tail;
+            fill_ = tail;
+            unflushed_ = false;
+        }
+
+        /// <summary>
+        /// Writes the current buffer to the output stream.
+        /// </summary>
+        void write_stream() noexcept
+        {
+            if (fill_ == 0)
+                return;
+
+            try
+            {
+                if (!stream_->write(current_buffer(), static_cast<std::streamsize>(fill_)))
+                    write_errors_.fetch_add(1, std::memory_order_relaxed);
+            }
+            catch (...)
+            {
+                write_errors_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            fill_ = 0;
+            unflushed_ = false;
+        }
+
+        /// <summary>
+        /// Starts an overlapped write of the current buffer at file_offset_.
+        /// </summary>
+        void begin_write(const std::size_t size) noexcept
+        {
+            if (!file_)
+            {
+                // No file after a failed rotation: the data is lost, the error was already counted
+                return;
+            }
+
+            overlapped_ = {};
+            overlapped_.Offset = static_cast<DWORD>(file_offset_);
+            overlapped_.OffsetHigh = static_cast<DWORD>(file_offset_ >> 32);
+            overlapped_.hEvent = static_cast<HANDLE>(io_event_);
+
+            if (!WriteFile(static_cast<HANDLE>(file_), current_buffer(), static_cast<DWORD>(size), nullptr, &overlapped_) &&
+                GetLastError() != ERROR_IO_PENDING)
+            {
+                write_errors_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            write_pending_ = true;
+        }
+
+        /// <summary>
+        /// Waits for the outstanding overlapped write, if any.
+        /// </summary>
+        void wait_pending() noexcept
+        {
+            if (!write_pending_)
+                return;
+
+            write_pending_ = false;
+
+            if (DWORD written = 0; !GetOverlappedResult(static_cast<HANDLE>(file_), &overlapped_, &written, TRUE))
+                write_errors_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /// <summary>
+        /// Flushes and closes the current file and creates the next one.
+        /// </summary>
+        void rotate() noexcept
+        {
+            flush();
+            close_file();
+
+            ++file_index_;
+
+            if (!open_file())
+                write_errors_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /// <summary>
+        /// Creates the file for file_index_ and removes the one falling out of the max_files window.
+        /// </summary>
+        /// <returns>false if the file cannot be created.</returns>
+        bool open_file() noexcept
+        {
+            fill_ = 0;
+            file_offset_ = 0;
+            file_size_ = 0;
+            file_records_ = 0;
+            file_opened_ = std::chrono::steady_clock::now();
+
+            try
+            {
+                file_ = netlib::winsys::safe_object_handle(CreateFileW(path_for(file_index_).c_str(), GENERIC_WRITE,
+                    FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, CREATE_ALWAYS,
+                    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED, nullptr));
+
+                if (!file_)
+                    return false;
+
+                if (rotation_enabled() && options_.max_files != 0 && file_index_ >= options_.max_files)
+                {
+                    std::error_code ec;
+                    std::filesystem::remove(path_for(file_index_ - options_.max_files), ec);
+                }
+            }
+            catch (...)
+            {
+                // Out of memory building a file name
+                if (!file_)
+                    return false;
+            }
+
+            files_.fetch_add(1, std::memory_order_relaxed);
+            append_file_header();
+            return true;
+        }
+
+        /// <summary>
+        /// Completes outstanding I/O and closes the current file.
+        /// </summary>
+        void close_file() noexcept
+        {
+            wait_pending();
+            file_.reset();
+        }
+
+        /// <summary>
+        /// Returns the name of the file with the given rotation index.
+        /// </summary>
+        [[nodiscard]] std::filesystem::path path_for(const std::uint64_t index) const
+        {
+            if (!rotation_enabled())
+                return options_.path;
+
+            auto path = options_.path;
+            path.replace_filename(std::format(L"{}_{:05}{}", options_.path.stem().wstring(), index,
+                                              options_.path.extension().wstring()));
+            return path;
+        }
+
+        /// <summary>
+        /// Returns true if files are rotated.
+        /// </summary>
+        [[nodiscard]] bool rotation_enabled() const noexcept
+        {
+            return stream_ == nullptr && (options_.max_file_size != 0 || options_.max_file_age.count() != 0);
+        }
+
+        /// <summary>
+        /// Returns the buffer being filled.
+        /// </summary>
+        [[nodiscard]] char* current_buffer() const noexcept
+        {
+            return buffers_.get() + current_ * buffer_size;
+        }
+
+        std::ostream* stream_{ nullptr };                                       ///< Output stream, nullptr when writing files.
+        file_options options_;                                                  ///< Output file settings.
+        const std::uint32_t snaplen_;                                           ///< Bytes of each packet saved.
+
+        tools::concurrency::mpsc_queue<record, ring_capacity> ring_;            ///< Captured packets.
+        std::atomic_bool parked_{ false };                                      ///< Set while the writer is (about to be) waiting.
+        std::atomic_bool exit_{ false };                                        ///< Stops the writer.
+        netlib::winsys::safe_event wake_event_{ CreateEvent(nullptr, FALSE, FALSE, nullptr) };  ///< Wakes the writer.
+
+        // Writer thread state
+        std::unique_ptr<char, virtual_free_deleter> buffers_;                   ///< The two output buffers, back to back.
+        std::size_t current_{ 0 };                                              ///< Index of the buffer being filled.
+        std::size_t fill_{ 0 };                                                 ///< Bytes in the buffer being filled.
+        bool unflushed_{ false };                                               ///< Bytes appended since the last flush.
+        netlib::winsys::safe_object_handle file_;                               ///< Current file.
+        netlib::winsys::safe_event io_event_{ CreateEvent(nullptr, TRUE, FALSE, nullptr) };  ///< Completion event of overlapped_.
+        OVERLAPPED overlapped_{};                                               ///< Outstanding write.
+        bool write_pending_{ false };                                           ///< overlapped_ is in flight.
+        std::uint64_t file_offset_{ 0 };                                        ///< File offset of the buffer being filled.
+        std::uint64_t file_size_{ 0 };                                          ///< Bytes appended to the current file.
+        std::uint64_t file_records_{ 0 };                                       ///< Packets appended to the current file.
+        std::uint64_t file_index_{ 0 };                                         ///< Rotation index of the current file.
+        std::chrono::steady_clock::time_point file_opened_{};                   ///< Creation time of the current file.
+
+        std::atomic<std::uint64_t> written_{ 0 };                               ///< See statistics.
+        std::atomic<std::uint64_t> dropped_{ 0 };                               ///< See statistics.
+        std::atomic<std::uint64_t> truncated_{ 0 };                             ///< See statistics.
+        std::atomic<std::uint64_t> bytes_written_{ 0 };                         ///< See statistics.
+        std::atomic<std::uint64_t> write_errors_{ 0 };                          ///< See statistics.
+        std::atomic<std::uint32_t> files_{ 0 };                                 ///< See statistics.
+
+        std::thread thread_;                                                    ///< Writer thread.
+    };
+}
@@ -0,0 +1,375 @@
+#pragma once
+#include "pcap.h"
+#include "pcapng.h"
+
+namespace pcap
+{
+    // --------------------------------------------------------------------------------
+    /// <summary>
+    /// Reads the Ethernet frames of a libpcap or pcapng capture, such as the files written by
+    /// pcap_stream_logger and pcap_async_writer. Both byte orders, the microsecond and nanosecond
+    /// libpcap variants and the pcapng timestamp resolutions are accepted. Frames captured on an
+    /// interface of another link type are skipped.
+    /// </summary>
+    // --------------------------------------------------------------------------------
+    class pcap_file_reader
+    {
+    public:
+        /// <summary>
+        /// Direction of a frame, only pcapng captures record it
+        /// </summary>
+        enum class packet_direction : uint8_t
+        {
+            /// <summary>not recorded</summary>
+            unknown,
+            /// <summary>received from the network</summary>
+            inbound,
+            /// <summary>sent by the host</summary>
+            outbound
+        };
+
+        /// <summary>
+        /// A captured frame
+        /// </summary>
+        struct packet
+        {
+            /// <summary>capture time since the Unix epoch</summary>
+            std::chrono::nanoseconds timestamp{};
+            /// <summary>direction of the frame</summary>
+            packet_direction direction{ packet_direction::unknown };
+            /// <summary>length of the frame on the wire, data may be shorter</summary>
+            uint32_t original_length{};
+            /// <summary>captured octets of the frame</summary>
+            std::vector<char> data;
+        };
+
+        /// <summary>
+        /// Initializes a new instance of the pcap_file_reader class.
+        /// </summary>
+        /// <param name="input">The capture, opened in binary mode.</param>
+        /// <exception cref="std::runtime_error">The stream does not start with a supported capture header.</exception>
+        explicit pcap_file_reader(std::istream& input) : input_(input)
+        {
+            uint32_t magic = 0;
+            if (!read_raw(magic))
+                throw std::runtime_error("The capture is empty");
+
+            if (magic == pcapng::section_header_block)
+            {
+                pcapng_ = true;
+                if (!read_section_header())
+                    throw std::runtime_error("Invalid pcapng section header");
+                return;
+            }
+
+            switch (magic)
+            {
+            case 0xa1b2c3d4: break;
+            case 0xd4c3b2a1: swapped_ = true; break;
+            case 0xa1b23c4d: nanoseconds_ = true; break;
+            case 0x4d3cb2a1: swapped_ = nanoseconds_ = true; break;
+            default: throw std::runtime_error("Not a libpcap or pcapng capture");
+            }
+
+            pcap_hdr_t header{};
+            if (!input_.read(reinterpret_cast<char*>(&header) + sizeof(magic), sizeof(header) - sizeof(magic)))
+                throw std::runtime_error("The capture header is truncated");
+
+            if (to_host(header.network) != LINKTYPE_ETHERNET)
+                throw std::runtime_error("Only Ethernet captures are supported");
+        }
+
+        pcap_file_reader(const pcap_file_reader& other) = delete;
+        pcap_file_reader& operator=(const pcap_file_reader& other) = delete;
+        pcap_file_reader(pcap_file_reader&& other) noexcept = delete;
+        pcap_file_reader& operator=(pcap_file_reader&& other) noexcept = delete;
+
+        ~pcap_file_reader() = default;
+
+        /// <summary>
+        /// Reads the next Ethernet frame of the capture.
+        /// </summary>
+        /// <param name="packet">Receives the frame, its buffer is reused.</param>
+        /// <returns>False at the end of the capture or at a truncated or malformed record.</returns>
+        bool read(packet& packet)
+        {
+            return pcapng_ ? read_enhanced_packet(packet) : read_record(packet);
+        }
+
+        /// <summary>
+        /// Returns true if the capture is in pcapng format.
+        /// </summary>
+        [[nodiscard]] bool is_pcapng() const noexcept
+        {
+            return pcapng_;
+        }
+
+    private:
+        /// <summary>pcapng if_tsresol option code</summary>
+        static constexpr uint16_t if_tsresol = 9;
+
+        /// <summary>
+        /// Properties of a pcapng interface
+        /// </summary>
+        struct interface_description
+        {
+            /// <summary>data link type</summary>
+            uint16_t link_type;
+            /// <summary>timestamp units per second</summary>
+            uint64_t units_per_second;
+        };
+
+        std::istream& input_;
+        bool pcapng_{ false };
+        bool swapped_{ false };
+        bool nanoseconds_{ false };
+        std::vector<interface_description> interfaces_;
+        std::vector<char> block_;
+
+        /// <summary>
+        /// Reads a value in the byte order of the file.
+        /// </summary>
+        template <typename T>
+        bool read_raw(T& value)
+        {
+            return static_cast<bool>(input_.read(reinterpret_cast<char*>(&value), sizeof(T)));
+        }
+
+        /// <summary>
+        /// Reverses the byte order of a value.
+        /// </summary>
+        template <typename T>
+        [[nodiscard]] static T byte_swap(T value) noexcept
+        {
+            auto* const bytes = reinterpret_cast<uint8_t*>(&value);
+            std::reverse(bytes, bytes + sizeof(T));
+            return value;
+        }
+
+        /// <summary>
+        /// Converts a value from the byte order of the file.
+        /// </summary>
+        template <typename T>
+        [[nodiscard]] T to_host(const T value) const noexcept
+        {
+            return swapped_ ? byte_swap(value) : value;
+        }
+
+        /// <summary>
+        /// Loads a value in the byte order of the file from a block body.
+        /// </summary>
+        template <typename T>
+        [[nodiscard]] T load(const char* data) const noexcept
+        {
+            T value;
+            std::memcpy(&value, data, sizeof(T));
+            return to_host(value);
+        }
+
+        /// <summary>
+        /// Reads a libpcap record.
+        /// </summary>
+        bool read_record(packet& packet)
+        {
+            pcaprec_hdr_t header{};
+            if (!read_raw(header))
+                return false;
+
+            const auto captured = to_host(header.incl_len);
+
+            // Refuse lengths no Ethernet capture can have rather than allocating them
+            if (captured > 256 * 1024)
+                return false;
+
+            packet.data.resize(captured);
+            if (!input_.read(packet.data.data(), captured))
+                return false;
+
+            const auto fraction = std::chrono::nanoseconds(to_host(header.ts_usec));
+            packet.timestamp = std::chrono::seconds(to_host(header.ts_sec)) + (nanoseconds_ ? fraction : fraction * 1000);
+            packet.direction = packet_direction::unknown;
+            packet.original_length = to_host(header.orig_len);
+
+            return true;
+        }
+
+        /// <summary>
+        /// Reads the rest of a Section Header Block, the block type was read already.
+        /// </summary>
+        /// <returns>False if the block is truncated or invalid.</returns>
+        bool read_section_header()
+        {
+            uint32_t length = 0, byte_order = 0;
+            if (!read_raw(length) || !read_raw(byte_order))
+                return false;
+
+            // Every section declares its own byte order
+            if (byte_order == pcapng::byte_order_magic)
+                swapped_ = false;
+            else if (byte_order == byte_swap(pcapng::byte_order_magic))
+                swapped_ = true;
+            else
+                return false;
+
+            // Interface ids are numbered per section
+            interfaces_.clear();
+
+            length = to_host(length);
+            if (length < sizeof(pcapng::block_header) + sizeof(pcapng::section_header_body) + sizeof(uint32_t) ||
+                length % 4 != 0)
+                return false;
+
+            return static_cast<bool>(input_.ignore(length - sizeof(pcapng::block_header) - sizeof(byte_order)));
+        }
+
+        /// <summary>
+        /// Reads blocks up to the next Enhanced Packet Block of an Ethernet interface.
+        /// </summary>
+        bool read_enhanced_packet(packet& packet)
+        {
+            for (;;)
+            {
+                uint32_t type = 0;
+                if (!read_raw(type))
+                    return false;
+
+                if (type == pcapng::section_header_block)
+                {
+                    if (!read_section_header())
+                        return false;
+                    continue;
+                }
+
+                uint32_t length = 0;
+                if (!read_raw(length))
+                    return false;
+
+                type = to_host(type);
+                length = to_host(length);
+
+                if (length < sizeof(pcapng::block_header) + sizeof(uint32_t) || length % 4 != 0 || length > 1024 * 1024)
+                    return false;
+
+                // The body is followed by the repeated block length
+                block_.resize(length - sizeof(pcapng::block_header));
+                if (!input_.read(block_.data(), static_cast<std::streamsize>(block_.size())))
+                    return false;
+
+                const auto body_length = block_.size() - sizeof(uint32_t);
+
+                if (type == pcapng::interface_description_block)
+                {
+                    if (body_length < sizeof(pcapng::interface_description_body))
+                        return false;
+
+                    interfaces_.push_back({ load<uint16_t>(block_.data()),
+                        timestamp_resolution(block_.data() + sizeof(pcapng::interface_description_body),
+                                             body_length - sizeof(pcapng::interface_description_body)) });
+                }
+                else if (type == pcapng::enhanced_packet_block)
+                {
+                    if (body_length < sizeof(pcapng::enhanced_packet_body))
+                        return false;
+
+                    const auto* const body = block_.data();
+                    const auto interface_id = load<uint32_t>(body + offsetof(pcapng::enhanced_packet_body, interface_id));
+                    const auto captured = load<uint32_t>(body + offsetof(pcapng::enhanced_packet_body, captured_length));
+
+                    if (captured > body_length - sizeof(pcapng::enhanced_packet_body))
+                        return false;
+
+                    if (interface_id >= interfaces_.size() || interfaces_[interface_id].link_type != LINKTYPE_ETHERNET)
+                        continue;
+
+                    const auto* const data = body + sizeof(pcapng::enhanced_packet_body);
+                    packet.data.assign(data, data + captured);
+
+                    const auto units = static_cast<uint64_t>(load<uint32_t>(body + offsetof(pcapng::enhanced_packet_body, timestamp_high))) << 32 |
+                        load<uint32_t>(body + offsetof(pcapng::enhanced_packet_body, timestamp_low));
+                    const auto per_second = interfaces_[interface_id].units_per_second;
+
+                    packet.timestamp = std::chrono::seconds(units / per_second) + std::chrono::nanoseconds(
+                        static_cast<int64_t>(static_cast<double>(units % per_second) * 1e9 / static_cast<double>(per_second)));
+                    packet.original_length = load<uint32_t>(body + offsetof(pcapng::enhanced_packet_body, original_length));
+
+                    const auto options = sizeof(pcapng::enhanced_packet_body) + pcapng::padded(captured);
+                    packet.direction = options < body_length
+                        ? direction_of(body + options, body_length - options)
+                        : packet_direction::unknown;
+
+                    return true;
+                }
+
+                // Other blocks (name resolution, statistics, ...) carry no frames
+            }
+        }
+
+        /// <summary>
+        /// Finds an option in a block option list.
+        /// </summary>
+        /// <returns>Pointer to the value and its length, nullptr if the option is absent.</returns>
+        [[nodiscard]] std::pair<const char*, uint16_t> find_option(const char* options, std::size_t length, const uint16_t code) const
+        {
+            while (length >= sizeof(pcapng::option_header))
+            {
+                const auto option_code = load<uint16_t>(options);
+                const auto option_length = load<uint16_t>(options + sizeof(uint16_t));
+
+                if (option_code == pcapng::opt_endofopt || length - sizeof(pcapng::option_header) < option_length)
+                    break;
+
+                if (option_code == code)
+                    return { options + sizeof(pcapng::option_header), option_length };
+
+                const auto size = sizeof(pcapng::option_header) + pcapng::padded(option_length);
+                if (size > length)
+                    break;
+
+                options += size;
+                length -= size;
+            }
+
+            return { nullptr, 0 };
+        }
+
+        /// <summary>
+        /// Returns the timestamp units per second of an interface, microseconds unless if_tsresol says otherwise.
+        /// </summary>
+        [[nodiscard]] uint64_t timestamp_resolution(const char* options, const std::size_t length) const
+        {
+            const auto [value, value_length] = find_option(options, length, if_tsresol);
+            if (value == nullptr || value_length != 1)
+                return 1'000'000;
+
+            // The most significant bit selects a power of two instead of a power of ten
+            const auto resolution = static_cast<uint8_t>(*value);
+            const auto exponent = resolution & 0x7f;
+
+            if (resolution & 0x80)
+                return exponent < 64 ? uint64_t{ 1 } << exponent : 1'000'000;
+
+            uint64_t units = 1;
+            for (auto i = 0; i < exponent && i < 19; ++i)
+                units *= 10;
+
+            return units;
+        }
+
+        /// <summary>
+        /// Returns the direction recorded in the epb_flags option of an Enhanced Packet Block.
+        /// </summary>
+        [[nodiscard]] packet_direction direction_of(const char* options, const std::size_t length) const
+        {
+            const auto [value, value_length] = find_option(options, length, pcapng::epb_flags);
+            if (value == nullptr || value_length != sizeof(uint32_t))
+                return packet_direction::unknown;
+
+            switch (load<uint32_t>(value) & 0x3)
+            {
+            case pcapng::epb_flags_inbound: return packet_direction::inbound;
+            case pcapng::epb_flags_outbound: return packet_direction::outbound;
+            default: return packet_direction::unknown;
+            }
+        }
+    };
+}
@@ -0,0 +1,146 @@
+// ReSharper disable CppInconsistentNaming
+#pragma once
+
+namespace pcap
+{
+    // --------------------------------------------------------------------------------
+    /// <summary>
+    /// pcapng (PCAP Next Generation) block and option codes used by the capture writer
+    /// </summary>
+    // --------------------------------------------------------------------------------
+    namespace pcapng
+    {
+        /// <summary>Section Header Block type</summary>
+        constexpr uint32_t section_header_block = 0x0A0D0D0A;
+        /// <summary>Interface Description Block type</summary>
+        constexpr uint32_t interface_description_block = 0x00000001;
+        /// <summary>Enhanced Packet Block type</summary>
+        constexpr uint32_t enhanced_packet_block = 0x00000006;
+
+        /// <summary>Section Header Block byte-order magic</summary>
+        constexpr uint32_t byte_order_magic = 0x1A2B3C4D;
+
+        /// <summary>End of the option list</summary>
+        constexpr uint16_t opt_endofopt = 0;
+        /// <summary>UTF-8 comment, valid in every block</summary>
+        constexpr uint16_t opt_comment = 1;
+        /// <summary>Enhanced Packet Block flags word (direction, reception type)</summary>
+        constexpr uint16_t epb_flags = 2;
+        /// <summary>Name of the application that wrote the section</summary>
+        constexpr uint16_t shb_userappl = 4;
+
+        /// <summary>epb_flags direction: inbound</summary>
+        constexpr uint32_t epb_flags_inbound = 0x1;
+        /// <summary>epb_flags direction: outbound</summary>
+        constexpr uint32_t epb_flags_outbound = 0x2;
+
+        /// <summary>
+        /// Leading fields common to all blocks, the block total length is repeated after the body
+        /// </summary>
+        struct block_header
+        {
+            /// <summary>block type</summary>
+            uint32_t block_type;
+            /// <summary>block size in octets including the header and the trailing length</summary>
+            uint32_t block_total_length;
+        };
+
+        /// <summary>
+        /// Section Header Block body
+        /// </summary>
+        struct section_header_body
+        {
+            /// <summary>byte_order_magic in the writer's byte order</summary>
+            uint32_t byte_order_magic;
+            /// <summary>major version number</summary>
+            uint16_t version_major;
+            /// <summary>minor version number</summary>
+            uint16_t version_minor;
+            /// <summary>section size in octets, -1 if not specified</summary>
+            int64_t section_length;
+        };
+
+        /// <summary>
+        /// Interface Description Block body
+        /// </summary>
+        struct interface_description_body
+        {
+            /// <summary>data link type</summary>
+            uint16_t link_type;
+            /// <summary>reserved, must be zero</summary>
+            uint16_t reserved;
+            /// <summary>max length of captured packets, in octets</summary>
+            uint32_t snaplen;
+        };
+
+        /// <summary>
+        /// Enhanced Packet Block body preceding the packet data
+        /// </summary>
+        struct enhanced_packet_body
+        {
+            /// <summary>index of the interface in the section</summary>
+            uint32_t interface_id;
+            /// <summary>upper 32 bits of the timestamp (microseconds since 1970 by default)</summary>
+            uint32_t timestamp_high;
+            /// <summary>lower 32 bits of the timestamp</summary>
+            uint32_t timestamp_low;
+            /// <summary>number of octets of packet saved in file</summary>
+            uint32_t captured_length;
+            /// <summary>actual length of packet</summary>
+            uint32_t original_length;
+        };
+
+        /// <summary>
+        /// Option header, the value follows padded to 32 bits
+        /// </summary>
+        struct option_header
+        {
+            /// <summary>option code</summary>
+            uint16_t code;
+            /// <summary>value length in octets, without padding</summary>
+            uint16_t length;
+        };
+
+        /// <summary>
+        /// Rounds a length up to the 32-bit alignment of block fields
+        /// </summary>
+        constexpr std::size_t padded(const std::size_t length) noexcept
+        {
+            return (length + 3) & ~std::size_t{ 3 };
+        }
+    }
+
+    /// <summary>
+    /// Attribution of a captured packet, written as Enhanced Packet Block comment in pcapng captures
+    /// </summary>
+    struct packet_annotation
+    {
+        /// <summary>
+        /// What the router did with the packet
+        /// </summary>
+        enum class packet_action : uint8_t
+        {
+            /// <summary>not decided (yet)</summary>
+            none,
+            /// <summary>passed unchanged</summary>
+            pass,
+            /// <summary>dropped</summary>
+            drop,
+            /// <summary>rewritten and sent back in the opposite direction (redirected to/from a proxy)</summary>
+            revert,
+            /// <summary>queued until its owner process is resolved</summary>
+            deferred
+        };
+
+        /// <summary>owner process name, empty if unknown</summary>
+        std::wstring_view process_name;
+        /// <summary>owner process id, 0 if unknown</summary>
+        uint32_t process_id{ 0 };
+        /// <summary>SOCKS5 proxy the owner is associated with</summary>
+        std::optional<std::size_t> proxy_id;
+        /// <summary>router decision</summary>
+        packet_action action{ packet_action::none };
+        /// <summary>the packet as rewritten by the router rather than as received</summary>
+        bool rewritten{ false };
+    };
+}
@@ -0,0 +1,280 @@
+#pragma once
+
+namespace proxy
+{
+    /**
+     * @class app_name_automaton
+     * @brief Aho-Corasick automaton over a set of prioritized substring patterns.
+     *
+     * Patterns are added with a priority (lower wins) and compiled once; afterwards find_first()
+     * scans a text in a single pass and returns the lowest priority among all patterns occurring
+     * anywhere in the text. The compiled automaton is immutable and safe for concurrent readers.
+     */
+    class app_name_automaton
+    {
+    public:
+        /// Returned by find_first() when no pattern occurs in the text.
+        static constexpr uint32_t no_match = std::numeric_limits<uint32_t>::max();
+
+        /**
+         * @brief Adds a pattern. Must be called before compile().
+         * @param pattern Substring to search for.
+         * @param priority Pattern priority, lower values win.
+         */
+        void add(const std::wstring_view pattern, const uint32_t priority)
+        {
+            uint32_t state = 0;
+
+            for (const auto symbol : pattern)
+            {
+                auto next = child(state, symbol);
+                if (next == 0)
+                {
+                    next = static_cast<uint32_t>(nodes_.size());
+                    nodes_.emplace_back();
+
+                    auto& transitions = nodes_[state].transitions;
+                    transitions.insert(std::ranges::lower_bound(transitions, symbol, {}, &transition::first),
+                                       transition{ symbol, next });
+                }
+                state = next;
+            }
+
+            nodes_[state].best = std::min(nodes_[state].best, priority);
+            patterns_ = true;
+        }
+
+        /**
+         * @brief Builds the failure links and propagates pattern priorities along them.
+         */
+        void compile()
+        {
+            std::vector<uint32_t> queue;
+            queue.reserve(nodes_.size());
+
+            for (const auto& [symbol, next] : nodes_[0].transitions)
+            {
+                nodes_[next].fail = 0;
+                queue.push_back(next);
+            }
+
+            // Breadth-first order guarantees the failure target of a node is final before the node itself
+            for (std::size_t i = 0; i < queue.size(); ++i)
+            {
+                const auto state = queue[i];
+                nodes_[state].best = std::min(nodes_[state].best, nodes_[nodes_[state].fail].best);
+
+                for (const auto& [symbol, next] : nodes_[state].transitions)
+                {
+                    nodes_[next].fail = step(nodes_[state].fail, symbol);
+                    queue.push_back(next);
+                }
+            }
+        }
+
+        /**
+         * @brief Returns the lowest priority of all patterns occurring in the text.
+         * @param text Text to scan.
+         * @return Pattern priority, or no_match.
+         */
+        [[nodiscard]] uint32_t find_first(const std::wstring_view text) const noexcept
+        {
+            if (!patterns_)
+                return no_match;
+
+            uint32_t state = 0;
+            auto best = nodes_[0].best;
+
+            for (const auto symbol : text)
+            {
+                if (best == 0)
+                    break;
+
+                state = step(state, symbol);
+                best = std::min(best, nodes_[state].best);
+            }
+
+            return best;
+        }
+
+        /**
+         * @brief Returns true if no pattern has been added.
+         */
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return !patterns_;
+        }
+
+    private:
+        using transition = std::pair<wchar_t, uint32_t>;
+
+        /**
+         * @struct node
+         * @brief Automaton state.
+         */
+        struct node
+        {
+            std::vector<transition> transitions;    ///< Outgoing edges sorted by symbol.
+            uint32_t fail{ 0 };                     ///< Longest proper suffix state.
+            uint32_t best{ no_match };              ///< Lowest priority of patterns ending here or at any suffix state.
+        };
+
+        /**
+         * @brief Returns the direct child of a state for a symbol, or 0 (root) if there is none.
+         */
+        [[nodiscard]] uint32_t child(const uint32_t state, const wchar_t symbol) const noexcept
+        {
+            const auto& transitions = nodes_[state].transitions;
+            const auto it = std::ranges::lower_bound(transitions, symbol, {}, &transition::first);
+            return (it != transitions.end() && it->first == symbol) ? it->second : 0;
+        }
+
+        /**
+         * @brief Follows the goto/failure functions for a symbol.
+         */
+        [[nodiscard]] uint32_t step(uint32_t state, const wchar_t symbol) const noexcept
+        {
+            for (;;)
+            {
+                if (const auto next = child(state, symbol); next != 0 || state == 0)
+                    return next;
+                state = nodes_[state].fail;
+            }
+        }
+
+        /// Automaton states, node 0 is the root.
+        std::vector<node> nodes_{ 1 };
+        /// True once at least one pattern has been added.
+        bool patterns_{ false };
+    };
+
+    /**
+     * @class app_name_matcher
+     * @brief Immutable, compiled form of the router's process-to-proxy associations and exclusions.
+     *
+     * Mirrors the matching rules of the original linear scan: a pattern or exclusion containing a
+     * path separator is matched as a substring of the process path, otherwise of the process name;
+     * the first association (lowest proxy index, then insertion order) that matches wins; a process
+     * matching any exclusion is excluded, provided at least one association exists.
+     *
+     * All patterns are expected in upper case, matching the normalization of iphelper::network_process.
+     */
+    class app_name_matcher
+    {
+    public:
+        /**
+         * @struct match_result
+         * @brief Outcome of matching a process against the compiled rules.
+         */
+        struct match_result
+        {
+            bool excluded{ false };                 ///< Process matched an exclusion entry.
+            std::optional<std::size_t> proxy_id;    ///< Index of the associated proxy, if any.
+        };
+
+        /**
+         * @brief Compiles the associations and exclusions.
+         * @param generation Non-zero identifier of this configuration revision, used to tag memoized results.
+         * @param associations Proxy index to upper-cased process name/path pattern.
+         * @param excluded Upper-cased excluded process names/paths.
+         */
+        app_name_matcher(const uint32_t generation, const std::multimap<std::size_t, std::wstring>& associations,
+                         const std::vector<std::wstring>& excluded)
+            : generation_(generation)
+        {
+            proxy_ids_.reserve(associations.size());
+
+            for (const auto& [proxy_id, pattern] : associations)
+            {
+                const auto priority = static_cast<uint32_t>(proxy_ids_.size());
+                (is_path_pattern(pattern) ? path_patterns_ : name_patterns_).add(pattern, priority);
+                proxy_ids_.push_back(proxy_id);
+            }
+
+            for (const auto& entry : excluded)
+            {
+                (is_path_pattern(entry) ? path_exclusions_ : name_exclusions_).add(entry, 0);
+            }
+
+            name_patterns_.compile();
+            path_patterns_.compile();
+            name_exclusions_.compile();
+            path_exclusions_.compile();
+        }
+
+        /**
+         * @brief Returns the configuration revision this matcher was compiled from.
+         */
+        [[nodiscard]] uint32_t generation() const noexcept
+        {
+            return generation_;
+        }
+
+        /**
+         * @brief Matches a process against the compiled rules.
+         * @param name Upper-cased process name.
+         * @param path_name Upper-cased process executable path.
+         * @return The match result.
+         */
+        [[nodiscard]] match_result match(const std::wstring_view name, const std::wstring_view path_name) const noexcept
+        {
+            if (proxy_ids_.empty())
+                return {};
+
+            if (name_exclusions_.find_first(name) != app_name_automaton::no_match ||
+                path_exclusions_.find_first(path_name) != app_name_automaton::no_match)
+                return { true, std::nullopt };
+
+            const auto best = std::min(name_patterns_.find_first(name), path_patterns_.find_first(path_name));
+            if (best == app_name_automaton::no_match)
+                return {};
+
+            return { false, proxy_ids_[best] };
+        }
+
+        /**
+         * @brief Packs a match result and the matcher generation into a single memo word.
+         */
+        [[nodiscard]] uint64_t encode(const match_result& result) const noexcept
+        {
+            return static_cast<uint64_t>(generation_) << 32 |
+                (result.excluded ? excluded_flag : 0) |
+                (result.proxy_id ? static_cast<uint32_t>(result.proxy_id.value() + 1) : 0);
+        }
+
+        /**
+         * @brief Unpacks a memo word produced by encode().
+         * @return The memoized result, or std::nullopt if it belongs to another generation.
+         */
+        [[nodiscard]] std::optional<match_result> decode(const uint64_t memo) const noexcept
+        {
+            if (static_cast<uint32_t>(memo >> 32) != generation_)
+                return std::nullopt;
+
+            const auto proxy = static_cast<uint32_t>(memo) & ~excluded_flag;
+            return match_result{
+                (static_cast<uint32_t>(memo) & excluded_flag) != 0,
+                proxy ? std::optional<std::size_t>(proxy - 1) : std::nullopt
+            };
+        }
+
+    private:
+        /// Memo word bit marking an excluded process.
+        static constexpr uint32_t excluded_flag = 0x80000000u;
+
+        /**
+         * @brief Path patterns are matched against the full executable path, others against the name.
+         */
+        static bool is_path_pattern(const std::wstring& pattern) noexcept
+        {
+            return pattern.find(L'\\') != std::wstring::npos || pattern.find(L'/') != std::wstring::npos;
+        }
+
+        uint32_t generation_;                       ///< Configuration revision.
+        std::vector<std::size_t> proxy_ids_;        ///< Proxy index by pattern priority.
+        app_name_automaton name_patterns_;          ///< Association patterns matched against the name.
+        app_name_automaton path_patterns_;          ///< Association patterns matched against the path.
+        app_name_automaton name_exclusions_;        ///< Exclusions matched against the name.
+        app_name_automaton path_exclusions_;        ///< Exclusions matched against the path.
+    };
+}
@@ -0,0 +1,496 @@
+#pragma once
+
+namespace proxy
+{
+    /**
+     * @class dns_cache
+     * @brief In-memory cache of DNS responses keyed by question, honoring the record TTLs.
+     *
+     * Only standard queries with a single question are handled. The key is the question name
+     * (case-folded, in wire format), type and class, so a cached response answers any query for
+     * the same question regardless of its ID.
+     *
+     * A positive response lives for the smallest TTL of its records. NXDOMAIN and NODATA responses
+     * are cached as well (RFC 2308), for the smaller of the SOA record TTL and its MINIMUM field;
+     * negative responses without an SOA record, truncated responses and other response codes are
+     * not cached. The lifetimes are clamped to the configured bounds. An answer taken from the
+     * cache has the query's ID and its record TTLs reduced by the time spent in the cache.
+     *
+     * When the cache is full, expired entries are evicted first, then the entry closest to expiry.
+     *
+     * All public methods are thread-safe.
+     */
+    class dns_cache
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        /**
+         * @brief Size of the DNS message header.
+         */
+        static constexpr std::size_t header_length = 12;
+
+        /**
+         * @brief Record type of EDNS OPT pseudo-records, which carry no TTL.
+         */
+        static constexpr uint16_t type_opt = 41;
+
+        /**
+         * @brief Record type of SOA records.
+         */
+        static constexpr uint16_t type_soa = 6;
+
+        /**
+         * @brief Response code of a name that does not exist.
+         */
+        static constexpr uint8_t rcode_nxdomain = 3;
+
+        /**
+         * @brief Response code of a server failure.
+         */
+        static constexpr uint8_t rcode_servfail = 2;
+
+        /**
+         * @struct options
+         * @brief Cache settings.
+         */
+        struct options
+        {
+            std::size_t max_entries{ 4096 };                    ///< Largest number of cached questions.
+            std::chrono::seconds min_ttl{ 0 };                  ///< Lower bound of a positive entry lifetime.
+            std::chrono::seconds max_ttl{ 3600 };               ///< Upper bound of a positive entry lifetime.
+            std::chrono::seconds max_negative_ttl{ 300 };       ///< Upper bound of a negative entry lifetime.
+        };
+
+        /**
+         * @struct statistics
+         * @brief Cache counters.
+         */
+        struct statistics
+        {
+            std::size_t entries;        ///< Questions currently cached.
+            uint64_t hits;              ///< Queries answered from the cache.
+            uint64_t negative_hits;     ///< Hits on NXDOMAIN/NODATA entries, included in hits.
+            uint64_t misses;            ///< Lookups of questions not cached or expired.
+            uint64_t evictions;         ///< Live entries evicted to make room.
+        };
+
+        /**
+         * @brief Constructs an empty cache.
+         * @param settings Cache settings.
+         */
+        explicit dns_cache(const options& settings)
+            : options_(settings)
+        {
+        }
+
+        /**
+         * @brief Returns the cache key of a standard query with a single question.
+         *
+         * @param query The DNS query message.
+         * @return The key, or std::nullopt if the message is not such a query.
+         */
+        [[nodiscard]] static std::optional<std::string> key_of(const std::span<const uint8_t> query)
+        {
+            if (query.size() < header_length)
+                return std::nullopt;
+
+            // QR must be clear and OPCODE must be QUERY
+            if ((query[2] & 0xf8) != 0 || read_u16(query, 4) != 1)
+                return std::nullopt;
+
+            return question_key(query);
+        }
+
+        /**
+         * @brief Writes the cached response to a query.
+         *
+         * @param key Key of the query, see key_of().
+         * @param id ID of the query (network byte order as in the message).
+         * @param response Buffer receiving the response, may overlap the query.
+         * @return The response length, 0 if the question is not cached or the response does not fit.
+         */
+        std::size_t find(const std::string& key, const uint16_t id, const std::span<uint8_t> response)
+        {
+            std::scoped_lock lock(lock_);
+
+            const auto it = entries_.find(key);
+            const auto now = clock::now();
+
+            if (it == entries_.end() || it->second.expires <= now)
+            {
+                ++misses_;
+                return 0;
+            }
+
+            const auto& entry = it->second;
+
+            if (entry.message.size() > response.size())
+                return 0;
+
+            std::memmove(response.data(), entry.message.data(), entry.message.size());
+            std::memcpy(response.data(), &id, sizeof(id));
+
+            // The records have aged by the time spent in the cache
+            const auto age = static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::seconds>(now - entry.stored).count());
+
+            for (const auto offset : entry.ttl_offsets)
+            {
+                const auto ttl = read_u32(entry.message, offset);
+                write_u32(response, offset, ttl > age ? ttl - age : 0);
+            }
+
+            ++hits_;
+            if (entry.negative)
+                ++negative_hits_;
+
+            return entry.message.size();
+        }
+
+        /**
+         * @brief Caches a response if it is cacheable.
+         *
+         * @param key Key of the query the response answers.
+         * @param response The DNS response message.
+         * @return true if the response was cached.
+         */
+        bool insert(const std::string& key, const std::span<const uint8_t> response)
+        {
+            if (response.size() < header_length || (response[2] & 0x80) == 0 || (response[2] & 0x02) != 0)
+                return false; // not a response, or truncated
+
+            const auto rcode = static_cast<uint8_t>(response[3] & 0x0f);
+            if (rcode != 0 && rcode != rcode_nxdomain)
+                return false;
+
+            // The response must answer the very question it is cached for
+            if (const auto response_key = question_key(response); !response_key || response_key.value() != key)
+                return false;
+
+            auto offset = skip_question(response);
+            if (!offset)
+                return false;
+
+            const auto answers = read_u16(response, 6);
+            const auto records = static_cast<std::size_t>(answers) + read_u16(response, 8) + read_u16(response, 10);
+
+            std::vector<std::size_t> ttl_offsets;
+            std::optional<uint32_t> min_ttl;
+            std::optional<uint32_t> negative_ttl;
+
+            for (std::size_t i = 0; i < records; ++i)
+            {
+                const auto record = parse_record(response, offset.value());
+                if (!record)
+                    return false;
+
+                if (record->type != type_opt)
+                {
+                    ttl_offsets.push_back(record->ttl_offset);
+                    min_ttl = std::min(min_ttl.value_or(record->ttl), record->ttl);
+
+                    // RFC 2308: negative answers live for min(SOA TTL, SOA MINIMUM)
+                    if (record->type == type_soa && i >= answers && record->data_length >= 4)
+                    {
+                        const auto minimum = read_u32(response, record->data_offset + record->data_length - 4);
+                        negative_ttl = std::min(record->ttl, minimum);
+                    }
+                }
+
+                offset = record->data_offset + record->data_length;
+            }
+
+            const auto negative = rcode == rcode_nxdomain || answers == 0;
+
+            std::chrono::seconds ttl;
+            if (negative)
+            {
+                if (!negative_ttl)
+                    return false;
+
+                ttl = std::min(std::chrono::seconds{ negative_ttl.value() }, options_.max_negative_ttl);
+            }
+            else
+            {
+                ttl = std::clamp(std::chrono::seconds{ min_ttl.value_or(0) }, options_.min_ttl, options_.max_ttl);
+            }
+
+            if (ttl.count() == 0 || options_.max_entries == 0)
+                return false;
+
+            const auto now = clock::now();
+
+            std::scoped_lock lock(lock_);
+
+            if (entries_.size() >= options_.max_entries && entries_.find(key) == entries_.end())
+                make_room(now);
+
+            entries_.insert_or_assign(key, entry{
+                std::vector<uint8_t>(response.begin(), response.end()), std::move(ttl_offsets),
+                now, now + ttl, negative });
+
+            return true;
+        }
+
+        /**
+         * @brief Drops every cached response.
+         */
+        void clear()
+        {
+            std::scoped_lock lock(lock_);
+            entries_.clear();
+        }
+
+        /**
+         * @brief Returns a snapshot of the cache counters.
+         */
+        [[nodiscard]] statistics get_statistics() const
+        {
+            std::scoped_lock lock(lock_);
+            return { entries_.size(), hits_, negative_hits_, misses_, evictions_ };
+        }
+
+        /**
+         * @brief Turns a query into a SERVFAIL response in place, for queries that could not be forwarded.
+         *
+         * @param message The query, becomes the response.
+         * @return The response length (header and question), 0 if the query is malformed.
+         */
+        static std::size_t make_servfail(const std::span<uint8_t> message) noexcept
+        {
+            const auto question_end = skip_question(message);
+            if (!question_end)
+                return 0;
+
+            // QR set, RD kept, RA set, RCODE SERVFAIL; only the question is echoed
+            message[2] = static_cast<uint8_t>(0x80 | (message[2] & 0x01));
+            message[3] = static_cast<uint8_t>(0x80 | rcode_servfail);
+            write_u16(message, 6, 0);
+            write_u16(message, 8, 0);
+            write_u16(message, 10, 0);
+
+            return question_end.value();
+        }
+
+        /**
+         * @brief Copies a response into a buffer, truncating it to the question with TC set if it does not fit.
+         *
+         * A truncated response makes the client repeat the query over TCP.
+         *
+         * @param response The DNS response message.
+         * @param buffer Buffer receiving the response.
+         * @return The written length, 0 if even the truncated response does not fit.
+         */
+        static std::size_t copy_response(const std::span<const uint8_t> response, const std::span<uint8_t> buffer) noexcept
+        {
+            if (response.size() <= buffer.size())
+            {
+                std::memcpy(buffer.data(), response.data(), response.size());
+                return response.size();
+            }
+
+            const auto question_end = skip_question(response);
+            if (!question_end || question_end.value() > buffer.size())
+                return 0;
+
+            std::memcpy(buffer.data(), response.data(), question_end.value());
+            buffer[2] |= 0x02;
+            write_u16(buffer, 6, 0);
+            write_u16(buffer, 8, 0);
+            write_u16(buffer, 10, 0);
+
+            return question_end.value();
+        }
+
+        /**
+         * @brief Returns the ID of a DNS message as stored in the message (network byte order).
+         */
+        [[nodiscard]] static uint16_t id_of(const std::span<const uint8_t> message) noexcept
+        {
+            uint16_t id;
+            std::memcpy(&id, message.data(), sizeof(id));
+            return id;
+        }
+
+    private:
+        /**
+         * @struct entry
+         * @brief Cached response.
+         */
+        struct entry
+        {
+            std::vector<uint8_t> message;               ///< Response as received, with its original TTLs.
+            std::vector<std::size_t> ttl_offsets;       ///< Offsets of the record TTL fields in message.
+            clock::time_point stored;                   ///< Time the response was cached.
+            clock::time_point expires;                  ///< Time the entry stops answering.
+            bool negative;                              ///< NXDOMAIN or NODATA response.
+        };
+
+        /**
+         * @struct record
+         * @brief Location of a resource record in a message.
+         */
+        struct record
+        {
+            uint16_t type;              ///< Record type.
+            uint32_t ttl;               ///< Record TTL.
+            std::size_t ttl_offset;     ///< Offset of the TTL field.
+            std::size_t data_offset;    ///< Offset of RDATA.
+            std::size_t data_length;    ///< Length of RDATA.
+        };
+
+        static uint16_t read_u16(const std::span<const uint8_t> message, const std::size_t offset) noexcept
+        {
+            return static_cast<uint16_t>(message[offset] << 8 | message[offset + 1]);
+        }
+
+        static uint32_t read_u32(const std::span<const uint8_t> message, const std::size_t offset) noexcept
+        {
+            return static_cast<uint32_t>(read_u16(message, offset)) << 16 | read_u16(message, offset + 2);
+        }
+
+        static void write_u16(const std::span<uint8_t> message, const std::size_t offset, const uint16_t value) noexcept
+        {
+            message[offset] = static_cast<uint8_t>(value >> 8);
+            message[offset + 1] = static_cast<uint8_t>(value);
+        }
+
+        static void write_u32(const std::span<uint8_t> message, const std::size_t offset, const uint32_t value) noexcept
+        {
+            write_u16(message, offset, static_cast<uint16_t>(value >> 16));
+            write_u16(message, offset + 2, static_cast<uint16_t>(value));
+        }
+
+        /**
+         * @brief Returns the offset following the (possibly compressed) name starting at offset.
+         */
+        static std::optional<std::size_t> skip_name(const std::span<const uint8_t> message, std::size_t offset) noexcept
+        {
+            while (offset < message.size())
+            {
+                const auto length = message[offset];
+
+                if (length == 0)
+                    return offset + 1;
+
+                // A compression pointer ends the name
+                if ((length & 0xc0) == 0xc0)
+                    return offset + 2 <= message.size() ? std::optional(offset + 2) : std::nullopt;
+
+                if ((length & 0xc0) != 0)
+                    return std::nullopt;
+
+                offset += 1 + length;
+            }
+
+            return std::nullopt;
+        }
+
+        /**
+         * @brief Returns the offset following the single question of a message.
+         */
+        static std::optional<std::size_t> skip_question(const std::span<const uint8_t> message) noexcept
+        {
+            if (message.size() < header_length || read_u16(message, 4) != 1)
+                return std::nullopt;
+
+            const auto name_end = skip_name(message, header_length);
+            if (!name_end || name_end.value() + 4 > message.size())
+                return std::nullopt;
+
+            return name_end.value() + 4;
+        }
+
+        /**
+         * @brief Builds the key of the single question of a message: case-folded name, type and class.
+         *
+         * The question name of a query is never compressed, a compressed one is rejected.
+         */
+        static std::optional<std::string> question_key(const std::span<const uint8_t> message)
+        {
+            const auto question_end = skip_question(message);
+            if (!question_end)
+                return std::nullopt;
+
+            std::string key(reinterpret_cast<const char*>(message.data()) + header_length,
+                            question_end.value() - header_length);
+
+            for (std::size_t i = 0; i + 4 < key.size();)
+            {
+                const auto length = static_cast<uint8_t>(key[i]);
+                if ((length & 0xc0) != 0)
+                    return std::nullopt;
+
+                for (std::size_t j = i + 1; j <= i + length; ++j)
+                    key[j] = static_cast<char>(std::tolower(static_cast<unsigned char>(key[j])));
+
+                i += 1 + length;
+            }
+
+            return key;
+        }
+
+        /**
+         * @brief Parses the resource record starting at offset.
+         */
+        static std::optional<record> parse_record(const std::span<const uint8_t> message, const std::size_t offset) noexcept
+        {
+            const auto name_end = skip_name(message, offset);
+
+            // TYPE, CLASS, TTL and RDLENGTH
+            if (!name_end || name_end.value() + 10 > message.size())
+                return std::nullopt;
+
+            const auto position = name_end.value();
+            const auto data_length = read_u16(message, position + 8);
+
+            if (position + 10 + data_length > message.size())
+                return std::nullopt;
+
+            return record{ read_u16(message, position), read_u32(message, position + 4), position + 4, position + 10,
+                           data_length };
+        }
+
+        /**
+         * @brief Evicts the expired entries, or the one closest to expiry if none has expired. Called under lock_.
+         */
+        void make_room(const clock::time_point now)
+        {
+            if (entries_.erase_if([now](const auto& value) { return value.second.expires <= now; }) != 0)
+                return;
+
+            const auto oldest = std::min_element(entries_.begin(), entries_.end(), [](const auto& lhs, const auto& rhs) {
+                return lhs.second.expires < rhs.second.expires;
+            });
+            if (oldest != entries_.end())
+            {
+                entries_.erase(oldest);
+                ++evictions_;
+            }
+        }
+
+        /**
+         * @brief Cache settings.
+         */
+        options options_;
+
+        /**
+         * @brief Protects entries_ and the counters.
+         */
+        mutable std::mutex lock_;
+
+        /**
+         * @brief Cached responses by question key.
+         */
+        tools::generic::flat_hash_map<std::string, entry> entries_;
+
+        /**
+         * @brief Cache counters.
+         */
+        uint64_t hits_{ 0 };
+        uint64_t negative_hits_{ 0 };
+        uint64_t misses_{ 0 };
+        uint64_t evictions_{ 0 };
+    };
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+namespace proxy
+{
+    /**
+     * @class flow_hold_table
+     * @brief Fixed-size, lock-free table of flows that have packets waiting for deferred process resolution.
+     *
+     * While the first packets of a flow sit in the deferred-resolve queue, later packets of the same
+     * flow must queue up behind them instead of overtaking them through the fast path. The table
+     * counts the queued packets per flow: hold() is called for every deferred packet, release()
+     * once the packet has been re-injected or dropped, and is_held() tells the packet path whether
+     * a flow still has packets in flight.
+     *
+     * Flows are hashed to a fixed number of counting slots without storing the key. A collision
+     * only holds back an unrelated flow for one resolver pass, which delays but never reorders it.
+     * A slot stops holding new packets once it has been occupied for longer than the hold timeout,
+     * so a lagging resolver cannot stall a flow indefinitely.
+     *
+     * @tparam T IP address type (net::ip_address_v4 or net::ip_address_v6).
+     * @tparam Size Number of slots, must be a power of two.
+     */
+    template <net::ip_address T, std::size_t Size = 4096>
+    class flow_hold_table
+    {
+        static_assert(std::has_single_bit(Size), "flow_hold_table size must be a power of two");
+
+    public:
+        /// Flow identifier, shared with the per-flow verdict cache.
+        using flow_key = typename flow_verdict_cache<T>::flow_key;
+
+        /**
+         * @brief Constructs an empty table.
+         * @param timeout Maximum time a flow is held, counted from its first deferred packet.
+         */
+        explicit flow_hold_table(const std::chrono::milliseconds timeout = std::chrono::milliseconds{ 2000 })
+            : timeout_(static_cast<uint32_t>(timeout.count()))
+        {
+        }
+
+        flow_hold_table(const flow_hold_table&) = delete;
+        flow_hold_table(flow_hold_table&&) = delete;
+        flow_hold_table& operator=(const flow_hold_table&) = delete;
+        flow_hold_table& operator=(flow_hold_table&&) = delete;
+        ~flow_hold_table() = default;
+
+        /**
+         * @brief Returns the slot a flow maps to.
+         */
+        [[nodiscard]] static std::size_t slot_of(const flow_key& key) noexcept
+        {
+            std::array<uint8_t, 2 * sizeof(T)> addresses{};
+            std::memcpy(addresses.data(), &key.source, sizeof(T));
+            std::memcpy(addresses.data() + sizeof(T), &key.destination, sizeof(T));
+
+            uint64_t hash = 0x9E3779B97F4A7C15ull ^ (static_cast<uint64_t>(key.source_port) << 24 |
+                static_cast<uint64_t>(key.destination_port) << 8 | key.protocol);
+
+            for (std::size_t i = 0; i < addresses.size(); i += sizeof(uint32_t))
+            {
+                uint32_t word;
+                std::memcpy(&word, addresses.data() + i, sizeof(word));
+                hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+                hash ^= hash >> 32;
+            }
+
+            return static_cast<std::size_t>(hash) & (Size - 1);
+        }
+
+        /**
+         * @brief Returns true if no flow is currently held. A single relaxed load.
+         */
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return held_.load(std::memory_order_relaxed) == 0;
+        }
+
+        /**
+         * @brief Returns true if packets of the flow mapped to a slot must wait behind deferred ones.
+         * @param slot Slot returned by slot_of().
+         */
+        [[nodiscard]] bool is_held(const std::size_t slot) const noexcept
+        {
+            const auto& entry = slots_[slot];
+
+            if (entry.count.load(std::memory_order_acquire) == 0)
+                return false;
+
+            return now() - entry.held_since.load(std::memory_order_relaxed) < timeout_;
+        }
+
+        /**
+         * @brief Accounts for a packet of the flow entering the deferred-resolve queue.
+         * @param slot Slot returned by slot_of().
+         */
+        void hold(const std::size_t slot) noexcept
+        {
+            auto& entry = slots_[slot];
+
+            if (entry.count.fetch_add(1, std::memory_order_acq_rel) == 0)
+            {
+                entry.held_since.store(now(), std::memory_order_relaxed);
+                held_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * @brief Accounts for a packet of the flow leaving the deferred path (re-injected or dropped).
+         * @param slot Slot passed to the matching hold() call.
+         */
+        void release(const std::size_t slot) noexcept
+        {
+            if (slots_[slot].count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                held_.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+    private:
+        /**
+         * @struct slot
+         * @brief Counting slot.
+         */
+        struct slot
+        {
+            std::atomic<uint32_t> count{ 0 };           ///< Deferred packets of the flows mapped to this slot.
+            std::atomic<uint32_t> held_since{ 0 };      ///< Time the count last became non-zero, in milliseconds since construction.
+        };
+
+        /**
+         * @brief Returns the current time in milliseconds since table construction.
+         */
+        [[nodiscard]] uint32_t now() const noexcept
+        {
+            return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - epoch_).count());
+        }
+
+        /// Hold timeout in milliseconds.
+        const uint32_t timeout_;
+        /// Reference point for the slot timestamps.
+        const std::chrono::steady_clock::time_point epoch_{ std::chrono::steady_clock::now() };
+        /// Number of slots with a non-zero count.
+        std::atomic<uint32_t> held_{ 0 };
+        /// Slot storage.
+        std::array<slot, Size> slots_{};
+    };
+}
@@ -0,0 +1,309 @@
+#pragma once
+
+namespace proxy
+{
+    /**
+     * @enum flow_verdict
+     * @brief Cached routing decision for a transport flow.
+     */
+    enum class flow_verdict : uint8_t
+    {
+        none,       ///< No cached decision (cache miss).
+        pass,       ///< Pass the packet unmodified.
+        redirect,   ///< Redirect client-to-server traffic to the local proxy port stored with the verdict.
+        revert      ///< Translate server-to-client traffic coming back from the local proxy.
+    };
+
+    /**
+     * @class flow_verdict_cache
+     * @brief Fixed-size, lock-free cache of per-flow routing decisions keyed by 5-tuple.
+     *
+     * The cache is direct-mapped: every flow hashes to exactly one slot, and a newer flow colliding
+     * with an older one simply replaces it. Each slot is protected by a sequence lock, so readers
+     * never block or write shared memory, and concurrent writers to the same slot skip the update
+     * instead of waiting (losing an update only costs a slow-path lookup for the next packet).
+     *
+     * Entries expire after a fixed time-to-live counted from insertion, which bounds how long a
+     * decision based on a stale process table can survive. invalidate() advances a generation
+     * counter which makes every existing entry a miss in O(1); it is used whenever the routing
+     * configuration changes. An entry carries the generation find() saw before its decision was
+     * computed, so a decision that raced with invalidate() is never cached as current.
+     *
+     * @tparam T IP address type (net::ip_address_v4 or net::ip_address_v6).
+     * @tparam Size Number of slots, must be a power of two.
+     */
+    template <net::ip_address T, std::size_t Size = 16384>
+    class flow_verdict_cache
+    {
+        static_assert(std::has_single_bit(Size), "flow_verdict_cache size must be a power of two");
+
+        /// Number of 64-bit words needed for two addresses, two ports and the protocol.
+        static constexpr std::size_t key_words = (2 * sizeof(T) + 2 * sizeof(uint16_t) + sizeof(uint8_t) + 7) / 8;
+
+        /// Packed key representation.
+        using packed_key = std::array<uint64_t, key_words>;
+
+    public:
+        /**
+         * @struct flow_key
+         * @brief Transport flow identifier as seen in the packet (not normalized for direction).
+         */
+        struct flow_key
+        {
+            T source;                   ///< Source IP address.
+            T destination;              ///< Destination IP address.
+            uint16_t source_port;       ///< Source port (host byte order).
+            uint16_t destination_port;  ///< Destination port (host byte order).
+            uint8_t protocol;           ///< IPPROTO_TCP or IPPROTO_UDP.
+        };
+
+        /**
+         * @struct cached_verdict
+         * @brief Result of a successful cache lookup.
+         */
+        struct cached_verdict
+        {
+            flow_verdict verdict;   ///< Cached decision.
+            uint16_t port;          ///< Local proxy port (host byte order) for flow_verdict::redirect.
+        };
+
+        /**
+         * @struct statistics
+         * @brief Lookup counters of the cache.
+         */
+        struct statistics
+        {
+            uint64_t hits;      ///< Lookups that returned a verdict.
+            uint64_t misses;    ///< Lookups that fell back to the slow path.
+        };
+
+        /**
+         * @brief Constructs an empty cache.
+         * @param ttl Time-to-live of an entry counted from its insertion.
+         */
+        explicit flow_verdict_cache(const std::chrono::seconds ttl = std::chrono::seconds{ 30 })
+            : ttl_(static_cast<uint32_t>(ttl.count())),
+              slots_(std::make_unique<slot[]>(Size))
+        {
+        }
+
+        flow_verdict_cache(const flow_verdict_cache&) = delete;
+        flow_verdict_cache(flow_verdict_cache&&) = delete;
+        flow_verdict_cache& operator=(const flow_verdict_cache&) = delete;
+        flow_verdict_cache& operator=(flow_verdict_cache&&) = delete;
+        ~flow_verdict_cache() = default;
+
+        /**
+         * @brief Looks up the cached decision for a flow.
+         *
+         * The generation is read before the slot, the decision computed on a miss must be based on
+         * configuration read after this call and inserted with this generation.
+         *
+         * @param key Flow identifier.
+         * @param generation Receives the generation the lookup was made in, to be passed to insert().
+         * @return Cached verdict, or std::nullopt on miss, expiry or concurrent update.
+         */
+        [[nodiscard]] std::optional<cached_verdict> find(const flow_key& key, uint32_t& generation) const noexcept
+        {
+            generation = current_generation();
+            auto result = lookup(key, generation);
+            (result ? hits_ : misses_).add();
+            return result;
+        }
+
+        /**
+         * @brief Returns the current generation, for a decision computed without a find(), see insert().
+         */
+        [[nodiscard]] uint32_t current_generation() const noexcept
+        {
+            // Pairs with invalidate(): configuration read after this sees the change that ended the generation
+            return generation_.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief Returns the lookup counters since construction.
+         */
+        [[nodiscard]] statistics get_statistics() const noexcept
+        {
+            return { hits_.value(), misses_.value() };
+        }
+
+        /**
+         * @brief Inserts or replaces the decision for a flow.
+         *
+         * The decision is dropped if the cache was invalidated since @p generation was read, it may
+         * be based on the configuration that invalidate() replaced.
+         *
+         * @param key Flow identifier.
+         * @param generation Generation returned by the find() that preceded the decision.
+         * @param verdict Decision to cache.
+         * @param port Local proxy port (host byte order) for flow_verdict::redirect.
+         */
+        void insert(const flow_key& key, const uint32_t generation, const flow_verdict verdict,
+                    const uint16_t port = 0) noexcept
+        {
+            if (generation != generation_.load(std::memory_order_relaxed))
+                return;
+
+            // Tagged with the caller's generation, an invalidate() racing with the store still makes it a miss
+            store(pack(key), generation, verdict, port);
+        }
+
+        /**
+         * @brief Removes the decision for a flow if it is cached.
+         * @param key Flow identifier.
+         */
+        void erase(const flow_key& key) noexcept
+        {
+            const auto packed = pack(key);
+            const auto& entry = slots_[index_of(packed)];
+
+            // Only clear the slot if it still belongs to this flow
+            for (std::size_t i = 0; i < key_words; ++i)
+            {
+                if (entry.key[i].load(std::memory_order_relaxed) != packed[i])
+                    return;
+            }
+
+            store(packed, generation_.load(std::memory_order_relaxed), flow_verdict::none, 0);
+        }
+
+        /**
+         * @brief Invalidates every cached decision.
+         *
+         * Must be called after the new configuration is published, see current_generation().
+         */
+        void invalidate() noexcept
+        {
+            generation_.fetch_add(1, std::memory_order_release);
+        }
+
+    private:
+        /**
+         * @brief Reads the slot of a flow under its sequence lock.
+         */
+        [[nodiscard]] std::optional<cached_verdict> lookup(const flow_key& key, const uint32_t generation) const noexcept
+        {
+            const auto packed = pack(key);
+            const auto& entry = slots_[index_of(packed)];
+
+            const auto sequence = entry.sequence.load(std::memory_order_acquire);
+            if (sequence & 1)
+                return std::nullopt;
+
+            packed_key stored{};
+            for (std::size_t i = 0; i < key_words; ++i)
+                stored[i] = entry.key[i].load(std::memory_order_relaxed);
+            const auto value = entry.value.load(std::memory_order_relaxed);
+            const auto inserted_at = entry.inserted_at.load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (entry.sequence.load(std::memory_order_relaxed) != sequence)
+                return std::nullopt;
+
+            if (stored != packed ||
+                static_cast<uint32_t>(value >> 32) != generation ||
+                now() - inserted_at >= ttl_)
+                return std::nullopt;
+
+            const auto verdict = static_cast<flow_verdict>((value >> 16) & 0xff);
+            if (verdict == flow_verdict::none)
+                return std::nullopt;
+
+            return cached_verdict{ verdict, static_cast<uint16_t>(value & 0xffff) };
+        }
+
+        /**
+         * @struct slot
+         * @brief Sequence-locked cache slot; all members are atomics so torn reads are detected, not undefined.
+         */
+        struct alignas(std::bit_ceil(sizeof(uint64_t) * (key_words + 2))) slot
+        {
+            std::atomic<uint32_t> sequence{ 0 };        ///< Odd while an update is in progress.
+            std::atomic<uint32_t> inserted_at{ 0 };     ///< Insertion time in seconds since cache construction.
+            std::array<std::atomic<uint64_t>, key_words> key{};  ///< Packed flow key.
+            std::atomic<uint64_t> value{ 0 };           ///< generation << 32 | verdict << 16 | port.
+        };
+
+        /**
+         * @brief Writes a slot under its sequence lock, skipping the update if another writer holds it.
+         */
+        void store(const packed_key& packed, const uint32_t generation, const flow_verdict verdict,
+                   const uint16_t port) noexcept
+        {
+            auto& entry = slots_[index_of(packed)];
+
+            auto sequence = entry.sequence.load(std::memory_order_relaxed);
+            if ((sequence & 1) ||
+                !entry.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire))
+                return;
+
+            for (std::size_t i = 0; i < key_words; ++i)
+                entry.key[i].store(packed[i], std::memory_order_relaxed);
+            entry.value.store(static_cast<uint64_t>(generation) << 32 |
+                static_cast<uint64_t>(verdict) << 16 | port, std::memory_order_relaxed);
+            entry.inserted_at.store(now(), std::memory_order_relaxed);
+
+            entry.sequence.store(sequence + 2, std::memory_order_release);
+        }
+
+        /**
+         * @brief Packs a flow key into fixed-size words (zero padded).
+         */
+        static packed_key pack(const flow_key& key) noexcept
+        {
+            std::array<uint8_t, key_words * sizeof(uint64_t)> bytes{};
+            auto* position = bytes.data();
+
+            std::memcpy(position, &key.source, sizeof(T));
+            position += sizeof(T);
+            std::memcpy(position, &key.destination, sizeof(T));
+            position += sizeof(T);
+            std::memcpy(position, &key.source_port, sizeof(uint16_t));
+            position += sizeof(uint16_t);
+            std::memcpy(position, &key.destination_port, sizeof(uint16_t));
+            position += sizeof(uint16_t);
+            *position = key.protocol;
+
+            packed_key packed{};
+            std::memcpy(packed.data(), bytes.data(), bytes.size());
+            return packed;
+        }
+
+        /**
+         * @brief Maps a packed key to its slot index.
+         */
+        static std::size_t index_of(const packed_key& packed) noexcept
+        {
+            uint64_t hash = 0x9E3779B97F4A7C15ull;
+            for (const auto word : packed)
+            {
+                hash ^= word;
+                hash *= 0xff51afd7ed558ccdull;
+                hash ^= hash >> 32;
+            }
+            return static_cast<std::size_t>(hash) & (Size - 1);
+        }
+
+        /**
+         * @brief Returns the current time in seconds since cache construction.
+         */
+        [[nodiscard]] uint32_t now() const noexcept
+        {
+            return static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - epoch_).count());
+        }
+
+        /// Entry time-to-live in seconds.
+        const uint32_t ttl_;
+        /// Reference point for the slot timestamps.
+        const std::chrono::steady_clock::time_point epoch_{ std::chrono::steady_clock::now() };
+        /// Current configuration generation; entries with a different generation are misses.
+        std::atomic<uint32_t> generation_{ 1 };
+        /// Slot storage.
+        std::unique_ptr<slot[]> slots_;
+        /// Lookup counters, sharded per processor as every packet updates one of them.
+        mutable tools::metrics::counter hits_;
+        mutable tools::metrics::counter misses_;
+    };
+}
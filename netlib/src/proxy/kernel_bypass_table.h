@@ -0,0 +1,385 @@
+#pragma once
+
+namespace proxy
+{
+    /**
+     * @class kernel_bypass_table
+     * @brief Passes established unproxied flows in the driver through ndisapi::static_filters.
+     *
+     * Flows the router passes unchanged (owner excluded or not associated with a proxy, destination
+     * excluded by the redirect decider) still cost a user-mode round trip per packet. The packet
+     * path reports every packet it passes from a cached verdict with count_passed_packet(); once a
+     * flow has passed promote_after packets it becomes a candidate, and synchronize() installs a
+     * pair of pass filters matching exactly that flow (both addresses, both ports, protocol) so the
+     * following packets are passed in the kernel.
+     *
+     * Filters are bound to the full flow rather than to a local port: the OS recycles local ports,
+     * and a port-wide filter would pass the next connection of a proxied process using the port.
+     * Each installed flow holds a lease and is removed when it expires (the flow returns to user
+     * mode and is promoted again if it is still busy), and invalidate() removes them all at the
+     * next synchronize() since configuration changes may make a bypassed flow proxied. The table
+     * holds at most max_flows flows because the driver scans its filters linearly per packet.
+     *
+     * The packet path side is lock-free except for the rare promotion that queues a candidate;
+     * synchronize() and clear() talk to the driver and must be called from one maintenance thread
+     * at a time, serialized with every other user of the static_filters object.
+     *
+     * @tparam T IP address type (net::ip_address_v4 or net::ip_address_v6).
+     */
+    template <net::ip_address T>
+    class kernel_bypass_table
+    {
+        /// Number of per-flow counting slots, a power of two.
+        static constexpr std::size_t counter_slots = 4096;
+
+        /// Bits of a counting slot holding the packet count, the rest holds the flow tag.
+        static constexpr uint32_t count_mask = 0xffff;
+
+    public:
+        /**
+         * @struct options
+         * @brief Kernel bypass settings.
+         */
+        struct options
+        {
+            std::size_t max_flows{ 128 };                       ///< Flows bypassed at the same time (two filters each).
+            uint32_t promote_after{ 64 };                       ///< Passed packets seen in user mode before a flow is bypassed.
+            std::chrono::seconds lease{ 30 };                   ///< Time a bypassed flow stays in the driver.
+        };
+
+        /**
+         * @struct flow
+         * @brief Flow oriented from the local host, so both directions are the same flow.
+         */
+        struct flow
+        {
+            T local;                    ///< Local IP address.
+            T remote;                   ///< Remote IP address.
+            uint16_t local_port;        ///< Local port (host byte order).
+            uint16_t remote_port;       ///< Remote port (host byte order).
+            uint8_t protocol;           ///< IPPROTO_TCP or IPPROTO_UDP.
+
+            bool operator==(const flow& other) const
+            {
+                return local == other.local && remote == other.remote && local_port == other.local_port &&
+                    remote_port == other.remote_port && protocol == other.protocol;
+            }
+        };
+
+        /**
+         * @struct statistics
+         * @brief Kernel bypass counters.
+         */
+        struct statistics
+        {
+            std::size_t installed;      ///< Flows currently bypassed.
+            uint64_t promoted;          ///< Flows installed in the driver.
+            uint64_t expired;           ///< Flows removed at the end of their lease.
+            uint64_t flushed;           ///< Flows removed by invalidate() or clear().
+            uint64_t table_full;        ///< Candidates skipped because max_flows flows were bypassed.
+            uint64_t failed;            ///< Candidates the driver rejected.
+        };
+
+        /**
+         * @brief Constructs an empty table.
+         * @param settings Kernel bypass settings.
+         */
+        explicit kernel_bypass_table(const options& settings)
+            : options_(settings),
+              counters_(std::make_unique<std::atomic<uint32_t>[]>(counter_slots))
+        {
+            options_.max_flows = std::max<std::size_t>(options_.max_flows, 1);
+            options_.promote_after = std::clamp<uint32_t>(options_.promote_after, 1, count_mask);
+            pending_.reserve(options_.max_flows);
+            installed_.reserve(options_.max_flows);
+        }
+
+        kernel_bypass_table(const kernel_bypass_table&) = delete;
+        kernel_bypass_table(kernel_bypass_table&&) = delete;
+        kernel_bypass_table& operator=(const kernel_bypass_table&) = delete;
+        kernel_bypass_table& operator=(kernel_bypass_table&&) = delete;
+        ~kernel_bypass_table() = default;
+
+        /**
+         * @brief Counts a packet passed in user mode and queues the flow once it is busy enough.
+         * @param passed_flow Flow of the packet.
+         */
+        void count_passed_packet(const flow& passed_flow) noexcept
+        {
+            const auto hash = flow_hash(passed_flow);
+            auto& slot = counters_[static_cast<std::size_t>(hash) & (counter_slots - 1)];
+            const auto tag = static_cast<uint32_t>(hash >> 32) & ~count_mask;
+
+            auto value = slot.load(std::memory_order_relaxed);
+            uint32_t next;
+
+            do
+            {
+                if ((value & ~count_mask) != tag)
+                    next = tag | 1;
+                else if ((value & count_mask) >= options_.promote_after)
+                    return; // already queued or installed
+                else
+                    next = value + 1;
+            }
+            while (!slot.compare_exchange_weak(value, next, std::memory_order_relaxed));
+
+            if ((next & count_mask) != options_.promote_after)
+                return;
+
+            std::lock_guard lock(pending_lock_);
+            if (pending_.size() < options_.max_flows)
+                pending_.push_back(passed_flow);
+            else
+                slot.store(0, std::memory_order_relaxed); // retry with a later packet
+        }
+
+        /**
+         * @brief Requests removal of every bypassed flow at the next synchronize().
+         *
+         * Flows stay bypassed until then, i.e. for at most one maintenance interval.
+         */
+        void invalidate() noexcept
+        {
+            flush_requested_.store(true, std::memory_order_release);
+        }
+
+        /**
+         * @brief Brings the driver filter table in line: removes expired flows, installs candidates.
+         *
+         * All changes of a pass go to the driver as one static_filters::update, the bypass filters are
+         * kept in filter_group::low behind the router's own filters. If the driver rejects the update
+         * nothing changes: removals are retried at the next pass and the candidates may be promoted again.
+         *
+         * @param filters Static filters of the router.
+         */
+        void synchronize(ndisapi::static_filters& filters)
+        {
+            const auto now = std::chrono::steady_clock::now();
+
+            std::vector<flow> candidates;
+            {
+                std::lock_guard lock(pending_lock_);
+                candidates.swap(pending_);
+                pending_.reserve(options_.max_flows);
+            }
+
+            const auto flush = flush_requested_.exchange(false, std::memory_order_acq_rel);
+
+            if (flush)
+            {
+                // Candidates were promoted under the previous configuration as well
+                for (const auto& candidate : candidates)
+                    reset_counter(candidate);
+                candidates.clear();
+            }
+
+            auto batch = filters.begin_update();
+
+            std::vector<flow> removed;
+            for (const auto& entry : installed_)
+            {
+                if (!flush && entry.expires_at > now)
+                    continue;
+
+                const auto [out_filter, in_filter] = make_filters(entry.bypassed);
+                batch.remove(out_filter).remove(in_filter);
+                removed.push_back(entry.bypassed);
+            }
+
+            std::vector<flow> added;
+            const auto free_slots = options_.max_flows - (installed_.size() - removed.size());
+            for (const auto& candidate : candidates)
+            {
+                const auto is_candidate = [&candidate](const flow& other) { return other == candidate; };
+
+                if (std::ranges::any_of(installed_, is_candidate, &installed_flow::bypassed) ||
+                    std::ranges::any_of(added, is_candidate))
+                    continue;
+
+                if (added.size() >= free_slots)
+                {
+                    table_full_.fetch_add(1, std::memory_order_relaxed);
+                    reset_counter(candidate);
+                    continue;
+                }
+
+                const auto [out_filter, in_filter] = make_filters(candidate);
+                batch.add(out_filter, ndisapi::filter_group::low).add(in_filter, ndisapi::filter_group::low);
+                added.push_back(candidate);
+            }
+
+            if (batch.empty())
+                return;
+
+            if (!batch.commit())
+            {
+                failed_.fetch_add(added.size(), std::memory_order_relaxed);
+                for (const auto& candidate : added)
+                    reset_counter(candidate);
+
+                if (flush)
+                    flush_requested_.store(true, std::memory_order_release);
+                return;
+            }
+
+            std::erase_if(installed_, [&removed](const installed_flow& entry)
+            {
+                return std::ranges::find(removed, entry.bypassed) != removed.end();
+            });
+
+            // Let removed flows be promoted again if they are still busy
+            for (const auto& bypassed : removed)
+                reset_counter(bypassed);
+
+            (flush ? flushed_ : expired_).fetch_add(removed.size(), std::memory_order_relaxed);
+
+            for (const auto& candidate : added)
+                installed_.push_back({ candidate, now + options_.lease });
+            promoted_.fetch_add(added.size(), std::memory_order_relaxed);
+
+            installed_count_.store(installed_.size(), std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Removes every bypassed flow from the driver and drops the queued candidates.
+         * @param filters Static filters of the router.
+         * @return False if the driver rejected the removal, the flows are forgotten anyway.
+         */
+        bool clear(ndisapi::static_filters& filters)
+        {
+            {
+                std::lock_guard lock(pending_lock_);
+                pending_.clear();
+            }
+
+            auto batch = filters.begin_update();
+            for (const auto& entry : installed_)
+            {
+                const auto [out_filter, in_filter] = make_filters(entry.bypassed);
+                batch.remove(out_filter).remove(in_filter);
+            }
+
+            const auto result = batch.empty() || batch.commit();
+
+            flush_requested_.store(false, std::memory_order_relaxed);
+            flushed_.fetch_add(installed_.size(), std::memory_order_relaxed);
+            installed_.clear();
+            installed_count_.store(0, std::memory_order_relaxed);
+
+            for (std::size_t i = 0; i < counter_slots; ++i)
+                counters_[i].store(0, std::memory_order_relaxed);
+
+            return result;
+        }
+
+        /**
+         * @brief Returns the kernel bypass counters.
+         */
+        [[nodiscard]] statistics get_statistics() const noexcept
+        {
+            return {
+                installed_count_.load(std::memory_order_relaxed),
+                promoted_.load(std::memory_order_relaxed),
+                expired_.load(std::memory_order_relaxed),
+                flushed_.load(std::memory_order_relaxed),
+                table_full_.load(std::memory_order_relaxed),
+                failed_.load(std::memory_order_relaxed)
+            };
+        }
+
+    private:
+        /**
+         * @struct installed_flow
+         * @brief Flow passed by the driver and the end of its lease.
+         */
+        struct installed_flow
+        {
+            flow bypassed;                                  ///< The flow.
+            std::chrono::steady_clock::time_point expires_at; ///< End of the lease.
+        };
+
+        /**
+         * @brief Builds the outbound and inbound pass filters of a flow.
+         */
+        static std::pair<ndisapi::filter<T>, ndisapi::filter<T>> make_filters(const flow& bypassed)
+        {
+            const auto host = [](const T& address) { return net::ip_subnet<T>{ address }; };
+
+            ndisapi::filter<T> out_filter;
+            out_filter
+                .set_action(ndisapi::action_t::pass)
+                .set_direction(ndisapi::direction_t::out)
+                .set_protocol(bypassed.protocol)
+                .set_source_address(host(bypassed.local))
+                .set_dest_address(host(bypassed.remote))
+                .set_source_port(std::make_pair(bypassed.local_port, bypassed.local_port))
+                .set_dest_port(std::make_pair(bypassed.remote_port, bypassed.remote_port));
+
+            ndisapi::filter<T> in_filter;
+            in_filter
+                .set_action(ndisapi::action_t::pass)
+                .set_direction(ndisapi::direction_t::in)
+                .set_protocol(bypassed.protocol)
+                .set_source_address(host(bypassed.remote))
+                .set_dest_address(host(bypassed.local))
+                .set_source_port(std::make_pair(bypassed.remote_port, bypassed.remote_port))
+                .set_dest_port(std::make_pair(bypassed.local_port, bypassed.local_port));
+
+            return { out_filter, in_filter };
+        }
+
+        /**
+         * @brief Restarts the packet count of a flow.
+         */
+        void reset_counter(const flow& counted) noexcept
+        {
+            counters_[static_cast<std::size_t>(flow_hash(counted)) & (counter_slots - 1)].store(
+                0, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Hashes a flow.
+         */
+        static uint64_t flow_hash(const flow& hashed) noexcept
+        {
+            std::array<uint8_t, 2 * sizeof(T)> bytes{};
+            std::memcpy(bytes.data(), &hashed.local, sizeof(T));
+            std::memcpy(bytes.data() + sizeof(T), &hashed.remote, sizeof(T));
+
+            uint64_t hash = 0x9E3779B97F4A7C15ull ^ (static_cast<uint64_t>(hashed.local_port) << 24 |
+                static_cast<uint64_t>(hashed.remote_port) << 8 | hashed.protocol);
+
+            for (std::size_t i = 0; i < bytes.size(); i += sizeof(uint32_t))
+            {
+                uint32_t word;
+                std::memcpy(&word, bytes.data() + i, sizeof(word));
+                hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+                hash ^= hash >> 32;
+            }
+
+            return hash * 0xc4ceb9fe1a85ec53ull;
+        }
+
+        /// Kernel bypass settings.
+        options options_;
+        /// Per-flow passed packet counters (flow tag << 16 | count).
+        std::unique_ptr<std::atomic<uint32_t>[]> counters_;
+        /// Protects pending_.
+        std::mutex pending_lock_;
+        /// Flows promoted by the packet path, installed by the next synchronize().
+        std::vector<flow> pending_;
+        /// Flows passed by the driver, owned by the maintenance thread.
+        std::vector<installed_flow> installed_;
+        /// Set by invalidate(), consumed by synchronize().
+        std::atomic<bool> flush_requested_{ false };
+        /// Size of installed_ for get_statistics().
+        std::atomic<std::size_t> installed_count_{ 0 };
+        /// Statistics counters.
+        std::atomic<uint64_t> promoted_{ 0 };
+        std::atomic<uint64_t> expired_{ 0 };
+        std::atomic<uint64_t> flushed_{ 0 };
+        std::atomic<uint64_t> table_full_{ 0 };
+        std::atomic<uint64_t> failed_{ 0 };
+    };
+}
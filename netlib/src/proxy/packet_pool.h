@@ -57,16 +57,73 @@ namespace proxy
      * Provides allocation and deallocation of net_packet_t objects of various sizes.
      * Maintains internal pools for different buffer sizes to minimize heap allocations
      * and improve performance in high-throughput network applications.
+     *
+     * Buffers are cached in magazines (small arrays of buffers of one size tier). Every thread
+     * keeps one loaded magazine per tier and pool, so that allocate() and free() normally touch
+     * only thread-local memory. A thread exchanges whole magazines with the pool's depot, a
+     * lock-free list (SLIST) of non-empty magazines per tier, when its magazine runs empty or
+     * full; buffers are only allocated from or returned to the heap when the depot cannot help.
+     *
+     * The number of magazines a tier's depot may hold self-tunes between the configured pool size
+     * and a per-tier memory cap: it grows when buffers had to be destroyed while allocations were
+     * recently served from the heap, and shrinks back after a long run without a heap allocation.
+     *
+     * Magazines cached by a thread are returned to the depot when the thread exits, or destroyed
+     * if the pool no longer exists. All methods are thread-safe.
      */
     class packet_pool
     {
     public:
+        /**
+         * @brief Buffer sizes of the tiers, in ascending order.
+         */
+        constexpr static std::array<uint32_t, 8> tier_sizes{ 32, 64, 128, 256, 512, 1024, 2048, 256 * 256 };
+
+        /**
+         * @brief Number of size tiers.
+         */
+        constexpr static size_t tier_count = tier_sizes.size();
+
+        /**
+         * @struct tier_statistics
+         * @brief Usage counters of one size tier.
+         *
+         * Allocations and releases served by thread magazines are counted per thread and added
+         * when the thread exchanges a magazine with the depot, so these totals lag behind.
+         */
+        struct tier_statistics
+        {
+            uint32_t packet_size;       ///< Buffer size of the tier.
+            uint64_t allocations;       ///< Buffers handed out by allocate().
+            uint64_t heap_allocations;  ///< Buffers that had to be allocated from the heap.
+            uint64_t releases;          ///< Buffers returned with free().
+            uint64_t heap_releases;     ///< Buffers destroyed because the depot was full.
+            uint32_t depot_magazines;   ///< Non-empty magazines currently in the depot.
+            uint32_t depot_limit;       ///< Current (self-tuned) depot capacity in magazines.
+            uint32_t magazine_size;     ///< Buffers per magazine.
+        };
+
         /**
          * @brief Constructs a packet_pool with a specified pool size limit.
-         * @param pool_size Maximum number of buffers to keep in each internal pool.
+         * @param pool_size Number of buffers each tier's depot holds before it starts self-tuning.
+         */
+        explicit packet_pool(const uint32_t pool_size = 100)
+            : depot_(std::make_shared<depot>(pool_size))
+        {
+        }
+
+        packet_pool(const packet_pool&) = delete;
+        packet_pool& operator=(const packet_pool&) = delete;
+        packet_pool(packet_pool&&) = delete;
+        packet_pool& operator=(packet_pool&&) = delete;
+
+        /**
+         * @brief Returns the calling thread's magazines to the depot. The magazines of other
+         * threads are destroyed when those threads exit.
          */
-        explicit packet_pool(const uint32_t pool_size = 100) : pool_count_limit_{ pool_size }
+        ~packet_pool()
         {
+            release_thread_cache();
         }
 
         /**
@@ -80,292 +137,621 @@ namespace proxy
          */
         std::unique_ptr<net_packet_t> allocate(const uint32_t size)
         {
-            if (size > 256 * 256)
+            if (size > tier_sizes.back())
                 return nullptr;
 
-            std::lock_guard<std::mutex> lock(lock_);
+            const auto tier = tier_index(size);
+            auto& entry = thread_entry();
+            auto*& loaded = entry.loaded[tier];
 
-            if (size <= 32)
+            if (loaded == nullptr || loaded->count == 0)
             {
-                if (!p_32_b_.empty())
-                {
-                    auto packet = std::move(p_32_b_.top());
-                    p_32_b_.pop();
-                    return std::unique_ptr<net_packet_t>(reinterpret_cast<net_packet_t*>(packet.release()));
-                }
+                // Swap the empty magazine for a filled one from the depot
+                auto* const filled = depot_->pop_filled(tier);
 
-                try
+                if (filled == nullptr)
                 {
-                    auto packet = std::make_unique<net_packet<32>>();
-                    return std::unique_ptr<net_packet_t>(reinterpret_cast<net_packet_t*>(packet.release()));
-                }
-                catch (std::bad_alloc&)
-                {
-                    return nullptr;
+                    depot_->record_miss(tier, std::exchange(entry.allocations[tier], 0) + 1);
+                    return std::unique_ptr<net_packet_t>(create_packet(tier));
                 }
+
+                depot_->record_refill(tier, std::exchange(entry.allocations[tier], 0));
+
+                if (loaded != nullptr)
+                    depot_->push_empty(tier, loaded);
+
+                loaded = filled;
             }
 
-            if (size <= 64)
+            ++entry.allocations[tier];
+            return std::unique_ptr<net_packet_t>(loaded->packets[--loaded->count]);
+        }
+
+        /**
+         * @brief Returns a packet buffer to the pool for reuse.
+         *
+         * The buffer is placed in the calling thread's magazine of its size tier. If the pool
+         * cannot take it (the depot is full), the buffer is destroyed.
+         *
+         * @param packet Unique pointer to the packet buffer to free.
+         */
+        void free(std::unique_ptr<net_packet_t> packet)
+        {
+            if (!packet)
+                return;
+
+            const auto size = packet->max_size();
+            const auto tier = tier_index(size);
+
+            if (tier_sizes[tier] != size)
+                return;
+
+            auto& entry = thread_entry();
+            auto*& loaded = entry.loaded[tier];
+
+            ++entry.releases[tier];
+
+            if (loaded != nullptr && loaded->count == magazine_size(tier))
             {
-                if (!p_64_b_.empty())
+                // Hand the full magazine over to the depot and continue with an empty one
+                if (!depot_->push_filled(tier, loaded, std::exchange(entry.releases[tier], 0)))
                 {
-                    auto packet = std::move(p_64_b_.top());
-                    p_64_b_.pop();
-                    return std::unique_ptr<net_packet_t>(reinterpret_cast<net_packet_t*>(packet.release()));
-                }
-                try
-                {
-                    auto packet = std::make_unique<net_packet<64>>();
-                    return std::unique_ptr<net_packet_t>(reinterpret_cast<net_packet_t*>(packet.release()));
-                }
-                catch (std::bad_alloc&)
-                {
-                    return nullptr;
+                    destroy_packet(packet.release());
+                    return;
                 }
+
+                loaded = nullptr;
             }
 
-            if (size <= 128)
+            if (loaded == nullptr)
             {
-                if (!p_128_b_.empty())
-                {
-                    auto packet = std::move(p_128_b_.top());
-                    p_128_b_.pop();
-                    return std::unique_ptr<net_packet_t>(reinterpret_cast<net_packet_t*>(packet.release()));
-                }
-                try
-                {
-                    auto packet = std::make_unique<net_packet<128>>();
-                    return std::unique_ptr<net_packet_t>(reinterpret_cast<net_packet_t*>(packet.release()));
-                }
-                catch (std::bad_alloc&)
+                loaded = depot_->pop_empty(tier);
+
+                if (loaded == nullptr)
                 {
-                    return nullptr;
+                    destroy_packet(packet.release());
+                    return;
                 }
             }
 
-            if (size <= 256)
+            loaded->packets[loaded->count++] = packet.release();
+        }
+
+        /**
+         * @brief Gets the current pool size limit for each buffer size.
+         * @return The pool size limit.
+         */
+        uint32_t get_pool_size_limit() const
+        {
+            return depot_->pool_size.load();
+        }
+
+        /**
+         * @brief Sets a new pool size limit and resets all internal pools.
+         * @param pool_size_limit The new pool size limit.
+         */
+        void set_pool_size_limit(const uint32_t pool_size_limit)
+        {
+            depot_->pool_size = pool_size_limit;
+            reset();
+        }
+
+        /**
+         * @brief Clears the depot and the calling thread's magazines, releasing their buffers.
+         *
+         * The tier limits restart from the pool size limit. Magazines cached by other threads
+         * are kept until they are exchanged with the depot or their thread exits.
+         */
+        void reset()
+        {
+            release_thread_cache();
+            depot_->clear();
+        }
+
+        /**
+         * @brief Returns the usage counters of every size tier.
+         */
+        [[nodiscard]] std::array<tier_statistics, tier_count> get_statistics() const
+        {
+            std::array<tier_statistics, tier_count> statistics{};
+
+            for (size_t tier = 0; tier < tier_count; ++tier)
+            {
+                const auto& t = depot_->tiers[tier];
+
+                statistics[tier] = {
+                    tier_sizes[tier],
+                    t.allocations.load(std::memory_order_relaxed),
+                    t.heap_allocations.load(std::memory_order_relaxed),
+                    t.releases.load(std::memory_order_relaxed),
+                    t.heap_releases.load(std::memory_order_relaxed),
+                    t.filled_count.load(std::memory_order_relaxed),
+                    t.limit.load(std::memory_order_relaxed),
+                    magazine_size(tier)
+                };
+            }
+
+            return statistics;
+        }
+
+    private:
+        /**
+         * @brief Largest number of buffers in a magazine (small tiers).
+         */
+        constexpr static uint32_t max_magazine_size = 32;
+
+        /**
+         * @brief Smallest number of buffers in a magazine (large tiers).
+         */
+        constexpr static uint32_t min_magazine_size = 4;
+
+        /**
+         * @brief Memory a magazine is sized for, bounding what a thread keeps cached per tier.
+         */
+        constexpr static uint32_t magazine_bytes = 64 * 1024;
+
+        /**
+         * @brief Memory a tier's depot may grow to by self-tuning.
+         */
+        constexpr static size_t max_depot_bytes = 16 * 1024 * 1024;
+
+        /**
+         * @brief Depot refills without a heap allocation after which a grown tier limit is halved.
+         */
+        constexpr static uint32_t shrink_interval = 4096;
+
+        /**
+         * @brief Number of pools a thread caches magazines for at the same time.
+         */
+        constexpr static size_t thread_cache_entries = 4;
+
+        /**
+         * @struct magazine
+         * @brief Array of cached buffers of one tier, linkable into an SLIST.
+         */
+        struct alignas(MEMORY_ALLOCATION_ALIGNMENT) magazine
+        {
+            SLIST_ENTRY link;                                           ///< Must stay the first member.
+            uint32_t count;                                             ///< Number of buffers held.
+            std::array<net_packet_t*, max_magazine_size> packets;       ///< Cached buffers.
+        };
+
+        /**
+         * @struct depot
+         * @brief Magazines shared by all threads, referenced weakly by the thread caches.
+         */
+        struct depot
+        {
+            /**
+             * @brief Depot of one tier, on its own cache line.
+             */
+            struct alignas(tools::concurrency::cache_line_size) tier_depot
             {
-                if (!p_256_b_.empty())
-                {
-                    auto packet = std::move(p_256_b_.top());
-                    p_256_b_.pop();
-                    return std::unique_ptr<net_packet_t>(reinterpret_cast<net_packet_t*>(packet.release()));
-                }
-                try
-                {
-                    auto packet = std::make_unique<net_packet<256>>();
-                    return std::unique_ptr<net_packet_t>(reinterpret_cast<net_packet_t*>(packet.release()));
-                }
-                catch (std::bad_alloc&)
+                SLIST_HEADER filled;                            ///< Non-empty magazines.
+                SLIST_HEADER empty;                             ///< Empty magazines kept for reuse.
+                std::atomic<uint32_t> filled_count{ 0 };        ///< Magazines in filled.
+                std::atomic<uint32_t> empty_count{ 0 };         ///< Magazines in empty.
+                std::atomic<uint32_t> limit{ 0 };               ///< Capacity of filled, in magazines.
+                std::atomic<uint32_t> refills_since_miss{ 0 };  ///< Refills since the last heap allocation.
+                std::atomic_bool missed{ false };               ///< A heap allocation occurred since the last growth.
+                std::atomic<uint64_t> allocations{ 0 };
+                std::atomic<uint64_t> heap_allocations{ 0 };
+                std::atomic<uint64_t> releases{ 0 };
+                std::atomic<uint64_t> heap_releases{ 0 };
+            };
+
+            explicit depot(const uint32_t size) : pool_size(size)
+            {
+                for (size_t tier = 0; tier < tier_count; ++tier)
                 {
-                    return nullptr;
+                    InitializeSListHead(&tiers[tier].filled);
+                    InitializeSListHead(&tiers[tier].empty);
+                    tiers[tier].limit = min_limit(tier);
                 }
             }
 
-            if (size <= 512)
+            depot(const depot&) = delete;
+            depot& operator=(const depot&) = delete;
+            depot(depot&&) = delete;
+            depot& operator=(depot&&) = delete;
+
+            ~depot()
             {
-                if (!p_512_b_.empty())
-                {
-                    auto packet = std::move(p_512_b_.top());
-                    p_512_b_.pop();
-                    return std::unique_ptr<net_packet_t>(reinterpret_cast<net_packet_t*>(packet.release()));
-                }
-                try
-                {
-                    auto packet = std::make_unique<net_packet<512>>();
-                    return std::unique_ptr<net_packet_t>(reinterpret_cast<net_packet_t*>(packet.release()));
-                }
-                catch (std::bad_alloc&)
-                {
+                clear();
+            }
+
+            /**
+             * @brief Depot capacity derived from the pool size (the floor of the self-tuned limit).
+             */
+            [[nodiscard]] uint32_t min_limit(const size_t tier) const noexcept
+            {
+                const auto magazines = (pool_size.load() + magazine_size(tier) - 1) / magazine_size(tier);
+                return std::max<uint32_t>(magazines, 1);
+            }
+
+            /**
+             * @brief Upper bound of the self-tuned limit.
+             */
+            [[nodiscard]] uint32_t max_limit(const size_t tier) const noexcept
+            {
+                const auto magazines = static_cast<uint32_t>(
+                    max_depot_bytes / (static_cast<size_t>(tier_sizes[tier]) * magazine_size(tier)));
+                return std::max(magazines, min_limit(tier));
+            }
+
+            /**
+             * @brief Takes a non-empty magazine, or returns nullptr if there is none.
+             */
+            magazine* pop_filled(const size_t tier) noexcept
+            {
+                auto* const entry = InterlockedPopEntrySList(&tiers[tier].filled);
+                if (entry == nullptr)
                     return nullptr;
-                }
+
+                tiers[tier].filled_count.fetch_sub(1, std::memory_order_relaxed);
+                return reinterpret_cast<magazine*>(entry);
             }
 
-            if (size <= 1024)
+            /**
+             * @brief Stores a non-empty magazine if the tier limit allows it.
+             *
+             * A full depot first grows its limit if allocations recently went to the heap.
+             *
+             * @return false if the depot is full (the magazine stays with the caller).
+             */
+            bool push_filled(const size_t tier, magazine* m, const uint64_t releases) noexcept
             {
-                if (!p_1024_b_.empty())
-                {
-                    auto packet = std::move(p_1024_b_.top());
-                    p_1024_b_.pop();
-                    return std::unique_ptr<net_packet_t>(reinterpret_cast<net_packet_t*>(packet.release()));
-                }
-                try
+                auto& t = tiers[tier];
+                t.releases.fetch_add(releases, std::memory_order_relaxed);
+
+                if (t.filled_count.load(std::memory_order_relaxed) >= t.limit.load(std::memory_order_relaxed))
                 {
-                    auto packet = std::make_unique<net_packet<1024>>();
-                    return std::unique_ptr<net_packet_t>(reinterpret_cast<net_packet_t*>(packet.release()));
+                    if (!t.missed.exchange(false, std::memory_order_relaxed) || !grow(tier))
+                    {
+                        t.heap_releases.fetch_add(1, std::memory_order_relaxed);
+                        return false;
+                    }
                 }
-                catch (std::bad_alloc&)
+
+                t.filled_count.fetch_add(1, std::memory_order_relaxed);
+                InterlockedPushEntrySList(&t.filled, &m->link);
+                return true;
+            }
+
+            /**
+             * @brief Takes an empty magazine, allocating one if none is cached.
+             * @return The magazine, or nullptr if memory is exhausted.
+             */
+            magazine* pop_empty(const size_t tier) noexcept
+            {
+                if (auto* const entry = InterlockedPopEntrySList(&tiers[tier].empty); entry != nullptr)
                 {
-                    return nullptr;
+                    tiers[tier].empty_count.fetch_sub(1, std::memory_order_relaxed);
+                    return reinterpret_cast<magazine*>(entry);
                 }
+
+                auto* const m = new (std::nothrow) magazine;
+                if (m != nullptr)
+                    m->count = 0;
+
+                return m;
             }
 
-            if (size <= 2048)
+            /**
+             * @brief Keeps an empty magazine for reuse (as many as can be filled, the rest is deleted).
+             */
+            void push_empty(const size_t tier, magazine* m) noexcept
             {
-                if (!p_2048_b_.empty())
+                auto& t = tiers[tier];
+
+                if (t.empty_count.load(std::memory_order_relaxed) >= t.limit.load(std::memory_order_relaxed))
                 {
-                    auto packet = std::move(p_2048_b_.top());
-                    p_2048_b_.pop();
-                    return std::unique_ptr<net_packet_t>(reinterpret_cast<net_packet_t*>(packet.release()));
+                    delete m;
+                    return;
                 }
-                try
+
+                t.empty_count.fetch_add(1, std::memory_order_relaxed);
+                InterlockedPushEntrySList(&t.empty, &m->link);
+            }
+
+            /**
+             * @brief Returns a magazine of an exiting thread: kept if non-empty and the depot has room.
+             */
+            void give_back(const size_t tier, magazine* m, const uint64_t allocations, const uint64_t releases) noexcept
+            {
+                auto& t = tiers[tier];
+                t.allocations.fetch_add(allocations, std::memory_order_relaxed);
+
+                if (m->count != 0 && push_filled(tier, m, releases))
+                    return;
+
+                destroy_magazine(m);
+            }
+
+            /**
+             * @brief Counts a refill from the depot, shrinking a grown limit after a long run without misses.
+             */
+            void record_refill(const size_t tier, const uint64_t allocations) noexcept
+            {
+                auto& t = tiers[tier];
+                t.allocations.fetch_add(allocations, std::memory_order_relaxed);
+
+                if (t.refills_since_miss.fetch_add(1, std::memory_order_relaxed) + 1 < shrink_interval)
+                    return;
+
+                t.refills_since_miss.store(0, std::memory_order_relaxed);
+
+                // Surplus magazines are drained naturally, the depot only refuses new ones
+                const auto limit = t.limit.load(std::memory_order_relaxed);
+                t.limit.store(std::max(limit / 2, min_limit(tier)), std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief Counts an allocation served by the heap because the depot was empty.
+             */
+            void record_miss(const size_t tier, const uint64_t allocations) noexcept
+            {
+                auto& t = tiers[tier];
+                t.allocations.fetch_add(allocations, std::memory_order_relaxed);
+                t.heap_allocations.fetch_add(1, std::memory_order_relaxed);
+                t.refills_since_miss.store(0, std::memory_order_relaxed);
+                t.missed.store(true, std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief Doubles the tier limit up to max_limit().
+             * @return false if the limit is already at its maximum.
+             */
+            bool grow(const size_t tier) noexcept
+            {
+                auto& t = tiers[tier];
+                const auto limit = t.limit.load(std::memory_order_relaxed);
+                const auto grown = std::min(limit * 2, max_limit(tier));
+
+                if (grown <= limit)
+                    return false;
+
+                t.limit.store(grown, std::memory_order_relaxed);
+                return true;
+            }
+
+            /**
+             * @brief Destroys all cached magazines and restarts the tier limits.
+             */
+            void clear() noexcept
+            {
+                for (size_t tier = 0; tier < tier_count; ++tier)
                 {
-                    auto packet = std::make_unique<net_packet<2048>>();
-                    return std::unique_ptr<net_packet_t>(reinterpret_cast<net_packet_t*>(packet.release()));
+                    auto& t = tiers[tier];
+
+                    for (auto* entry = InterlockedFlushSList(&t.filled); entry != nullptr;)
+                    {
+                        auto* const m = reinterpret_cast<magazine*>(entry);
+                        entry = entry->Next;
+                        destroy_magazine(m);
+                    }
+
+                    for (auto* entry = InterlockedFlushSList(&t.empty); entry != nullptr;)
+                    {
+                        auto* const m = reinterpret_cast<magazine*>(entry);
+                        entry = entry->Next;
+                        delete m;
+                    }
+
+                    t.filled_count = 0;
+                    t.empty_count = 0;
+                    t.refills_since_miss = 0;
+                    t.missed = false;
+                    t.limit = min_limit(tier);
                 }
-                catch (std::bad_alloc&)
+            }
+
+            std::atomic<uint32_t> pool_size;                ///< Configured pool size, in buffers per tier.
+            std::array<tier_depot, tier_count> tiers;       ///< Per-tier depots.
+        };
+
+        /**
+         * @struct cache_entry
+         * @brief Magazines of one pool cached by a thread.
+         */
+        struct cache_entry
+        {
+            const depot* owner{ nullptr };                          ///< Pool the magazines belong to.
+            std::weak_ptr<depot> owner_ref;                         ///< Used to return them when the thread exits.
+            std::array<magazine*, tier_count> loaded{};             ///< Loaded magazine per tier.
+            std::array<uint64_t, tier_count> allocations{};         ///< Allocations not yet counted by the depot.
+            std::array<uint64_t, tier_count> releases{};            ///< Releases not yet counted by the depot.
+
+            /**
+             * @brief Returns the magazines to their pool (or destroys them) and unbinds the entry.
+             */
+            void release() noexcept
+            {
+                const auto owner_depot = owner_ref.lock();
+
+                for (size_t tier = 0; tier < tier_count; ++tier)
                 {
-                    return nullptr;
+                    if (loaded[tier] == nullptr)
+                        continue;
+
+                    if (owner_depot)
+                        owner_depot->give_back(tier, loaded[tier], allocations[tier], releases[tier]);
+                    else
+                        destroy_magazine(loaded[tier]);
+
+                    loaded[tier] = nullptr;
                 }
+
+                allocations = {};
+                releases = {};
+                owner = nullptr;
+                owner_ref.reset();
             }
+        };
+
+        /**
+         * @struct thread_cache
+         * @brief Per-thread cache entries, released when the thread exits.
+         */
+        struct thread_cache
+        {
+            std::array<cache_entry, thread_cache_entries> entries;  ///< Entries, most recently bound last.
 
-            if (!p_max_b_.empty())
+            thread_cache() = default;
+            thread_cache(const thread_cache&) = delete;
+            thread_cache& operator=(const thread_cache&) = delete;
+            thread_cache(thread_cache&&) = delete;
+            thread_cache& operator=(thread_cache&&) = delete;
+
+            ~thread_cache()
             {
-                auto packet = std::move(p_max_b_.top());
-                p_max_b_.pop();
-                return std::unique_ptr<net_packet_t>(packet.release());
+                for (auto& entry : entries)
+                    entry.release();
             }
+        };
+
+        /**
+         * @brief Returns the tier serving buffers of the given size (size must not exceed the largest tier).
+         */
+        static constexpr size_t tier_index(const uint32_t size) noexcept
+        {
+            size_t tier = 0;
+
+            while (tier_sizes[tier] < size)
+                ++tier;
+
+            return tier;
+        }
+
+        /**
+         * @brief Returns the number of buffers in a magazine of the tier.
+         */
+        static constexpr uint32_t magazine_size(const size_t tier) noexcept
+        {
+            return std::clamp(magazine_bytes / tier_sizes[tier], min_magazine_size, max_magazine_size);
+        }
+
+        /**
+         * @brief Allocates a buffer of the given size from the heap.
+         */
+        template <uint32_t Size>
+        static net_packet_t* make_packet() noexcept
+        {
             try
             {
-                auto packet = std::make_unique<net_packet<256 * 256>>();
-                return std::unique_ptr<net_packet_t>(packet.release());
+                return reinterpret_cast<net_packet_t*>(new net_packet<Size>());
             }
-            catch (std::bad_alloc&)
+            catch (const std::bad_alloc&)
             {
                 return nullptr;
             }
         }
 
         /**
-         * @brief Returns a packet buffer to the pool for reuse.
-         *
-         * The buffer is placed in the appropriate internal pool based on its size.
-         * If the pool for that size is full, the buffer is destroyed.
-         *
-         * @param packet Unique pointer to the packet buffer to free.
+         * @brief Allocates a buffer of the given tier from the heap.
+         * @return The buffer, or nullptr if memory is exhausted.
          */
-        void free(std::unique_ptr<net_packet_t> packet)
+        static net_packet_t* create_packet(const size_t tier) noexcept
         {
-            std::lock_guard<std::mutex> lock(lock_);
+            switch (tier)
+            {
+            case 0: return make_packet<tier_sizes[0]>();
+            case 1: return make_packet<tier_sizes[1]>();
+            case 2: return make_packet<tier_sizes[2]>();
+            case 3: return make_packet<tier_sizes[3]>();
+            case 4: return make_packet<tier_sizes[4]>();
+            case 5: return make_packet<tier_sizes[5]>();
+            case 6: return make_packet<tier_sizes[6]>();
+            default: return make_packet<tier_sizes[7]>();
+            }
+        }
 
+        /**
+         * @brief Returns a buffer to the heap, as the type it was created with.
+         */
+        static void destroy_packet(net_packet_t* packet) noexcept
+        {
             switch (packet->max_size())
             {
-            case 32:
-                if (p_32_b_.size() < pool_count_limit_)
-                {
-                    p_32_b_.push(std::unique_ptr<net_packet<32>>(reinterpret_cast<net_packet<32>*>(packet.release())));
-                }
-                break;
-            case 64:
-                if (p_64_b_.size() < pool_count_limit_)
-                {
-                    p_64_b_.push(std::unique_ptr<net_packet<64>>(reinterpret_cast<net_packet<64>*>(packet.release())));
-                }
-                break;
-            case 128:
-                if (p_128_b_.size() < pool_count_limit_)
-                {
-                    p_128_b_.push(
-                        std::unique_ptr<net_packet<128>>(reinterpret_cast<net_packet<128>*>(packet.release())));
-                }
-                break;
-            case 256:
-                if (p_256_b_.size() < pool_count_limit_)
-                {
-                    p_256_b_.push(
-                        std::unique_ptr<net_packet<256>>(reinterpret_cast<net_packet<256>*>(packet.release())));
-                }
-                break;
-            case 512:
-                if (p_512_b_.size() < pool_count_limit_)
-                {
-                    p_512_b_.push(
-                        std::unique_ptr<net_packet<512>>(reinterpret_cast<net_packet<512>*>(packet.release())));
-                }
-                break;
-            case 1024:
-                if (p_1024_b_.size() < pool_count_limit_)
-                {
-                    p_1024_b_.push(
-                        std::unique_ptr<net_packet<1024>>(reinterpret_cast<net_packet<1024>*>(packet.release())));
-                }
-                break;
-            case 2048:
-                if (p_2048_b_.size() < pool_count_limit_)
-                {
-                    p_2048_b_.push(
-                        std::unique_ptr<net_packet<2048>>(reinterpret_cast<net_packet<2048>*>(packet.release())));
-                }
-                break;
-            case 256 * 256:
-                if (p_max_b_.size() < pool_count_limit_)
-                {
-                    p_max_b_.push(std::unique_ptr<net_packet<256 * 256>>(packet.release()));
-                }
-                break;
-            default:
-                break;
+            case tier_sizes[0]: delete reinterpret_cast<net_packet<tier_sizes[0]>*>(packet); break;
+            case tier_sizes[1]: delete reinterpret_cast<net_packet<tier_sizes[1]>*>(packet); break;
+            case tier_sizes[2]: delete reinterpret_cast<net_packet<tier_sizes[2]>*>(packet); break;
+            case tier_sizes[3]: delete reinterpret_cast<net_packet<tier_sizes[3]>*>(packet); break;
+            case tier_sizes[4]: delete reinterpret_cast<net_packet<tier_sizes[4]>*>(packet); break;
+            case tier_sizes[5]: delete reinterpret_cast<net_packet<tier_sizes[5]>*>(packet); break;
+            case tier_sizes[6]: delete reinterpret_cast<net_packet<tier_sizes[6]>*>(packet); break;
+            default: delete packet; break;
             }
         }
 
         /**
-         * @brief Gets the current pool size limit for each buffer size.
-         * @return The pool size limit.
+         * @brief Destroys a magazine and the buffers it holds.
          */
-        uint32_t get_pool_size_limit() const
+        static void destroy_magazine(magazine* m) noexcept
         {
-            return pool_count_limit_;
+            for (uint32_t i = 0; i < m->count; ++i)
+                destroy_packet(m->packets[i]);
+
+            delete m;
         }
 
         /**
-         * @brief Sets a new pool size limit and resets all internal pools.
-         * @param pool_size_limit The new pool size limit.
+         * @brief Returns the calling thread's cache.
          */
-        void set_pool_size_limit(const uint32_t pool_size_limit)
+        static thread_cache& local_cache() noexcept
         {
-            reset();
-            pool_count_limit_ = pool_size_limit;
+            thread_local thread_cache cache;
+            return cache;
         }
 
         /**
-         * @brief Clears all internal buffer pools, releasing all stored buffers.
+         * @brief Returns the calling thread's cache entry of this pool, binding one if needed.
+         *
+         * When all entries are bound to other pools, the least recently bound one is released.
          */
-        void reset()
+        cache_entry& thread_entry()
         {
-            std::lock_guard<std::mutex> lock(lock_);
-
-            std::stack<std::unique_ptr<net_packet<32>>>().swap(p_32_b_);
-            std::stack<std::unique_ptr<net_packet<64>>>().swap(p_64_b_);
-            std::stack<std::unique_ptr<net_packet<128>>>().swap(p_128_b_);
-            std::stack<std::unique_ptr<net_packet<256>>>().swap(p_256_b_);
-            std::stack<std::unique_ptr<net_packet<512>>>().swap(p_512_b_);
-            std::stack<std::unique_ptr<net_packet<1024>>>().swap(p_1024_b_);
-            std::stack<std::unique_ptr<net_packet<2048>>>().swap(p_2048_b_);
-            std::stack<std::unique_ptr<net_packet<256 * 256>>>().swap(p_max_b_);
+            auto& entries = local_cache().entries;
+
+            for (auto& entry : entries)
+            {
+                if (entry.owner == depot_.get())
+                {
+                    // A previous pool at the same address left buffers of the same types, keep them
+                    if (entry.owner_ref.expired())
+                        entry.owner_ref = depot_;
+
+                    return entry;
+                }
+            }
+
+            auto it = std::ranges::find(entries, static_cast<const depot*>(nullptr), &cache_entry::owner);
+
+            if (it == entries.end())
+            {
+                entries.front().release();
+                std::rotate(entries.begin(), entries.begin() + 1, entries.end());
+                it = entries.end() - 1;
+            }
+
+            it->owner = depot_.get();
+            it->owner_ref = depot_;
+            return *it;
         }
 
-    private:
-        /// <summary>Stack of 32-byte packet buffers.</summary>
-        std::stack<std::unique_ptr<net_packet<32>>> p_32_b_;
-        /// <summary>Stack of 64-byte packet buffers.</summary>
-        std::stack<std::unique_ptr<net_packet<64>>> p_64_b_;
-        /// <summary>Stack of 128-byte packet buffers.</summary>
-        std::stack<std::unique_ptr<net_packet<128>>> p_128_b_;
-        /// <summary>Stack of 256-byte packet buffers.</summary>
-        std::stack<std::unique_ptr<net_packet<256>>> p_256_b_;
-        /// <summary>Stack of 512-byte packet buffers.</summary>
-        std::stack<std::unique_ptr<net_packet<512>>> p_512_b_;
-        /// <summary>Stack of 1024-byte packet buffers.</summary>
-        std::stack<std::unique_ptr<net_packet<1024>>> p_1024_b_;
-        /// <summary>Stack of 2048-byte packet buffers.</summary>
-        std::stack<std::unique_ptr<net_packet<2048>>> p_2048_b_;
-        /// <summary>Stack of max-size packet buffers (65536 bytes).</summary>
-        std::stack<std::unique_ptr<net_packet<256 * 256>>> p_max_b_;
-
-        /// <summary>Mutex for synchronizing access to all buffer pools.</summary>
-        std::mutex lock_;
-
-        /// <summary>Maximum number of buffers to keep in each pool.</summary>
-        std::atomic_uint32_t pool_count_limit_;
+        /**
+         * @brief Returns the calling thread's magazines of this pool to the depot.
+         */
+        void release_thread_cache() noexcept
+        {
+            for (auto& entry : local_cache().entries)
+            {
+                if (entry.owner == depot_.get())
+                    entry.release();
+            }
+        }
+
+        /// <summary>Depots of all tiers, shared with the thread caches.</summary>
+        std::shared_ptr<depot> depot_;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,285 @@
+#pragma once
+
+namespace proxy
+{
+    /**
+     * @class pcap_capture_filter
+     * @brief Selects and samples the packets socks_local_router writes to its packet capture.
+     *
+     * Criteria of different kinds are combined with AND, the entries of one kind with OR; a kind
+     * without entries matches every packet:
+     * - Owner: process names and/or proxy ids. The owner of a flow is only known where the router
+     *   resolves it, so the router reports the verdict per local port with note_flow_owner() and
+     *   the packet test is a bitmap lookup of the packet's ports.
+     * - Endpoints: address, port and protocol rules, each matched against source and destination.
+     *
+     * Selected packets can be sampled further: every Nth packet (per capturing thread) and/or the
+     * first K packets of each flow. Per-flow counters live in a fixed table of hashed slots shared
+     * by both directions of a flow and restarted by a TCP SYN; colliding flows evict each other,
+     * which can only let extra packets through.
+     *
+     * All checks are lock-free and cost a few loads for a packet that is not selected. IPv4 and
+     * IPv6 packets are inspected, matching the router's packet path.
+     */
+    class pcap_capture_filter
+    {
+        /// Number of per-flow counting slots, a power of two.
+        static constexpr std::size_t flow_slots = 4096;
+
+        /// Address of an endpoint rule, of either family.
+        using address_type = std::variant<net::ip_address_v4, net::ip_address_v6>;
+
+    public:
+        /**
+         * @struct endpoint_rule
+         * @brief Matches packets from or to an address and/or port.
+         */
+        struct endpoint_rule
+        {
+            std::optional<address_type> address;    ///< Source or destination address, any of either family if empty.
+            std::optional<uint16_t> port;           ///< Source or destination port (host byte order), any if empty.
+            uint8_t protocol{ 0 };                  ///< IPPROTO_TCP or IPPROTO_UDP, 0 for any.
+        };
+
+        /**
+         * @struct options
+         * @brief Capture selection and sampling settings.
+         */
+        struct options
+        {
+            std::vector<std::wstring> process_names;        ///< Owner process names (case-insensitive).
+            std::vector<std::size_t> proxy_ids;             ///< Proxies the owner process is associated with.
+            std::vector<endpoint_rule> endpoints;           ///< Endpoint rules.
+            uint32_t sample_one_in{ 1 };                    ///< Capture every Nth selected packet, 1 for all.
+            uint32_t first_packets_per_flow{ 0 };           ///< Capture at most this many packets per flow, 0 for no limit.
+        };
+
+        /**
+         * @brief Constructs the filter.
+         * @param settings Selection and sampling settings.
+         */
+        explicit pcap_capture_filter(options settings)
+            : options_(std::move(settings))
+        {
+            for (auto& name : options_.process_names)
+                std::ranges::transform(name, name.begin(), ::towupper);
+
+            options_.sample_one_in = std::max(options_.sample_one_in, 1u);
+            options_.first_packets_per_flow = std::min<uint32_t>(options_.first_packets_per_flow, count_mask);
+        }
+
+        pcap_capture_filter(const pcap_capture_filter&) = delete;
+        pcap_capture_filter(pcap_capture_filter&&) = delete;
+        pcap_capture_filter& operator=(const pcap_capture_filter&) = delete;
+        pcap_capture_filter& operator=(pcap_capture_filter&&) = delete;
+        ~pcap_capture_filter() = default;
+
+        /**
+         * @brief Returns true if packets are selected by their owner process or proxy.
+         */
+        [[nodiscard]] bool has_owner_criteria() const noexcept
+        {
+            return !options_.process_names.empty() || !options_.proxy_ids.empty();
+        }
+
+        /**
+         * @brief Tests a flow owner against the process name and proxy criteria.
+         * @param process The owner process.
+         * @param proxy_id The proxy the process is associated with, if any.
+         * @return True if the owner is selected.
+         */
+        [[nodiscard]] bool matches_owner(const iphelper::network_process& process,
+                                         const std::optional<std::size_t> proxy_id) const noexcept
+        {
+            if (!options_.process_names.empty() && std::ranges::find(options_.process_names, process.name) ==
+                options_.process_names.end())
+                return false;
+
+            if (!options_.proxy_ids.empty() &&
+                (!proxy_id || std::ranges::find(options_.proxy_ids, proxy_id.value()) == options_.proxy_ids.end()))
+                return false;
+
+            return true;
+        }
+
+        /**
+         * @brief Records the owner verdict of the flow using a local port.
+         * @param protocol IPPROTO_TCP or IPPROTO_UDP.
+         * @param local_port Port of the local endpoint (host byte order).
+         * @param selected Result of matches_owner() for the flow owner.
+         */
+        void note_flow_owner(const uint8_t protocol, const uint16_t local_port, const bool selected) noexcept
+        {
+            auto& ports = protocol == IPPROTO_TCP ? tcp_owner_ports_ : udp_owner_ports_;
+
+            // Read first: the verdict of an established port is usually unchanged
+            if (ports.test(local_port) != selected)
+                selected ? ports.set(local_port) : ports.reset(local_port);
+        }
+
+        /**
+         * @brief Decides whether a packet is captured.
+         * @param packet Ethernet frame carrying an IPv4 or IPv6 packet.
+         * @return True if the packet is selected and passes the sampling.
+         */
+        [[nodiscard]] bool should_capture(const INTERMEDIATE_BUFFER& packet) noexcept
+        {
+            const auto* const ethernet_header = reinterpret_cast<const ether_header*>(packet.m_IBuffer);
+
+            if (ntohs(ethernet_header->h_proto) == ETH_P_IPV6)
+            {
+                const auto* const ip_header = reinterpret_cast<const ipv6hdr*>(ethernet_header + 1);
+                const auto [transport_header, protocol] =
+                    net::ipv6_helper::find_transport_header(ip_header, packet.m_Length - ETHER_HEADER_LENGTH);
+
+                return should_capture(net::ip_address_v6(ip_header->ip6_src), net::ip_address_v6(ip_header->ip6_dst),
+                                      protocol, static_cast<const uint8_t*>(transport_header));
+            }
+
+            const auto* const ip_header = reinterpret_cast<const iphdr*>(ethernet_header + 1);
+
+            return should_capture(net::ip_address_v4(ip_header->ip_src), net::ip_address_v4(ip_header->ip_dst),
+                                  ip_header->ip_p,
+                                  reinterpret_cast<const uint8_t*>(ip_header) + sizeof(DWORD) * ip_header->ip_hl);
+        }
+
+    private:
+        /// Bits of a counting slot holding the packet count, the rest holds the flow tag.
+        static constexpr uint32_t count_mask = 0xffff;
+
+        /**
+         * @brief Decides whether a packet is captured from its addresses and transport header.
+         * @param source Source address.
+         * @param destination Destination address.
+         * @param protocol Transport protocol.
+         * @param transport_header Transport header, nullptr if not found (e.g. in a non-first IPv6 fragment).
+         * @return True if the packet is selected and passes the sampling.
+         */
+        template <net::ip_address T>
+        bool should_capture(const T& source, const T& destination, const uint8_t protocol,
+                            const uint8_t* transport_header) noexcept
+        {
+            const auto has_ports = transport_header && (protocol == IPPROTO_TCP || protocol == IPPROTO_UDP);
+
+            uint16_t source_port = 0, destination_port = 0;
+
+            if (has_ports)
+            {
+                // TCP and UDP headers both start with the source and destination ports
+                const auto* const ports = reinterpret_cast<const uint16_t*>(transport_header);
+                source_port = ntohs(ports[0]);
+                destination_port = ntohs(ports[1]);
+            }
+
+            if (has_owner_criteria())
+            {
+                if (!has_ports)
+                    return false;
+
+                // The local endpoint is the source of outbound and the destination of inbound packets
+                const auto& owner_ports = protocol == IPPROTO_TCP ? tcp_owner_ports_ : udp_owner_ports_;
+                if (!owner_ports.test(source_port) && !owner_ports.test(destination_port))
+                    return false;
+            }
+
+            if (!options_.endpoints.empty() && std::ranges::none_of(options_.endpoints, [&](const endpoint_rule& rule)
+                {
+                    if (rule.protocol != 0 && rule.protocol != protocol)
+                        return false;
+
+                    if (rule.port && !has_ports)
+                        return false;
+
+                    const auto matches = [&rule](const T& address, const uint16_t port)
+                    {
+                        return (!rule.address || rule.address.value() == address_type(address)) &&
+                            (!rule.port || rule.port.value() == port);
+                    };
+
+                    return matches(source, source_port) || matches(destination, destination_port);
+                }))
+            {
+                return false;
+            }
+
+            if (options_.sample_one_in > 1)
+            {
+                thread_local uint32_t sample_counter = 0;
+                if (++sample_counter % options_.sample_one_in != 0)
+                    return false;
+            }
+
+            if (options_.first_packets_per_flow != 0 && has_ports)
+            {
+                const auto restart = protocol == IPPROTO_TCP &&
+                    (reinterpret_cast<const tcphdr*>(transport_header)->th_flags & (TH_SYN | TH_ACK)) == TH_SYN;
+
+                return count_flow_packet(source, destination, source_port, destination_port, protocol, restart);
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Counts a packet of a flow and returns false once the flow has used its quota.
+         */
+        template <net::ip_address T>
+        bool count_flow_packet(const T& source, const T& destination, const uint16_t source_port,
+                               const uint16_t destination_port, const uint8_t protocol, const bool restart) noexcept
+        {
+            // Both directions of a flow map to the same slot
+            const auto hash = endpoint_hash(source, source_port) + endpoint_hash(destination, destination_port) +
+                protocol;
+            auto& slot = slots_[static_cast<std::size_t>(hash) & (flow_slots - 1)];
+            const auto tag = static_cast<uint32_t>(hash >> 32) & ~count_mask;
+
+            auto value = slot.load(std::memory_order_relaxed);
+
+            for (;;)
+            {
+                uint32_t next;
+
+                if (restart || (value & ~count_mask) != tag)
+                    next = tag | 1;
+                else if ((value & count_mask) >= options_.first_packets_per_flow)
+                    return false;
+                else
+                    next = value + 1;
+
+                if (slot.compare_exchange_weak(value, next, std::memory_order_relaxed))
+                    return true;
+            }
+        }
+
+        /**
+         * @brief Hashes one endpoint of a flow.
+         */
+        template <net::ip_address T>
+        static uint64_t endpoint_hash(const T& address, const uint16_t port) noexcept
+        {
+            std::array<uint8_t, sizeof(T)> bytes{};
+            std::memcpy(bytes.data(), &address, sizeof(T));
+
+            uint64_t hash = 0x9E3779B97F4A7C15ull ^ port;
+
+            for (std::size_t i = 0; i < bytes.size(); i += sizeof(uint32_t))
+            {
+                uint32_t word;
+                std::memcpy(&word, bytes.data() + i, sizeof(word));
+                hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+                hash ^= hash >> 32;
+            }
+
+            return hash * 0xc4ceb9fe1a85ec53ull;
+        }
+
+        /// Selection and sampling settings.
+        options options_;
+        /// Local TCP ports of flows whose owner is selected.
+        net::port_bitmap tcp_owner_ports_;
+        /// Local UDP ports of flows whose owner is selected.
+        net::port_bitmap udp_owner_ports_;
+        /// Per-flow packet counters (flow tag << 16 | count).
+        std::array<std::atomic<uint32_t>, flow_slots> slots_{};
+    };
+}
@@ -18,6 +18,8 @@ namespace proxy
      * - negotiate_io_read:  Read operation during connection negotiation.
      * - negotiate_io_write: Write operation during connection negotiation.
      * - inject_io_write:    Write operation for injecting data.
+     * - accept_io:          Overlapped accept of a client connection (AcceptEx).
+     * - connect_io:         Overlapped connect to the remote peer (ConnectEx).
      */
     enum class proxy_io_operation : uint8_t
     {
@@ -25,7 +27,38 @@ namespace proxy
         relay_io_write = 1,     ///< Write operation for relaying data.
         negotiate_io_read = 2,  ///< Read operation during negotiation.
         negotiate_io_write = 3, ///< Write operation during negotiation.
-        inject_io_write = 4     ///< Write operation for injecting data.
+        inject_io_write = 4,    ///< Write operation for injecting data.
+        accept_io = 5,          ///< Overlapped accept of a client connection.
+        connect_io = 6          ///< Overlapped connect to the remote peer.
+    };
+
+    /**
+     * @brief Lets an IPv6 socket to the remote proxy also reach IPv4 peers through their
+     *        IPv4-mapped addresses (::ffff:a.b.c.d).
+     *
+     * The IPv6 proxy servers of socks_local_router reach an IPv4 SOCKS5 proxy this way, so the
+     * upstream family does not depend on the family of the redirected client connection. Must be
+     * called before the socket is bound or connected.
+     *
+     * @param socket IPv6 socket.
+     * @return true on success.
+     */
+    inline bool enable_dual_stack(const SOCKET socket) noexcept
+    {
+        constexpr DWORD v6_only = 0;
+        return setsockopt(socket, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast<const char*>(&v6_only),
+                          sizeof(v6_only)) != SOCKET_ERROR;
+    }
+
+    /**
+     * @struct session_metrics
+     * @brief Counters shared by all sessions relayed through one upstream proxy.
+     */
+    struct session_metrics
+    {
+        tools::metrics::counter bytes_sent;             ///< Bytes received from local applications and relayed to the proxy.
+        tools::metrics::counter bytes_received;         ///< Bytes received from the proxy and relayed to local applications.
+        tools::metrics::latency_histogram handshake_time; ///< SOCKS5 negotiation time of TCP sessions and UDP associations.
     };
 
     // --------------------------------------------------------------------------------
@@ -66,7 +99,8 @@ namespace proxy
          */
         negotiate_context(const negotiate_context& other)
             : remote_address(other.remote_address),
-            remote_port(other.remote_port)
+            remote_port(other.remote_port),
+            metrics(other.metrics)
         {
         }
 
@@ -76,7 +110,8 @@ namespace proxy
          */
         negotiate_context(negotiate_context&& other) noexcept
             : remote_address(std::move(other.remote_address)),
-            remote_port(other.remote_port)
+            remote_port(other.remote_port),
+            metrics(std::move(other.metrics))
         {
         }
 
@@ -92,6 +127,7 @@ namespace proxy
 
             remote_address = other.remote_address;
             remote_port = other.remote_port;
+            metrics = other.metrics;
             return *this;
         }
 
@@ -107,6 +143,7 @@ namespace proxy
 
             remote_address = std::move(other.remote_address);
             remote_port = other.remote_port;
+            metrics = std::move(other.metrics);
             return *this;
         }
 
@@ -119,5 +156,10 @@ namespace proxy
          * @brief The remote port for negotiation.
          */
         uint16_t remote_port;
+
+        /**
+         * @brief Metrics of the upstream proxy the session is relayed through, may be null.
+         */
+        std::shared_ptr<session_metrics> metrics;
     };
 }
\ No newline at end of file
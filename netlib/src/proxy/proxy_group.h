@@ -0,0 +1,570 @@
+#pragma once
+
+namespace proxy
+{
+    /**
+     * @class proxy_group
+     * @brief Set of interchangeable SOCKS5 upstreams behind one proxy id, with health probing and
+     *        per-session upstream selection.
+     *
+     * Every new TCP or UDP session asks the group for an upstream with select(). Upstreams marked
+     * down are skipped, so that new sessions fail over as soon as the prober has seen an upstream
+     * fail instead of each waiting for its own SOCKS5 negotiation to time out. Among the upstreams
+     * that are up, the selection takes the lowest measured handshake time or the fewest active
+     * sessions, depending on the configured policy; ties go to the upstream added first.
+     *
+     * The probe thread connects to every upstream and runs the SOCKS5 method negotiation (RFC 1928
+     * identification request and reply), which measures the round trips a session pays before its
+     * request. failure_threshold consecutive failures mark an upstream down, one success marks it up.
+     * A group with a single upstream is not probed: it has nothing to fail over to.
+     *
+     * Sessions hold the lease returned by open_session() for their lifetime, which keeps the session
+     * counts used by the least_sessions policy.
+     *
+     * All public methods are thread-safe. The group must be owned by a std::shared_ptr.
+     */
+    class proxy_group : public netlib::log::logger<proxy_group>, public std::enable_shared_from_this<proxy_group>
+    {
+    public:
+        using log_level = netlib::log::log_level;
+        using logger = netlib::log::logger<proxy_group>;
+        using endpoint_t = net::ip_endpoint<net::ip_address_v4>;
+        using clock = std::chrono::steady_clock;
+
+        /**
+         * @brief Upstream selection policy.
+         */
+        enum class selection : uint8_t
+        {
+            lowest_latency,     ///< Lowest smoothed handshake time.
+            least_sessions      ///< Fewest active sessions, then lowest handshake time.
+        };
+
+        /**
+         * @brief Selection and probing settings.
+         */
+        struct options
+        {
+            selection policy{ selection::lowest_latency };      ///< Upstream selection policy.
+            std::chrono::milliseconds probe_interval{ 5000 };   ///< Delay between two probe rounds.
+            std::chrono::milliseconds probe_timeout{ 2000 };    ///< Bound of each connect, send and receive of a probe.
+            uint32_t failure_threshold{ 2 };                    ///< Consecutive failed probes marking an upstream down.
+        };
+
+        /**
+         * @brief State of one upstream.
+         */
+        struct member_statistics
+        {
+            endpoint_t endpoint;                    ///< Address and port of the upstream.
+            bool up;                                ///< Selected for new sessions.
+            std::optional<std::chrono::microseconds> rtt; ///< Smoothed handshake time, if measured.
+            uint32_t sessions;                      ///< Active sessions.
+            uint64_t selected;                      ///< Sessions started on this upstream.
+            uint64_t probe_failures;                ///< Failed probes.
+        };
+
+        /**
+         * @brief Upstream chosen for a new session.
+         */
+        struct choice
+        {
+            size_t index;           ///< Index of the upstream in the group, for open_session().
+            endpoint_t endpoint;    ///< Address and port of the upstream.
+        };
+
+        /**
+         * @brief Constructs a group with its primary upstream.
+         *
+         * @param primary       Upstream given to add_socks5_proxy().
+         * @param authenticate  Offer RFC 1929 username/password authentication in the probes.
+         * @param log_level     Logging level (default: error).
+         * @param log_stream    Optional output stream for logging.
+         */
+        proxy_group(const endpoint_t& primary, const bool authenticate,
+            const log_level log_level = log_level::error,
+            std::shared_ptr<std::ostream> log_stream = nullptr)
+            : logger(log_level, std::move(log_stream)),
+            authenticate_(authenticate)
+        {
+            members_.emplace_back(primary);
+        }
+
+        proxy_group(const proxy_group&) = delete;
+        proxy_group& operator=(const proxy_group&) = delete;
+        proxy_group(proxy_group&&) = delete;
+        proxy_group& operator=(proxy_group&&) = delete;
+
+        /**
+         * @brief Stops the probe thread.
+         */
+        ~proxy_group()
+        {
+            stop();
+        }
+
+        /**
+         * @brief Adds an upstream. It is considered up until probed.
+         *
+         * @param endpoint Address and port of the upstream.
+         * @return false if the upstream is already in the group.
+         */
+        bool add(const endpoint_t& endpoint)
+        {
+            {
+                std::unique_lock lock(members_lock_);
+
+                if (std::ranges::any_of(members_, [&endpoint](const member& m) { return m.endpoint == endpoint; }))
+                    return false;
+
+                members_.emplace_back(endpoint);
+            }
+
+            {
+                std::scoped_lock lock(lock_);
+                changed_ = true;
+            }
+
+            signal_.notify_all();
+            return true;
+        }
+
+        /**
+         * @brief Replaces the selection and probing settings.
+         */
+        void set_options(const options& settings)
+        {
+            {
+                std::scoped_lock lock(lock_);
+                options_ = settings;
+                changed_ = true;
+            }
+
+            policy_.store(settings.policy, std::memory_order_relaxed);
+            signal_.notify_all();
+        }
+
+        /**
+         * @brief Returns the number of upstreams.
+         */
+        [[nodiscard]] size_t size() const
+        {
+            std::shared_lock lock(members_lock_);
+            return members_.size();
+        }
+
+        /**
+         * @brief Starts the probe thread. No-op if running.
+         *
+         * @throws std::system_error if the thread cannot be created.
+         */
+        void start()
+        {
+            std::scoped_lock lock(lock_);
+
+            if (probe_thread_.joinable())
+                return;
+
+            stop_ = false;
+            probe_thread_ = std::thread(&proxy_group::probe_thread, this);
+        }
+
+        /**
+         * @brief Stops the probe thread. Health and latency are kept for the next start().
+         */
+        void stop()
+        {
+            {
+                std::scoped_lock lock(lock_);
+                stop_ = true;
+            }
+
+            signal_.notify_all();
+
+            if (probe_thread_.joinable())
+                probe_thread_.join();
+        }
+
+        /**
+         * @brief Chooses the upstream of a new session.
+         *
+         * If every upstream is down, the one with the fewest consecutive failures is returned, so that
+         * sessions still get a chance while the prober waits for the next round.
+         */
+        [[nodiscard]] choice select()
+        {
+            const auto policy = policy_.load(std::memory_order_relaxed);
+
+            std::shared_lock lock(members_lock_);
+
+            // An upstream without a measurement ranks after the measured ones
+            const auto rank = [policy](const member& m)
+            {
+                const auto rtt = m.rtt_us.load(std::memory_order_relaxed);
+                const auto latency = rtt < 0 ? std::numeric_limits<int64_t>::max() : rtt;
+                const auto sessions = policy == selection::least_sessions
+                                          ? m.sessions.load(std::memory_order_relaxed)
+                                          : 0u;
+                return std::make_pair(sessions, latency);
+            };
+
+            auto best = members_.size();
+
+            for (size_t i = 0; i < members_.size(); ++i)
+            {
+                if (!members_[i].up.load(std::memory_order_relaxed))
+                    continue;
+
+                if (best == members_.size() || rank(members_[i]) < rank(members_[best]))
+                    best = i;
+            }
+
+            if (best == members_.size())
+            {
+                best = 0;
+
+                for (size_t i = 1; i < members_.size(); ++i)
+                {
+                    if (members_[i].consecutive_failures.load(std::memory_order_relaxed) <
+                        members_[best].consecutive_failures.load(std::memory_order_relaxed))
+                        best = i;
+                }
+            }
+
+            members_[best].selected.fetch_add(1, std::memory_order_relaxed);
+
+            return { best, members_[best].endpoint };
+        }
+
+        /**
+         * @brief Counts a session on an upstream until the returned lease is released.
+         *
+         * @param index Index returned by select().
+         * @return Lease to keep for the lifetime of the session.
+         */
+        [[nodiscard]] std::shared_ptr<void> open_session(const size_t index)
+        {
+            {
+                std::shared_lock lock(members_lock_);
+                members_[index].sessions.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            return std::make_shared<session_lease>(shared_from_this(), index);
+        }
+
+        /**
+         * @brief Returns the traffic and handshake metrics of the sessions relayed through the group.
+         *
+         * The proxy servers attach them to the negotiate context of every session.
+         */
+        [[nodiscard]] const std::shared_ptr<session_metrics>& get_session_metrics() const noexcept
+        {
+            return session_metrics_;
+        }
+
+        /**
+         * @brief Returns the state of every upstream, in the order they were added.
+         */
+        [[nodiscard]] std::vector<member_statistics> get_statistics() const
+        {
+            std::shared_lock lock(members_lock_);
+
+            std::vector<member_statistics> result;
+            result.reserve(members_.size());
+
+            for (const auto& m : members_)
+            {
+                const auto rtt = m.rtt_us.load(std::memory_order_relaxed);
+
+                result.push_back({
+                    m.endpoint,
+                    m.up.load(std::memory_order_relaxed),
+                    rtt < 0 ? std::nullopt : std::optional(std::chrono::microseconds(rtt)),
+                    m.sessions.load(std::memory_order_relaxed),
+                    m.selected.load(std::memory_order_relaxed),
+                    m.probe_failures.load(std::memory_order_relaxed)
+                });
+            }
+
+            return result;
+        }
+
+    private:
+        /**
+         * @brief Upstream and its health.
+         */
+        struct member
+        {
+            explicit member(const endpoint_t& endpoint) : endpoint(endpoint) {}
+
+            endpoint_t endpoint;
+            std::atomic_bool up{ true };
+            std::atomic<int64_t> rtt_us{ -1 };              ///< Smoothed handshake time, -1 until measured
+            std::atomic_uint32_t consecutive_failures{ 0 };
+            std::atomic_uint32_t sessions{ 0 };
+            std::atomic_uint64_t selected{ 0 };
+            std::atomic_uint64_t probe_failures{ 0 };
+        };
+
+        /**
+         * @brief Decrements the session count of an upstream when released.
+         */
+        struct session_lease
+        {
+            session_lease(std::shared_ptr<proxy_group> group, const size_t index)
+                : group(std::move(group)), index(index)
+            {
+            }
+
+            session_lease(const session_lease&) = delete;
+            session_lease& operator=(const session_lease&) = delete;
+
+            ~session_lease()
+            {
+                std::shared_lock lock(group->members_lock_);
+                group->members_[index].sessions.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            std::shared_ptr<proxy_group> group;
+            size_t index;
+        };
+
+        /**
+         * @brief Runs the SOCKS5 method negotiation with an upstream.
+         *
+         * @return The time from the connection attempt to the method reply, or std::nullopt on failure.
+         */
+        [[nodiscard]] std::optional<std::chrono::microseconds> probe(const endpoint_t& endpoint,
+            const std::chrono::milliseconds timeout) const
+        {
+            const auto socket = WSASocket(AF_INET, SOCK_STREAM, IPPROTO_TCP, nullptr, 0, 0);
+
+            if (socket == INVALID_SOCKET)
+                return std::nullopt;
+
+            const auto result = [&]() -> std::optional<std::chrono::microseconds>
+            {
+                const auto started = clock::now();
+
+                // Connect without blocking, so that an unreachable upstream costs the timeout
+                // rather than the system connect timeout
+                u_long mode = 1;
+                if (ioctlsocket(socket, FIONBIO, &mode) != 0)
+                    return std::nullopt;
+
+                sockaddr_in sa_service{};
+                sa_service.sin_family = AF_INET;
+                sa_service.sin_addr = endpoint.ip;
+                sa_service.sin_port = htons(endpoint.port);
+
+                if (connect(socket, reinterpret_cast<SOCKADDR*>(&sa_service), sizeof(sa_service)) == SOCKET_ERROR &&
+                    WSAGetLastError() != WSAEWOULDBLOCK)
+                    return std::nullopt;
+
+                if (!wait(socket, false, timeout))
+                    return std::nullopt;
+
+                auto error = 0;
+                auto error_length = static_cast<int>(sizeof(error));
+                if (getsockopt(socket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &error_length) != 0 ||
+                    error != 0)
+                    return std::nullopt;
+
+                socks5_ident_req<2> ident_req{};
+                ident_req.methods[0] = 0x0; // RFC 1928: X'00' NO AUTHENTICATION REQUIRED
+                ident_req.methods[1] = 0x2; // RFC 1928: X'02' USERNAME/PASSWORD
+
+                auto ident_req_size = sizeof(ident_req);
+
+                if (!authenticate_)
+                {
+                    ident_req.number_of_methods = 1;
+                    ident_req_size = sizeof(socks5_ident_req<1>);
+                }
+
+                if (send(socket, reinterpret_cast<const char*>(&ident_req), static_cast<int>(ident_req_size), 0) !=
+                    static_cast<int>(ident_req_size))
+                    return std::nullopt;
+
+                socks5_ident_resp ident_resp{};
+                auto received = 0;
+
+                while (received < static_cast<int>(sizeof(ident_resp)))
+                {
+                    if (!wait(socket, true, timeout))
+                        return std::nullopt;
+
+                    const auto length = recv(socket, reinterpret_cast<char*>(&ident_resp) + received,
+                        static_cast<int>(sizeof(ident_resp)) - received, 0);
+
+                    if (length == SOCKET_ERROR || length == 0)
+                        return std::nullopt;
+
+                    received += length;
+                }
+
+                if (ident_resp.version != 5 || ident_resp.method == 0xFF)
+                    return std::nullopt;
+
+                return std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - started);
+            }();
+
+            closesocket(socket);
+
+            return result;
+        }
+
+        /**
+         * @brief Waits until a non-blocking socket is readable or writable (connected).
+         */
+        static bool wait(const SOCKET socket, const bool readable, const std::chrono::milliseconds timeout) noexcept
+        {
+            fd_set set;
+            FD_ZERO(&set);
+            FD_SET(socket, &set);
+
+            fd_set error_set;
+            FD_ZERO(&error_set);
+            FD_SET(socket, &error_set);
+
+            timeval tv{};
+            tv.tv_sec = static_cast<long>(timeout.count() / 1000);
+            tv.tv_usec = static_cast<long>((timeout.count() % 1000) * 1000);
+
+            // The write set reports a completed connect, the error set a failed one
+            return ::select(0, readable ? &set : nullptr, readable ? nullptr : &set, &error_set, &tv) > 0 &&
+                FD_ISSET(socket, &set);
+        }
+
+        /**
+         * @brief Records the result of a probe.
+         */
+        void update_health(const size_t index, const std::optional<std::chrono::microseconds> rtt,
+            const uint32_t failure_threshold)
+        {
+            std::shared_lock lock(members_lock_);
+            auto& m = members_[index];
+
+            if (rtt)
+            {
+                // Smoothed like the TCP SRTT with a gain of 1/8 (RFC 6298)
+                const auto previous = m.rtt_us.load(std::memory_order_relaxed);
+                const auto sample = rtt->count();
+                m.rtt_us.store(previous < 0 ? sample : previous + (sample - previous) / 8, std::memory_order_relaxed);
+                m.consecutive_failures.store(0, std::memory_order_relaxed);
+
+                if (!m.up.exchange(true, std::memory_order_relaxed))
+                    NETLIB_INFO("SOCKS5 upstream {}:{} is up again", m.endpoint.ip, m.endpoint.port);
+
+                return;
+            }
+
+            m.probe_failures.fetch_add(1, std::memory_order_relaxed);
+
+            if (m.consecutive_failures.fetch_add(1, std::memory_order_relaxed) + 1 >= failure_threshold &&
+                m.up.exchange(false, std::memory_order_relaxed))
+            {
+                NETLIB_WARNING("SOCKS5 upstream {}:{} is down, new sessions use the other upstreams",
+                    m.endpoint.ip, m.endpoint.port);
+            }
+        }
+
+        /**
+         * @brief Probes the upstreams every probe_interval while the group has more than one.
+         */
+        void probe_thread()
+        {
+            std::unique_lock lock(lock_);
+
+            while (!stop_)
+            {
+                // A change made from here on is seen by the wait below, even during the round
+                changed_ = false;
+                const auto settings = options_;
+                lock.unlock();
+
+                std::vector<endpoint_t> endpoints;
+
+                {
+                    std::shared_lock members_lock(members_lock_);
+
+                    if (members_.size() > 1)
+                    {
+                        for (const auto& m : members_)
+                            endpoints.push_back(m.endpoint);
+                    }
+                }
+
+                for (size_t i = 0; i < endpoints.size(); ++i)
+                {
+                    const auto rtt = probe(endpoints[i], settings.probe_timeout);
+
+                    NETLIB_DEBUG("Probe of SOCKS5 upstream {}:{}: {}", endpoints[i].ip, endpoints[i].port,
+                        rtt ? std::format("{}us", rtt->count()) : std::string("failed"));
+
+                    update_health(i, rtt, settings.failure_threshold);
+                }
+
+                lock.lock();
+
+                // Woken early by stop(), set_options() or add()
+                signal_.wait_for(lock, settings.probe_interval, [this] { return stop_ || changed_; });
+            }
+        }
+
+        /**
+         * @brief Offer username/password authentication in the probes.
+         */
+        bool authenticate_;
+
+        /**
+         * @brief Protects members_ against add(); the member states are atomics.
+         */
+        mutable std::shared_mutex members_lock_;
+
+        /**
+         * @brief Upstreams in the order they were added. Elements are never moved or removed.
+         */
+        std::deque<member> members_;
+
+        /**
+         * @brief Metrics shared by all sessions of the group.
+         */
+        std::shared_ptr<session_metrics> session_metrics_{ std::make_shared<session_metrics>() };
+
+        /**
+         * @brief Selection policy, readable without lock_.
+         */
+        std::atomic<selection> policy_{ selection::lowest_latency };
+
+        /**
+         * @brief Protects options_, stop_, changed_ and probe_thread_.
+         */
+        mutable std::mutex lock_;
+
+        /**
+         * @brief Wakes the probe thread.
+         */
+        std::condition_variable signal_;
+
+        /**
+         * @brief Selection and probing settings.
+         */
+        options options_;
+
+        /**
+         * @brief True when the probe thread must exit.
+         */
+        bool stop_{ true };
+
+        /**
+         * @brief True when add() or set_options() changed the group since the probe round began.
+         */
+        bool changed_{ false };
+
+        /**
+         * @brief Thread probing the upstreams.
+         */
+        std::thread probe_thread_;
+    };
+}
@@ -0,0 +1,345 @@
+#pragma once
+
+namespace proxy
+{
+    /**
+     * @class relay_buffer_pool
+     * @brief Process-wide pool of size-tiered relay buffers for TCP proxy sessions.
+     *
+     * Buffers come in three tiers (4 KB, 16 KB and 64 KB). The small tiers are carved out of
+     * shared 64 KB slabs, so that thousands of mostly idle sessions cost a few pages each instead
+     * of 128 KB. A slab whose buffers are all free again is returned to the heap, unless it is the
+     * last spare slab of its tier. Large buffers are allocated individually and only a limited
+     * number of them is cached, the rest is returned to the heap once the bulk flows that needed
+     * them are over.
+     *
+     * The pool is process-wide and not NUMA aware: buffers are allocated from the default heap
+     * regardless of the shard the session runs on.
+     *
+     * All methods are thread-safe.
+     */
+    class relay_buffer_pool
+    {
+    public:
+        /**
+         * @brief Buffer sizes of the tiers, in ascending order.
+         */
+        constexpr static std::array<uint32_t, 3> tier_sizes{ 4096, 16384, 65536 };
+
+        /**
+         * @brief Size of the smallest tier, used for new sessions.
+         */
+        constexpr static uint32_t min_buffer_size = tier_sizes.front();
+
+        /**
+         * @brief Size of the largest tier.
+         */
+        constexpr static uint32_t max_buffer_size = tier_sizes.back();
+
+        relay_buffer_pool(const relay_buffer_pool&) = delete;
+        relay_buffer_pool& operator=(const relay_buffer_pool&) = delete;
+        relay_buffer_pool(relay_buffer_pool&&) = delete;
+        relay_buffer_pool& operator=(relay_buffer_pool&&) = delete;
+
+        /**
+         * @brief Releases the slabs and the cached large buffers.
+         */
+        ~relay_buffer_pool()
+        {
+            for (auto* buffer : large_free_)
+                ::operator delete(buffer);
+        }
+
+        /**
+         * @brief Accessor for the singleton instance.
+         * @return Reference to the process-wide pool.
+         */
+        static relay_buffer_pool& instance()
+        {
+            static relay_buffer_pool instance;
+            return instance;
+        }
+
+        /**
+         * @brief Returns the size of the next larger tier (or max_buffer_size if already the largest).
+         * @param size Current buffer size.
+         */
+        static constexpr uint32_t next_tier(const uint32_t size) noexcept
+        {
+            for (const auto tier : tier_sizes)
+            {
+                if (tier > size)
+                    return tier;
+            }
+
+            return max_buffer_size;
+        }
+
+        /**
+         * @brief Allocates a buffer of the given tier.
+         * @param size One of tier_sizes.
+         * @return Pointer to the buffer, or nullptr if memory is exhausted.
+         */
+        char* allocate(const uint32_t size) noexcept
+        {
+            std::scoped_lock lock(lock_);
+
+            if (size == max_buffer_size)
+            {
+                if (!large_free_.empty())
+                {
+                    auto* const buffer = large_free_.back();
+                    large_free_.pop_back();
+                    return buffer;
+                }
+
+                return static_cast<char*>(::operator new(max_buffer_size, std::nothrow));
+            }
+
+            auto& free_list = small_free_[tier_index(size)];
+
+            if (free_list.empty() && !add_slab(size, free_list))
+                return nullptr;
+
+            auto* const buffer = free_list.back();
+            free_list.pop_back();
+            --slab_of(buffer).free_count;
+            return buffer;
+        }
+
+        /**
+         * @brief Returns a buffer obtained from allocate() to the pool.
+         * @param buffer Buffer to release (nullptr is ignored).
+         * @param size   Tier size the buffer was allocated with.
+         */
+        void free(char* buffer, const uint32_t size) noexcept
+        {
+            if (buffer == nullptr)
+                return;
+
+            std::scoped_lock lock(lock_);
+
+            if (size == max_buffer_size)
+            {
+                if (large_free_.size() < large_cache_limit)
+                {
+                    try
+                    {
+                        large_free_.push_back(buffer);
+                        return;
+                    }
+                    catch (const std::bad_alloc&)
+                    {
+                    }
+                }
+
+                ::operator delete(buffer);
+                return;
+            }
+
+            // The free list capacity is reserved when the slab is added, so this never reallocates
+            auto& free_list = small_free_[tier_index(size)];
+            free_list.push_back(buffer);
+
+            const auto slab = std::prev(slabs_.upper_bound(buffer));
+            const auto count = slab_size / size;
+
+            // Release a wholly free slab, but keep a slab's worth of free buffers of the tier
+            // so that a session opening and closing in a loop does not churn the heap.
+            if (++slab->second.free_count == count && free_list.size() >= 2 * static_cast<size_t>(count))
+                release_slab(slab, free_list);
+        }
+
+    private:
+        /**
+         * @brief Size of the slabs the small tiers are carved from.
+         */
+        constexpr static uint32_t slab_size = max_buffer_size;
+
+        /**
+         * @brief Maximum number of idle large buffers kept for reuse.
+         */
+        constexpr static size_t large_cache_limit = 64;
+
+        relay_buffer_pool() = default;
+
+        /**
+         * @brief Maps a small tier size to its free list index.
+         */
+        static constexpr size_t tier_index(const uint32_t size) noexcept
+        {
+            return size == tier_sizes[0] ? 0 : 1;
+        }
+
+        /**
+         * @brief A slab and the number of its buffers currently on the free list.
+         */
+        struct slab_entry
+        {
+            std::unique_ptr<char[]> memory;
+            uint32_t free_count;
+        };
+
+        /**
+         * @brief Slabs keyed by their base address.
+         */
+        using slab_map = std::map<const char*, slab_entry>;
+
+        /**
+         * @brief Returns the slab containing the buffer.
+         */
+        slab_entry& slab_of(const char* buffer) noexcept
+        {
+            return std::prev(slabs_.upper_bound(buffer))->second;
+        }
+
+        /**
+         * @brief Allocates a new slab and splits it into buffers of the given tier.
+         * @return false if memory is exhausted.
+         */
+        bool add_slab(const uint32_t size, std::vector<char*>& free_list) noexcept
+        {
+            try
+            {
+                const auto count = slab_size / size;
+                auto slab = std::make_unique<char[]>(slab_size);
+
+                free_list.reserve(free_list.size() + count);
+
+                auto* const memory = slab.get();
+
+                slabs_.emplace(memory, slab_entry{ std::move(slab), count });
+
+                for (uint32_t i = 0; i < count; ++i)
+                    free_list.push_back(memory + static_cast<size_t>(i) * size);
+
+                return true;
+            }
+            catch (const std::bad_alloc&)
+            {
+                return false;
+            }
+        }
+
+        /**
+         * @brief Removes the buffers of a wholly free slab from the free list and frees the slab.
+         */
+        void release_slab(const slab_map::iterator slab, std::vector<char*>& free_list) noexcept
+        {
+            const auto* const first = slab->second.memory.get();
+            const auto* const last = first + slab_size;
+
+            std::erase_if(free_list, [first, last](const char* buffer) { return buffer >= first && buffer < last; });
+            slabs_.erase(slab);
+        }
+
+        /**
+         * @brief Protects the free lists and the slab list.
+         */
+        std::mutex lock_;
+
+        /**
+         * @brief Free 4 KB and 16 KB buffers.
+         */
+        std::array<std::vector<char*>, 2> small_free_;
+
+        /**
+         * @brief Slabs backing the small tiers.
+         */
+        slab_map slabs_;
+
+        /**
+         * @brief Cached idle 64 KB buffers.
+         */
+        std::vector<char*> large_free_;
+    };
+
+    /**
+     * @class relay_buffer
+     * @brief Owning handle of a relay buffer obtained from relay_buffer_pool.
+     *
+     * Returns its memory to the pool on destruction.
+     */
+    class relay_buffer
+    {
+    public:
+        /**
+         * @brief Allocates a buffer of the smallest tier.
+         * @throws std::bad_alloc if memory is exhausted.
+         */
+        relay_buffer()
+            : data_(relay_buffer_pool::instance().allocate(relay_buffer_pool::min_buffer_size))
+        {
+            if (data_ == nullptr)
+                throw std::bad_alloc();
+        }
+
+        relay_buffer(const relay_buffer&) = delete;
+        relay_buffer& operator=(const relay_buffer&) = delete;
+        relay_buffer(relay_buffer&&) = delete;
+        relay_buffer& operator=(relay_buffer&&) = delete;
+
+        /**
+         * @brief Returns the buffer to the pool.
+         */
+        ~relay_buffer()
+        {
+            relay_buffer_pool::instance().free(data_, size_);
+        }
+
+        /**
+         * @brief Returns a pointer to the buffer memory.
+         */
+        [[nodiscard]] char* data() const noexcept
+        {
+            return data_;
+        }
+
+        /**
+         * @brief Returns the buffer size in bytes.
+         */
+        [[nodiscard]] uint32_t size() const noexcept
+        {
+            return size_;
+        }
+
+        /**
+         * @brief Replaces the buffer with one of another tier, keeping a block of pending data.
+         *
+         * The caller must guarantee that no overlapped operation references the current buffer.
+         *
+         * @param size    New tier size.
+         * @param pending Start of the data to keep (must lie in the current buffer).
+         * @param length  Number of bytes to keep; copied to the start of the new buffer.
+         * @return true if the buffer was replaced, false if the pool is exhausted (the current buffer is kept).
+         */
+        bool resize(const uint32_t size, const char* pending, const uint32_t length) noexcept
+        {
+            if (size == size_ || length > size)
+                return false;
+
+            auto* const buffer = relay_buffer_pool::instance().allocate(size);
+            if (buffer == nullptr)
+                return false;
+
+            if (length != 0)
+                std::memcpy(buffer, pending, length);
+
+            relay_buffer_pool::instance().free(data_, size_);
+            data_ = buffer;
+            size_ = size;
+            return true;
+        }
+
+    private:
+        /**
+         * @brief Buffer memory.
+         */
+        char* data_;
+
+        /**
+         * @brief Buffer size (one of relay_buffer_pool::tier_sizes).
+         */
+        uint32_t size_{ relay_buffer_pool::min_buffer_size };
+    };
+}
@@ -174,5 +174,198 @@ namespace proxy
 
         std::optional<std::string> socks5_username{ std::nullopt }; ///< Optional username
         std::optional<std::string> socks5_password{ std::nullopt }; ///< Optional password
+        std::shared_ptr<void> session_lease{ nullptr };              ///< Released with the session, see proxy_group::open_session()
     };
+
+    /**
+     * @brief Sends a whole buffer on a blocking socket.
+     */
+    inline bool blocking_send_all(const SOCKET socket, const char* data, int length) noexcept
+    {
+        while (length > 0)
+        {
+            const auto sent = send(socket, data, length, 0);
+            if (sent == SOCKET_ERROR)
+                return false;
+
+            data += sent;
+            length -= sent;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Receives exactly length bytes on a blocking socket.
+     */
+    inline bool blocking_recv_all(const SOCKET socket, char* data, int length) noexcept
+    {
+        while (length > 0)
+        {
+            const auto received = recv(socket, data, length, 0);
+            if (received == SOCKET_ERROR || received == 0)
+                return false;
+
+            data += received;
+            length -= received;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Connects a blocking socket to an address of its family, waiting at most timeout.
+     *
+     * The connection is set up in non-blocking mode, so that an unreachable peer does not hold
+     * the caller for the system's connect timeout. The socket is back in blocking mode on return;
+     * on failure WSAGetLastError() reports the reason (WSAETIMEDOUT if the timeout elapsed).
+     *
+     * @tparam T Address type (net::ip_address_v4 or net::ip_address_v6).
+     */
+    template <net::ip_address T>
+    bool blocking_connect(const SOCKET socket, const T& address, const uint16_t port,
+        const std::chrono::milliseconds timeout) noexcept
+    {
+        u_long mode = 1;
+        if (ioctlsocket(socket, FIONBIO, &mode) != 0)
+            return false;
+
+        auto status = SOCKET_ERROR;
+
+        if constexpr (T::af_type == AF_INET)
+        {
+            sockaddr_in sa_service{};
+            sa_service.sin_family = T::af_type;
+            sa_service.sin_addr = address;
+            sa_service.sin_port = htons(port);
+
+            status = connect(socket, reinterpret_cast<SOCKADDR*>(&sa_service), sizeof(sa_service));
+        }
+        else
+        {
+            sockaddr_in6 sa_service{};
+            sa_service.sin6_family = T::af_type;
+            sa_service.sin6_addr = address;
+            sa_service.sin6_port = htons(port);
+
+            // The proxy may be an IPv4 one given by its IPv4-mapped address
+            enable_dual_stack(socket);
+
+            status = connect(socket, reinterpret_cast<SOCKADDR*>(&sa_service), sizeof(sa_service));
+        }
+
+        auto error = status == SOCKET_ERROR ? WSAGetLastError() : 0;
+
+        if (error == WSAEWOULDBLOCK)
+        {
+            WSAPOLLFD poll_fd{ socket, POLLWRNORM, 0 };
+
+            if (const auto ready = WSAPoll(&poll_fd, 1, static_cast<INT>(timeout.count())); ready == SOCKET_ERROR)
+            {
+                error = WSAGetLastError();
+            }
+            else if (ready == 0)
+            {
+                error = WSAETIMEDOUT;
+            }
+            else
+            {
+                // A refused or unreachable connection reports POLLERR/POLLHUP with the reason in SO_ERROR
+                int length = sizeof(error);
+                if (getsockopt(socket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &length) == SOCKET_ERROR)
+                    error = WSAGetLastError();
+            }
+        }
+
+        mode = 0;
+        if (ioctlsocket(socket, FIONBIO, &mode) != 0 && error == 0)
+            error = WSAGetLastError();
+
+        if (error != 0)
+        {
+            WSASetLastError(error);
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Runs the SOCKS5 method selection and, if the proxy chooses it, the RFC 1929
+     *        username/password authentication on a connected blocking socket.
+     *
+     * @tparam Logger Logger class reporting the failures.
+     * @param logger The logger, may be nullptr.
+     * @param socket The connection to the proxy.
+     * @param username Optional username, username/password is only offered with one.
+     * @param password Optional password.
+     * @return true if the connection is ready for a SOCKS5 request.
+     */
+    template <typename Logger>
+    bool blocking_socks5_authenticate(const Logger* logger, const SOCKET socket,
+        const std::optional<std::string>& username, const std::optional<std::string>& password)
+    {
+        socks5_ident_req<2> ident_req{};
+        socks5_ident_resp ident_resp{};
+
+        auto socks5_ident_req_size = sizeof(ident_req);
+
+        ident_req.methods[0] = 0x0; // RFC 1928: X'00' NO AUTHENTICATION REQUIRED
+        ident_req.methods[1] = 0x2; // RFC 1928: X'02' USERNAME/PASSWORD
+
+        // Don't suggest username/password option if not provided
+        if (!username.has_value())
+        {
+            ident_req.number_of_methods = 1;
+            socks5_ident_req_size = sizeof(socks5_ident_req<1>);
+        }
+
+        if (!blocking_send_all(socket, reinterpret_cast<const char*>(&ident_req), static_cast<int>(socks5_ident_req_size)) ||
+            !blocking_recv_all(socket, reinterpret_cast<char*>(&ident_resp), sizeof(ident_resp)))
+        {
+            NETLIB_DEBUG_PTR(logger, "negotiate: SOCKS5 identification failed: {}", WSAGetLastError());
+            return false;
+        }
+
+        if ((ident_resp.version != 5) ||
+            (ident_resp.method == 0xFF))
+        {
+            NETLIB_INFO_PTR(logger, "[SOCKS5]: negotiate: SOCKS5 authentication has failed");
+            return false;
+        }
+
+        if (ident_resp.method != 0x2)
+            return true;
+
+        if (!username.has_value() || !password.has_value() ||
+            username.value().empty() || password.value().empty())
+        {
+            NETLIB_INFO_PTR(logger, "[SOCKS5]: negotiate: RFC 1928: X'02' USERNAME/PASSWORD is chosen but credentials are not provided");
+            return false;
+        }
+
+        socks5_username_auth auth_req{};
+        const auto auth_size = auth_req.init(username.value(), password.value());
+
+        if (auth_size == 0)
+        {
+            NETLIB_INFO_PTR(logger, "[SOCKS5]: negotiate: USERNAME or PASSWORD exceeds maximum possible length");
+            return false;
+        }
+
+        if (!blocking_send_all(socket, reinterpret_cast<const char*>(&auth_req), static_cast<int>(auth_size)) ||
+            !blocking_recv_all(socket, reinterpret_cast<char*>(&ident_resp), sizeof(ident_resp)))
+        {
+            NETLIB_DEBUG_PTR(logger, "negotiate: SOCKS5 authentication exchange failed: {}", WSAGetLastError());
+            return false;
+        }
+
+        if (ident_resp.method != 0x0)
+        {
+            NETLIB_INFO_PTR(logger, "[SOCKS5]: negotiate: USERNAME/PASSWORD authentication has failed!");
+            return false;
+        }
+
+        return true;
+    }
 }
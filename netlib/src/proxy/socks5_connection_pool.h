@@ -0,0 +1,369 @@
+#pragma once
+
+namespace proxy
+{
+    /**
+     * @class socks5_connection_pool
+     * @brief Warm pool of pre-connected, pre-authenticated control connections to one SOCKS5 proxy.
+     *
+     * Before a session can send its CONNECT or UDP ASSOCIATE request, it has to connect to the proxy,
+     * negotiate the authentication method and optionally authenticate (RFC 1929), which costs two to
+     * three round trips. The pool keeps up to a configured number of connections on which these steps
+     * are already done, so that a session claiming one sends its request right away.
+     *
+     * Connections are opened by a background thread with blocking I/O bounded by io_timeout, never on
+     * a completion port thread. Unclaimed connections are closed once their TTL has elapsed, since
+     * proxies drop connections that do not send a request in time, and are replaced. After a failed
+     * attempt the thread backs off (up to max_retry_delay) so that an unreachable proxy is not hammered.
+     *
+     * A claimed connection is probed before it is handed out. It is an overlapped socket in
+     * non-blocking mode, not yet associated with a completion port, and is owned by the caller.
+     *
+     * All public methods are thread-safe.
+     *
+     * @tparam T Address type (e.g., IPv4 or IPv6).
+     */
+    template <net::ip_address T>
+    class socks5_connection_pool : public netlib::log::logger<socks5_connection_pool<T>>
+    {
+    public:
+        using log_level = netlib::log::log_level;
+        using logger = netlib::log::logger<socks5_connection_pool>;
+        using address_type_t = T;
+        using clock = std::chrono::steady_clock;
+
+        /**
+         * @brief Default lifetime of an unclaimed connection (below the usual proxy negotiation timeouts).
+         */
+        constexpr static std::chrono::seconds default_ttl{ 20 };
+
+        /**
+         * @brief Send/receive timeout of the negotiation performed by the background thread.
+         */
+        constexpr static DWORD io_timeout_ms = 5000;
+
+        /**
+         * @brief Longest delay between two attempts after consecutive failures.
+         */
+        constexpr static std::chrono::seconds max_retry_delay{ 30 };
+
+        /**
+         * @brief Constructs a pool for a SOCKS5 proxy. No connection is opened before start().
+         *
+         * @param proxy_address Address of the SOCKS5 proxy.
+         * @param proxy_port    TCP port of the SOCKS5 proxy.
+         * @param username      Optional RFC 1929 username.
+         * @param password      Optional RFC 1929 password.
+         * @param size          Number of connections kept warm (0 disables the pool).
+         * @param ttl           Lifetime of an unclaimed connection.
+         * @param log_level     Logging level (default: error).
+         * @param log_stream    Optional output stream for logging.
+         */
+        socks5_connection_pool(const address_type_t& proxy_address, const uint16_t proxy_port,
+            std::optional<std::string> username, std::optional<std::string> password,
+            const size_t size, const std::chrono::seconds ttl = default_ttl,
+            const log_level log_level = log_level::error,
+            std::shared_ptr<std::ostream> log_stream = nullptr)
+            : logger(log_level, std::move(log_stream)),
+            proxy_address_(proxy_address),
+            proxy_port_(proxy_port),
+            username_(std::move(username)),
+            password_(std::move(password)),
+            size_(size),
+            ttl_(ttl)
+        {
+        }
+
+        socks5_connection_pool(const socks5_connection_pool&) = delete;
+        socks5_connection_pool& operator=(const socks5_connection_pool&) = delete;
+        socks5_connection_pool(socks5_connection_pool&&) = delete;
+        socks5_connection_pool& operator=(socks5_connection_pool&&) = delete;
+
+        /**
+         * @brief Stops the background thread and closes the unclaimed connections.
+         */
+        ~socks5_connection_pool()
+        {
+            stop();
+        }
+
+        /**
+         * @brief Returns true if the pool holds connections to the given proxy.
+         */
+        [[nodiscard]] bool serves(const address_type_t& proxy_address, const uint16_t proxy_port) const noexcept
+        {
+            return proxy_address == proxy_address_ && proxy_port == proxy_port_;
+        }
+
+        /**
+         * @brief Returns the number of connections currently ready to be claimed.
+         */
+        [[nodiscard]] size_t size() const
+        {
+            std::scoped_lock lock(lock_);
+            return idle_.size();
+        }
+
+        /**
+         * @brief Starts the background thread filling the pool. No-op if the pool is disabled or running.
+         *
+         * @throws std::system_error if the thread cannot be created.
+         */
+        void start()
+        {
+            std::scoped_lock lock(lock_);
+
+            if (size_ == 0 || refill_thread_.joinable())
+                return;
+
+            stop_ = false;
+            refill_thread_ = std::thread(&socks5_connection_pool::refill_thread, this);
+        }
+
+        /**
+         * @brief Stops the background thread and closes the unclaimed connections.
+         *
+         * Waits for the connection the thread may be opening, whose connect and negotiation steps
+         * are each bounded by io_timeout_ms.
+         */
+        void stop()
+        {
+            {
+                std::scoped_lock lock(lock_);
+                stop_ = true;
+            }
+
+            signal_.notify_all();
+
+            if (refill_thread_.joinable())
+                refill_thread_.join();
+
+            std::scoped_lock lock(lock_);
+
+            for (const auto& connection : idle_)
+                closesocket(connection.socket);
+
+            idle_.clear();
+        }
+
+        /**
+         * @brief Takes a ready connection out of the pool.
+         *
+         * Connections closed by the proxy in the meantime are discarded. The pool is refilled in the
+         * background.
+         *
+         * @return A connection ready for the SOCKS5 request, or INVALID_SOCKET if none is available.
+         */
+        [[nodiscard]] SOCKET claim()
+        {
+            for (;;)
+            {
+                SOCKET socket;
+
+                {
+                    std::scoped_lock lock(lock_);
+
+                    if (idle_.empty())
+                        break;
+
+                    // The newest connection is the least likely to have been dropped by the proxy
+                    socket = idle_.back().socket;
+                    idle_.pop_back();
+                }
+
+                signal_.notify_one();
+
+                if (is_alive(socket))
+                    return socket;
+
+                NETLIB_DEBUG("claim: Discarding a connection closed by the SOCKS5 proxy {}:{}",
+                    proxy_address_, proxy_port_);
+                closesocket(socket);
+            }
+
+            signal_.notify_one();
+            return INVALID_SOCKET;
+        }
+
+    private:
+        /**
+         * @brief Unclaimed connection.
+         */
+        struct idle_connection
+        {
+            SOCKET socket;
+            clock::time_point expires;
+        };
+
+        /**
+         * @brief Returns true if the proxy has neither closed the connection nor sent anything on it.
+         */
+        static bool is_alive(const SOCKET socket) noexcept
+        {
+            char byte;
+            return recv(socket, &byte, 1, MSG_PEEK) == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK;
+        }
+
+        /**
+         * @brief Opens a connection to the proxy and performs the method negotiation and authentication.
+         *
+         * @return The negotiated connection in non-blocking mode, or INVALID_SOCKET on failure.
+         */
+        SOCKET open_connection() const
+        {
+            auto socket = WSASocket(address_type_t::af_type, SOCK_STREAM, IPPROTO_TCP, nullptr, 0,
+                WSA_FLAG_OVERLAPPED);
+
+            if (socket == INVALID_SOCKET)
+                return INVALID_SOCKET;
+
+            if (!negotiate(socket))
+            {
+                closesocket(socket);
+                return INVALID_SOCKET;
+            }
+
+            // The session relays with overlapped I/O, the timeouts only bound the negotiation here
+            constexpr DWORD no_timeout = 0;
+            setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&no_timeout), sizeof(no_timeout));
+            setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&no_timeout), sizeof(no_timeout));
+
+            u_long mode = 1;
+            if (ioctlsocket(socket, FIONBIO, &mode) != 0)
+            {
+                closesocket(socket);
+                return INVALID_SOCKET;
+            }
+
+            return socket;
+        }
+
+        /**
+         * @brief Connects a socket to the proxy and runs the SOCKS5 exchange up to (not including) the request.
+         */
+        bool negotiate(const SOCKET socket) const
+        {
+            setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&io_timeout_ms), sizeof(io_timeout_ms));
+            setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&io_timeout_ms), sizeof(io_timeout_ms));
+
+            if (!blocking_connect(socket, proxy_address_, proxy_port_, std::chrono::milliseconds(io_timeout_ms)))
+            {
+                NETLIB_DEBUG("negotiate: Failed to connect to SOCKS5 proxy {}:{}: {}",
+                    proxy_address_, proxy_port_, WSAGetLastError());
+                return false;
+            }
+
+            return blocking_socks5_authenticate(this, socket, username_, password_);
+        }
+
+        /**
+         * @brief Keeps size_ connections ready, replacing the expired ones.
+         */
+        void refill_thread()
+        {
+            auto retry_delay = std::chrono::seconds{ 1 };
+            auto next_attempt = clock::now();
+
+            std::unique_lock lock(lock_);
+
+            while (!stop_)
+            {
+                auto now = clock::now();
+
+                // Connections are appended in creation order, the oldest expire first
+                while (!idle_.empty() && idle_.front().expires <= now)
+                {
+                    closesocket(idle_.front().socket);
+                    idle_.pop_front();
+                }
+
+                if (idle_.size() < size_ && now >= next_attempt)
+                {
+                    lock.unlock();
+                    const auto socket = open_connection();
+                    lock.lock();
+
+                    if (socket != INVALID_SOCKET)
+                    {
+                        retry_delay = std::chrono::seconds{ 1 };
+
+                        try
+                        {
+                            if (stop_ || idle_.size() >= size_)
+                                closesocket(socket);
+                            else
+                                idle_.push_back({ socket, clock::now() + ttl_ });
+                        }
+                        catch (const std::bad_alloc&)
+                        {
+                            closesocket(socket);
+                        }
+
+                        continue;
+                    }
+
+                    NETLIB_WARNING("refill_thread: Failed to open a connection to SOCKS5 proxy {}:{}, retrying in {}s",
+                        proxy_address_, proxy_port_, retry_delay.count());
+
+                    now = clock::now();
+                    next_attempt = now + retry_delay;
+                    retry_delay = std::min(retry_delay * 2, max_retry_delay);
+                }
+
+                auto wake = idle_.empty() ? now + ttl_ : idle_.front().expires;
+
+                if (idle_.size() < size_)
+                    wake = std::min(wake, next_attempt);
+
+                signal_.wait_until(lock, wake);
+            }
+        }
+
+        /**
+         * @brief Address and port of the SOCKS5 proxy.
+         */
+        address_type_t proxy_address_;
+        uint16_t proxy_port_;
+
+        /**
+         * @brief Optional RFC 1929 credentials.
+         */
+        std::optional<std::string> username_;
+        std::optional<std::string> password_;
+
+        /**
+         * @brief Number of connections kept warm.
+         */
+        size_t size_;
+
+        /**
+         * @brief Lifetime of an unclaimed connection.
+         */
+        std::chrono::seconds ttl_;
+
+        /**
+         * @brief Protects idle_ and stop_.
+         */
+        mutable std::mutex lock_;
+
+        /**
+         * @brief Wakes the background thread when a connection is claimed or the pool is stopped.
+         */
+        std::condition_variable signal_;
+
+        /**
+         * @brief Unclaimed connections, oldest first.
+         */
+        std::deque<idle_connection> idle_;
+
+        /**
+         * @brief True when the background thread must exit.
+         */
+        bool stop_{ true };
+
+        /**
+         * @brief Background thread filling the pool.
+         */
+        std::thread refill_thread_;
+    };
+}
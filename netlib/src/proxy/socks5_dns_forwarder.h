@@ -0,0 +1,693 @@
+#pragma once
+
+namespace proxy
+{
+    /**
+     * @class socks5_dns_forwarder
+     * @brief Resolves DNS queries through a SOCKS5 proxy, answering repeated questions from a dns_cache.
+     *
+     * Queries are sent to a configured upstream resolver either in SOCKS5 UDP datagrams over a UDP
+     * ASSOCIATE relay, or as DNS over TCP (RFC 7766) on a CONNECT tunnel, for proxies that do not
+     * relay UDP. Identical questions asked while one is in flight are coalesced: only the first is
+     * sent upstream and every asker receives the response with its own query ID.
+     *
+     * Upstream exchanges are performed by a few worker threads with blocking I/O bounded by the
+     * configured timeout, never on the packet path. Each worker keeps its connection to the proxy
+     * open between queries. A failed exchange is retried once on a new connection; if that fails as
+     * well, the askers receive a SERVFAIL response so that they move on without waiting for their
+     * own timeout.
+     *
+     * All public methods are thread-safe. Completion handlers are called on a worker thread and must
+     * not throw.
+     *
+     * @tparam T Address type of the proxy and of the upstream resolver (e.g., IPv4 or IPv6).
+     */
+    template <net::ip_address T>
+    class socks5_dns_forwarder : public netlib::log::logger<socks5_dns_forwarder<T>>
+    {
+    public:
+        using log_level = netlib::log::log_level;
+        using logger = netlib::log::logger<socks5_dns_forwarder>;
+        using address_type_t = T;
+
+        /**
+         * @brief Receives the response to a forwarded query; the span is only valid during the call.
+         */
+        using completion_handler = std::function<void(std::span<const uint8_t>)>;
+
+        /**
+         * @brief Largest DNS message exchanged with the upstream resolver.
+         */
+        constexpr static size_t max_message_size = 65535;
+
+        /**
+         * @enum transport
+         * @brief How queries reach the upstream resolver through the proxy.
+         */
+        enum class transport : uint8_t
+        {
+            udp,    ///< SOCKS5 UDP ASSOCIATE relay.
+            tcp     ///< DNS over TCP on a SOCKS5 CONNECT tunnel.
+        };
+
+        /**
+         * @enum forward_result
+         * @brief Outcome of forward().
+         */
+        enum class forward_result : uint8_t
+        {
+            pending,    ///< The handler will be called with the response.
+            rejected,   ///< Not a query handled by the forwarder, the packet should go its way unchanged.
+            overloaded  ///< Too many queries in flight, the query should be dropped.
+        };
+
+        /**
+         * @struct options
+         * @brief Forwarder settings.
+         */
+        struct options
+        {
+            address_type_t resolver{};                          ///< Upstream resolver, reached through the proxy.
+            uint16_t resolver_port{ 53 };                       ///< Upstream resolver port.
+            transport upstream{ transport::udp };               ///< How queries reach the resolver.
+            size_t workers{ 2 };                                ///< Number of upstream connections and threads.
+            size_t max_pending{ 1024 };                         ///< Largest number of queries waiting for a response.
+            std::chrono::milliseconds timeout{ 3000 };          ///< Bound of each upstream I/O operation.
+            dns_cache::options cache{};                         ///< Response cache settings.
+        };
+
+        /**
+         * @struct statistics
+         * @brief Forwarder counters.
+         */
+        struct statistics
+        {
+            dns_cache::statistics cache;    ///< Response cache counters.
+            uint64_t forwarded;             ///< Questions sent upstream.
+            uint64_t coalesced;             ///< Queries attached to an identical one in flight.
+            uint64_t failed;                ///< Questions answered with SERVFAIL after the upstream exchange failed.
+            uint64_t overloaded;            ///< Queries refused because max_pending was reached.
+        };
+
+        /**
+         * @brief Constructs a forwarder for a SOCKS5 proxy. No connection is opened before start().
+         *
+         * @param proxy_address Address of the SOCKS5 proxy.
+         * @param proxy_port    TCP port of the SOCKS5 proxy.
+         * @param username      Optional RFC 1929 username.
+         * @param password      Optional RFC 1929 password.
+         * @param settings      Forwarder settings.
+         * @param log_level     Logging level (default: error).
+         * @param log_stream    Optional output stream for logging.
+         */
+        socks5_dns_forwarder(const address_type_t& proxy_address, const uint16_t proxy_port,
+            std::optional<std::string> username, std::optional<std::string> password,
+            const options& settings,
+            const log_level log_level = log_level::error,
+            std::shared_ptr<std::ostream> log_stream = nullptr)
+            : logger(log_level, std::move(log_stream)),
+            proxy_address_(proxy_address),
+            proxy_port_(proxy_port),
+            username_(std::move(username)),
+            password_(std::move(password)),
+            options_(settings),
+            cache_(settings.cache)
+        {
+        }
+
+        socks5_dns_forwarder(const socks5_dns_forwarder&) = delete;
+        socks5_dns_forwarder& operator=(const socks5_dns_forwarder&) = delete;
+        socks5_dns_forwarder(socks5_dns_forwarder&&) = delete;
+        socks5_dns_forwarder& operator=(socks5_dns_forwarder&&) = delete;
+
+        /**
+         * @brief Stops the worker threads.
+         */
+        ~socks5_dns_forwarder()
+        {
+            stop();
+        }
+
+        /**
+         * @brief Starts the worker threads. No-op if running.
+         *
+         * @throws std::system_error if a thread cannot be created.
+         */
+        void start()
+        {
+            {
+                std::scoped_lock lock(lock_);
+
+                if (!workers_.empty())
+                    return;
+
+                stop_ = false;
+
+                try
+                {
+                    for (size_t i = 0; i < std::max<size_t>(options_.workers, 1); ++i)
+                        workers_.emplace_back(&socks5_dns_forwarder::worker_thread, this);
+
+                    return;
+                }
+                catch (const std::system_error&)
+                {
+                    // The threads already started are joined below, outside the lock they wait for
+                }
+            }
+
+            stop();
+            throw std::system_error(std::make_error_code(std::errc::resource_unavailable_try_again),
+                "socks5_dns_forwarder: failed to start the worker threads");
+        }
+
+        /**
+         * @brief Stops the worker threads and discards the queries in flight; no handler is called afterwards.
+         *
+         * Waits for the exchanges the workers have in progress, whose connect, send and receive steps
+         * are each bounded by options::timeout.
+         */
+        void stop()
+        {
+            std::vector<std::thread> workers;
+
+            {
+                std::scoped_lock lock(lock_);
+                stop_ = true;
+                workers.swap(workers_);
+            }
+
+            signal_.notify_all();
+
+            for (auto& worker : workers)
+                worker.join();
+
+            std::scoped_lock lock(lock_);
+
+            jobs_.clear();
+            pending_.clear();
+            pending_queries_ = 0;
+        }
+
+        /**
+         * @brief Writes the cached response to a query.
+         *
+         * @param query The DNS query message.
+         * @param response Buffer receiving the response, may start at the query.
+         * @return The response length, 0 if there is no usable cached response.
+         */
+        [[nodiscard]] size_t answer(const std::span<const uint8_t> query, const std::span<uint8_t> response)
+        {
+            const auto key = dns_cache::key_of(query);
+            if (!key)
+                return 0;
+
+            return cache_.find(key.value(), dns_cache::id_of(query), response);
+        }
+
+        /**
+         * @brief Resolves a query upstream, coalescing it with an identical query in flight.
+         *
+         * @param query The DNS query message, copied before the call returns.
+         * @param handler Called with the response, carrying the ID of the query.
+         * @return Whether the handler will be called.
+         */
+        forward_result forward(const std::span<const uint8_t> query, completion_handler handler)
+        {
+            auto key = dns_cache::key_of(query);
+            if (!key)
+                return forward_result::rejected;
+
+            std::scoped_lock lock(lock_);
+
+            if (stop_)
+                return forward_result::rejected;
+
+            if (pending_queries_ >= options_.max_pending)
+            {
+                ++overloaded_;
+                return forward_result::overloaded;
+            }
+
+            auto [it, inserted] = pending_.try_emplace(key.value());
+            it->second.push_back({ dns_cache::id_of(query), std::move(handler) });
+            ++pending_queries_;
+
+            if (!inserted)
+            {
+                ++coalesced_;
+                return forward_result::pending;
+            }
+
+            jobs_.push_back({ std::move(key.value()), std::vector<uint8_t>(query.begin(), query.end()) });
+            signal_.notify_one();
+
+            return forward_result::pending;
+        }
+
+        /**
+         * @brief Returns a snapshot of the forwarder counters.
+         */
+        [[nodiscard]] statistics get_statistics() const
+        {
+            const auto cache = cache_.get_statistics();
+
+            std::scoped_lock lock(lock_);
+            return { cache, forwarded_, coalesced_, failed_, overloaded_ };
+        }
+
+    private:
+        /**
+         * @brief Asker of a query in flight.
+         */
+        struct waiter
+        {
+            uint16_t id;                    ///< Query ID (network byte order).
+            completion_handler handler;     ///< Receives the response.
+        };
+
+        /**
+         * @brief Question to be sent upstream.
+         */
+        struct job
+        {
+            std::string key;                ///< Cache key of the question.
+            std::vector<uint8_t> query;     ///< First query asking it.
+        };
+
+        /**
+         * @brief Connection of a worker to the proxy.
+         */
+        struct upstream_connection
+        {
+            SOCKET control{ INVALID_SOCKET };   ///< SOCKS5 control connection (the DNS over TCP tunnel in tcp mode).
+            SOCKET relay{ INVALID_SOCKET };     ///< UDP socket connected to the proxy relay (udp mode).
+            uint16_t next_id{ 0 };              ///< Source of upstream query IDs.
+
+            void close() noexcept
+            {
+                if (relay != INVALID_SOCKET)
+                    closesocket(std::exchange(relay, INVALID_SOCKET));
+
+                if (control != INVALID_SOCKET)
+                    closesocket(std::exchange(control, INVALID_SOCKET));
+            }
+        };
+
+        /**
+         * @brief Applies the I/O timeout to a socket.
+         */
+        void set_timeout(const SOCKET socket) const noexcept
+        {
+            const auto timeout = static_cast<DWORD>(options_.timeout.count());
+            setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+            setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+        }
+
+        /**
+         * @brief Connects a socket to the proxy and runs the SOCKS5 exchange up to (not including) the request.
+         */
+        bool negotiate(const SOCKET socket) const
+        {
+            set_timeout(socket);
+
+            if (!blocking_connect(socket, proxy_address_, proxy_port_, options_.timeout))
+            {
+                NETLIB_DEBUG("negotiate: Failed to connect to SOCKS5 proxy {}:{}: {}",
+                    proxy_address_, proxy_port_, WSAGetLastError());
+                return false;
+            }
+
+            return blocking_socks5_authenticate(this, socket, username_, password_);
+        }
+
+        /**
+         * @brief Sends a CONNECT or UDP ASSOCIATE request and receives the reply.
+         *
+         * The reply length depends on the type of the bound address, so it is received in parts.
+         *
+         * @return The bound port (host byte order), or std::nullopt if the request failed.
+         */
+        std::optional<uint16_t> request(const SOCKET socket, const unsigned char command,
+            const address_type_t& address, const uint16_t port) const
+        {
+            socks5_req<address_type_t> req{};
+
+            req.cmd = command;
+            req.address_type = address_type_t::af_type == AF_INET ? 1 : 4;
+            req.dest_address = address;
+            req.dest_port = htons(port);
+
+            // Header, then up to a 255 bytes long domain name with its length, then the port
+            std::array<uint8_t, 4 + 1 + 255 + 2> reply{};
+
+            if (!blocking_send_all(socket, reinterpret_cast<const char*>(&req), sizeof(req)) ||
+                !blocking_recv_all(socket, reinterpret_cast<char*>(reply.data()), 4))
+            {
+                NETLIB_DEBUG("request: SOCKS5 request {} failed: {}", command, WSAGetLastError());
+                return std::nullopt;
+            }
+
+            if (reply[0] != 5 || reply[1] != 0)
+            {
+                NETLIB_INFO("[SOCKS5]: request: SOCKS5 request {} was refused with reply {}", command, reply[1]);
+                return std::nullopt;
+            }
+
+            size_t offset = 4;
+            size_t address_length;
+
+            switch (reply[3])
+            {
+            case 1: address_length = 4; break;
+            case 4: address_length = 16; break;
+            case 3:
+                if (!blocking_recv_all(socket, reinterpret_cast<char*>(reply.data() + offset), 1))
+                    return std::nullopt;
+                address_length = reply[offset++];
+                break;
+            default:
+                NETLIB_INFO("[SOCKS5]: request: Unsupported bound address type {}", reply[3]);
+                return std::nullopt;
+            }
+
+            if (!blocking_recv_all(socket, reinterpret_cast<char*>(reply.data() + offset), static_cast<int>(address_length + 2)))
+                return std::nullopt;
+
+            offset += address_length;
+
+            return static_cast<uint16_t>(reply[offset] << 8 | reply[offset + 1]);
+        }
+
+        /**
+         * @brief Opens the worker connection: a CONNECT tunnel to the resolver or a UDP ASSOCIATE relay.
+         */
+        bool open(upstream_connection& connection) const
+        {
+            connection.control = WSASocket(address_type_t::af_type, SOCK_STREAM, IPPROTO_TCP, nullptr, 0, 0);
+
+            if (connection.control == INVALID_SOCKET)
+                return false;
+
+            if (!negotiate(connection.control))
+            {
+                connection.close();
+                return false;
+            }
+
+            if (options_.upstream == transport::tcp)
+            {
+                if (!request(connection.control, 1, options_.resolver, options_.resolver_port))
+                {
+                    connection.close();
+                    return false;
+                }
+
+                return true;
+            }
+
+            const auto relay_port = request(connection.control, 3, address_type_t{}, 0);
+
+            if (!relay_port)
+            {
+                connection.close();
+                return false;
+            }
+
+            connection.relay = WSASocket(address_type_t::af_type, SOCK_DGRAM, IPPROTO_UDP, nullptr, 0, 0);
+
+            if (connection.relay == INVALID_SOCKET)
+            {
+                connection.close();
+                return false;
+            }
+
+            set_timeout(connection.relay);
+
+            // The relay is reached at the proxy address, as by socks5_udp_proxy_socket
+            if (!blocking_connect(connection.relay, proxy_address_, relay_port.value(), options_.timeout))
+            {
+                NETLIB_DEBUG("open: Failed to connect to the UDP relay {}:{}: {}",
+                    proxy_address_, relay_port.value(), WSAGetLastError());
+                connection.close();
+                return false;
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Sends a query on the connection and receives its response, skipping stale responses.
+         */
+        bool exchange(upstream_connection& connection, const std::span<const uint8_t> query,
+            std::vector<uint8_t>& response) const
+        {
+            if (connection.control == INVALID_SOCKET && !open(connection))
+                return false;
+
+            // The upstream ID tells the response apart from late responses to earlier queries
+            const auto id = htons(++connection.next_id);
+
+            if (options_.upstream == transport::tcp)
+            {
+                std::vector<uint8_t> message(2 + query.size());
+                message[0] = static_cast<uint8_t>(query.size() >> 8);
+                message[1] = static_cast<uint8_t>(query.size());
+                std::memcpy(message.data() + 2, query.data(), query.size());
+                std::memcpy(message.data() + 2, &id, sizeof(id));
+
+                if (!blocking_send_all(connection.control, reinterpret_cast<const char*>(message.data()), static_cast<int>(message.size())))
+                    return false;
+
+                for (;;)
+                {
+                    uint8_t length[2];
+
+                    if (!blocking_recv_all(connection.control, reinterpret_cast<char*>(length), sizeof(length)))
+                        return false;
+
+                    response.resize(static_cast<size_t>(length[0] << 8 | length[1]));
+
+                    if (!blocking_recv_all(connection.control, reinterpret_cast<char*>(response.data()), static_cast<int>(response.size())))
+                        return false;
+
+                    if (response.size() >= dns_cache::header_length && dns_cache::id_of(response) == id)
+                        return true;
+                }
+            }
+
+            socks5_udp_header<address_type_t> header{};
+
+            header.address_type = address_type_t::af_type == AF_INET ? 1 : 4;
+            header.dest_address = options_.resolver;
+            header.dest_port = htons(options_.resolver_port);
+
+            std::vector<uint8_t> datagram(sizeof(header) + query.size());
+            std::memcpy(datagram.data(), &header, sizeof(header));
+            std::memcpy(datagram.data() + sizeof(header), query.data(), query.size());
+            std::memcpy(datagram.data() + sizeof(header), &id, sizeof(id));
+
+            if (send(connection.relay, reinterpret_cast<const char*>(datagram.data()), static_cast<int>(datagram.size()), 0) == SOCKET_ERROR)
+                return false;
+
+            datagram.resize(max_message_size);
+
+            for (;;)
+            {
+                const auto received = recv(connection.relay, reinterpret_cast<char*>(datagram.data()), static_cast<int>(datagram.size()), 0);
+                if (received == SOCKET_ERROR)
+                    return false;
+
+                // Reserved, fragment, address type, then the source address and port
+                const auto length = static_cast<size_t>(received);
+                if (length < 4 || datagram[2] != 0)
+                    continue;
+
+                size_t offset;
+
+                switch (datagram[3])
+                {
+                case 1: offset = 4 + 4 + 2; break;
+                case 4: offset = 4 + 16 + 2; break;
+                case 3: offset = length > 4 ? 4 + 1 + datagram[4] + 2 : length; break;
+                default: continue;
+                }
+
+                if (length < offset + dns_cache::header_length)
+                    continue;
+
+                const std::span message(datagram.data() + offset, length - offset);
+
+                if (dns_cache::id_of(message) == id)
+                {
+                    response.assign(message.begin(), message.end());
+                    return true;
+                }
+            }
+        }
+
+        /**
+         * @brief Hands the response to the askers of a question, each with its own query ID.
+         *
+         * @param key Cache key of the question.
+         * @param response The response, or an empty one to only discard the askers.
+         */
+        void complete(const std::string& key, std::vector<uint8_t>& response)
+        {
+            std::vector<waiter> waiters;
+
+            {
+                std::scoped_lock lock(lock_);
+
+                if (const auto it = pending_.find(key); it != pending_.end())
+                {
+                    waiters = std::move(it->second);
+                    pending_.erase(it);
+                    pending_queries_ -= waiters.size();
+                }
+            }
+
+            if (response.size() < dns_cache::header_length)
+                return;
+
+            for (const auto& [id, handler] : waiters)
+            {
+                std::memcpy(response.data(), &id, sizeof(id));
+                handler(response);
+            }
+        }
+
+        /**
+         * @brief Resolves the queued questions on its own upstream connection.
+         */
+        void worker_thread()
+        {
+            upstream_connection connection;
+
+            std::unique_lock lock(lock_);
+
+            while (!stop_)
+            {
+                if (jobs_.empty())
+                {
+                    signal_.wait(lock);
+                    continue;
+                }
+
+                auto [key, query] = std::move(jobs_.front());
+                jobs_.pop_front();
+                ++forwarded_;
+
+                lock.unlock();
+
+                std::vector<uint8_t> response;
+
+                try
+                {
+                    auto resolved = exchange(connection, query, response);
+
+                    if (!resolved)
+                    {
+                        // The proxy or the resolver may have dropped an idle connection
+                        connection.close();
+                        resolved = exchange(connection, query, response);
+                    }
+
+                    if (resolved)
+                    {
+                        cache_.insert(key, response);
+                    }
+                    else
+                    {
+                        NETLIB_WARNING("worker_thread: Failed to resolve a query through SOCKS5 proxy {}:{}: {}",
+                            proxy_address_, proxy_port_, WSAGetLastError());
+
+                        connection.close();
+                        response = std::move(query);
+                        response.resize(dns_cache::make_servfail(response));
+
+                        lock.lock();
+                        ++failed_;
+                        lock.unlock();
+                    }
+                }
+                catch (const std::bad_alloc&)
+                {
+                    response.clear();
+                }
+
+                complete(key, response);
+
+                lock.lock();
+            }
+
+            lock.unlock();
+            connection.close();
+        }
+
+        /**
+         * @brief Address and port of the SOCKS5 proxy.
+         */
+        address_type_t proxy_address_;
+        uint16_t proxy_port_;
+
+        /**
+         * @brief Optional RFC 1929 credentials.
+         */
+        std::optional<std::string> username_;
+        std::optional<std::string> password_;
+
+        /**
+         * @brief Forwarder settings.
+         */
+        options options_;
+
+        /**
+         * @brief Responses of the upstream resolver.
+         */
+        dns_cache cache_;
+
+        /**
+         * @brief Protects jobs_, pending_, stop_, workers_ and the counters.
+         */
+        mutable std::mutex lock_;
+
+        /**
+         * @brief Wakes a worker when a question is queued or the forwarder is stopped.
+         */
+        std::condition_variable signal_;
+
+        /**
+         * @brief Questions waiting for a worker, oldest first.
+         */
+        std::deque<job> jobs_;
+
+        /**
+         * @brief Askers of each question in flight, by cache key.
+         */
+        tools::generic::flat_hash_map<std::string, std::vector<waiter>> pending_;
+
+        /**
+         * @brief Number of queries in pending_, coalesced ones included.
+         */
+        size_t pending_queries_{ 0 };
+
+        /**
+         * @brief True when the workers must exit.
+         */
+        bool stop_{ true };
+
+        /**
+         * @brief Worker threads.
+         */
+        std::vector<std::thread> workers_;
+
+        /**
+         * @brief Forwarder counters.
+         */
+        uint64_t forwarded_{ 0 };
+        uint64_t coalesced_{ 0 };
+        uint64_t failed_{ 0 };
+        uint64_t overloaded_{ 0 };
+    };
+}
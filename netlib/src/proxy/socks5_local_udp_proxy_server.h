@@ -73,10 +73,25 @@ namespace proxy
          */
         constexpr static size_t connections_array_size = 64;
 
+        /**
+         * @brief Number of Registered I/O receives kept posted on the server socket.
+         */
+        constexpr static ULONG rio_receive_depth = 64;
+
+        /**
+         * @brief Resolution of the session idle timers (and longest wait of the cleanup thread).
+         */
+        constexpr static std::chrono::seconds idle_timer_tick{ 1 };
+
+        /**
+         * @brief Number of idle timer wheel slots, covering T::idle_timeout in ticks.
+         */
+        constexpr static size_t idle_timer_slots = 512;
+
         /**
          * @brief Mutex for synchronizing access to internal data structures.
          *
-         * Used to protect shared resources such as the proxy_sockets_ map
+         * Used to protect shared resources such as the proxy_sockets_ map and the idle timers
          * from concurrent access by multiple threads.
          */
         std::mutex lock_;
@@ -91,7 +106,7 @@ namespace proxy
         /**
          * @brief Thread object for client cleanup operations.
          *
-         * Periodically checks and removes inactive or closed client connections.
+         * Removes closed client connections and those whose idle timer has expired.
          */
         std::thread check_clients_thread_;
 
@@ -104,6 +119,26 @@ namespace proxy
          */
         std::map<uint16_t, std::shared_ptr<T>> proxy_sockets_;
 
+        /**
+         * @brief Idle timer of every active session, keyed by local UDP port.
+         */
+        tools::generic::timing_wheel<uint16_t> idle_timers_{ idle_timer_tick, idle_timer_slots };
+
+        /**
+         * @brief Protects closed_sessions_. Innermost lock, nothing is called while it is held.
+         */
+        std::mutex closed_lock_;
+
+        /**
+         * @brief Wakes the cleanup thread when a session has been closed.
+         */
+        std::condition_variable closed_signal_;
+
+        /**
+         * @brief Sessions marked for removal since the last cleanup pass, with their local UDP port.
+         */
+        std::vector<std::pair<uint16_t, std::weak_ptr<T>>> closed_sessions_;
+
         /**
          * @brief Indicates whether the server is terminating.
          *
@@ -162,44 +197,80 @@ namespace proxy
         uint16_t proxy_port_;
 
         /**
-         * @brief Reference to the I/O completion port used for asynchronous operations.
+         * @brief Reference to the I/O completion ports used for asynchronous operations.
          */
-        netlib::winsys::io_completion_port& completion_port_;
+        netlib::winsys::io_completion_port_group& completion_ports_;
 
         /**
-         * @brief Completion key associated with the server socket in the I/O completion port.
+         * @brief Completion keys of this server's handler, one per completion port shard.
+         *
+         * The server socket is bound to the first shard; each session is bound to the shard
+         * picked when it was created.
          */
-        ULONG_PTR completion_key_{ 0 };
+        std::vector<ULONG_PTR> completion_keys_;
 
         /**
          * @brief Function to query remote peer information for a given local address and port.
          */
         std::function<query_remote_peer_t> query_remote_peer_;
 
+        /**
+         * @brief ConnectEx extension function used to connect the SOCKS5 control sockets.
+         */
+        LPFN_CONNECTEX connect_ex_{ nullptr };
+
+        /**
+         * @brief True if the server socket receives through Registered I/O.
+         */
+        bool registered_io_;
+
+        /**
+         * @brief Registered I/O receive queue of the server socket (nullptr with classic overlapped receives).
+         */
+        std::unique_ptr<netlib::winsys::rio_receive_queue> rio_receive_queue_;
+
+        /**
+         * @brief Optional pool of pre-negotiated control connections to the SOCKS5 proxy.
+         */
+        std::shared_ptr<socks5_connection_pool<address_type_t>> connection_pool_;
+
     public:
         /**
          * @brief Constructs a SOCKS5 local UDP proxy server.
          *
-         * Initializes the proxy server with the specified UDP port, I/O completion port,
+         * Initializes the proxy server with the specified UDP port, I/O completion ports,
          * remote peer query function, logging level, and optional log stream.
          *
          * @param proxy_port The local UDP port to bind the proxy server to.
-         * @param completion_port Reference to the I/O completion port for asynchronous operations.
+         * @param completion_ports Reference to the I/O completion ports for asynchronous operations.
          * @param query_remote_peer_fn Function to resolve the remote peer for a given local address/port.
          * @param log_level The logging level for the server (default: error).
          * @param log_stream Optional output stream for logging (default: std::nullopt).
+         * @param registered_io If true, the server socket receives datagrams from local clients through
+         *                  Registered I/O, falling back to overlapped receives if RIO is unavailable (default: false).
+         * @param connection_pool Optional pool of pre-negotiated SOCKS5 control connections. Sessions to the
+         *                  pool's proxy claim one and send UDP ASSOCIATE right away (default: nullptr).
          *
-         * @throws std::runtime_error if the server socket cannot be created or bound.
+         * @throws std::runtime_error if ConnectEx cannot be loaded or the server socket cannot be created or bound.
          */
-        socks5_local_udp_proxy_server(const uint16_t proxy_port, netlib::winsys::io_completion_port& completion_port,
+        socks5_local_udp_proxy_server(const uint16_t proxy_port, netlib::winsys::io_completion_port_group& completion_ports,
             const std::function<query_remote_peer_t>& query_remote_peer_fn,
             const log_level log_level = log_level::error,
-            std::shared_ptr<std::ostream> log_stream = nullptr)
+            std::shared_ptr<std::ostream> log_stream = nullptr,
+            const bool registered_io = false,
+            std::shared_ptr<socks5_connection_pool<address_type_t>> connection_pool = nullptr)
             : logger(log_level, std::move(log_stream)),
             proxy_port_(proxy_port),
-            completion_port_(completion_port),
-            query_remote_peer_(query_remote_peer_fn)
+            completion_ports_(completion_ports),
+            query_remote_peer_(query_remote_peer_fn),
+            registered_io_(registered_io),
+            connection_pool_(std::move(connection_pool))
         {
+            if (!load_connect_ex())
+            {
+                throw std::runtime_error("socks5_local_udp_proxy_server: failed to load ConnectEx.");
+            }
+
             if (!create_server_socket())
             {
                 throw std::runtime_error("socks5_local_udp_proxy_server: failed to create server socket.");
@@ -268,8 +339,7 @@ namespace proxy
 
             if (server_socket_ != static_cast<SOCKET>(INVALID_SOCKET))
             {
-                if (auto [associate_status, io_key] = completion_port_.associate_socket(
-                    server_socket_,
+                const std::function<netlib::winsys::io_completion_port::callback_t> io_handler =
                     [this](const DWORD num_bytes, OVERLAPPED* povlp, const BOOL status)
                     {
                         // RAII guard to ensure we decrement on all exit paths (including exceptions)
@@ -299,6 +369,33 @@ namespace proxy
 
                         std::lock_guard lock(lock_);
 
+                        // Registered I/O receives of the server socket have completed
+                        if (rio_receive_queue_ && povlp == rio_receive_queue_->notification())
+                        {
+                            if (!rio_receive_queue_->process_completions(
+                                [this](const char* data, const DWORD length, const SOCKADDR_STORAGE& from)
+                                {
+                                    relay_local_datagram(data, length, from);
+                                }))
+                            {
+                                NETLIB_ERROR("Failed to process registered I/O receives of the server socket");
+                            }
+
+                            // Increment counter BEFORE re-arming, the notification is a pending operation too
+                            if (!end_server_)
+                            {
+                                active_iocp_operations_.fetch_add(1, std::memory_order_acquire);
+
+                                if (!rio_receive_queue_->arm())
+                                {
+                                    active_iocp_operations_.fetch_sub(1, std::memory_order_release);
+                                    result = false;
+                                }
+                            }
+
+                            return result;
+                        }
+
                         auto io_context = static_cast<per_io_context_t*>(povlp);
 
                         // If this is the server socket's read operation
@@ -309,29 +406,10 @@ namespace proxy
 
                             if (status && num_bytes)
                             {
-                                do
-                                {
-                                    if (false == connect_to_remote_host(io_context))
-                                    {
-                                        result = false;
-                                        break;
-                                    }
-
-                                    io_context->wsa_buf = packet_pool_->allocate(num_bytes);
-
-                                    if (!io_context->wsa_buf)
-                                    {
-                                        result = false;
-                                        break;
-                                    }
-
-                                    io_context->wsa_buf->len = num_bytes;
-                                    memmove(io_context->wsa_buf->buf, server_receive_buffer_.data(), num_bytes);
-                                } while (false);
+                                result = relay_local_datagram(server_receive_buffer_.data(), num_bytes, recv_from_sa_);
                             }
                         }
-
-                        if (status && result)
+                        else if (status)
                         {
                             switch (io_context->io_operation)
                             {
@@ -355,9 +433,20 @@ namespace proxy
                                 T::process_inject_buffer_complete(packet_pool_, io_context);
                                 break;
 
+                            case proxy_io_operation::connect_io:
+                                io_context->proxy_socket_ptr->process_connect_complete(io_context);
+                                break;
+
                             default: break; // NOLINT(clang-diagnostic-covered-switch-default)
                             }
                         }
+                        else if ((io_context->io_operation == proxy_io_operation::connect_io) ||
+                            (io_context->io_operation == proxy_io_operation::negotiate_io_read) ||
+                            (io_context->io_operation == proxy_io_operation::negotiate_io_write))
+                        {
+                            // The SOCKS5 control connection failed before the association was established
+                            io_context->proxy_socket_ptr->close_client();
+                        }
 
                         if (server_read)
                         {
@@ -388,9 +477,37 @@ namespace proxy
                         }
 
                         return result;
-                   }); associate_status == true)
+                   };
+
+                if (auto [associate_status, io_key] = completion_ports_.port(0).associate_socket(
+                    server_socket_, io_handler); associate_status == true)
                 {
-                    completion_key_ = io_key;
+                    completion_keys_.assign(completion_ports_.size(), 0);
+                    completion_keys_[0] = io_key;
+
+                    for (size_t i = 1; i < completion_ports_.size(); ++i)
+                    {
+                        completion_keys_[i] = completion_ports_.port(i).register_handler(io_handler);
+                    }
+
+                    if (registered_io_)
+                    {
+                        if (start_registered_io())
+                        {
+                            check_clients_thread_ = std::thread(&socks5_local_udp_proxy_server<T>::clear_thread, this);
+                            return true;
+                        }
+
+                        if (rio_receive_queue_)
+                        {
+                            // The socket is bound to a RIO request queue and cannot receive otherwise
+                            closesocket(server_socket_);
+                            server_socket_ = INVALID_SOCKET;
+                            end_server_ = true;
+                            return false;
+                        }
+                    }
+
                     DWORD flags = 0;
 
                     // Increment counter BEFORE posting the initial I/O operation
@@ -453,7 +570,11 @@ namespace proxy
             }
 
             // Step 1: Signal shutdown - IOCP lambda will check this and exit
-            end_server_ = true;
+            {
+                std::lock_guard lock(closed_lock_);
+                end_server_ = true;
+            }
+            closed_signal_.notify_all();
 
             // Step 2: Close server socket
             // This causes any pending WSARecvFrom to complete immediately with an error.
@@ -464,12 +585,15 @@ namespace proxy
                 server_socket_ = INVALID_SOCKET;
             }
 
-            // Step 2.5: Unregister the IOCP handler BEFORE waiting
-            if (completion_key_ != 0) {
-                (void)completion_port_.unregister_handler(completion_key_);
-                completion_key_ = 0;
+            // Step 2.5: Unregister the IOCP handlers BEFORE waiting
+            for (size_t i = 0; i < completion_keys_.size(); ++i)
+            {
+                if (completion_keys_[i] != 0)
+                    (void)completion_ports_.port(i).unregister_handler(completion_keys_[i]);
             }
 
+            completion_keys_.clear();
+
             // Step 3: Close all proxy sockets FIRST to cancel their I/O operations
             // This is CRITICAL: proxy sockets post their own I/O operations that will
             // call back into this server's lambda, potentially after the server is destroyed.
@@ -483,6 +607,8 @@ namespace proxy
                     // which will close their sockets and cancel any pending I/O
                     proxy_sockets_.clear();
                 }
+
+                idle_timers_.clear();
             }
 
             // Step 4: Wait for all active IOCP operations to complete
@@ -507,6 +633,9 @@ namespace proxy
                 std::this_thread::sleep_for(wait_time);
             }
 
+            // The server socket is closed and no notification is being processed any more
+            rio_receive_queue_.reset();
+
             // Step 5: Join background threads
             if (proxy_server_.joinable())
             {
@@ -517,6 +646,8 @@ namespace proxy
             {
                 check_clients_thread_.join();
             }
+
+            closed_sessions_.clear();
         }
 
     private:
@@ -554,8 +685,24 @@ namespace proxy
          */
         bool create_server_socket()
         {
-            server_socket_ = WSASocket(address_type_t::af_type, SOCK_DGRAM, IPPROTO_UDP, nullptr, 0,
-                WSA_FLAG_OVERLAPPED);
+            if (registered_io_)
+            {
+                server_socket_ = WSASocket(address_type_t::af_type, SOCK_DGRAM, IPPROTO_UDP, nullptr, 0,
+                    WSA_FLAG_OVERLAPPED | WSA_FLAG_REGISTERED_IO);
+
+                if (server_socket_ == static_cast<SOCKET>(INVALID_SOCKET))
+                {
+                    NETLIB_WARNING("create_server_socket: Registered I/O socket unavailable ({}), using overlapped I/O",
+                        WSAGetLastError());
+                    registered_io_ = false;
+                }
+            }
+
+            if (server_socket_ == static_cast<SOCKET>(INVALID_SOCKET))
+            {
+                server_socket_ = WSASocket(address_type_t::af_type, SOCK_DGRAM, IPPROTO_UDP, nullptr, 0,
+                    WSA_FLAG_OVERLAPPED);
+            }
 
             if (server_socket_ == static_cast<SOCKET>(INVALID_SOCKET))
             {
@@ -629,312 +776,201 @@ namespace proxy
         }
 
         /**
-         * @brief Establishes a TCP connection to the specified SOCKS5 proxy server.
+         * @brief Starts receiving on the server socket through Registered I/O.
          *
-         * This method creates a non-blocking TCP socket (IPv4 or IPv6 depending on address_type_t::af_type),
-         * binds it to a local ephemeral port, and connects it to the given SOCKS5 proxy server address and port.
-         * On failure, the socket is closed and INVALID_SOCKET is returned.
+         * Posts the RIO receives and arms the completion queue, whose notifications arrive on the
+         * first completion port shard with the server's completion key.
          *
-         * @param socks_server_address The address of the SOCKS5 proxy server to connect to.
-         * @param socks_server_port The port of the SOCKS5 proxy server.
-         * @return A connected TCP SOCKET handle, or INVALID_SOCKET on failure.
+         * @return True if the receives were posted and the queue armed. Otherwise false, and the
+         *         server falls back to overlapped receives if rio_receive_queue_ was released, or must
+         *         fail to start if it is kept (the socket is bound to a request queue for good).
          */
-        SOCKET connect_to_socks5_proxy(address_type_t socks_server_address, const uint16_t socks_server_port)
+        bool start_registered_io()
         {
-            auto socks_tcp_socket = WSASocket(address_type_t::af_type, SOCK_STREAM, IPPROTO_TCP, nullptr, 0,
-                WSA_FLAG_OVERLAPPED);
+            rio_receive_queue_ = std::make_unique<netlib::winsys::rio_receive_queue>(
+                server_socket_, static_cast<HANDLE>(completion_ports_.port(0)), completion_keys_[0],
+                rio_receive_depth, static_cast<ULONG>(T::send_receive_buffer_size));
 
-            if (socks_tcp_socket == INVALID_SOCKET)
+            if (rio_receive_queue_->valid())
             {
-                return INVALID_SOCKET;
-            }
+                // Increment counter BEFORE arming, the notification is a pending operation
+                active_iocp_operations_.fetch_add(1, std::memory_order_acquire);
 
-            // Set socket timeouts to prevent indefinite blocking in recv/send calls
-            // This prevents deadlock where IOCP worker holds lock_ while blocked on network I/O
-            constexpr DWORD timeout_ms = 5000; // 5 second timeout
-            if (setsockopt(socks_tcp_socket, SOL_SOCKET, SO_RCVTIMEO, 
-                          reinterpret_cast<const char*>(&timeout_ms), sizeof(timeout_ms)) == SOCKET_ERROR)
-            {
-                NETLIB_WARNING("Failed to set socket receive timeout: {}", WSAGetLastError());
-            }
-            
-            if (setsockopt(socks_tcp_socket, SOL_SOCKET, SO_SNDTIMEO, 
-                          reinterpret_cast<const char*>(&timeout_ms), sizeof(timeout_ms)) == SOCKET_ERROR)
-            {
-                NETLIB_WARNING("Failed to set socket send timeout: {}", WSAGetLastError());
-            }
-
-            if constexpr (address_type_t::af_type == AF_INET)
-            {
-                sockaddr_in sa_local{};
-                sa_local.sin_family = address_type_t::af_type;
-                sa_local.sin_port = htons(0);
-                sa_local.sin_addr.s_addr = htonl(INADDR_ANY);
-
-                if (const auto status = bind(socks_tcp_socket, reinterpret_cast<sockaddr*>(&sa_local), sizeof(sa_local))
-                    ; status == SOCKET_ERROR)
+                if (rio_receive_queue_->arm())
                 {
-                    closesocket(socks_tcp_socket);
-                    return INVALID_SOCKET;
+                    NETLIB_INFO("start_registered_io: Server socket receives through Registered I/O");
+                    return true;
                 }
-            }
-            else
-            {
-                sockaddr_in6 sa_local{};
-                sa_local.sin6_family = address_type_t::af_type;
-                sa_local.sin6_port = htons(0);
-                sa_local.sin6_addr = in6addr_any;
 
-                if (const auto status = bind(socks_tcp_socket, reinterpret_cast<sockaddr*>(&sa_local), sizeof(sa_local))
-                    ; status == SOCKET_ERROR)
-                {
-                    closesocket(socks_tcp_socket);
-                    return INVALID_SOCKET;
-                }
+                active_iocp_operations_.fetch_sub(1, std::memory_order_release);
             }
 
-            // connect to server
-            if constexpr (address_type_t::af_type == AF_INET)
+            if (rio_receive_queue_->bound())
             {
-                sockaddr_in sa_service{};
-                sa_service.sin_family = address_type_t::af_type;
-                sa_service.sin_addr = socks_server_address;
-                sa_service.sin_port = htons(socks_server_port);
-
-                if (connect(socks_tcp_socket, reinterpret_cast<SOCKADDR*>(&sa_service), sizeof(sa_service)) ==
-                    SOCKET_ERROR)
-                {
-                    closesocket(socks_tcp_socket);
-                    return INVALID_SOCKET;
-                }
+                NETLIB_ERROR("start_registered_io: Registered I/O receives failed to start: {}", WSAGetLastError());
+                return false;
             }
-            else
-            {
-                sockaddr_in6 sa_service{};
-                sa_service.sin6_family = address_type_t::af_type;
-                sa_service.sin6_addr = socks_server_address;
-                sa_service.sin6_port = htons(socks_server_port);
 
-                if (connect(socks_tcp_socket, reinterpret_cast<SOCKADDR*>(&sa_service), sizeof(sa_service)) ==
-                    SOCKET_ERROR)
-                {
-                    closesocket(socks_tcp_socket);
-                    return INVALID_SOCKET;
-                }
-            }
+            NETLIB_WARNING("start_registered_io: Registered I/O unavailable ({}), using overlapped I/O",
+                WSAGetLastError());
 
-            return socks_tcp_socket;
+            rio_receive_queue_.reset();
+            return false;
         }
 
         /**
-         * @brief Performs SOCKS5 negotiation and sends the UDP ASSOCIATE command.
+         * @brief Relays a datagram received on the server socket to the session of its sender.
          *
-         * This method negotiates authentication with the SOCKS5 proxy server over the provided TCP socket,
-         * using either "NO AUTHENTICATION REQUIRED" or "USERNAME/PASSWORD" (RFC 1929) as needed.
-         * If authentication succeeds, it sends a UDP ASSOCIATE command to the proxy and retrieves the
-         * UDP port assigned by the proxy for relaying UDP packets.
+         * Looks up (or creates) the session of the local peer, copies the datagram into a pooled
+         * packet and hands it to the session as a completed receive from the local socket.
          *
-         * @param socks_tcp_socket The connected TCP socket to the SOCKS5 proxy server.
-         * @param negotiate_ctx Unique pointer to the negotiation context, containing optional credentials.
-         * @return The UDP port assigned by the SOCKS5 proxy for UDP relay, or std::nullopt on failure.
+         * @param data   Datagram payload (only valid for the duration of the call).
+         * @param length Payload length in bytes.
+         * @param from   Source address of the datagram.
+         * @return True if the datagram was relayed, false if the session could not be set up or
+         *         no packet buffer was available.
          */
-        [[nodiscard]] std::optional<uint16_t> associate_to_socks5_proxy(const SOCKET socks_tcp_socket,
-            std::unique_ptr<negotiate_context_t>&
-            negotiate_ctx) const noexcept
+        bool relay_local_datagram(const char* data, const DWORD length, const SOCKADDR_STORAGE& from)
         {
-            using namespace std::string_literals;
-
-            socks5_ident_req<2> ident_req{};
-            socks5_ident_resp ident_resp{};
-            socks5_req<address_type_t> associate_req;
-            socks5_resp<address_type_t> associate_resp;
-
-            auto socks5_ident_req_size = sizeof(ident_req);
-
-            ident_req.methods[0] = 0x0; // RFC 1928: X'00' NO AUTHENTICATION REQUIRED
-            ident_req.methods[1] = 0x2; // RFC 1928: X'02' USERNAME/PASSWORD
-
-            // Don't suggest username/password option if not provided
-            if (!negotiate_ctx->socks5_username.has_value())
+            if (false == connect_to_remote_host(&server_io_context_, from))
             {
-                ident_req.number_of_methods = 1;
-                socks5_ident_req_size = sizeof(socks5_ident_req<1>);
+                return false;
             }
 
-            auto result = send(socks_tcp_socket, reinterpret_cast<const char*>(&ident_req),
-                static_cast<int>(socks5_ident_req_size), 0);
-            if (result == SOCKET_ERROR)
-            {
-                NETLIB_INFO(
-                    "[SOCKS5]: associate_to_socks5_proxy: Failed to send socks5_ident_req: {}",
-                    WSAGetLastError());
-                return {};
-            }
+            server_io_context_.wsa_buf = packet_pool_->allocate(length);
 
-            result = recv(socks_tcp_socket, reinterpret_cast<char*>(&ident_resp), sizeof(ident_resp), 0);
-            if (result == SOCKET_ERROR)
+            if (!server_io_context_.wsa_buf)
             {
-                NETLIB_INFO(
-                    "[SOCKS5]: associate_to_socks5_proxy: Failed to receive socks5_ident_resp: {}",
-                    WSAGetLastError());
-                return {};
+                return false;
             }
 
-            if ((ident_resp.version != 5) ||
-                (ident_resp.method == 0xFF))
-            {
-                NETLIB_INFO(
-                    "[SOCKS5]: associate_to_socks5_proxy: SOCKS5 authentication has failed");
-                return {};
-            }
+            server_io_context_.wsa_buf->len = length;
+            memmove(server_io_context_.wsa_buf->buf, data, length);
 
-            if (ident_resp.method == 0x2)
-            {
-                if (!negotiate_ctx->socks5_username.has_value())
-                {
-                    NETLIB_INFO(
-                        "[SOCKS5]: associate_to_socks5_proxy: RFC 1928: X'02' USERNAME/PASSWORD is chosen but USERNAME is not provided");
-                    return {};
-                }
+            server_io_context_.proxy_socket_ptr->process_receive_buffer_complete(length, &server_io_context_);
+            return true;
+        }
 
-                if (negotiate_ctx->socks5_username.value().length() > socks5_username_max_length || 
-                    negotiate_ctx->socks5_username.value().length() < 1)
-                {
-                    NETLIB_INFO(
-                        "[SOCKS5]: associate_to_socks5_proxy: RFC 1928: X'02' USERNAME/PASSWORD is chosen but USERNAME exceeds maximum possible length");
-                    return {};
-                }
+        /**
+         * @brief Loads the ConnectEx extension function used to connect the SOCKS5 control sockets.
+         *
+         * @return True if the function was loaded, false otherwise.
+         */
+        bool load_connect_ex()
+        {
+            const auto probe_socket = WSASocket(address_type_t::af_type, SOCK_STREAM, IPPROTO_TCP, nullptr, 0,
+                WSA_FLAG_OVERLAPPED);
 
-                if (!negotiate_ctx->socks5_password.has_value())
-                {
-                    NETLIB_INFO(
-                        "[SOCKS5]: associate_to_socks5_proxy: RFC 1928: X'02' USERNAME/PASSWORD is chosen but PASSWORD is not provided");
-                    return {};
-                }
+            if (probe_socket == INVALID_SOCKET)
+            {
+                return false;
+            }
 
-                if (negotiate_ctx->socks5_password.value().length() > socks5_username_max_length || 
-                    negotiate_ctx->socks5_password.value().length() < 1)
-                {
-                    NETLIB_INFO(
-                        "[SOCKS5]: associate_to_socks5_proxy: RFC 1928: X'02' USERNAME/PASSWORD is chosen but PASSWORD exceeds maximum possible length");
-                    return {};
-                }
+            GUID id = WSAID_CONNECTEX;
+            DWORD bytes = 0;
 
-                const socks5_username_auth auth_req(
-                    negotiate_ctx->socks5_username.value(),
-                    negotiate_ctx->socks5_password.value()
-                );
+            const auto status = WSAIoctl(probe_socket, SIO_GET_EXTENSION_FUNCTION_POINTER, &id, sizeof(id), &connect_ex_,
+                sizeof(connect_ex_), &bytes, nullptr, nullptr);
 
-                result = send(socks_tcp_socket, reinterpret_cast<const char*>(&auth_req),
-                    3 + static_cast<int>(negotiate_ctx->socks5_username.value().length()) + 
-                    static_cast<int>(negotiate_ctx->socks5_password.value().length()), 0);
-                if (result == SOCKET_ERROR)
-                {
-                    NETLIB_INFO(
-                        "[SOCKS5]: associate_to_socks5_proxy: Failed to send socks5_username_auth: {}",
-                        WSAGetLastError());
-                    return {};
-                }
+            closesocket(probe_socket);
 
-                result = recv(socks_tcp_socket, reinterpret_cast<char*>(&ident_resp), sizeof(ident_resp), 0);
-                if (result == SOCKET_ERROR)
-                {
-                    NETLIB_INFO(
-                        "[SOCKS5]: associate_to_socks5_proxy: Failed to receive socks5_ident_resp: {}",
-                        WSAGetLastError());
-                    return {};
-                }
+            if (status == SOCKET_ERROR)
+            {
+                NETLIB_ERROR("load_connect_ex: WSAIoctl failed: {}", WSAGetLastError());
+                return false;
+            }
 
-                if (ident_resp.method != 0x0)
-                {
-                    NETLIB_INFO(
-                        "[SOCKS5]: associate_to_socks5_proxy: USERNAME/PASSWORD authentication has failed!");
-                    return {};
-                }
+            return true;
+        }
+
+        /**
+         * @brief Creates a socket bound to an ephemeral local port and any local address.
+         *
+         * The socket is created in overlapped mode (IPv4 or IPv6 depending on address_type_t::af_type),
+         * as required by ConnectEx for the SOCKS5 control connection and by the relay I/O.
+         *
+         * @param type     Socket type (SOCK_STREAM or SOCK_DGRAM).
+         * @param protocol Socket protocol (IPPROTO_TCP or IPPROTO_UDP).
+         * @return A bound SOCKET handle, or INVALID_SOCKET on failure.
+         */
+        static SOCKET create_bound_socket(const int type, const int protocol)
+        {
+            auto bound_socket = WSASocket(address_type_t::af_type, type, protocol, nullptr, 0, WSA_FLAG_OVERLAPPED);
 
-                NETLIB_INFO(
-                    "[SOCKS5]: associate_to_socks5_proxy: USERNAME/PASSWORD authentication SUCCESS");
+            if (bound_socket == INVALID_SOCKET)
+            {
+                return INVALID_SOCKET;
             }
 
-            associate_req.version = 5;
-            associate_req.cmd = 3;
-            associate_req.reserved = 0;
+            auto status = SOCKET_ERROR;
+
             if constexpr (address_type_t::af_type == AF_INET)
             {
-                associate_req.address_type = 1;
+                sockaddr_in sa_local{};
+                sa_local.sin_family = address_type_t::af_type;
+                sa_local.sin_port = htons(0);
+                sa_local.sin_addr.s_addr = htonl(INADDR_ANY);
+
+                status = bind(bound_socket, reinterpret_cast<sockaddr*>(&sa_local), sizeof(sa_local));
             }
             else
             {
-                associate_req.address_type = 4;
-            }
-            associate_req.dest_address = address_type_t{};
-            associate_req.dest_port = 0;
-            result = send(socks_tcp_socket, reinterpret_cast<const char*>(&associate_req), sizeof(associate_req), 0);
-            if (result == SOCKET_ERROR)
-            {
-                NETLIB_INFO(
-                    "[SOCKS5]: associate_to_socks5_proxy: Failed to send SOCKS5 ASSOCIATE request: {}",
-                    WSAGetLastError());
-                return {};
-            }
+                sockaddr_in6 sa_local{};
+                sa_local.sin6_family = address_type_t::af_type;
+                sa_local.sin6_port = htons(0);
+                sa_local.sin6_addr = in6addr_any;
 
-            result = recv(socks_tcp_socket, reinterpret_cast<char*>(&associate_resp), sizeof(associate_resp), 0);
-            if (result == SOCKET_ERROR)
-            {
-                NETLIB_INFO(
-                    "[SOCKS5]: associate_to_socks5_proxy: Failed to receive SOCKS5 ASSOCIATE response: {}",
-                    WSAGetLastError());
-                return {};
+                // The proxy may be an IPv4 one given by its IPv4-mapped address
+                enable_dual_stack(bound_socket);
+
+                status = bind(bound_socket, reinterpret_cast<sockaddr*>(&sa_local), sizeof(sa_local));
             }
 
-            if ((associate_resp.version != 5) ||
-                (associate_resp.reply != 0))
+            if (status == SOCKET_ERROR)
             {
-                NETLIB_INFO(
-                    "[SOCKS5]: associate_to_socks5_proxy: SOCKS5 ASSOCIATE has failed");
-                return {};
+                closesocket(bound_socket);
+                return INVALID_SOCKET;
             }
 
-            NETLIB_INFO(
-                "[SOCKS5]: associate_to_socks5_proxy: SOCKS5 ASSOCIATE SUCCESS port: {}",
-                ntohs(associate_resp.bind_port));
-
-            return ntohs(associate_resp.bind_port);
+            return bound_socket;
         }
 
         /**
          * @brief Establishes a UDP relay session to a remote host through a SOCKS5 proxy.
          *
          * This method is responsible for setting up a UDP relay for a new client connection.
-         * It determines the local peer's address and port from the last received UDP packet,
+         * It determines the local peer's address and port from the source address of the received packet,
          * checks if a proxy socket for this client already exists, and if not:
          *   - Resolves the remote SOCKS5 proxy address, port, and negotiation context.
-         *   - Establishes a TCP connection to the SOCKS5 proxy and performs authentication/negotiation.
-         *   - Issues a UDP ASSOCIATE command to the proxy and retrieves the assigned UDP port.
-         *   - Creates and binds a UDP socket for relaying packets to the proxy.
-         *   - Connects the UDP socket to the proxy and stores the session in the proxy_sockets_ map.
-         *   - Associates the new proxy socket with the I/O completion port and starts it.
+         *   - Claims the SOCKS5 TCP control socket from the connection pool, or creates and binds it, and
+         *     creates the UDP socket for relaying packets.
+         *   - Stores the session in the proxy_sockets_ map, associates its sockets with the I/O
+         *     completion port and starts it.
          *
-         * If any step fails, all resources are cleaned up and the method returns false.
+         * The session connects to the proxy, authenticates and issues the UDP ASSOCIATE command
+         * asynchronously on the completion port threads, buffering the local datagrams until the
+         * proxy has assigned its UDP port. If a step before the session is started fails, all
+         * resources are cleaned up and the method returns false; later failures close the session.
          *
          * @param io_context Pointer to the per-I/O context structure for the current operation.
          *                   On success, its proxy_socket_ptr is set to the active proxy socket.
+         * @param from       Source address of the received packet (the local peer).
          * @return True if the relay session was established or already exists, false on failure.
          */
-        bool connect_to_remote_host(per_io_context_t* io_context)
+        bool connect_to_remote_host(per_io_context_t* io_context, const SOCKADDR_STORAGE& from)
         {
             uint16_t local_peer_port = 0;
             address_type_t local_peer_address{};
 
             if constexpr (address_type_t::af_type == AF_INET)
             {
-                local_peer_port = ntohs(reinterpret_cast<sockaddr_in*>(&recv_from_sa_)->sin_port);
-                local_peer_address = address_type_t(reinterpret_cast<sockaddr_in*>(&recv_from_sa_)->sin_addr);
+                local_peer_port = ntohs(reinterpret_cast<const sockaddr_in*>(&from)->sin_port);
+                local_peer_address = address_type_t(reinterpret_cast<const sockaddr_in*>(&from)->sin_addr);
             }
             else if constexpr (address_type_t::af_type == AF_INET6)
             {
-                local_peer_port = ntohs(reinterpret_cast<sockaddr_in6*>(&recv_from_sa_)->sin6_port);
-                local_peer_address = address_type_t(reinterpret_cast<sockaddr_in6*>(&recv_from_sa_)->sin6_addr);
+                local_peer_port = ntohs(reinterpret_cast<const sockaddr_in6*>(&from)->sin6_port);
+                local_peer_address = address_type_t(reinterpret_cast<const sockaddr_in6*>(&from)->sin6_addr);
             }
             else
             {
@@ -953,128 +989,52 @@ namespace proxy
                 get_remote_peer(local_peer_address, local_peer_port);
 
             NETLIB_DEBUG(
-                "connect_to_remote_host: Connect to SOCKS5 proxy and send ASSOCIATE command: {}:{}",
+                "connect_to_remote_host: Create session through SOCKS5 proxy: {}:{}",
                 remote_address,
                 remote_port);
 
-            auto socks5_tcp_socket = connect_to_socks5_proxy(remote_address, remote_port);
-            if (socks5_tcp_socket == INVALID_SOCKET)
+            // A pooled control socket is already connected and authenticated (claim() doesn't block)
+            auto socks5_tcp_socket = INVALID_SOCKET;
+            if (connection_pool_ && connection_pool_->serves(remote_address, remote_port))
             {
-                NETLIB_DEBUG(
-                    "connect_to_remote_host: Failed to connect to SOCKS5 proxy: {}:{}",
-                    remote_address,
-                    remote_port);
-                return false;
+                socks5_tcp_socket = connection_pool_->claim();
             }
 
-            auto udp_port = associate_to_socks5_proxy(socks5_tcp_socket, negotiate_ctx);
-            if (!udp_port.has_value())
+            const auto pre_authenticated = (socks5_tcp_socket != INVALID_SOCKET);
+
+            // The SOCKS5 negotiation runs on the completion port, nothing blocks while lock_ is held
+            if (!pre_authenticated)
             {
-                NETLIB_DEBUG(
-                    "connect_to_remote_host: ASSOCIATE command has failed: {}:{}",
-                    remote_address,
-                    remote_port);
+                socks5_tcp_socket = create_bound_socket(SOCK_STREAM, IPPROTO_TCP);
+            }
 
-                closesocket(socks5_tcp_socket);
+            if (socks5_tcp_socket == INVALID_SOCKET)
+            {
+                NETLIB_DEBUG(
+                    "connect_to_remote_host: Failed to create SOCKS5 control socket: {}",
+                    WSAGetLastError());
                 return false;
             }
 
-            NETLIB_DEBUG(
-                "connect_to_remote_host: UDP connect: {}:{}",
-                remote_address,
-                udp_port.value());
-
-            auto remote_socket = WSASocket(address_type_t::af_type, SOCK_DGRAM, IPPROTO_UDP, nullptr, 0,
-                WSA_FLAG_OVERLAPPED);
-
+            auto remote_socket = create_bound_socket(SOCK_DGRAM, IPPROTO_UDP);
             if (remote_socket == INVALID_SOCKET)
             {
                 NETLIB_DEBUG(
                     "connect_to_remote_host: Failed to create UDP socket: {}",
                     WSAGetLastError());
+                closesocket(socks5_tcp_socket);
                 return false;
             }
 
-            if constexpr (address_type_t::af_type == AF_INET)
-            {
-                sockaddr_in sa_local{};
-                sa_local.sin_family = address_type_t::af_type;
-                sa_local.sin_port = htons(0);
-                sa_local.sin_addr.s_addr = htonl(INADDR_ANY);
-
-                if (const auto status = bind(remote_socket, reinterpret_cast<sockaddr*>(&sa_local), sizeof(sa_local));
-                    status == SOCKET_ERROR)
-                {
-                    closesocket(remote_socket);
-                    closesocket(socks5_tcp_socket);
-                    NETLIB_DEBUG(
-                        "connect_to_remote_host: Failed to bind UDP socket: {}",
-                        WSAGetLastError());
-                    return false;
-                }
-            }
-            else
-            {
-                sockaddr_in6 sa_local{};
-                sa_local.sin6_family = address_type_t::af_type;
-                sa_local.sin6_port = htons(0);
-                sa_local.sin6_addr = in6addr_any;
-
-                if (const auto status = bind(remote_socket, reinterpret_cast<sockaddr*>(&sa_local), sizeof(sa_local));
-                    status == SOCKET_ERROR)
-                {
-                    closesocket(remote_socket);
-                    closesocket(socks5_tcp_socket);
-                    NETLIB_DEBUG(
-                        "connect_to_remote_host: Failed to bind UDP socket: {}",
-                        WSAGetLastError());
-                    return false;
-                }
-            }
-
-            // connect to server
-            if constexpr (address_type_t::af_type == AF_INET)
-            {
-                sockaddr_in sa_service{};
-                sa_service.sin_family = address_type_t::af_type;
-                sa_service.sin_addr = remote_address;
-                sa_service.sin_port = htons(udp_port.value());
-
-                if (connect(remote_socket, reinterpret_cast<SOCKADDR*>(&sa_service), sizeof(sa_service)) ==
-                    SOCKET_ERROR)
-                {
-                    closesocket(remote_socket);
-                    closesocket(socks5_tcp_socket);
-                    NETLIB_DEBUG(
-                        "connect_to_remote_host: Failed to connect UDP socket: {}",
-                        WSAGetLastError());
-                    return false;
-                }
-            }
-            else
-            {
-                sockaddr_in6 sa_service{};
-                sa_service.sin6_family = address_type_t::af_type;
-                sa_service.sin6_addr = remote_address;
-                sa_service.sin6_port = htons(udp_port.value());
-
-                if (connect(remote_socket, reinterpret_cast<SOCKADDR*>(&sa_service), sizeof(sa_service)) ==
-                    SOCKET_ERROR)
-                {
-                    closesocket(remote_socket);
-                    closesocket(socks5_tcp_socket);
-                    NETLIB_DEBUG(
-                        "connect_to_remote_host: Failed to connect UDP socket: {}",
-                        WSAGetLastError());
-                    return false;
-                }
-            }
+            // Bind the session to one completion port shard for its whole lifetime
+            const auto shard = completion_ports_.next_shard();
 
             auto [it, result] = proxy_sockets_.emplace(local_peer_port,
-                std::make_shared<T>(
-                    socks5_tcp_socket, packet_pool_, server_socket_,
-                    recv_from_sa_, remote_socket, remote_address,
-                    udp_port.value(), std::move(negotiate_ctx),
+                completion_ports_.make_shared<T>(
+                    shard,
+                    socks5_tcp_socket, connect_ex_, packet_pool_, server_socket_,
+                    from, remote_socket, remote_address,
+                    remote_port, std::move(negotiate_ctx),
                     logger::log_level_, logger::log_stream_));
 
             if (result)
@@ -1084,8 +1044,28 @@ namespace proxy
                     // Initialize I/O contexts with shared_ptr
                     it->second->initialize_io_contexts();
 
+                    if (pre_authenticated)
+                    {
+                        it->second->set_pre_authenticated();
+                    }
+
+                    // The session reports its closure instead of being polled
+                    it->second->set_close_handler(
+                        [this, local_peer_port, session = std::weak_ptr<T>(it->second)]
+                        {
+                            queue_removal(local_peer_port, session);
+                        });
+
+                    // Also bounds the time allowed to the association
+                    idle_timers_.schedule(local_peer_port, it->second->idle_deadline());
+
                     // Now safe to associate and start
-                    it->second->associate_to_completion_port(completion_key_, completion_port_);
+                    if (!it->second->associate_to_completion_port(completion_keys_[shard], completion_ports_.port(shard)))
+                    {
+                        throw std::runtime_error("failed to associate the session sockets with the completion port");
+                    }
+
+                    // Starts the SOCKS5 negotiation, datagrams are buffered until the association is established
                     it->second->start();
 
                     // Set the context pointer to the shared_ptr
@@ -1096,10 +1076,11 @@ namespace proxy
                     NETLIB_DEBUG(
                         "connect_to_remote_host: Failed to initialize proxy socket for: {}:{} ({})",
                         remote_address,
-                        udp_port.value(),
+                        remote_port,
                         e.what());
                     // Remove from map - the shared_ptr destructor will close the sockets
                     // that were transferred to T's constructor
+                    idle_timers_.cancel(local_peer_port);
                     proxy_sockets_.erase(it);
                     return false;
                 }
@@ -1108,8 +1089,9 @@ namespace proxy
                     NETLIB_DEBUG(
                         "connect_to_remote_host: Failed to initialize proxy socket for: {}:{} (unknown exception)",
                         remote_address,
-                        udp_port.value());
+                        remote_port);
                     // Remove from map - the shared_ptr destructor will close the sockets
+                    idle_timers_.cancel(local_peer_port);
                     proxy_sockets_.erase(it);
                     return false;
                 }
@@ -1121,7 +1103,7 @@ namespace proxy
                 NETLIB_DEBUG(
                     "connect_to_remote_host: Failed to create proxy socket for: {}:{}",
                     remote_address,
-                    udp_port.value());
+                    remote_port);
                 return false;
             }
 
@@ -1129,38 +1111,115 @@ namespace proxy
         }
 
         /**
-         * @brief Periodically cleans up inactive or closed proxy socket sessions.
+         * @brief Queues a session marked for removal for the cleanup thread.
+         *
+         * Called from the session's close handler.
+         *
+         * @param local_peer_port Local UDP port the session is registered under.
+         * @param session         The closed session.
+         */
+        void queue_removal(const uint16_t local_peer_port, std::weak_ptr<T> session) noexcept
+        {
+            try
+            {
+                std::lock_guard lock(closed_lock_);
+                closed_sessions_.emplace_back(local_peer_port, std::move(session));
+            }
+            catch (const std::bad_alloc&)
+            {
+                // The session is still reaped when its idle timer expires
+                return;
+            }
+
+            closed_signal_.notify_one();
+        }
+
+        /**
+         * @brief Removes the session registered under a local UDP port.
+         *
+         * Must be called with lock_ held.
          *
-         * This thread routine runs in the background while the server is active. It acquires a lock
-         * on the proxy_sockets_ map, iterates through all active proxy socket sessions, and removes
-         * any that are ready for removal (e.g., due to client disconnect or error). The cleanup
-         * operation is performed once per second to minimize resource usage and ensure timely
-         * release of unused sockets.
+         * @param it       Position of the session in proxy_sockets_.
+         * @param released Receives the map's reference, so that the session is destroyed after lock_ is released.
+         */
+        void release_session(const typename std::map<uint16_t, std::shared_ptr<T>>::iterator it,
+                             std::vector<std::shared_ptr<T>>& released)
+        {
+            idle_timers_.cancel(it->first);
+            released.push_back(std::move(it->second));
+            proxy_sockets_.erase(it);
+        }
+
+        /**
+         * @brief Cleans up closed and idle proxy socket sessions.
+         *
+         * This thread routine runs in the background while the server is active. Sessions report
+         * themselves through queue_removal() when they are closed and are removed as soon as the
+         * thread wakes up. Idle sessions are found through a timing wheel instead of a scan: when a
+         * session's idle timer expires, the session is removed if it has been idle for T::idle_timeout
+         * and rescheduled from its last activity otherwise. The cost of a pass is proportional to the
+         * number of sessions closed or expired, and removed sessions are destroyed after lock_ is
+         * released.
          *
          * The thread exits automatically when the server is stopped (end_server_ is set to true).
          */
         void clear_thread()
         {
+            std::vector<std::pair<uint16_t, std::weak_ptr<T>>> closed;
+            std::vector<std::shared_ptr<T>> released;
+
             while (end_server_ == false)
             {
+                {
+                    std::unique_lock lock(closed_lock_);
+                    closed_signal_.wait_for(lock, idle_timer_tick, [this]
+                    {
+                        return !closed_sessions_.empty() || end_server_;
+                    });
+
+                    closed.swap(closed_sessions_);
+                }
+
+                try
                 {
                     std::lock_guard lock(lock_);
 
-                    for (auto it = proxy_sockets_.begin(); it != proxy_sockets_.end();)
+                    for (const auto& [port, weak] : closed)
                     {
+                        // The port may have been reused by a new session in the meantime
+                        if (const auto session = weak.lock())
+                        {
+                            if (const auto it = proxy_sockets_.find(port);
+                                it != proxy_sockets_.end() && it->second == session)
+                            {
+                                release_session(it, released);
+                            }
+                        }
+                    }
+
+                    idle_timers_.advance(std::chrono::steady_clock::now(), [this, &released](const uint16_t port)
+                    {
+                        const auto it = proxy_sockets_.find(port);
+                        if (it == proxy_sockets_.end())
+                            return;
+
                         if (it->second->is_ready_for_removal())
                         {
-                            proxy_sockets_.erase(it++);
+                            release_session(it, released);
                         }
                         else
                         {
-                            ++it;
+                            idle_timers_.schedule(port, it->second->idle_deadline());
                         }
-                    }
+                    });
+                }
+                catch (const std::bad_alloc&)
+                {
+                    NETLIB_ERROR("clear_thread: Out of memory while reaping sessions");
                 }
 
-                using namespace std::chrono_literals;
-                std::this_thread::sleep_for(1000ms);
+                closed.clear();
+                released.clear();
             }
         }
     };
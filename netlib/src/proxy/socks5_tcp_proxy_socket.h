@@ -107,6 +107,18 @@ namespace proxy
             NETLIB_DEBUG("initialize_io_contexts: SOCKS5 negotiation contexts initialized successfully");
         }
 
+        /**
+         * @brief Marks the remote socket as already negotiated and authenticated with the proxy.
+         *
+         * Used for connections claimed from a socks5_connection_pool: remote_negotiate() then sends
+         * the CONNECT command right away instead of starting with the identification request.
+         * Must be called before start().
+         */
+        void set_pre_authenticated() noexcept
+        {
+            pre_authenticated_ = true;
+        }
+
         /**
          * @brief Handles completion of a SOCKS5 negotiation receive operation.
          *
@@ -119,9 +131,10 @@ namespace proxy
          *   - If username/password authentication is required, validates credentials and sends the authentication request.
          *   - If no authentication is required, sends the CONNECT command to the proxy.
          * - On receiving the authentication response (password_sent state), checks for success and sends the CONNECT command.
-         * - On receiving the CONNECT response (connect_sent state), checks for success and starts data relay if successful.
+         * - On receiving the CONNECT response (connect_sent state), reads it up to the length of its bound address,
+         *   checks for success and starts data relay if successful.
          *
-         * @param io_size Number of bytes received (unused in this implementation).
+         * @param io_size Number of bytes received.
          * @param io_context Pointer to the per-I/O context structure for the operation.
          */
         void process_receive_negotiate_complete(const uint32_t io_size, per_io_context_t* io_context) override
@@ -201,44 +214,7 @@ namespace proxy
                         }
                         else // NO AUTHENTICATION REQUIRED is chosen
                         {
-                            connect_request_.cmd = 1;
-                            connect_request_.reserved = 0;
-                            connect_request_.address_type = 1;
-                            connect_request_.dest_address = tcp_proxy_socket<T>::negotiate_ctx_->remote_address;
-                            connect_request_.dest_port = htons(tcp_proxy_socket<T>::negotiate_ctx_->remote_port);
-
-                            io_context_send_negotiate_.wsa_buf.buf = reinterpret_cast<char*>(&connect_request_);
-                            io_context_send_negotiate_.wsa_buf.len = sizeof(socks5_req<T>);
-                            io_context_recv_negotiate_.wsa_buf.buf = reinterpret_cast<char*>(&connect_response_);
-                            io_context_recv_negotiate_.wsa_buf.len = sizeof(socks5_resp<T>);
-
-                            DWORD flags = 0;
-
-                            if ((::WSASend(
-                                tcp_proxy_socket<T>::remote_socket_,
-                                &io_context_send_negotiate_.wsa_buf,
-                                1,
-                                nullptr,
-                                0,
-                                &io_context_send_negotiate_,
-                                nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
-                            {
-                                tcp_proxy_socket<T>::close_client(false, false);
-                            }
-
-                            current_state_ = socks5_state::connect_sent;
-
-                            if ((::WSARecv(
-                                tcp_proxy_socket<T>::remote_socket_,
-                                &io_context_recv_negotiate_.wsa_buf,
-                                1,
-                                nullptr,
-                                &flags,
-                                &io_context_recv_negotiate_,
-                                nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
-                            {
-                                tcp_proxy_socket<T>::close_client(true, false);
-                            }
+                            send_connect_request();
                         }
                     }
                 }
@@ -253,62 +229,33 @@ namespace proxy
                     }
                     else
                     {
-                        connect_request_.cmd = 1;
-                        connect_request_.reserved = 0;
-                        if constexpr (address_type_t::af_type == AF_INET)
-                        {
-                            connect_request_.address_type = 1; // IPv4
-                        }
-                        else
-                        {
-                            connect_request_.address_type = 4; // IPv6
-                        }
-                        connect_request_.dest_address = tcp_proxy_socket<T>::negotiate_ctx_->remote_address;
-                        connect_request_.dest_port = htons(tcp_proxy_socket<T>::negotiate_ctx_->remote_port);
-
-                        io_context_send_negotiate_.wsa_buf.buf = reinterpret_cast<char*>(&connect_request_);
-                        io_context_send_negotiate_.wsa_buf.len = sizeof(socks5_req<T>);
-                        io_context_recv_negotiate_.wsa_buf.buf = reinterpret_cast<char*>(&connect_response_);
-                        io_context_recv_negotiate_.wsa_buf.len = sizeof(socks5_resp<T>);
-
-                        DWORD flags = 0;
-
-                        if ((::WSASend(
-                            tcp_proxy_socket<T>::remote_socket_,
-                            &io_context_send_negotiate_.wsa_buf,
-                            1,
-                            nullptr,
-                            0,
-                            &io_context_send_negotiate_,
-                            nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
-                        {
-                            tcp_proxy_socket<T>::close_client(false, false);
-                        }
-
-                        current_state_ = socks5_state::connect_sent;
-
-                        if ((::WSARecv(
-                            tcp_proxy_socket<T>::remote_socket_,
-                            &io_context_recv_negotiate_.wsa_buf,
-                            1,
-                            nullptr,
-                            &flags,
-                            &io_context_recv_negotiate_,
-                            nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
-                        {
-                            tcp_proxy_socket<T>::close_client(true, false);
-                        }
+                        send_connect_request();
                     }
                 }
                 else if (current_state_ == socks5_state::connect_sent)
                 {
-                    if (connect_response_.reply != 0)
+                    connect_reply_received_ += io_size;
+
+                    // The bound address type of the reply need not match the requested one
+                    const auto reply_length = connect_reply_received_ < 4
+                        ? connect_reply_min_length
+                        : connect_reply_length();
+
+                    if ((connect_reply_received_ >= 2 && connect_reply_[1] != 0) || reply_length == 0)
                     {
-                        // SOCKS v5 connect failed
+                        // SOCKS v5 connect failed or the bound address type is not supported
                         tcp_proxy_socket<T>::close_client(true, false);
                     }
+                    else if (connect_reply_received_ < reply_length)
+                    {
+                        // Read the rest of the reply, none of it may be relayed to the client
+                        receive_connect_reply(reply_length);
+                    }
                     else
                     {
+                        if (const auto& metrics = tcp_proxy_socket<T>::negotiate_ctx_->metrics; metrics)
+                            metrics->handshake_time.record(std::chrono::steady_clock::now() - negotiate_started_);
+
                         tcp_proxy_socket<T>::start_data_relay();
                     }
                 }
@@ -325,8 +272,11 @@ namespace proxy
          * - ident_req_: Buffer for the SOCKS5 identification request (supports up to 2 methods).
          * - ident_resp_: Buffer for the SOCKS5 identification response from the proxy.
          * - connect_request_: Buffer for the SOCKS5 CONNECT command request.
-         * - connect_response_: Buffer for the SOCKS5 CONNECT command response.
+         * - connect_reply_: Buffer for the SOCKS5 CONNECT command reply, long enough for an IPv6 bound address.
+         * - connect_reply_received_: Bytes of the CONNECT reply received so far.
          * - username_auth_: Buffer for username/password authentication as per RFC 1929.
+         * - pre_authenticated_: True if the remote socket was claimed from a socks5_connection_pool.
+         * - negotiate_started_: Start of the negotiation, for the handshake time metric.
          *
          * These members are used to manage the asynchronous negotiation and authentication
          * sequence with the SOCKS5 proxy server, including method selection, credential exchange,
@@ -339,8 +289,100 @@ namespace proxy
         socks5_ident_req<2> ident_req_{};
         socks5_ident_resp ident_resp_{};
         socks5_req<address_type_t> connect_request_;
-        socks5_resp<address_type_t> connect_response_;
+        std::array<unsigned char, 4 + 16 + 2> connect_reply_{};
+        ULONG connect_reply_received_{ 0 };
         socks5_username_auth username_auth_{};
+        bool pre_authenticated_{ false };
+        std::chrono::steady_clock::time_point negotiate_started_{};
+
+        /**
+         * @brief Length of a CONNECT reply with an IPv4 bound address, the shortest one supported.
+         */
+        static constexpr ULONG connect_reply_min_length = 4 + 4 + 2;
+
+        /**
+         * @brief Returns the full length of the CONNECT reply from its header, or 0 for an
+         * unsupported bound address type.
+         */
+        [[nodiscard]] ULONG connect_reply_length() const noexcept
+        {
+            switch (connect_reply_[3])
+            {
+            case 1: return 4 + 4 + 2;   // IPv4
+            case 4: return 4 + 16 + 2;  // IPv6
+            default: return 0;
+            }
+        }
+
+        /**
+         * @brief Posts the receive of the CONNECT reply bytes still missing up to reply_length.
+         *
+         * Closes the client connection if the operation cannot be issued.
+         *
+         * @param reply_length Length of the reply received so far plus the bytes to receive.
+         */
+        void receive_connect_reply(const ULONG reply_length)
+        {
+            io_context_recv_negotiate_.wsa_buf.buf = reinterpret_cast<char*>(connect_reply_.data() + connect_reply_received_);
+            io_context_recv_negotiate_.wsa_buf.len = reply_length - connect_reply_received_;
+
+            DWORD flags = 0;
+
+            if ((::WSARecv(
+                tcp_proxy_socket<T>::remote_socket_,
+                &io_context_recv_negotiate_.wsa_buf,
+                1,
+                nullptr,
+                &flags,
+                &io_context_recv_negotiate_,
+                nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
+            {
+                tcp_proxy_socket<T>::close_client(true, false);
+            }
+        }
+
+        /**
+         * @brief Sends the SOCKS5 CONNECT command for the target address and posts the receive of its reply.
+         *
+         * Closes the client connection if either operation cannot be issued.
+         */
+        void send_connect_request()
+        {
+            connect_request_.cmd = 1;
+            connect_request_.reserved = 0;
+            if constexpr (address_type_t::af_type == AF_INET)
+            {
+                connect_request_.address_type = 1; // IPv4
+            }
+            else
+            {
+                connect_request_.address_type = 4; // IPv6
+            }
+            connect_request_.dest_address = tcp_proxy_socket<T>::negotiate_ctx_->remote_address;
+            connect_request_.dest_port = htons(tcp_proxy_socket<T>::negotiate_ctx_->remote_port);
+
+            io_context_send_negotiate_.wsa_buf.buf = reinterpret_cast<char*>(&connect_request_);
+            io_context_send_negotiate_.wsa_buf.len = sizeof(socks5_req<T>);
+
+            if ((::WSASend(
+                tcp_proxy_socket<T>::remote_socket_,
+                &io_context_send_negotiate_.wsa_buf,
+                1,
+                nullptr,
+                0,
+                &io_context_send_negotiate_,
+                nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
+            {
+                tcp_proxy_socket<T>::close_client(false, false);
+                return;
+            }
+
+            current_state_ = socks5_state::connect_sent;
+
+            // The reply is first received up to the length of one with an IPv4 bound address
+            connect_reply_received_ = 0;
+            receive_connect_reply(connect_reply_min_length);
+        }
 
     protected:
         /**
@@ -363,6 +405,7 @@ namespace proxy
          * This method starts the SOCKS5 handshake by sending an identification request to the remote proxy.
          * If username/password credentials are provided in the negotiation context, the request will include
          * the USERNAME/PASSWORD method; otherwise, only "NO AUTHENTICATION REQUIRED" is offered.
+         * A pre-authenticated connection (see set_pre_authenticated()) starts with the CONNECT command.
          * The method sets up the necessary buffers and asynchronous send/receive operations for the handshake.
          *
          * @return False if negotiation is in progress, true if negotiation is already complete or not required.
@@ -371,7 +414,14 @@ namespace proxy
         {
             if (tcp_proxy_socket<T>::negotiate_ctx_)
             {
-                if (current_state_ == socks5_state::pre_login)
+                negotiate_started_ = std::chrono::steady_clock::now();
+
+                if (current_state_ == socks5_state::pre_login && pre_authenticated_)
+                {
+                    NETLIB_DEBUG("SOCKS5 connection is pre-authenticated, sending CONNECT");
+                    send_connect_request();
+                }
+                else if (current_state_ == socks5_state::pre_login)
                 {
                     NETLIB_DEBUG("Starting SOCKS5 negotiation with remote proxy");
 
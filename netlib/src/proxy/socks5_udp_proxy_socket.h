@@ -111,6 +111,29 @@ namespace proxy
     class socks5_udp_proxy_socket final : public netlib::log::logger<socks5_udp_proxy_socket<T>>,  // NOLINT(clang-diagnostic-padded)
         public std::enable_shared_from_this<socks5_udp_proxy_socket<T>>
     {
+        /**
+        * @enum socks5_state
+        * @brief Internal state machine for the SOCKS5 UDP ASSOCIATE negotiation.
+        *
+        * - pre_login: Initial state before negotiation begins.
+        * - connecting: Control connection to the proxy in progress.
+        * - login_sent: Identification request sent to the proxy.
+        * - password_sent: Username/password authentication sent.
+        * - associate_sent: UDP ASSOCIATE command sent to the proxy.
+        * - associated: UDP relay port assigned, datagrams are relayed.
+        * - failed: Negotiation failed, the session is closed.
+        */
+        enum class socks5_state : uint8_t
+        {
+            pre_login,
+            connecting,
+            login_sent,
+            password_sent,
+            associate_sent,
+            associated,
+            failed
+        };
+
     public:
         /**
          * @brief Size of the send/receive buffer for UDP packets (64 KiB).
@@ -119,6 +142,21 @@ namespace proxy
          */
         constexpr static size_t send_receive_buffer_size = 256ull * 256ull;
 
+        /**
+         * @brief Inactivity period after which the session is removed.
+         */
+        constexpr static std::chrono::minutes idle_timeout{ 5 };
+
+        /**
+         * @brief Time allowed to the SOCKS5 proxy to complete the UDP association.
+         */
+        constexpr static std::chrono::seconds associate_timeout{ 5 };
+
+        /**
+         * @brief Maximum number of local datagrams buffered while the association is negotiated.
+         */
+        constexpr static size_t max_pending_datagrams = 64;
+
         /**
          * @brief Type aliases for logging, address, negotiation context, and per-I/O context.
          *
@@ -146,6 +184,11 @@ namespace proxy
         /// </summary>
         SOCKET socks_socket_;
 
+        /// <summary>
+        /// ConnectEx extension function used to connect socks_socket_ to the proxy server.
+        /// </summary>
+        LPFN_CONNECTEX connect_ex_;
+
         /// <summary>
         /// Shared pointer to the packet pool for efficient allocation and reuse of network packet buffers.
         /// </summary>
@@ -171,6 +214,11 @@ namespace proxy
         /// </summary>
         std::unique_ptr<negotiate_context_t> negotiate_ctx_;
 
+        /// <summary>
+        /// Time start() was called, the association handshake time is measured from it.
+        /// </summary>
+        std::chrono::steady_clock::time_point negotiate_started_{};
+
         /// <summary>
         /// Buffer for receiving data from the remote UDP socket (SOCKS5 proxy).
         /// </summary>
@@ -195,7 +243,8 @@ namespace proxy
         address_type_t remote_peer_address_;
 
         /// <summary>
-        /// Remote peer's UDP port number as assigned by the SOCKS5 proxy.
+        /// TCP port of the SOCKS5 proxy until the association is established, then the UDP port
+        /// number assigned by the SOCKS5 proxy.
         /// </summary>
         uint16_t remote_peer_port_;
 
@@ -204,6 +253,60 @@ namespace proxy
         /// </summary>
         std::atomic_bool ready_for_removal_{ false };
 
+        /// <summary>
+        /// Called once when the session is marked for removal, lets the owner reap it without polling.
+        /// </summary>
+        std::function<void()> close_handler_;
+
+        /// <summary>
+        /// Per-I/O contexts of the overlapped connect and the negotiation exchange on socks_socket_.
+        /// Initialized with nullptr, set later via initialize_io_contexts().
+        /// </summary>
+        per_io_context_t io_context_connect_{ proxy_io_operation::connect_io, nullptr, false };
+        per_io_context_t io_context_send_negotiate_{ proxy_io_operation::negotiate_io_write, nullptr, false };
+        per_io_context_t io_context_recv_negotiate_{ proxy_io_operation::negotiate_io_read, nullptr, false };
+
+        /// <summary>
+        /// Request being sent and remaining part of the response being received on socks_socket_.
+        /// </summary>
+        WSABUF negotiate_send_buf_{};
+        WSABUF negotiate_recv_buf_{};
+
+        /// <summary>
+        /// Number of bytes of the current response received so far.
+        /// </summary>
+        ULONG negotiate_received_{ 0 };
+
+        /// <summary>
+        /// Current state of the SOCKS5 negotiation.
+        /// </summary>
+        socks5_state state_{ socks5_state::pre_login };
+
+        /// <summary>
+        /// True if socks_socket_ was claimed from a socks5_connection_pool (already connected and authenticated).
+        /// </summary>
+        bool pre_authenticated_{ false };
+
+        /// <summary>
+        /// Time by which the association must be established.
+        /// </summary>
+        std::chrono::steady_clock::time_point associate_deadline_;
+
+        /// <summary>
+        /// Buffers of the SOCKS5 negotiation messages. The ASSOCIATE reply is kept raw, as the
+        /// proxy may report a relay address of either family.
+        /// </summary>
+        socks5_ident_req<2> ident_req_{};
+        socks5_ident_resp ident_resp_{};
+        socks5_username_auth username_auth_{};
+        socks5_req<address_type_t> associate_req_;
+        std::array<unsigned char, 4 + 16 + 2> associate_resp_{};
+
+        /// <summary>
+        /// Datagrams received from the local client while the association is negotiated.
+        /// </summary>
+        std::vector<std::unique_ptr<net_packet_t>> pending_datagrams_;
+
     public:
         /**
          * @brief Constructs a SOCKS5 UDP proxy socket instance.
@@ -212,18 +315,20 @@ namespace proxy
          * Sets up the local and remote sockets, packet pool, addressing, negotiation context,
          * and logging configuration. The timestamp is initialized to the current time.
          *
-         * @param socks_socket      SOCKS5 TCP control connection socket (for UDP association).
+         * @param socks_socket      Bound, not yet connected SOCKS5 TCP control connection socket (for UDP association).
+         * @param connect_ex        ConnectEx extension function of the control socket's provider.
          * @param packet_pool       Shared pointer to the packet pool for buffer management.
          * @param local_socket      Local UDP socket for client communication.
          * @param local_address_sa  Local socket's destination address for outgoing packets.
-         * @param remote_socket     Remote UDP socket for communication with the SOCKS5 proxy.
-         * @param remote_address    Remote peer address (IPv4 or IPv6) assigned by the proxy.
-         * @param remote_port       Remote peer UDP port assigned by the proxy.
+         * @param remote_socket     Bound, not yet connected remote UDP socket for communication with the SOCKS5 proxy.
+         * @param remote_address    SOCKS5 proxy address (IPv4 or IPv6).
+         * @param remote_port       SOCKS5 proxy TCP port.
          * @param negotiate_ctx     Unique pointer to the negotiation context (auth/session info).
          * @param log_level         Logging level for this socket (default: error).
          * @param log_stream        Optional output stream for logging (default: std::nullopt).
          */
-        socks5_udp_proxy_socket(const SOCKET socks_socket, const std::shared_ptr<packet_pool>& packet_pool, const SOCKET& local_socket,
+        socks5_udp_proxy_socket(const SOCKET socks_socket, const LPFN_CONNECTEX connect_ex,
+            const std::shared_ptr<packet_pool>& packet_pool, const SOCKET& local_socket,
             const SOCKADDR_STORAGE& local_address_sa, const SOCKET remote_socket,
             address_type_t remote_address, const uint16_t remote_port,
             std::unique_ptr<negotiate_context_t> negotiate_ctx,
@@ -232,13 +337,15 @@ namespace proxy
             : logger(log_level, std::move(log_stream)),
             timestamp_{ std::chrono::steady_clock::now() },
             socks_socket_(socks_socket),
+            connect_ex_(connect_ex),
             packet_pool_(packet_pool),
             local_socket_(local_socket),
             remote_socket_(remote_socket),
             local_address_sa_(local_address_sa),
             negotiate_ctx_(std::move(negotiate_ctx)),
             remote_peer_address_(remote_address),
-            remote_peer_port_(remote_port)
+            remote_peer_port_(remote_port),
+            associate_deadline_{ timestamp_ + associate_timeout }
         {
         }
 
@@ -252,6 +359,9 @@ namespace proxy
         {
             auto self = this->shared_from_this();
             io_context_recv_from_remote_.proxy_socket_ptr = self;
+            io_context_connect_.proxy_socket_ptr = self;
+            io_context_send_negotiate_.proxy_socket_ptr = self;
+            io_context_recv_negotiate_.proxy_socket_ptr = self;
         }
 
         /**
@@ -264,6 +374,8 @@ namespace proxy
          */
         ~socks5_udp_proxy_socket()
         {
+            discard_pending_datagrams();
+
             if (remote_socket_ != static_cast<SOCKET>(INVALID_SOCKET))
             {
                 // Cancel all pending I/O operations on the remote socket before closing
@@ -348,49 +460,96 @@ namespace proxy
         }
 
         /**
-         * @brief Associates the remote socket with an I/O completion port.
+         * @brief Associates the remote socket and the SOCKS5 control socket with an I/O completion port.
          *
-         * @param completion_key The completion key to associate with the socket.
+         * @param completion_key The completion key to associate with the sockets.
          * @param completion_port Reference to the I/O completion port.
-         * @return True if the association succeeded, false otherwise.
+         * @return True if both associations succeeded, false otherwise.
          */
         bool associate_to_completion_port(const ULONG_PTR completion_key,
             const netlib::winsys::io_completion_port& completion_port) const
         {
-            if (remote_socket_ != static_cast<SOCKET>(INVALID_SOCKET))
-                return completion_port.associate_socket(remote_socket_, completion_key);
+            if (remote_socket_ == static_cast<SOCKET>(INVALID_SOCKET) ||
+                socks_socket_ == static_cast<SOCKET>(INVALID_SOCKET))
+                return false;
 
-            return false;
+            return completion_port.associate_socket(remote_socket_, completion_key) &&
+                completion_port.associate_socket(socks_socket_, completion_key);
         }
 
         /**
          * @brief Marks the proxy socket as ready for removal and cleanup.
          *
          * This is typically called when a connection is closed or an error occurs.
+         * Datagrams still waiting for the association are released.
          */
         void close_client()
         {
-            ready_for_removal_.store(true);
+            if (ready_for_removal_.exchange(true))
+                return;
+
+            discard_pending_datagrams();
+
+            if (close_handler_)
+                close_handler_();
+        }
+
+        /**
+         * @brief Sets the handler called once the session is marked for removal by close_client().
+         *
+         * Must be set before the session is started.
+         *
+         * @param handler Notification handler.
+         */
+        void set_close_handler(std::function<void()> handler)
+        {
+            close_handler_ = std::move(handler);
         }
 
         /**
          * @brief Checks if the proxy socket is ready to be removed.
          *
          * The socket is considered ready for removal if it has been marked as such,
-         * or if no packets have been processed for more than 5 minutes.
+         * if the association was not established within associate_timeout,
+         * or if no packets have been processed for more than idle_timeout.
          *
          * @return True if the socket should be removed, false otherwise.
          */
         bool is_ready_for_removal() const
         {
-            using namespace std::chrono_literals;
+            const auto now = std::chrono::steady_clock::now();
 
-            if (ready_for_removal_.load() || (std::chrono::steady_clock::now() - timestamp_ > 5min))
+            if (ready_for_removal_.load() ||
+                (state_ != socks5_state::associated && now > associate_deadline_) ||
+                (now - timestamp_ > idle_timeout))
                 return true;
 
             return false;
         }
 
+        /**
+         * @brief Returns the time at which the session becomes idle for longer than idle_timeout
+         * (or the association deadline if it comes first and the association is not established yet).
+         */
+        [[nodiscard]] std::chrono::steady_clock::time_point idle_deadline() const
+        {
+            if (state_ != socks5_state::associated)
+                return std::min(associate_deadline_, timestamp_ + idle_timeout);
+
+            return timestamp_ + idle_timeout;
+        }
+
+        /**
+         * @brief Marks the control socket as already connected to and authenticated with the proxy.
+         *
+         * Used for connections claimed from a socks5_connection_pool: remote_negotiate() then sends
+         * the UDP ASSOCIATE command right away. Must be called before start().
+         */
+        void set_pre_authenticated() noexcept
+        {
+            pre_authenticated_ = true;
+        }
+
         /**
          * @brief Starts the SOCKS5 UDP proxy session, including negotiation and data relay.
          *
@@ -403,6 +562,8 @@ namespace proxy
          */
         bool start()
         {
+            negotiate_started_ = std::chrono::steady_clock::now();
+
             if (local_negotiate() && (remote_negotiate()))
             {
                 // if negotiate phase can be complete immediately (or not needed at all)
@@ -416,23 +577,144 @@ namespace proxy
         }
 
         /**
-         * @brief Handler for completion of a receive operation during negotiation.
+         * @brief Handles completion of the overlapped connect to the SOCKS5 proxy.
          *
-         * This static method is intended to be overridden in derived classes to handle
-         * protocol-specific negotiation steps when a receive operation completes.
+         * Sends the identification request, offering USERNAME/PASSWORD authentication only if
+         * credentials are provided in the negotiation context.
+         *
+         * @param io_context Pointer to the per-I/O context structure for the operation.
+         */
+        void process_connect_complete([[maybe_unused]] per_io_context_t* io_context)
+        {
+            if (state_ != socks5_state::connecting)
+                return;
+
+            if (setsockopt(socks_socket_, SOL_SOCKET, SO_UPDATE_CONNECT_CONTEXT, nullptr, 0) == SOCKET_ERROR)
+            {
+                NETLIB_WARNING("process_connect_complete: Failed to update the SOCKS5 control socket: {} for {}:{}",
+                    WSAGetLastError(), remote_peer_address_, remote_peer_port_);
+                fail_association();
+                return;
+            }
+
+            NETLIB_DEBUG("process_connect_complete: Connected to SOCKS5 proxy {}:{}",
+                remote_peer_address_, remote_peer_port_);
+
+            auto socks5_ident_req_size = sizeof(ident_req_);
+
+            ident_req_.methods[0] = 0x0; // RFC 1928: X'00' NO AUTHENTICATION REQUIRED
+            ident_req_.methods[1] = 0x2; // RFC 1928: X'02' USERNAME/PASSWORD
+
+            // Don't suggest username/password option if not provided
+            if (!negotiate_ctx_ || !negotiate_ctx_->socks5_username.has_value())
+            {
+                ident_req_.number_of_methods = 1;
+                socks5_ident_req_size = sizeof(socks5_ident_req<1>);
+            }
+
+            post_negotiate(&ident_req_, static_cast<ULONG>(socks5_ident_req_size),
+                &ident_resp_, sizeof(ident_resp_), socks5_state::login_sent);
+        }
+
+        /**
+         * @brief Handles completion of a receive operation during negotiation.
+         *
+         * Advances the SOCKS5 state machine once a complete response has been received:
+         * - identification response: sends the username/password authentication if chosen by the proxy,
+         *   the UDP ASSOCIATE command otherwise;
+         * - authentication response: sends the UDP ASSOCIATE command;
+         * - ASSOCIATE response: connects the remote socket to the assigned UDP port, starts the data
+         *   relay and forwards the datagrams buffered meanwhile.
+         *
+         * If any step fails, the session is closed.
          *
          * @param io_size   Number of bytes received.
          * @param io_context Pointer to the per-I/O context structure for the operation.
          */
-        static void process_receive_negotiate_complete(const uint32_t io_size, per_io_context_t* io_context)
+        void process_receive_negotiate_complete(const uint32_t io_size, [[maybe_unused]] per_io_context_t* io_context)
         {
+            if (io_size == 0)
+            {
+                NETLIB_INFO("[SOCKS5]: process_receive_negotiate_complete: Control connection closed by {}:{}",
+                    remote_peer_address_, remote_peer_port_);
+                fail_association();
+                return;
+            }
+
+            negotiate_received_ += io_size;
+            negotiate_recv_buf_.buf += io_size;
+            negotiate_recv_buf_.len -= io_size;
+
+            // The bound address of the ASSOCIATE reply may be longer than expected
+            if (negotiate_recv_buf_.len == 0 && state_ == socks5_state::associate_sent)
+            {
+                if (const auto length = associate_reply_length(); length > negotiate_received_)
+                    negotiate_recv_buf_.len = length - negotiate_received_;
+            }
+
+            // Wait for the rest of the response
+            if (negotiate_recv_buf_.len != 0)
+            {
+                post_negotiate_receive();
+                return;
+            }
+
+            switch (state_)
+            {
+            case socks5_state::login_sent:
+                if ((ident_resp_.version != 5) ||
+                    (ident_resp_.method == 0xFF))
+                {
+                    NETLIB_INFO("[SOCKS5]: process_receive_negotiate_complete: SOCKS5 authentication has failed");
+                    fail_association();
+                }
+                else if (ident_resp_.method == 0x2) // USERNAME/PASSWORD is chosen
+                {
+                    send_username_auth();
+                }
+                else
+                {
+                    send_associate_request();
+                }
+                break;
+
+            case socks5_state::password_sent:
+                if (ident_resp_.method != 0x0)
+                {
+                    NETLIB_INFO("[SOCKS5]: process_receive_negotiate_complete: USERNAME/PASSWORD authentication has failed!");
+                    fail_association();
+                }
+                else
+                {
+                    NETLIB_INFO("[SOCKS5]: process_receive_negotiate_complete: USERNAME/PASSWORD authentication SUCCESS");
+                    send_associate_request();
+                }
+                break;
+
+            case socks5_state::associate_sent:
+                if ((associate_resp_[0] != 5) ||
+                    (associate_resp_[1] != 0) ||
+                    (associate_reply_length() == 0))
+                {
+                    NETLIB_INFO("[SOCKS5]: process_receive_negotiate_complete: SOCKS5 ASSOCIATE has failed");
+                    fail_association();
+                }
+                else
+                {
+                    complete_association(static_cast<uint16_t>(
+                        (associate_resp_[negotiate_received_ - 2] << 8) | associate_resp_[negotiate_received_ - 1]));
+                }
+                break;
+
+            default:
+                break;
+            }
         }
 
         /**
          * @brief Handler for completion of a send operation during negotiation.
          *
-         * This static method is intended to be overridden in derived classes to handle
-         * protocol-specific negotiation steps when a send operation completes.
+         * Nothing to do, the negotiation advances when the response to the request is received.
          *
          * @param io_size   Number of bytes sent.
          * @param io_context Pointer to the per-I/O context structure for the operation.
@@ -445,7 +727,8 @@ namespace proxy
          * @brief Handles completion of a receive operation on the data relay path.
          *
          * Updates the session timestamp and relays received data between local and remote sockets.
-         * If the data was received from the local socket, it is forwarded to the remote peer via the proxy.
+         * If the data was received from the local socket, it is forwarded to the remote peer via the proxy
+         * (or buffered until the association is established).
          * If the data was received from the remote socket, it is forwarded to the local client.
          * Handles buffer management and error conditions.
          *
@@ -460,48 +743,25 @@ namespace proxy
                 io_size, io_context->is_local ? "local" : "remote",
                 remote_peer_address_, remote_peer_port_);
 
+            if (negotiate_ctx_ && negotiate_ctx_->metrics)
+            {
+                (io_context->is_local ? negotiate_ctx_->metrics->bytes_sent : negotiate_ctx_->metrics->bytes_received)
+                    .add(io_size);
+            }
+
             if (io_context->is_local == true)
             {
                 NETLIB_DEBUG("process_receive_buffer_complete: {}:{} received data from local socket: {} bytes",
                     remote_peer_address_, remote_peer_port_, io_size);
 
-                NETLIB_DEBUG("process_receive_buffer_complete: Allocating I/O context for remote send operation");
-
-                // Use shared_from_this() to get shared_ptr
-                if (auto* io_context_send_to_remote = socks5_udp_per_io_context<T>::allocate_io_context(
-                    proxy_io_operation::relay_io_write, this->shared_from_this(), false); io_context_send_to_remote)
+                // Datagrams wait for the association to be established
+                if (state_ != socks5_state::associated)
                 {
-                    NETLIB_DEBUG("process_receive_buffer_complete: I/O context allocated, forwarding data to remote host");
-
-                    // forward the received data to remote host
-                    io_context_send_to_remote->wsa_buf = std::move(io_context->wsa_buf);
-
-                    NETLIB_DEBUG("process_receive_buffer_complete: {}:{} sending {} bytes to remote socket",
-                        remote_peer_address_, remote_peer_port_, io_size);
-
-                    if ((::WSASend(
-                        remote_socket_,
-                        io_context_send_to_remote->wsa_buf.get(),
-                        1,
-                        nullptr,
-                        0,
-                        io_context_send_to_remote,
-                        nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
-                    {
-                        const auto error = WSAGetLastError();
-                        NETLIB_WARNING("process_receive_buffer_complete: WSASend to remote failed with error: {}", error);
-                        // Close connection to remote peer in case of error
-                        close_client();
-                    }
-                    else
-                    {
-                        NETLIB_DEBUG("process_receive_buffer_complete: WSASend to remote initiated successfully");
-                    }
+                    queue_pending_datagram(std::move(io_context->wsa_buf));
                 }
                 else
                 {
-                    NETLIB_ERROR("process_receive_buffer_complete: Failed to allocate I/O context for remote send, freeing packet");
-                    packet_pool_->free(std::move(io_context->wsa_buf));
+                    send_to_remote(std::move(io_context->wsa_buf));
                 }
             }
             else
@@ -855,18 +1115,64 @@ namespace proxy
         }
 
         /**
-         * @brief Performs remote-side negotiation for the SOCKS5 UDP proxy session.
+         * @brief Starts the SOCKS5 UDP ASSOCIATE negotiation with the proxy.
          *
-         * This method is intended to be overridden in derived classes to implement
-         * protocol-specific negotiation logic for the remote socket. By default, it
-         * returns true, indicating that no negotiation is required or that negotiation
-         * completes immediately.
+         * Initiates the overlapped connect of the control socket; the negotiation continues from
+         * process_connect_complete() and process_receive_negotiate_complete() on the completion
+         * port threads, and the data relay is started once the proxy has assigned its UDP port.
+         * A pre-authenticated control socket (see set_pre_authenticated()) starts with the ASSOCIATE command.
          *
-         * @return true if remote negotiation is complete or not required, false otherwise.
+         * @return False if negotiation is in progress (or has failed), true if the association is established.
          */
-        static bool remote_negotiate()
+        bool remote_negotiate()
         {
-            return true;
+            if (state_ != socks5_state::pre_login)
+                return state_ == socks5_state::associated;
+
+            if (pre_authenticated_)
+            {
+                NETLIB_DEBUG("remote_negotiate: Using a pre-authenticated connection to SOCKS5 proxy {}:{}",
+                    remote_peer_address_, remote_peer_port_);
+                send_associate_request();
+                return false;
+            }
+
+            SOCKADDR_STORAGE sa_service{};
+            int sa_service_length = 0;
+
+            if constexpr (address_type_t::af_type == AF_INET)
+            {
+                auto* const sa = reinterpret_cast<sockaddr_in*>(&sa_service);
+                sa->sin_family = address_type_t::af_type;
+                sa->sin_addr = remote_peer_address_;
+                sa->sin_port = htons(remote_peer_port_);
+                sa_service_length = sizeof(sockaddr_in);
+            }
+            else
+            {
+                auto* const sa = reinterpret_cast<sockaddr_in6*>(&sa_service);
+                sa->sin6_family = address_type_t::af_type;
+                sa->sin6_addr = remote_peer_address_;
+                sa->sin6_port = htons(remote_peer_port_);
+                sa_service_length = sizeof(sockaddr_in6);
+            }
+
+            NETLIB_DEBUG("remote_negotiate: Connecting to SOCKS5 proxy {}:{}", remote_peer_address_, remote_peer_port_);
+
+            state_ = socks5_state::connecting;
+
+            if (!connect_ex_(socks_socket_, reinterpret_cast<const sockaddr*>(&sa_service), sa_service_length,
+                             nullptr, 0, nullptr, &io_context_connect_))
+            {
+                if (const auto error = WSAGetLastError(); error != ERROR_IO_PENDING)
+                {
+                    NETLIB_WARNING("remote_negotiate: ConnectEx to SOCKS5 proxy {}:{} failed: {}",
+                        remote_peer_address_, remote_peer_port_, error);
+                    fail_association();
+                }
+            }
+
+            return false;
         }
 
         /**
@@ -925,5 +1231,313 @@ namespace proxy
 
             return true;
         }
+
+    private:
+        /**
+         * @brief Sends a SOCKS5 request on the control socket and receives its response.
+         *
+         * @param request         Request buffer (must remain valid until the send completes).
+         * @param request_length  Request length in bytes.
+         * @param response        Response buffer.
+         * @param response_length Expected response length in bytes.
+         * @param next_state      State entered while the response is awaited.
+         * @return true if both operations were initiated, false otherwise (the session is closed).
+         */
+        bool post_negotiate(void* request, const ULONG request_length, void* response, const ULONG response_length,
+            const socks5_state next_state)
+        {
+            state_ = next_state;
+            negotiate_send_buf_ = { request_length, static_cast<char*>(request) };
+            negotiate_recv_buf_ = { response_length, static_cast<char*>(response) };
+            negotiate_received_ = 0;
+
+            if ((::WSASend(
+                socks_socket_,
+                &negotiate_send_buf_,
+                1,
+                nullptr,
+                0,
+                &io_context_send_negotiate_,
+                nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
+            {
+                NETLIB_WARNING("post_negotiate: WSASend to SOCKS5 proxy {}:{} failed with error: {}",
+                    remote_peer_address_, remote_peer_port_, WSAGetLastError());
+                fail_association();
+                return false;
+            }
+
+            return post_negotiate_receive();
+        }
+
+        /**
+         * @brief Receives the (rest of the) current SOCKS5 response into negotiate_recv_buf_.
+         *
+         * @return true if the receive was initiated, false otherwise (the session is closed).
+         */
+        bool post_negotiate_receive()
+        {
+            DWORD flags = 0;
+
+            if ((::WSARecv(
+                socks_socket_,
+                &negotiate_recv_buf_,
+                1,
+                nullptr,
+                &flags,
+                &io_context_recv_negotiate_,
+                nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
+            {
+                NETLIB_WARNING("post_negotiate_receive: WSARecv from SOCKS5 proxy {}:{} failed with error: {}",
+                    remote_peer_address_, remote_peer_port_, WSAGetLastError());
+                fail_association();
+                return false;
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Sends the RFC 1929 username/password authentication chosen by the proxy.
+         */
+        void send_username_auth()
+        {
+            if (!negotiate_ctx_ || !negotiate_ctx_->socks5_username.has_value())
+            {
+                NETLIB_INFO(
+                    "[SOCKS5]: send_username_auth: RFC 1928: X'02' USERNAME/PASSWORD is chosen but USERNAME is not provided");
+                fail_association();
+                return;
+            }
+
+            if (negotiate_ctx_->socks5_username.value().length() > socks5_username_max_length ||
+                negotiate_ctx_->socks5_username.value().length() < 1)
+            {
+                NETLIB_INFO(
+                    "[SOCKS5]: send_username_auth: RFC 1928: X'02' USERNAME/PASSWORD is chosen but USERNAME exceeds maximum possible length");
+                fail_association();
+                return;
+            }
+
+            if (!negotiate_ctx_->socks5_password.has_value())
+            {
+                NETLIB_INFO(
+                    "[SOCKS5]: send_username_auth: RFC 1928: X'02' USERNAME/PASSWORD is chosen but PASSWORD is not provided");
+                fail_association();
+                return;
+            }
+
+            if (negotiate_ctx_->socks5_password.value().length() > socks5_username_max_length ||
+                negotiate_ctx_->socks5_password.value().length() < 1)
+            {
+                NETLIB_INFO(
+                    "[SOCKS5]: send_username_auth: RFC 1928: X'02' USERNAME/PASSWORD is chosen but PASSWORD exceeds maximum possible length");
+                fail_association();
+                return;
+            }
+
+            const auto auth_size = username_auth_.init(
+                negotiate_ctx_->socks5_username.value(),
+                negotiate_ctx_->socks5_password.value());
+
+            post_negotiate(&username_auth_, auth_size, &ident_resp_, sizeof(ident_resp_), socks5_state::password_sent);
+        }
+
+        /**
+         * @brief Sends the UDP ASSOCIATE command.
+         *
+         * The reply is first received up to the length of one with an IPv4 bound address and
+         * extended by associate_reply_length() if the proxy reports an IPv6 address.
+         */
+        void send_associate_request()
+        {
+            associate_req_.version = 5;
+            associate_req_.cmd = 3;
+            associate_req_.reserved = 0;
+            if constexpr (address_type_t::af_type == AF_INET)
+            {
+                associate_req_.address_type = 1;
+            }
+            else
+            {
+                associate_req_.address_type = 4;
+            }
+            associate_req_.dest_address = address_type_t{};
+            associate_req_.dest_port = 0;
+
+            post_negotiate(&associate_req_, sizeof(associate_req_), associate_resp_.data(), 4 + 4 + 2,
+                socks5_state::associate_sent);
+        }
+
+        /**
+         * @brief Returns the full length of the ASSOCIATE reply from its header, or 0 for an
+         * unsupported bound address type.
+         */
+        [[nodiscard]] ULONG associate_reply_length() const noexcept
+        {
+            switch (associate_resp_[3])
+            {
+            case 1: return 4 + 4 + 2;   // IPv4
+            case 4: return 4 + 16 + 2;  // IPv6
+            default: return 0;
+            }
+        }
+
+        /**
+         * @brief Connects the remote socket to the UDP port assigned by the proxy, starts the data
+         * relay and forwards the datagrams buffered during the negotiation.
+         *
+         * @param udp_port UDP relay port assigned by the proxy.
+         */
+        void complete_association(const uint16_t udp_port)
+        {
+            NETLIB_INFO("[SOCKS5]: complete_association: SOCKS5 ASSOCIATE SUCCESS port: {}", udp_port);
+
+            remote_peer_port_ = udp_port;
+
+            auto status = SOCKET_ERROR;
+
+            if constexpr (address_type_t::af_type == AF_INET)
+            {
+                sockaddr_in sa_service{};
+                sa_service.sin_family = address_type_t::af_type;
+                sa_service.sin_addr = remote_peer_address_;
+                sa_service.sin_port = htons(udp_port);
+
+                status = connect(remote_socket_, reinterpret_cast<SOCKADDR*>(&sa_service), sizeof(sa_service));
+            }
+            else
+            {
+                sockaddr_in6 sa_service{};
+                sa_service.sin6_family = address_type_t::af_type;
+                sa_service.sin6_addr = remote_peer_address_;
+                sa_service.sin6_port = htons(udp_port);
+
+                status = connect(remote_socket_, reinterpret_cast<SOCKADDR*>(&sa_service), sizeof(sa_service));
+            }
+
+            if (status == SOCKET_ERROR)
+            {
+                NETLIB_WARNING("complete_association: Failed to connect UDP socket to {}:{}: {}",
+                    remote_peer_address_, udp_port, WSAGetLastError());
+                fail_association();
+                return;
+            }
+
+            state_ = socks5_state::associated;
+
+            if (negotiate_ctx_ && negotiate_ctx_->metrics)
+                negotiate_ctx_->metrics->handshake_time.record(std::chrono::steady_clock::now() - negotiate_started_);
+
+            if (!start_data_relay())
+                return;
+
+            NETLIB_DEBUG("complete_association: Forwarding {} buffered datagrams to {}:{}",
+                pending_datagrams_.size(), remote_peer_address_, remote_peer_port_);
+
+            auto pending = std::move(pending_datagrams_);
+            pending_datagrams_.clear();
+
+            for (auto& packet : pending)
+            {
+                if (ready_for_removal_)
+                    release_packet(std::move(packet));
+                else
+                    send_to_remote(std::move(packet));
+            }
+        }
+
+        /**
+         * @brief Ends a failed negotiation and closes the session.
+         */
+        void fail_association()
+        {
+            state_ = socks5_state::failed;
+            close_client();
+        }
+
+        /**
+         * @brief Buffers a local datagram until the association is established.
+         *
+         * The datagram is dropped if the session is closed or max_pending_datagrams are already buffered.
+         *
+         * @param packet Datagram received from the local client.
+         */
+        void queue_pending_datagram(std::unique_ptr<net_packet_t> packet)
+        {
+            if (ready_for_removal_ || pending_datagrams_.size() >= max_pending_datagrams)
+            {
+                NETLIB_DEBUG("queue_pending_datagram: Dropping datagram for {}:{} ({} buffered)",
+                    remote_peer_address_, remote_peer_port_, pending_datagrams_.size());
+                release_packet(std::move(packet));
+                return;
+            }
+
+            try
+            {
+                pending_datagrams_.push_back(std::move(packet));
+            }
+            catch (const std::bad_alloc&)
+            {
+                NETLIB_ERROR("queue_pending_datagram: Out of memory, dropping datagram");
+                release_packet(std::move(packet));
+            }
+        }
+
+        /**
+         * @brief Returns the buffered datagrams to the packet pool.
+         */
+        void discard_pending_datagrams()
+        {
+            for (auto& packet : pending_datagrams_)
+                release_packet(std::move(packet));
+
+            pending_datagrams_.clear();
+        }
+
+        /**
+         * @brief Forwards a datagram received from the local client to the proxy's UDP relay port.
+         *
+         * @param packet Datagram to send (its len is the datagram size).
+         */
+        void send_to_remote(std::unique_ptr<net_packet_t> packet)
+        {
+            NETLIB_DEBUG("send_to_remote: Allocating I/O context for remote send operation");
+
+            auto* io_context_send_to_remote = socks5_udp_per_io_context<T>::allocate_io_context(
+                proxy_io_operation::relay_io_write, this->shared_from_this(), false);
+
+            if (!io_context_send_to_remote)
+            {
+                NETLIB_ERROR("send_to_remote: Failed to allocate I/O context for remote send, freeing packet");
+                release_packet(std::move(packet));
+                return;
+            }
+
+            io_context_send_to_remote->wsa_buf = std::move(packet);
+
+            NETLIB_DEBUG("send_to_remote: {}:{} sending {} bytes to remote socket",
+                remote_peer_address_, remote_peer_port_, io_context_send_to_remote->wsa_buf->len);
+
+            if ((::WSASend(
+                remote_socket_,
+                io_context_send_to_remote->wsa_buf.get(),
+                1,
+                nullptr,
+                0,
+                io_context_send_to_remote,
+                nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
+            {
+                const auto error = WSAGetLastError();
+                NETLIB_WARNING("send_to_remote: WSASend to remote failed with error: {}", error);
+                // No completion will be queued
+                socks5_udp_per_io_context<T>::release_io_context(io_context_send_to_remote);
+                // Close connection to remote peer in case of error
+                close_client();
+            }
+            else
+            {
+                NETLIB_DEBUG("send_to_remote: WSASend to remote initiated successfully");
+            }
+        }
     };
 }
\ No newline at end of file
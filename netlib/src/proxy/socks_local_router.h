@@ -32,48 +32,61 @@ namespace proxy
         friend network_config_info;
 
         /**
-         * @brief Type alias for the SOCKS5 TCP proxy server specialized for IPv4.
+         * @brief Type alias for the SOCKS5 TCP proxy server of an address family.
          */
-        using s5_tcp_proxy_server = tcp_proxy_server<socks5_tcp_proxy_socket<net::ip_address_v4>>;
+        template <net::ip_address T>
+        using s5_tcp_proxy_server = tcp_proxy_server<socks5_tcp_proxy_socket<T>>;
 
         /**
-         * @brief Type alias for the SOCKS5 UDP proxy server specialized for IPv4.
+         * @brief Type alias for the SOCKS5 UDP proxy server of an address family.
          */
-        using s5_udp_proxy_server = socks5_local_udp_proxy_server<socks5_udp_proxy_socket<net::ip_address_v4>>;
+        template <net::ip_address T>
+        using s5_udp_proxy_server = socks5_local_udp_proxy_server<socks5_udp_proxy_socket<T>>;
 
         /**
-         * @brief Entry stored in tcp_mapper_: redirected destination endpoint and the
-         *        steady-clock timestamp at which the mapping was created. The timestamp
-         *        is used by process_resolve_thread_proc to evict stale entries whose
-         *        SYN never produced a local proxy connection (e.g. RST/timeout).
+         * @brief Type alias for the TCP and UDP proxy servers of one SOCKS5 proxy and address family.
          */
-        struct tcp_mapper_entry
-        {
-            net::ip_endpoint<net::ip_address_v4> endpoint;
-            std::chrono::steady_clock::time_point created_at;
-        };
+        template <net::ip_address T>
+        using s5_proxy_servers = std::pair<std::unique_ptr<s5_tcp_proxy_server<T>>, std::unique_ptr<s5_udp_proxy_server<T>>>;
 
         /**
-         * @brief Stores a mapping of TCP source ports to their original destination
-         *        endpoints, stamped with the time the entry was created so stale
-         *        entries can be aged out.
+         * @brief Maximum age for a tcp_mapper_v4_/tcp_mapper_v6_ entry before it is considered stale. SYN
+         *        packets that never reach the local SOCKS5 server (e.g. RST'd, dropped,
+         *        app gave up) leave entries behind that must not be applied to a later
+         *        connection reusing the source port.
          */
-        std::unordered_map<uint16_t, tcp_mapper_entry> tcp_mapper_;
+        static constexpr std::chrono::seconds tcp_mapper_entry_ttl_{ 30 };
 
         /**
-         * @brief Maximum age for a tcp_mapper_ entry before it is considered stale and
-         *        evicted by the resolve thread. SYN packets that never reach the local
-         *        SOCKS5 server (e.g. RST'd, dropped, app gave up) would otherwise leak
-         *        entries indefinitely.
+         * @brief Maps TCP source ports of redirected connections to their original destination
+         *        endpoints. Written by the packet path on every redirected SYN and consumed by the
+         *        SOCKS5 negotiate callback, both without locks; stale entries are rejected on
+         *        lookup and overwritten by the next SYN from the same port. One map per address
+         *        family, each consumed by the proxy servers of its family.
          */
-        static constexpr std::chrono::seconds tcp_mapper_entry_ttl_{ 30 };
+        tcp_port_map<net::ip_address_v4> tcp_mapper_v4_{ tcp_mapper_entry_ttl_ };
+        tcp_port_map<net::ip_address_v6> tcp_mapper_v6_{ tcp_mapper_entry_ttl_ };
+
+        /**
+         * @brief Lifetime of a flow cache entry. Bounds how long a decision made from a
+         *        stale process table (e.g. a recycled PID) can be reused before the flow is
+         *        re-evaluated.
+         */
+        static constexpr std::chrono::seconds flow_cache_ttl_{ 30 };
+
+        /**
+         * @brief Longest time packets of a flow are held behind its deferred packets. Bounds the
+         *        extra latency of a flow when the resolver lags; afterwards new packets of the
+         *        flow take the regular path again.
+         */
+        static constexpr std::chrono::milliseconds flow_hold_timeout_{ 2000 };
 
         /**
          * @brief Maximum number of packets that may be queued for deferred process
          *        resolution before new packets are dropped. Bounds memory growth of
          *        process_resolve_buffer_queue_ (and therefore the intermediate buffer
          *        pool) when the single-threaded resolver cannot keep up with the
-         *        incoming packet rate.
+         *        incoming packet rate. Must be a power of two (queue capacity).
          */
         static constexpr std::size_t max_resolve_queue_depth_ = 2048;
 
@@ -104,34 +117,238 @@ namespace proxy
         std::atomic<std::uint64_t> resolve_queue_alloc_failures_{ 0 };
 
         /**
-         * @brief Stores the set of UDP ports being mapped.
+         * @brief Packets of resolve_queue_dropped_packets_ and resolve_queue_alloc_failures_ already
+         *        reported by the throttled log path, which resets those counters. The sums give the
+         *        cumulative counts of get_metrics() without another atomic on the drop path.
+         */
+        std::atomic<std::uint64_t> resolve_queue_dropped_logged_{ 0 };
+        std::atomic<std::uint64_t> resolve_queue_alloc_failures_logged_{ 0 };
+
+        /**
+         * @brief Deferred-resolve counters, updated by the resolver thread once per batch
+         *        and reported through get_deferred_resolve_statistics().
+         */
+        std::atomic<std::size_t> resolve_queue_peak_depth_{ 0 };        ///< Largest batch drained from the queue
+        std::atomic<std::uint64_t> deferred_packets_{ 0 };              ///< Packets re-injected after deferred resolution
+        std::atomic<std::uint64_t> deferred_table_refreshes_{ 0 };      ///< Process table refreshes performed for deferred packets
+        std::atomic<std::uint64_t> deferred_latency_total_us_{ 0 };     ///< Sum of queue-to-re-injection latencies
+        std::atomic<std::uint64_t> deferred_latency_max_us_{ 0 };       ///< Largest queue-to-re-injection latency
+
+        /**
+         * @brief Phase durations of the last start(), reported through get_metrics().
+         */
+        std::atomic<std::uint64_t> startup_total_us_{ 0 };              ///< The whole start()
+        std::atomic<std::uint64_t> startup_proxies_us_{ 0 };            ///< Starting the proxy servers
+        std::atomic<std::uint64_t> startup_process_tables_us_{ 0 };     ///< Loading the process tables, in the background
+        std::atomic<std::uint64_t> startup_network_us_{ 0 };            ///< Network configuration and waiting for the tables
+        std::atomic<std::uint64_t> endpoint_resolution_us_{ 0 };        ///< Parsing and resolving proxy endpoints, summed
+
+        /**
+         * @brief Interval of the redirected flow summaries logged by the resolver thread.
+         */
+        static constexpr std::chrono::seconds flow_summary_interval_{ 10 };
+
+        /**
+         * @brief Maximum number of processes listed individually in a flow summary, the rest
+         *        are reported as a single total.
+         */
+        static constexpr std::size_t flow_summary_max_processes_ = 16;
+
+        /**
+         * @brief Rate limit of the per-flow "Redirecting" log lines of each protocol: sustained
+         *        lines per second and burst. Flows beyond the limit are still counted in the
+         *        flow summary, so a connection storm costs a bounded number of log lines.
+         */
+        static constexpr std::uint32_t flow_log_rate_ = 10;
+        static constexpr std::uint32_t flow_log_burst_ = 50;
+
+        /**
+         * @brief Protects flow_summary_processes_.
+         */
+        std::mutex flow_summary_lock_;
+
+        /**
+         * @brief Processes with flows redirected since the last flow summary. A process is added
+         *        by the flow that makes its iphelper::network_process::redirected_flows non-zero,
+         *        so the lock is taken at most once per process and summary interval.
+         */
+        std::vector<std::shared_ptr<iphelper::network_process>> flow_summary_processes_;
+
+        /**
+         * @brief Type alias for the per-flow verdict cache of an address family.
+         */
+        template <net::ip_address T>
+        using flow_cache = flow_verdict_cache<T>;
+
+        /**
+         * @brief Per-flow routing decisions for IPv4 and IPv6 TCP/UDP traffic.
+         *
+         * Populated by the slow path of process_tcp_packet()/process_udp_packet() and consulted
+         * first for every subsequent packet of the flow, so established flows skip the proxy
+         * port checks, the process lookup, the redirect decider and the proxy pattern scan.
+         * TCP SYNs always take the slow path (they create the redirect state), FIN/RST remove
+         * the entry, entries expire after flow_cache_ttl_, and every configuration change
+         * invalidates the whole cache. Unresolved flows (default process) are never cached.
+         */
+        flow_cache<net::ip_address_v4> flow_cache_v4_{ flow_cache_ttl_ };
+        flow_cache<net::ip_address_v6> flow_cache_v6_{ flow_cache_ttl_ };
+
+        /**
+         * @brief Type alias for the IPv4 kernel bypass table.
+         */
+        using kernel_bypass_v4 = kernel_bypass_table<net::ip_address_v4>;
+
+        /**
+         * @brief Type alias for the IPv6 kernel bypass table.
+         */
+        using kernel_bypass_v6 = kernel_bypass_table<net::ip_address_v6>;
+
+        /**
+         * @brief Busy passed flows installed as pass filters in the driver, null if disabled.
+         *
+         * Fed by the cached pass verdicts of the flow cache of the same family, synchronized with the
+         * driver by the resolver thread every kernel_bypass_sync_interval_ and flushed by
+         * invalidate_flow_cache(). Both tables are enabled and disabled together.
+         */
+        std::unique_ptr<kernel_bypass_v4> kernel_bypass_v4_;
+        std::unique_ptr<kernel_bypass_v6> kernel_bypass_v6_;
+
+        /**
+         * @brief Interval of the kernel bypass synchronization, also the longest time a bypassed
+         *        flow stays in the driver after a configuration change.
+         */
+        static constexpr std::chrono::seconds kernel_bypass_sync_interval_{ 1 };
+
+        /**
+         * @brief Type alias for the deferred flow hold table of an address family.
+         */
+        template <net::ip_address T>
+        using flow_holds = flow_hold_table<T>;
+
+        /**
+         * @brief IPv4 and IPv6 flows with packets waiting in process_resolve_buffer_queue_.
+         *
+         * While a flow has deferred packets, its follow-up packets are deferred as well instead
+         * of overtaking them through the fast path (e.g. data after a deferred SYN, or the second
+         * datagram of a UDP flow once a refresh has made its owner known).
+         */
+        flow_holds<net::ip_address_v4> flow_holds_v4_{ flow_hold_timeout_ };
+        flow_holds<net::ip_address_v6> flow_holds_v6_{ flow_hold_timeout_ };
+
+        /**
+         * @brief I/O completion ports for asynchronous operations (one per core group if sharded).
+         */
+        netlib::winsys::io_completion_port_group io_ports_;
+
+        /**
+         * @brief True if the TCP proxy servers relay established sessions in fast relay mode.
          */
-        std::unordered_set<uint16_t> udp_mapper_;
+        bool fast_tcp_relay_;
 
         /**
-         * @brief Mutex to synchronize access to the TCP port mapping.
+         * @brief True if the UDP proxy servers receive from local clients through Registered I/O.
          */
-        std::mutex tcp_mapper_lock_;
+        bool registered_udp_io_;
 
         /**
-         * @brief Mutex to synchronize access to the UDP port mapping.
+         * @brief Optional packet capture. The packet path only copies packets into its ring,
+         *        a background thread writes them to pcap_log_stream_ or to rotating files.
          */
-        std::mutex udp_mapper_lock_;
+        std::optional<pcap::pcap_async_writer> pcap_logger_;
 
         /**
-         * @brief I/O completion port for asynchronous operations.
+         * @brief Optional selection and sampling of the captured packets, see set_pcap_capture_filter().
          */
-        netlib::winsys::io_completion_port io_port_;
+        std::unique_ptr<pcap_capture_filter> pcap_filter_;
 
         /**
-         * @brief Optional pcap stream logger for packet capture logging.
+         * @brief Set while the capture is pcapng: packets are then recorded once the router has
+         *        decided on them, annotated with the owner process, its proxy and the decision.
          */
-        std::optional<pcap::pcap_stream_logger> pcap_logger_;
+        bool pcap_annotate_{ false };
 
         /**
-         * @brief Vector storing pairs of unique pointers to TCP and UDP proxy servers.
+         * @brief Per-thread state of the packet filter_packet() is deciding on while a capture is written.
          */
-        std::vector<std::pair<std::unique_ptr<s5_tcp_proxy_server>, std::unique_ptr<s5_udp_proxy_server>>> proxy_servers_;
+        struct pcap_packet_context
+        {
+            std::unique_ptr<INTERMEDIATE_BUFFER> staged;            ///< The packet as received (annotated capture).
+            bool active{ false };                                   ///< filter_packet() is deciding on the packet.
+            bool pending{ false };                                  ///< The packet was selected for capture (and staged if annotated).
+            bool rewritten{ false };                                ///< The router rewrote the packet, record it again.
+            bool deferred{ false };                                 ///< The packet was queued for the resolver thread.
+            std::shared_ptr<iphelper::network_process> process;     ///< The owner, if resolved.
+            std::optional<std::size_t> proxy_id;                    ///< The proxy associated with the owner.
+        };
+
+        /**
+         * @brief IPv4 TCP and UDP proxy servers, indexed by proxy ID.
+         */
+        std::vector<s5_proxy_servers<net::ip_address_v4>> proxy_servers_;
+
+        /**
+         * @brief IPv6 TCP and UDP proxy servers, indexed by proxy ID like proxy_servers_.
+         *
+         * They take the connections and datagrams of redirected IPv6 flows and reach an IPv4 SOCKS5
+         * proxy through its IPv4-mapped address. Servers that are not listening, e.g. on a host
+         * without IPv6, publish no port and the flows they would relay are passed.
+         */
+        std::vector<s5_proxy_servers<net::ip_address_v6>> proxy_servers_v6_;
+
+        /**
+         * @brief Pools of pre-negotiated SOCKS5 connections indexed by proxy ID, shared with the proxy
+         *        servers they serve, null for the proxies without a pool.
+         *
+         * Started and stopped together with the proxy servers. The IPv6 servers of a proxy have a
+         * pool of their own, their connections are IPv6 sockets.
+         */
+        std::vector<std::shared_ptr<proxy::socks5_connection_pool<net::ip_address_v4>>> connection_pools_;
+        std::vector<std::shared_ptr<proxy::socks5_connection_pool<net::ip_address_v6>>> connection_pools_v6_;
+
+        /**
+         * @brief Type alias for the DNS forwarder of a proxy.
+         */
+        using dns_forwarder = socks5_dns_forwarder<net::ip_address_v4>;
+
+        /**
+         * @brief Endpoints and optional credentials of the SOCKS5 proxies, indexed by proxy ID.
+         */
+        std::vector<std::pair<net::ip_endpoint<net::ip_address_v4>,
+                              std::optional<std::pair<std::string, std::string>>>> proxy_endpoints_;
+
+        /**
+         * @brief Upstream groups indexed by proxy ID, selecting the SOCKS5 endpoint of each new session.
+         *
+         * The first member of a group is the endpoint given to add_socks5_proxy(), the others are added
+         * by add_socks5_proxy_endpoint(). Probing runs while the router is started. Null for the
+         * proxies retired by reconfigure().
+         */
+        std::vector<std::shared_ptr<proxy::proxy_group>> proxy_groups_;
+
+        /**
+         * @brief DNS forwarders indexed by proxy ID, null for the proxies without DNS forwarding.
+         *
+         * Started and stopped together with the proxy servers, see set_dns_forwarding().
+         */
+        std::vector<std::shared_ptr<dns_forwarder>> dns_forwarders_;
+
+        /**
+         * @brief True while the filters taking DNS queries to user mode are installed.
+         */
+        bool dns_filters_installed_{ false };
+
+        /**
+         * @brief True while the LAN bypass filters are installed, guarded by static_filters_lock_.
+         */
+        bool lan_filters_installed_{ false };
+
+        /**
+         * @brief Priority group of the LAN bypass filters.
+         *
+         * Follows filter_group::high, which holds the DNS redirect filters, so that queries to a
+         * resolver on the LAN still reach the DNS forwarders.
+         */
+        static constexpr uint8_t lan_bypass_group = ndisapi::filter_group::high + 1;
 
         /**
          * @brief Maps proxy indexes to their corresponding process names (sorted by proxy ID).
@@ -143,6 +360,95 @@ namespace proxy
          */
         std::vector<std::wstring> excluded_list_;
 
+        /**
+         * @struct routing_snapshot
+         * @brief Immutable view of proxy_servers_, proxy_to_names_ and excluded_list_ used by the packet path.
+         */
+        struct routing_snapshot
+        {
+            uint64_t version{ 0 };                                  ///< Process-wide unique snapshot version (0 for the initial empty one).
+            app_name_matcher matcher{ 1, {}, {} };                  ///< Compiled associations and exclusions.
+            std::vector<std::optional<uint16_t>> tcp_ports;         ///< Local IPv4 TCP proxy port by proxy index.
+            std::vector<std::optional<uint16_t>> udp_ports;         ///< Local IPv4 UDP proxy port by proxy index.
+            std::vector<std::optional<uint16_t>> tcp_ports_v6;      ///< Local IPv6 TCP proxy port by proxy index.
+            std::vector<std::optional<uint16_t>> udp_ports_v6;      ///< Local IPv6 UDP proxy port by proxy index.
+            std::vector<std::shared_ptr<dns_forwarder>> dns_forwarders; ///< DNS forwarder by proxy index, empty if no proxy has one.
+        };
+
+        /**
+         * @brief Current routing configuration.
+         *
+         * Rebuilt under lock_ on every configuration change (and after start() has bound the local
+         * proxy ports) and published atomically, so the packet path never acquires lock_. Each
+         * snapshot carries a new matcher generation which tags the per-process memoized result in
+         * iphelper::network_process::proxy_match.
+         */
+        std::atomic<std::shared_ptr<const routing_snapshot>> routing_{ std::make_shared<const routing_snapshot>(
+            routing_snapshot{ .version = next_routing_version_.fetch_add(1, std::memory_order_relaxed) }) };
+
+        /**
+         * @brief Version of the snapshot stored in routing_, polled by current_routing().
+         */
+        std::atomic<uint64_t> routing_version_{ routing_.load(std::memory_order_relaxed)->version };
+
+        /**
+         * @brief Superseded snapshots a thread may still use, guarded by lock_.
+         *
+         * The per-thread caches of current_routing() do not own the snapshot they point to, so a
+         * superseded one is kept while a thread announces it, see reclaim_routing_snapshots(). Each
+         * thread announces one snapshot at most, so at most one snapshot per thread is kept.
+         */
+        std::vector<std::shared_ptr<const routing_snapshot>> retired_routing_;
+
+        /**
+         * @brief Snapshot announced by a thread that runs the packet path, see current_routing().
+         */
+        struct routing_reader
+        {
+            std::atomic<uint64_t> version{ 0 };     ///< Version of the snapshot the thread uses, 0 for none.
+            bool in_use{ true };                    ///< False once the thread has exited, the entry is then reused.
+        };
+
+        /**
+         * @brief Announcements of the threads that run the packet path.
+         *
+         * Shared with the per-thread caches of current_routing(), which release their entry when the
+         * thread exits, even after the router is gone.
+         */
+        struct routing_readers
+        {
+            std::mutex lock;                        ///< Guards the entries and their in_use flags.
+            std::deque<routing_reader> readers;     ///< One per thread, never moved.
+        };
+
+        /**
+         * @brief Announcements of the snapshots in use, scanned by reclaim_routing_snapshots().
+         */
+        const std::shared_ptr<routing_readers> routing_readers_{ std::make_shared<routing_readers>() };
+
+        /**
+         * @brief Matcher generation of the most recently published snapshot.
+         */
+        uint32_t routing_generation_{ 1 };
+
+        /**
+         * @brief Source of process-wide unique snapshot versions, so per-thread snapshot caches can
+         *        never confuse two router instances allocated at the same address.
+         */
+        static inline std::atomic<uint64_t> next_routing_version_{ 1 };
+
+        /**
+         * @brief Local TCP proxy listening ports, mirror routing_snapshot::tcp_ports/tcp_ports_v6 for O(1) lookups.
+         */
+        net::port_bitmap tcp_proxy_ports_v4_;
+        net::port_bitmap tcp_proxy_ports_v6_;
+
+        /**
+         * @brief Local UDP proxy listening ports, mirror routing_snapshot::udp_ports/udp_ports_v6 for O(1) lookups.
+         */
+        net::port_bitmap udp_proxy_ports_v4_;
+        net::port_bitmap udp_proxy_ports_v6_;
+
         /**
          * @brief Shared mutex to protect concurrent access to shared resources.
          */
@@ -162,14 +468,16 @@ namespace proxy
         std::mutex lifecycle_mutex_;
 
         /**
-         * @brief Unique pointer to the TCP redirect object.
+         * @brief TCP redirect objects of IPv4 and IPv6.
          */
-        std::unique_ptr<ndisapi::tcp_local_redirect<net::ip_address_v4>> tcp_redirect_{ nullptr };
+        std::unique_ptr<ndisapi::tcp_local_redirect<net::ip_address_v4>> tcp_redirect_v4_{ nullptr };
+        std::unique_ptr<ndisapi::tcp_local_redirect<net::ip_address_v6>> tcp_redirect_v6_{ nullptr };
 
         /**
-         * @brief Unique pointer to the UDP redirect object.
+         * @brief UDP redirect objects of IPv4 and IPv6.
          */
-        std::unique_ptr<ndisapi::socks5_udp_local_redirect<net::ip_address_v4>> udp_redirect_{ nullptr };
+        std::unique_ptr<ndisapi::socks5_udp_local_redirect<net::ip_address_v4>> udp_redirect_v4_{ nullptr };
+        std::unique_ptr<ndisapi::socks5_udp_local_redirect<net::ip_address_v6>> udp_redirect_v6_{ nullptr };
 
         /**
          * @brief Unique pointer to the packet filter object.
@@ -177,9 +485,15 @@ namespace proxy
         std::unique_ptr<packet_filter> packet_filter_{ nullptr };
 
         /**
-         * @brief Static filters for packet filtering.
+         * @brief Static filters for packet filtering, not created in replay mode.
+         */
+        std::optional<ndisapi::static_filters> static_filters_;
+
+        /**
+         * @brief Serializes changes to static_filters_ made by the configuration methods and by the
+         *        kernel bypass synchronization on the resolver thread.
          */
-        ndisapi::static_filters static_filters_;
+        std::mutex static_filters_lock_;
 
         /**
          * @brief Process lookup for IPv4 addresses.
@@ -201,35 +515,78 @@ namespace proxy
          */
         std::unordered_set<std::string> adapters_to_filter_;
 
+        /**
+         * @brief Serializes the full and the targeted network configuration updates.
+         */
+        std::mutex network_config_lock_;
+
+        /**
+         * @brief Internal names of the NDIS adapters of the external non-PPP interfaces, keyed by
+         *        interface LUID, protected by network_config_lock_.
+         *
+         * Filled by the full network configuration update; an empty name records an interface
+         * without an NDIS adapter. Valid while the NDIS adapters are the same as in
+         * interface_adapter_handles_.
+         */
+        std::unordered_map<uint64_t, std::string> interface_adapters_;
+
+        /**
+         * @brief Handles of the NDIS adapters seen by the last full network configuration update,
+         *        protected by network_config_lock_.
+         */
+        std::vector<HANDLE> interface_adapter_handles_;
+
+        /**
+         * @brief Coalesces the IP interface change notifications into network configuration updates.
+         */
+        iphelper::interface_change_queue interface_changes_{ iphelper::interface_change_queue::options{} };
+
         /**
          * @brief Thread for lazy process resolution.
          */
         std::thread process_resolve_thread_;
 
         /**
-         * @brief Queue for holding pointers to intermediate_buffer objects that require process resolution.
+         * @brief Packet waiting for deferred process resolution.
+         */
+        struct deferred_packet
+        {
+            ndisapi::intermediate_buffer_pool::intermediate_buffer_ptr buffer; ///< Copy of the packet
+            std::chrono::steady_clock::time_point enqueued_at;                 ///< Time the packet was deferred
+            std::size_t hold_slot;                                             ///< Flow hold table slot of the packet's flow
+            uint8_t protocol;                                                  ///< IPPROTO_TCP or IPPROTO_UDP
+            bool ipv6;                                                         ///< IPv6 packet, hold_slot is a flow_holds_v6_ slot
+        };
+
+        /**
+         * @brief Queue for holding packets that require process resolution.
          *
-         * This queue is used to store buffers that need to be processed by the process resolution thread.
-         * Access to this queue is synchronized using process_resolve_buffer_mutex_ and process_resolve_buffer_queue_cv_.
+         * Producers (packet filter callbacks) push without taking a lock; the process resolution
+         * thread is the single consumer and drains the queue in batches.
          */
-        std::queue<ndisapi::intermediate_buffer_pool::intermediate_buffer_ptr> process_resolve_buffer_queue_;
+        tools::concurrency::mpsc_queue<deferred_packet, max_resolve_queue_depth_> process_resolve_buffer_queue_;
 
         /**
-         * @brief Mutex to guard access to the process_resolve_buffer_queue_.
+         * @brief Mutex the process resolution thread parks on together with process_resolve_buffer_queue_cv_.
          *
-         * This mutex ensures thread-safe access to the buffer queue, preventing data races
-         * when multiple threads are adding to or removing from the queue.
+         * Only used for sleeping and waking the resolver, never for queue access.
          */
         mutable std::mutex process_resolve_buffer_mutex_;
 
         /**
-         * @brief Condition variable for synchronizing access to the process_resolve_buffer_queue_.
+         * @brief Condition variable for waking the process resolution thread.
          *
-         * This condition variable is used to notify waiting threads when new buffers are added to the queue,
-         * allowing the process resolution thread to efficiently wait for work.
+         * Producers only notify it while resolver_parked_ is set, so an active resolver costs
+         * the packet path nothing beyond the queue push.
          */
         std::condition_variable process_resolve_buffer_queue_cv_;
 
+        /**
+         * @brief Set by the process resolution thread while it is (about to be) waiting on
+         *        process_resolve_buffer_queue_cv_.
+         */
+        std::atomic_bool resolver_parked_{ false };
+
         /**
          * @brief Shared pointer to an output stream for PCAP (packet capture) logging.
          *
@@ -249,14 +606,77 @@ namespace proxy
         std::atomic_bool is_active_{ false };
 
 	public:
-	    using redirect_decider_t = std::function<bool(const std::wstring&, const sockaddr*, int)>;
+	    // Maps a process name to the key passed to the decider; called once per process entry.
+	    using redirect_key_t = std::function<uint32_t(const std::wstring&)>;
+	    // Decides per packet from the process key and the destination, without string work.
+	    using redirect_decider_t = std::function<bool(uint32_t, const sockaddr*, int)>;
 
 	    // Optional; if not set, legacy behavior (always redirect when associated) remains.
-	    void set_redirect_decider(redirect_decider_t cb) { redirect_decider_ = std::move(cb); }
+	    // Must not be called while the router is running.
+	    void set_redirect_decider(redirect_key_t key_of, redirect_decider_t cb)
+	    {
+	        redirect_key_of_ = std::move(key_of);
+	        redirect_decider_ = std::move(cb);
+	        ++redirect_key_generation_;
+	        invalidate_flow_cache();
+	    }
+
+	    /**
+	     * @brief Drops all cached per-flow routing decisions.
+	     *
+	     * Must be called whenever an input of the routing decision changes outside of this
+	     * class, e.g. the destination policy consulted by the redirect decider. Changes made
+	     * through the router's own configuration methods invalidate the cache automatically.
+	     */
+	    void invalidate_flow_cache() noexcept
+	    {
+	        flow_cache_v4_.invalidate();
+	        flow_cache_v6_.invalidate();
+
+	        // Bypassed flows were passed under the same decisions
+	        if (kernel_bypass_v4_)
+	            kernel_bypass_v4_->invalidate();
+
+	        if (kernel_bypass_v6_)
+	            kernel_bypass_v6_->invalidate();
+	    }
+
+	    /**
+	     * @brief Counters of the deferred process resolution path.
+	     */
+	    struct deferred_resolve_statistics
+	    {
+	        std::size_t queue_depth;                        ///< Packets currently waiting for resolution
+	        std::size_t peak_queue_depth;                   ///< Largest batch drained by the resolver
+	        std::uint64_t packets;                          ///< Packets re-injected after deferred resolution
+	        std::uint64_t table_refreshes;                  ///< Process table refreshes performed for deferred packets
+	        std::chrono::microseconds average_latency;      ///< Mean time from deferral to re-injection
+	        std::chrono::microseconds max_latency;          ///< Largest time from deferral to re-injection
+	    };
+
+	    /**
+	     * @brief Returns a snapshot of the deferred process resolution counters.
+	     */
+	    [[nodiscard]] deferred_resolve_statistics get_deferred_resolve_statistics() const noexcept
+	    {
+	        const auto packets = deferred_packets_.load(std::memory_order_relaxed);
+	        const auto latency_total = deferred_latency_total_us_.load(std::memory_order_relaxed);
+
+	        return {
+	            process_resolve_buffer_queue_.size(),
+	            resolve_queue_peak_depth_.load(std::memory_order_relaxed),
+	            packets,
+	            deferred_table_refreshes_.load(std::memory_order_relaxed),
+	            std::chrono::microseconds(packets ? latency_total / packets : 0),
+	            std::chrono::microseconds(deferred_latency_max_us_.load(std::memory_order_relaxed))
+	        };
+	    }
 
 
     private:
         redirect_decider_t redirect_decider_; // empty => legacy behavior
+        redirect_key_t redirect_key_of_;
+        uint32_t redirect_key_generation_{ 1 }; // tags network_process::redirect_key memos
         // -----------------------------------------------------------------------
         /**
          * @brief Atomic flag that signals the deferred-resolve thread to exit.
@@ -272,74 +692,139 @@ namespace proxy
          */
         std::atomic_bool resolver_should_exit_{ false };
 
+        /**
+         * @brief Selects the member of the address family T out of an IPv4/IPv6 member pair.
+         */
+        template <net::ip_address T, typename V4, typename V6>
+        static constexpr auto& per_family(V4& v4, V6& v6) noexcept
+        {
+            if constexpr (std::is_same_v<T, net::ip_address_v4>)
+                return v4;
+            else
+                return v6;
+        }
+
+        /**
+         * @brief Addresses and transport header of an IPv4 or IPv6 packet.
+         */
+        template <net::ip_address T>
+        struct transport_packet
+        {
+            T source;                       ///< Source address
+            T destination;                  ///< Destination address
+            uint8_t* transport_header;      ///< First transport header, null for a non-first IPv6 fragment
+            uint8_t protocol;               ///< Transport protocol of transport_header
+        };
+
+        /**
+         * @brief Locates the transport header of the IP packet in an Ethernet frame.
+         *
+         * IPv6 extension headers are skipped, so the protocol is the one of the transport header
+         * rather than the IPv6 next header field.
+         */
+        template <net::ip_address T>
+        static transport_packet<T> parse_transport_packet(ndisapi::intermediate_buffer& buffer) noexcept
+        {
+            if constexpr (std::is_same_v<T, net::ip_address_v4>)
+            {
+                auto* const ip_header = reinterpret_cast<iphdr_ptr>(buffer.m_IBuffer + ETHER_HEADER_LENGTH);
+
+                return { T(ip_header->ip_src), T(ip_header->ip_dst),
+                         reinterpret_cast<uint8_t*>(ip_header) + sizeof(DWORD) * ip_header->ip_hl, ip_header->ip_p };
+            }
+            else
+            {
+                auto* const ip_header = reinterpret_cast<ipv6hdr_ptr>(buffer.m_IBuffer + ETHER_HEADER_LENGTH);
+                const auto [header, protocol] = net::ipv6_helper::find_transport_header(
+                    ip_header, buffer.m_Length - ETHER_HEADER_LENGTH);
+
+                return { T(ip_header->ip6_src), T(ip_header->ip6_dst), static_cast<uint8_t*>(header), protocol };
+            }
+        }
+
+        /**
+         * @brief Returns the transport flow identifier of a TCP/UDP packet.
+         */
+        template <net::ip_address T>
+        static typename flow_cache<T>::flow_key packet_flow_key(const transport_packet<T>& packet) noexcept
+        {
+            // TCP and UDP headers both start with the source and destination ports
+            const auto* const ports = reinterpret_cast<const uint16_t*>(packet.transport_header);
+
+            return { packet.source, packet.destination, ntohs(ports[0]), ntohs(ports[1]), packet.protocol };
+        }
+
         /**
          * @brief Enqueues a TCP/UDP packet for deferred process resolution, dropping
          *        it if process_resolve_buffer_queue_ is already at capacity.
          *
          * Bounding the queue is what keeps the intermediate buffer pool's high-water
          * mark finite when the resolver thread cannot keep up with the incoming
-         * packet rate. The capacity check is performed under
-         * process_resolve_buffer_mutex_ before allocating from the pool so an
-         * overload condition does not produce unnecessary buffer-pool churn.
-         * The queued_multi_interface_packet_filter callback path drives this
-         * function from a single packet processing thread, so the size check
-         * and subsequent push are not racing other filter callbacks; the
-         * implementation does not rely on exceeding max_resolve_queue_depth_
-         * to remain bounded under concurrency.
+         * packet rate. The capacity is checked before allocating from the pool so
+         * an overload condition does not produce unnecessary buffer-pool churn; the
+         * push itself enforces the bound strictly and is safe for any number of
+         * concurrent callers, so no lock is taken on this path.
          *
          * Defined in the private section above the constructor so its declaration
          * is in scope for the packet_filter callback lambda constructed in the
          * constructor body, regardless of compiler treatment of complete-class
          * context for member name lookup inside lambdas.
          *
+         * @tparam T The address family of the packet.
          * @param buffer The intermediate buffer describing the packet to enqueue.
+         * @param packet The parsed addresses and transport header of the packet.
          * @return Always returns a 'drop' action: the packet is either queued for
          *         later re-injection (and therefore dropped from the current pass)
          *         or dropped outright due to overload / allocation failure.
          */
-        packet_filter::packet_action enqueue_for_deferred_resolve(ndisapi::intermediate_buffer& buffer)
+        template <net::ip_address T>
+        packet_filter::packet_action enqueue_for_deferred_resolve(ndisapi::intermediate_buffer& buffer,
+                                                                  const transport_packet<T>& packet)
         {
+            if (process_resolve_buffer_queue_.size() >= max_resolve_queue_depth_)
             {
-                std::scoped_lock lock(process_resolve_buffer_mutex_);
-                if (process_resolve_buffer_queue_.size() >= max_resolve_queue_depth_)
-                {
-                    // The increment occurs while holding process_resolve_buffer_mutex_
-                    // so this full-queue drop path is not expected to undercount due
-                    // to contention. Treat the counter as a coarse overload signal
-                    // rather than precise end-to-end accounting; if the
-                    // single-callback-thread assumption changes in the future, the
-                    // more likely concurrency artifact would be temporary queue
-                    // overshoot from the unlocked allocation window below, not
-                    // missed increments in this branch.
-                    resolve_queue_dropped_packets_.fetch_add(1, std::memory_order_relaxed);
-                    return packet_filter::packet_action{ packet_filter::packet_action::action_type::drop };
-                }
+                // Treat the counter as a coarse overload signal rather than precise
+                // end-to-end accounting.
+                resolve_queue_dropped_packets_.fetch_add(1, std::memory_order_relaxed);
+                return packet_filter::packet_action{ packet_filter::packet_action::action_type::drop };
             }
 
-            if (auto allocated_buffer = ndisapi::intermediate_buffer_pool::instance().allocate(buffer))
+            constexpr auto ipv6 = std::is_same_v<T, net::ip_address_v6>;
+            auto& holds = per_family<T>(flow_holds_v4_, flow_holds_v6_);
+
+            // Taken while packet still points into buffer
+            const auto hold_slot = flow_holds<T>::slot_of(packet_flow_key(packet));
+
+            // A buffer of the packet filter's block is taken out of the block rather than copied. Fall
+            // back to a copy if it comes from elsewhere or no replacement slot can be allocated.
+            auto& buffer_pool = ndisapi::intermediate_buffer_pool::instance();
+            auto allocated_buffer = buffer_pool.steal(buffer);
+
+            if (!allocated_buffer)
+                allocated_buffer = buffer_pool.allocate(buffer);
+
+            if (allocated_buffer)
             {
-                bool pushed = false;
+                // Hold the flow before publishing the packet so the resolver cannot
+                // release it first
+                holds.hold(hold_slot);
+
+                if (deferred_packet deferred{ std::move(allocated_buffer), std::chrono::steady_clock::now(), hold_slot,
+                                              packet.protocol, ipv6 };
+                    process_resolve_buffer_queue_.try_push(std::move(deferred)))
                 {
-                    std::scoped_lock lock(process_resolve_buffer_mutex_);
-                    // Re-check capacity under the lock so the depth bound is
-                    // enforced strictly even if multiple producers ever drive
-                    // this path concurrently in the future. The allocation
-                    // window above is unlocked, so without this re-check the
-                    // queue could transiently exceed max_resolve_queue_depth_.
-                    if (process_resolve_buffer_queue_.size() < max_resolve_queue_depth_)
-                    {
-                        process_resolve_buffer_queue_.push(std::move(allocated_buffer));
-                        pushed = true;
-                    }
-                    else
-                    {
-                        resolve_queue_dropped_packets_.fetch_add(1, std::memory_order_relaxed);
-                    }
+                    if (pcap_annotate_)
+                        pcap_context().deferred = true;
+
+                    wake_resolver();
+                }
+                else
+                {
+                    // The queue filled up after the capacity check above; the packet
+                    // buffer falls out of scope here and is returned to the pool.
+                    holds.release(hold_slot);
+                    resolve_queue_dropped_packets_.fetch_add(1, std::memory_order_relaxed);
                 }
-                if (pushed)
-                    process_resolve_buffer_queue_cv_.notify_one();
-                // allocated_buffer falls out of scope here and is returned to the
-                // pool automatically when not pushed.
             }
             else
             {
@@ -354,11 +839,41 @@ namespace proxy
                 // next timed maintenance wakeup. The drop-log path itself is
                 // still throttled by drop_log_throttle_interval_, so a flood
                 // of failures cannot translate into a flood of log lines.
-                process_resolve_buffer_queue_cv_.notify_one();
+                wake_resolver();
             }
             return packet_filter::packet_action{ packet_filter::packet_action::action_type::drop };
         }
 
+        /**
+         * @brief Wakes the process resolution thread if it is parked.
+         *
+         * The fence pairs with the one the resolver issues after setting resolver_parked_: either
+         * the resolver observes the published queue element before waiting, or this thread
+         * observes the parked flag and notifies under the mutex, so a wake-up cannot be lost.
+         */
+        void wake_resolver()
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (resolver_parked_.load(std::memory_order_relaxed))
+            {
+                std::scoped_lock lock(process_resolve_buffer_mutex_);
+                process_resolve_buffer_queue_cv_.notify_one();
+            }
+        }
+
+        /**
+         * @brief Sets resolver_should_exit_ and wakes the process resolution thread.
+         */
+        void signal_resolver_exit()
+        {
+            {
+                std::scoped_lock lock(process_resolve_buffer_mutex_);
+                resolver_should_exit_.store(true);
+            }
+            process_resolve_buffer_queue_cv_.notify_all();
+        }
+
     public:
         enum supported_protocols : uint8_t
         {
@@ -367,6 +882,29 @@ namespace proxy
             both
         };
 
+        /**
+         * @brief A SOCKS5 proxy and the processes routed through it, see reconfigure().
+         */
+        struct proxy_configuration
+        {
+            std::string endpoint;                               ///< Primary endpoint in "IP:Port" format.
+            std::vector<std::string> alternative_endpoints;     ///< Endpoints added with add_socks5_proxy_endpoint().
+            supported_protocols protocols{ both };              ///< Protocols to be proxied.
+            std::optional<std::pair<std::string, std::string>> credentials; ///< Username and password.
+            std::vector<std::wstring> process_names;            ///< Processes associated with the proxy.
+            size_t connection_pool_size{ 0 };                   ///< Connection pool of a new proxy, see add_socks5_proxy().
+        };
+
+        /**
+         * @brief The proxies, process associations and exclusions of the router, see reconfigure().
+         */
+        struct configuration
+        {
+            std::vector<proxy_configuration> proxies;           ///< SOCKS5 proxies and their processes.
+            std::vector<std::wstring> excluded_process_names;   ///< Process names passed to exclude_process_name().
+            bool bypass_lan{ false };                           ///< Pass the local network ranges, see set_bypass_lan().
+        };
+
         /**
          * The socks_local_router class constructor, used to set up a local router to handle SOCKS traffic.
          * It creates instances of `tcp_local_redirect`, `socks5_udp_local_redirect` and `queued_packet_filter`
@@ -376,70 +914,109 @@ namespace proxy
          *                  For instance, if log_level > netlib::log::log_level::debug, the router creates a pcap file for capturing network packets.
          * @param log_stream Optional reference to an output stream for logging.
          * @param pcap_log_stream Optional reference to an output stream for pcap logging.
+         * @param shard_completion_ports If true, runs one I/O completion port per core group with pinned
+         *                  worker threads; each proxied session stays on the shard it was assigned when
+         *                  accepted and its socket objects are allocated on that shard's NUMA node
+         *                  (relay buffers come from the process-wide, non NUMA aware relay_buffer_pool).
+         * @param fast_tcp_relay If true, relay operations of established TCP sessions that complete
+         *                  immediately are processed inline instead of through the completion port.
+         * @param registered_udp_io If true, the UDP proxy servers receive datagrams from local clients
+         *                  through Registered I/O (RIO) instead of one overlapped WSARecvFrom per datagram.
          */
         explicit socks_local_router(const log_level log_level = log_level::error,
                                     std::shared_ptr<std::ostream> log_stream = nullptr,
-                                    std::shared_ptr<std::ostream> pcap_log_stream = nullptr) :
-                                    logger(log_level, std::move(log_stream)),
-                                    static_filters_{ true, true, log_level_, log_stream_ },
-                                    process_lookup_v4_{ log_level_, log_stream_ },
-                                    process_lookup_v6_{ log_level_, log_stream_ },
-                                    pcap_log_stream_(std::move(pcap_log_stream))
+                                    std::shared_ptr<std::ostream> pcap_log_stream = nullptr,
+                                    const bool shard_completion_ports = false,
+                                    const bool fast_tcp_relay = false,
+                                    const bool registered_udp_io = false) :
+            socks_local_router(true, log_level, std::move(log_stream), std::move(pcap_log_stream),
+                               shard_completion_ports, fast_tcp_relay, registered_udp_io)
         {
-            using namespace std::string_literals;
+        }
 
-            if (pcap_log_stream) {
-                pcap_logger_.emplace(*pcap_log_stream_);
-            }
+        /**
+         * @brief Tag selecting the replay mode constructor.
+         */
+        struct replay_mode_t
+        {
+            explicit replay_mode_t() = default;
+        };
 
-            // Initialize TCP and UDP redirect objects
-            tcp_redirect_ = std::make_unique<ndisapi::tcp_local_redirect<net::ip_address_v4>>(log_level_, log_stream);
-            udp_redirect_ = std::make_unique<ndisapi::socks5_udp_local_redirect<net::ip_address_v4>>(
-                log_level_, log_stream);
-
-            // Initialize packet filter
-            packet_filter_ = std::make_unique<packet_filter>(
-                nullptr,
-                [this](HANDLE, ndisapi::intermediate_buffer& buffer)
-                {
-                    auto* const ethernet_header = reinterpret_cast<ether_header_ptr>(buffer.m_IBuffer);
-                    const auto destination_mac = net::mac_address(ethernet_header->h_dest);
+        /**
+         * @brief Selects the replay mode constructor.
+         */
+        static constexpr replay_mode_t replay_mode{};
 
-                    if (ntohs(ethernet_header->h_proto) != ETH_P_IP)
-                    {
-                        return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
-                    }
+        /**
+         * @brief Constructs a router that is never attached to the driver.
+         *
+         * Neither the packet filter nor the static filters are created, so the driver does not need
+         * to be installed and start() fails. Packets are fed to filter_packet() by the caller, with
+         * the process tables set by set_static_process_table() or, by default, loaded from the system
+         * on construction. Proxies can be added and their local proxy servers are started as usual.
+         * Used to replay captures through the packet path (see netlib/benchmarks/pcap_replay.cpp).
+         *
+         * @param log_level The level of log information to be printed.
+         * @param log_stream Optional reference to an output stream for logging.
+         */
+        socks_local_router(replay_mode_t, const log_level log_level = log_level::error,
+                           std::shared_ptr<std::ostream> log_stream = nullptr) :
+            socks_local_router(false, log_level, std::move(log_stream), nullptr, false, false, false)
+        {
+            // start() is not available to load the tables, without them every flow would be deferred
+            load_process_tables();
+        }
 
-                    log_packet_to_pcap(buffer);
+    private:
+        /**
+         * @brief Constructs the router, attached to the driver unless in replay mode.
+         */
+        socks_local_router(const bool attach_driver,
+                           const log_level log_level,
+                           std::shared_ptr<std::ostream> log_stream,
+                           std::shared_ptr<std::ostream> pcap_log_stream,
+                           const bool shard_completion_ports,
+                           const bool fast_tcp_relay,
+                           const bool registered_udp_io) :
+                           logger(log_level, std::move(log_stream)),
+                           io_ports_{ shard_completion_ports },
+                           fast_tcp_relay_(fast_tcp_relay),
+                           registered_udp_io_(registered_udp_io),
+                           process_lookup_v4_{ log_level_, log_stream_, false },
+                           process_lookup_v6_{ log_level_, log_stream_, false },
+                           pcap_log_stream_(std::move(pcap_log_stream))
+        {
+            using namespace std::string_literals;
 
-                    const auto* const ip_header = reinterpret_cast<iphdr_ptr>(ethernet_header + 1);
+            if (pcap_log_stream_) {
+                pcap_logger_.emplace(*pcap_log_stream_);
+            }
 
-                    if (ip_header->ip_p == IPPROTO_UDP)
-                    {
-                        // skip broadcast and multicast UDP packets
-                        if (destination_mac.is_broadcast() || destination_mac.is_multicast())
-                        {
-                            return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
-                        }
+            // Initialize TCP and UDP redirect objects
+            tcp_redirect_v4_ = std::make_unique<ndisapi::tcp_local_redirect<net::ip_address_v4>>(log_level_, log_stream);
+            tcp_redirect_v6_ = std::make_unique<ndisapi::tcp_local_redirect<net::ip_address_v6>>(log_level_, log_stream);
+            udp_redirect_v4_ = std::make_unique<ndisapi::socks5_udp_local_redirect<net::ip_address_v4>>(
+                log_level_, log_stream);
+            udp_redirect_v6_ = std::make_unique<ndisapi::socks5_udp_local_redirect<net::ip_address_v6>>(
+                log_level_, log_stream);
 
-                        if (const auto result = process_udp_packet(buffer, false))
-                        {
-                            return result.value();
-                        }
-                        return enqueue_for_deferred_resolve(buffer);
-                    }
+            if (!attach_driver)
+                return;
 
-                    if (ip_header->ip_p == IPPROTO_TCP)
-                    {
-                        if (const auto result = process_tcp_packet(buffer, false))
-                        {
-                            return result.value();
-                        }
-                        return enqueue_for_deferred_resolve(buffer);
-                    }
+            static_filters_.emplace(true, true, log_level_, log_stream_);
 
-                    return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
-                });
+            // Initialize packet filter
+            packet_filter_ = std::make_unique<packet_filter>(
+                nullptr,
+                [this](HANDLE, ndisapi::intermediate_buffer& buffer)
+                {
+                    return filter_packet(buffer);
+                },
+                packet_filter::filter_options{
+                    .queue = packet_filter::queue_mode::spsc_ring,
+                    .routing = packet_filter::routing_mode::direct,
+                    .inline_write_threshold = 8,
+                    .block_sizing = packet_filter::block_size_policy::adaptive });
 
             // Set up ICMP filter to pass all ICMP traffic
             ndisapi::filter<net::ip_address_v4> icmp_filter;
@@ -449,9 +1026,20 @@ namespace proxy
                 .set_protocol(IPPROTO_ICMP);
 
             // Add the ICMP filter to the static filters list
-            static_filters_.add_filter_back(icmp_filter);
+            static_filters_->add_filter_back(icmp_filter);
+
+            // Pass ICMPv6 as well, neighbor discovery must not be delayed by the router
+            ndisapi::filter<net::ip_address_v6> icmpv6_filter;
+            icmpv6_filter
+                .set_action(ndisapi::action_t::pass)
+                .set_direction(ndisapi::direction_t::both)
+                .set_protocol(IPPROTO_ICMPV6);
+
+            static_filters_->add_filter_back(icmpv6_filter);
         }
 
+    public:
+
         /**
          * Destructor for the socks_local_router class.
          * It ensures the router stops properly when an instance of the class is destroyed.
@@ -532,6 +1120,11 @@ namespace proxy
             resolver_should_exit_.store(false);
             resolve_queue_dropped_packets_.store(0, std::memory_order_relaxed);
             resolve_queue_alloc_failures_.store(0, std::memory_order_relaxed);
+            resolve_queue_dropped_logged_.store(0, std::memory_order_relaxed);
+            resolve_queue_alloc_failures_logged_.store(0, std::memory_order_relaxed);
+
+            // Decisions cached during a previous run may refer to redirect state that is gone
+            invalidate_flow_cache();
 
             if (!packet_filter_)
             {
@@ -544,6 +1137,40 @@ namespace proxy
                 return false;
             }
 
+            const auto started = std::chrono::steady_clock::now();
+
+            // Load the process tables while the proxies come up, so the first packets find their owners
+            // instead of each paying for a table refresh
+            std::chrono::steady_clock::duration process_tables_time{};
+
+            const auto warm_up = [this, &process_tables_time]
+            {
+                process_tables_time = load_process_tables();
+            };
+
+            std::thread warm_up_thread;
+
+            // The thread references locals of this function, join it on every exit path
+            const auto join_warm_up = gsl::finally([&warm_up_thread]
+            {
+                if (warm_up_thread.joinable())
+                    warm_up_thread.join();
+            });
+
+            try
+            {
+                warm_up_thread = std::thread(warm_up);
+            }
+            catch (const std::system_error&)
+            {
+                warm_up();
+            }
+
+            interface_changes_.start([this](const iphelper::interface_change_queue::batch& changes)
+                {
+                    update_network_configuration(changes);
+                });
+
             if (!this->set_notify_ip_interface_change())
             {
                 NETLIB_LOG(
@@ -552,37 +1179,114 @@ namespace proxy
                     GetLastError());
             }
 
+            const auto proxies_started = std::chrono::steady_clock::now();
+
             {
                 std::shared_lock lock(lock_);
 
                 // Start thread pool
-                io_port_.start_thread_pool();
+                io_ports_.start_thread_pool();
+
+                for (const auto& pool : connection_pools_)
+                {
+                    if (pool)
+                        pool->start();
+                }
+
+                for (const auto& pool : connection_pools_v6_)
+                {
+                    if (pool)
+                        pool->start();
+                }
+
+                for (const auto& group : proxy_groups_)
+                {
+                    if (group)
+                        group->start();
+                }
 
-                // Start proxies
-                for (auto& [tcp, udp] : proxy_servers_)
+                // Without its workers a forwarder rejects the queries, they reach their resolver directly
+                for (const auto& forwarder : dns_forwarders_)
                 {
-                    if (tcp)
+                    if (!forwarder)
+                        continue;
+
+                    try
                     {
-                        if (!tcp->start())
-                        {
-                            NETLIB_LOG(log_level::error, "Failed to start TCP proxy on port: {}", tcp->proxy_port());
-                        }
+                        forwarder->start();
                     }
+                    catch (const std::system_error& e)
+                    {
+                        NETLIB_LOG(log_level::error, "Failed to start a DNS forwarder: {}", e.what());
+                    }
+                }
+
+                // Start proxies, concurrently since each server binds, listens and posts its accepts on its own
+                std::vector<std::function<void()>> server_starts;
 
-                    if (udp)
+                const auto add_server_starts = [this, &server_starts](auto& proxy_servers)
+                {
+                    // The IPv6 ones fail on a host without IPv6, which leaves IPv4 unaffected
+                    constexpr auto failure_level =
+                        std::is_same_v<std::remove_cvref_t<decltype(proxy_servers)>, decltype(proxy_servers_v6_)>
+                            ? log_level::warning
+                            : log_level::error;
+
+                    for (auto& [tcp, udp] : proxy_servers)
                     {
-                        if (!udp->start())
+                        if (tcp)
+                        {
+                            server_starts.emplace_back([this, failure_level, server = tcp.get()]
+                            {
+                                if (!server->start())
+                                {
+                                    NETLIB_LOG(failure_level, "Failed to start TCP proxy on port: {}", server->proxy_port());
+                                }
+                            });
+                        }
+
+                        if (udp)
                         {
-                            NETLIB_LOG(log_level::error, "Failed to start UDP proxy on port: {}", udp->proxy_port());
+                            server_starts.emplace_back([this, failure_level, server = udp.get()]
+                            {
+                                if (!server->start())
+                                {
+                                    NETLIB_LOG(failure_level, "Failed to start UDP proxy on port: {}", server->proxy_port());
+                                }
+                            });
                         }
                     }
-                }
+                };
+
+                add_server_starts(proxy_servers_);
+                add_server_starts(proxy_servers_v6_);
+
+                run_concurrently(server_starts);
+            }
+
+            startup_proxies_us_.store(elapsed_us(proxies_started), std::memory_order_relaxed);
+
+            {
+                // Local proxy ports are assigned when the proxies bind, publish them to the packet path
+                std::scoped_lock lock(lock_);
+                publish_routing_snapshot();
             }
 
             process_resolve_thread_ = std::thread(&socks_local_router::process_resolve_thread_proc, this);
 
             // Update network configuration and start filter
+            const auto network_started = std::chrono::steady_clock::now();
             update_network_configuration();
+
+            // The filter goes live with the tables loaded
+            if (warm_up_thread.joinable())
+                warm_up_thread.join();
+
+            startup_network_us_.store(elapsed_us(network_started), std::memory_order_relaxed);
+            startup_process_tables_us_.store(
+                std::chrono::duration_cast<std::chrono::microseconds>(process_tables_time).count(),
+                std::memory_order_relaxed);
+
             if (!packet_filter_->start_filter())
             {
                 NETLIB_LOG(log_level::error, "Failed to start NDIS packet filter");
@@ -600,43 +1304,83 @@ namespace proxy
                         GetLastError());
                 }
 
+                interface_changes_.stop();
+
                 // Collect raw proxy pointers under lock_ but stop them outside
                 // the lock. Proxy cleanup threads may need to acquire the
                 // same mutex, so holding lock_ across stop() can deadlock.
                 // This mirrors the pattern used in stop().
-                std::vector<std::pair<s5_tcp_proxy_server*, s5_udp_proxy_server*>> proxies_to_stop;
+                std::vector<std::pair<s5_tcp_proxy_server<net::ip_address_v4>*,
+                                      s5_udp_proxy_server<net::ip_address_v4>*>> proxies_to_stop;
+                std::vector<std::pair<s5_tcp_proxy_server<net::ip_address_v6>*,
+                                      s5_udp_proxy_server<net::ip_address_v6>*>> proxies_to_stop_v6;
                 {
                     std::shared_lock lock(lock_);
                     proxies_to_stop.reserve(proxy_servers_.size());
                     for (auto& [tcp, udp] : proxy_servers_)
                         proxies_to_stop.emplace_back(tcp.get(), udp.get());
+
+                    proxies_to_stop_v6.reserve(proxy_servers_v6_.size());
+                    for (auto& [tcp, udp] : proxy_servers_v6_)
+                        proxies_to_stop_v6.emplace_back(tcp.get(), udp.get());
                 }
 
                 // Stop all proxies without holding lock_.
-                for (auto& [tcp, udp] : proxies_to_stop)
+                const auto stop_proxies = [](const auto& proxies)
+                {
+                    for (auto& [tcp, udp] : proxies)
+                    {
+                        if (tcp)
+                            tcp->stop();
+
+                        if (udp)
+                            udp->stop();
+                    }
+                };
+
+                stop_proxies(proxies_to_stop);
+                stop_proxies(proxies_to_stop_v6);
+
+                for (const auto& pool : connection_pools_)
                 {
-                    if (tcp)
-                        tcp->stop();
+                    if (pool)
+                        pool->stop();
+                }
+
+                for (const auto& pool : connection_pools_v6_)
+                {
+                    if (pool)
+                        pool->stop();
+                }
 
-                    if (udp)
-                        udp->stop();
+                for (const auto& group : proxy_groups_)
+                {
+                    if (group)
+                        group->stop();
+                }
+
+                for (const auto& forwarder : dns_forwarders_)
+                {
+                    if (forwarder)
+                        forwarder->stop();
                 }
 
                 // Stop the thread pool associated with the I/O completion port.
-                io_port_.stop_thread_pool();
+                io_ports_.stop_thread_pool();
 
                 is_active_.store(false);
 
                 // The packet filter never started in this error branch, so
                 // no callback thread can still be enqueuing — safe to
                 // signal resolver shutdown directly.
-                resolver_should_exit_.store(true);
-                process_resolve_buffer_queue_cv_.notify_all();
+                signal_resolver_exit();
 
                 if (process_resolve_thread_.joinable())
                     process_resolve_thread_.join();
             }
 
+            startup_total_us_.store(elapsed_us(started), std::memory_order_relaxed);
+
             return is_active_;
         }
 
@@ -676,24 +1420,48 @@ namespace proxy
             // which would otherwise leave them stranded in
             // process_resolve_buffer_queue_.
             NETLIB_DEBUG("Stopping process resolve thread");
-            resolver_should_exit_.store(true);
-            process_resolve_buffer_queue_cv_.notify_all();
+            signal_resolver_exit();
 
             if (process_resolve_thread_.joinable())
                 process_resolve_thread_.join();
 
+            // No query can be forwarded anymore, the responses still in flight are discarded
+            for (const auto& forwarder : dns_forwarders_)
+            {
+                if (forwarder)
+                    forwarder->stop();
+            }
+
+            // The resolver maintained the bypassed flows, nothing can add new ones now
+            if (kernel_bypass_v4_ && static_filters_)
+            {
+                std::scoped_lock filters_lock(static_filters_lock_);
+                if (!kernel_bypass_v4_->clear(*static_filters_) || !kernel_bypass_v6_->clear(*static_filters_))
+                    NETLIB_WARNING("Failed to remove the kernel bypass filters from the driver");
+            }
+
             // Step 3: Stop all redirect objects FIRST to stop their cleanup threads
             // CRITICAL: Stop redirects before stopping proxies to ensure cleanup threads finish
             NETLIB_DEBUG("Stopping redirect objects");
 
-            if (tcp_redirect_)
+            if (tcp_redirect_v4_)
+            {
+                tcp_redirect_v4_->stop();  // This should join the cleanup thread
+            }
+
+            if (tcp_redirect_v6_)
             {
-                tcp_redirect_->stop();  // This should join the cleanup thread
+                tcp_redirect_v6_->stop();
             }
 
-            if (udp_redirect_)
+            if (udp_redirect_v4_)
                 {
-                udp_redirect_->stop();  // This should join the cleanup thread
+                udp_redirect_v4_->stop();  // This should join the cleanup thread
+            }
+
+            if (udp_redirect_v6_)
+            {
+                udp_redirect_v6_->stop();
             }
 
             // Step 4: Stop all proxy servers WITHOUT holding lock_
@@ -718,12 +1486,48 @@ namespace proxy
             }
             }
 
+            NETLIB_DEBUG("Stopping {} IPv6 proxy pairs", proxy_servers_v6_.size());
+
+            for (size_t i = 0; i < proxy_servers_v6_.size(); ++i)
+            {
+                if (proxy_servers_v6_[i].first)
+                {
+                    NETLIB_DEBUG("Stopping IPv6 TCP proxy #{} on port {}", i, proxy_servers_v6_[i].first->proxy_port());
+                    proxy_servers_v6_[i].first->stop();
+                }
+
+                if (proxy_servers_v6_[i].second)
+                {
+                    NETLIB_DEBUG("Stopping IPv6 UDP proxy #{} on port {}", i, proxy_servers_v6_[i].second->proxy_port());
+                    proxy_servers_v6_[i].second->stop();
+                }
+            }
+
+            // Close the warm SOCKS5 connections, nothing claims them anymore
+            for (const auto& pool : connection_pools_)
+            {
+                if (pool)
+                    pool->stop();
+            }
+
+            for (const auto& pool : connection_pools_v6_)
+            {
+                if (pool)
+                    pool->stop();
+            }
+
+            for (const auto& group : proxy_groups_)
+            {
+                if (group)
+                    group->stop();
+            }
+
             // Step 5: Stop the IOCP thread pool
             // At this point, all handlers registered by the proxy servers have been
             // unregistered by their respective stop() methods, so no new completions
             // will invoke callbacks that access destroyed objects.
             NETLIB_DEBUG("Stopping IOCP thread pool");
-            io_port_.stop_thread_pool();
+            io_ports_.stop_thread_pool();
 
             // Step 6: Cancel IP interface change notifications
             // Attempt to cancel notification of IP interface changes
@@ -767,6 +1571,17 @@ namespace proxy
                 NETLIB_DEBUG("All network interface callbacks completed");
             }
 
+            // Step 8: Stop the worker applying the coalesced interface changes
+            // No callback is left to post to the queue, a batch being applied is waited for.
+            interface_changes_.stop();
+
+            if (pcap_logger_)
+            {
+                const auto capture = pcap_logger_->get_statistics();
+                NETLIB_INFO("Packet capture: {} packet(s) written, {} dropped, {} truncated, {} write error(s)",
+                            capture.written, capture.dropped, capture.truncated, capture.write_errors);
+            }
+
             NETLIB_INFO("socks_local_router stopped successfully");
 
             // Return the current active status (which should now be false)
@@ -774,228 +1589,413 @@ namespace proxy
         }
 
         /**
-         * @brief Enables LAN traffic bypass by adding pass-through filters.
+         * @brief Captures the packets seen by the router into pcap files, replacing the capture
+         *        set up with the constructor's pcap_log_stream, if any.
          *
-         * When called, traffic to/from local network ranges (10.x.x.x, 172.16.x.x-172.31.x.x,
-         * 192.168.x.x, 224.0.0.x, 169.254.x.x) will pass through without being proxied.
+         * With options.format set to pcapng, each TCP/UDP packet is recorded once the router has
+         * decided on it, with a comment naming the owner process, its proxy and the action; a
+         * packet the router rewrites is recorded both as received and as rewritten.
          *
-         * @note This must be called before start() to take effect.
+         * Must be called while the router is stopped.
+         *
+         * @param options Output file, rotation and snap length settings.
+         * @return false if the router is running or the first capture file cannot be created.
          */
-        void set_bypass_lan() noexcept
+        bool start_pcap_capture(pcap::pcap_async_writer::file_options options)
         {
-            add_lan_passover_filters_v4();
+            std::scoped_lock lifecycle_lock(lifecycle_mutex_);
+
+            if (is_active_.load(std::memory_order_acquire))
+            {
+                NETLIB_LOG(log_level::error, "Packet capture can only be configured while the router is stopped");
+                return false;
+            }
+
+            try
+            {
+                pcap_annotate_ = false;
+                pcap_logger_.reset();
+                pcap_logger_.emplace(std::move(options));
+                pcap_annotate_ = pcap_logger_->format() == pcap::pcap_async_writer::file_format::pcapng;
+                return true;
+            }
+            catch (const std::exception& e)
+            {
+                NETLIB_LOG(log_level::error, "Failed to start packet capture: {}", e.what());
+                pcap_logger_.reset();
+                return false;
+            }
         }
 
         /**
-         * Checks whether the associated driver is loaded or not.
-         * @return boolean representing the load status of the driver (true if loaded, false if not).
+         * @brief Stops the packet capture and writes out the packets still queued.
+         *
+         * Must be called while the router is stopped.
+         *
+         * @return false if the router is running.
          */
-        bool is_driver_loaded() const
+        bool stop_pcap_capture()
         {
-            return packet_filter_->IsDriverLoaded();
+            std::scoped_lock lifecycle_lock(lifecycle_mutex_);
+
+            if (is_active_.load(std::memory_order_acquire))
+                return false;
+
+            pcap_annotate_ = false;
+            pcap_logger_.reset();
+            return true;
         }
 
         /**
-         * Add a SOCKS5 proxy and optionally starts it.
-         * @param endpoint string representing the endpoint of the SOCKS5 proxy server.
-         * @param protocols enum representing the protocols to be proxied.
-         * @param cred_pair optional pair of strings representing username and password for authentication.
-         * @param start boolean flag to start the proxy server after creating it.
-         * @return an optional value containing the index of the added proxy server if successful, std::nullopt otherwise.
+         * @brief Restricts the packet capture to selected flows and/or samples it.
+         *
+         * Packets are selected by owner process name, proxy id and endpoint rules and then
+         * optionally sampled 1-in-N or limited to the first K packets per flow, see
+         * pcap_capture_filter. Must be called while the router is stopped.
+         *
+         * @param options Selection and sampling settings, std::nullopt to capture every packet.
+         * @return false if the router is running.
          */
-        std::optional<size_t> add_socks5_proxy(
-            const std::string& endpoint,
-            const supported_protocols protocols,
-            const std::optional<std::pair<std::string, std::string>>& cred_pair,
-            const bool start = false
-        )
+        bool set_pcap_capture_filter(std::optional<pcap_capture_filter::options> options)
         {
-            using namespace std::string_literals;
-
-            // Parse the endpoint to an IP address and port number. This may
-            // perform a blocking DNS lookup via getaddrinfo, so it is
-            // intentionally done OUTSIDE lifecycle_mutex_ so that a concurrent
-            // start()/stop() cannot be stalled by name resolution.
-            auto proxy_endpoint = parse_endpoint(endpoint);
+            std::scoped_lock lifecycle_lock(lifecycle_mutex_);
 
-            // If parsing failed, log the error and return nullopt
-            if (!proxy_endpoint)
+            if (is_active_.load(std::memory_order_acquire))
             {
-                NETLIB_LOG(log_level::error, "Failed to parse the proxy endpoint {}", endpoint);
-                return {};
+                NETLIB_LOG(log_level::error, "The capture filter can only be configured while the router is stopped");
+                return false;
             }
 
-            // Serialize the lifecycle-state mutations (filter list, proxy
-            // construction/start, and proxy_servers_ insertion) against
-            // start()/stop() so that this function cannot register/start a
-            // proxy concurrently with start() failure cleanup (which would
-            // otherwise leave a running proxy that the cleanup snapshot of
-            // proxy_servers_ has already missed) or with stop().
-            std::scoped_lock lifecycle_lock(lifecycle_mutex_);
-
-            // Construct filter objects for the TCP and UDP traffic to and from the proxy server
-            // These filters are used to decide which packets to pass or drop
-            // They are configured to match packets based on their source/destination IP and port numbers
-            // and their protocol (TCP or UDP)
-            auto create_filter = [](const uint8_t protocol, const ndisapi::direction_t direction,
-                const net::ip_address_v4& address, const uint16_t port)
-            {
-                ndisapi::filter<net::ip_address_v4> filter;
-                filter.set_protocol(protocol)
-                      .set_direction(direction)
-                      .set_action(ndisapi::action_t::pass)
-                    .set_dest_address(net::ip_subnet{ address, net::ip_address_v4{"255.255.255.255"} })
-                      .set_dest_port(std::make_pair(port, port));
-                return filter;
-            };
+            pcap_filter_ = options ? std::make_unique<pcap_capture_filter>(std::move(options.value())) : nullptr;
+            return true;
+        }
 
-            const auto tcp_out_filter = create_filter(IPPROTO_TCP, ndisapi::direction_t::out, proxy_endpoint.value().ip,
-                                                      proxy_endpoint.value().port);
-            const auto tcp_in_filter = create_filter(IPPROTO_TCP, ndisapi::direction_t::in, proxy_endpoint.value().ip,
-                                                     proxy_endpoint.value().port);
-            const auto udp_out_filter = create_filter(IPPROTO_UDP, ndisapi::direction_t::out, proxy_endpoint.value().ip,
-                                                      proxy_endpoint.value().port);
-            const auto udp_in_filter = create_filter(IPPROTO_UDP, ndisapi::direction_t::in, proxy_endpoint.value().ip,
-                                                     proxy_endpoint.value().port);
+        /**
+         * @brief Enables or disables passing busy unproxied flows in the driver.
+         *
+         * Once a flow the router passes unchanged has sent options.promote_after packets through
+         * user mode, a pair of static filters matching the flow is installed so its following
+         * packets are passed in the kernel, see kernel_bypass_table. Bypassed packets are no longer
+         * seen by the router, so they are missing from packet captures. Must be called while the
+         * router is stopped.
+         *
+         * @param options Kernel bypass settings applied to IPv4 and IPv6 flows each, std::nullopt to disable.
+         * @return false if the router is running.
+         */
+        bool set_kernel_bypass(std::optional<kernel_bypass_v4::options> options)
+        {
+            std::scoped_lock lifecycle_lock(lifecycle_mutex_);
 
-            // Add the filters to a filter list
-            // Apply all the filters to the network traffic
-            if (protocols == both || protocols == udp)
+            if (is_active_.load(std::memory_order_acquire))
             {
-                static_filters_.add_filter_back(tcp_out_filter);
-                static_filters_.add_filter_back(tcp_in_filter);
-                static_filters_.add_filter_back(udp_out_filter);
-                static_filters_.add_filter_back(udp_in_filter);
+                NETLIB_LOG(log_level::error, "Kernel bypass can only be configured while the router is stopped");
+                return false;
             }
-            else if (protocols == tcp)
+
+            if (!options)
             {
-                static_filters_.add_filter_back(tcp_out_filter);
-                static_filters_.add_filter_back(tcp_in_filter);
+                kernel_bypass_v4_.reset();
+                kernel_bypass_v6_.reset();
+                return true;
             }
 
-            try
-            {
-                // Create TCP and UDP proxy server objects and start them if required
+            kernel_bypass_v4_ = std::make_unique<kernel_bypass_v4>(options.value());
+            kernel_bypass_v6_ = std::make_unique<kernel_bypass_v6>(kernel_bypass_v6::options{
+                options->max_flows, options->promote_after, options->lease });
+            return true;
+        }
 
-                auto socks_tcp_proxy_server = (protocols == both || protocols == tcp)
-                                                  ? std::make_unique<s5_tcp_proxy_server>(
-                                                      0, io_port_, [this, endpoint = proxy_endpoint.value(), cred_pair](
-                                                      const net::ip_address_v4 address, const uint16_t port)->
-                                                      std::tuple<net::ip_address_v4, uint16_t, std::unique_ptr<
-                                                                     s5_tcp_proxy_server::negotiate_context_t>>
-                                                      {
-                                                          std::scoped_lock lock(tcp_mapper_lock_);
-
-                                                          if (const auto it = tcp_mapper_.find(port); it != tcp_mapper_.
-                                                              end())
-                                                          {
-                                                              // Discard stale entries whose age has exceeded the TTL.
-                                                              // Eviction is performed asynchronously by the resolver
-                                                              // thread and may be delayed, so validate age at lookup
-                                                              // time to avoid misrouting a new connection on a reused
-                                                              // source port.
-                                                              if (std::chrono::steady_clock::now() - it->second.created_at
-                                                                  > tcp_mapper_entry_ttl_)
-                                                              {
-                                                                  NETLIB_LOG(log_level::warning,
-                                                                            "TCP Redirect entry for port {} was stale (age exceeded TTL); discarding.",
-                                                                            port);
-                                                                  tcp_mapper_.erase(it);
-                                                                  return std::make_tuple(net::ip_address_v4{}, 0, nullptr);
-                                                              }
-
-                                                              NETLIB_LOG(log_level::info,
-                                                                        "TCP Redirect entry was found for the {} : {} is {} : {}",
-                                                                        address, port, net::ip_address_v4{it->second.endpoint.ip}, it->second.endpoint.port);
-
-                                                              auto remote_address = it->second.endpoint.ip;
-                                                              auto remote_port = it->second.endpoint.port;
-
-                                                              tcp_mapper_.erase(it);
-
-                                                              return std::make_tuple(endpoint.ip, endpoint.port,
-                                                                  std::make_unique<
-                                                                      s5_tcp_proxy_server::negotiate_context_t>(
-                                                                      remote_address, remote_port,
-                                                                      cred_pair
-                                                                          ? std::optional(cred_pair.value().first)
-                                                                          : std::nullopt,
-                                                                      cred_pair
-                                                                          ? std::optional(cred_pair.value().second)
-                                                                          : std::nullopt));
-                                                          }
-
-                                                          return std::make_tuple(net::ip_address_v4{}, 0, nullptr);
-                                                      }, log_level_, log_stream_)
-                                                  : nullptr;
-
-                auto socks_udp_proxy_server = (protocols == both || protocols == udp)
-                                                  ? std::make_unique<s5_udp_proxy_server>(
-                                                      0, io_port_, [this, endpoint = proxy_endpoint.value(), cred_pair](
-                                                      const net::ip_address_v4 address, const uint16_t port)->
-                                                      std::tuple<net::ip_address_v4, uint16_t, std::unique_ptr<
-                                                                     s5_udp_proxy_server::negotiate_context_t>>
-                                                      {
-                                                          std::scoped_lock lock(udp_mapper_lock_);
-
-                                                          if (const auto it = udp_mapper_.find(port); it != udp_mapper_.
-                                                              end())
-                                                          {
-                                                              NETLIB_LOG(log_level::info,
-                                                                        "UDP Redirect entry was found for the {} : {}",
-                                                                        address, port);
-
-                                                              udp_mapper_.erase(it);
-
-                                                              return std::make_tuple(endpoint.ip, endpoint.port,
-                                                                  std::make_unique<
-                                                                      s5_udp_proxy_server::negotiate_context_t>(
-                                                                      net::ip_address_v4{}, 0,
-                                                                      cred_pair
-                                                                          ? std::optional(cred_pair.value().first)
-                                                                          : std::nullopt,
-                                                                      cred_pair
-                                                                          ? std::optional(cred_pair.value().second)
-                                                                          : std::nullopt));
-                                                          }
-
-                                                          return std::make_tuple(net::ip_address_v4{}, 0, nullptr);
-                                                      }, log_level_, log_stream_)
-                                                  : nullptr;
-
-                if (start) // optionally start proxies
-                {
-                    // If successful in starting the servers, log the local listening ports
-                    if (socks_tcp_proxy_server)
-                    {
-                        if (!socks_tcp_proxy_server->start())
-                        {
-                            NETLIB_LOG(log_level::error, "Failed to start TCP SOCKS5 proxy {}", endpoint);
-                            return {};
-                        }
+        /**
+         * @brief Returns the kernel bypass counters of IPv4 and IPv6 flows summed, or std::nullopt
+         *        if kernel bypass is disabled.
+         */
+        [[nodiscard]] std::optional<kernel_bypass_v4::statistics> get_kernel_bypass_statistics() const
+        {
+            if (!kernel_bypass_v4_)
+                return std::nullopt;
 
-                        NETLIB_LOG(log_level::info,
-                                  "Local TCP proxy for {} is listening port: {}", endpoint, socks_tcp_proxy_server->proxy_port());
-                    }
+            const auto v4 = kernel_bypass_v4_->get_statistics();
+            const auto v6 = kernel_bypass_v6_->get_statistics();
 
-                    if (socks_udp_proxy_server)
-                    {
-                        if (!socks_udp_proxy_server->start())
-                        {
-                            NETLIB_LOG(log_level::error, "Failed to start UDP SOCKS5 proxy {}", endpoint);
-                            return {};
-                        }
+            return kernel_bypass_v4::statistics{
+                v4.installed + v6.installed, v4.promoted + v6.promoted, v4.expired + v6.expired,
+                v4.flushed + v6.flushed, v4.table_full + v6.table_full, v4.failed + v6.failed };
+        }
+
+        /**
+         * @brief Enables or disables DNS forwarding through a SOCKS5 proxy.
+         *
+         * The UDP DNS queries of the processes associated with the proxy, IPv4 and IPv6 alike, are
+         * taken from the stack and resolved by a socks5_dns_forwarder through the proxy instead of
+         * reaching their resolver directly, so the lookups of proxied applications do not leak to
+         * the local network. Repeated questions are answered from the forwarder cache without
+         * leaving the host. The queries of other processes are passed unchanged. Must be called
+         * while the router is stopped.
+         *
+         * @param proxy_id The ID of the proxy, as returned by add_socks5_proxy().
+         * @param options Forwarder settings (upstream resolver, UDP or TCP transport, cache), std::nullopt to disable.
+         * @return false if the router is running or the proxy ID is out of range.
+         */
+        bool set_dns_forwarding(const size_t proxy_id, const std::optional<dns_forwarder::options>& options)
+        {
+            std::scoped_lock lifecycle_lock(lifecycle_mutex_);
+
+            if (is_active_.load(std::memory_order_acquire))
+            {
+                NETLIB_LOG(log_level::error, "DNS forwarding can only be configured while the router is stopped");
+                return false;
+            }
+
+            bool enabled;
+
+            {
+                std::scoped_lock lock(lock_);
+
+                if (proxy_id >= proxy_servers_.size() || !proxy_groups_[proxy_id])
+                {
+                    NETLIB_LOG(log_level::error, "set_dns_forwarding: proxy index is out of range!");
+                    return false;
+                }
+
+                try
+                {
+                    const auto& [endpoint, cred_pair] = proxy_endpoints_[proxy_id];
+
+                    auto forwarder = options
+                        ? std::make_shared<dns_forwarder>(
+                            endpoint.ip, endpoint.port,
+                            cred_pair ? std::optional(cred_pair.value().first) : std::nullopt,
+                            cred_pair ? std::optional(cred_pair.value().second) : std::nullopt,
+                            options.value(), log_level_, log_stream_)
+                        : nullptr;
 
-                        NETLIB_LOG(log_level::info,
-                                  "Local UDP proxy for {} is listening port: {}", endpoint, socks_udp_proxy_server->proxy_port());
+                    dns_forwarders_[proxy_id].swap(forwarder);
+
+                    if (!publish_routing_snapshot())
+                    {
+                        dns_forwarders_[proxy_id].swap(forwarder);
+                        return false;
                     }
                 }
+                catch (const std::exception& e)
+                {
+                    NETLIB_LOG(log_level::error, "Exception configuring DNS forwarding: {}", e.what());
+                    return false;
+                }
+
+                enabled = std::ranges::any_of(dns_forwarders_, [](const auto& forwarder) { return forwarder != nullptr; });
+            }
+
+            update_dns_redirect_filters(enabled);
+
+            return true;
+        }
+
+        /**
+         * @brief Returns the DNS forwarding counters of a proxy, or std::nullopt if it does not forward DNS.
+         *
+         * @param proxy_id The ID of the proxy.
+         */
+        [[nodiscard]] std::optional<dns_forwarder::statistics> get_dns_forwarding_statistics(const size_t proxy_id)
+        {
+            std::shared_lock lock(lock_);
+
+            if (proxy_id >= dns_forwarders_.size() || !dns_forwarders_[proxy_id])
+                return std::nullopt;
+
+            return dns_forwarders_[proxy_id]->get_statistics();
+        }
+
+        /**
+         * @brief Returns the packet capture counters, or std::nullopt if no capture is active.
+         *
+         * Must not be called concurrently with start_pcap_capture() or stop_pcap_capture().
+         */
+        [[nodiscard]] std::optional<pcap::pcap_async_writer::statistics> get_pcap_statistics() const
+        {
+            if (!pcap_logger_)
+                return std::nullopt;
+
+            return pcap_logger_->get_statistics();
+        }
+
+        /**
+         * @brief Enables LAN traffic bypass by adding pass-through filters.
+         *
+         * When called, traffic to/from local network ranges (10.x.x.x, 172.16.x.x-172.31.x.x,
+         * 192.168.x.x, 224.0.0.x, 169.254.x.x, and the IPv6 unique local, link-local and multicast
+         * ranges) will pass through without being proxied.
+         *
+         * @note This must be called before start() to take effect.
+         */
+        void set_bypass_lan() noexcept
+        {
+            update_lan_bypass_filters(true);
+        }
+
+        /**
+         * Checks whether the associated driver is loaded or not.
+         * @return boolean representing the load status of the driver (true if loaded, false if not).
+         */
+        bool is_driver_loaded() const
+        {
+            return packet_filter_ && packet_filter_->IsDriverLoaded();
+        }
+
+        /**
+         * @brief Takes the routing decision of the packet filter on an Ethernet frame.
+         *
+         * This is the callback the router installs into the packet filter: redirected packets are
+         * rewritten in place, packets whose owner is not known yet are queued for the resolver
+         * thread and the packet is written to the pcap log if one is configured. Callers may also
+         * drive the packet path with their own frames, e.g. a router in replay mode fed from a
+         * capture (see netlib/benchmarks/pcap_replay.cpp) or synthetic frames (see
+         * netlib/benchmarks/packet_path_benchmark.cpp).
+         *
+         * Caller frames must be allocated from ndisapi::intermediate_buffer_pool: a deferred packet is
+         * taken out of a buffer attached to a packet block and copied from any other pool buffer (see
+         * ndisapi::intermediate_buffer_pool::steal()).
+         *
+         * @param buffer The frame, m_dwDeviceFlags gives its direction.
+         * @return The action the packet filter takes on the frame.
+         */
+        packet_filter::packet_action filter_packet(ndisapi::intermediate_buffer& buffer)
+        {
+            const auto ether_type = ntohs(reinterpret_cast<ether_header_ptr>(buffer.m_IBuffer)->h_proto);
+
+            if (ether_type != ETH_P_IP && ether_type != ETH_P_IPV6)
+            {
+                return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
+            }
+
+            const auto filter = [this, ether_type](ndisapi::intermediate_buffer& packet)
+            {
+                return ether_type == ETH_P_IP
+                           ? filter_ip_packet<net::ip_address_v4>(packet)
+                           : filter_ip_packet<net::ip_address_v6>(packet);
+            };
+
+            if (pcap_annotate_)
+            {
+                // pcapng records are written once the router has decided on the packet
+                begin_pcap_packet(buffer);
+                const auto action = filter(buffer);
+                end_pcap_packet(buffer, action.action);
+                return action;
+            }
+
+            if (pcap_logger_)
+            {
+                // The rewritten copy of the packet is recorded if the packet as received is
+                auto& context = pcap_context();
+                context.pending = !pcap_filter_ || pcap_filter_->should_capture(buffer);
+
+                if (context.pending)
+                    pcap_logger_.value() << buffer;
+
+                context.active = true;
+                const auto leave = gsl::finally([&context] { context.active = false; });
+
+                return filter(buffer);
+            }
+
+            return filter(buffer);
+        }
+
+        /**
+         * @brief Replaces the process tables of an address family with a fixed set of owners.
+         *
+         * The tables are no longer refreshed from the system and flows without a listed owner are
+         * attributed to @p fallback, see iphelper::process_lookup::set_static_table(). Meant for a
+         * router in replay mode, where the owners of the captured flows no longer exist.
+         *
+         * @tparam T The address family.
+         * @param tcp Owners of TCP sessions, keyed by local and remote endpoint.
+         * @param udp Owners of UDP endpoints.
+         * @param fallback Owner of the unlisted flows, the default SYSTEM process if null.
+         */
+        template <net::ip_address T>
+        void set_static_process_table(
+            const std::vector<std::pair<net::ip_session<T>, std::shared_ptr<iphelper::network_process>>>& tcp,
+            const std::vector<std::pair<net::ip_endpoint<T>, std::shared_ptr<iphelper::network_process>>>& udp,
+            std::shared_ptr<iphelper::network_process> fallback = nullptr)
+        {
+            per_family<T>(process_lookup_v4_, process_lookup_v6_).set_static_table(tcp, udp, std::move(fallback));
+
+            // Decisions taken for the previous owners must not be reused
+            invalidate_flow_cache();
+        }
+
+        /**
+         * Add a SOCKS5 proxy and optionally starts it.
+         * @param endpoint string representing the endpoint of the SOCKS5 proxy server.
+         * @param protocols enum representing the protocols to be proxied.
+         * @param cred_pair optional pair of strings representing username and password for authentication.
+         * @param start boolean flag to start the proxy server after creating it.
+         * @param connection_pool_size number of pre-connected, pre-authenticated connections kept to the
+         *        SOCKS5 proxy, so that new TCP and UDP sessions skip the connect and authentication round
+         *        trips (0 disables the pool).
+         * @param connection_pool_ttl lifetime of an unclaimed pooled connection, should stay below the
+         *        proxy's own negotiation timeout.
+         * @return an optional value containing the index of the added proxy server if successful, std::nullopt otherwise.
+         */
+        std::optional<size_t> add_socks5_proxy(
+            const std::string& endpoint,
+            const supported_protocols protocols,
+            const std::optional<std::pair<std::string, std::string>>& cred_pair,
+            const bool start = false,
+            const size_t connection_pool_size = 0,
+            const std::chrono::seconds connection_pool_ttl =
+                proxy::socks5_connection_pool<net::ip_address_v4>::default_ttl
+        )
+        {
+            using namespace std::string_literals;
+
+            // Parse the endpoint to an IP address and port number. This may
+            // perform a blocking DNS lookup via getaddrinfo, so it is
+            // intentionally done OUTSIDE lifecycle_mutex_ so that a concurrent
+            // start()/stop() cannot be stalled by name resolution.
+            const auto resolution_started = std::chrono::steady_clock::now();
+            auto proxy_endpoint = parse_endpoint(endpoint);
+            endpoint_resolution_us_.fetch_add(elapsed_us(resolution_started), std::memory_order_relaxed);
+
+            // If parsing failed, log the error and return nullopt
+            if (!proxy_endpoint)
+            {
+                NETLIB_LOG(log_level::error, "Failed to parse the proxy endpoint {}", endpoint);
+                return {};
+            }
+
+            // Serialize the lifecycle-state mutations (filter list, proxy
+            // construction/start, and proxy_servers_ insertion) against
+            // start()/stop() so that this function cannot register/start a
+            // proxy concurrently with start() failure cleanup (which would
+            // otherwise leave a running proxy that the cleanup snapshot of
+            // proxy_servers_ has already missed) or with stop().
+            std::scoped_lock lifecycle_lock(lifecycle_mutex_);
+
+            add_proxy_pass_filters(proxy_endpoint.value(), protocols);
+
+            try
+            {
+                auto proxy = create_proxy(endpoint, proxy_endpoint.value(), protocols, cred_pair, start,
+                                          connection_pool_size, connection_pool_ttl);
+                if (!proxy)
+                    return {};
 
                 // Lock the mutex to safely add the proxy servers to the shared data structure
                 std::scoped_lock lock(lock_);
 
-                proxy_servers_.emplace_back(
-                    std::move(socks_tcp_proxy_server), std::move(socks_udp_proxy_server));
+                push_proxy(std::move(proxy.value()));
+
+                if (!publish_routing_snapshot())
+                {
+                    // Keep proxy_servers_ consistent with what the packet path can observe
+                    pop_proxy();
+                    return {};
+                }
+
+                invalidate_flow_cache();
 
                 return proxy_servers_.size() - 1; // Return the index of the added proxy server
             }
@@ -1009,108 +2009,791 @@ namespace proxy
         }
 
         /**
-         * Associates a process name to a specific proxy ID. This function is thread-safe.
-         * @param process_name the name of the process to associate with a proxy
-         * @param proxy_id the ID of the proxy server to associate with the process
-         * @return True if the association was successful, False otherwise
+         * @brief Adds an alternative SOCKS5 endpoint to a proxy.
+         *
+         * New sessions of the proxy start on whichever of its endpoints the selection policy prefers
+         * (see set_proxy_selection()), skipping endpoints that failed their health probes. The
+         * endpoint must accept the credentials of the proxy. Sessions already running are not moved.
+         *
+         * @param proxy_id The ID of the proxy, as returned by add_socks5_proxy().
+         * @param endpoint The alternative endpoint in "IP:Port" format.
+         * @return true if the endpoint was added, false if it is invalid, already part of the proxy or
+         *         the proxy does not exist.
          */
-        bool associate_process_name_to_proxy(const std::wstring& process_name, const size_t proxy_id)
+        bool add_socks5_proxy_endpoint(const size_t proxy_id, const std::string& endpoint)
         {
-            // The lock_guard object acquires the lock in a safe manner,
-            // ensuring it gets released even if an exception is thrown.
-            std::scoped_lock lock(lock_);
+            // May perform a blocking DNS lookup, see add_socks5_proxy()
+            const auto proxy_endpoint = parse_endpoint(endpoint);
 
-            // Check if the provided proxy ID is within the range of available proxies
-            if (proxy_id >= proxy_servers_.size())
+            if (!proxy_endpoint)
             {
-                NETLIB_LOG(log_level::error,
-                    "associate_process_name_to_proxy: proxy index is out of range!");
-                return false; // Return false since the proxy_id is out of range
+                NETLIB_LOG(log_level::error, "Failed to parse the proxy endpoint {}", endpoint);
+                return false;
             }
 
-            try
+            std::shared_ptr<proxy::proxy_group> group;
+            supported_protocols protocols;
+
             {
-                // Associate the given process name to the specified proxy ID.
-                proxy_to_names_.emplace(proxy_id, to_upper(process_name));
-            }
-            catch (const std::exception& e) {
-                NETLIB_LOG(log_level::error, "Exception associating process name to proxy: {}", e.what());
-                return false; // Return false if any exception occurs during the association
+                std::shared_lock lock(lock_);
+
+                if (proxy_id >= proxy_groups_.size() || !proxy_groups_[proxy_id])
+                {
+                    NETLIB_LOG(log_level::error, "add_socks5_proxy_endpoint: proxy index is out of range!");
+                    return false;
+                }
+
+                group = proxy_groups_[proxy_id];
+
+                const auto& [tcp_server, udp_server] = proxy_servers_[proxy_id];
+                protocols = tcp_server && udp_server ? both : tcp_server ? tcp : udp;
             }
-            catch (...) {
-                NETLIB_LOG(log_level::error, "Unknown exception associating process name to proxy.");
+
+            // Pass the traffic to the endpoint before a session can select it
+            add_proxy_pass_filters(proxy_endpoint.value(), protocols);
+
+            if (!group->add(proxy_endpoint.value()))
+            {
+                NETLIB_LOG(log_level::warning, "{} is already an endpoint of proxy #{}", endpoint, proxy_id);
                 return false;
             }
 
-            return true; // Return true to indicate the association was successful
+            NETLIB_LOG(log_level::info, "Added endpoint {} to proxy #{}", endpoint, proxy_id);
+
+            return true;
         }
 
         /**
-         * @brief Adds a process name to the exclusion list. This function is thread-safe.
-         * @param excluded_entry the name of the process to exclude
-         * @return True if exclusion was successful, otherwise false
+         * @brief Sets how the sessions of a proxy choose among its endpoints and how they are probed.
+         *
+         * @param proxy_id The ID of the proxy, as returned by add_socks5_proxy().
+         * @param settings Selection policy and probing settings.
+         * @return true if the settings were applied, false if the proxy does not exist.
          */
-        bool exclude_process_name(const std::wstring& excluded_entry) noexcept
+        bool set_proxy_selection(const size_t proxy_id, const proxy::proxy_group::options& settings)
         {
-            // The lock_guard makes this function thread-safe against other operations using `lock_`.
-            std::scoped_lock lock(lock_);
+            std::shared_lock lock(lock_);
 
-            try
+            if (proxy_id >= proxy_groups_.size() || !proxy_groups_[proxy_id])
             {
-                // Append the excluded entry
-                excluded_list_.push_back(to_upper(excluded_entry));
-            }
-            catch (const std::exception& e) {
-                NETLIB_LOG(log_level::error, "Exception excluding process name: {}", e.what());
-                return false;
-            }
-            catch (...) {
-                NETLIB_LOG(log_level::error, "Unknown exception excluding process name.");
+                NETLIB_LOG(log_level::error, "set_proxy_selection: proxy index is out of range!");
                 return false;
             }
 
+            proxy_groups_[proxy_id]->set_options(settings);
+
             return true;
         }
 
         /**
-         * Parses a string to construct a network endpoint, consisting of an IPv4 address and a port number.
-         * The format of the string is expected to be "IP:PORT".
-         * @param endpoint The string representation of the network endpoint.
-         * @return A std::optional containing a net::ip_endpoint<net::ip_address_v4> object if parsing is successful,
-         *         or an empty std::optional otherwise.
+         * @brief Returns the health, latency and session counts of the endpoints of a proxy.
+         *
+         * @param proxy_id The ID of the proxy.
+         * @return The endpoints in the order they were added, empty if the proxy does not exist.
          */
-        static std::optional<net::ip_endpoint<net::ip_address_v4>> parse_endpoint(const std::string& endpoint)
+        [[nodiscard]] std::vector<proxy::proxy_group::member_statistics> get_proxy_statistics(const size_t proxy_id)
         {
-            net::ip_endpoint<net::ip_address_v4> result_endpoint;
+            std::shared_lock lock(lock_);
 
-            // Locate the ':' character in the string. This separates the IP address and port.
-            if (const auto pos = endpoint.find(':'); pos != std::string::npos)
-            {
-                // Extract and validate the IP address.
-                auto [result_v4, address_v4] = net::ip_address_v4::from_string(endpoint.substr(0, pos));
+            if (proxy_id >= proxy_groups_.size() || !proxy_groups_[proxy_id])
+                return {};
 
-                // Extract and validate the port number.
-                if (auto [p, ec] = std::from_chars(endpoint.data() + pos + 1, endpoint.data() + endpoint.size(),
-                                                   result_endpoint.port); ec == std::errc())
-                {
-                    if (result_v4)
-                    {
-                        // If the IP address is valid, assign it to the result endpoint.
-                        result_endpoint.ip = address_v4;
-                    }
-                    else
-                    {
-                        // If the IP address is not valid, resolve it using the getaddrinfo function.
-                        addrinfo* resulted_address_info = nullptr;
-                        addrinfo hints{};
+            return proxy_groups_[proxy_id]->get_statistics();
+        }
 
-                        ZeroMemory(&hints, sizeof(hints));
-                        hints.ai_family = AF_INET;
-                        hints.ai_socktype = SOCK_STREAM;
-                        hints.ai_protocol = IPPROTO_TCP;
+        /**
+         * @brief Live metrics of one SOCKS5 proxy.
+         */
+        struct proxy_metrics
+        {
+            std::string endpoint;                   ///< Primary endpoint given to add_socks5_proxy(), empty if retired.
+            uint32_t sessions;                      ///< Active sessions over all endpoints of the proxy.
+            uint64_t sessions_total;                ///< Sessions started since the proxy was added.
+            uint64_t bytes_sent;                    ///< Bytes relayed from local applications to the proxy.
+            uint64_t bytes_received;                ///< Bytes relayed from the proxy to local applications.
+            size_t pooled_connections;              ///< Idle pre-negotiated connections, IPv4 and IPv6.
+            tools::metrics::latency_histogram::snapshot handshake_time; ///< SOCKS5 negotiation times.
+        };
 
-                        if (const auto ret_val = getaddrinfo(endpoint.substr(0, pos).c_str(),
-                                                             std::to_string(result_endpoint.port).c_str(), &hints,
+        /**
+         * @brief Phase durations of the last start().
+         */
+        struct startup_timing
+        {
+            std::chrono::microseconds total;                 ///< The whole start().
+            std::chrono::microseconds proxies;               ///< Starting the proxy servers, concurrently.
+            std::chrono::microseconds process_tables;        ///< Loading the process tables, overlapping the other phases.
+            std::chrono::microseconds network_configuration; ///< Network configuration and waiting for the process tables.
+            std::chrono::microseconds endpoint_resolution;   ///< Parsing and resolving proxy endpoints since construction.
+        };
+
+        /**
+         * @brief Snapshot of the data path metrics, see get_metrics().
+         */
+        struct metrics
+        {
+            packet_filter::pipeline_statistics pipeline;                ///< Stage queue depths and block processing time.
+            flow_cache<net::ip_address_v4>::statistics flow_cache;      ///< Flow verdict cache lookups, IPv4 and IPv6 summed.
+            iphelper::process_lookup<net::ip_address_v4>::refresh_statistics process_lookup_v4; ///< IPv4 process table refreshes.
+            iphelper::process_lookup<net::ip_address_v6>::refresh_statistics process_lookup_v6; ///< IPv6 process table refreshes.
+            deferred_resolve_statistics deferred_resolve;               ///< Deferred process resolution.
+            uint64_t resolve_queue_dropped;                             ///< Packets dropped on a full resolve queue since start().
+            uint64_t resolve_queue_alloc_failures;                      ///< Packets dropped on buffer allocation failures since start().
+            ndisapi::intermediate_buffer_pool::statistics buffer_pool;  ///< Packet buffer pool occupancy.
+            startup_timing startup;                                     ///< Phase durations of the last start().
+            std::vector<proxy_metrics> proxies;                         ///< Per-proxy metrics indexed by proxy ID.
+        };
+
+        /**
+         * @brief Returns a snapshot of the data path metrics.
+         *
+         * The counters are sampled one by one while the data path keeps running, the snapshot is
+         * consistent per counter, not as a whole. Reading it costs a few hundred atomic loads and
+         * the table locks of the process lookups; it is meant to be polled every few seconds.
+         */
+        [[nodiscard]] metrics get_metrics()
+        {
+            const auto flow_cache_v4 = flow_cache_v4_.get_statistics();
+            const auto flow_cache_v6 = flow_cache_v6_.get_statistics();
+
+            metrics result{
+                packet_filter_ ? packet_filter_->get_pipeline_statistics() : packet_filter::pipeline_statistics{},
+                { flow_cache_v4.hits + flow_cache_v6.hits, flow_cache_v4.misses + flow_cache_v6.misses },
+                process_lookup_v4_.get_refresh_statistics(),
+                process_lookup_v6_.get_refresh_statistics(),
+                get_deferred_resolve_statistics(),
+                resolve_queue_dropped_logged_.load(std::memory_order_relaxed) +
+                    resolve_queue_dropped_packets_.load(std::memory_order_relaxed),
+                resolve_queue_alloc_failures_logged_.load(std::memory_order_relaxed) +
+                    resolve_queue_alloc_failures_.load(std::memory_order_relaxed),
+                ndisapi::intermediate_buffer_pool::instance().get_statistics(),
+                {
+                    std::chrono::microseconds(startup_total_us_.load(std::memory_order_relaxed)),
+                    std::chrono::microseconds(startup_proxies_us_.load(std::memory_order_relaxed)),
+                    std::chrono::microseconds(startup_process_tables_us_.load(std::memory_order_relaxed)),
+                    std::chrono::microseconds(startup_network_us_.load(std::memory_order_relaxed)),
+                    std::chrono::microseconds(endpoint_resolution_us_.load(std::memory_order_relaxed))
+                },
+                {}
+            };
+
+            std::shared_lock lock(lock_);
+
+            result.proxies.reserve(proxy_groups_.size());
+
+            for (size_t proxy_id = 0; proxy_id < proxy_groups_.size(); ++proxy_id)
+            {
+                const auto& group = proxy_groups_[proxy_id];
+
+                // Retired by reconfigure(), the ID is kept
+                if (!group)
+                {
+                    result.proxies.emplace_back();
+                    continue;
+                }
+
+                const auto& session = group->get_session_metrics();
+
+                proxy_metrics proxy{
+                    proxy_endpoints_[proxy_id].first.to_string(),
+                    0, 0,
+                    session->bytes_sent.value(),
+                    session->bytes_received.value(),
+                    (connection_pools_[proxy_id] ? connection_pools_[proxy_id]->size() : 0) +
+                        (connection_pools_v6_[proxy_id] ? connection_pools_v6_[proxy_id]->size() : 0),
+                    session->handshake_time.get_snapshot()
+                };
+
+                for (const auto& member : group->get_statistics())
+                {
+                    proxy.sessions += member.sessions;
+                    proxy.sessions_total += member.selected;
+                }
+
+                result.proxies.push_back(std::move(proxy));
+            }
+
+            return result;
+        }
+
+        /**
+         * @brief Returns the data path metrics in the Prometheus text exposition format.
+         *
+         * The page carries the same values as get_metrics() with the proxies labelled by ID and
+         * primary endpoint, ready to be served to a scraper or written to a textfile collector.
+         */
+        [[nodiscard]] std::string get_prometheus_metrics()
+        {
+            using tools::metrics::prometheus_writer;
+
+            const auto m = get_metrics();
+            prometheus_writer writer;
+
+            const std::array<std::pair<const char*, size_t>, 4> stages{ {
+                { "read", m.pipeline.read_queue },
+                { "process", m.pipeline.process_queue },
+                { "write_mstcp", m.pipeline.write_mstcp_queue },
+                { "write_adapter", m.pipeline.write_adapter_queue } } };
+
+            for (const auto& [stage, depth] : stages)
+            {
+                writer.gauge("socksify_filter_queue_blocks", "Packet blocks queued for each filter stage.", depth,
+                    prometheus_writer::label("stage", stage));
+            }
+
+            writer.gauge("socksify_filter_read_size", "Packet buffers offered to each driver read.", m.pipeline.read_size);
+            writer.counter("socksify_filter_blocks_total", "Packet blocks processed.", m.pipeline.blocks);
+            writer.counter("socksify_filter_packets_total", "Packets processed.", m.pipeline.packets);
+            writer.histogram("socksify_filter_block_seconds", "Classification and routing time of a packet block.",
+                m.pipeline.block_time);
+
+            writer.counter("socksify_flow_cache_lookups_total", "Flow verdict cache lookups.", m.flow_cache.hits,
+                prometheus_writer::label("result", "hit"));
+            writer.counter("socksify_flow_cache_lookups_total", "Flow verdict cache lookups.", m.flow_cache.misses,
+                prometheus_writer::label("result", "miss"));
+
+            const auto v4 = prometheus_writer::label("family", "ipv4");
+            const auto v6 = prometheus_writer::label("family", "ipv6");
+            const auto tcp_v4 = v4 + "," + prometheus_writer::label("protocol", "tcp");
+            const auto udp_v4 = v4 + "," + prometheus_writer::label("protocol", "udp");
+            const auto tcp_v6 = v6 + "," + prometheus_writer::label("protocol", "tcp");
+            const auto udp_v6 = v6 + "," + prometheus_writer::label("protocol", "udp");
+
+            writer.counter("socksify_process_table_refreshes_total", "Process table refreshes.",
+                m.process_lookup_v4.tcp_refreshes, tcp_v4);
+            writer.counter("socksify_process_table_refreshes_total", "Process table refreshes.",
+                m.process_lookup_v4.udp_refreshes, udp_v4);
+            writer.counter("socksify_process_table_refreshes_total", "Process table refreshes.",
+                m.process_lookup_v6.tcp_refreshes, tcp_v6);
+            writer.counter("socksify_process_table_refreshes_total", "Process table refreshes.",
+                m.process_lookup_v6.udp_refreshes, udp_v6);
+            writer.counter("socksify_process_table_refresh_failures_total", "Process table refreshes that failed.",
+                m.process_lookup_v4.failures, v4);
+            writer.counter("socksify_process_table_refresh_failures_total", "Process table refreshes that failed.",
+                m.process_lookup_v6.failures, v6);
+            writer.gauge("socksify_process_table_entries", "Sockets mapped to their owning process.",
+                m.process_lookup_v4.tcp_entries, tcp_v4);
+            writer.gauge("socksify_process_table_entries", "Sockets mapped to their owning process.",
+                m.process_lookup_v4.udp_entries, udp_v4);
+            writer.gauge("socksify_process_table_entries", "Sockets mapped to their owning process.",
+                m.process_lookup_v6.tcp_entries, tcp_v6);
+            writer.gauge("socksify_process_table_entries", "Sockets mapped to their owning process.",
+                m.process_lookup_v6.udp_entries, udp_v6);
+            writer.histogram("socksify_process_table_refresh_seconds", "Duration of a process table refresh.",
+                m.process_lookup_v4.refresh_time, v4);
+            writer.histogram("socksify_process_table_refresh_seconds", "Duration of a process table refresh.",
+                m.process_lookup_v6.refresh_time, v6);
+
+            writer.gauge("socksify_resolve_queue_packets", "Packets waiting for deferred process resolution.",
+                m.deferred_resolve.queue_depth);
+            writer.counter("socksify_resolve_deferred_packets_total", "Packets re-injected after deferred process resolution.",
+                m.deferred_resolve.packets);
+            writer.counter("socksify_resolve_dropped_packets_total", "Packets dropped by the deferred process resolution.",
+                m.resolve_queue_dropped, prometheus_writer::label("reason", "queue_full"));
+            writer.counter("socksify_resolve_dropped_packets_total", "Packets dropped by the deferred process resolution.",
+                m.resolve_queue_alloc_failures, prometheus_writer::label("reason", "no_buffer"));
+
+            writer.gauge("socksify_buffer_pool_buffers", "Packet buffers of the intermediate buffer pool.",
+                m.buffer_pool.capacity, prometheus_writer::label("state", "capacity"));
+            writer.gauge("socksify_buffer_pool_buffers", "Packet buffers of the intermediate buffer pool.",
+                m.buffer_pool.in_use, prometheus_writer::label("state", "in_use"));
+            writer.gauge("socksify_buffer_pool_buffers", "Packet buffers of the intermediate buffer pool.",
+                m.buffer_pool.peak_in_use, prometheus_writer::label("state", "peak_in_use"));
+
+            const std::array<std::pair<const char*, std::chrono::microseconds>, 4> phases{ {
+                { "total", m.startup.total },
+                { "proxies", m.startup.proxies },
+                { "process_tables", m.startup.process_tables },
+                { "network_configuration", m.startup.network_configuration } } };
+
+            for (const auto& [phase, duration] : phases)
+            {
+                writer.seconds("socksify_startup_seconds", "Duration of the phases of the last start().", duration,
+                    prometheus_writer::label("phase", phase));
+            }
+
+            writer.seconds("socksify_endpoint_resolution_seconds", "Time spent parsing and resolving proxy endpoints.",
+                m.startup.endpoint_resolution);
+
+            // Retired proxies have no endpoint and no series
+            std::vector<proxy_metrics> proxies;
+            std::vector<std::string> proxy_labels;
+            proxy_labels.reserve(m.proxies.size());
+
+            for (size_t proxy_id = 0; proxy_id < m.proxies.size(); ++proxy_id)
+            {
+                if (m.proxies[proxy_id].endpoint.empty())
+                    continue;
+
+                proxies.push_back(m.proxies[proxy_id]);
+                proxy_labels.push_back(prometheus_writer::label("proxy", std::to_string(proxy_id)) + "," +
+                    prometheus_writer::label("endpoint", m.proxies[proxy_id].endpoint));
+            }
+
+            // Samples of a family must be contiguous, so every family loops over the proxies
+            for (size_t i = 0; i < proxies.size(); ++i)
+                writer.gauge("socksify_proxy_sessions", "Active proxied sessions.", proxies[i].sessions, proxy_labels[i]);
+            for (size_t i = 0; i < proxies.size(); ++i)
+                writer.counter("socksify_proxy_sessions_total", "Proxied sessions started.", proxies[i].sessions_total,
+                    proxy_labels[i]);
+            for (size_t i = 0; i < proxies.size(); ++i)
+                writer.counter("socksify_proxy_sent_bytes_total", "Bytes relayed to the proxy.", proxies[i].bytes_sent,
+                    proxy_labels[i]);
+            for (size_t i = 0; i < proxies.size(); ++i)
+                writer.counter("socksify_proxy_received_bytes_total", "Bytes relayed from the proxy.",
+                    proxies[i].bytes_received, proxy_labels[i]);
+            for (size_t i = 0; i < proxies.size(); ++i)
+                writer.gauge("socksify_proxy_pooled_connections", "Idle pre-negotiated connections to the proxy.",
+                    proxies[i].pooled_connections, proxy_labels[i]);
+            for (size_t i = 0; i < proxies.size(); ++i)
+                writer.histogram("socksify_proxy_handshake_seconds", "SOCKS5 negotiation time of a session.",
+                    proxies[i].handshake_time, proxy_labels[i]);
+
+            return writer.str();
+        }
+
+        /**
+         * Associates a process name to a specific proxy ID. This function is thread-safe.
+         * @param process_name the name of the process to associate with a proxy
+         * @param proxy_id the ID of the proxy server to associate with the process
+         * @return True if the association was successful, False otherwise
+         */
+        bool associate_process_name_to_proxy(const std::wstring& process_name, const size_t proxy_id)
+        {
+            // The lock_guard object acquires the lock in a safe manner,
+            // ensuring it gets released even if an exception is thrown.
+            std::scoped_lock lock(lock_);
+
+            // Check if the provided proxy ID is within the range of available proxies
+            if (proxy_id >= proxy_servers_.size() || !proxy_groups_[proxy_id])
+            {
+                NETLIB_LOG(log_level::error,
+                    "associate_process_name_to_proxy: proxy index is out of range!");
+                return false; // Return false since the proxy_id is out of range
+            }
+
+            try
+            {
+                // Associate the given process name to the specified proxy ID.
+                const auto it = proxy_to_names_.emplace(proxy_id, to_upper(process_name));
+
+                if (!publish_routing_snapshot())
+                {
+                    proxy_to_names_.erase(it);
+                    return false;
+                }
+            }
+            catch (const std::exception& e) {
+                NETLIB_LOG(log_level::error, "Exception associating process name to proxy: {}", e.what());
+                return false; // Return false if any exception occurs during the association
+            }
+            catch (...) {
+                NETLIB_LOG(log_level::error, "Unknown exception associating process name to proxy.");
+                return false;
+            }
+
+            invalidate_flow_cache();
+
+            return true; // Return true to indicate the association was successful
+        }
+
+        /**
+         * @brief Adds a process name to the exclusion list. This function is thread-safe.
+         * @param excluded_entry the name of the process to exclude
+         * @return True if exclusion was successful, otherwise false
+         */
+        bool exclude_process_name(const std::wstring& excluded_entry) noexcept
+        {
+            // The lock_guard makes this function thread-safe against other operations using `lock_`.
+            std::scoped_lock lock(lock_);
+
+            try
+            {
+                // Append the excluded entry
+                excluded_list_.push_back(to_upper(excluded_entry));
+
+                if (!publish_routing_snapshot())
+                {
+                    excluded_list_.pop_back();
+                    return false;
+                }
+            }
+            catch (const std::exception& e) {
+                NETLIB_LOG(log_level::error, "Exception excluding process name: {}", e.what());
+                return false;
+            }
+            catch (...) {
+                NETLIB_LOG(log_level::error, "Unknown exception excluding process name.");
+                return false;
+            }
+
+            invalidate_flow_cache();
+
+            return true;
+        }
+
+        /**
+         * @brief Replaces the proxies, process associations, exclusions and LAN bypass with those of a
+         *        configuration while the router keeps running.
+         *
+         * The configuration is compared with the running one. A proxy with the same primary endpoint,
+         * credentials and protocols whose endpoints are all still listed is kept with its sessions,
+         * connection pool, DNS forwarder and selection settings, and receives the alternative endpoints
+         * it lacks. The other listed proxies are created, and started if the router is. The proxies
+         * that are not listed anymore are retired: their sessions are closed and their IDs are not
+         * reused. All process associations and exclusions are replaced, and the packet path switches
+         * to them and to the new proxies with a single routing snapshot, so no packet is routed by a
+         * mix of both configurations. The packet filter keeps running throughout.
+         *
+         * Either the whole configuration is applied or, if an endpoint is invalid or a proxy cannot be
+         * created, nothing changes.
+         *
+         * @param config The new configuration.
+         * @return The proxy ID of each entry of config.proxies, std::nullopt on failure.
+         */
+        std::optional<std::vector<size_t>> reconfigure(const configuration& config)
+        {
+            using endpoint_t = net::ip_endpoint<net::ip_address_v4>;
+
+            // Parsing may perform blocking DNS lookups, see add_socks5_proxy(), the host names are
+            // resolved concurrently rather than one lookup after the other
+            std::vector<std::string> names;
+
+            for (const auto& proxy : config.proxies)
+            {
+                // The primary endpoint goes first
+                names.push_back(proxy.endpoint);
+                names.insert(names.end(), proxy.alternative_endpoints.begin(), proxy.alternative_endpoints.end());
+            }
+
+            const auto resolution_started = std::chrono::steady_clock::now();
+            const auto resolved = parse_endpoints(names);
+            endpoint_resolution_us_.fetch_add(elapsed_us(resolution_started), std::memory_order_relaxed);
+
+            std::vector<std::vector<endpoint_t>> endpoints;
+            endpoints.reserve(config.proxies.size());
+
+            for (size_t i = 0, next = 0; i < config.proxies.size(); ++i)
+            {
+                auto& parsed = endpoints.emplace_back();
+                parsed.reserve(config.proxies[i].alternative_endpoints.size() + 1);
+
+                for (const auto end = next + config.proxies[i].alternative_endpoints.size() + 1; next < end; ++next)
+                {
+                    if (!resolved[next])
+                    {
+                        NETLIB_LOG(log_level::error, "reconfigure: failed to parse the proxy endpoint {}", names[next]);
+                        return std::nullopt;
+                    }
+
+                    parsed.push_back(resolved[next].value());
+                }
+            }
+
+            std::scoped_lock lifecycle_lock(lifecycle_mutex_);
+
+            const auto active = is_active_.load(std::memory_order_acquire);
+
+            // Proxies are only added under lifecycle_mutex_, so the IDs of the new ones are known now
+            std::vector<std::optional<size_t>> proxy_ids(config.proxies.size());
+            std::vector<bool> kept;
+
+            // Group and current endpoints of each kept proxy, by index in config.proxies
+            std::vector<std::pair<std::shared_ptr<proxy::proxy_group>, std::vector<endpoint_t>>> kept_groups(
+                config.proxies.size());
+
+            {
+                std::shared_lock lock(lock_);
+
+                kept.resize(proxy_groups_.size());
+
+                for (size_t i = 0; i < config.proxies.size(); ++i)
+                {
+                    const auto& proxy = config.proxies[i];
+
+                    for (size_t proxy_id = 0; proxy_id < proxy_groups_.size(); ++proxy_id)
+                    {
+                        if (kept[proxy_id] || !proxy_groups_[proxy_id])
+                            continue;
+
+                        const auto& [endpoint, cred_pair] = proxy_endpoints_[proxy_id];
+                        const auto& [tcp_server, udp_server] = proxy_servers_[proxy_id];
+                        const auto protocols = tcp_server && udp_server ? both : tcp_server ? tcp : udp;
+
+                        if (endpoint != endpoints[i].front() || cred_pair != proxy.credentials || protocols != proxy.protocols)
+                            continue;
+
+                        std::vector<endpoint_t> members;
+                        for (const auto& member : proxy_groups_[proxy_id]->get_statistics())
+                            members.push_back(member.endpoint);
+
+                        // An endpoint cannot be taken out of a group, a proxy losing one is replaced
+                        if (!std::ranges::all_of(members, [&endpoints, i](const auto& member)
+                            {
+                                return std::ranges::find(endpoints[i], member) != endpoints[i].end();
+                            }))
+                            continue;
+
+                        kept[proxy_id] = true;
+                        proxy_ids[i] = proxy_id;
+                        kept_groups[i] = { proxy_groups_[proxy_id], std::move(members) };
+                        break;
+                    }
+                }
+            }
+
+            // Create the new proxies before changing anything, so a failure leaves the router as it was
+            std::vector<proxy_slot> created;
+
+            const auto discard = [&created, active]
+            {
+                // Objects that were never started need no stop
+                if (active)
+                {
+                    for (auto& proxy : created)
+                        stop_proxy(proxy);
+                }
+            };
+
+            std::multimap<size_t, std::wstring> proxy_to_names;
+            std::vector<std::wstring> excluded_list;
+
+            try
+            {
+                for (size_t i = 0; i < config.proxies.size(); ++i)
+                {
+                    if (proxy_ids[i])
+                        continue;
+
+                    const auto& proxy = config.proxies[i];
+
+                    // The pass filters are added once the configuration is committed, see below
+                    auto slot = create_proxy(proxy.endpoint, endpoints[i].front(), proxy.protocols, proxy.credentials,
+                                             active, proxy.connection_pool_size,
+                                             proxy::socks5_connection_pool<net::ip_address_v4>::default_ttl);
+                    if (!slot)
+                    {
+                        discard();
+                        return std::nullopt;
+                    }
+
+                    for (auto it = std::next(endpoints[i].begin()); it != endpoints[i].end(); ++it)
+                        slot->group->add(*it);
+
+                    proxy_ids[i] = kept.size() + created.size();
+                    created.push_back(std::move(slot.value()));
+                }
+
+                for (size_t i = 0; i < config.proxies.size(); ++i)
+                {
+                    for (const auto& name : config.proxies[i].process_names)
+                        proxy_to_names.emplace(proxy_ids[i].value(), to_upper(name));
+                }
+
+                excluded_list.reserve(config.excluded_process_names.size());
+
+                for (const auto& name : config.excluded_process_names)
+                    excluded_list.push_back(to_upper(name));
+            }
+            catch (const std::exception& e)
+            {
+                NETLIB_LOG(log_level::error, "An exception was thrown while reconfiguring the proxies: {}", e.what());
+                discard();
+                return std::nullopt;
+            }
+
+            std::vector<std::pair<size_t, proxy_slot>> retired;
+            bool published = false;
+            bool forwarding = false;
+
+            {
+                std::scoped_lock lock(lock_);
+
+                bool reserved = false;
+
+                try
+                {
+                    // Nothing below can throw once room is made
+                    reserve_proxies(kept.size() + created.size());
+                    retired.reserve(kept.size());
+                    reserved = true;
+                }
+                catch (const std::exception& e)
+                {
+                    NETLIB_LOG(log_level::error, "An exception was thrown while reconfiguring the proxies: {}", e.what());
+                }
+
+                if (reserved)
+                {
+                    for (auto& proxy : created)
+                        push_proxy(std::move(proxy));
+
+                    for (size_t proxy_id = 0; proxy_id < kept.size(); ++proxy_id)
+                    {
+                        if (!kept[proxy_id] && proxy_groups_[proxy_id])
+                            swap_proxy(proxy_id, retired.emplace_back(proxy_id, proxy_slot{}).second);
+                    }
+
+                    proxy_to_names_.swap(proxy_to_names);
+                    excluded_list_.swap(excluded_list);
+
+                    published = publish_routing_snapshot();
+
+                    if (!published)
+                    {
+                        // Back to what the packet path still observes
+                        proxy_to_names_.swap(proxy_to_names);
+                        excluded_list_.swap(excluded_list);
+
+                        for (auto& [proxy_id, proxy] : retired)
+                            swap_proxy(proxy_id, proxy);
+
+                        retired.clear();
+
+                        for (auto it = created.rbegin(); it != created.rend(); ++it)
+                            *it = pop_proxy();
+                    }
+                }
+
+                forwarding = std::ranges::any_of(dns_forwarders_, [](const auto& forwarder) { return forwarder != nullptr; });
+            }
+
+            if (!published)
+            {
+                discard();
+                return std::nullopt;
+            }
+
+            // Decisions cached for the previous configuration must not be reused
+            invalidate_flow_cache();
+
+            // Changed once the new proxies are committed, so a failed reconfigure leaves the filters as they
+            // were. One table write replaces the filters of the retired endpoints by those of the new ones
+            // and of the endpoints added to kept groups. Removals apply first, so an endpoint retired and
+            // added back keeps one copy, and an endpoint still used by a kept proxy keeps its filters.
+            if (static_filters_)
+            {
+                std::scoped_lock filters_lock(static_filters_lock_);
+                auto proxy_filters = static_filters_->begin_update();
+
+                try
+                {
+                    for (const auto& [proxy_id, proxy] : retired)
+                    {
+                        const auto& [tcp_server, udp_server] = proxy.servers;
+                        const auto protocols = tcp_server && udp_server ? both : tcp_server ? tcp : udp;
+
+                        for (const auto& member : proxy.group->get_statistics())
+                        {
+                            if (std::ranges::any_of(kept_groups, [&member](const auto& group)
+                                {
+                                    return std::ranges::find(group.second, member.endpoint) != group.second.end();
+                                }))
+                                continue;
+
+                            update_proxy_pass_filters(proxy_filters, member.endpoint, protocols, false);
+                        }
+                    }
+
+                    for (size_t i = 0; i < config.proxies.size(); ++i)
+                    {
+                        const auto& members = kept_groups[i].second;
+
+                        for (const auto& endpoint : endpoints[i])
+                        {
+                            if (proxy_ids[i].value() >= kept.size() || std::ranges::find(members, endpoint) == members.end())
+                                update_proxy_pass_filters(proxy_filters, endpoint, config.proxies[i].protocols, true);
+                        }
+                    }
+
+                    if (!proxy_filters.commit())
+                        NETLIB_WARNING("Failed to update the pass filters of the SOCKS5 proxies");
+                }
+                catch (const std::exception& e)
+                {
+                    NETLIB_LOG(log_level::error, "Failed to update the pass filters of the SOCKS5 proxies: {}", e.what());
+                }
+            }
+
+            // Sessions already running keep their upstream, new ones may select the added endpoints,
+            // whose traffic is passed by now
+            for (size_t i = 0; i < config.proxies.size(); ++i)
+            {
+                const auto& [group, members] = kept_groups[i];
+
+                if (!group)
+                    continue;
+
+                for (const auto& endpoint : endpoints[i])
+                {
+                    if (std::ranges::find(members, endpoint) == members.end())
+                        group->add(endpoint);
+                }
+            }
+
+            // No snapshot refers to the retired proxies anymore, their sessions are closed
+            for (auto& [proxy_id, proxy] : retired)
+            {
+                if (active)
+                    stop_proxy(proxy);
+
+                NETLIB_LOG(log_level::info, "Retired proxy #{} ({})", proxy_id, proxy.endpoint.first.to_string());
+            }
+
+            update_dns_redirect_filters(forwarding);
+            update_lan_bypass_filters(config.bypass_lan);
+
+            NETLIB_LOG(log_level::info, "Reconfigured: {} proxies kept, {} added, {} retired",
+                       config.proxies.size() - created.size(), created.size(), retired.size());
+
+            std::vector<size_t> result;
+            result.reserve(proxy_ids.size());
+
+            for (const auto& proxy_id : proxy_ids)
+                result.push_back(proxy_id.value());
+
+            return result;
+        }
+
+        /**
+         * Parses a string to construct a network endpoint, consisting of an IPv4 address and a port number.
+         * The format of the string is expected to be "IP:PORT".
+         * @param endpoint The string representation of the network endpoint.
+         * @return A std::optional containing a net::ip_endpoint<net::ip_address_v4> object if parsing is successful,
+         *         or an empty std::optional otherwise.
+         */
+        static std::optional<net::ip_endpoint<net::ip_address_v4>> parse_endpoint(const std::string& endpoint)
+        {
+            net::ip_endpoint<net::ip_address_v4> result_endpoint;
+
+            // Locate the ':' character in the string. This separates the IP address and port.
+            if (const auto pos = endpoint.find(':'); pos != std::string::npos)
+            {
+                // Extract and validate the IP address.
+                auto [result_v4, address_v4] = net::ip_address_v4::from_string(endpoint.substr(0, pos));
+
+                // Extract and validate the port number.
+                if (auto [p, ec] = std::from_chars(endpoint.data() + pos + 1, endpoint.data() + endpoint.size(),
+                                                   result_endpoint.port); ec == std::errc())
+                {
+                    if (result_v4)
+                    {
+                        // If the IP address is valid, assign it to the result endpoint.
+                        result_endpoint.ip = address_v4;
+                    }
+                    else
+                    {
+                        // If the IP address is not valid, resolve it using the getaddrinfo function.
+                        addrinfo* resulted_address_info = nullptr;
+                        addrinfo hints{};
+
+                        ZeroMemory(&hints, sizeof(hints));
+                        hints.ai_family = AF_INET;
+                        hints.ai_socktype = SOCK_STREAM;
+                        hints.ai_protocol = IPPROTO_TCP;
+
+                        if (const auto ret_val = getaddrinfo(endpoint.substr(0, pos).c_str(),
+                                                             std::to_string(result_endpoint.port).c_str(), &hints,
                                                              &resulted_address_info); ret_val == 0)
                         {
                             for (const auto* ptr = resulted_address_info; ptr != nullptr; ptr = ptr->ai_next)
@@ -1128,171 +2811,1277 @@ namespace proxy
                 }
             }
 
-            // If the IP address is not default, return the result endpoint.
-            if (result_endpoint.ip != net::ip_address_v4{})
-                return result_endpoint;
+            // If the IP address is not default, return the result endpoint.
+            if (result_endpoint.ip != net::ip_address_v4{})
+                return result_endpoint;
+
+            // Otherwise, return an empty std::optional.
+            return {};
+        }
+
+        /**
+         * Parses a list of "IP:PORT" strings, see parse_endpoint(). The entries naming a host are
+         * resolved concurrently, so the whole list takes about as long as its slowest lookup.
+         * @param endpoints The string representations of the network endpoints.
+         * @return The endpoint of each entry, an empty std::optional where parsing failed.
+         */
+        static std::vector<std::optional<net::ip_endpoint<net::ip_address_v4>>> parse_endpoints(
+            const std::vector<std::string>& endpoints)
+        {
+            std::vector<std::optional<net::ip_endpoint<net::ip_address_v4>>> result(endpoints.size());
+            std::vector<std::function<void()>> lookups;
+
+            for (size_t i = 0; i < endpoints.size(); ++i)
+            {
+                const auto& endpoint = endpoints[i];
+
+                // Literal addresses need no lookup
+                if (const auto pos = endpoint.find(':');
+                    pos == std::string::npos || net::ip_address_v4::from_string(endpoint.substr(0, pos)).first)
+                {
+                    result[i] = parse_endpoint(endpoint);
+                    continue;
+                }
+
+                lookups.emplace_back([&endpoint, &parsed = result[i]]
+                {
+                    try
+                    {
+                        parsed = parse_endpoint(endpoint);
+                    }
+                    catch (...)
+                    {
+                        parsed.reset();
+                    }
+                });
+            }
+
+            run_concurrently(lookups);
+
+            return result;
+        }
+
+    private:
+        /**
+         * @brief Runs the tasks on threads of their own and waits for all of them. The first one runs
+         *        on the calling thread, as does any task a thread cannot be created for.
+         * @param tasks The tasks, they must not throw.
+         */
+        static void run_concurrently(std::vector<std::function<void()>>& tasks)
+        {
+            std::vector<std::thread> threads;
+            threads.reserve(tasks.empty() ? 0 : tasks.size() - 1);
+
+            for (size_t i = 1; i < tasks.size(); ++i)
+            {
+                try
+                {
+                    threads.emplace_back(tasks[i]);
+                }
+                catch (const std::system_error&)
+                {
+                    tasks[i]();
+                }
+            }
+
+            if (!tasks.empty())
+                tasks.front()();
+
+            for (auto& thread : threads)
+                thread.join();
+        }
+
+        /**
+         * @brief Loads the IPv4 and IPv6 process tables concurrently.
+         * @return The time taken. A table that fails to load now is loaded on demand by the packet path.
+         */
+        std::chrono::steady_clock::duration load_process_tables()
+        {
+            const auto started = std::chrono::steady_clock::now();
+
+            const auto load = [](auto& lookup)
+            {
+                try
+                {
+                    lookup.actualize(true, true);
+                }
+                catch (...)
+                {
+                }
+            };
+
+            std::vector<std::function<void()>> tables{
+                [this, &load] { load(process_lookup_v4_); },
+                [this, &load] { load(process_lookup_v6_); }
+            };
+            run_concurrently(tables);
+
+            return std::chrono::steady_clock::now() - started;
+        }
+
+        /**
+         * @brief Returns the microseconds elapsed since a point in time.
+         */
+        static std::uint64_t elapsed_us(const std::chrono::steady_clock::time_point since)
+        {
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - since).count());
+        }
+
+        /// <summary>
+        /// Converts std::wstring to upper case
+        /// </summary>
+        /// <param name="str">wide char string to convert</param>
+        /// <returns>resulted wide char string</returns>
+        static std::wstring to_upper(const std::wstring& str)
+        {
+            std::wstring upper_case;
+            std::ranges::transform(str, std::back_inserter(upper_case), toupper);
+            return upper_case;
+        }
+
+        /**
+         * @brief Adds the static filters passing the traffic to and from a SOCKS5 upstream.
+         *
+         * @param endpoint The SOCKS5 upstream.
+         * @param protocols The protocols proxied through it, UDP also needs its TCP control connection.
+         */
+        void add_proxy_pass_filters(const net::ip_endpoint<net::ip_address_v4>& endpoint,
+                                    const supported_protocols protocols)
+        {
+            if (!static_filters_)
+                return;
+
+            // Apply all the filters to the network traffic
+            std::scoped_lock filters_lock(static_filters_lock_);
+            auto proxy_filters = static_filters_->begin_update();
+            update_proxy_pass_filters(proxy_filters, endpoint, protocols, true);
+
+            if (!proxy_filters.commit())
+            {
+                NETLIB_WARNING("Failed to add the pass filters of the SOCKS5 proxy {}:{}", endpoint.ip, endpoint.port);
+            }
+        }
+
+        /**
+         * @brief Records the addition or removal of the static filters passing the traffic to and from
+         *        a SOCKS5 upstream in a filter table update.
+         *
+         * @param batch The filter table update.
+         * @param endpoint The SOCKS5 upstream.
+         * @param protocols The protocols proxied through it, UDP also needs its TCP control connection.
+         * @param add true to add the filters, false to remove them.
+         */
+        static void update_proxy_pass_filters(ndisapi::static_filters::update& batch,
+                                              const net::ip_endpoint<net::ip_address_v4>& endpoint,
+                                              const supported_protocols protocols, const bool add)
+        {
+            // Construct filter objects for the TCP and UDP traffic to and from the proxy server
+            // These filters are used to decide which packets to pass or drop
+            // They are configured to match packets based on their source/destination IP and port numbers
+            // and their protocol (TCP or UDP)
+            auto create_filter = [](const uint8_t protocol, const ndisapi::direction_t direction,
+                const net::ip_address_v4& address, const uint16_t port)
+            {
+                ndisapi::filter<net::ip_address_v4> filter;
+                filter.set_protocol(protocol)
+                      .set_direction(direction)
+                      .set_action(ndisapi::action_t::pass)
+                    .set_dest_address(net::ip_subnet{ address, net::ip_address_v4{"255.255.255.255"} })
+                      .set_dest_port(std::make_pair(port, port));
+                return filter;
+            };
+
+            std::vector<ndisapi::filter<net::ip_address_v4>> filters;
+
+            if (protocols == both || protocols == udp || protocols == tcp)
+            {
+                filters.push_back(create_filter(IPPROTO_TCP, ndisapi::direction_t::out, endpoint.ip, endpoint.port));
+                filters.push_back(create_filter(IPPROTO_TCP, ndisapi::direction_t::in, endpoint.ip, endpoint.port));
+            }
+
+            if (protocols == both || protocols == udp)
+            {
+                filters.push_back(create_filter(IPPROTO_UDP, ndisapi::direction_t::out, endpoint.ip, endpoint.port));
+                filters.push_back(create_filter(IPPROTO_UDP, ndisapi::direction_t::in, endpoint.ip, endpoint.port));
+            }
+
+            for (const auto& filter : filters)
+            {
+                if (add)
+                    batch.add(filter);
+                else
+                    batch.remove(filter);
+            }
+        }
+
+        /**
+         * @brief The entries of the per-proxy vectors at the ID of one SOCKS5 proxy.
+         *
+         * Moved in and out of the vectors as a whole, so they stay indexed by proxy ID. A retired proxy
+         * (see reconfigure()) keeps its ID with an empty slot, which publishes no ports.
+         */
+        struct proxy_slot
+        {
+            s5_proxy_servers<net::ip_address_v4> servers;
+            s5_proxy_servers<net::ip_address_v6> servers_v6;
+            std::shared_ptr<proxy::socks5_connection_pool<net::ip_address_v4>> connection_pool;
+            std::shared_ptr<proxy::socks5_connection_pool<net::ip_address_v6>> connection_pool_v6;
+            std::pair<net::ip_endpoint<net::ip_address_v4>, std::optional<std::pair<std::string, std::string>>> endpoint;
+            std::shared_ptr<proxy::proxy_group> group;
+            std::shared_ptr<dns_forwarder> forwarder;
+        };
+
+        /**
+         * @brief Creates the servers, connection pools and upstream group of a SOCKS5 proxy and
+         *        optionally starts them, see add_socks5_proxy(). Must be called under lifecycle_mutex_.
+         *
+         * @param name The endpoint as given by the caller, for logging.
+         * @param endpoint The parsed endpoint.
+         * @return The proxy, std::nullopt if one of its IPv4 servers failed to start.
+         * @throws std::exception if an object cannot be created.
+         */
+        std::optional<proxy_slot> create_proxy(
+            const std::string& name,
+            const net::ip_endpoint<net::ip_address_v4>& endpoint,
+            const supported_protocols protocols,
+            const std::optional<std::pair<std::string, std::string>>& cred_pair,
+            const bool start,
+            const size_t connection_pool_size,
+            const std::chrono::seconds connection_pool_ttl)
+        {
+            proxy_slot proxy;
+            proxy.endpoint = { endpoint, cred_pair };
+
+            // Shared by the TCP and UDP proxy servers of this endpoint
+            if (connection_pool_size != 0)
+            {
+                proxy.connection_pool = std::make_shared<proxy::socks5_connection_pool<net::ip_address_v4>>(
+                    endpoint.ip, endpoint.port,
+                    cred_pair ? std::optional(cred_pair.value().first) : std::nullopt,
+                    cred_pair ? std::optional(cred_pair.value().second) : std::nullopt,
+                    connection_pool_size, connection_pool_ttl, log_level_, log_stream_);
+            }
+
+            // Selects the SOCKS5 endpoint of each session, add_socks5_proxy_endpoint() adds alternatives
+            proxy.group = std::make_shared<proxy::proxy_group>(endpoint, cred_pair.has_value(), log_level_, log_stream_);
+
+            // Create TCP and UDP proxy server objects and start them if required
+            proxy.servers = create_proxy_servers(proxy.group, protocols, cred_pair, proxy.connection_pool);
+
+            // Redirected IPv6 flows are relayed by IPv6 servers connecting to the IPv4-mapped
+            // address of the proxy
+            const net::ip_endpoint<net::ip_address_v6> endpoint_v6{
+                net::ip_address_v6::v4_mapped(endpoint.ip), endpoint.port };
+
+            if (connection_pool_size != 0)
+            {
+                proxy.connection_pool_v6 = std::make_shared<proxy::socks5_connection_pool<net::ip_address_v6>>(
+                    endpoint_v6.ip, endpoint_v6.port,
+                    cred_pair ? std::optional(cred_pair.value().first) : std::nullopt,
+                    cred_pair ? std::optional(cred_pair.value().second) : std::nullopt,
+                    connection_pool_size, connection_pool_ttl, log_level_, log_stream_);
+            }
+
+            proxy.servers_v6 = create_proxy_servers<net::ip_address_v6>(
+                proxy.group, protocols, cred_pair, proxy.connection_pool_v6);
+
+            if (!start)
+                return proxy;
+
+            if (proxy.connection_pool)
+            {
+                proxy.connection_pool->start();
+            }
+
+            proxy.group->start();
+
+            // If successful in starting the servers, log the local listening ports
+            if (auto& tcp_server = proxy.servers.first)
+            {
+                if (!tcp_server->start())
+                {
+                    NETLIB_LOG(log_level::error, "Failed to start TCP SOCKS5 proxy {}", name);
+                    return {};
+                }
+
+                NETLIB_LOG(log_level::info, "Local TCP proxy for {} is listening port: {}", name, tcp_server->proxy_port());
+            }
+
+            if (auto& udp_server = proxy.servers.second)
+            {
+                if (!udp_server->start())
+                {
+                    NETLIB_LOG(log_level::error, "Failed to start UDP SOCKS5 proxy {}", name);
+                    return {};
+                }
+
+                NETLIB_LOG(log_level::info, "Local UDP proxy for {} is listening port: {}", name, udp_server->proxy_port());
+            }
+
+            if (proxy.connection_pool_v6)
+            {
+                proxy.connection_pool_v6->start();
+            }
+
+            if (auto& [tcp, udp] = proxy.servers_v6; (tcp && !tcp->start()) || (udp && !udp->start()))
+            {
+                // IPv6 may be disabled on this host, IPv4 traffic is proxied regardless
+                NETLIB_LOG(log_level::warning,
+                          "Failed to start the IPv6 proxies for {}, IPv6 traffic is not redirected", name);
+            }
+
+            return proxy;
+        }
+
+        /**
+         * @brief Exchanges a slot with the entries of the per-proxy vectors at a proxy ID. Must be
+         *        called under lock_.
+         */
+        void swap_proxy(const size_t proxy_id, proxy_slot& proxy) noexcept
+        {
+            std::swap(proxy_servers_[proxy_id], proxy.servers);
+            std::swap(proxy_servers_v6_[proxy_id], proxy.servers_v6);
+            std::swap(connection_pools_[proxy_id], proxy.connection_pool);
+            std::swap(connection_pools_v6_[proxy_id], proxy.connection_pool_v6);
+            std::swap(proxy_endpoints_[proxy_id], proxy.endpoint);
+            std::swap(proxy_groups_[proxy_id], proxy.group);
+            std::swap(dns_forwarders_[proxy_id], proxy.forwarder);
+        }
+
+        /**
+         * @brief Appends a proxy to the per-proxy vectors, its ID is the previous size of proxy_servers_.
+         *        Must be called under lock_.
+         *
+         * @throws std::bad_alloc, the vectors are unchanged then.
+         */
+        void push_proxy(proxy_slot&& proxy)
+        {
+            const auto proxy_id = proxy_servers_.size();
+            reserve_proxies(proxy_id + 1);
+
+            proxy_servers_.emplace_back();
+            proxy_servers_v6_.emplace_back();
+            connection_pools_.emplace_back();
+            connection_pools_v6_.emplace_back();
+            proxy_endpoints_.emplace_back();
+            proxy_groups_.emplace_back();
+            dns_forwarders_.emplace_back();
+
+            swap_proxy(proxy_id, proxy);
+        }
+
+        /**
+         * @brief Removes the last proxy from the per-proxy vectors. Must be called under lock_.
+         */
+        proxy_slot pop_proxy() noexcept
+        {
+            proxy_slot proxy;
+            swap_proxy(proxy_servers_.size() - 1, proxy);
+
+            proxy_servers_.pop_back();
+            proxy_servers_v6_.pop_back();
+            connection_pools_.pop_back();
+            connection_pools_v6_.pop_back();
+            proxy_endpoints_.pop_back();
+            proxy_groups_.pop_back();
+            dns_forwarders_.pop_back();
+
+            return proxy;
+        }
+
+        /**
+         * @brief Reserves room for @p count proxies in the per-proxy vectors, so appending cannot throw.
+         */
+        void reserve_proxies(const size_t count)
+        {
+            const auto reserve = [count](auto& entries)
+            {
+                if (entries.capacity() < count)
+                    entries.reserve(std::max(count, entries.capacity() * 2));
+            };
+
+            reserve(proxy_servers_);
+            reserve(proxy_servers_v6_);
+            reserve(connection_pools_);
+            reserve(connection_pools_v6_);
+            reserve(proxy_endpoints_);
+            reserve(proxy_groups_);
+            reserve(dns_forwarders_);
+        }
+
+        /**
+         * @brief Stops the forwarder, servers, connection pools and probing of a proxy taken out of the
+         *        per-proxy vectors. Must not be called under lock_, see stop().
+         */
+        static void stop_proxy(proxy_slot& proxy)
+        {
+            if (proxy.forwarder)
+                proxy.forwarder->stop();
+
+            const auto stop_servers = [](auto& servers)
+            {
+                if (servers.first)
+                    servers.first->stop();
+
+                if (servers.second)
+                    servers.second->stop();
+            };
+
+            stop_servers(proxy.servers);
+            stop_servers(proxy.servers_v6);
+
+            if (proxy.connection_pool)
+                proxy.connection_pool->stop();
+
+            if (proxy.connection_pool_v6)
+                proxy.connection_pool_v6->stop();
+
+            if (proxy.group)
+                proxy.group->stop();
+        }
+
+        /**
+         * @brief Creates the TCP and/or UDP proxy servers of one SOCKS5 proxy for an address family.
+         *
+         * The servers take the original destination of a redirected connection from tcp_mapper_v4_/
+         * tcp_mapper_v6_ and accept the UDP associations registered by the redirect of their family.
+         *
+         * Each session is started on the upstream the group selects and holds a lease on it. The
+         * IPv6 servers reach the IPv4 upstreams through their IPv4-mapped addresses.
+         *
+         * @param group The upstreams of the proxy.
+         * @param protocols The protocols to be proxied.
+         * @param cred_pair Optional username and password for authentication.
+         * @param connection_pool Pre-negotiated connections to the proxy, may be null.
+         * @return The TCP and UDP proxy servers, a server of an unsupported protocol is null.
+         */
+        template <net::ip_address T>
+        s5_proxy_servers<T> create_proxy_servers(
+            const std::shared_ptr<proxy::proxy_group>& group,
+            const supported_protocols protocols,
+            const std::optional<std::pair<std::string, std::string>>& cred_pair,
+            const std::shared_ptr<proxy::socks5_connection_pool<T>>& connection_pool)
+        {
+            // Picks the upstream of a new session, the lease and the group metrics are held by its negotiate context
+            const auto open_session = [group](auto& negotiate_ctx) -> net::ip_endpoint<T>
+            {
+                const auto [index, endpoint] = group->select();
+                negotiate_ctx->session_lease = group->open_session(index);
+                negotiate_ctx->metrics = group->get_session_metrics();
+
+                if constexpr (std::is_same_v<T, net::ip_address_v6>)
+                    return { net::ip_address_v6::v4_mapped(endpoint.ip), endpoint.port };
+                else
+                    return endpoint;
+            };
+
+            auto socks_tcp_proxy_server = (protocols == both || protocols == tcp)
+                                              ? std::make_unique<s5_tcp_proxy_server<T>>(
+                                                  0, io_ports_, [this, open_session, cred_pair](
+                                                  const T address, const uint16_t port)->
+                                                  std::tuple<T, uint16_t, std::unique_ptr<
+                                                                 typename s5_tcp_proxy_server<T>::negotiate_context_t>>
+                                                  {
+                                                      const auto [state, destination] = per_family<T>(tcp_mapper_v4_, tcp_mapper_v6_).take(port);
+
+                                                      if (state == tcp_port_map<T>::status::stale)
+                                                      {
+                                                          // The SYN that created the entry never produced a local
+                                                          // proxy connection within the TTL, do not misroute a new
+                                                          // connection on a reused source port.
+                                                          NETLIB_LOG(log_level::warning,
+                                                                    "TCP Redirect entry for port {} was stale (age exceeded TTL); discarding.",
+                                                                    port);
+                                                          return std::make_tuple(T{}, 0, nullptr);
+                                                      }
+
+                                                      if (state == tcp_port_map<T>::status::found)
+                                                      {
+                                                          NETLIB_LOG(log_level::info,
+                                                                    "TCP Redirect entry was found for the {} : {} is {} : {}",
+                                                                    address, port, destination.ip, destination.port);
+
+                                                          auto negotiate_ctx = std::make_unique<
+                                                              typename s5_tcp_proxy_server<T>::negotiate_context_t>(
+                                                              destination.ip, destination.port,
+                                                              cred_pair
+                                                                  ? std::optional(cred_pair.value().first)
+                                                                  : std::nullopt,
+                                                              cred_pair
+                                                                  ? std::optional(cred_pair.value().second)
+                                                                  : std::nullopt);
+
+                                                          const auto upstream = open_session(negotiate_ctx);
+
+                                                          return std::make_tuple(upstream.ip, upstream.port,
+                                                                                 std::move(negotiate_ctx));
+                                                      }
+
+                                                      return std::make_tuple(T{}, 0, nullptr);
+                                                  }, log_level_, log_stream_, fast_tcp_relay_, connection_pool)
+                                              : nullptr;
+
+            auto socks_udp_proxy_server = (protocols == both || protocols == udp)
+                                              ? std::make_unique<s5_udp_proxy_server<T>>(
+                                                  0, io_ports_, [this, open_session, cred_pair](
+                                                  const T address, const uint16_t port)->
+                                                  std::tuple<T, uint16_t, std::unique_ptr<
+                                                                 typename s5_udp_proxy_server<T>::negotiate_context_t>>
+                                                  {
+                                                      // Endpoints are registered by the packet path when the first
+                                                      // datagram of a redirected UDP flow is seen
+                                                      if (per_family<T>(udp_redirect_v4_, udp_redirect_v6_)->take_pending_endpoint(port))
+                                                      {
+                                                          NETLIB_LOG(log_level::info,
+                                                                    "UDP Redirect entry was found for the {} : {}",
+                                                                    address, port);
+
+                                                          auto negotiate_ctx = std::make_unique<
+                                                              typename s5_udp_proxy_server<T>::negotiate_context_t>(
+                                                              T{}, 0,
+                                                              cred_pair
+                                                                  ? std::optional(cred_pair.value().first)
+                                                                  : std::nullopt,
+                                                              cred_pair
+                                                                  ? std::optional(cred_pair.value().second)
+                                                                  : std::nullopt);
+
+                                                          const auto upstream = open_session(negotiate_ctx);
+
+                                                          return std::make_tuple(upstream.ip, upstream.port,
+                                                                                 std::move(negotiate_ctx));
+                                                      }
+
+                                                      return std::make_tuple(T{}, 0, nullptr);
+                                                  }, log_level_, log_stream_, registered_udp_io_,
+                                                  connection_pool)
+                                              : nullptr;
+
+            return { std::move(socks_tcp_proxy_server), std::move(socks_udp_proxy_server) };
+        }
+
+        /**
+         * @brief Builds a routing snapshot from proxy_servers_, proxy_servers_v6_, dns_forwarders_,
+         *        proxy_to_names_ and excluded_list_ and publishes it. Must be called under lock_.
+         * @return True on success, false if the snapshot could not be built (the previous one stays active).
+         */
+        bool publish_routing_snapshot() noexcept
+        {
+            try
+            {
+                // Generation 0 is reserved for "never matched" memo words
+                auto generation = routing_generation_ + 1;
+                if (generation == 0)
+                    generation = 1;
+
+                auto snapshot = std::make_shared<routing_snapshot>(routing_snapshot{
+                    next_routing_version_.fetch_add(1, std::memory_order_relaxed),
+                    app_name_matcher(generation, proxy_to_names_, excluded_list_),
+                    {},
+                    {},
+                    {},
+                    {},
+                    {}
+                });
+
+                // A server that is not listening has no port yet, its flows are passed
+                const auto publish = [](const auto& proxy_servers, auto& tcp_ports, auto& udp_ports)
+                {
+                    const auto listening_port = [](const auto& server)
+                    {
+                        return server && server->proxy_port() != 0 ? std::optional(server->proxy_port()) : std::nullopt;
+                    };
+
+                    tcp_ports.reserve(proxy_servers.size());
+                    udp_ports.reserve(proxy_servers.size());
+
+                    for (const auto& [tcp, udp] : proxy_servers)
+                    {
+                        tcp_ports.push_back(listening_port(tcp));
+                        udp_ports.push_back(listening_port(udp));
+                    }
+                };
+
+                publish(proxy_servers_, snapshot->tcp_ports, snapshot->udp_ports);
+                publish(proxy_servers_v6_, snapshot->tcp_ports_v6, snapshot->udp_ports_v6);
+
+                // Left empty without forwarders, so DNS queries are passed without a process lookup
+                if (std::ranges::any_of(dns_forwarders_, [](const auto& forwarder) { return forwarder != nullptr; }))
+                    snapshot->dns_forwarders = dns_forwarders_;
+
+                auto previous = routing_.load(std::memory_order_relaxed);
+
+                // Threads may still use the previous snapshot, see current_routing()
+                retired_routing_.push_back(previous);
+
+                update_proxy_ports(*previous, *snapshot);
+
+                const auto version = snapshot->version;
+                routing_.store(std::move(snapshot), std::memory_order_release);
+                routing_version_.store(version, std::memory_order_seq_cst);
+                routing_generation_ = generation;
+
+                reclaim_routing_snapshots();
+            }
+            catch (const std::exception& e) {
+                NETLIB_LOG(log_level::error, "Exception building routing snapshot: {}", e.what());
+                return false;
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Brings the proxy port bitmaps of both families from the ports of one snapshot to another.
+         *
+         * New ports are added before stale ones are removed so a port that stays in use is never
+         * reported missing. Must be called under lock_.
+         */
+        void update_proxy_ports(const routing_snapshot& from, const routing_snapshot& to) noexcept
+        {
+            const auto update = [](net::port_bitmap& bitmap, const std::vector<std::optional<uint16_t>>& old_ports,
+                                   const std::vector<std::optional<uint16_t>>& new_ports)
+            {
+                for (const auto& port : new_ports)
+                {
+                    if (port.value_or(0) != 0)
+                        bitmap.set(port.value());
+                }
+
+                for (const auto& port : old_ports)
+                {
+                    if (port.value_or(0) != 0 && std::ranges::find(new_ports, port) == new_ports.end())
+                        bitmap.reset(port.value());
+                }
+            };
+
+            update(tcp_proxy_ports_v4_, from.tcp_ports, to.tcp_ports);
+            update(udp_proxy_ports_v4_, from.udp_ports, to.udp_ports);
+            update(tcp_proxy_ports_v6_, from.tcp_ports_v6, to.tcp_ports_v6);
+            update(udp_proxy_ports_v6_, from.udp_ports_v6, to.udp_ports_v6);
+        }
+
+        /**
+         * @brief Frees the superseded snapshots no thread announces anymore. Must be called under lock_,
+         *        after the version of the current snapshot has been stored.
+         */
+        void reclaim_routing_snapshots() noexcept
+        {
+            std::scoped_lock readers_lock(routing_readers_->lock);
+
+            std::erase_if(retired_routing_, [this](const auto& snapshot)
+            {
+                return std::ranges::none_of(routing_readers_->readers, [&snapshot](const routing_reader& reader)
+                {
+                    return reader.version.load(std::memory_order_seq_cst) == snapshot->version;
+                });
+            });
+        }
+
+        /**
+         * @brief Returns the routing snapshot for the calling thread.
+         *
+         * Each thread keeps the version of the snapshot it used last with a non-owning pointer to it
+         * and re-loads routing_ (which updates the shared reference count) only after
+         * routing_version_ has changed, so in the steady state a packet costs a single plain atomic
+         * load and no locked operation. Versions are unique across router instances, so the cache
+         * never matches another router.
+         *
+         * The snapshot a thread switches to is announced in its routing_reader entry before the
+         * thread checks that it is still current. A publisher that supersedes it afterwards finds the
+         * announcement and keeps it in retired_routing_ until the thread announces another one, see
+         * reclaim_routing_snapshots(). A thread idle in the packet path thus keeps one snapshot alive.
+         *
+         * @return Reference to the snapshot, valid until the next call on the same thread.
+         */
+        const routing_snapshot& current_routing() const
+        {
+            struct thread_cache
+            {
+                uint64_t version{ 0 };
+                const routing_snapshot* snapshot{ nullptr };
+                std::shared_ptr<routing_readers> readers;
+                routing_reader* reader{ nullptr };
+
+                thread_cache() = default;
+                thread_cache(const thread_cache&) = delete;
+                thread_cache& operator=(const thread_cache&) = delete;
+
+                ~thread_cache()
+                {
+                    detach();
+                }
+
+                // Takes a free entry of a router, a thread running the packet path of several
+                // routers moves from one to the other
+                void attach(const std::shared_ptr<routing_readers>& to)
+                {
+                    detach();
+
+                    std::scoped_lock lock(to->lock);
+
+                    const auto free = std::ranges::find_if(to->readers, [](const routing_reader& entry)
+                    {
+                        return !entry.in_use;
+                    });
+
+                    reader = free != to->readers.end() ? &*free : &to->readers.emplace_back();
+                    reader->in_use = true;
+                    readers = to;
+                }
+
+                void detach() noexcept
+                {
+                    if (!reader)
+                        return;
+
+                    reader->version.store(0, std::memory_order_release);
+
+                    std::scoped_lock lock(readers->lock);
+                    reader->in_use = false;
+                    reader = nullptr;
+                    readers.reset();
+                    snapshot = nullptr;
+                    version = 0;
+                }
+            };
+
+            thread_local thread_cache cache;
+
+            if (routing_version_.load(std::memory_order_acquire) != cache.version || !cache.snapshot)
+            {
+                if (cache.readers != routing_readers_)
+                    cache.attach(routing_readers_);
+
+                for (;;)
+                {
+                    // Owned by routing_ at the check below and by retired_routing_ once superseded
+                    const auto snapshot = routing_.load(std::memory_order_acquire);
+                    cache.reader->version.store(snapshot->version, std::memory_order_seq_cst);
+
+                    if (routing_version_.load(std::memory_order_seq_cst) == snapshot->version)
+                    {
+                        cache.snapshot = snapshot.get();
+                        cache.version = snapshot->version;
+                        break;
+                    }
+                }
+            }
+
+            return *cache.snapshot;
+        }
 
-            // Otherwise, return an empty std::optional.
-            return {};
+        /**
+         * @brief Matches a process against the configured associations and exclusions.
+         *
+         * The result is memoized in the process entry and reused until the configuration changes.
+         * The router's own process never matches.
+         *
+         * @param routing The routing snapshot of the current packet.
+         * @param process The process details to check.
+         * @return The (possibly memoized) match result.
+         */
+        static app_name_matcher::match_result match_process(const routing_snapshot& routing,
+                                                            const std::shared_ptr<iphelper::network_process>& process)
+        {
+            const auto& matcher = routing.matcher;
+
+            if (const auto memoized = matcher.decode(process->proxy_match.load(std::memory_order_relaxed)))
+                return memoized.value();
+
+            const auto result = (process->id == ::GetCurrentProcessId())
+                ? app_name_matcher::match_result{}
+                : matcher.match(process->name, process->path_name);
+
+            process->proxy_match.store(matcher.encode(result), std::memory_order_relaxed);
+
+            return result;
         }
 
-    private:
-        /// <summary>
-        /// Converts std::wstring to upper case
-        /// </summary>
-        /// <param name="str">wide char string to convert</param>
-        /// <returns>resulted wide char string</returns>
-        static std::wstring to_upper(const std::wstring& str)
+        /**
+         * @brief Returns the redirect decider key of a process, memoized in the process entry.
+         *
+         * @param process The process details.
+         * @return The key produced by the redirect_key_t callback for the process name.
+         */
+        uint32_t redirect_key_of(const std::shared_ptr<iphelper::network_process>& process) const
         {
-            std::wstring upper_case;
-            std::ranges::transform(str, std::back_inserter(upper_case), toupper);
-            return upper_case;
+            if (const auto memo = process->redirect_key.load(std::memory_order_relaxed);
+                static_cast<uint32_t>(memo >> 32) == redirect_key_generation_)
+            {
+                return static_cast<uint32_t>(memo);
+            }
+
+            const auto key = redirect_key_of_ ? redirect_key_of_(process->name) : 0;
+            process->redirect_key.store(static_cast<uint64_t>(redirect_key_generation_) << 32 | key,
+                                        std::memory_order_relaxed);
+            return key;
+        }
+
+        /**
+         * Retrieves the TCP proxy port number associated with a given process name.
+         * @tparam T The address family of the flow, selects the proxy servers of that family.
+         * @param routing The routing snapshot of the current packet.
+         * @param process The pointer to network_process.
+         * @return A std::optional containing the TCP port number if the process name is found,
+         *         or an empty std::optional otherwise.
+         */
+        template <net::ip_address T>
+        static std::optional<uint16_t> get_proxy_port_tcp(const routing_snapshot& routing,
+                                                           const std::shared_ptr<iphelper::network_process>& process)
+        {
+            if (!process) return {};
+
+            const auto match = match_process(routing, process);
+            if (!match.proxy_id) return {};
+
+            return per_family<T>(routing.tcp_ports, routing.tcp_ports_v6)[match.proxy_id.value()];
+        }
+
+        /**
+         * Retrieves the UDP proxy port number associated with a given process name.
+         * @tparam T The address family of the flow, selects the proxy servers of that family.
+         * @param routing The routing snapshot of the current packet.
+         * @param process The pointer to network_process.
+         * @return A std::optional containing the UDP port number if the process name is found,
+         *         or an empty std::optional otherwise.
+         */
+        template <net::ip_address T>
+        static std::optional<uint16_t> get_proxy_port_udp(const routing_snapshot& routing,
+                                                           const std::shared_ptr<iphelper::network_process>& process)
+        {
+            if (!process) return {};
+
+            const auto match = match_process(routing, process);
+            if (!match.proxy_id) return {};
+
+            return per_family<T>(routing.udp_ports, routing.udp_ports_v6)[match.proxy_id.value()];
+        }
+
+        /**
+         * Checks if the given TCP port number is being used by any of the current proxy servers.
+         * @tparam T The address family of the proxy servers.
+         * @param port The TCP port number to check.
+         * @return True if the port number is used by any proxy server, false otherwise.
+         */
+        template <net::ip_address T>
+        bool is_tcp_proxy_port(const uint16_t port) const noexcept
+        {
+            return per_family<T>(tcp_proxy_ports_v4_, tcp_proxy_ports_v6_).test(port);
+        }
+
+        /**
+         * Checks if the given UDP port number is being used by any of the current proxy servers.
+         * @tparam T The address family of the proxy servers.
+         * @param port The UDP port number to check.
+         * @return True if the port number is used by any proxy server, false otherwise.
+         */
+        template <net::ip_address T>
+        bool is_udp_proxy_port(const uint16_t port) const noexcept
+        {
+            return per_family<T>(udp_proxy_ports_v4_, udp_proxy_ports_v6_).test(port);
+        }
+
+        /**
+         * @brief Consults the optional redirect decider (per-process destination include policy).
+         *
+         * @param process The process owning the flow.
+         * @param destination The destination address of the flow.
+         * @param destination_port The destination port, in network byte order.
+         * @return True if the flow may be redirected, which is always the case without a decider.
+         */
+        template <net::ip_address T>
+        bool is_redirect_allowed(const std::shared_ptr<iphelper::network_process>& process, const T& destination,
+                                 const uint16_t destination_port)
+        {
+            if (!redirect_decider_)
+                return true;
+
+            if constexpr (std::is_same_v<T, net::ip_address_v4>)
+            {
+                sockaddr_in dst{};
+                dst.sin_family = AF_INET;
+                dst.sin_addr = destination;
+                dst.sin_port = destination_port;
+
+                return redirect_decider_(redirect_key_of(process), reinterpret_cast<sockaddr*>(&dst), sizeof(dst));
+            }
+            else
+            {
+                sockaddr_in6 dst{};
+                dst.sin6_family = AF_INET6;
+                dst.sin6_addr = destination;
+                dst.sin6_port = destination_port;
+
+                return redirect_decider_(redirect_key_of(process), reinterpret_cast<sockaddr*>(&dst), sizeof(dst));
+            }
+        }
+
+        /**
+         * @brief Decides on an IPv4 or IPv6 packet seen by the packet filter.
+         *
+         * Broadcast and multicast UDP and protocols other than TCP and UDP are passed, so are IPv6
+         * fragments without a transport header. TCP and UDP packets go through process_tcp_packet()/
+         * process_udp_packet(), or are queued for the resolver thread if their owner is not known yet
+         * or earlier packets of their flow are queued.
+         *
+         * @tparam T The address family of the packet.
+         * @param buffer The packet, an Ethernet frame carrying IPv4 or IPv6 according to T.
+         * @return The packet action.
+         */
+        template <net::ip_address T>
+        packet_filter::packet_action filter_ip_packet(ndisapi::intermediate_buffer& buffer)
+        {
+            const auto packet = parse_transport_packet<T>(buffer);
+
+            if (packet.transport_header == nullptr ||
+                (packet.protocol != IPPROTO_TCP && packet.protocol != IPPROTO_UDP))
+            {
+                return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
+            }
+
+            if (packet.protocol == IPPROTO_UDP)
+            {
+                const auto destination_mac =
+                    net::mac_address(reinterpret_cast<ether_header_ptr>(buffer.m_IBuffer)->h_dest);
+
+                // skip broadcast and multicast UDP packets
+                if (destination_mac.is_broadcast() || destination_mac.is_multicast())
+                {
+                    return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
+                }
+            }
+
+            // Follow-up packets of a flow with deferred packets must not overtake them
+            if (const auto& holds = per_family<T>(flow_holds_v4_, flow_holds_v6_);
+                holds.empty() || !holds.is_held(flow_holds<T>::slot_of(packet_flow_key(packet))))
+            {
+                const auto result = packet.protocol == IPPROTO_TCP
+                                        ? process_tcp_packet(buffer, packet, false)
+                                        : process_udp_packet(buffer, packet, false);
+                if (result)
+                {
+                    return result.value();
+                }
+            }
+
+            return enqueue_for_deferred_resolve(buffer, packet);
+        }
+
+        /**
+         * @brief Processes a UDP packet for possible redirection through a proxy.
+         *
+         * This function inspects the provided intermediate_buffer, attempts to resolve the associated process,
+         * and determines if the UDP packet should be redirected to a proxy port, passed through, or reverted.
+         * If the process cannot be resolved and @p postponed is false, the function returns std::nullopt,
+         * indicating that the packet should be queued for later processing. If @p postponed is true, a
+         * second attempt is made to resolve the process using an updated process table.
+         *
+         * If the process is associated with a UDP proxy, and the packet is from a new endpoint, the source
+         * port is recorded and a redirection is logged. The function then attempts to process the packet for
+         * client-to-server redirection. If the packet is from a known proxy port, it attempts to process it
+         * for server-to-client redirection.
+         *
+         * @tparam T The address family of the packet, selects the fast-path structures of that family.
+         * @param buffer Reference to the intermediate_buffer containing the packet data.
+         * @param packet The parsed addresses and UDP header of the packet.
+         * @param postponed If false, only the current process table is used for lookup. If true, the process
+         *        table is refreshed and a second lookup is attempted.
+         * @return std::optional<packet_filter::packet_action> indicating the action to take:
+         *         - std::nullopt: process could not be resolved (should be queued for later)
+         *         - packet_action::revert: packet should be reverted (redirected)
+         *         - packet_action::pass: packet should be passed through
+         * (unchanged comment)
+         */
+        template <net::ip_address T>
+        std::optional<packet_filter::packet_action> process_udp_packet(ndisapi::intermediate_buffer& buffer,
+                                                                       const transport_packet<T>& packet,
+                                                                       const bool postponed)
+        {
+            const auto* const udp_header = reinterpret_cast<udphdr_ptr>(packet.transport_header);
+
+            // DNS queries are never redirected to the UDP proxy, the DNS forwarders may take them
+            if (ntohs(udp_header->th_dport) == 53)
+            {
+                return process_dns_packet(buffer, packet, postponed);
+            }
+
+            auto& cache = per_family<T>(flow_cache_v4_, flow_cache_v6_);
+            auto& udp_redirect = *per_family<T>(udp_redirect_v4_, udp_redirect_v6_);
+
+            const typename flow_verdict_cache<T>::flow_key flow_key{
+                packet.source, packet.destination,
+                ntohs(udp_header->th_sport), ntohs(udp_header->th_dport), IPPROTO_UDP };
+
+            // Packets of a known flow take a single cache lookup
+            uint32_t generation = 0;
+            if (const auto cached = cache.find(flow_key, generation))
+            {
+                if (const auto action = apply_cached_udp_verdict<T>(buffer, cached.value()))
+                {
+                    if (cached->verdict == flow_verdict::pass)
+                        count_kernel_bypass_candidate<T>(buffer, flow_key);
+                    return action;
+                }
+
+                cache.erase(flow_key);
+            }
+
+            // Read after the lookup, a decision made on it is cached only if it is still current
+            const auto& routing = current_routing();
+
+            // If the packet is from a known proxy port, process for server-to-client redirection
+            if (is_udp_proxy_port<T>(ntohs(udp_header->th_sport)))
+            {
+                if (udp_redirect.process_server_to_client_packet(buffer))
+                {
+                    cache.insert(flow_key, generation, flow_verdict::revert);
+                    log_packet_to_pcap(buffer);
+                    return packet_filter::packet_action{ packet_filter::packet_action::action_type::revert };
+                }
+            }
+
+            auto& lookup = per_family<T>(process_lookup_v4_, process_lookup_v6_);
+
+            auto process = lookup.
+                template lookup_process_for_udp<false>(net::ip_endpoint<T>{
+                packet.source, ntohs(udp_header->th_sport)
+            });
+
+            if (!process)
+            {
+                if (postponed)
+                {
+                    process = lookup.
+                        template lookup_process_for_udp<true>(net::ip_endpoint<T>{
+                        packet.source, ntohs(udp_header->th_sport)
+                    });
+                }
+                else
+                {
+                    return std::nullopt;
+                }
+            }
+
+            // The default process stands in for an unresolved owner, its decision must not stick
+            const auto cacheable = process->id != 0;
+
+            note_pcap_flow_owner(routing, process, IPPROTO_UDP, ntohs(udp_header->th_sport));
+
+            // Excluded processes and processes without an associated proxy are never redirected
+            if (!match_process(routing, process).proxy_id)
+            {
+                if (cacheable)
+                    cache.insert(flow_key, generation, flow_verdict::pass);
+                return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
+            }
+
+            if (!is_redirect_allowed(process, packet.destination, udp_header->th_dport))
+            {
+                // Do NOT redirect this destination for this process
+                if (cacheable)
+                    cache.insert(flow_key, generation, flow_verdict::pass);
+                return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
+            }
+
+            // The per-process proxy port overrides are only ever set for IPv4 proxy servers
+            auto port = get_proxy_port_udp<T>(routing, process);
+            if constexpr (std::is_same_v<T, net::ip_address_v4>)
+            {
+                if (process->udp_proxy_port)
+                    port = process->udp_proxy_port;
+            }
+
+            if (port.has_value())
+            {
+                if (udp_redirect.is_new_endpoint(buffer))
+                {
+                    count_redirected_flow(process, false);
+
+                    NETLIB_LOG_THROTTLED(log_level::info, flow_log_rate_, flow_log_burst_,
+                        "Redirecting UDP {} : {} -> {} : {}",
+                        packet.source, ntohs(udp_header->th_sport),
+                        packet.destination, ntohs(udp_header->th_dport));
+                }
+
+                if (udp_redirect.process_client_to_server_packet(buffer, htons(port.value())))
+                {
+                    if (cacheable)
+                        cache.insert(flow_key, generation, flow_verdict::redirect, port.value());
+                    log_packet_to_pcap(buffer);
+                    return packet_filter::packet_action{ packet_filter::packet_action::action_type::revert };
+                }
+
+            }
+            else
+            {
+                if (cacheable)
+                    cache.insert(flow_key, generation, flow_verdict::pass);
+            }
+
+            return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
         }
 
         /**
-         * @brief Matches an application name pattern against the process details with exclusion support.
-         *
-         * This function performs a two-stage matching process:
-         * 1. First, it checks if the process should be excluded based on the exclusion list
-         * 2. Then, it performs pattern matching if the process is not excluded
+         * @brief Resolves a DNS query of a proxied process through the DNS forwarder of its proxy.
          *
-         * For both exclusion checking and pattern matching, the function uses intelligent field selection:
-         * - If the pattern/exclusion entry contains path separators ("/" or "\\"), it matches against the process's full path_name
-         * - If the pattern/exclusion entry contains no path separators, it matches against the process's name only
+         * A query answered from the forwarder cache is turned into the response in place and
+         * reverted to the stack. Other queries are dropped and their response is injected into the
+         * stack by the forwarder once it has arrived; if the forwarder is overloaded the query is
+         * just dropped and the client retries. Queries of processes without a forwarding proxy,
+         * queries to destinations the redirect decider excludes and messages the forwarder does not
+         * handle are passed.
          *
-         * The pattern matching is performed case-insensitively using substring matching.
-         * The function automatically excludes the current process (by process ID) to prevent self-matching.
-         *
-         * @param app The application name or pattern to check against the process details.
-         *            Can be either a simple process name (e.g., "notepad.exe") or a path-based pattern (e.g., "C:\\Windows\\System32\\notepad.exe").
-         * @param process The process details to check against the application pattern.
-         *                Must contain valid name and path_name fields for comparison.
-         * @return true if the process details match the application pattern and are not in the exclusion list,
-         *              and are not the current process; false otherwise.
-         *
-         * @note This function does not perform caching. Caching is handled at a higher level by the
-         *       get_proxy_port_tcp() and get_proxy_port_udp() functions using process_to_proxy_cache_.
-         *
-         * @note The function performs direct string matching without regex support. All comparisons
-         *       are case-sensitive as input is already converted to uppercase by calling functions.
+         * @tparam T The address family of the packet.
+         * @param buffer Reference to the intermediate_buffer containing the packet data.
+         * @param packet The parsed addresses and UDP header of the packet.
+         * @param postponed If false, only the current process table is used for lookup.
+         * @return std::nullopt if the process could not be resolved (should be queued for later),
+         *         the packet action otherwise.
          */
-        bool match_app_name(const std::wstring& app, const std::shared_ptr<iphelper::network_process>& process) const
+        template <net::ip_address T>
+        std::optional<packet_filter::packet_action> process_dns_packet(ndisapi::intermediate_buffer& buffer,
+                                                                       const transport_packet<T>& packet,
+                                                                       const bool postponed)
         {
-            if (!process) return false;
+            const auto& routing = current_routing();
 
-            // Exclude the current process by process ID (not cached since it's a quick check)
-            if (process->id == ::GetCurrentProcessId())
-                return false;
-
-            // Check exclusion list
-            for (const auto& excluded_entry : excluded_list_) {
-                if ((excluded_entry.find(L'\\') != std::wstring::npos || excluded_entry.find(L'/') != std::wstring::npos)
-                    ? (process->path_name.find(excluded_entry) != std::wstring::npos)
-                    : (process->name.find(excluded_entry) != std::wstring::npos)
-                    ) {
-                    process->excluded = true;
-                    return false; // Excluded
-                }
+            if (routing.dns_forwarders.empty())
+            {
+                return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
             }
 
-            return (app.find(L'\\') != std::wstring::npos || app.find(L'/') != std::wstring::npos)
-                    ? (process->path_name.find(app) != std::wstring::npos)
-                    : (process->name.find(app) != std::wstring::npos);
-        }
+            const auto* const udp_header = reinterpret_cast<udphdr_ptr>(packet.transport_header);
+            const net::ip_endpoint<T> source{ packet.source, ntohs(udp_header->th_sport) };
 
-        /**
-         * Retrieves the TCP proxy port number associated with a given process name.
-         * @param process The pointer to network_process.
-         * @return A std::optional containing the TCP port number if the process name is found,
-         *         or an empty std::optional otherwise.
-         */
-        std::optional<uint16_t> get_proxy_port_tcp(const std::shared_ptr<iphelper::network_process>& process)
-        {
-            if (!process) return {};
+            auto& lookup = per_family<T>(process_lookup_v4_, process_lookup_v6_);
 
-            std::shared_lock lock(lock_);
+            auto process = lookup.template lookup_process_for_udp<false>(source);
 
-            for (const auto& [proxy_id, process_pattern] : proxy_to_names_)
+            if (!process)
             {
-                if (match_app_name(process_pattern, process))
-                {
-                    return proxy_servers_[proxy_id].first
-                        ? std::optional(proxy_servers_[proxy_id].first->proxy_port())
-                        : std::nullopt;
-                }
+                if (!postponed)
+                    return std::nullopt;
+
+                process = lookup.template lookup_process_for_udp<true>(source);
             }
 
-            return {};
-        }
+            const auto proxy_id = match_process(routing, process).proxy_id;
 
-        /**
-         * Retrieves the UDP proxy port number associated with a given process name.
-         * @param process The pointer to network_process.
-         * @return A std::optional containing the UDP port number if the process name is found,
-         *         or an empty std::optional otherwise.
-         */
-        std::optional<uint16_t> get_proxy_port_udp(const std::shared_ptr<iphelper::network_process>& process)
-        {
-            if (!process) return {};
+            if (!proxy_id || !routing.dns_forwarders[proxy_id.value()] ||
+                !is_redirect_allowed(process, packet.destination, udp_header->th_dport))
+            {
+                return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
+            }
 
-            std::shared_lock lock(lock_);
+            auto& forwarder = *routing.dns_forwarders[proxy_id.value()];
 
-            // Search for a matching process pattern
-            for (const auto& [proxy_id, process_pattern] : proxy_to_names_)
+            auto* const payload = packet.transport_header + sizeof(udphdr);
+            const auto transport_offset = static_cast<size_t>(packet.transport_header - buffer.m_IBuffer);
+            const auto frame_length = std::min<size_t>(buffer.m_Length, MAX_ETHER_FRAME);
+
+            if (transport_offset + sizeof(udphdr) > frame_length || ntohs(udp_header->length) < sizeof(udphdr))
             {
-                if (match_app_name(process_pattern, process))
-                {
-                    return proxy_servers_[proxy_id].second
-                        ? std::optional(proxy_servers_[proxy_id].second->proxy_port())
-                        : std::nullopt;
-                }
+                return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
             }
 
-            return {};
-        }
+            const std::span<const uint8_t> query{
+                payload, std::min<size_t>(ntohs(udp_header->length) - sizeof(udphdr),
+                                          frame_length - transport_offset - sizeof(udphdr)) };
 
-        /**
-         * Checks if the given TCP port number is being used by any of the current proxy servers.
-         * @param port The TCP port number to check.
-         * @return True if the port number is used by any proxy server, false otherwise.
-         */
-        bool is_tcp_proxy_port(const uint16_t port)
-        {
-            // Locks the proxy servers list for reading.
-            std::shared_lock lock(lock_);
+            // The response replaces the query and may use the whole frame
+            if (const auto length = forwarder.answer(query, { payload, buffer.m_IBuffer + MAX_ETHER_FRAME });
+                length != 0)
+            {
+                build_dns_reply<T>(buffer, packet.transport_header, length);
+                log_packet_to_pcap(buffer);
+                return packet_filter::packet_action{ packet_filter::packet_action::action_type::revert };
+            }
+
+            // The query frame becomes the response frame, each asker needs a copy of its own
+            const std::shared_ptr<ndisapi::intermediate_buffer> reply =
+                ndisapi::intermediate_buffer_pool::instance().allocate(buffer);
 
-            // Checks each proxy server to see if the given port number is being used.
-            // Returns true if any server is using the port, false otherwise.
-            return std::ranges::any_of(std::as_const(proxy_servers_), [port](auto& proxy)
+            if (!reply)
             {
-                if (proxy.first && proxy.first->proxy_port() == port)
-                    return true;
-                return false;
+                return packet_filter::packet_action{ packet_filter::packet_action::action_type::drop };
+            }
+
+            const auto result = forwarder.forward(query, [this, reply, transport_offset](const std::span<const uint8_t> response)
+            {
+                auto* const transport_header = reply->m_IBuffer + transport_offset;
+                auto* const reply_payload = transport_header + sizeof(udphdr);
+
+                const auto length = dns_cache::copy_response(response, { reply_payload, reply->m_IBuffer + MAX_ETHER_FRAME });
+                if (length == 0)
+                    return;
+
+                build_dns_reply<T>(*reply, transport_header, length);
+                send_packet_to_mstcp(*reply);
             });
+
+            switch (result)
+            {
+            case dns_forwarder::forward_result::pending:
+            case dns_forwarder::forward_result::overloaded:
+                return packet_filter::packet_action{ packet_filter::packet_action::action_type::drop };
+            case dns_forwarder::forward_result::rejected:
+            default:
+                return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
+            }
         }
 
         /**
-         * Checks if the given UDP port number is being used by any of the current proxy servers.
-         * @param port The UDP port number to check.
-         * @return True if the port number is used by any proxy server, false otherwise.
+         * @brief Turns a DNS query frame into the response frame for the stack.
+         *
+         * The response has been written over the query payload. Ethernet and IP addresses and UDP
+         * ports are swapped, the lengths set and the checksums recalculated.
+         *
+         * @tparam T The address family of the packet.
+         * @param buffer The frame of the query.
+         * @param transport_header The UDP header of the query within buffer.
+         * @param length The length of the DNS response.
          */
-        bool is_udp_proxy_port(const uint16_t port)
+        template <net::ip_address T>
+        static void build_dns_reply(ndisapi::intermediate_buffer& buffer, uint8_t* const transport_header,
+                                    const size_t length) noexcept
         {
-            // Locks the proxy servers list for reading.
-            std::shared_lock lock(lock_);
+            auto* const eth_header = reinterpret_cast<ether_header_ptr>(buffer.m_IBuffer);
+            auto* const udp_header = reinterpret_cast<udphdr_ptr>(transport_header);
+            const auto udp_length = static_cast<uint16_t>(sizeof(udphdr) + length);
+
+            std::swap(eth_header->h_dest, eth_header->h_source);
+            std::swap(udp_header->th_sport, udp_header->th_dport);
+            udp_header->length = htons(udp_length);
 
-            // Checks each proxy server to see if the given port number is being used.
-            // Returns true if any server is using the port, false otherwise.
-            return std::ranges::any_of(std::as_const(proxy_servers_), [port](auto& proxy)
+            buffer.m_Length = static_cast<ULONG>(transport_header - buffer.m_IBuffer) + udp_length;
+
+            if constexpr (std::is_same_v<T, net::ip_address_v4>)
             {
-                if (proxy.second && proxy.second->proxy_port() == port)
-                    return true;
-                return false;
-            });
+                auto* const ip_header = reinterpret_cast<iphdr_ptr>(buffer.m_IBuffer + ETHER_HEADER_LENGTH);
+
+                std::swap(ip_header->ip_dst, ip_header->ip_src);
+                ip_header->ip_len = htons(static_cast<uint16_t>(
+                    transport_header - reinterpret_cast<uint8_t*>(ip_header) + udp_length));
+
+                net::ip_checksum::recalculate_ipv4_transport(buffer);
+                net::ip_checksum::recalculate_ipv4_header(buffer);
+            }
+            else
+            {
+                auto* const ip_header = reinterpret_cast<ipv6hdr_ptr>(buffer.m_IBuffer + ETHER_HEADER_LENGTH);
+
+                std::swap(ip_header->ip6_dst, ip_header->ip6_src);
+                ip_header->ip6_len = htons(static_cast<uint16_t>(
+                    transport_header - reinterpret_cast<uint8_t*>(ip_header + 1) + udp_length));
+
+                net::ipv6_helper::recalculate_tcp_udp_checksum(&buffer);
+            }
         }
 
         /**
-         * @brief Processes a UDP packet for possible redirection through a proxy.
+         * @brief Processes a TCP packet for possible redirection through a proxy.
          *
          * This function inspects the provided intermediate_buffer, attempts to resolve the associated process,
          * and determines if the UDP packet should be redirected to a proxy port, passed through, or reverted.
@@ -1305,7 +4094,9 @@ namespace proxy
          * client-to-server redirection. If the packet is from a known proxy port, it attempts to process it
          * for server-to-client redirection.
          *
+         * @tparam T The address family of the packet, selects the fast-path structures of that family.
          * @param buffer Reference to the intermediate_buffer containing the packet data.
+         * @param packet The parsed addresses and TCP header of the packet.
          * @param postponed If false, only the current process table is used for lookup. If true, the process
          *        table is refreshed and a second lookup is attempted.
          * @return std::optional<packet_filter::packet_action> indicating the action to take:
@@ -1314,42 +4105,75 @@ namespace proxy
          *         - packet_action::pass: packet should be passed through
          * (unchanged comment)
          */
-        std::optional<packet_filter::packet_action> process_udp_packet(ndisapi::intermediate_buffer& buffer, const bool postponed)
+        template <net::ip_address T>
+        std::optional<packet_filter::packet_action> process_tcp_packet(ndisapi::intermediate_buffer& buffer,
+                                                                       const transport_packet<T>& packet,
+                                                                       const bool postponed)
         {
-            auto* const ethernet_header = reinterpret_cast<ether_header_ptr>(buffer.m_IBuffer);
-            auto* const ip_header = reinterpret_cast<iphdr_ptr>(ethernet_header + 1);
-            const auto* const udp_header = reinterpret_cast<udphdr_ptr>(reinterpret_cast<PUCHAR>(ip_header)
-                + sizeof(DWORD) * ip_header->ip_hl);
+            const auto* const tcp_header = reinterpret_cast<tcphdr_ptr>(packet.transport_header);
 
-            // If the destination port is 53 (DNS), allow the packet to pass through without redirection
-            // TODO: We might consider adding a DNS proxy in the future
-            if (ntohs(udp_header->th_dport) == 53)
+            auto& cache = per_family<T>(flow_cache_v4_, flow_cache_v6_);
+            auto& tcp_redirect = *per_family<T>(tcp_redirect_v4_, tcp_redirect_v6_);
+
+            const typename flow_verdict_cache<T>::flow_key flow_key{
+                packet.source, packet.destination,
+                ntohs(tcp_header->th_sport), ntohs(tcp_header->th_dport), IPPROTO_TCP };
+
+            // SYN creates the redirect state and always takes the slow path, FIN/RST end the flow
+            const auto is_syn = (tcp_header->th_flags & (TH_SYN | TH_ACK)) == TH_SYN;
+            const auto cacheable_packet = !(tcp_header->th_flags & (TH_FIN | TH_RST));
+
+            // Packets of an established flow take a single cache lookup
+            auto generation = cache.current_generation();
+            if (!is_syn)
             {
-                return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
+                if (const auto cached = cache.find(flow_key, generation))
+                {
+                    if (!cacheable_packet)
+                        cache.erase(flow_key);
+
+                    if (const auto action = apply_cached_tcp_verdict<T>(buffer, cached.value()))
+                    {
+                        if (cached->verdict == flow_verdict::pass && cacheable_packet)
+                            count_kernel_bypass_candidate<T>(buffer, flow_key);
+                        return action;
+                    }
+
+                    cache.erase(flow_key);
+                }
             }
 
+            // Read after the lookup, a decision made on it is cached only if it is still current
+            const auto& routing = current_routing();
+
             // If the packet is from a known proxy port, process for server-to-client redirection
-            if (is_udp_proxy_port(ntohs(udp_header->th_sport)))
+            if (is_tcp_proxy_port<T>(ntohs(tcp_header->th_sport)))
             {
-                if (udp_redirect_->process_server_to_client_packet(buffer))
+                if (tcp_redirect.process_server_to_client_packet(buffer))
                 {
+                    if (cacheable_packet)
+                        cache.insert(flow_key, generation, flow_verdict::revert);
                     log_packet_to_pcap(buffer);
                     return packet_filter::packet_action{ packet_filter::packet_action::action_type::revert };
                 }
             }
 
-            auto process = process_lookup_v4_.
-                lookup_process_for_udp<false>(net::ip_endpoint<net::ip_address_v4>{
-                ip_header->ip_src, ntohs(udp_header->th_sport)
+            auto& lookup = per_family<T>(process_lookup_v4_, process_lookup_v6_);
+
+            auto process = lookup.
+                template lookup_process_for_tcp<false>(net::ip_session<T>{
+                packet.source, packet.destination, ntohs(tcp_header->th_sport),
+                    ntohs(tcp_header->th_dport)
             });
 
             if (!process)
             {
                 if (postponed)
                 {
-                    process = process_lookup_v4_.
-                        lookup_process_for_udp<true>(net::ip_endpoint<net::ip_address_v4>{
-                        ip_header->ip_src, ntohs(udp_header->th_sport)
+                    process = lookup.
+                        template lookup_process_for_tcp<true>(net::ip_session<T>{
+                        packet.source, packet.destination, ntohs(tcp_header->th_sport),
+                            ntohs(tcp_header->th_dport)
                     });
                 }
                 else
@@ -1358,184 +4182,463 @@ namespace proxy
                 }
             }
 
-            if (process->excluded || process->bypass_udp)
-                return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
+            // The default process stands in for an unresolved owner, its decision must not stick
+            const auto cacheable = cacheable_packet && process->id != 0;
+
+            note_pcap_flow_owner(routing, process, IPPROTO_TCP, ntohs(tcp_header->th_sport));
 
-            // -------- NEW: consult optional redirect decider (per-process CIDR include) --------
-			// Consult optional per-process destination include policy
-			if (redirect_decider_)
-			{
-			    sockaddr_in dst{};
-			    dst.sin_family = AF_INET;
-			    dst.sin_addr   = ip_header->ip_dst;      // <-- assign in_addr directly (fixes C2440)
-			    dst.sin_port   = udp_header->th_dport;   // already in network byte order
+            // Excluded processes and processes without an associated proxy are never redirected
+            if (!match_process(routing, process).proxy_id)
+            {
+                if (cacheable)
+                    cache.insert(flow_key, generation, flow_verdict::pass);
+                return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
+            }
 
-			    if (!redirect_decider_(process->name, reinterpret_cast<sockaddr*>(&dst), sizeof(dst)))
-			    {
-			        // Do NOT redirect this destination for this process
-			        return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
-			    }
-			}
+            if (!is_redirect_allowed(process, packet.destination, tcp_header->th_dport))
+            {
+                // Do NOT redirect this destination for this process
+                if (cacheable)
+                    cache.insert(flow_key, generation, flow_verdict::pass);
+                return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
+            }
 
-            // ------------------------------------------------------------------------------------
+            // The per-process proxy port overrides are only ever set for IPv4 proxy servers
+            auto port = get_proxy_port_tcp<T>(routing, process);
+            if constexpr (std::is_same_v<T, net::ip_address_v4>)
+            {
+                if (process->tcp_proxy_port)
+                    port = process->tcp_proxy_port;
+            }
 
-            if (const auto port = process->udp_proxy_port ? process->udp_proxy_port : get_proxy_port_udp(process); port.has_value())
+            if (port.has_value())
             {
-                if (udp_redirect_->is_new_endpoint(buffer))
+                // If this is a SYN packet (connection initiation), map the source port to the destination endpoint
+                if (is_syn)
                 {
-                    std::scoped_lock lock(udp_mapper_lock_);
-                    udp_mapper_.insert(ntohs(udp_header->th_sport));
+                    per_family<T>(tcp_mapper_v4_, tcp_mapper_v6_).insert(ntohs(tcp_header->th_sport),
+                        net::ip_endpoint<T>(packet.destination, ntohs(tcp_header->th_dport)));
 
-                    NETLIB_LOG(log_level::info,
-                        "Redirecting UDP {} : {} -> {} : {}",
-                        net::ip_address_v4(ip_header->ip_src), ntohs(udp_header->th_sport),
-                        net::ip_address_v4(ip_header->ip_dst), ntohs(udp_header->th_dport));
+                    count_redirected_flow(process, true);
+
+                    NETLIB_LOG_THROTTLED(log_level::info, flow_log_rate_, flow_log_burst_,
+                        "Redirecting TCP: {} : {} -> {} : {}",
+                        packet.source, ntohs(tcp_header->th_sport),
+                        packet.destination, ntohs(tcp_header->th_dport));
                 }
 
-                if (udp_redirect_->process_client_to_server_packet(buffer, htons(port.value())))
+                // Attempt to process the packet for client-to-server redirection
+                if (tcp_redirect.process_client_to_server_packet(buffer, htons(port.value())))
                 {
+                    if (cacheable)
+                        cache.insert(flow_key, generation, flow_verdict::redirect, port.value());
                     log_packet_to_pcap(buffer);
                     return packet_filter::packet_action{ packet_filter::packet_action::action_type::revert };
                 }
-
             }
             else
             {
-                process->bypass_udp = true;
+                if (cacheable)
+                    cache.insert(flow_key, generation, flow_verdict::pass);
             }
 
+            // Otherwise, pass the packet through
             return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
         }
 
         /**
-         * @brief Processes a TCP packet for possible redirection through a proxy.
+         * @brief Counts a packet passed from a cached verdict towards bypassing its flow in the driver.
          *
-         * This function inspects the provided intermediate_buffer, attempts to resolve the associated process,
-         * and determines if the UDP packet should be redirected to a proxy port, passed through, or reverted.
-         * If the process cannot be resolved and @p postponed is false, the function returns std::nullopt,
-         * indicating that the packet should be queued for later processing. If @p postponed is true, a
-         * second attempt is made to resolve the process using an updated process table.
+         * @param buffer The packet.
+         * @param key Flow of the packet as seen in the packet.
+         */
+        template <net::ip_address T>
+        void count_kernel_bypass_candidate(const ndisapi::intermediate_buffer& buffer,
+                                           const typename flow_verdict_cache<T>::flow_key& key) noexcept
+        {
+            auto& kernel_bypass = per_family<T>(kernel_bypass_v4_, kernel_bypass_v6_);
+            using flow = typename kernel_bypass_table<T>::flow;
+
+            if (!kernel_bypass)
+                return;
+
+            // The table orients flows from the local host
+            kernel_bypass->count_passed_packet(buffer.m_dwDeviceFlags == PACKET_FLAG_ON_SEND
+                ? flow{ key.source, key.destination, key.source_port, key.destination_port, key.protocol }
+                : flow{ key.destination, key.source, key.destination_port, key.source_port, key.protocol });
+        }
+
+        /**
+         * @brief Applies a cached verdict to a TCP packet.
          *
-         * If the process is associated with a UDP proxy, and the packet is from a new endpoint, the source
-         * port is recorded and a redirection is logged. The function then attempts to process the packet for
-         * client-to-server redirection. If the packet is from a known proxy port, it attempts to process it
-         * for server-to-client redirection.
+         * @param buffer Packet to process.
+         * @param cached Verdict found in the flow cache of the packet's family.
+         * @return The packet action, or std::nullopt if the redirect state backing the verdict is
+         *         gone and the packet has to take the slow path.
+         */
+        template <net::ip_address T>
+        std::optional<packet_filter::packet_action> apply_cached_tcp_verdict(ndisapi::intermediate_buffer& buffer,
+            const typename flow_verdict_cache<T>::cached_verdict& cached)
+        {
+            auto& tcp_redirect = *per_family<T>(tcp_redirect_v4_, tcp_redirect_v6_);
+
+            switch (cached.verdict)
+            {
+            case flow_verdict::pass:
+                return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
+            case flow_verdict::redirect:
+                if (!tcp_redirect.process_client_to_server_packet(buffer, htons(cached.port)))
+                    return std::nullopt;
+                break;
+            case flow_verdict::revert:
+                if (!tcp_redirect.process_server_to_client_packet(buffer))
+                    return std::nullopt;
+                break;
+            case flow_verdict::none:
+                return std::nullopt;
+            }
+
+            log_packet_to_pcap(buffer);
+            return packet_filter::packet_action{ packet_filter::packet_action::action_type::revert };
+        }
+
+        /**
+         * @brief Applies a cached verdict to a UDP packet.
          *
-         * @param buffer Reference to the intermediate_buffer containing the packet data.
-         * @param postponed If false, only the current process table is used for lookup. If true, the process
-         *        table is refreshed and a second lookup is attempted.
-         * @return std::optional<packet_filter::packet_action> indicating the action to take:
-         *         - std::nullopt: process could not be resolved (should be queued for later)
-         *         - packet_action::revert: packet should be reverted (redirected)
-         *         - packet_action::pass: packet should be passed through
-         * (unchanged comment)
+         * @param buffer Packet to process.
+         * @param cached Verdict found in the flow cache of the packet's family.
+         * @return The packet action, or std::nullopt if the redirect state backing the verdict is
+         *         gone and the packet has to take the slow path.
+         */
+        template <net::ip_address T>
+        std::optional<packet_filter::packet_action> apply_cached_udp_verdict(ndisapi::intermediate_buffer& buffer,
+            const typename flow_verdict_cache<T>::cached_verdict& cached)
+        {
+            auto& udp_redirect = *per_family<T>(udp_redirect_v4_, udp_redirect_v6_);
+
+            switch (cached.verdict)
+            {
+            case flow_verdict::pass:
+                return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
+            case flow_verdict::redirect:
+                if (!udp_redirect.process_client_to_server_packet(buffer, htons(cached.port)))
+                    return std::nullopt;
+                break;
+            case flow_verdict::revert:
+                if (!udp_redirect.process_server_to_client_packet(buffer))
+                    return std::nullopt;
+                break;
+            case flow_verdict::none:
+                return std::nullopt;
+            }
+
+            log_packet_to_pcap(buffer);
+            return packet_filter::packet_action{ packet_filter::packet_action::action_type::revert };
+        }
+
+        /**
+         * @brief Counts a redirected flow in the next flow summary.
+         *
+         * Costs an atomic increment on the process entry; only the first flow of a process
+         * since the previous summary takes flow_summary_lock_ to queue the process.
+         *
+         * @param process The process owning the flow.
+         * @param tcp true for a TCP connection, false for a UDP endpoint.
+         */
+        void count_redirected_flow(const std::shared_ptr<iphelper::network_process>& process, const bool tcp)
+        {
+            if (get_log_level() < log_level::info)
+                return;
+
+            if (process->redirected_flows.fetch_add(tcp ? 1 : 1ULL << 32, std::memory_order_relaxed) != 0)
+                return;
+
+            try
+            {
+                std::scoped_lock lock(flow_summary_lock_);
+                flow_summary_processes_.push_back(process);
+            }
+            catch (const std::bad_alloc&)
+            {
+                // Not queued: let the next flow of the process try again
+                process->redirected_flows.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * @brief Logs the flows redirected since the previous summary, per process and per proxy.
+         *
+         * Called by the resolver thread every flow_summary_interval_ and once more when it exits.
+         *
+         * @param elapsed Time since the previous summary.
+         */
+        void log_flow_summary(const std::chrono::steady_clock::duration elapsed)
+        {
+            std::vector<std::shared_ptr<iphelper::network_process>> processes;
+
+            {
+                std::scoped_lock lock(flow_summary_lock_);
+                processes.swap(flow_summary_processes_);
+            }
+
+            if (processes.empty())
+                return;
+
+            struct process_flows
+            {
+                const iphelper::network_process* process;
+                std::uint32_t tcp;
+                std::uint32_t udp;
+            };
+
+            struct proxy_flows
+            {
+                std::uint64_t tcp{ 0 };
+                std::uint64_t udp{ 0 };
+                std::size_t processes{ 0 };
+            };
+
+            const auto& routing = current_routing();
+            std::vector<process_flows> flows;
+            std::vector<proxy_flows> proxies(routing.tcp_ports.size());
+
+            flows.reserve(processes.size());
+
+            for (const auto& process : processes)
+            {
+                // Flows counted after the exchange re-queue the process for the next summary
+                const auto counts = process->redirected_flows.exchange(0, std::memory_order_relaxed);
+                const auto tcp = static_cast<std::uint32_t>(counts);
+                const auto udp = static_cast<std::uint32_t>(counts >> 32);
+
+                flows.push_back({ process.get(), tcp, udp });
+
+                if (const auto proxy_id = match_process(routing, process).proxy_id;
+                    proxy_id && proxy_id.value() < proxies.size())
+                {
+                    auto& proxy = proxies[proxy_id.value()];
+                    proxy.tcp += tcp;
+                    proxy.udp += udp;
+                    ++proxy.processes;
+                }
+            }
+
+            std::ranges::sort(flows, std::ranges::greater{},
+                              [](const process_flows& f) { return std::uint64_t{ f.tcp } + f.udp; });
+
+            const auto seconds = std::max<std::int64_t>(
+                std::chrono::duration_cast<std::chrono::seconds>(elapsed).count(), 1);
+
+            for (std::size_t i = 0; i < std::min(flows.size(), flow_summary_max_processes_); ++i)
+            {
+                NETLIB_LOG(log_level::info, "Redirected {} TCP connection(s) and {} UDP endpoint(s) of {} (PID {}) in the last {}s",
+                           flows[i].tcp, flows[i].udp, tools::strings::to_string(flows[i].process->name),
+                           flows[i].process->id, seconds);
+            }
+
+            if (flows.size() > flow_summary_max_processes_)
+            {
+                std::uint64_t tcp = 0, udp = 0;
+
+                for (std::size_t i = flow_summary_max_processes_; i < flows.size(); ++i)
+                {
+                    tcp += flows[i].tcp;
+                    udp += flows[i].udp;
+                }
+
+                NETLIB_LOG(log_level::info, "Redirected {} TCP connection(s) and {} UDP endpoint(s) of {} more process(es) in the last {}s",
+                           tcp, udp, flows.size() - flow_summary_max_processes_, seconds);
+            }
+
+            for (std::size_t i = 0; i < proxies.size(); ++i)
+            {
+                if (proxies[i].processes == 0)
+                    continue;
+
+                NETLIB_LOG(log_level::info, "SOCKS5 proxy #{} received {} TCP connection(s) and {} UDP endpoint(s) from {} process(es) in the last {}s",
+                           i, proxies[i].tcp, proxies[i].udp, proxies[i].processes, seconds);
+            }
+        }
+
+        /**
+         * @brief Logs a single packet to the pcap logger.
+         *
+         * This function logs a single packet to the pcap logger if it is available.
+         *
+         * @param packet The packet to be logged.
+         */
+        void log_packet_to_pcap(const INTERMEDIATE_BUFFER& packet) {
+            if (!pcap_logger_) {
+                return;
+            }
+
+            // A packet rewritten by filter_packet() follows the capture decision taken on it as
+            // received, so the sampling and the per-flow quotas count every packet once
+            if (auto& context = pcap_context(); context.active) {
+                if (!context.pending) {
+                    return;
+                }
+
+                // In an annotated capture the packet is logged after it has been rewritten:
+                // end_pcap_packet() records it again along with the original
+                if (pcap_annotate_) {
+                    context.rewritten = true;
+                }
+                else {
+                    pcap_logger_.value() << packet;
+                }
+
+                return;
+            }
+
+            if (pcap_filter_ && !pcap_filter_->should_capture(packet)) {
+                return;
+            }
+
+            if (!pcap_annotate_) {
+                pcap_logger_.value() << packet;
+                return;
+            }
+
+            const auto annotation = make_pcap_annotation(pcap_context(), pcap::packet_annotation::packet_action::revert, true);
+            pcap_logger_->capture(packet, &annotation);
+        }
+
+        /**
+         * @brief Returns the annotated capture state of the calling thread.
          */
-        std::optional<packet_filter::packet_action> process_tcp_packet(ndisapi::intermediate_buffer& buffer, const bool postponed)
+        static pcap_packet_context& pcap_context() noexcept
         {
-            auto* const ethernet_header = reinterpret_cast<ether_header_ptr>(buffer.m_IBuffer);
-            auto* const ip_header = reinterpret_cast<iphdr_ptr>(ethernet_header + 1);
-            const auto* const tcp_header = reinterpret_cast<tcphdr_ptr>(reinterpret_cast<PUCHAR>(
-                ip_header) +
-                sizeof(DWORD) * ip_header->ip_hl);
+            thread_local pcap_packet_context context;
+            return context;
+        }
 
-            // If the packet is from a known proxy port, process for server-to-client redirection
-            if (is_tcp_proxy_port(ntohs(tcp_header->th_sport)))
-            {
-                if (tcp_redirect_->process_server_to_client_packet(buffer))
-                {
-                    log_packet_to_pcap(buffer);
-                    return packet_filter::packet_action{ packet_filter::packet_action::action_type::revert };
-                }
-            }
+        /**
+         * @brief Starts recording a packet in an annotated capture.
+         *
+         * Copies the packet as received, it is written by end_pcap_packet() together with the
+         * owner and the action decided on in between.
+         *
+         * @param packet The packet about to be decided on.
+         */
+        void begin_pcap_packet(const INTERMEDIATE_BUFFER& packet) const noexcept
+        {
+            auto& context = pcap_context();
 
-            auto process = process_lookup_v4_.
-                lookup_process_for_tcp<false>(net::ip_session<net::ip_address_v4>{
-                ip_header->ip_src, ip_header->ip_dst, ntohs(tcp_header->th_sport),
-                    ntohs(tcp_header->th_dport)
-            });
+            context.active = true;
+            context.pending = false;
+            context.rewritten = false;
+            context.deferred = false;
+            context.process.reset();
+            context.proxy_id.reset();
 
-            if (!process)
+            if (pcap_filter_ && !pcap_filter_->should_capture(packet))
+                return;
+
+            if (!context.staged)
             {
-                if (postponed)
-                {
-                    process = process_lookup_v4_.
-                        lookup_process_for_tcp<true>(net::ip_session<net::ip_address_v4>{
-                        ip_header->ip_src, ip_header->ip_dst, ntohs(tcp_header->th_sport),
-                            ntohs(tcp_header->th_dport)
-                    });
-                }
-                else
-                {
-                    return std::nullopt;
-                }
+                context.staged.reset(new(std::nothrow) INTERMEDIATE_BUFFER);
+
+                // Out of memory: the packet is not recorded
+                if (!context.staged)
+                    return;
             }
 
-            if (process->excluded || process->bypass_tcp)
-                return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
+            std::memcpy(context.staged.get(), &packet,
+                        offsetof(INTERMEDIATE_BUFFER, m_IBuffer) + std::min<std::size_t>(packet.m_Length, MAX_ETHER_FRAME));
+            context.pending = true;
+        }
+
+        /**
+         * @brief Writes the packet started with begin_pcap_packet() with its annotation.
+         *
+         * @param packet The packet, as rewritten if the router did; not accessed unless it was
+         *        rewritten (a deferred packet may already belong to the resolver thread).
+         * @param action The action decided on, std::nullopt to discard the packet.
+         */
+        void end_pcap_packet(const INTERMEDIATE_BUFFER& packet,
+                             const std::optional<packet_filter::packet_action::action_type> action)
+        {
+            auto& context = pcap_context();
+            context.active = false;
 
-            // -------- NEW: consult optional redirect decider (per-process CIDR include) --------
-			// Consult optional per-process destination include policy
-			if (redirect_decider_)
-			{
-			    sockaddr_in dst{};
-			    dst.sin_family = AF_INET;
-			    dst.sin_addr   = ip_header->ip_dst;      // <-- assign in_addr directly (fixes C2440)
-			    dst.sin_port   = tcp_header->th_dport;   // already in network byte order
+            if (!action)
+                return;
 
-			    if (!redirect_decider_(process->name, reinterpret_cast<sockaddr*>(&dst), sizeof(dst)))
-			    {
-			        // Do NOT redirect this destination for this process
-			        return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
-			    }
-			}
+            using packet_action = pcap::packet_annotation::packet_action;
+            using action_type = packet_filter::packet_action::action_type;
 
-            // ------------------------------------------------------------------------------------
+            const auto decided = *action == action_type::pass ? packet_action::pass
+                : *action == action_type::revert ? packet_action::revert
+                : context.deferred ? packet_action::deferred : packet_action::drop;
 
-            if (const auto port = process->tcp_proxy_port ? process->tcp_proxy_port : get_proxy_port_tcp(process); port.has_value())
+            if (context.pending)
             {
-                // If this is a SYN packet (connection initiation), map the source port to the destination endpoint
-                if ((tcp_header->th_flags & (TH_SYN | TH_ACK)) == TH_SYN)
-                {
-                    std::scoped_lock lock(tcp_mapper_lock_);
-                    tcp_mapper_[ntohs(tcp_header->th_sport)] =
-                        tcp_mapper_entry{
-                            net::ip_endpoint(net::ip_address_v4(ip_header->ip_dst),
-                                ntohs(tcp_header->th_dport)),
-                            std::chrono::steady_clock::now()
-                        };
-
-                    NETLIB_LOG(log_level::info,
-                        "Redirecting TCP: {} : {} -> {} : {}",
-                        net::ip_address_v4(ip_header->ip_src), ntohs(tcp_header->th_sport),
-                        net::ip_address_v4(ip_header->ip_dst), ntohs(tcp_header->th_dport));
-                }
+                const auto annotation = make_pcap_annotation(context, decided, false);
+                pcap_logger_->capture(*context.staged, &annotation);
+            }
 
-                // Attempt to process the packet for client-to-server redirection
-                if (tcp_redirect_->process_client_to_server_packet(buffer, htons(port.value())))
-                {
-                    log_packet_to_pcap(buffer);
-                    return packet_filter::packet_action{ packet_filter::packet_action::action_type::revert };
-                }
+            if (context.rewritten)
+            {
+                const auto annotation = make_pcap_annotation(context, decided, true);
+                pcap_logger_->capture(packet, &annotation);
             }
-            else
+
+            // Do not keep the owner alive until the thread's next packet
+            context.process.reset();
+        }
+
+        /**
+         * @brief Builds the annotation of a packet from the capture state of its thread.
+         */
+        static pcap::packet_annotation make_pcap_annotation(const pcap_packet_context& context,
+                                                            const pcap::packet_annotation::packet_action action,
+                                                            const bool rewritten) noexcept
+        {
+            pcap::packet_annotation annotation{ {}, 0, context.proxy_id, action, rewritten };
+
+            if (context.process)
             {
-                process->bypass_tcp = true;
+                annotation.process_name = context.process->name;
+                annotation.process_id = static_cast<uint32_t>(context.process->id);
             }
 
-            // Otherwise, pass the packet through
-            return packet_filter::packet_action{ packet_filter::packet_action::action_type::pass };
+            return annotation;
         }
 
         /**
-         * @brief Logs a single packet to the pcap logger.
+         * @brief Reports the owner of a flow to the packet capture.
          *
-         * This function logs a single packet to the pcap logger if it is available.
+         * Called wherever the packet path resolves the owner of a TCP/UDP flow. The capture filter
+         * records its owner verdict, so packets of the flow on paths that do not know the owner are
+         * still selected by their local port, and an annotated capture attributes the packet.
          *
-         * @param packet The packet to be logged.
+         * @param routing The routing snapshot of the current packet.
+         * @param process The flow owner.
+         * @param protocol IPPROTO_TCP or IPPROTO_UDP.
+         * @param local_port Source port of the outbound packet (host byte order).
          */
-        void log_packet_to_pcap(const INTERMEDIATE_BUFFER& packet) {
-            if (pcap_logger_) {
-                pcap_logger_.value() << packet;
+        void note_pcap_flow_owner(const routing_snapshot& routing, const std::shared_ptr<iphelper::network_process>& process,
+                                  const uint8_t protocol, const uint16_t local_port) const
+        {
+            if (!pcap_logger_)
+                return;
+
+            const auto owner_criteria = pcap_filter_ && pcap_filter_->has_owner_criteria();
+
+            if (!owner_criteria && !pcap_annotate_)
+                return;
+
+            const auto proxy_id = match_process(routing, process).proxy_id;
+
+            if (owner_criteria)
+                pcap_filter_->note_flow_owner(protocol, local_port, pcap_filter_->matches_owner(*process, proxy_id));
+
+            if (pcap_annotate_)
+            {
+                auto& context = pcap_context();
+                context.process = process;
+                context.proxy_id = proxy_id;
             }
         }
 
@@ -1579,24 +4682,112 @@ namespace proxy
             );
         }
 
+        /**
+         * @brief Sends a single packet to the Microsoft TCP/IP stack (MSTCP).
+         *
+         * @param packet The packet to send.
+         * @return true if the packet was successfully sent to MSTCP, false otherwise.
+         */
+        bool send_packet_to_mstcp(ndisapi::intermediate_buffer& packet) const
+        {
+            PINTERMEDIATE_BUFFER packets[] = { &packet };
+            DWORD packets_success = 0;
+            return packet_filter_->SendPacketsToMstcpUnsorted(packets, 1, &packets_success);
+        }
+
+        /**
+         * @brief Runs a deferred packet through the TCP/UDP processing path and moves its buffer
+         *        into the matching re-injection batch.
+         *
+         * @param packet Deferred packet; its buffer is moved out unless the owner is still unknown.
+         * @param postponed Passed to process_tcp_packet/process_udp_packet. If false, only the
+         *                  current process tables are consulted.
+         * @param to_adapters Batch of packets to send to the network adapters.
+         * @param to_mstcp Batch of packets to send to the Microsoft TCP/IP stack.
+         * @return false if the owner could not be resolved from the current tables (only possible
+         *         when @p postponed is false), true once the packet has been handled.
+         */
+        bool route_deferred_packet(deferred_packet& packet, const bool postponed,
+                                   std::vector<ndisapi::intermediate_buffer_pool::intermediate_buffer_ptr>& to_adapters,
+                                   std::vector<ndisapi::intermediate_buffer_pool::intermediate_buffer_ptr>& to_mstcp)
+        {
+            std::optional<packet_filter::packet_action> result;
+
+            if (packet.protocol != IPPROTO_UDP && packet.protocol != IPPROTO_TCP)
+            {
+                // Only TCP/UDP packets should be queued for deferred processing
+                assert(false && "Only TCP/UDP packets should be queued for deferred processing");
+                packet.buffer.reset();
+                return true;
+            }
+
+            if (pcap_annotate_)
+                begin_pcap_packet(*packet.buffer);
+
+            const auto process_packet = [this, &packet, postponed](const auto& parsed)
+            {
+                return packet.protocol == IPPROTO_UDP
+                           ? process_udp_packet(*packet.buffer, parsed, postponed)
+                           : process_tcp_packet(*packet.buffer, parsed, postponed);
+            };
+
+            result = packet.ipv6
+                         ? process_packet(parse_transport_packet<net::ip_address_v6>(*packet.buffer))
+                         : process_packet(parse_transport_packet<net::ip_address_v4>(*packet.buffer));
+
+            // Recorded a second time, now with the owner resolved; discarded if still unknown
+            if (pcap_annotate_)
+                end_pcap_packet(*packet.buffer, result ? std::optional(result->action) : std::nullopt);
+
+            if (!result)
+            {
+                // Should always have a result for postponed packets
+                assert(!postponed && "process_tcp_packet/process_udp_packet should always return a result for postponed packets");
+                if (!postponed)
+                    return false;
+
+                packet.buffer.reset();
+                return true;
+            }
+
+            if (result->action == packet_filter::packet_action::action_type::pass)
+            {
+                to_adapters.push_back(std::move(packet.buffer));
+            }
+            else if (result->action == packet_filter::packet_action::action_type::revert)
+            {
+                to_mstcp.push_back(std::move(packet.buffer));
+            }
+            else
+            {
+                packet.buffer.reset();
+            }
+
+            return true;
+        }
+
         /**
         * @brief Thread procedure for deferred process resolution and packet forwarding.
         *
         * This method runs in a dedicated thread and is responsible for processing packets
         * that could not be immediately associated with a process. It waits for packets to
-        * appear in the process_resolve_buffer_queue_, then attempts to resolve the process
-        * information using an updated process table. Based on the result of the resolution
-        * and packet inspection, packets are either sent to network adapters, sent to the
-        * Microsoft TCP/IP stack, or dropped. The method ensures thread safety and efficient
-        * processing by using local queues and minimizing lock contention.
+        * appear in the process_resolve_buffer_queue_ and processes them in batches, so a
+        * burst of new connections costs one process table refresh rather than one per packet.
+        * Based on the result of the resolution and packet inspection, packets are either
+        * sent to network adapters, sent to the Microsoft TCP/IP stack, or dropped.
         *
         * The main steps are:
         * 1. Wait for packets to be queued or for resolver_should_exit_ to be set.
-        * 2. Swap the shared queue with a local queue for processing.
-        * 3. Refresh the process lookup table.
-        * 4. For each packet, attempt to resolve the process and determine the appropriate
-        *    action (pass to adapter, revert to MSTCP, or assert on unexpected cases).
-        * 5. Send processed packets to their respective destinations and clear local queues.
+        * 2. Drain the queue into a local batch.
+        * 3. Retry every packet against the current process tables: owners of packets
+        *    deferred while an earlier batch was being processed are usually known by now.
+        * 4. Refresh the process tables once (only the families and protocols still unresolved) and
+        *    resolve the remaining packets, falling back to the default process.
+        * 5. Re-inject each batch with a single send per destination and update the
+        *    deferred-resolve counters.
+        *
+        * All packets of a flow resolve to the same owner at each stage, so the per-flow order
+        * of the re-injected packets is preserved.
         *
         * The thread exits only after resolver_should_exit_ has been set (which stop()
         * does after packet_filter_->stop_filter() returns) and the shared queue has
@@ -1606,25 +4797,37 @@ namespace proxy
         void process_resolve_thread_proc()
         {
             // Use local (non-static) containers to avoid static initialization order issues and data races
-            std::queue<ndisapi::intermediate_buffer_pool::intermediate_buffer_ptr> local_queue;
+            std::vector<deferred_packet> batch;
+            std::vector<deferred_packet*> unresolved;
             std::vector<ndisapi::intermediate_buffer_pool::intermediate_buffer_ptr> to_adapters;
             std::vector<ndisapi::intermediate_buffer_pool::intermediate_buffer_ptr> to_mstcp;
 
-            // Run the tcp_mapper_ sweep at most once per maintenance interval, even
-            // under heavy resolver activity. The interval is half the TTL so an
-            // entry is evicted within at most 1.5 * TTL of becoming stale, and the
-            // condition variable below uses the same period as its wait timeout so
-            // the sweep still runs when the deferred-resolve queue stays empty.
-            constexpr auto maintenance_interval = tcp_mapper_entry_ttl_ / 2;
-            auto last_sweep = std::chrono::steady_clock::now();
-            auto last_drop_log = last_sweep;
+            batch.reserve(max_resolve_queue_depth_);
+            unresolved.reserve(max_resolve_queue_depth_);
+
+            // The condition variable below uses the maintenance interval as its wait
+            // timeout so throttled drop diagnostics are still surfaced when the
+            // deferred-resolve queue stays empty. It is capped at the flow summary
+            // interval so the summaries are not delayed on an idle queue either.
+            const auto maintenance_interval = std::min<std::chrono::seconds>(
+                { tcp_mapper_entry_ttl_ / 2, flow_summary_interval_,
+                  kernel_bypass_v4_ ? kernel_bypass_sync_interval_ : flow_summary_interval_ });
+            auto last_drop_log = std::chrono::steady_clock::now();
+            auto last_flow_summary = last_drop_log;
+            auto last_kernel_bypass_sync = last_drop_log;
 
             while (true)
             {
                 {
                     std::unique_lock lock(process_resolve_buffer_mutex_);
-                    // Timed wait so we still run periodic maintenance (tcp_mapper_
-                    // TTL eviction) when no packets are being deferred. Also wake
+
+                    // Publish the parked flag before the predicate inspects the queue,
+                    // see wake_resolver() for the producer side of the handshake.
+                    resolver_parked_.store(true, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                    // Timed wait so we still run periodic maintenance (drop
+                    // diagnostics) when no packets are being deferred. Also wake
                     // early for maintenance-only notifications so throttled
                     // alloc-failure/drop diagnostics are not delayed until the next
                     // timeout when no packet was actually queued, but only once
@@ -1647,35 +4850,37 @@ namespace proxy
                         return std::chrono::steady_clock::now() - last_drop_log >= drop_log_throttle_interval_;
                         });
 
+                    resolver_parked_.store(false, std::memory_order_relaxed);
+
                     if (resolver_should_exit_.load() && process_resolve_buffer_queue_.empty())
                         break;
+                }
 
-                    // Swap the contents of the shared queue with the local queue
-                    std::swap(process_resolve_buffer_queue_, local_queue);
+                // Periodic summary of the redirected flows, see count_redirected_flow()
+                if (const auto now = std::chrono::steady_clock::now(); now - last_flow_summary >= flow_summary_interval_)
+                {
+                    log_flow_summary(now - last_flow_summary);
+                    last_flow_summary = now;
                 }
 
-                // Evict stale tcp_mapper_ entries whose SYN was redirected but never
-                // produced a local proxy connection (e.g. peer RST, timeout, app gave
-                // up). Without this sweep such entries would leak indefinitely since
-                // the only other removal site is the SOCKS5 negotiate callback. The
-                // sweep is rate-limited to maintenance_interval to bound CPU cost
-                // when the resolver loop runs frequently under sustained load.
+                // Install newly promoted bypass flows, remove expired and invalidated ones
                 if (const auto now = std::chrono::steady_clock::now();
-                    now - last_sweep >= maintenance_interval)
+                    kernel_bypass_v4_ && now - last_kernel_bypass_sync >= kernel_bypass_sync_interval_)
                 {
-                    last_sweep = now;
-                    std::scoped_lock lock(tcp_mapper_lock_);
-                    for (auto it = tcp_mapper_.begin(); it != tcp_mapper_.end();)
-                    {
-                        if (now - it->second.created_at > tcp_mapper_entry_ttl_)
-                        {
-                            it = tcp_mapper_.erase(it);
-                        }
-                        else
-                        {
-                            ++it;
-                        }
-                    }
+                    std::scoped_lock filters_lock(static_filters_lock_);
+                    kernel_bypass_v4_->synchronize(*static_filters_);
+                    kernel_bypass_v6_->synchronize(*static_filters_);
+                    last_kernel_bypass_sync = now;
+                }
+
+                // Drain at most one queue's worth of packets so a sustained stream of
+                // deferred packets cannot starve the maintenance work below
+                for (std::size_t i = 0; i < max_resolve_queue_depth_; ++i)
+                {
+                    auto packet = process_resolve_buffer_queue_.try_pop();
+                    if (!packet)
+                        break;
+                    batch.push_back(std::move(packet.value()));
                 }
 
                 // Periodically surface the counts of packets dropped due to a
@@ -1685,7 +4890,7 @@ namespace proxy
                 // most once per drop_log_throttle_interval_ — between
                 // emissions the cumulative counts keep accumulating in the
                 // atomic counters, so no drops are lost; only the log rate is
-                // bounded. Performed before the local_queue.empty() early-
+                // bounded. Performed before the batch.empty() early-
                 // continue so the signal is still surfaced when the queue
                 // stays empty (e.g. resolver succeeds inline but allocations
                 // are failing). Relaxed ordering is sufficient because the
@@ -1712,6 +4917,7 @@ namespace proxy
                                     resolve_queue_dropped_packets_.exchange(0, std::memory_order_relaxed);
                                 dropped != 0)
                             {
+                                resolve_queue_dropped_logged_.fetch_add(dropped, std::memory_order_relaxed);
                                 NETLIB_LOG(log_level::warning,
                                     "Dropped {} packet(s) because process_resolve_buffer_queue_ reached capacity at {} entries.",
                                     dropped, max_resolve_queue_depth_);
@@ -1724,6 +4930,7 @@ namespace proxy
                                     resolve_queue_alloc_failures_.exchange(0, std::memory_order_relaxed);
                                 alloc_failures != 0)
                             {
+                                resolve_queue_alloc_failures_logged_.fetch_add(alloc_failures, std::memory_order_relaxed);
                                 NETLIB_LOG(log_level::error,
                                     "Dropped {} packet(s) because the intermediate buffer pool failed to allocate.",
                                     alloc_failures);
@@ -1755,91 +4962,108 @@ namespace proxy
                 // Nothing else to do on a maintenance-only wakeup (timer fired with
                 // an empty queue) — skip process-lookup refresh until there is
                 // real packet work.
-                if (local_queue.empty())
+                if (batch.empty())
                 {
                     continue;
                 }
 
-                // Actualize process lookup before processing
-                process_lookup_v4_.actualize(true, true);
+                if (batch.size() > resolve_queue_peak_depth_.load(std::memory_order_relaxed))
+                    resolve_queue_peak_depth_.store(batch.size(), std::memory_order_relaxed);
 
-                while (!local_queue.empty())
-                {
-                    auto buffer_ptr = std::move(local_queue.front());
-                    local_queue.pop();
+                // Stage 1: packets whose owner appeared with an earlier refresh need no new one
+                auto refresh_tcp_v4 = false, refresh_udp_v4 = false, refresh_tcp_v6 = false, refresh_udp_v6 = false;
 
-                    auto* const ethernet_header = reinterpret_cast<ether_header_ptr>(buffer_ptr->m_IBuffer);
+                for (auto& packet : batch)
+                {
+                    if (route_deferred_packet(packet, false, to_adapters, to_mstcp))
+                        continue;
 
-                    if (const auto* const ip_header = reinterpret_cast<iphdr_ptr>(ethernet_header + 1);
-                        ip_header->ip_p == IPPROTO_UDP)
-                    {
-                        if (const auto result = process_udp_packet(*buffer_ptr, true);
-                            result && result->action == packet_filter::packet_action::action_type::pass)
-                        {
-                            to_adapters.push_back(std::move(buffer_ptr));
-                        }
-                        else if (result && result->action == packet_filter::packet_action::action_type::revert)
-                        {
-                            to_mstcp.push_back(std::move(buffer_ptr));
-                        }
-                        else
-                        {
-                            // Should always have a result for postponed packets
-                            assert(false && "process_udp_packet should always return a result for postponed packets");
-                        }
-                    }
-                    else if (ip_header->ip_p == IPPROTO_TCP)
-                    {
-                        if (const auto result = process_tcp_packet(*buffer_ptr, true);
-                            result && result->action == packet_filter::packet_action::action_type::pass)
-                        {
-                            to_adapters.push_back(std::move(buffer_ptr));
-                        }
-                        else if (result && result->action == packet_filter::packet_action::action_type::revert)
-                        {
-                            to_mstcp.push_back(std::move(buffer_ptr));
-                        }
-                        else
-                        {
-                            // Should always have a result for postponed packets
-                            assert(false && "process_tcp_packet should always return a result for postponed packets");
-                        }
-                    }
+                    if (packet.ipv6)
+                        (packet.protocol == IPPROTO_TCP ? refresh_tcp_v6 : refresh_udp_v6) = true;
                     else
-                    {
-                        // Only TCP/UDP packets should be queued for deferred processing
-                        assert(false && "Only TCP/UDP packets should be queued for deferred processing");
-                    }
+                        (packet.protocol == IPPROTO_TCP ? refresh_tcp_v4 : refresh_udp_v4) = true;
+
+                    unresolved.push_back(&packet);
+                }
+
+                // Stage 2: a single refresh of the tables still missing owners resolves the rest of the batch
+                if (!unresolved.empty())
+                {
+                    if (refresh_tcp_v4 || refresh_udp_v4)
+                        process_lookup_v4_.actualize(refresh_tcp_v4, refresh_udp_v4);
+
+                    if (refresh_tcp_v6 || refresh_udp_v6)
+                        process_lookup_v6_.actualize(refresh_tcp_v6, refresh_udp_v6);
+
+                    deferred_table_refreshes_.fetch_add(1, std::memory_order_relaxed);
+
+                    for (auto* packet : unresolved)
+                        route_deferred_packet(*packet, true, to_adapters, to_mstcp);
+
+                    unresolved.clear();
                 }
 
+                // Stage 3: one re-injection call per destination for the whole batch
                 if (!to_adapters.empty())
                 {
                     send_packets_to_adapters(to_adapters);
+                    ndisapi::intermediate_buffer_pool::instance().free(to_adapters);
                     to_adapters.clear();
                 }
 
                 if (!to_mstcp.empty())
                 {
                     send_packets_to_mstcp(to_mstcp);
+                    ndisapi::intermediate_buffer_pool::instance().free(to_mstcp);
                     to_mstcp.clear();
                 }
+
+                const auto sent_at = std::chrono::steady_clock::now();
+                std::uint64_t latency_total = 0, latency_max = 0;
+
+                for (const auto& packet : batch)
+                {
+                    const auto latency = static_cast<std::uint64_t>(
+                        std::chrono::duration_cast<std::chrono::microseconds>(sent_at - packet.enqueued_at).count());
+                    latency_total += latency;
+                    latency_max = std::max(latency_max, latency);
+                }
+
+                // The batch is on the wire: later packets of its flows may take the fast path again
+                for (const auto& packet : batch)
+                {
+                    if (packet.ipv6)
+                        flow_holds_v6_.release(packet.hold_slot);
+                    else
+                        flow_holds_v4_.release(packet.hold_slot);
+                }
+
+                deferred_packets_.fetch_add(batch.size(), std::memory_order_relaxed);
+                deferred_latency_total_us_.fetch_add(latency_total, std::memory_order_relaxed);
+                if (latency_max > deferred_latency_max_us_.load(std::memory_order_relaxed))
+                    deferred_latency_max_us_.store(latency_max, std::memory_order_relaxed);
+
+                batch.clear();
             }
+
+            // Flows counted since the last periodic summary
+            log_flow_summary(std::chrono::steady_clock::now() - last_flow_summary);
         }
 
         /**
          * @brief Callback function that is called when the IP interface changes.
          *
          * This function is triggered by changes in the network configuration and
-         * updates the network configuration accordingly.
+         * queues the changed interface; bursts of notifications are applied at once
+         * by update_network_configuration on the interface_changes_ worker.
          *
          * @param row Pointer to the MIB_IPINTERFACE_ROW structure that contains
          *            information about the IP interface that changed.
          * @param notification_type The type of notification that triggered the callback.
          */
-        void ip_interface_changed_callback([[maybe_unused]] PMIB_IPINTERFACE_ROW row, [[maybe_unused]] MIB_NOTIFICATION_TYPE notification_type)
+        void ip_interface_changed_callback(PMIB_IPINTERFACE_ROW row, const MIB_NOTIFICATION_TYPE notification_type)
         {
-            NETLIB_LOG(log_level::debug, "Network configuration has changed.");
-            update_network_configuration();
+            interface_changes_.post(notification_type == MibInitialNotification ? nullptr : row);
         }
 
         /**
@@ -1850,7 +5074,16 @@ namespace proxy
          */
         void update_network_configuration()
         {
-            const auto ndis_adapters = packet_filter_->get_interface_list();
+            std::scoped_lock config_lock(network_config_lock_);
+
+            auto ndis_adapters = packet_filter_->get_interface_list();
+
+            interface_adapter_handles_.clear();
+            for (const auto& adapter : ndis_adapters)
+                interface_adapter_handles_.push_back(adapter.get_adapter());
+
+            interface_adapters_.clear();
+
             const auto configured_interfaces = iphelper::network_adapter_info::get_external_network_connections();
             std::unordered_set<std::string> adapters_to_filter;
 
@@ -1865,6 +5098,11 @@ namespace proxy
                         }); it != ndis_adapters.end())
                     {
                         adapters_to_filter.insert(it->get_internal_name());
+                        interface_adapters_.try_emplace(adapter.get_luid().Value, it->get_internal_name());
+                    }
+                    else
+                    {
+                        interface_adapters_.try_emplace(adapter.get_luid().Value);
                     }
                 }
                 else
@@ -1913,13 +5151,147 @@ namespace proxy
                 adapters_to_filter_ = std::move(adapters_to_filter);
             }
         }
+
+        /**
+         * @brief Applies a batch of coalesced IP interface changes.
+         *
+         * Interfaces known from the last full update get their adapter filtered or unfiltered
+         * individually. A full batch, an interface not seen before, a PPP interface (matched by
+         * its RAS links) or a change in the NDIS adapter list fall back to the full update.
+         *
+         * @param changes Interfaces changed since the previous batch.
+         */
+        void update_network_configuration(const iphelper::interface_change_queue::batch& changes)
+        {
+            NETLIB_DEBUG("Network configuration has changed, {} interface(s){}",
+                         changes.interfaces.size(), changes.full ? ", full update" : "");
+
+            if (!changes.full && update_changed_interfaces(changes.interfaces))
+                return;
+
+            update_network_configuration();
+        }
+
+        /**
+         * @brief Filters or unfilters the adapters of the changed interfaces known from the last full update.
+         *
+         * @param interfaces LUIDs of the changed interfaces.
+         * @return false if a full update is required, nothing has been changed then.
+         */
+        bool update_changed_interfaces(const std::vector<uint64_t>& interfaces)
+        {
+            std::scoped_lock config_lock(network_config_lock_);
+
+            const auto ndis_adapters = packet_filter_->get_interface_list();
+
+            if (!std::ranges::equal(ndis_adapters, interface_adapter_handles_, {},
+                                    [](const auto& adapter) { return adapter.get_adapter(); }))
+                return false;
+
+            std::vector<std::pair<std::string, bool>> updates;
+            updates.reserve(interfaces.size());
+
+            for (const auto luid : interfaces)
+            {
+                const auto it = interface_adapters_.find(luid);
+
+                if (it == interface_adapters_.end())
+                    return false;
+
+                if (it->second.empty())
+                    continue;
+
+                IF_LUID if_luid{};
+                if_luid.Value = luid;
+
+                updates.emplace_back(it->second, iphelper::network_adapter_info::is_external_network_connection(if_luid));
+            }
+
+            for (const auto& [internal_name, filter] : updates)
+            {
+                {
+                    std::shared_lock lock(adapters_to_filter_lock_);
+                    if (adapters_to_filter_.contains(internal_name) == filter)
+                        continue;
+                }
+
+                if (filter)
+                {
+                    packet_filter_->filter_network_adapter(internal_name);
+                    NETLIB_DEBUG("Filtering network interface: {}", internal_name);
+                }
+                else
+                {
+                    packet_filter_->unfilter_network_adapter(internal_name);
+                    NETLIB_DEBUG("Unfiltering network interface: {}", internal_name);
+                }
+
+                std::unique_lock lock(adapters_to_filter_lock_);
+
+                if (filter)
+                    adapters_to_filter_.insert(internal_name);
+                else
+                    adapters_to_filter_.erase(internal_name);
+            }
+
+            return true;
+        }
         
         /**
-        * @brief Builds and adds IPv4 pass-through filters for common local network ranges.
+         * @brief Installs or removes the filters taking outbound DNS queries to user mode.
+         *
+         * They are evaluated before the LAN bypass filters (see lan_bypass_group), otherwise the
+         * queries to a resolver on the LAN would be passed by the driver.
+         *
+         * @param enable true if at least one proxy forwards DNS.
+         */
+        void update_dns_redirect_filters(const bool enable)
+        {
+            if (!static_filters_)
+                return;
+
+            const auto dns_filter = []<net::ip_address T>()
+            {
+                ndisapi::filter<T> filter;
+                filter
+                    .set_direction(ndisapi::direction_t::out)
+                    .set_action(ndisapi::action_t::redirect)
+                    .set_protocol(IPPROTO_UDP)
+                    .set_dest_port(std::make_pair<uint16_t, uint16_t>(53, 53));
+                return filter;
+            };
+
+            const auto dns_filter_v4 = dns_filter.template operator()<net::ip_address_v4>();
+            const auto dns_filter_v6 = dns_filter.template operator()<net::ip_address_v6>();
+
+            std::scoped_lock filters_lock(static_filters_lock_);
+
+            // Checked under the lock, so that concurrent callers do not add or remove the filters twice
+            if (enable == dns_filters_installed_)
+                return;
+
+            auto dns_filters = static_filters_->begin_update();
+
+            if (enable)
+                dns_filters.add(dns_filter_v4, ndisapi::filter_group::high).add(dns_filter_v6, ndisapi::filter_group::high);
+            else
+                dns_filters.remove(dns_filter_v4).remove(dns_filter_v6);
+
+            if (!dns_filters.commit())
+            {
+                NETLIB_WARNING("Failed to update the DNS redirect filters");
+                return;
+            }
+
+            dns_filters_installed_ = enable;
+        }
+
+        /**
+        * @brief Installs or removes IPv4 and IPv6 pass-through filters for common local network ranges.
         *
         * The function generates inbound and outbound filters that allow traffic
-        * for a predefined set of local and special-purpose IPv4 subnets and adds
-        * them to the static filters list.
+        * for a predefined set of local and special-purpose subnets and adds
+        * them to or removes them from the static filters list.
         *
         * Bypassed ranges:
         * - 10.0.0.0/8      (Private Class A)
@@ -1927,11 +5299,19 @@ namespace proxy
         * - 192.168.0.0/16  (Private Class C)
         * - 224.0.0.0/4     (Multicast)
         * - 169.254.0.0/16  (Link-local / APIPA)
+        * - fc00::/7        (Unique local)
+        * - fe80::/10       (Link-local)
+        * - ff00::/8        (Multicast)
+        *
+        * @param enable true to bypass the local network ranges.
         */
-        void add_lan_passover_filters_v4()
+        void update_lan_bypass_filters(const bool enable)
         {
+            if (!static_filters_)
+                return;
+
             // List of local IPv4 address ranges (address + subnet mask)
-            static constexpr std::array<std::pair<const char*, const char*>, 5> local_ranges{ {
+            static constexpr std::array<std::pair<const char*, const char*>, 5> local_ranges_v4{ {
                 {"10.0.0.0",    "255.0.0.0"},      // 10.0.0.0/8 - Private Class A
                 {"172.16.0.0",  "255.240.0.0"},    // 172.16.0.0/12 - Private Class B
                 {"192.168.0.0", "255.255.0.0"},    // 192.168.0.0/16 - Private Class C
@@ -1939,35 +5319,61 @@ namespace proxy
                 {"169.254.0.0", "255.255.0.0"}     // 169.254.0.0/16 - Link-local (APIPA)
             } };
 
-            // Helper to construct an IPv4 subnet object from string literals
-            const auto to_subnet = [](const char* address, const char* mask) {
-                return net::ip_subnet{
-                    net::ip_address_v4{address},
-                    net::ip_address_v4{mask}
-                };
-                };
+            // List of local IPv6 address ranges (address + subnet mask)
+            static constexpr std::array<std::pair<const char*, const char*>, 3> local_ranges_v6{ {
+                {"fc00::", "fe00::"},              // fc00::/7 - Unique local
+                {"fe80::", "ffc0::"},              // fe80::/10 - Link-local
+                {"ff00::", "ff00::"}               // ff00::/8 - Multicast
+            } };
 
-            for (const auto& [address, mask] : local_ranges) {
-                const auto subnet = to_subnet(address, mask);
+            std::scoped_lock filters_lock(static_filters_lock_);
 
-                // Allow inbound traffic originating from the local subnet
-                ndisapi::filter<net::ip_address_v4> in_filter;
-                in_filter
-                    .set_direction(ndisapi::direction_t::in)
-                    .set_action(ndisapi::action_t::pass)
-                    .set_source_address(subnet);
-                static_filters_.add_filter_front(in_filter);
+            if (enable == lan_filters_installed_)
+                return;
 
-                // Allow outbound traffic destined to the local subnet
-                ndisapi::filter<net::ip_address_v4> out_filter;
-                out_filter
-                    .set_direction(ndisapi::direction_t::out)
-                    .set_action(ndisapi::action_t::pass)
-                    .set_dest_address(subnet);
-                static_filters_.add_filter_front(out_filter);
+            // One table write for all ranges, ahead of every other filter but the DNS redirect ones
+            auto lan_filters = static_filters_->begin_update();
+
+            const auto update_ranges = [&lan_filters, enable]<net::ip_address T>(const auto& local_ranges)
+            {
+                for (const auto& [address, mask] : local_ranges) {
+                    const auto subnet = net::ip_subnet{ T{ address }, T{ mask } };
+
+                    // Allow inbound traffic originating from the local subnet
+                    ndisapi::filter<T> in_filter;
+                    in_filter
+                        .set_direction(ndisapi::direction_t::in)
+                        .set_action(ndisapi::action_t::pass)
+                        .set_source_address(subnet);
+
+                    // Allow outbound traffic destined to the local subnet
+                    ndisapi::filter<T> out_filter;
+                    out_filter
+                        .set_direction(ndisapi::direction_t::out)
+                        .set_action(ndisapi::action_t::pass)
+                        .set_dest_address(subnet);
+
+                    if (enable)
+                        lan_filters.add(in_filter, lan_bypass_group).add(out_filter, lan_bypass_group);
+                    else
+                        lan_filters.remove(in_filter).remove(out_filter);
+                }
+            };
+
+            update_ranges.template operator()<net::ip_address_v4>(local_ranges_v4);
+            update_ranges.template operator()<net::ip_address_v6>(local_ranges_v6);
+
+            if (!lan_filters.commit())
+            {
+                NETLIB_WARNING("Failed to update the LAN bypass filters");
+                return;
             }
 
-            NETLIB_LOG(log_level::info, "LAN bypass enabled - local network traffic will not be proxied");
+            lan_filters_installed_ = enable;
+
+            NETLIB_LOG(log_level::info, enable
+                ? "LAN bypass enabled - local network traffic will not be proxied"
+                : "LAN bypass disabled - local network traffic is proxied");
         }
     };
 }
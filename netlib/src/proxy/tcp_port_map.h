@@ -0,0 +1,205 @@
+#pragma once
+
+namespace proxy
+{
+    /**
+     * @class tcp_port_map
+     * @brief Lock-free map from a redirected connection's local source port to its original destination.
+     *
+     * The key is a 16-bit port, so the map is a direct-indexed array of 65536 slots. For IPv4 each
+     * slot is a single 64-bit atomic word packing the destination address, port and the insertion
+     * time (512 KB), which makes insert() one store and take() one load plus one compare-exchange.
+     * An IPv6 address does not fit the word: it is kept in two more words (1.5 MB) guarded by the
+     * slot word as a sequence lock, so take() still claims the entry with one compare-exchange and
+     * never returns an address torn by a concurrent insert().
+     *
+     * Expiry is implicit: take() rejects entries older than the time-to-live, and an abandoned
+     * entry occupies only its own slot until the next SYN from the same port overwrites it, so
+     * no timer or periodic sweep is needed. The insertion time is kept with a 15-bit resolution in
+     * seconds; an entry left untouched for a multiple of that period (about 9 hours) would appear
+     * fresh again, which requires a connection reaching the local proxy from that port without a
+     * preceding redirected SYN.
+     *
+     * @tparam T IP address type (net::ip_address_v4 or net::ip_address_v6).
+     */
+    template <net::ip_address T>
+    class tcp_port_map
+    {
+        static constexpr std::size_t slot_count = 65536;
+
+        static constexpr uint64_t occupied_flag = 1;
+        static constexpr uint32_t stamp_mask = 0x7fff;
+
+        /// True if the destination address is packed into the slot word.
+        static constexpr bool packed_address = std::is_same_v<T, net::ip_address_v4>;
+
+        /// Words holding the destination address beside the slot word, none if it is packed.
+        static constexpr std::size_t address_words = packed_address ? 0 : sizeof(T) / sizeof(uint64_t);
+
+        /**
+         * @struct slot
+         * @brief Entry of one local port.
+         */
+        struct slot
+        {
+            /// IPv4 address or IPv6 sequence << 32 | port << 16 | stamp << 1 | occupied.
+            std::atomic<uint64_t> word{ 0 };
+            /// IPv6 destination address.
+            std::array<std::atomic<uint64_t>, address_words> address{};
+        };
+
+    public:
+        /**
+         * @enum status
+         * @brief Outcome of a take() call.
+         */
+        enum class status : uint8_t
+        {
+            absent,     ///< No entry for the port.
+            stale,      ///< The entry was older than the time-to-live and has been discarded.
+            found       ///< The entry was valid and has been removed.
+        };
+
+        /**
+         * @struct take_result
+         * @brief Result of a take() call.
+         */
+        struct take_result
+        {
+            status state;                                       ///< Lookup outcome.
+            net::ip_endpoint<T> endpoint;                       ///< Original destination if state is status::found.
+        };
+
+        /**
+         * @brief Constructs an empty map.
+         * @param ttl Time-to-live of an entry counted from its insertion, must be well below 9 hours.
+         */
+        explicit tcp_port_map(const std::chrono::seconds ttl)
+            : ttl_(static_cast<uint32_t>(ttl.count())),
+              slots_(std::make_unique<slot[]>(slot_count))
+        {
+        }
+
+        tcp_port_map(const tcp_port_map&) = delete;
+        tcp_port_map(tcp_port_map&&) = delete;
+        tcp_port_map& operator=(const tcp_port_map&) = delete;
+        tcp_port_map& operator=(tcp_port_map&&) = delete;
+        ~tcp_port_map() = default;
+
+        /**
+         * @brief Records (or replaces) the original destination of the connection from a local port.
+         * @param port Local source port (host byte order).
+         * @param destination Original destination endpoint.
+         */
+        void insert(const uint16_t port, const net::ip_endpoint<T>& destination) noexcept
+        {
+            auto& entry = slots_[port];
+
+            if constexpr (packed_address)
+            {
+                entry.word.store(pack(destination.ip.S_un.S_addr, destination.port, now()), std::memory_order_release);
+            }
+            else
+            {
+                // A new sequence makes take() calls that read the previous word fail their claim
+                const auto sequence = static_cast<uint32_t>(entry.word.load(std::memory_order_relaxed) >> 32) + 1;
+
+                // Empty the slot while the address is rewritten, see take()
+                entry.word.store(static_cast<uint64_t>(sequence) << 32, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+
+                std::array<uint64_t, address_words> words{};
+                std::memcpy(words.data(), &destination.ip, sizeof(T));
+
+                for (std::size_t i = 0; i < address_words; ++i)
+                    entry.address[i].store(words[i], std::memory_order_relaxed);
+
+                entry.word.store(pack(sequence, destination.port, now()), std::memory_order_release);
+            }
+        }
+
+        /**
+         * @brief Removes and returns the entry of a local port.
+         *
+         * The removal is a compare-exchange against the word that was read, so an entry inserted
+         * concurrently by a newer SYN on the same port is never discarded by mistake.
+         *
+         * @param port Local source port (host byte order).
+         * @return The lookup outcome and, for status::found, the original destination.
+         */
+        take_result take(const uint16_t port) noexcept
+        {
+            auto& entry = slots_[port];
+
+            auto word = entry.word.load(std::memory_order_acquire);
+            if (!(word & occupied_flag))
+                return { status::absent, {} };
+
+            T address{};
+
+            if constexpr (packed_address)
+            {
+                address = T(static_cast<uint32_t>(word >> 32));
+            }
+            else
+            {
+                std::array<uint64_t, address_words> words{};
+
+                for (std::size_t i = 0; i < address_words; ++i)
+                    words[i] = entry.address[i].load(std::memory_order_relaxed);
+
+                std::memcpy(&address, words.data(), sizeof(T));
+
+                // An address rewritten since the word was read makes the claim below fail
+                std::atomic_thread_fence(std::memory_order_acquire);
+            }
+
+            // An IPv6 slot keeps its sequence when emptied so a word is never reused
+            if (!entry.word.compare_exchange_strong(word, packed_address ? 0 : word & ~uint64_t{ 0xffffffff },
+                                                    std::memory_order_acq_rel))
+                return { status::absent, {} };
+
+            if (((now() - static_cast<uint32_t>(word >> 1)) & stamp_mask) > ttl_)
+                return { status::stale, {} };
+
+            return { status::found, net::ip_endpoint(address, static_cast<uint16_t>(word >> 16)) };
+        }
+
+        /**
+         * @brief Removes all entries.
+         */
+        void clear() noexcept
+        {
+            for (std::size_t i = 0; i < slot_count; ++i)
+                slots_[i].word.store(0, std::memory_order_relaxed);
+        }
+
+    private:
+        /**
+         * @brief Packs a slot word: IPv4 address or IPv6 sequence << 32 | port << 16 | stamp << 1 | occupied.
+         */
+        static uint64_t pack(const uint32_t high, const uint16_t port, const uint32_t stamp) noexcept
+        {
+            return static_cast<uint64_t>(high) << 32 |
+                static_cast<uint64_t>(port) << 16 |
+                static_cast<uint64_t>(stamp & stamp_mask) << 1 |
+                occupied_flag;
+        }
+
+        /**
+         * @brief Returns the current time in seconds since map construction, truncated to the stamp width.
+         */
+        [[nodiscard]] uint32_t now() const noexcept
+        {
+            return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::steady_clock::now() - epoch_).count()) & stamp_mask;
+        }
+
+        /// Entry time-to-live in seconds.
+        const uint32_t ttl_;
+        /// Reference point for the slot timestamps.
+        const std::chrono::steady_clock::time_point epoch_{ std::chrono::steady_clock::now() };
+        /// Slot storage indexed by local source port.
+        std::unique_ptr<slot[]> slots_;
+    };
+}
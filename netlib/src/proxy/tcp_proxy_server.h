@@ -24,7 +24,7 @@ namespace proxy
      *   - per_io_context_t: Per-I/O context type for managing asynchronous operations.
      *
      * Public interface:
-     * - tcp_proxy_server(uint16_t proxy_port, winsys::io_completion_port&, std::function<query_remote_peer_t>, ...)
+     * - tcp_proxy_server(uint16_t proxy_port, winsys::io_completion_port_group&, std::function<query_remote_peer_t>, ...)
      *      Constructs and initializes the proxy server, binding to the specified port.
      * - ~tcp_proxy_server()
      *      Cleans up all resources and stops the server.
@@ -40,9 +40,18 @@ namespace proxy
      * Not copyable or movable.
      *
      * Internal details:
-     * - Uses a vector of socket/event/context tuples to track pending and active connections.
-     * - Uses multiple threads for accepting connections, connecting to remote hosts, and cleaning up idle sessions.
-     * - Associates sockets with the I/O completion port for efficient asynchronous I/O.
+     * - Keeps accept_backlog AcceptEx operations posted on the listening socket and connects to the
+     *   remote peer with ConnectEx, so accepting and connecting run on the completion port threads
+     *   with no limit on the number of connections being set up.
+     * - Uses a dedicated thread only for cleaning up idle sessions.
+     * - Associates sockets with the I/O completion port for efficient asynchronous I/O. With a sharded
+     *   completion port group, each session is bound to one shard and its socket objects are
+     *   allocated on that shard's NUMA node. Relay buffers come from the process-wide
+     *   relay_buffer_pool, which is not NUMA aware.
+     * - In fast relay mode, relay operations that complete immediately skip the completion port and
+     *   are processed on the thread that issued them (see tcp_proxy_socket::enable_fast_relay).
+     * - With a socks5_connection_pool, sessions to the pool's proxy start on a pre-negotiated connection
+     *   and skip the connect and authentication round trips.
      * - Thread safety is ensured via shared_mutex and atomic flags.
      */
     template <typename T>
@@ -88,18 +97,48 @@ namespace proxy
 
     private:
         /**
-         * @brief Maximum number of simultaneous connections/events the server can track.
+         * @brief Number of AcceptEx operations kept posted on the listening socket.
          *
-         * This constant defines the reserved size for the internal connection/event arrays.
+         * Each completed accept is re-posted right away, so this only bounds how many clients can be
+         * accepted while no completion port thread is free to re-post, not the number of connections.
+         * An accept that fails to post is retried by the cleanup thread on its next tick.
          */
-        constexpr static size_t connections_array_size = 64;
+        constexpr static size_t accept_backlog = 32;
 
         /**
-         * @brief Reference to the I/O completion port used for asynchronous socket operations.
+         * @brief Size of one address slot in the AcceptEx output buffer (the API requires 16 spare bytes).
+         */
+        constexpr static DWORD accept_address_length = sizeof(SOCKADDR_STORAGE) + 16;
+
+        /**
+         * @struct pending_connection
+         * @brief Overlapped context of a connection being accepted or connected to the remote peer.
+         *
+         * Derives from per_io_context_t so the completion handler can tell it apart from proxy socket
+         * I/O by its io_operation (proxy_io_operation::accept_io or proxy_io_operation::connect_io).
+         * Both sockets are associated with the completion port shard of the session before the
+         * overlapped operation is posted.
+         */
+        struct pending_connection : per_io_context_t
+        {
+            explicit pending_connection(const proxy_io_operation operation)
+                : per_io_context_t(operation, nullptr, true)
+            {
+            }
+
+            SOCKET local_socket{ INVALID_SOCKET };                      ///< Accepted (or being accepted) client socket.
+            SOCKET remote_socket{ INVALID_SOCKET };                     ///< Socket connecting to the remote peer.
+            size_t shard{ 0 };                                          ///< Completion port shard of the session.
+            std::unique_ptr<negotiate_context_t> negotiate_ctx;         ///< Negotiation context for the session.
+            std::array<char, 2 * accept_address_length> addresses{};    ///< AcceptEx local and remote address output.
+        };
+
+        /**
+         * @brief Reference to the I/O completion ports used for asynchronous socket operations.
          *
          * This enables scalable, efficient handling of multiple concurrent I/O operations.
          */
-        netlib::winsys::io_completion_port& completion_port_;
+        netlib::winsys::io_completion_port_group& completion_ports_;
 
         /**
          * @brief Callback function to query remote peer information for each new connection.
@@ -110,45 +149,79 @@ namespace proxy
         std::function<query_remote_peer_t> query_remote_peer_;
 
         /**
-         * @brief Shared mutex for synchronizing access to internal data structures.
-         *
-         * Used to protect concurrent access to the proxy socket and event arrays.
+         * @brief Resolution of the session idle timers (and longest wait of the cleanup thread).
          */
-        std::shared_mutex lock_;
+        constexpr static std::chrono::seconds idle_timer_tick{ 1 };
 
         /**
-         * @brief Thread for accepting incoming client connections and dispatching them.
+         * @brief Number of idle timer wheel slots, covering T::idle_timeout in ticks.
          */
-        std::thread proxy_server_;
+        constexpr static size_t idle_timer_slots = 4096;
 
         /**
-         * @brief Thread for periodically checking and cleaning up closed or idle client sessions.
+         * @brief Shared mutex for synchronizing access to internal data structures.
+         *
+         * Used to protect concurrent access to the proxy socket table, the idle timers and the pending connects.
          */
-        std::thread check_clients_thread_;
+        std::shared_mutex lock_;
 
         /**
-         * @brief Thread for handling asynchronous connections to remote hosts.
+         * @brief Thread reaping closed sessions and sessions whose idle timer has expired.
          */
-        std::thread connect_to_remote_host_thread_;
+        std::thread check_clients_thread_;
 
         /**
-         * @brief Vector of active proxy socket instances, one per client session.
+         * @brief Active proxy socket instances, one per client session, keyed by address.
          *
          * Uses shared_ptr to enable safe concurrent access from IOCP threads.
          * The last reference may be held by a pending I/O operation.
          */
-        std::vector<std::shared_ptr<T>> proxy_sockets_;
+        tools::generic::flat_hash_map<T*, std::shared_ptr<T>> proxy_sockets_;
 
         /**
-         * @brief Array of tuples tracking events, sockets, and negotiation contexts for pending connections.
-         *
-         * Each tuple contains:
-         * - WSAEVENT: Event handle for overlapped I/O notification.
-         * - SOCKET:   Local client socket.
-         * - SOCKET:   Remote server socket.
-         * - std::unique_ptr<negotiate_context_t>: Negotiation context for the session.
+         * @brief Idle timer of every active session (deadline: last activity plus T::idle_timeout).
+         */
+        tools::generic::timing_wheel<T*> idle_timers_{ idle_timer_tick, idle_timer_slots };
+
+        /**
+         * @brief Protects closed_sessions_ and unposted_accepts_. Never held together with a session lock.
          */
-        std::vector<std::tuple<WSAEVENT, SOCKET, SOCKET, std::unique_ptr<negotiate_context_t>>> sock_array_events_;
+        std::mutex closed_lock_;
+
+        /**
+         * @brief Wakes the cleanup thread when a session has been closed.
+         */
+        std::condition_variable closed_signal_;
+
+        /**
+         * @brief Sessions that have closed both sockets since the last cleanup pass.
+         */
+        std::vector<std::weak_ptr<T>> closed_sessions_;
+
+        /**
+         * @brief Accept contexts whose AcceptEx could not be posted, retried by the cleanup thread.
+         */
+        std::vector<pending_connection*> unposted_accepts_;
+
+        /**
+         * @brief Contexts of the AcceptEx operations posted on the listening socket (reused after each accept).
+         */
+        std::vector<std::unique_ptr<pending_connection>> accept_contexts_;
+
+        /**
+         * @brief Contexts of the ConnectEx operations in progress, keyed by context address.
+         */
+        std::unordered_map<pending_connection*, std::unique_ptr<pending_connection>> connect_contexts_;
+
+        /**
+         * @brief AcceptEx extension function of the listening socket's provider.
+         */
+        LPFN_ACCEPTEX accept_ex_{ nullptr };
+
+        /**
+         * @brief ConnectEx extension function of the listening socket's provider.
+         */
+        LPFN_CONNECTEX connect_ex_{ nullptr };
 
         /**
          * @brief The main listening socket for incoming client connections.
@@ -156,9 +229,9 @@ namespace proxy
         SOCKET server_socket_{ INVALID_SOCKET };
 
         /**
-         * @brief Completion key associated with the I/O completion port for this server.
+         * @brief Completion keys of this server's handler, one per completion port shard.
          */
-        ULONG_PTR completion_key_{ 0 };
+        std::vector<ULONG_PTR> completion_keys_;
 
         /**
          * @brief Counts the number of IOCP operations currently executing in the lambda.
@@ -173,6 +246,16 @@ namespace proxy
          */
         uint16_t proxy_port_;
 
+        /**
+         * @brief True if established sessions relay in fast relay mode.
+         */
+        bool fast_relay_;
+
+        /**
+         * @brief Optional pool of pre-negotiated connections to the SOCKS5 proxy (used only if T supports it).
+         */
+        std::shared_ptr<socks5_connection_pool<address_type_t>> connection_pool_;
+
         /**
         * @brief Atomic flag indicating whether the server is shutting down or has terminated.
         */
@@ -187,24 +270,39 @@ namespace proxy
          * cannot be created or bound.
          *
          * @param proxy_port         The TCP port number to listen on for incoming client connections.
-         * @param completion_port    Reference to the I/O completion port for asynchronous operations.
+         * @param completion_ports   Reference to the I/O completion ports for asynchronous operations.
          * @param query_remote_peer_fn
          *        Callback function to determine the remote peer address, port, and negotiation context
          *        for each new client connection.
          * @param log_level          Logging level for this server instance (default: error).
          * @param log_stream         Optional output stream for logging (default: std::nullopt).
+         * @param fast_relay         If true, established sessions process immediately completed relay
+         *                           operations inline instead of through the completion port. Ignored if
+         *                           a non-IFS layered service provider is installed for TCP (default: false).
+         * @param connection_pool    Optional pool of pre-negotiated SOCKS5 connections. Sessions to the pool's
+         *                           proxy claim a connection from it instead of connecting and authenticating,
+         *                           if T supports pre-authenticated sockets (default: nullptr).
          *
          * @throws std::runtime_error if the server socket cannot be created or bound.
          */
-        tcp_proxy_server(const uint16_t proxy_port, netlib::winsys::io_completion_port& completion_port,
+        tcp_proxy_server(const uint16_t proxy_port, netlib::winsys::io_completion_port_group& completion_ports,
             const std::function<query_remote_peer_t>& query_remote_peer_fn,
             const log_level log_level = log_level::error,
-            std::shared_ptr<std::ostream> log_stream = nullptr)
+            std::shared_ptr<std::ostream> log_stream = nullptr,
+            const bool fast_relay = false,
+            std::shared_ptr<socks5_connection_pool<address_type_t>> connection_pool = nullptr)
             : logger(log_level, std::move(log_stream)),
             proxy_port_(proxy_port),
-            completion_port_(completion_port),
+            fast_relay_(fast_relay && are_tcp_providers_ifs()),
+            connection_pool_(std::move(connection_pool)),
+            completion_ports_(completion_ports),
             query_remote_peer_(query_remote_peer_fn)
         {
+            if (fast_relay && !fast_relay_)
+            {
+                NETLIB_WARNING("tcp_proxy_server: non-IFS TCP provider installed, fast relay mode disabled");
+            }
+
             if (!create_server_socket())
             {
                 throw std::runtime_error("tcp_proxy_server: failed to create server socket.");
@@ -265,11 +363,11 @@ namespace proxy
          * This method initializes the server for accepting new client connections and relaying data.
          * It performs the following steps:
          * - Checks if the server is already running; if so, returns true immediately.
-         * - Reserves space for connection events and sockets.
-         * - Creates the initial event and socket tuple for accepting connections.
-         * - Associates the listening socket with the I/O completion port and sets up the callback handler.
+         * - Loads the AcceptEx and ConnectEx extension functions.
+         * - Associates the listening socket with the first I/O completion port and registers the
+         *   callback handler with every other port of the group.
          * - If association fails, cleans up resources and returns false.
-         * - Launches the main proxy server thread, client cleanup thread, and remote host connection thread.
+         * - Posts accept_backlog overlapped accepts and launches the client cleanup thread.
          *
          * @return true if the server was started successfully or is already running; false if initialization failed.
          */
@@ -281,19 +379,17 @@ namespace proxy
                 return true;
             }
 
-            end_server_ = false;
-
-            sock_array_events_.reserve(connections_array_size);
+            if (server_socket_ == static_cast<SOCKET>(INVALID_SOCKET) ||
+                !load_extension_function(WSAID_ACCEPTEX, accept_ex_) ||
+                !load_extension_function(WSAID_CONNECTEX, connect_ex_))
+            {
+                return false;
+            }
 
-            sock_array_events_.push_back(std::make_tuple(WSACreateEvent(),
-                                                         WSASocket(address_type_t::af_type, SOCK_STREAM,
-                                                                   IPPROTO_TCP, nullptr, 0,
-                                                                   WSA_FLAG_OVERLAPPED), INVALID_SOCKET, nullptr));
+            end_server_ = false;
 
-            if (std::get<1>(sock_array_events_[0]) != INVALID_SOCKET)
             {
-                auto [success, io_key] = completion_port_.associate_socket(
-                    std::get<1>(sock_array_events_[0]),
+                const std::function<netlib::winsys::io_completion_port::callback_t> io_handler =
                     [this](const DWORD num_bytes, OVERLAPPED* povlp, const BOOL status)
                     {
                         // Increment active operations counter on entry
@@ -323,6 +419,19 @@ namespace proxy
 
                         auto io_context = static_cast<per_io_context_t*>(povlp);
 
+                        // Accepts and connects complete on server-owned contexts, before any proxy socket exists
+                        if (io_context->io_operation == proxy_io_operation::accept_io)
+                        {
+                            process_accept_complete(static_cast<pending_connection*>(io_context), status);
+                            return true;
+                        }
+
+                        if (io_context->io_operation == proxy_io_operation::connect_io)
+                        {
+                            process_connect_complete(static_cast<pending_connection*>(io_context), status);
+                            return true;
+                        }
+
                         if (!status || (status && (num_bytes == 0)))
                         {
                             if ((io_context->io_operation == proxy_io_operation::relay_io_read) ||
@@ -359,38 +468,49 @@ namespace proxy
 
                         case proxy_io_operation::inject_io_write:
                             T::process_inject_buffer_complete(io_context);
-                            break;
+                            return true;
                         default: break; // NOLINT(clang-diagnostic-covered-switch-default)
                         }
 
+                        // Relay operations issued while processing may have completed immediately
+                        io_context->proxy_socket_ptr->process_inline_completions();
+
                         return true;
-                    });
+                    };
+
+                auto [success, io_key] = completion_ports_.port(0).associate_socket(server_socket_, io_handler);
 
                 if (success == true)
                 {
-                    completion_key_ = io_key;
-                }
-                else
-                {
-                    if (std::get<0>(sock_array_events_[0]) != INVALID_HANDLE_VALUE)
-                    {
-                        WSACloseEvent(std::get<0>(sock_array_events_[0]));
-                    }
+                    completion_keys_.assign(completion_ports_.size(), 0);
+                    completion_keys_[0] = io_key;
 
-                    if (std::get<1>(sock_array_events_[0]) != INVALID_SOCKET)
+                    for (size_t i = 1; i < completion_ports_.size(); ++i)
                     {
-                        closesocket(std::get<1>(sock_array_events_[0]));
+                        completion_keys_[i] = completion_ports_.port(i).register_handler(io_handler);
                     }
-
-                    sock_array_events_.clear();
+                }
+                else
+                {
                     end_server_ = true;
                     return false;
                 }
             }
 
-            proxy_server_ = std::thread(&tcp_proxy_server::start_proxy_thread, this);
+            accept_contexts_.reserve(accept_backlog);
+
+            for (size_t i = 0; i < accept_backlog; ++i)
+            {
+                accept_contexts_.push_back(std::make_unique<pending_connection>(proxy_io_operation::accept_io));
+
+                if (!post_accept(accept_contexts_.back().get()))
+                {
+                    NETLIB_WARNING("start: Failed to post overlapped accept {} of {}", i + 1, accept_backlog);
+                    unposted_accepts_.push_back(accept_contexts_.back().get());
+                }
+            }
+
             check_clients_thread_ = std::thread(&tcp_proxy_server::clear_thread, this);
-            connect_to_remote_host_thread_ = std::thread(&tcp_proxy_server::connect_to_remote_host_thread, this);
 
             return true;
         }
@@ -400,10 +520,11 @@ namespace proxy
          *
          * This method performs a graceful shutdown of the proxy server by:
          * 1. Setting the end_server_ flag to signal shutdown
-         * 2. Closing the server socket, which causes pending I/O to complete with error
+         * 2. Closing the server socket, which causes pending accepts to complete with error
          * 3. Waiting for all active IOCP operations to complete (tracked by atomic counter)
-         * 4. Joining background threads
-         * 5. Clearing resources
+         * 4. Joining the cleanup thread
+         * 5. Closing the sockets of pending accepts and connects, waiting for every one of them to
+         *    complete, then clearing resources
          *
          * The IOCP thread pool itself is managed by io_completion_port and will be 
          * properly shut down when the completion port is destroyed.
@@ -419,7 +540,11 @@ namespace proxy
             }
 
             // Step 1: Signal shutdown - IOCP lambda will check this and exit
-            end_server_ = true;
+            {
+                std::scoped_lock lock(closed_lock_);
+                end_server_ = true;
+            }
+            closed_signal_.notify_all();
 
             // Step 2: Close server socket
             // This causes any pending accept/I/O operations to complete immediately with an error.
@@ -427,16 +552,14 @@ namespace proxy
             closesocket(server_socket_);
             server_socket_ = INVALID_SOCKET;
 
+            // Step 2.5: Unregister the IOCP handlers BEFORE waiting
+            for (size_t i = 0; i < completion_keys_.size(); ++i)
             {
-                std::unique_lock lock(lock_);
-                ::WSASetEvent(std::get<0>(sock_array_events_[0]));
+                if (completion_keys_[i] != 0)
+                    (void)completion_ports_.port(i).unregister_handler(completion_keys_[i]);
             }
 
-            // Step 2.5: Unregister the IOCP handler BEFORE waiting
-            if (completion_key_ != 0) {
-                (void)completion_port_.unregister_handler(completion_key_);
-                completion_key_ = 0;
-            }
+            completion_keys_.clear();
 
             // Step 3: Wait for all active IOCP operations to complete
             // The socket closure ensures pending operations complete quickly.
@@ -461,37 +584,69 @@ namespace proxy
             }
 
             // Step 4: Join background threads
-            if (proxy_server_.joinable())
-            {
-                proxy_server_.join();
-            }
-
             if (check_clients_thread_.joinable())
             {
                 check_clients_thread_.join();
             }
 
-            if (connect_to_remote_host_thread_.joinable())
-            {
-                connect_to_remote_host_thread_.join();
-            }
-
             // Step 5: Clear resources
             // Now safe because:
             // - end_server_ is true, so IOCP lambda won't process new completions
             // - Socket is closed, so no new I/O can be initiated
             // - We waited for all active operations to complete
-            if (!sock_array_events_.empty())
+            // Pending accepts and connects still own their sockets; closing them cancels the
+            // operations, and the contexts are released only once the system has completed every
+            // one of them, as it writes to a context until then.
             {
-                sock_array_events_.clear();
+                std::scoped_lock lock(lock_);
+
+                for (const auto& context : accept_contexts_)
+                    close_pending_connection(*context);
+
+                for (const auto& [address, context] : connect_contexts_)
+                    close_pending_connection(*context);
             }
 
+            for (int cancel_iterations = 0;; ++cancel_iterations)
+            {
+                size_t outstanding = 0;
+
+                {
+                    std::shared_lock lock(lock_);
+
+                    outstanding = static_cast<size_t>(std::ranges::count_if(accept_contexts_, [](const auto& context)
+                    {
+                        return !HasOverlappedIoCompleted(context.get());
+                    }) + std::ranges::count_if(connect_contexts_, [](const auto& entry)
+                    {
+                        return !HasOverlappedIoCompleted(entry.second.get());
+                    }));
+                }
+
+                if (outstanding == 0)
+                    break;
+
+                if (cancel_iterations == 100)
+                {
+                    NETLIB_WARNING("stop: Still waiting for {} pending accepts and connects to complete", outstanding);
+                }
+
+                std::this_thread::sleep_for(10ms);
+            }
+
+            accept_contexts_.clear();
+            connect_contexts_.clear();
+            unposted_accepts_.clear();
+
+            idle_timers_.clear();
+            closed_sessions_.clear();
+
             if (!proxy_sockets_.empty())
             {
                 proxy_sockets_.clear();
             }
 
-            // Note: The IOCP thread pool itself is managed by completion_port_ and will be
+            // Note: The IOCP thread pools themselves are managed by completion_ports_ and will be
             // properly shut down when io_completion_port's destructor is called.
         }
 
@@ -510,10 +665,10 @@ namespace proxy
             std::vector<negotiate_context_t> result;
             result.reserve(proxy_sockets_.size());
 
-            std::transform(proxy_sockets_.cbegin(), proxy_sockets_.cend(), std::back_inserter(result), [](auto&& e)
-                {
-                    return *reinterpret_cast<negotiate_context_t*>(e->get_negotiate_ctx());
-                });
+            for (const auto& [key, socket] : proxy_sockets_)
+            {
+                result.push_back(*reinterpret_cast<negotiate_context_t*>(socket->get_negotiate_ctx()));
+            }
 
             return result;
         }
@@ -666,22 +821,185 @@ namespace proxy
         }
 
         /**
-         * @brief Establishes an asynchronous connection to a remote host for a given accepted client socket.
+         * @brief Loads a Winsock extension function (AcceptEx, ConnectEx) for the listening socket's provider.
+         *
+         * @param id       Extension function GUID.
+         * @param function Receives the function pointer.
+         * @return true if the function was loaded; false otherwise.
+         */
+        template <typename F>
+        bool load_extension_function(GUID id, F& function)
+        {
+            DWORD bytes = 0;
+
+            if (WSAIoctl(server_socket_, SIO_GET_EXTENSION_FUNCTION_POINTER, &id, sizeof(id), &function,
+                         sizeof(function), &bytes, nullptr, nullptr) == SOCKET_ERROR)
+            {
+                NETLIB_ERROR("load_extension_function: WSAIoctl failed: {}", WSAGetLastError());
+                return false;
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Checks that every installed TCP provider returns IFS handles.
+         *
+         * FILE_SKIP_COMPLETION_PORT_ON_SUCCESS is unreliable on sockets of non-IFS layered service
+         * providers, so fast relay mode is only used when none is installed.
+         *
+         * @return true if all TCP providers have the XP1_IFS_HANDLES flag; false otherwise or on failure.
+         */
+        static bool are_tcp_providers_ifs()
+        {
+            INT protocols[] = { IPPROTO_TCP, 0 };
+            DWORD length = 0;
+
+            if (WSAEnumProtocolsW(protocols, nullptr, &length) != SOCKET_ERROR || WSAGetLastError() != WSAENOBUFS)
+                return false;
+
+            std::vector<uint8_t> buffer(length);
+            auto* const info = reinterpret_cast<LPWSAPROTOCOL_INFOW>(buffer.data());
+
+            const auto count = WSAEnumProtocolsW(protocols, info, &length);
+            if (count == SOCKET_ERROR)
+                return false;
+
+            return std::all_of(info, info + count, [](const WSAPROTOCOL_INFOW& provider)
+                {
+                    return (provider.dwServiceFlags1 & XP1_IFS_HANDLES) != 0;
+                });
+        }
+
+        /**
+         * @brief Closes the sockets still owned by a pending accept or connect, cancelling its operation.
+         *
+         * @param context The pending connection context.
+         */
+        static void close_pending_connection(pending_connection& context) noexcept
+        {
+            if (context.local_socket != INVALID_SOCKET)
+            {
+                closesocket(context.local_socket);
+                context.local_socket = INVALID_SOCKET;
+            }
+
+            if (context.remote_socket != INVALID_SOCKET)
+            {
+                closesocket(context.remote_socket);
+                context.remote_socket = INVALID_SOCKET;
+            }
+        }
+
+        /**
+         * @brief Posts an overlapped accept on the listening socket.
+         *
+         * The accept socket is created up front and associated with the completion port shard picked
+         * for the session, so all of the session's later I/O completes on that shard. No initial data
+         * is awaited, as the client may wait for the server to speak first.
+         *
+         * @param context Accept context to (re)use; must not have an accept in progress.
+         * @return true if the accept was posted; false otherwise.
+         */
+        bool post_accept(pending_connection* context)
+        {
+            const auto socket = WSASocket(address_type_t::af_type, SOCK_STREAM, IPPROTO_TCP, nullptr, 0,
+                WSA_FLAG_OVERLAPPED);
+
+            if (socket == INVALID_SOCKET)
+            {
+                NETLIB_ERROR("post_accept: Failed to create accept socket: {}", WSAGetLastError());
+                return false;
+            }
+
+            // Bind the session to one completion port shard for its whole lifetime
+            const auto shard = completion_ports_.next_shard();
+
+            if (!completion_ports_.port(shard).associate_socket(socket, completion_keys_[shard]))
+            {
+                NETLIB_ERROR("post_accept: Failed to associate accept socket with completion port");
+                closesocket(socket);
+                return false;
+            }
+
+            static_cast<WSAOVERLAPPED&>(*context) = WSAOVERLAPPED{};
+            context->local_socket = socket;
+            context->shard = shard;
+
+            if (DWORD received = 0; !accept_ex_(server_socket_, socket, context->addresses.data(), 0,
+                                                accept_address_length, accept_address_length, &received, context))
+            {
+                if (const auto error = WSAGetLastError(); error != ERROR_IO_PENDING)
+                {
+                    NETLIB_ERROR("post_accept: AcceptEx failed: {}", error);
+                    context->local_socket = INVALID_SOCKET;
+                    closesocket(socket);
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Handles a completed overlapped accept and re-posts it.
+         *
+         * On success, starts connecting the accepted client to its remote peer; the client socket is
+         * closed if that can't be initiated.
+         *
+         * @param context The accept context.
+         * @param status  Completion status of the accept.
+         */
+        void process_accept_complete(pending_connection* context, const BOOL status)
+        {
+            const auto accepted = std::exchange(context->local_socket, INVALID_SOCKET);
+            const auto shard = context->shard;
+
+            if (!status)
+            {
+                NETLIB_DEBUG("process_accept_complete: Accept failed: {}", GetLastError());
+                closesocket(accepted);
+            }
+            else if (setsockopt(accepted, SOL_SOCKET, SO_UPDATE_ACCEPT_CONTEXT,
+                                reinterpret_cast<const char*>(&server_socket_), sizeof(server_socket_)) == SOCKET_ERROR ||
+                     !connect_to_remote_host(accepted, shard))
+            {
+                closesocket(accepted);
+            }
+
+            if (end_server_.load(std::memory_order_acquire))
+                return;
+
+            if (!post_accept(context))
+            {
+                NETLIB_WARNING("process_accept_complete: Failed to re-post overlapped accept, retrying later");
+
+                std::scoped_lock lock(closed_lock_);
+                unposted_accepts_.push_back(context);
+            }
+        }
+
+        /**
+         * @brief Initiates an overlapped connection to the remote host for an accepted client socket.
          *
          * This method performs the following steps:
          * - Queries the remote peer address, port, and negotiation context using get_remote_peer().
          * - If the remote port is invalid, returns false.
+         * - If a connection to the remote peer can be claimed from the connection pool, associates it with
+         *   the session's completion port shard and starts the session on it right away.
          * - Creates a new overlapped socket for the remote connection.
-         * - Binds the remote socket to an ephemeral local port and any local address (IPv4 or IPv6).
+         * - Binds the remote socket to an ephemeral local port and any local address (IPv4 or IPv6),
+         *   as required by ConnectEx.
          * - Sets the remote socket to non-blocking mode.
-         * - Registers the remote socket and associated event/context in the internal tracking array.
-         * - Initiates a non-blocking connect() to the remote peer.
-         * - If the connection fails immediately (other than WSAEWOULDBLOCK), cleans up and returns false.
+         * - Associates the remote socket with the session's completion port shard.
+         * - Registers a connect context and initiates ConnectEx to the remote peer.
+         * - If the connection fails immediately, cleans up and returns false.
          *
          * @param accepted The accepted client SOCKET for which to establish a remote connection.
+         * @param shard    The completion port shard the accepted socket is associated with.
          * @return true if the connection initiation was successful; false otherwise.
          */
-        bool connect_to_remote_host(SOCKET accepted)
+        bool connect_to_remote_host(SOCKET accepted, const size_t shard)
         {
             auto [remote_ip, remote_port, negotiate_ctx] = get_remote_peer(accepted);
 
@@ -691,6 +1009,26 @@ namespace proxy
                 return false;
             }
 
+            if constexpr (requires (T& session) { session.set_pre_authenticated(); })
+            {
+                if (connection_pool_ && connection_pool_->serves(remote_ip, remote_port))
+                {
+                    if (const auto pooled = connection_pool_->claim(); pooled != INVALID_SOCKET)
+                    {
+                        if (completion_ports_.port(shard).associate_socket(pooled, completion_keys_[shard]))
+                        {
+                            NETLIB_DEBUG("connect_to_remote_host: Using a pooled connection to {}:{}", remote_ip,
+                                remote_port);
+                            start_session(shard, accepted, pooled, std::move(negotiate_ctx), true);
+                            return true;
+                        }
+
+                        NETLIB_WARNING("connect_to_remote_host: Failed to associate pooled socket with completion port");
+                        closesocket(pooled);
+                    }
+                }
+            }
+
             NETLIB_DEBUG("connect_to_remote_host: Connecting to {}:{}", remote_ip, remote_port);
 
             auto remote_socket = WSASocket(address_type_t::af_type, SOCK_STREAM, IPPROTO_TCP, nullptr, 0,
@@ -702,6 +1040,9 @@ namespace proxy
                 return false;
             }
 
+            SOCKADDR_STORAGE sa_service{};
+            int sa_service_length = 0;
+
             if constexpr (address_type_t::af_type == AF_INET)
             {
                 sockaddr_in sa_local{};
@@ -720,6 +1061,12 @@ namespace proxy
                     closesocket(remote_socket);
                     return false;
                 }
+
+                auto* const sa = reinterpret_cast<sockaddr_in*>(&sa_service);
+                sa->sin_family = address_type_t::af_type;
+                sa->sin_addr = remote_ip;
+                sa->sin_port = htons(remote_port);
+                sa_service_length = sizeof(sockaddr_in);
             }
             else
             {
@@ -728,6 +1075,9 @@ namespace proxy
                 sa_local.sin6_port = htons(0);
                 sa_local.sin6_addr = in6addr_any;
 
+                // The remote peer may be an IPv4 proxy given by its IPv4-mapped address
+                enable_dual_stack(remote_socket);
+
                 // bind socket's name
                 const auto status = bind(remote_socket, reinterpret_cast<sockaddr*>(&sa_local), sizeof(sa_local));
 
@@ -739,6 +1089,12 @@ namespace proxy
                     closesocket(remote_socket);
                     return false;
                 }
+
+                auto* const sa = reinterpret_cast<sockaddr_in6*>(&sa_service);
+                sa->sin6_family = address_type_t::af_type;
+                sa->sin6_addr = remote_ip;
+                sa->sin6_port = htons(remote_port);
+                sa_service_length = sizeof(sockaddr_in6);
             }
 
             // enable non-blocking mode
@@ -751,97 +1107,40 @@ namespace proxy
                 // Continue anyway, as this might not be critical
             }
 
-            // The client_service structure specifies the address family,
-            // IP address, and port of the server to be connected to.
+            if (!completion_ports_.port(shard).associate_socket(remote_socket, completion_keys_[shard]))
             {
-                std::scoped_lock lock(lock_);
-
-                if (sock_array_events_.size() >= connections_array_size - 1)
-                {
-                    NETLIB_WARNING("connect_to_remote_host: Socket array full, cannot add new connection");
-                    shutdown(remote_socket, SD_BOTH);
-                    closesocket(remote_socket);
-                    return false;
-                }
-
-                sock_array_events_.push_back(
-                    std::make_tuple(WSACreateEvent(), accepted, remote_socket, std::move(negotiate_ctx)));
-
-                if (std::get<0>(sock_array_events_.back()) == WSA_INVALID_EVENT)
-                {
-                    NETLIB_ERROR("connect_to_remote_host: Failed to create WSA event: {}", WSAGetLastError());
-                    sock_array_events_.pop_back();
-                    shutdown(remote_socket, SD_BOTH);
-                    closesocket(remote_socket);
-                    return false;
-                }
+                NETLIB_ERROR("connect_to_remote_host: Failed to associate remote socket with completion port");
+                closesocket(remote_socket);
+                return false;
+            }
 
-                if (WSAEventSelect(remote_socket, std::get<0>(sock_array_events_.back()), FD_CONNECT) == SOCKET_ERROR)
-                {
-                    const auto error = WSAGetLastError();
-                    NETLIB_WARNING("connect_to_remote_host: WSAEventSelect failed: {}", error);
-                    WSACloseEvent(std::get<0>(sock_array_events_.back()));
-                    sock_array_events_.pop_back();
-                    shutdown(remote_socket, SD_BOTH);
-                    closesocket(remote_socket);
-                    return false;
-                }
+            auto context = std::make_unique<pending_connection>(proxy_io_operation::connect_io);
+            auto* const connect_context = context.get();
+            connect_context->local_socket = accepted;
+            connect_context->remote_socket = remote_socket;
+            connect_context->shard = shard;
+            connect_context->negotiate_ctx = std::move(negotiate_ctx);
 
-                WSASetEvent(std::get<0>(sock_array_events_[0]));
+            {
+                std::scoped_lock lock(lock_);
+                connect_contexts_.emplace(connect_context, std::move(context));
             }
 
             NETLIB_DEBUG("connect_to_remote_host: Initiating connection to {}:{}", remote_ip, remote_port);
 
-            // connect to server
-            if constexpr (address_type_t::af_type == AF_INET)
+            if (!connect_ex_(remote_socket, reinterpret_cast<const sockaddr*>(&sa_service), sa_service_length,
+                             nullptr, 0, nullptr, connect_context))
             {
-                sockaddr_in sa_service{};
-                sa_service.sin_family = address_type_t::af_type;
-                sa_service.sin_addr = remote_ip;
-                sa_service.sin_port = htons(remote_port);
-
-                if (connect(remote_socket, reinterpret_cast<SOCKADDR*>(&sa_service), sizeof(sa_service)) ==
-                    SOCKET_ERROR)
+                if (const auto error = WSAGetLastError(); error != ERROR_IO_PENDING)
                 {
-                    if (const auto error = WSAGetLastError(); error != WSAEWOULDBLOCK)
-                    {
-                        NETLIB_WARNING("connect_to_remote_host: IPv4 connect failed: {}", error);
-                        shutdown(remote_socket, SD_BOTH);
-                        closesocket(remote_socket);
-                        return false;
-                    }
-                    NETLIB_DEBUG("connect_to_remote_host: IPv4 connection in progress (WSAEWOULDBLOCK)");
-                }
-                else
-                {
-                    NETLIB_DEBUG("connect_to_remote_host: IPv4 connection completed immediately");
-                }
-            }
-            else
-            {
-                sockaddr_in6 sa_service{};
-                sa_service.sin6_family = address_type_t::af_type;
-                sa_service.sin6_addr = remote_ip;
-                sa_service.sin6_port = htons(remote_port);
+                    NETLIB_WARNING("connect_to_remote_host: ConnectEx failed: {}", error);
 
-                if (connect(remote_socket, reinterpret_cast<SOCKADDR*>(&sa_service), sizeof(sa_service)) ==
-                    SOCKET_ERROR)
-                {
-                    if (const auto error = WSAGetLastError(); error != WSAEWOULDBLOCK)
-                    {
-                        NETLIB_WARNING("connect_to_remote_host: IPv6 connect failed: {}", error);
-                        shutdown(remote_socket, SD_BOTH);
-                        closesocket(remote_socket);
-                        return false;
-                    }
-                    else
-                    {
-                        NETLIB_DEBUG("connect_to_remote_host: IPv6 connection in progress (WSAEWOULDBLOCK)");
-                    }
-                }
-                else
-                {
-                    NETLIB_DEBUG("connect_to_remote_host: IPv6 connection completed immediately");
+                    // No completion will be queued; the caller still owns (and closes) the accepted socket
+                    std::scoped_lock lock(lock_);
+                    connect_contexts_.erase(connect_context);
+                    shutdown(remote_socket, SD_BOTH);
+                    closesocket(remote_socket);
+                    return false;
                 }
             }
 
@@ -850,279 +1149,243 @@ namespace proxy
         }
 
         /**
-         * @brief Main thread routine for accepting and dispatching incoming client connections.
+         * @brief Handles a completed overlapped connect to a remote host.
          *
-         * This method runs in a dedicated thread and continuously accepts new TCP client connections
-         * on the server's listening socket as long as the server is running. For each accepted connection:
-         * - If the server is shutting down or the accept fails, the loop exits.
-         * - Attempts to establish a connection to the corresponding remote host using connect_to_remote_host().
-         * - If the remote connection setup fails, the accepted client socket is closed immediately.
+         * On success, starts the session (see start_session()). On failure, both sockets are closed.
          *
-         * The thread terminates when the server is stopped or a fatal error occurs on accept.
+         * @param context The connect context.
+         * @param status  Completion status of the connect.
          */
-        void start_proxy_thread()
+        void process_connect_complete(pending_connection* context, const BOOL status)
         {
-            while (end_server_ == false)
+            std::unique_ptr<pending_connection> owned;
+
             {
-                //
-                // loop accepting connections from clients until proxy shuts down
-                //
-                const auto accepted = WSAAccept(server_socket_, nullptr, nullptr, nullptr, 0);
+                std::scoped_lock lock(lock_);
 
-                if (accepted == static_cast<SOCKET>(INVALID_SOCKET) || end_server_)
-                {
-                    break;
-                }
+                const auto it = connect_contexts_.find(context);
+                if (it == connect_contexts_.end())
+                    return;
 
-                if (sock_array_events_.size() >= connections_array_size) {
-                    NETLIB_WARNING("Too many pending connections, rejecting new client.");
-                    closesocket(accepted);
-                    continue;
-                }
+                owned = std::move(it->second);
+                connect_contexts_.erase(it);
+            }
 
-                if (const auto connected = connect_to_remote_host(accepted); !connected)
-                {
-                    closesocket(accepted);
-                }
+            // Take the sockets over from the context - we own the resources now
+            const auto local_socket = std::exchange(owned->local_socket, INVALID_SOCKET);
+            const auto remote_socket = std::exchange(owned->remote_socket, INVALID_SOCKET);
+
+            if (!status ||
+                setsockopt(remote_socket, SOL_SOCKET, SO_UPDATE_CONNECT_CONTEXT, nullptr, 0) == SOCKET_ERROR)
+            {
+                NETLIB_DEBUG("process_connect_complete: Connection to the remote host failed: {}", GetLastError());
+                shutdown(local_socket, SD_BOTH);
+                closesocket(local_socket);
+                closesocket(remote_socket);
+                return;
             }
+
+            start_session(owned->shard, local_socket, remote_socket, std::move(owned->negotiate_ctx), false);
         }
 
         /**
-         * @brief Thread routine for handling asynchronous connections to remote hosts.
+         * @brief Constructs the proxy socket instance for a session, registers it and starts it.
          *
-         * This method runs in a dedicated thread and manages the completion of non-blocking connect operations
-         * for remote sockets. It operates as follows:
-         * - Continuously builds a list of WSAEVENT handles corresponding to pending remote connection attempts.
-         * - Waits for any of these events to be signaled, indicating a completed connection attempt.
-         * - If a connection event (other than the first) is signaled, finalizes the session:
-         *   - Closes the event handle.
-         *   - Constructs a new proxy socket instance for the completed connection, associates it with the I/O completion port,
-         *     and starts the proxy session.
-         *   - Removes the processed entry from the tracking array.
-         * - If the first event is signaled, resets it and continues.
-         * - On server shutdown, cleans up all remaining events and sockets in the tracking array.
+         * Both sockets must already be connected and associated with the session's completion port
+         * shard. The sockets are owned by this method: they are closed if the session can't be started.
          *
-         * Thread safety is ensured via shared and exclusive locks as needed.
-         * The thread exits when the server is stopped.
+         * @param shard             The completion port shard of the session.
+         * @param local_socket      The accepted client socket.
+         * @param remote_socket     The socket connected to the remote peer.
+         * @param negotiate_ctx     Negotiation context for the session.
+         * @param pre_authenticated True if remote_socket was claimed from the connection pool.
          */
-        void connect_to_remote_host_thread()
+        void start_session(const size_t shard, const SOCKET local_socket, const SOCKET remote_socket,
+            std::unique_ptr<negotiate_context_t> negotiate_ctx, [[maybe_unused]] const bool pre_authenticated)
         {
-            std::vector<WSAEVENT> wait_events;
-            wait_events.reserve(connections_array_size);
+            std::shared_ptr<T> socket;
 
-            while (end_server_ == false)
+            try
             {
-                // initialize wait events array
-                wait_events.clear();
-
-                {
-                    std::shared_lock lock(lock_);
-
-                    std::transform(sock_array_events_.cbegin(), sock_array_events_.cend(),
-                        std::back_inserter(wait_events), [](auto&& e)
-                        {
-                            return std::get<0>(e);
-                        });
-                }
-
-                const auto event_index = wait_for_multiple_objects(static_cast<DWORD>(wait_events.size()),
-                    wait_events.data(), INFINITE);
-
-                if (end_server_ == true)
-                    break;
-
-                if (event_index != 0)
-                {
-                    std::scoped_lock lock(lock_);
-
-                    WSACloseEvent(wait_events[event_index]);
-
-                    // Extract socket handles before creating the shared_ptr
-                    // so we can clean them up if initialization fails
-                    auto local_socket = std::get<1>(sock_array_events_[event_index]);
-                    auto remote_socket = std::get<2>(sock_array_events_[event_index]);
-                    auto negotiate_ctx = std::move(std::get<3>(sock_array_events_[event_index]));
-
-                    // Remove from tracking array first - we own the resources now
-                    sock_array_events_.erase(sock_array_events_.begin() + event_index);
-
-                    try
-                    {
-                        // Create socket as shared_ptr
-                        auto socket = std::make_shared<T>(
-                            local_socket,
-                            remote_socket,
-                            std::move(negotiate_ctx),
-                            logger::log_level_, logger::log_stream_);
-
-                        // Initialize I/O contexts - can throw std::bad_weak_ptr or std::runtime_error
-                        socket->initialize_io_contexts();
-
-                        // Associate with completion port
-                        socket->associate_to_completion_port(completion_key_, completion_port_);
-
-                        // Start the socket
-                        socket->start();
-
-                        // Store in vector - socket is now fully initialized
-                        proxy_sockets_.push_back(std::move(socket));
-                    }
-                    catch (const std::exception& e)
-                    {
-                        // Initialization failed - clean up sockets manually since they weren't
-                        // transferred to a successfully initialized proxy socket
-                        NETLIB_ERROR("connect_to_remote_host_thread: Failed to initialize proxy socket: {}", e.what());
-
-                        if (local_socket != INVALID_SOCKET)
-                        {
-                            shutdown(local_socket, SD_BOTH);
-                            closesocket(local_socket);
-                        }
+                // Create socket as shared_ptr, in the memory of the shard's NUMA node (relay buffers
+                // are allocated separately from relay_buffer_pool)
+                socket = completion_ports_.make_shared<T>(
+                    shard,
+                    local_socket,
+                    remote_socket,
+                    std::move(negotiate_ctx),
+                    logger::log_level_, logger::log_stream_);
+            }
+            catch (const std::exception& e)
+            {
+                // The sockets weren't transferred to a proxy socket - clean them up manually
+                NETLIB_ERROR("start_session: Failed to create proxy socket: {}", e.what());
+                shutdown(local_socket, SD_BOTH);
+                closesocket(local_socket);
+                closesocket(remote_socket);
+                return;
+            }
 
-                        if (remote_socket != INVALID_SOCKET)
-                        {
-                            shutdown(remote_socket, SD_BOTH);
-                            closesocket(remote_socket);
-                        }
-                        // Continue processing other connections
-                    }
-                    catch (...)
-                    {
-                        NETLIB_ERROR("connect_to_remote_host_thread: Unknown exception during proxy socket initialization");
+            try
+            {
+                // Initialize I/O contexts - can throw std::bad_weak_ptr or std::runtime_error
+                socket->initialize_io_contexts();
 
-                        if (local_socket != INVALID_SOCKET)
-                        {
-                            shutdown(local_socket, SD_BOTH);
-                            closesocket(local_socket);
-                        }
+                // Both sockets were associated with the completion port before accept/connect
+                socket->set_established();
 
-                        if (remote_socket != INVALID_SOCKET)
-                        {
-                            shutdown(remote_socket, SD_BOTH);
-                            closesocket(remote_socket);
-                        }
-                        // Continue processing other connections
-                    }
-                }
-                else
+                if constexpr (requires (T& session) { session.set_pre_authenticated(); })
                 {
-                    WSAResetEvent(wait_events[event_index]);
+                    if (pre_authenticated)
+                        socket->set_pre_authenticated();
                 }
-            }
-
-            // cleanup on exit
-            std::shared_lock lock(lock_);
 
-            for (auto&& a : sock_array_events_)
-            {
-                if (std::get<0>(a) != INVALID_HANDLE_VALUE)
+                if (fast_relay_)
                 {
-                    WSACloseEvent(std::get<0>(a));
+                    socket->enable_fast_relay(completion_ports_.port(shard), completion_keys_[shard]);
                 }
 
-                if (std::get<1>(a) != INVALID_SOCKET)
+                // Register the session before starting it, so that it is reaped even if it closes right away
+                socket->set_close_handler([this, session = std::weak_ptr<T>(socket)]
                 {
-                    shutdown(std::get<1>(a), SD_BOTH);
-                    closesocket(std::get<1>(a));
-                    std::get<1>(a) = INVALID_SOCKET;
-                }
+                    queue_removal(session);
+                });
 
-                if (std::get<2>(a) != INVALID_SOCKET)
                 {
-                    shutdown(std::get<2>(a), SD_BOTH);
-                    closesocket(std::get<2>(a));
-                    std::get<2>(a) = INVALID_SOCKET;
+                    std::scoped_lock lock(lock_);
+                    proxy_sockets_.try_emplace(socket.get(), socket);
+                    idle_timers_.schedule(socket.get(), std::chrono::steady_clock::now() + T::idle_timeout);
                 }
+
+                // Start the socket
+                socket->start();
+                socket->process_inline_completions();
+            }
+            catch (const std::exception& e)
+            {
+                // The proxy socket owns both sockets now and closes them when released
+                NETLIB_ERROR("start_session: Failed to initialize proxy socket: {}", e.what());
+
+                std::scoped_lock lock(lock_);
+                idle_timers_.cancel(socket.get());
+                proxy_sockets_.erase(socket.get());
             }
         }
 
         /**
-         * @brief Thread routine for cleaning up closed or idle proxy sessions.
+         * @brief Queues a session that has closed both sockets for removal by the cleanup thread.
+         *
+         * Called from the session's close handler, under the session lock.
          *
-         * This method runs in a dedicated thread and periodically scans the list of active proxy socket
-         * instances. It removes any sockets that are ready for removal (e.g., closed or idle sessions)
-         * from the internal proxy_sockets_ vector. The cleanup operation is protected by a lock to ensure
-         * thread safety. The thread sleeps for 1 second between cleanup cycles and exits when the server
-         * is stopped.
+         * @param session The closed session.
          */
-        void clear_thread()
+        void queue_removal(std::weak_ptr<T> session) noexcept
         {
-            while (end_server_ == false)
+            try
             {
-                {
-                    std::scoped_lock lock(lock_);
-
-                    proxy_sockets_.erase(std::remove_if(proxy_sockets_.begin(), proxy_sockets_.end(), [](auto&& a)
-                        {
-                            return a->is_ready_for_removal();
-                        }), proxy_sockets_.end());
-                }
-
-                using namespace std::chrono_literals;
-                std::this_thread::sleep_for(1000ms);
+                std::scoped_lock lock(closed_lock_);
+                closed_sessions_.push_back(std::move(session));
+            }
+            catch (const std::bad_alloc&)
+            {
+                // The session is still reaped when its idle timer expires
+                return;
             }
+
+            closed_signal_.notify_one();
         }
 
         /**
-         * @brief Waits for one or more objects (such as threads or events) to become signaled.
+         * @brief Removes a session from the table and the idle timers.
          *
-         * This static utility function provides a scalable way to wait for multiple synchronization objects,
-         * such as thread or event handles, to become signaled. If the number of handles exceeds the platform's
-         * MAXIMUM_WAIT_OBJECTS, the function recursively splits the array and waits on subsets, using a randomized
-         * order to avoid starvation. For a manageable number of handles, it delegates to the native
-         * ::WaitForMultipleObjects API.
+         * Must be called with lock_ held exclusively.
          *
-         * @param count   The number of handles in the array.
-         * @param handles Pointer to an array of HANDLEs to wait on.
-         * @param ms      The maximum time to wait, in milliseconds. Use INFINITE for no timeout.
-         * @return WAIT_OBJECT_0 + index of the signaled handle if successful, WAIT_TIMEOUT if the wait timed out.
+         * @param session  The session to remove.
+         * @param released Receives the table's reference, so that the session is destroyed after lock_ is released.
          */
-        static DWORD wait_for_multiple_objects(const DWORD count, const HANDLE* handles, const DWORD ms)
+        void release_session(T* const session, std::vector<std::shared_ptr<T>>& released)
         {
-            // Thread local seed for rand_r
-            thread_local auto seed = static_cast<uint32_t>(time(nullptr));
+            const auto it = proxy_sockets_.find(session);
+            if (it == proxy_sockets_.end())
+                return;
+
+            idle_timers_.cancel(session);
+            released.push_back(std::move(it->second));
+            proxy_sockets_.erase(it);
+        }
 
-            // Initial result set to timeout
-            DWORD result = WAIT_TIMEOUT;
+        /**
+         * @brief Thread routine for cleaning up closed or idle proxy sessions.
+         *
+         * Sessions report themselves through queue_removal() once both of their sockets are closed,
+         * and are removed as soon as the thread wakes up. Sessions left open are tracked by a timing
+         * wheel instead of being scanned: when a session's idle timer expires, the session is checked
+         * (which closes it if it has really been idle for T::idle_timeout) and otherwise rescheduled
+         * from its last activity. The cost of a pass is thus proportional to the number of sessions
+         * closed or expired, not to the number of sessions. Removed sessions are destroyed after
+         * lock_ is released. Every pass also retries the accepts that could not be posted, so the
+         * accept backlog recovers. The thread exits when the server is stopped.
+         */
+        void clear_thread()
+        {
+            std::vector<std::weak_ptr<T>> closed;
+            std::vector<std::shared_ptr<T>> released;
 
-            // If the number of objects is greater than the maximum allowed...
-            if (count >= MAXIMUM_WAIT_OBJECTS)
+            while (end_server_ == false)
             {
-                // Loop until a handle is signaled or until the timeout is reached if timeout is infinite
-                do
                 {
-                    // Divide the number of handles in half
-                    const DWORD split = count / 2;
+                    std::unique_lock lock(closed_lock_);
+                    closed_signal_.wait_for(lock, idle_timer_tick, [this]
+                    {
+                        return !closed_sessions_.empty() || end_server_;
+                    });
+
+                    closed.swap(closed_sessions_);
+
+                    // stop() sets end_server_ under this lock before it closes the listening socket
+                    if (!end_server_)
+                    {
+                        std::erase_if(unposted_accepts_, [this](pending_connection* const context)
+                        {
+                            return post_accept(context);
+                        });
+                    }
+                }
+
+                try
+                {
+                    std::scoped_lock lock(lock_);
 
-                    // Divide the wait time in half, if timeout is infinite, use a default wait time of 2000ms
-                    const DWORD wait = (ms == INFINITE ? 2000 : ms) / 2;
-                    const int random = rand_s(&seed);
+                    for (const auto& weak : closed)
+                    {
+                        if (const auto session = weak.lock())
+                            release_session(session.get(), released);
+                    }
 
-                    // Recurse on both halves in a random order until a handle is signaled or all handles are checked
-                    for (short branch = 0; branch < 2 && result == WAIT_TIMEOUT; branch++)
+                    idle_timers_.advance(std::chrono::steady_clock::now(), [this, &released](T* const session)
                     {
-                        if (random % 2 == branch)
+                        const auto it = proxy_sockets_.find(session);
+                        if (it == proxy_sockets_.end())
+                            return;
+
+                        if (it->second->is_ready_for_removal())
                         {
-                            // Wait for the lower half of handles
-                            result = wait_for_multiple_objects(split, handles, wait);
+                            release_session(session, released);
                         }
                         else
                         {
-                            // Wait for the upper half of handles, adjust result if a handle is signaled
-                            result = wait_for_multiple_objects(count - split, handles + split, wait);
-                            if (result >= WAIT_OBJECT_0 && result < WAIT_OBJECT_0 + split) result += split;
+                            idle_timers_.schedule(session, it->second->idle_deadline());
                         }
-                    }
-                } while (ms == INFINITE && result == WAIT_TIMEOUT);
-            }
-            else
-            {
-                // If the number of handles is within limit, use the native win32 function
-                result = ::WaitForMultipleObjects(count, handles, FALSE, ms);
-            }
+                    });
+                }
+                catch (const std::bad_alloc&)
+                {
+                    NETLIB_ERROR("clear_thread: Out of memory while reaping sessions");
+                }
 
-            // Return the result
-            return result;
+                closed.clear();
+                released.clear();
+            }
         }
     };
 }
@@ -147,13 +147,25 @@ namespace proxy
 
     protected:
         /**
-         * @brief Size (in bytes) of the internal send/receive buffers for relaying data.
+         * @brief Maximum size (in bytes) of the internal send/receive buffers for relaying data.
          *
-         * This constant defines the buffer size used for both directions of data transfer
-         * between the local and remote sockets.
+         * Sessions start with the smallest relay_buffer_pool tier in each direction and grow
+         * towards this size only while the direction carries bulk data.
          */
-        constexpr static size_t send_receive_buffer_size = 65536;
+        constexpr static size_t send_receive_buffer_size = relay_buffer_pool::max_buffer_size;
 
+        /**
+         * @brief Inactivity period after which the relay buffers shrink back to the smallest tier.
+         */
+        constexpr static std::chrono::seconds buffer_shrink_idle_time{ 5 };
+
+    public:
+        /**
+         * @brief Inactivity period after which an open session is considered abandoned and closed.
+         */
+        constexpr static std::chrono::hours idle_timeout{ 1 };
+
+    protected:
         /**
          * @brief Socket handle for the locally connected client.
          *
@@ -177,27 +189,81 @@ namespace proxy
         std::unique_ptr<negotiate_context_t> negotiate_ctx_;
 
         /**
-         * @brief Mutex for synchronizing access to I/O operations and state.
+         * @brief Relay state shared by the two completions of one relay direction.
+         *
+         * A direction is the receive on one socket and the send on the other one. Its lock serializes
+         * these two completions and protects the direction's ring buffer and WSABUFs, so that uploads
+         * and downloads of the same session are processed concurrently. The socket handles and the
+         * connection status are only modified with both direction locks held (always acquired together
+         * through std::scoped_lock), so either direction lock is enough to read them.
+         */
+        struct relay_direction
+        {
+            /**
+             * @brief Serializes the completions of the direction.
+             */
+            std::mutex lock;
+
+            /**
+             * @brief Relay operations of the direction that completed immediately, waiting for
+             *        process_inline_completions(). The direction has at most two operations outstanding.
+             */
+            std::array<std::pair<per_io_context_t*, DWORD>, 2> inline_completions{};
+
+            /**
+             * @brief Number of valid entries in inline_completions.
+             */
+            size_t inline_completion_count{ 0 };
+        };
+
+        /**
+         * @brief Socket closure requested by a relay completion, performed once its direction lock is released.
          *
-         * Ensures thread-safe access to socket state and buffers.
+         * Closing takes both direction locks, which a completion holding one of them cannot acquire
+         * without risking a lock-order inversion with the other direction.
          */
-        std::mutex lock_;
+        struct pending_close
+        {
+            bool requested{ false };
+            bool is_receive{ false };
+            bool is_local{ false };
+
+            void request(const bool receive, const bool local) noexcept
+            {
+                if (!requested)
+                {
+                    requested = true;
+                    is_receive = receive;
+                    is_local = local;
+                }
+            }
+        };
+
+        /**
+         * @brief Relay state of the local to remote direction (local receive, remote send).
+         */
+        relay_direction local_to_remote_;
+
+        /**
+         * @brief Relay state of the remote to local direction (remote receive, local send).
+         */
+        relay_direction remote_to_local_;
 
         /**
          * @brief Buffer for data relayed from the local client to the remote server.
          */
-        std::array<char, send_receive_buffer_size> from_local_to_remote_buffer_{};
+        relay_buffer from_local_to_remote_buffer_;
 
         /**
          * @brief Buffer for data relayed from the remote server to the local client.
          */
-        std::array<char, send_receive_buffer_size> from_remote_to_local_buffer_{};
+        relay_buffer from_remote_to_local_buffer_;
 
         /**
          * @brief WSABUF structure for receiving data from the local client.
          */
         WSABUF local_recv_buf_{
-            static_cast<ULONG>(send_receive_buffer_size), from_local_to_remote_buffer_.data()
+            from_local_to_remote_buffer_.size(), from_local_to_remote_buffer_.data()
         };
 
         /**
@@ -209,7 +275,7 @@ namespace proxy
          * @brief WSABUF structure for receiving data from the remote server.
          */
         WSABUF remote_recv_buf_{
-            static_cast<ULONG>(send_receive_buffer_size), from_remote_to_local_buffer_.data()
+            from_remote_to_local_buffer_.size(), from_remote_to_local_buffer_.data()
         };
 
         /**
@@ -222,7 +288,14 @@ namespace proxy
          *
          * Used for idle timeout and session cleanup logic.
          */
-        std::chrono::steady_clock::time_point timestamp_{ std::chrono::steady_clock::now() };
+        std::atomic<std::chrono::steady_clock::time_point> timestamp_{ std::chrono::steady_clock::now() };
+
+        /**
+         * @brief Called once, under both direction locks, when both sockets of the session have been closed.
+         *
+         * Lets the owner reap the session without polling it. Must not call back into the session.
+         */
+        std::function<void()> close_handler_;
 
         /**
          * @brief Per-I/O context for receiving data from the local client.
@@ -258,6 +331,33 @@ namespace proxy
          */
         connection_status connection_status_{ connection_status::client_connected };
 
+        /**
+         * @brief Maximum number of immediately completed relay operations processed per process_inline_completions() call.
+         *
+         * The rest is requeued to the completion port so that a single bulk session cannot monopolize a worker thread.
+         */
+        constexpr static size_t max_inline_completions = 16;
+
+        /**
+         * @brief Completion port the session's sockets are associated with (fast relay mode only).
+         */
+        HANDLE fast_relay_port_{ nullptr };
+
+        /**
+         * @brief Completion key of the session's sockets (fast relay mode only).
+         */
+        ULONG_PTR fast_relay_key_{ 0 };
+
+        /**
+         * @brief True if operations on the local socket that complete immediately skip the completion port.
+         */
+        bool skip_local_completion_{ false };
+
+        /**
+         * @brief True if operations on the remote socket that complete immediately skip the completion port.
+         */
+        bool skip_remote_completion_{ false };
+
     public:
         /**
          * @brief Constructs a tcp_proxy_socket instance for a proxied TCP session.
@@ -296,7 +396,7 @@ namespace proxy
          */
         virtual ~tcp_proxy_socket()
         {
-            std::scoped_lock lock(lock_);
+            std::scoped_lock lock(local_to_remote_.lock, remote_to_local_.lock);
 
             NETLIB_DEBUG("~tcp_proxy_socket: Starting destructor cleanup");
 
@@ -512,6 +612,103 @@ namespace proxy
             return true;
         }
 
+        /**
+         * @brief Marks the session as established when both sockets were associated with the I/O
+         * completion port before the session object was created (overlapped accept and connect).
+         *
+         * Used instead of associate_to_completion_port(), as a socket can be associated only once.
+         */
+        void set_established() noexcept
+        {
+            connection_status_ = connection_status::client_established;
+        }
+
+        /**
+         * @brief Requests the fast relay mode for the data relay phase of the session.
+         *
+         * When the data relay starts, both sockets are switched to FILE_SKIP_COMPLETION_PORT_ON_SUCCESS:
+         * a relay receive or send that completes immediately (data already buffered by the transport,
+         * typical for bulk transfers) is processed by process_inline_completions() on the calling thread
+         * instead of round-tripping through the completion port. Negotiation I/O is not affected, as the
+         * mode is switched on only after negotiation is done.
+         *
+         * @param completion_port  Completion port both sockets are associated with.
+         * @param completion_key   Completion key of both sockets (used to requeue excess inline completions).
+         *
+         * @note Must be called before start(). The caller must call process_inline_completions() after
+         *       each completion it dispatches to this session and after start().
+         */
+        void enable_fast_relay(const netlib::winsys::io_completion_port& completion_port, const ULONG_PTR completion_key) noexcept
+        {
+            fast_relay_port_ = static_cast<HANDLE>(completion_port);
+            fast_relay_key_ = completion_key;
+        }
+
+        /**
+         * @brief Processes relay operations that completed immediately in fast relay mode.
+         *
+         * Each operation is dispatched exactly as the completion port would have dispatched it: a zero-byte
+         * receive closes the receiving side, anything else goes to process_receive_buffer_complete() or
+         * process_send_buffer_complete(), which may complete further operations inline. After
+         * max_inline_completions operations the remaining ones are requeued to the completion port.
+         *
+         * @note Must be called without holding a direction lock. Does nothing if fast relay mode is off.
+         */
+        void process_inline_completions()
+        {
+            for (size_t processed = 0;; ++processed)
+            {
+                per_io_context_t* io_context = nullptr;
+                DWORD io_size = 0;
+
+                for (auto* direction : { &local_to_remote_, &remote_to_local_ })
+                {
+                    std::scoped_lock lock(direction->lock);
+
+                    if (direction->inline_completion_count == 0)
+                        continue;
+
+                    if (processed == max_inline_completions)
+                    {
+                        NETLIB_DEBUG("process_inline_completions: Requeuing {} inline completions to the completion port",
+                            direction->inline_completion_count);
+
+                        for (size_t i = 0; i < direction->inline_completion_count; ++i)
+                        {
+                            const auto& [context, bytes] = direction->inline_completions[i];
+
+                            if (!PostQueuedCompletionStatus(fast_relay_port_, bytes, fast_relay_key_, context))
+                            {
+                                NETLIB_ERROR("process_inline_completions: PostQueuedCompletionStatus failed: {}", GetLastError());
+                            }
+                        }
+
+                        direction->inline_completion_count = 0;
+                        continue;
+                    }
+
+                    std::tie(io_context, io_size) = direction->inline_completions[--direction->inline_completion_count];
+                    break;
+                }
+
+                if (io_context == nullptr)
+                    return;
+
+                if ((io_size == 0) && (io_context->io_operation == proxy_io_operation::relay_io_read))
+                {
+                    close_client(true, io_context->is_local);
+                }
+                else if (io_context->io_operation == proxy_io_operation::relay_io_read)
+                {
+                    process_receive_buffer_complete(io_size, io_context);
+                }
+                else
+                {
+                    process_send_buffer_complete(io_size, io_context);
+                }
+            }
+        }
+
         /**
          * @brief Closes the local or remote client socket and updates session state.
          *
@@ -520,21 +717,22 @@ namespace proxy
          * length to zero, based on whether the operation is for a receive or send path. If both sockets
          * are closed, the session is considered complete and ready for cleanup.
          *
-         * Thread safety is ensured by acquiring a lock, unless AlreadyLocked is set to true, in which case
-         * the caller is responsible for holding the lock.
+         * Thread safety is ensured by acquiring both direction locks, unless AlreadyLocked is set to true,
+         * in which case the caller is responsible for holding them.
          *
-         * @tparam AlreadyLocked  If true, assumes the caller already holds the lock; otherwise, acquires it internally.
+         * @tparam AlreadyLocked  If true, assumes the caller already holds both direction locks; otherwise, acquires them internally.
          * @param is_receive      If true, resets the receive buffer length; otherwise, resets the send buffer length.
          * @param is_local        If true, closes the local socket; otherwise, closes the remote socket.
          */
         template <bool AlreadyLocked = false>
         void close_client(const bool is_receive, const bool is_local)
         {
-            std::unique_lock lock(lock_, std::defer_lock);
+            std::unique_lock local_to_remote_lock(local_to_remote_.lock, std::defer_lock);
+            std::unique_lock remote_to_local_lock(remote_to_local_.lock, std::defer_lock);
 
             if constexpr (!AlreadyLocked)
             {
-                lock.lock();
+                std::lock(local_to_remote_lock, remote_to_local_lock);
             }
 
             NETLIB_DEBUG("close_client: Starting cleanup (is_receive: {}, is_local: {})",
@@ -729,6 +927,34 @@ namespace proxy
 
             NETLIB_DEBUG("close_client: Cleanup completed (is_receive: {}, is_local: {})",
                 is_receive, is_local);
+
+            if (close_handler_ && local_socket_ == static_cast<SOCKET>(INVALID_SOCKET) &&
+                remote_socket_ == static_cast<SOCKET>(INVALID_SOCKET))
+            {
+                NETLIB_DEBUG("close_client: Both sockets are closed, notifying the owner");
+                std::exchange(close_handler_, nullptr)();
+            }
+        }
+
+        /**
+         * @brief Sets the handler called once both sockets of the session have been closed.
+         *
+         * The handler runs under both direction locks, from whichever thread closes the second socket.
+         *
+         * @param handler Notification handler; must not call back into the session.
+         */
+        void set_close_handler(std::function<void()> handler)
+        {
+            std::scoped_lock lock(local_to_remote_.lock, remote_to_local_.lock);
+            close_handler_ = std::move(handler);
+        }
+
+        /**
+         * @brief Returns the time at which the session becomes idle for longer than idle_timeout.
+         */
+        [[nodiscard]] std::chrono::steady_clock::time_point idle_deadline() const noexcept
+        {
+            return timestamp_.load(std::memory_order_relaxed) + idle_timeout;
         }
 
         /**
@@ -743,12 +969,12 @@ namespace proxy
          * Modern web applications (WebSockets, Server-Sent Events, long-polling) can legitimately remain
          * idle for extended periods, so the timeout serves only as a safety net for abandoned connections.
          *
-         * Thread safety is ensured by acquiring a lock on the session state.
+         * Thread safety is ensured by acquiring both direction locks.
          *
          * @return true if the session is fully closed and all buffers are empty (ready for removal),
          *         false otherwise.
          *
-         * @note This method may be called periodically by a cleanup thread to manage session lifetimes.
+         * @note This method is called by the owner when the session's idle timer expires.
          *       It is safe to call concurrently with other session operations.
          *       The 1-hour safety timeout prevents memory leaks from truly abandoned connections while
          *       allowing legitimate long-lived connections to function normally.
@@ -757,7 +983,7 @@ namespace proxy
         {
             using namespace std::chrono_literals;
 
-            std::scoped_lock lock(lock_);
+            std::scoped_lock lock(local_to_remote_.lock, remote_to_local_.lock);
 
             NETLIB_DEBUG("is_ready_for_removal: Checking session readiness for removal");
 
@@ -798,13 +1024,13 @@ namespace proxy
             // Only check for extreme timeout as a safety measure (1 hour instead of 2 minutes)
             // This handles truly abandoned connections that somehow didn't get closed properly
             const auto current_time = std::chrono::steady_clock::now();
-            const auto idle_duration = current_time - timestamp_;
+            const auto idle_duration = current_time - timestamp_.load(std::memory_order_relaxed);
             const auto idle_seconds = std::chrono::duration_cast<std::chrono::seconds>(idle_duration).count();
 
             NETLIB_DEBUG("is_ready_for_removal: Session idle time: {} seconds (safety timeout: 3600 seconds)",
                 idle_seconds);
 
-            if (idle_duration > 1h)  // Changed from 120s to 1 hour as safety measure
+            if (idle_duration > idle_timeout)
             {
                 NETLIB_WARNING("is_ready_for_removal: Session has been idle for {} seconds (1 hour), performing safety cleanup", idle_seconds);
 
@@ -840,7 +1066,7 @@ namespace proxy
                     close_client<true>(false, false);
 
                     // Extend timestamp by 1 minute to avoid immediate re-cleanup attempts
-                    timestamp_ += 1min;
+                    timestamp_.store(timestamp_.load(std::memory_order_relaxed) + 1min, std::memory_order_relaxed);
 
                     NETLIB_DEBUG("is_ready_for_removal: Safety closure completed, timestamp extended by 1 minute");
                 }
@@ -972,8 +1198,7 @@ namespace proxy
          */
         virtual void process_receive_negotiate_complete(const uint32_t io_size, per_io_context_t* io_context)
         {
-            std::scoped_lock lock(lock_);
-            timestamp_ = std::chrono::steady_clock::now();
+            timestamp_.store(std::chrono::steady_clock::now(), std::memory_order_relaxed);
         }
 
         /**
@@ -988,8 +1213,7 @@ namespace proxy
          */
         virtual void process_send_negotiate_complete(const uint32_t io_size, per_io_context_t* io_context)
         {
-            std::scoped_lock lock(lock_);
-            timestamp_ = std::chrono::steady_clock::now();
+            timestamp_.store(std::chrono::steady_clock::now(), std::memory_order_relaxed);
         }
 
         /**
@@ -1004,8 +1228,9 @@ namespace proxy
          *   manages cyclic buffer pointers, and initiates further asynchronous receive operations as needed.
          *   If an error occurs during forwarding, the corresponding socket is closed.
          *
-         * The method ensures thread safety by acquiring a lock on the session state.
-         * It also logs debug information about data transfer events.
+         * The method holds the lock of the relay direction the receive belongs to, so it runs concurrently
+         * with the completions of the opposite direction. A socket closure needed on error is performed
+         * after the lock is released. It also logs debug information about data transfer events.
          *
          * @param io_size     The number of bytes received in the operation.
          * @param io_context  Pointer to the per-I/O context structure associated with this operation.
@@ -1016,9 +1241,11 @@ namespace proxy
          */
         virtual void process_receive_buffer_complete(const uint32_t io_size, per_io_context_t* io_context)
         {
-            std::scoped_lock lock(lock_);
+            pending_close close_request;
+            std::unique_lock lock(direction_of(*io_context).lock);
 
-            timestamp_ = std::chrono::steady_clock::now();
+            const auto now = std::chrono::steady_clock::now();
+            const auto idle_duration = now - timestamp_.exchange(now, std::memory_order_relaxed);
 
             NETLIB_DEBUG("process_receive_buffer_complete: Processing {} bytes from {} socket",
                 io_size, io_context->is_local ? "local" : "remote");
@@ -1046,6 +1273,12 @@ namespace proxy
             {
                 NETLIB_DEBUG("process_receive_buffer_complete: Connection established, processing data relay");
 
+                if (negotiate_ctx_ && negotiate_ctx_->metrics)
+                {
+                    (io_context->is_local ? negotiate_ctx_->metrics->bytes_sent : negotiate_ctx_->metrics->bytes_received)
+                        .add(io_size);
+                }
+
                 if (io_context->is_local)
                 {
                     NETLIB_DEBUG("process_receive_buffer_complete: Data received from local socket: {} bytes", io_size);
@@ -1056,25 +1289,21 @@ namespace proxy
                         NETLIB_DEBUG("process_receive_buffer_complete: No remote send in progress, forwarding to remote");
 
                         // if there is no "send to remotely connected socket" in progress
-                        // then forward the received data to remote host
+                        // then the ring holds only the received data and may be resized
+                        resize_relay_buffer(from_local_to_remote_buffer_, local_recv_buf_, io_size, idle_duration);
+
+                        // forward the received data to remote host
                         remote_send_buf_.buf = local_recv_buf_.buf;
                         remote_send_buf_.len = io_size;
 
                         NETLIB_DEBUG("process_receive_buffer_complete: Sending {} bytes to remote socket", io_size);
 
-                        if ((::WSASend(
-                            remote_socket_,
-                            &remote_send_buf_,
-                            1,
-                            nullptr,
-                            0,
-                            &io_context_send_to_remote_,
-                            nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
+                        if (!post_relay_send(remote_socket_, remote_send_buf_, io_context_send_to_remote_))
                         {
                             const auto error = WSAGetLastError();
                             NETLIB_WARNING("process_receive_buffer_complete: WSASend to remote failed: {}", error);
                             // Close connection to remote peer in case of error
-                            close_client<true>(false, false);
+                            close_request.request(false, false);
                         }
                         else
                         {
@@ -1119,21 +1348,12 @@ namespace proxy
                     {
                         NETLIB_DEBUG("process_receive_buffer_complete: Initiating new local receive with buffer size {}", local_recv_buf_.len);
 
-                        DWORD flags = 0;
-
-                        if ((::WSARecv(
-                            local_socket_,
-                            &local_recv_buf_,
-                            1,
-                            nullptr,
-                            &flags,
-                            &io_context_recv_from_local_,
-                            nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
+                        if (!post_relay_recv(local_socket_, local_recv_buf_, io_context_recv_from_local_))
                         {
                             const auto error = WSAGetLastError();
                             NETLIB_WARNING("process_receive_buffer_complete: WSARecv from local failed: {}", error);
                             // Close connection to local peer in case of error
-                            close_client<true>(true, true);
+                            close_request.request(true, true);
                         }
                         else
                         {
@@ -1155,25 +1375,21 @@ namespace proxy
                         NETLIB_DEBUG("process_receive_buffer_complete: No local send in progress, forwarding to local");
 
                         // if there is no "send to locally connected socket" in progress
-                        // then forward the received data to local host
+                        // then the ring holds only the received data and may be resized
+                        resize_relay_buffer(from_remote_to_local_buffer_, remote_recv_buf_, io_size, idle_duration);
+
+                        // forward the received data to local host
                         local_send_buf_.buf = remote_recv_buf_.buf;
                         local_send_buf_.len = io_size;
 
                         NETLIB_DEBUG("process_receive_buffer_complete: Sending {} bytes to local socket", io_size);
 
-                        if ((::WSASend(
-                            local_socket_,
-                            &local_send_buf_,
-                            1,
-                            nullptr,
-                            0,
-                            &io_context_send_to_local_,
-                            nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
+                        if (!post_relay_send(local_socket_, local_send_buf_, io_context_send_to_local_))
                         {
                             const auto error = WSAGetLastError();
                             NETLIB_WARNING("process_receive_buffer_complete: WSASend to local failed: {}", error);
                             // Close connection to local peer in case of error
-                            close_client<true>(false, true);
+                            close_request.request(false, true);
                         }
                         else
                         {
@@ -1219,21 +1435,12 @@ namespace proxy
                     {
                         NETLIB_DEBUG("process_receive_buffer_complete: Initiating new remote receive with buffer size {}", remote_recv_buf_.len);
 
-                        DWORD flags = 0;
-
-                        if ((::WSARecv(
-                            remote_socket_,
-                            &remote_recv_buf_,
-                            1,
-                            nullptr,
-                            &flags,
-                            &io_context_recv_from_remote_,
-                            nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
+                        if (!post_relay_recv(remote_socket_, remote_recv_buf_, io_context_recv_from_remote_))
                         {
                             const auto error = WSAGetLastError();
                             NETLIB_WARNING("process_receive_buffer_complete: WSARecv from remote failed: {}", error);
                             // Close connection to remote peer in case of error
-                            close_client<true>(true, false);
+                            close_request.request(true, false);
                         }
                         else
                         {
@@ -1254,6 +1461,11 @@ namespace proxy
                 break;
             }
 
+            lock.unlock();
+
+            if (close_request.requested)
+                close_client(close_request.is_receive, close_request.is_local);
+
             NETLIB_DEBUG("process_receive_buffer_complete: Completed processing {} bytes from {} socket",
                 io_size, io_context->is_local ? "local" : "remote");
         }
@@ -1275,8 +1487,9 @@ namespace proxy
          *   It also advances the remote send buffer pointer and length, and continues sending if more data is available.
          *   If all data has been sent and the session is completed, it closes the local socket.
          *
-         * The method ensures thread safety by acquiring a lock on the session state and logs debug information
-         * about send completions and subsequent actions.
+         * The method holds the lock of the relay direction the send belongs to, so it runs concurrently with
+         * the completions of the opposite direction; socket closures are performed after the lock is released.
+         * It logs debug information about send completions and subsequent actions.
          *
          * @param io_size     The number of bytes sent in the operation.
          * @param io_context  Pointer to the per-I/O context structure associated with this operation.
@@ -1287,9 +1500,10 @@ namespace proxy
          */
         virtual void process_send_buffer_complete(const uint32_t io_size, per_io_context_t* io_context)
         {
-            std::scoped_lock lock(lock_);
+            pending_close close_request;
+            std::unique_lock lock(direction_of(*io_context).lock);
 
-            timestamp_ = std::chrono::steady_clock::now();
+            timestamp_.store(std::chrono::steady_clock::now(), std::memory_order_relaxed);
 
             NETLIB_DEBUG("process_send_buffer_complete: Processing {} bytes sent to {} socket",
                 io_size, io_context->is_local ? "local" : "remote");
@@ -1306,8 +1520,6 @@ namespace proxy
                     {
                         NETLIB_DEBUG("process_send_buffer_complete: Remote receive buffer empty, setting up new receive");
 
-                        DWORD flags = 0;
-
                         remote_recv_buf_.buf = local_send_buf_.buf;
                         remote_recv_buf_.len = io_size;
 
@@ -1315,18 +1527,11 @@ namespace proxy
                         {
                             NETLIB_DEBUG("process_send_buffer_complete: Initiating remote receive with buffer size {}", remote_recv_buf_.len);
 
-                            if ((::WSARecv(
-                                remote_socket_,
-                                &remote_recv_buf_,
-                                1,
-                                nullptr,
-                                &flags,
-                                &io_context_recv_from_remote_,
-                                nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
+                            if (!post_relay_recv(remote_socket_, remote_recv_buf_, io_context_recv_from_remote_))
                             {
                                 const auto error = WSAGetLastError();
                                 NETLIB_WARNING("process_send_buffer_complete: WSARecv on remote failed: {}", error);
-                                close_client<true>(true, false);
+                                close_request.request(true, false);
                             }
                             else
                             {
@@ -1367,7 +1572,7 @@ namespace proxy
                     if (connection_status_ == connection_status::client_completed)
                     {
                         NETLIB_DEBUG("process_send_buffer_complete: Connection completed, closing remote client");
-                        close_client<true>(false, false);
+                        close_request.request(false, false);
                     }
 
                     local_send_buf_.len = 0;
@@ -1393,18 +1598,11 @@ namespace proxy
                     {
                         NETLIB_DEBUG("process_send_buffer_complete: Continuing send to local socket with {} bytes", local_send_buf_.len);
 
-                        if ((::WSASend(
-                            local_socket_,
-                            &local_send_buf_,
-                            1,
-                            nullptr,
-                            0,
-                            &io_context_send_to_local_,
-                            nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
+                        if (!post_relay_send(local_socket_, local_send_buf_, io_context_send_to_local_))
                         {
                             const auto error = WSAGetLastError();
                             NETLIB_WARNING("process_send_buffer_complete: WSASend to local failed: {}", error);
-                            close_client<true>(false, true);
+                            close_request.request(false, true);
                         }
                         else
                         {
@@ -1429,8 +1627,6 @@ namespace proxy
                     {
                         NETLIB_DEBUG("process_send_buffer_complete: Local receive buffer empty, setting up new receive");
 
-                        DWORD flags = 0;
-
                         local_recv_buf_.buf = remote_send_buf_.buf;
                         local_recv_buf_.len = io_size;
 
@@ -1438,18 +1634,11 @@ namespace proxy
                         {
                             NETLIB_DEBUG("process_send_buffer_complete: Initiating local receive with buffer size {}", local_recv_buf_.len);
 
-                            if ((::WSARecv(
-                                local_socket_,
-                                &local_recv_buf_,
-                                1,
-                                nullptr,
-                                &flags,
-                                &io_context_recv_from_local_,
-                                nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
+                            if (!post_relay_recv(local_socket_, local_recv_buf_, io_context_recv_from_local_))
                             {
                                 const auto error = WSAGetLastError();
                                 NETLIB_WARNING("process_send_buffer_complete: WSARecv on local failed: {}", error);
-                                close_client<true>(true, true);
+                                close_request.request(true, true);
                             }
                             else
                             {
@@ -1490,7 +1679,7 @@ namespace proxy
                     if (connection_status_ == connection_status::client_completed)
                     {
                         NETLIB_DEBUG("process_send_buffer_complete: Connection completed, closing local client");
-                        close_client<true>(false, false);
+                        close_request.request(false, false);
                     }
 
                     remote_send_buf_.len = 0;
@@ -1516,18 +1705,11 @@ namespace proxy
                     {
                         NETLIB_DEBUG("process_send_buffer_complete: Continuing send to remote socket with {} bytes", remote_send_buf_.len);
 
-                        if ((::WSASend(
-                            remote_socket_,
-                            &remote_send_buf_,
-                            1,
-                            nullptr,
-                            0,
-                            &io_context_send_to_remote_,
-                            nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
+                        if (!post_relay_send(remote_socket_, remote_send_buf_, io_context_send_to_remote_))
                         {
                             const auto error = WSAGetLastError();
                             NETLIB_WARNING("process_send_buffer_complete: WSASend to remote failed: {}", error);
-                            close_client<true>(false, false);
+                            close_request.request(false, false);
                         }
                         else
                         {
@@ -1541,6 +1723,11 @@ namespace proxy
                 }
             }
 
+            lock.unlock();
+
+            if (close_request.requested)
+                close_client(close_request.is_receive, close_request.is_local);
+
             NETLIB_DEBUG("process_send_buffer_complete: Completed processing {} bytes sent to {} socket",
                 io_size, io_context->is_local ? "local" : "remote");
         }
@@ -1642,14 +1829,16 @@ namespace proxy
             NETLIB_DEBUG("inject_to_local: Initiating WSASend to local socket {} with {} bytes",
                 static_cast<int>(local_socket_), length);
 
-            if ((::WSASend(
+            const auto result = ::WSASend(
                 local_socket_,
                 &context->wsa_buf,
                 1,
                 nullptr,
                 0,
                 context,
-                nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
+                nullptr);
+
+            if ((result == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
             {
                 const auto error = WSAGetLastError();
                 NETLIB_WARNING("inject_to_local: WSASend failed with error: {}", error);
@@ -1664,6 +1853,14 @@ namespace proxy
             }
 
             NETLIB_DEBUG("inject_to_local: WSASend initiated successfully for {} bytes", length);
+
+            if ((result == 0) && skip_local_completion_)
+            {
+                // Completed immediately and no completion packet will be queued in fast relay mode
+                process_inject_buffer_complete(context);
+                return true;
+            }
+
             NETLIB_DEBUG("inject_to_local: Injection completed, context and buffer will be cleaned up on completion");
 
             return true;
@@ -1745,14 +1942,16 @@ namespace proxy
             NETLIB_DEBUG("inject_to_remote: Initiating WSASend to remote socket {} with {} bytes",
                 static_cast<int>(remote_socket_), length);
 
-            if ((::WSASend(
+            const auto result = ::WSASend(
                 remote_socket_,
                 &context->wsa_buf,
                 1,
                 nullptr,
                 0,
                 context,
-                nullptr) == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
+                nullptr);
+
+            if ((result == SOCKET_ERROR) && (ERROR_IO_PENDING != WSAGetLastError()))
             {
                 const auto error = WSAGetLastError();
                 NETLIB_WARNING("inject_to_remote: WSASend failed with error: {}", error);
@@ -1767,6 +1966,14 @@ namespace proxy
             }
 
             NETLIB_DEBUG("inject_to_remote: WSASend initiated successfully for {} bytes", length);
+
+            if ((result == 0) && skip_remote_completion_)
+            {
+                // Completed immediately and no completion packet will be queued in fast relay mode
+                process_inject_buffer_complete(context);
+                return true;
+            }
+
             NETLIB_DEBUG("inject_to_remote: Injection completed, context and buffer will be cleaned up on completion");
 
             return true;
@@ -1853,15 +2060,21 @@ namespace proxy
         {
             NETLIB_DEBUG("start_data_relay: Starting data relay initialization");
 
-            DWORD flags = 0;
+            enable_completion_skipping();
 
             NETLIB_DEBUG("start_data_relay: Initiating WSARecv on local socket {}",
                 static_cast<int>(local_socket_));
 
-            auto ret = WSARecv(local_socket_, &local_recv_buf_, 1,
-                nullptr, &flags, &io_context_recv_from_local_, nullptr);
+            int wsa_error = 0;
+
+            {
+                std::scoped_lock lock(local_to_remote_.lock);
+
+                if (!post_relay_recv(local_socket_, local_recv_buf_, io_context_recv_from_local_))
+                    wsa_error = WSAGetLastError();
+            }
 
-            if (const auto wsa_error = WSAGetLastError(); ret == SOCKET_ERROR && (ERROR_IO_PENDING != wsa_error))
+            if (wsa_error != 0)
             {
                 NETLIB_WARNING("start_data_relay: WSARecv on local socket failed with error: {}", wsa_error);
                 NETLIB_DEBUG("start_data_relay: Closing local client due to WSARecv failure");
@@ -1872,22 +2085,22 @@ namespace proxy
                 NETLIB_DEBUG("start_data_relay: Data relay initialization failed on local socket");
                 return false;
             }
-            else if (ret == SOCKET_ERROR && wsa_error == ERROR_IO_PENDING)
-            {
-                NETLIB_DEBUG("start_data_relay: Local WSARecv initiated successfully (pending)");
-            }
             else
             {
-                NETLIB_DEBUG("start_data_relay: Local WSARecv completed immediately");
+                NETLIB_DEBUG("start_data_relay: Local WSARecv initiated successfully");
             }
 
             NETLIB_DEBUG("start_data_relay: Initiating WSARecv on remote socket {}",
                 static_cast<int>(remote_socket_));
 
-            ret = WSARecv(remote_socket_, &remote_recv_buf_, 1,
-                nullptr, &flags, &io_context_recv_from_remote_, nullptr);
+            {
+                std::scoped_lock lock(remote_to_local_.lock);
+
+                if (!post_relay_recv(remote_socket_, remote_recv_buf_, io_context_recv_from_remote_))
+                    wsa_error = WSAGetLastError();
+            }
 
-            if (const auto wsa_error = WSAGetLastError(); ret == SOCKET_ERROR && (ERROR_IO_PENDING != wsa_error))
+            if (wsa_error != 0)
             {
                 NETLIB_WARNING("start_data_relay: WSARecv on remote socket failed with error: {}", wsa_error);
                 NETLIB_DEBUG("start_data_relay: Cleaning up local socket due to remote WSARecv failure");
@@ -1925,13 +2138,9 @@ namespace proxy
                 NETLIB_DEBUG("start_data_relay: Data relay initialization failed on remote socket");
                 return false;
             }
-            else if (ret == SOCKET_ERROR && wsa_error == ERROR_IO_PENDING)
-            {
-                NETLIB_DEBUG("start_data_relay: Remote WSARecv initiated successfully (pending)");
-            }
             else
             {
-                NETLIB_DEBUG("start_data_relay: Remote WSARecv completed immediately");
+                NETLIB_DEBUG("start_data_relay: Remote WSARecv initiated successfully");
             }
 
             NETLIB_DEBUG("start_data_relay: Data relay successfully initialized for both sockets (local: {}, remote: {})",
@@ -1939,5 +2148,125 @@ namespace proxy
 
             return true;
         }
+
+    private:
+        /**
+         * @brief Moves a relay direction to another buffer tier while its ring holds only freshly received data.
+         *
+         * Called when a receive completes and no send is in progress for the direction, i.e. no
+         * overlapped operation references the buffer. A receive that filled all the space it was
+         * given marks a bulk flow and moves the buffer to the next tier; a small receive after
+         * buffer_shrink_idle_time of session inactivity returns it to the smallest tier. The
+         * received data is copied to the start of the new buffer and recv_buf is rebased onto it.
+         *
+         * @param buffer         Relay buffer of the direction.
+         * @param recv_buf       WSABUF of the completed receive (its buf points at the received data).
+         * @param io_size        Number of bytes received.
+         * @param idle_duration  Session inactivity period preceding this receive.
+         */
+        void resize_relay_buffer(relay_buffer& buffer, WSABUF& recv_buf, const uint32_t io_size,
+            const std::chrono::steady_clock::duration idle_duration)
+        {
+            uint32_t size = buffer.size();
+
+            if (io_size == recv_buf.len && size < relay_buffer_pool::max_buffer_size)
+            {
+                size = relay_buffer_pool::next_tier(size);
+            }
+            else if (idle_duration > buffer_shrink_idle_time && size > relay_buffer_pool::min_buffer_size &&
+                io_size <= relay_buffer_pool::min_buffer_size)
+            {
+                size = relay_buffer_pool::min_buffer_size;
+            }
+            else
+            {
+                return;
+            }
+
+            if (buffer.resize(size, recv_buf.buf, io_size))
+            {
+                NETLIB_DEBUG("resize_relay_buffer: Relay buffer resized to {} bytes", size);
+                recv_buf.buf = buffer.data();
+            }
+        }
+
+        /**
+         * @brief Switches both sockets to FILE_SKIP_COMPLETION_PORT_ON_SUCCESS if fast relay mode was requested.
+         */
+        void enable_completion_skipping() noexcept
+        {
+            if (fast_relay_port_ == nullptr)
+                return;
+
+            constexpr UCHAR modes = FILE_SKIP_COMPLETION_PORT_ON_SUCCESS | FILE_SKIP_SET_EVENT_ON_HANDLE;
+
+            skip_local_completion_ =
+                SetFileCompletionNotificationModes(reinterpret_cast<HANDLE>(local_socket_), modes) != FALSE;
+            skip_remote_completion_ =
+                SetFileCompletionNotificationModes(reinterpret_cast<HANDLE>(remote_socket_), modes) != FALSE;
+
+            NETLIB_DEBUG("enable_completion_skipping: Fast relay mode - local: {}, remote: {}",
+                skip_local_completion_, skip_remote_completion_);
+        }
+
+        /**
+         * @brief Records a relay operation that completed immediately if its socket skips the completion port.
+         *
+         * @param io_context  Context of the completed operation.
+         * @param io_size     Number of bytes transferred.
+         */
+        void queue_inline_completion(per_io_context_t& io_context, const DWORD io_size) noexcept
+        {
+            if (io_context.is_local ? skip_local_completion_ : skip_remote_completion_)
+            {
+                auto& direction = direction_of(io_context);
+                direction.inline_completions[direction.inline_completion_count++] = { &io_context, io_size };
+            }
+        }
+
+        /**
+         * @brief Returns the relay direction a relay context belongs to.
+         *
+         * Receiving from the local socket and sending to the remote one carry data from local to
+         * remote, the two other relay contexts carry data from remote to local.
+         */
+        relay_direction& direction_of(const per_io_context_t& io_context) noexcept
+        {
+            const auto is_receive = io_context.io_operation == proxy_io_operation::relay_io_read;
+            return io_context.is_local == is_receive ? local_to_remote_ : remote_to_local_;
+        }
+
+        /**
+         * @brief Posts a relay receive. Must be called with the lock of the context's direction held.
+         *
+         * @return false if the operation failed to start (WSAGetLastError() holds the error), true otherwise.
+         */
+        bool post_relay_recv(const SOCKET socket, WSABUF& buffer, per_io_context_t& io_context) noexcept
+        {
+            DWORD io_size = 0;
+            DWORD flags = 0;
+
+            if (::WSARecv(socket, &buffer, 1, &io_size, &flags, &io_context, nullptr) == SOCKET_ERROR)
+                return ERROR_IO_PENDING == WSAGetLastError();
+
+            queue_inline_completion(io_context, io_size);
+            return true;
+        }
+
+        /**
+         * @brief Posts a relay send. Must be called with the lock of the context's direction held.
+         *
+         * @return false if the operation failed to start (WSAGetLastError() holds the error), true otherwise.
+         */
+        bool post_relay_send(const SOCKET socket, WSABUF& buffer, per_io_context_t& io_context) noexcept
+        {
+            DWORD io_size = 0;
+
+            if (::WSASend(socket, &buffer, 1, &io_size, 0, &io_context, nullptr) == SOCKET_ERROR)
+                return ERROR_IO_PENDING == WSAGetLastError();
+
+            queue_inline_completion(io_context, io_size);
+            return true;
+        }
     };
 }
\ No newline at end of file
@@ -0,0 +1,421 @@
+#pragma once
+
+namespace tools::generic
+{
+    /**
+     * @class flat_hash_map
+     * @brief Open-addressing hash map with linear probing and inline key/value storage.
+     *
+     * All entries live in a single contiguous slot array, so a lookup is one hash computation
+     * followed by a short linear scan over adjacent slots instead of a bucket-list walk across
+     * separately allocated nodes. Each slot caches 32 bits of the key hash, which rejects most
+     * mismatching slots without comparing keys. Deletion uses backward shifting, so the table
+     * never accumulates tombstones and probe sequences stay short.
+     *
+     * Unlike std::unordered_map, any insertion or erasure may move other elements: iterators,
+     * pointers and references are invalidated by every modification.
+     *
+     * @tparam Key Key type, must be move constructible.
+     * @tparam Value Mapped type, must be move constructible.
+     * @tparam Hash Hash function object; its output is re-mixed, so weak hashes are acceptable.
+     * @tparam KeyEqual Key equality function object.
+     */
+    template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+    class flat_hash_map
+    {
+    public:
+        using key_type = Key;
+        using mapped_type = Value;
+        using value_type = std::pair<Key, Value>;
+        using size_type = std::size_t;
+
+    private:
+        /**
+         * @struct slot
+         * @brief Table slot, holds a value_type only while occupied.
+         */
+        struct slot
+        {
+            slot() noexcept {}
+            ~slot() {}
+
+            slot(const slot&) = delete;
+            slot& operator=(const slot&) = delete;
+
+            uint32_t hash{ 0 };         ///< Low 32 bits of the mixed key hash.
+            bool occupied{ false };     ///< True if value is constructed.
+            union
+            {
+                value_type value;       ///< Stored key/value pair.
+            };
+        };
+
+        /**
+         * @brief Iterator over the occupied slots.
+         */
+        template <bool Const>
+        class basic_iterator
+        {
+            using slot_pointer = std::conditional_t<Const, const slot*, slot*>;
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = flat_hash_map::value_type;
+            using difference_type = std::ptrdiff_t;
+            using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+            using reference = std::conditional_t<Const, const value_type&, value_type&>;
+
+            basic_iterator() noexcept = default;
+
+            basic_iterator(const slot_pointer current, const slot_pointer last) noexcept
+                : current_(current), last_(last)
+            {
+                skip_empty();
+            }
+
+            template <bool OtherConst, typename = std::enable_if_t<Const && !OtherConst>>
+            basic_iterator(const basic_iterator<OtherConst>& other) noexcept // NOLINT(google-explicit-constructor)
+                : current_(other.current_), last_(other.last_)
+            {
+            }
+
+            reference operator*() const noexcept { return current_->value; }
+            pointer operator->() const noexcept { return &current_->value; }
+
+            basic_iterator& operator++() noexcept
+            {
+                ++current_;
+                skip_empty();
+                return *this;
+            }
+
+            basic_iterator operator++(int) noexcept
+            {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            bool operator==(const basic_iterator& other) const noexcept { return current_ == other.current_; }
+            bool operator!=(const basic_iterator& other) const noexcept { return current_ != other.current_; }
+
+        private:
+            friend class flat_hash_map;
+            template <bool> friend class basic_iterator;
+
+            void skip_empty() noexcept
+            {
+                while (current_ != last_ && !current_->occupied)
+                    ++current_;
+            }
+
+            slot_pointer current_{ nullptr };
+            slot_pointer last_{ nullptr };
+        };
+
+    public:
+        using iterator = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+
+        flat_hash_map() = default;
+
+        flat_hash_map(const flat_hash_map&) = delete;
+        flat_hash_map& operator=(const flat_hash_map&) = delete;
+
+        flat_hash_map(flat_hash_map&& other) noexcept
+            : slots_(std::move(other.slots_)), capacity_(std::exchange(other.capacity_, 0)),
+              size_(std::exchange(other.size_, 0))
+        {
+        }
+
+        flat_hash_map& operator=(flat_hash_map&& other) noexcept
+        {
+            if (this != &other)
+            {
+                clear();
+                slots_ = std::move(other.slots_);
+                capacity_ = std::exchange(other.capacity_, 0);
+                size_ = std::exchange(other.size_, 0);
+            }
+            return *this;
+        }
+
+        ~flat_hash_map()
+        {
+            clear();
+        }
+
+        iterator begin() noexcept { return { slots_.get(), slots_.get() + capacity_ }; }
+        iterator end() noexcept { return { slots_.get() + capacity_, slots_.get() + capacity_ }; }
+        const_iterator begin() const noexcept { return { slots_.get(), slots_.get() + capacity_ }; }
+        const_iterator end() const noexcept { return { slots_.get() + capacity_, slots_.get() + capacity_ }; }
+
+        [[nodiscard]] size_type size() const noexcept { return size_; }
+        [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+        /**
+         * @brief Finds an element by key.
+         * @return Iterator to the element, or end().
+         */
+        iterator find(const Key& key) noexcept
+        {
+            const auto index = find_index(key);
+            return index == npos ? end() : iterator{ slots_.get() + index, slots_.get() + capacity_ };
+        }
+
+        /**
+         * @brief Finds an element by key.
+         * @return Iterator to the element, or end().
+         */
+        const_iterator find(const Key& key) const noexcept
+        {
+            const auto index = find_index(key);
+            return index == npos ? end() : const_iterator{ slots_.get() + index, slots_.get() + capacity_ };
+        }
+
+        /**
+         * @brief Inserts an element constructed from args if the key is not present.
+         * @return Iterator to the element with the key and true if the insertion took place.
+         */
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args)
+        {
+            const auto hash = hash_of(key);
+
+            if (const auto index = find_index(key, hash); index != npos)
+                return { iterator{ slots_.get() + index, slots_.get() + capacity_ }, false };
+
+            reserve(size_ + 1);
+
+            const auto index = free_index(hash);
+            auto& target = slots_[index];
+            std::construct_at(&target.value, std::piecewise_construct, std::forward_as_tuple(key),
+                              std::forward_as_tuple(std::forward<Args>(args)...));
+            target.hash = static_cast<uint32_t>(hash);
+            target.occupied = true;
+            ++size_;
+
+            return { iterator{ slots_.get() + index, slots_.get() + capacity_ }, true };
+        }
+
+        /**
+         * @brief Inserts an element or assigns to the existing one.
+         * @return Iterator to the element and true if the insertion took place.
+         */
+        template <typename M>
+        std::pair<iterator, bool> insert_or_assign(const Key& key, M&& value)
+        {
+            auto result = try_emplace(key, std::forward<M>(value));
+            if (!result.second)
+                result.first->second = std::forward<M>(value);
+            return result;
+        }
+
+        /**
+         * @brief Returns a reference to the value of a key, default constructing it if absent.
+         */
+        Value& operator[](const Key& key)
+        {
+            return try_emplace(key).first->second;
+        }
+
+        /**
+         * @brief Removes the element with the given key.
+         * @return Number of elements removed (0 or 1).
+         */
+        size_type erase(const Key& key) noexcept
+        {
+            const auto index = find_index(key);
+            if (index == npos)
+                return 0;
+
+            erase_index(index);
+            return 1;
+        }
+
+        /**
+         * @brief Removes the element an iterator points to.
+         */
+        void erase(const const_iterator it) noexcept
+        {
+            erase_index(static_cast<size_type>(it.current_ - slots_.get()));
+        }
+
+        /**
+         * @brief Removes all elements satisfying a predicate.
+         * @return Number of elements removed.
+         */
+        template <typename Predicate>
+        size_type erase_if(Predicate predicate)
+        {
+            if (size_ == 0)
+                return 0;
+
+            // Start right after an empty slot: backward shifting never moves an element across an
+            // empty slot, so every element is visited exactly once even when clusters wrap around.
+            size_type start = 0;
+            while (slots_[start].occupied)
+                ++start;
+
+            size_type removed = 0;
+
+            for (size_type step = 1; step <= capacity_; ++step)
+            {
+                const auto index = (start + step) & (capacity_ - 1);
+
+                // Re-examine the slot as long as erasing shifted another element into it
+                while (slots_[index].occupied && predicate(std::as_const(slots_[index].value)))
+                {
+                    erase_index(index);
+                    ++removed;
+                }
+            }
+
+            return removed;
+        }
+
+        /**
+         * @brief Removes all elements, keeping the allocated slots.
+         */
+        void clear() noexcept
+        {
+            for (size_type i = 0; i < capacity_ && size_ != 0; ++i)
+            {
+                if (slots_[i].occupied)
+                {
+                    std::destroy_at(&slots_[i].value);
+                    slots_[i].occupied = false;
+                    --size_;
+                }
+            }
+        }
+
+        /**
+         * @brief Ensures that count elements fit without rehashing.
+         *
+         * Used before bulk insertion so that the table is rehashed at most once.
+         */
+        void reserve(const size_type count)
+        {
+            if (count * max_load_denominator <= capacity_ * max_load_numerator)
+                return;
+
+            auto capacity = std::max<size_type>(capacity_, minimum_capacity);
+            while (count * max_load_denominator > capacity * max_load_numerator)
+                capacity *= 2;
+
+            rehash(capacity);
+        }
+
+    private:
+        static constexpr size_type npos = std::numeric_limits<size_type>::max();
+        static constexpr size_type minimum_capacity = 16;
+        /// Maximum load factor (3/4).
+        static constexpr size_type max_load_numerator = 3;
+        static constexpr size_type max_load_denominator = 4;
+
+        /**
+         * @brief Re-mixes the user hash (64-bit finalizer) so power-of-two masking uses all bits.
+         */
+        static uint64_t hash_of(const Key& key) noexcept
+        {
+            auto hash = static_cast<uint64_t>(Hash{}(key));
+            hash ^= hash >> 33;
+            hash *= 0xff51afd7ed558ccdull;
+            hash ^= hash >> 33;
+            hash *= 0xc4ceb9fe1a85ec53ull;
+            hash ^= hash >> 33;
+            return hash;
+        }
+
+        [[nodiscard]] size_type find_index(const Key& key) const noexcept
+        {
+            return find_index(key, hash_of(key));
+        }
+
+        [[nodiscard]] size_type find_index(const Key& key, const uint64_t hash) const noexcept
+        {
+            if (size_ == 0)
+                return npos;
+
+            const auto fragment = static_cast<uint32_t>(hash);
+
+            for (auto index = static_cast<size_type>(hash) & (capacity_ - 1);; index = (index + 1) & (capacity_ - 1))
+            {
+                const auto& current = slots_[index];
+                if (!current.occupied)
+                    return npos;
+                if (current.hash == fragment && KeyEqual{}(current.value.first, key))
+                    return index;
+            }
+        }
+
+        /**
+         * @brief Returns the first free slot of the probe sequence of a hash. The table must not be full.
+         */
+        [[nodiscard]] size_type free_index(const uint64_t hash) const noexcept
+        {
+            auto index = static_cast<size_type>(hash) & (capacity_ - 1);
+            while (slots_[index].occupied)
+                index = (index + 1) & (capacity_ - 1);
+            return index;
+        }
+
+        /**
+         * @brief Destroys the element at index and shifts the following cluster members back.
+         */
+        void erase_index(size_type index) noexcept
+        {
+            std::destroy_at(&slots_[index].value);
+            slots_[index].occupied = false;
+            --size_;
+
+            for (auto next = (index + 1) & (capacity_ - 1); slots_[next].occupied; next = (next + 1) & (capacity_ - 1))
+            {
+                // An element may move back only if its home slot is not after the hole (cyclically)
+                const auto home = static_cast<size_type>(slots_[next].hash) & (capacity_ - 1);
+                if (((next - home) & (capacity_ - 1)) < ((next - index) & (capacity_ - 1)))
+                    continue;
+
+                move_slot(slots_[next], slots_[index]);
+                index = next;
+            }
+        }
+
+        /**
+         * @brief Moves an occupied slot into an empty one.
+         */
+        static void move_slot(slot& from, slot& to) noexcept
+        {
+            std::construct_at(&to.value, std::move(from.value));
+            to.hash = from.hash;
+            to.occupied = true;
+            std::destroy_at(&from.value);
+            from.occupied = false;
+        }
+
+        void rehash(const size_type capacity)
+        {
+            auto slots = std::make_unique<slot[]>(capacity);
+
+            for (size_type i = 0; i < capacity_; ++i)
+            {
+                if (!slots_[i].occupied)
+                    continue;
+
+                auto index = static_cast<size_type>(slots_[i].hash) & (capacity - 1);
+                while (slots[index].occupied)
+                    index = (index + 1) & (capacity - 1);
+
+                move_slot(slots_[i], slots[index]);
+            }
+
+            slots_ = std::move(slots);
+            capacity_ = capacity;
+        }
+
+        std::unique_ptr<slot[]> slots_;     ///< Slot array of capacity_ entries (power of two).
+        size_type capacity_{ 0 };           ///< Number of slots.
+        size_type size_{ 0 };               ///< Number of occupied slots.
+    };
+}
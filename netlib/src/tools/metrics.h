@@ -0,0 +1,354 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+#include "spsc_ring.h"
+
+namespace tools::metrics
+{
+    /**
+     * @class counter
+     * @brief Monotonic event counter sharded per processor.
+     *
+     * Every processor increments its own cache line, so counters updated for every packet by
+     * several threads do not bounce a shared line between cores. Reading sums the shards and is
+     * meant for occasional snapshots only. The value is exact once the writers are quiescent and
+     * never decreases.
+     */
+    class counter
+    {
+    public:
+        /// Number of shards, a power of two; processors beyond it share shards.
+        static constexpr std::size_t shard_count = 16;
+
+        counter() = default;
+        counter(const counter&) = delete;
+        counter(counter&&) = delete;
+        counter& operator=(const counter&) = delete;
+        counter& operator=(counter&&) = delete;
+        ~counter() = default;
+
+        /**
+         * @brief Adds to the counter.
+         * @param amount Value to add.
+         */
+        void add(const uint64_t amount = 1) noexcept
+        {
+            shards_[current_shard()].value.fetch_add(amount, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Returns the sum of all shards.
+         */
+        [[nodiscard]] uint64_t value() const noexcept
+        {
+            uint64_t total = 0;
+            for (const auto& shard : shards_)
+                total += shard.value.load(std::memory_order_relaxed);
+            return total;
+        }
+
+    private:
+        /**
+         * @brief Returns the shard of the calling thread's processor.
+         */
+        static std::size_t current_shard() noexcept
+        {
+#ifdef _WIN32
+            return GetCurrentProcessorNumber() & (shard_count - 1);
+#else
+            return 0;
+#endif
+        }
+
+        /**
+         * @struct shard
+         * @brief Counter slice owning a whole cache line.
+         */
+        struct alignas(concurrency::cache_line_size) shard
+        {
+            std::atomic<uint64_t> value{ 0 };
+        };
+
+        std::array<shard, shard_count> shards_{};
+    };
+
+    /**
+     * @class latency_histogram
+     * @brief Histogram of durations in power-of-two microsecond buckets.
+     *
+     * Bucket i counts durations below 2^i microseconds (and at least 2^(i-1) for i > 0), the last
+     * bucket also takes everything longer. Recording is two relaxed atomic additions,
+     * cheap enough for per-block or per-handshake measurements; recording per packet should use a
+     * @ref counter instead.
+     */
+    class latency_histogram
+    {
+    public:
+        /// Number of buckets; the last finite bound is 2^(bucket_count - 2) microseconds (about 67 s).
+        static constexpr std::size_t bucket_count = 28;
+
+        /**
+         * @struct snapshot
+         * @brief Copy of the histogram at one point in time.
+         */
+        struct snapshot
+        {
+            std::array<uint64_t, bucket_count> buckets{};  ///< Non-cumulative bucket counts.
+            uint64_t count{ 0 };                            ///< Number of recorded durations.
+            uint64_t sum_us{ 0 };                           ///< Sum of the recorded durations in microseconds.
+
+            /**
+             * @brief Returns the upper bound of a bucket in microseconds.
+             * @param bucket Bucket index below bucket_count - 1 (the last bucket is unbounded).
+             */
+            [[nodiscard]] static constexpr uint64_t upper_bound_us(const std::size_t bucket) noexcept
+            {
+                return uint64_t{ 1 } << bucket;
+            }
+
+            /**
+             * @brief Estimates a percentile as the upper bound of the bucket containing it.
+             * @param fraction Percentile in the range [0, 1].
+             * @return Bound in microseconds, 0 if nothing was recorded.
+             */
+            [[nodiscard]] uint64_t percentile_us(const double fraction) const noexcept
+            {
+                if (count == 0)
+                    return 0;
+
+                const auto rank = static_cast<uint64_t>(fraction * static_cast<double>(count - 1)) + 1;
+                uint64_t seen = 0;
+
+                for (std::size_t i = 0; i < bucket_count; ++i)
+                {
+                    seen += buckets[i];
+                    if (seen >= rank)
+                        return upper_bound_us(i);
+                }
+
+                return upper_bound_us(bucket_count - 1);
+            }
+
+            /**
+             * @brief Returns the mean duration in microseconds, 0 if nothing was recorded.
+             */
+            [[nodiscard]] uint64_t mean_us() const noexcept
+            {
+                return count ? sum_us / count : 0;
+            }
+        };
+
+        latency_histogram() = default;
+        latency_histogram(const latency_histogram&) = delete;
+        latency_histogram(latency_histogram&&) = delete;
+        latency_histogram& operator=(const latency_histogram&) = delete;
+        latency_histogram& operator=(latency_histogram&&) = delete;
+        ~latency_histogram() = default;
+
+        /**
+         * @brief Records a duration.
+         * @param duration Measured duration, negative values count as zero.
+         */
+        template <typename Rep, typename Period>
+        void record(const std::chrono::duration<Rep, Period> duration) noexcept
+        {
+            const auto us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+            const auto value = us > 0 ? static_cast<uint64_t>(us) : 0;
+
+            const auto bucket = std::min<std::size_t>(std::bit_width(value), bucket_count - 1);
+
+            buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+            sum_us_.fetch_add(value, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Returns a copy of the histogram (not atomic as a whole).
+         */
+        [[nodiscard]] snapshot get_snapshot() const noexcept
+        {
+            snapshot result;
+
+            for (std::size_t i = 0; i < bucket_count; ++i)
+            {
+                result.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+                result.count += result.buckets[i];
+            }
+
+            result.sum_us = sum_us_.load(std::memory_order_relaxed);
+
+            return result;
+        }
+
+    private:
+        std::array<std::atomic<uint64_t>, bucket_count> buckets_{};
+        std::atomic<uint64_t> sum_us_{ 0 };
+    };
+
+    /**
+     * @class prometheus_writer
+     * @brief Builds a metrics page in the Prometheus text exposition format (version 0.0.4).
+     *
+     * Samples of one metric family must be written consecutively; the HELP and TYPE lines are
+     * emitted before the first sample of every family. Label values are escaped, metric and label
+     * names are expected to be valid already.
+     */
+    class prometheus_writer
+    {
+    public:
+        /**
+         * @brief Writes a counter sample.
+         * @param name Metric name, conventionally ending in _total.
+         * @param help Description of the family.
+         * @param value Sample value.
+         * @param labels Pre-formatted label set without braces, e.g. from label().
+         */
+        void counter(const std::string_view name, const std::string_view help, const uint64_t value,
+            const std::string_view labels = {})
+        {
+            family(name, help, "counter");
+            sample(name, labels, value);
+        }
+
+        /**
+         * @brief Writes a gauge sample.
+         * @param name Metric name.
+         * @param help Description of the family.
+         * @param value Sample value.
+         * @param labels Pre-formatted label set without braces.
+         */
+        void gauge(const std::string_view name, const std::string_view help, const uint64_t value,
+            const std::string_view labels = {})
+        {
+            family(name, help, "gauge");
+            sample(name, labels, value);
+        }
+
+        /**
+         * @brief Writes a gauge sample holding a duration converted to seconds.
+         * @param name Metric name, conventionally ending in _seconds.
+         * @param help Description of the family.
+         * @param value Sample value.
+         * @param labels Pre-formatted label set without braces.
+         */
+        template <typename Rep, typename Period>
+        void seconds(const std::string_view name, const std::string_view help,
+            const std::chrono::duration<Rep, Period> value, const std::string_view labels = {})
+        {
+            family(name, help, "gauge");
+            sample(name, labels, std::chrono::duration<double>(value).count());
+        }
+
+        /**
+         * @brief Writes a latency histogram converted to seconds.
+         * @param name Metric name, conventionally ending in _seconds.
+         * @param help Description of the family.
+         * @param histogram Histogram snapshot.
+         * @param labels Pre-formatted label set without braces.
+         */
+        void histogram(const std::string_view name, const std::string_view help,
+            const latency_histogram::snapshot& histogram, const std::string_view labels = {})
+        {
+            family(name, help, "histogram");
+
+            const auto separator = labels.empty() ? "" : ",";
+            uint64_t cumulative = 0;
+
+            for (std::size_t i = 0; i + 1 < latency_histogram::bucket_count; ++i)
+            {
+                cumulative += histogram.buckets[i];
+                std::format_to(std::back_inserter(text_), "{}_bucket{{{}{}le=\"{}\"}} {}\n", name, labels, separator,
+                    static_cast<double>(latency_histogram::snapshot::upper_bound_us(i)) / 1e6, cumulative);
+            }
+
+            std::format_to(std::back_inserter(text_), "{}_bucket{{{}{}le=\"+Inf\"}} {}\n", name, labels, separator,
+                histogram.count);
+            std::format_to(std::back_inserter(text_), "{}_sum{}{}{} {}\n", name, labels.empty() ? "" : "{", labels,
+                labels.empty() ? "" : "}", static_cast<double>(histogram.sum_us) / 1e6);
+            std::format_to(std::back_inserter(text_), "{}_count{}{}{} {}\n", name, labels.empty() ? "" : "{", labels,
+                labels.empty() ? "" : "}", histogram.count);
+        }
+
+        /**
+         * @brief Formats a label pair with an escaped value.
+         * @param name Label name.
+         * @param value Label value.
+         * @return Text like name="value", several pairs may be joined with commas.
+         */
+        [[nodiscard]] static std::string label(const std::string_view name, const std::string_view value)
+        {
+            std::string result;
+            result.reserve(name.size() + value.size() + 3);
+            result.append(name).append("=\"");
+
+            for (const auto c : value)
+            {
+                switch (c)
+                {
+                case '\\':
+                    result.append("\\\\");
+                    break;
+                case '"':
+                    result.append("\\\"");
+                    break;
+                case '\n':
+                    result.append("\\n");
+                    break;
+                default:
+                    result.push_back(c);
+                }
+            }
+
+            result.push_back('"');
+            return result;
+        }
+
+        /**
+         * @brief Returns the page written so far.
+         */
+        [[nodiscard]] const std::string& str() const noexcept
+        {
+            return text_;
+        }
+
+    private:
+        /**
+         * @brief Emits the HELP and TYPE lines when a new family starts.
+         */
+        void family(const std::string_view name, const std::string_view help, const std::string_view type)
+        {
+            if (name == family_)
+                return;
+
+            family_ = name;
+            std::format_to(std::back_inserter(text_), "# HELP {} {}\n# TYPE {} {}\n", name, help, name, type);
+        }
+
+        /**
+         * @brief Emits one sample line.
+         */
+        template <typename V>
+        void sample(const std::string_view name, const std::string_view labels, const V value)
+        {
+            if (labels.empty())
+                std::format_to(std::back_inserter(text_), "{} {}\n", name, value);
+            else
+                std::format_to(std::back_inserter(text_), "{}{{{}}} {}\n", name, labels, value);
+        }
+
+        /// Page text.
+        std::string text_;
+        /// Name of the family written last.
+        std::string family_;
+    };
+}
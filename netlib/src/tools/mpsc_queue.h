@@ -0,0 +1,196 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "spsc_ring.h"
+
+namespace tools::concurrency
+{
+    /**
+     * @class mpsc_queue
+     * @brief Bounded multi-producer/single-consumer queue without locks.
+     *
+     * Every slot carries a sequence number (Vyukov's bounded queue): a producer claims a position
+     * with a single CAS on the tail index, writes the element and publishes it by advancing the
+     * slot sequence; the consumer reads slots in order and recycles them by advancing the sequence
+     * by the capacity. Producers never wait for each other beyond a failed CAS and never wait for
+     * the consumer, a full queue is reported to the caller instead.
+     *
+     * Any number of threads may call try_push() concurrently. Exactly one thread may call
+     * try_pop() at any given time.
+     *
+     * The queue does not park the consumer itself; callers combine it with their own wake-up
+     * mechanism (a condition variable or event signalled after a successful push).
+     *
+     * @tparam T Element type. Must be default constructible and move assignable.
+     * @tparam Capacity Number of slots, must be a power of two.
+     */
+    template <typename T, std::size_t Capacity>
+    class mpsc_queue
+    {
+        static_assert(Capacity >= 2 && std::has_single_bit(Capacity), "mpsc_queue capacity must be a power of two");
+
+        static constexpr std::size_t mask = Capacity - 1;
+
+    public:
+        mpsc_queue()
+            : slots_(std::make_unique<slot[]>(Capacity))
+        {
+            for (std::size_t i = 0; i < Capacity; ++i)
+                slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        mpsc_queue(const mpsc_queue&) = delete;
+        mpsc_queue(mpsc_queue&&) = delete;
+        mpsc_queue& operator=(const mpsc_queue&) = delete;
+        mpsc_queue& operator=(mpsc_queue&&) = delete;
+        ~mpsc_queue() = default;
+
+        /**
+         * @brief Appends an element (any producer thread).
+         * @param value Element to move into the queue. Left untouched if the queue is full.
+         * @return false if the queue is full, true otherwise.
+         */
+        bool try_push(T&& value) noexcept(std::is_nothrow_move_assignable_v<T>)
+        {
+            return try_push_with([&value](T& element) { element = std::move(value); });
+        }
+
+        /**
+         * @brief Appends an element written in place by the caller (any producer thread).
+         *
+         * Saves the copy of a temporary for large elements: the writer fills the claimed slot
+         * directly, the element is published when it returns.
+         *
+         * @param writer Invoked as writer(T&) on the claimed slot. It should not throw: the slot
+         *               would never be published and would stall the consumer.
+         * @return false if the queue is full (the writer is not invoked), true otherwise.
+         */
+        template <typename Writer>
+        bool try_push_with(Writer&& writer) noexcept(noexcept(writer(std::declval<T&>())))
+        {
+            auto position = tail_.load(std::memory_order_relaxed);
+
+            for (;;)
+            {
+                auto& entry = slots_[position & mask];
+                const auto sequence = entry.sequence.load(std::memory_order_acquire);
+                const auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+
+                if (difference == 0)
+                {
+                    if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        writer(entry.value);
+                        entry.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    // The slot still holds the element from the previous lap: the queue is full
+                    return false;
+                }
+                else
+                {
+                    position = tail_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /**
+         * @brief Removes the oldest published element (consumer thread only).
+         *
+         * An element whose producer has claimed its slot but not yet finished writing it is not
+         * visible; try_pop() then reports the queue as empty until the write completes.
+         *
+         * @return The element, or std::nullopt if no published element is available.
+         */
+        std::optional<T> try_pop() noexcept(std::is_nothrow_move_constructible_v<T>)
+        {
+            const auto position = head_.load(std::memory_order_relaxed);
+            auto& entry = slots_[position & mask];
+
+            if (entry.sequence.load(std::memory_order_acquire) != position + 1)
+                return std::nullopt;
+
+            std::optional<T> value{ std::move(entry.value) };
+            entry.sequence.store(position + Capacity, std::memory_order_release);
+            head_.store(position + 1, std::memory_order_release);
+            return value;
+        }
+
+        /**
+         * @brief Removes the oldest published element, reading it in place (consumer thread only).
+         * @param reader Invoked as reader(T&) on the slot before it is recycled.
+         * @return false if no published element is available (the reader is not invoked).
+         */
+        template <typename Reader>
+        bool try_pop_with(Reader&& reader) noexcept(noexcept(reader(std::declval<T&>())))
+        {
+            const auto position = head_.load(std::memory_order_relaxed);
+            auto& entry = slots_[position & mask];
+
+            if (entry.sequence.load(std::memory_order_acquire) != position + 1)
+                return false;
+
+            reader(entry.value);
+            entry.sequence.store(position + Capacity, std::memory_order_release);
+            head_.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Returns an approximate number of queued elements, including claimed but unpublished slots.
+         */
+        [[nodiscard]] std::size_t size() const noexcept
+        {
+            const auto head = head_.load(std::memory_order_acquire);
+            const auto tail = tail_.load(std::memory_order_acquire);
+            return tail > head ? tail - head : 0;
+        }
+
+        /**
+         * @brief Returns true if the queue is (approximately) empty.
+         */
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return size() == 0;
+        }
+
+        /**
+         * @brief Returns the fixed queue capacity.
+         */
+        [[nodiscard]] static constexpr std::size_t capacity() noexcept
+        {
+            return Capacity;
+        }
+
+    private:
+        /**
+         * @struct slot
+         * @brief Queue slot; sequence == position + 1 once the element at position is published.
+         */
+        struct alignas(cache_line_size) slot
+        {
+            std::atomic<std::size_t> sequence{ 0 };     ///< Publication / recycling sequence number.
+            T value{};                                  ///< Stored element.
+        };
+
+        /// Consumer index; written by the consumer only.
+        alignas(cache_line_size) std::atomic<std::size_t> head_{ 0 };
+
+        /// Producer index; advanced by producers with CAS.
+        alignas(cache_line_size) std::atomic<std::size_t> tail_{ 0 };
+
+        /// Element storage (heap allocated, the padded slots are too large for an embedding object).
+        std::unique_ptr<slot[]> slots_;
+    };
+}
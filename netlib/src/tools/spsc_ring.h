@@ -0,0 +1,241 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <optional>
+#include <thread>
+
+namespace tools::concurrency
+{
+    /**
+     * @brief Destructive interference size used to keep producer and consumer
+     *        indices on separate cache lines.
+     */
+#ifdef __cpp_lib_hardware_interference_size
+    inline constexpr std::size_t cache_line_size = std::hardware_destructive_interference_size;
+#else
+    inline constexpr std::size_t cache_line_size = 64;
+#endif
+
+    /**
+     * @brief Issues a CPU relaxation hint inside a spin loop.
+     *
+     * Maps to PAUSE on x86/x64 and YIELD on ARM64 through the YieldProcessor() macro.
+     */
+    inline void cpu_relax() noexcept
+    {
+#ifdef YieldProcessor
+        YieldProcessor();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    /**
+     * @class spsc_ring
+     * @brief Bounded single-producer/single-consumer ring with spin-then-park waiting.
+     *
+     * Exactly one thread may call try_push() and exactly one thread may call try_pop()/pop()
+     * at any given time. The producer role may be handed over to another thread as long as
+     * the hand-over itself establishes a happens-before relationship (e.g. through an atomic
+     * release/acquire pair), the same holds for the consumer role.
+     *
+     * A successful push costs one release store of the tail index and, only when the consumer
+     * is parked, a single increment and wake of the signal word. The consumer spins for a
+     * configurable number of iterations before it parks on the signal word with
+     * std::atomic::wait (WaitOnAddress on Windows), so an active pipeline never enters the kernel.
+     *
+     * @tparam T Element type. Must be default constructible and move assignable.
+     * @tparam Capacity Number of slots, must be a power of two.
+     */
+    template <typename T, std::size_t Capacity>
+    class spsc_ring
+    {
+        static_assert(Capacity >= 2 && std::has_single_bit(Capacity), "spsc_ring capacity must be a power of two");
+
+        static constexpr std::size_t mask = Capacity - 1;
+
+    public:
+        /**
+         * @brief Constructs an empty, open ring.
+         * @param spin_count Number of empty polls the consumer performs before parking.
+         */
+        explicit spsc_ring(const uint32_t spin_count = 1024) noexcept
+            : spin_count_(spin_count)
+        {
+        }
+
+        spsc_ring(const spsc_ring&) = delete;
+        spsc_ring(spsc_ring&&) = delete;
+        spsc_ring& operator=(const spsc_ring&) = delete;
+        spsc_ring& operator=(spsc_ring&&) = delete;
+        ~spsc_ring() = default;
+
+        /**
+         * @brief Appends an element (producer side).
+         * @param value Element to move into the ring.
+         * @return false if the ring is full, true otherwise.
+         */
+        bool try_push(T&& value) noexcept(std::is_nothrow_move_assignable_v<T>)
+        {
+            const auto tail = tail_.load(std::memory_order_relaxed);
+
+            if (tail - cached_head_ == Capacity)
+            {
+                cached_head_ = head_.load(std::memory_order_acquire);
+                if (tail - cached_head_ == Capacity)
+                    return false;
+            }
+
+            slots_[tail & mask] = std::move(value);
+
+            // seq_cst store pairs with the seq_cst load of consumer_parked_ below and the
+            // consumer's seq_cst store/load sequence in pop(), so either the consumer observes
+            // the new tail before parking or the producer observes the parked flag.
+            tail_.store(tail + 1, std::memory_order_seq_cst);
+
+            if (consumer_parked_.load(std::memory_order_seq_cst))
+            {
+                signal_.fetch_add(1, std::memory_order_release);
+                signal_.notify_one();
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Removes the oldest element without waiting (consumer side).
+         * @return The element, or std::nullopt if the ring is empty.
+         */
+        std::optional<T> try_pop() noexcept(std::is_nothrow_move_constructible_v<T>)
+        {
+            const auto head = head_.load(std::memory_order_relaxed);
+
+            if (head == cached_tail_)
+            {
+                cached_tail_ = tail_.load(std::memory_order_acquire);
+                if (head == cached_tail_)
+                    return std::nullopt;
+            }
+
+            std::optional<T> value{ std::move(slots_[head & mask]) };
+            head_.store(head + 1, std::memory_order_release);
+            return value;
+        }
+
+        /**
+         * @brief Removes the oldest element, spinning and then parking while the ring is empty.
+         * @return The element, or std::nullopt if the ring was closed and is empty.
+         */
+        std::optional<T> pop() noexcept(std::is_nothrow_move_constructible_v<T>)
+        {
+            for (;;)
+            {
+                for (uint32_t i = 0; i <= spin_count_; ++i)
+                {
+                    if (auto value = try_pop())
+                        return value;
+
+                    if (closed_.load(std::memory_order_acquire))
+                        return try_pop();
+
+                    cpu_relax();
+                }
+
+                const auto signal = signal_.load(std::memory_order_acquire);
+                consumer_parked_.store(true, std::memory_order_seq_cst);
+
+                if (head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_seq_cst) &&
+                    !closed_.load(std::memory_order_seq_cst))
+                {
+                    signal_.wait(signal, std::memory_order_acquire);
+                }
+
+                consumer_parked_.store(false, std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * @brief Closes the ring and wakes a parked consumer.
+         *
+         * After close() the consumer drains the remaining elements and then pop() returns
+         * std::nullopt. Safe to call from any thread.
+         */
+        void close() noexcept
+        {
+            closed_.store(true, std::memory_order_seq_cst);
+            signal_.fetch_add(1, std::memory_order_release);
+            signal_.notify_all();
+        }
+
+        /**
+         * @brief Re-opens a closed ring and drops any remaining elements.
+         *
+         * Must only be called while neither producer nor consumer is active.
+         */
+        void reset() noexcept
+        {
+            while (try_pop()) {}
+            closed_.store(false, std::memory_order_release);
+        }
+
+        /**
+         * @brief Returns true if the ring has been closed.
+         */
+        [[nodiscard]] bool is_closed() const noexcept
+        {
+            return closed_.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief Returns an approximate number of queued elements (exact when called by either endpoint).
+         */
+        [[nodiscard]] std::size_t size() const noexcept
+        {
+            return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief Returns true if the ring is (approximately) empty.
+         */
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return size() == 0;
+        }
+
+        /**
+         * @brief Returns the fixed ring capacity.
+         */
+        [[nodiscard]] static constexpr std::size_t capacity() noexcept
+        {
+            return Capacity;
+        }
+
+    private:
+        /// Consumer index; written by the consumer only.
+        alignas(cache_line_size) std::atomic<std::size_t> head_{ 0 };
+        /// Producer's cached copy of head_, avoids touching the consumer line on every push.
+        std::size_t cached_head_{ 0 };
+
+        /// Producer index; written by the producer only.
+        alignas(cache_line_size) std::atomic<std::size_t> tail_{ 0 };
+        /// Consumer's cached copy of tail_, avoids touching the producer line on every pop.
+        std::size_t cached_tail_{ 0 };
+
+        /// Wake-up word the consumer parks on.
+        alignas(cache_line_size) std::atomic<uint32_t> signal_{ 0 };
+        /// Set by the consumer while it is (about to be) parked.
+        std::atomic_bool consumer_parked_{ false };
+        /// Set once the ring is closed for shutdown.
+        std::atomic_bool closed_{ false };
+        /// Number of empty polls before parking.
+        uint32_t spin_count_;
+
+        /// Element storage.
+        alignas(cache_line_size) std::array<T, Capacity> slots_{};
+    };
+}
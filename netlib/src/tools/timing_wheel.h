@@ -0,0 +1,264 @@
+#pragma once
+
+namespace tools::generic
+{
+    /**
+     * @class timing_wheel
+     * @brief Hashed timing wheel of keyed deadlines.
+     *
+     * Time is divided into ticks and every timer is stored in the slot of its deadline tick modulo
+     * the number of slots, so scheduling and cancelling a timer are O(1) and advancing the wheel
+     * only visits the slots of the elapsed ticks. With at least as many slots as there are ticks in
+     * the longest timeout, a visited slot holds just the timers due in that tick: the cost of
+     * advancing is proportional to the number of timers that actually expire, not to the number of
+     * timers scheduled.
+     *
+     * Deadlines are rounded up to the next tick, a timer never fires early. Expired timers are
+     * removed from the wheel before their callback runs, so the callback may schedule the same key
+     * again (e.g. when the owner was active in the meantime) or schedule and cancel other keys.
+     *
+     * The class is not thread-safe, callers serialize access with their own lock.
+     *
+     * @tparam Key Timer identifier, must be copyable.
+     * @tparam Hash Hash function object for Key.
+     */
+    template <typename Key, typename Hash = std::hash<Key>>
+    class timing_wheel
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        /**
+         * @brief Constructs an empty wheel.
+         * @param tick Timer resolution.
+         * @param slot_count Minimum number of slots (rounded up to a power of two). Should cover the
+         *                   longest timeout in ticks, longer timeouts are still handled correctly but
+         *                   are visited once per wheel revolution.
+         * @param now Start time of the wheel.
+         */
+        timing_wheel(const clock::duration tick, const std::size_t slot_count, const clock::time_point now = clock::now())
+            : tick_(tick),
+              mask_(std::bit_ceil(std::max<std::size_t>(slot_count, 2)) - 1),
+              slots_(mask_ + 1),
+              origin_(now)
+        {
+        }
+
+        timing_wheel(const timing_wheel&) = delete;
+        timing_wheel& operator=(const timing_wheel&) = delete;
+        timing_wheel(timing_wheel&&) = delete;
+        timing_wheel& operator=(timing_wheel&&) = delete;
+        ~timing_wheel() = default;
+
+        [[nodiscard]] std::size_t size() const noexcept { return positions_.size(); }
+        [[nodiscard]] bool empty() const noexcept { return positions_.empty(); }
+
+        /**
+         * @brief Returns true if a timer is scheduled for the key.
+         */
+        [[nodiscard]] bool contains(const Key& key) const noexcept
+        {
+            return positions_.find(key) != positions_.end();
+        }
+
+        /**
+         * @brief Schedules the timer of a key, replacing its previous deadline if any.
+         *
+         * Deadlines that are already due fire on the next advance().
+         *
+         * @param key Timer identifier.
+         * @param deadline Expiration time.
+         * @throws std::bad_alloc if memory is exhausted (the key is left without a timer).
+         */
+        void schedule(const Key& key, const clock::time_point deadline)
+        {
+            if (const auto it = positions_.find(key); it != positions_.end())
+            {
+                detach(it->second);
+                positions_.erase(it);
+            }
+
+            const auto tick = std::max(ticks_until(deadline), current_ + 1);
+            const auto slot = static_cast<std::size_t>(tick & mask_);
+            auto& nodes = slots_[slot];
+
+            nodes.push_back({ key, tick });
+
+            try
+            {
+                positions_.try_emplace(key, position{ slot, nodes.size() - 1 });
+            }
+            catch (...)
+            {
+                nodes.pop_back();
+                throw;
+            }
+        }
+
+        /**
+         * @brief Cancels the timer of a key.
+         * @return true if a timer was scheduled for the key.
+         */
+        bool cancel(const Key& key) noexcept
+        {
+            const auto it = positions_.find(key);
+            if (it == positions_.end())
+                return false;
+
+            detach(it->second);
+            positions_.erase(it);
+            return true;
+        }
+
+        /**
+         * @brief Removes all timers.
+         */
+        void clear() noexcept
+        {
+            for (auto& nodes : slots_)
+                nodes.clear();
+
+            positions_.clear();
+        }
+
+        /**
+         * @brief Advances the wheel to the given time and fires the expired timers.
+         *
+         * Must not be called from an expiry callback.
+         *
+         * @param now Current time.
+         * @param on_expired Called as on_expired(key) for every expired timer, after it was removed.
+         * @return Number of timers fired.
+         */
+        template <typename F>
+        std::size_t advance(const clock::time_point now, F on_expired)
+        {
+            const auto target = ticks_since(now);
+            if (target <= current_)
+                return 0;
+
+            // Beyond one revolution every slot is visited once, its due timers being those not past target
+            const auto steps = std::min<std::uint64_t>(target - current_, slots_.size());
+
+            expired_.clear();
+
+            for (std::uint64_t step = 1; step <= steps; ++step)
+            {
+                auto& nodes = slots_[static_cast<std::size_t>((current_ + step) & mask_)];
+
+                for (std::size_t i = 0; i < nodes.size();)
+                {
+                    if (nodes[i].deadline > target)
+                    {
+                        ++i;
+                        continue;
+                    }
+
+                    expired_.push_back(nodes[i].key);
+
+                    const auto it = positions_.find(nodes[i].key);
+                    detach(it->second);
+                    positions_.erase(it);
+                }
+            }
+
+            current_ = target;
+
+            for (const auto& key : expired_)
+                on_expired(key);
+
+            return expired_.size();
+        }
+
+    private:
+        /**
+         * @brief Location of a scheduled timer.
+         */
+        struct position
+        {
+            std::size_t slot;
+            std::size_t index;
+        };
+
+        /**
+         * @brief Timer stored in a slot.
+         */
+        struct node
+        {
+            Key key;
+            std::uint64_t deadline;
+        };
+
+        /**
+         * @brief Returns the number of whole ticks elapsed from the origin to a time point.
+         */
+        [[nodiscard]] std::uint64_t ticks_since(const clock::time_point time) const noexcept
+        {
+            return time > origin_ ? static_cast<std::uint64_t>((time - origin_) / tick_) : 0;
+        }
+
+        /**
+         * @brief Returns the first tick at or after a time point.
+         */
+        [[nodiscard]] std::uint64_t ticks_until(const clock::time_point time) const noexcept
+        {
+            if (time <= origin_)
+                return 0;
+
+            return static_cast<std::uint64_t>((time - origin_ + tick_ - clock::duration{ 1 }) / tick_);
+        }
+
+        /**
+         * @brief Removes a timer from its slot, moving the last timer of the slot into its place.
+         *
+         * The position entry of the removed timer is left to the caller.
+         */
+        void detach(const position& p) noexcept
+        {
+            auto& nodes = slots_[p.slot];
+
+            if (p.index + 1 != nodes.size())
+            {
+                nodes[p.index] = std::move(nodes.back());
+                positions_.find(nodes[p.index].key)->second.index = p.index;
+            }
+
+            nodes.pop_back();
+        }
+
+        /**
+         * @brief Duration of a tick.
+         */
+        clock::duration tick_;
+
+        /**
+         * @brief Slot count minus one (the slot count is a power of two).
+         */
+        std::uint64_t mask_;
+
+        /**
+         * @brief Timers of each slot, in no particular order.
+         */
+        std::vector<std::vector<node>> slots_;
+
+        /**
+         * @brief Location of every scheduled timer.
+         */
+        flat_hash_map<Key, position, Hash> positions_;
+
+        /**
+         * @brief Time of tick zero.
+         */
+        clock::time_point origin_;
+
+        /**
+         * @brief Last tick processed by advance().
+         */
+        std::uint64_t current_{ 0 };
+
+        /**
+         * @brief Keys expired by the running advance() (kept to reuse its capacity).
+         */
+        std::vector<Key> expired_;
+    };
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#pragma comment(lib, "ntdll.lib") // RtlNtStatusToDosError
+
 namespace netlib::winsys
 {
     // --------------------------------------------------------------------------------
@@ -210,21 +212,22 @@ namespace netlib::winsys
     /// CONCURRENCY CONTRACT:
     /// - Follows the same start/stop constraints as thread_pool (see thread_pool docs).
     /// - Handler registration/unregistration is thread-safe.
+    /// - Completions are dispatched without locking: each completion key indexes a handler slot
+    ///   directly, and workers call the stored handler in place instead of copying it.
     ///
     /// USAGE NOTES:
     /// - After construction, callers should check valid() to ensure IOCP was created successfully.
-    /// - On 32-bit systems, completion keys may theoretically wrap around after ~4 billion associations.
-    ///   For long-running services, consider monitoring handler count and restarting if needed.
+    /// - By default workers dequeue up to default_batch_size completions per wait with
+    ///   GetQueuedCompletionStatusEx; a batch size of 1 selects GetQueuedCompletionStatus.
+    /// - Completion keys carry a per-slot generation counter so that a stale completion for an
+    ///   unregistered key can't reach a handler that later reused the slot. On 32-bit systems the
+    ///   counter wraps after 16384 reuses of the same slot.
     /// </summary>
     // --------------------------------------------------------------------------------
     class io_completion_port final : public safe_object_handle, public thread_pool<io_completion_port>
     {
         friend thread_pool;
 
-        using mutex_type = std::shared_mutex;
-        using read_lock = std::shared_lock<mutex_type>;
-        using write_lock = std::unique_lock<mutex_type>;
-
     public:
         // ********************************************************************************
         /// <summary>
@@ -234,6 +237,9 @@ namespace netlib::winsys
         // ********************************************************************************
         using callback_t = bool(DWORD, OVERLAPPED*, BOOL);
 
+        /// <summary>default maximum number of completions dequeued by a worker per wait</summary>
+        static constexpr ULONG default_batch_size = 64;
+
         io_completion_port(const io_completion_port& other) = delete;
         io_completion_port& operator=(const io_completion_port& other) = delete;
 
@@ -242,18 +248,202 @@ namespace netlib::winsys
         io_completion_port& operator=(io_completion_port&&) = delete;
 
     private:
-        /// <summary>synchronization lock for handlers below (accessed concurrently)</summary>
-        mutable mutex_type handlers_lock_;
+        /// <summary>number of low key bits holding the handler slot index (plus one, key 0 is reserved)</summary>
+        static constexpr unsigned key_index_bits = 18;
+
+        /// <summary>maximum number of simultaneously registered handlers</summary>
+        static constexpr size_t max_handlers = (size_t{ 1 } << key_index_bits) - 1;
+
+        /// <summary>handler slots are allocated in fixed chunks so that published slots never move</summary>
+        static constexpr size_t slots_per_chunk = 1024;
+
+        /// <summary>number of chunk pointers needed to cover max_handlers slots</summary>
+        static constexpr size_t max_chunks = (max_handlers + slots_per_chunk - 1) / slots_per_chunk;
+
+        // ********************************************************************************
+        /// <summary>
+        /// Registered completion handler. The slot is published through its key: a worker
+        /// announces itself in callers, then calls the handler only if the key still matches.
+        /// Unregistration clears the key, so the handler is never destroyed or replaced while
+        /// a worker that saw the old key is running it.
+        /// </summary>
+        // ********************************************************************************
+        struct handler_slot
+        {
+            /// <summary>completion key currently bound to the slot (0 if free)</summary>
+            std::atomic<ULONG_PTR> key{ 0 };
+            /// <summary>number of workers currently dispatching through the slot</summary>
+            std::atomic<uint32_t> callers{ 0 };
+            /// <summary>reuse counter, stored in the upper key bits to tell reused slots apart</summary>
+            ULONG_PTR generation{ 0 };
+            /// <summary>completion handler, written only while the slot is unpublished and idle</summary>
+            std::function<callback_t> handler;
+        };
 
-        /// <summary>callback handlers storage keyed by IOCP completion key</summary>
-        std::unordered_map<ULONG_PTR, std::function<callback_t>> handlers_;
+        /// <summary>serializes handler registration and unregistration (never taken on dispatch)</summary>
+        mutable std::mutex handlers_lock_;
 
-        /// <summary>monotonically increasing key generator (0 reserved for internal wake-up)</summary>
-        std::atomic<ULONG_PTR> next_key_{ 1 };
+        /// <summary>published handler slot chunks, indexed by slot index / slots_per_chunk</summary>
+        std::array<std::atomic<handler_slot*>, max_chunks> chunks_{};
+
+        /// <summary>owning storage of the chunks above</summary>
+        std::vector<std::unique_ptr<handler_slot[]>> chunk_storage_;
+
+        /// <summary>indices of unregistered slots available for reuse</summary>
+        std::vector<uint32_t> free_slots_;
+
+        /// <summary>number of slots handed out so far (free or in use)</summary>
+        size_t slot_count_{ 0 };
+
+        /// <summary>maximum number of completions dequeued per wait (1 selects GetQueuedCompletionStatus)</summary>
+        ULONG batch_size_;
+
+        /// <summary>processor affinity applied to the worker threads (not set means no affinity)</summary>
+        std::optional<GROUP_AFFINITY> thread_affinity_;
 
         /// <summary>timeout for GetQueuedCompletionStatus (allows responsive shutdown)</summary>
         static constexpr DWORD shutdown_timeout_ms = 100;
 
+        // ********************************************************************************
+        /// <summary>
+        /// Returns the slot a completion key refers to, or nullptr if it was never allocated.
+        /// </summary>
+        // ********************************************************************************
+        [[nodiscard]] handler_slot* find_slot(const ULONG_PTR key) const noexcept
+        {
+            const auto index_plus_one = static_cast<size_t>(key & ((ULONG_PTR{ 1 } << key_index_bits) - 1));
+            if (index_plus_one == 0)
+                return nullptr;
+
+            const auto index = index_plus_one - 1;
+            auto* const chunk = chunks_[index / slots_per_chunk].load(std::memory_order_acquire);
+
+            return chunk != nullptr ? &chunk[index % slots_per_chunk] : nullptr;
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Calls the handler registered for a completion key directly from its slot.
+        /// </summary>
+        // ********************************************************************************
+        void dispatch(const ULONG_PTR completion_key, const DWORD num_bytes, OVERLAPPED* overlapped_ptr,
+                      const BOOL ok) const
+        {
+            auto* const slot = find_slot(completion_key);
+            if (slot == nullptr)
+                return;
+
+            // Announce the call before checking the key (pairs with the key reset in release_slot)
+            slot->callers.fetch_add(1, std::memory_order_seq_cst);
+
+            if (slot->key.load(std::memory_order_seq_cst) == completion_key)
+            {
+                try
+                {
+                    slot->handler(num_bytes, overlapped_ptr, ok);
+                }
+                catch (const std::exception& e)
+                {
+#ifdef _DEBUG
+                    try
+                    {
+                        OutputDebugStringA(std::format("IOCP handler exception: {}\n", e.what()).c_str());
+                    }
+                    catch (...)
+                    {
+                        OutputDebugStringA("IOCP handler exception (format failed)\n");
+                    }
+#else
+                    static_cast<void>(e);
+#endif
+                }
+                catch (...)
+                {
+#ifdef _DEBUG
+                    OutputDebugStringA("IOCP handler threw unknown exception\n");
+#endif
+                }
+            }
+            // else: handler was unregistered; ignore
+
+            slot->callers.fetch_sub(1, std::memory_order_release);
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Binds a handler to a free slot and returns its completion key. handlers_lock_ must be held.
+        /// </summary>
+        // ********************************************************************************
+        ULONG_PTR acquire_slot(const std::function<callback_t>& io_handler)
+        {
+            size_t index = 0;
+            handler_slot* slot = nullptr;
+
+            // Reuse an unregistered slot that no worker is still passing through
+            for (auto it = free_slots_.rbegin(); it != free_slots_.rend(); ++it)
+            {
+                if (auto* const candidate = find_slot(static_cast<ULONG_PTR>(*it) + 1);
+                    candidate->callers.load(std::memory_order_seq_cst) == 0)
+                {
+                    index = *it;
+                    slot = candidate;
+                    free_slots_.erase(std::next(it).base());
+                    break;
+                }
+            }
+
+            if (slot == nullptr)
+            {
+                if (slot_count_ == max_handlers)
+                {
+                    throw std::runtime_error(
+                        "io_completion_port: handler limit of " + std::to_string(max_handlers) + " reached");
+                }
+
+                index = slot_count_;
+
+                if (index % slots_per_chunk == 0)
+                {
+                    chunk_storage_.push_back(std::make_unique<handler_slot[]>(slots_per_chunk));
+                    chunks_[index / slots_per_chunk].store(chunk_storage_.back().get(), std::memory_order_release);
+                }
+
+                ++slot_count_;
+                slot = find_slot(static_cast<ULONG_PTR>(index) + 1);
+            }
+
+            slot->handler = io_handler;
+            ++slot->generation;
+
+            const auto key = slot->generation << key_index_bits | static_cast<ULONG_PTR>(index + 1);
+            slot->key.store(key, std::memory_order_release);
+
+            return key;
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Unbinds a completion key from its slot. handlers_lock_ must be held.
+        /// </summary>
+        /// <returns>true if the key was bound.</returns>
+        // ********************************************************************************
+        bool release_slot(const ULONG_PTR key)
+        {
+            auto* const slot = find_slot(key);
+            if (slot == nullptr || slot->key.load(std::memory_order_relaxed) != key)
+                return false;
+
+            slot->key.store(0, std::memory_order_seq_cst);
+
+            // Workers arriving from now on see the cleared key; release the handler's captures
+            // right away unless one is still running it (then it goes when the slot is reused)
+            if (slot->callers.load(std::memory_order_seq_cst) == 0)
+                slot->handler = nullptr;
+
+            free_slots_.push_back(static_cast<uint32_t>((key & ((ULONG_PTR{ 1 } << key_index_bits) - 1)) - 1));
+            return true;
+        }
+
         // ********************************************************************************
         /// <summary>
         /// Working thread routine (calls stored functions by the I/O completion key).
@@ -261,6 +451,26 @@ namespace netlib::winsys
         // ********************************************************************************
         void start_thread() const
         {
+            if (thread_affinity_ && !SetThreadGroupAffinity(GetCurrentThread(), &thread_affinity_.value(), nullptr))
+            {
+#ifdef _DEBUG
+                try
+                {
+                    OutputDebugStringA(std::format("SetThreadGroupAffinity failed: {}\n", GetLastError()).c_str());
+                }
+                catch (...)
+                {
+                    OutputDebugStringA("SetThreadGroupAffinity failed (format error)\n");
+                }
+#endif
+            }
+
+            if (batch_size_ > 1)
+            {
+                run_batched();
+                return;
+            }
+
             while (active_.load(std::memory_order_acquire))
             {
                 DWORD       num_bytes = 0;
@@ -311,45 +521,69 @@ namespace netlib::winsys
                 if (completion_key == 0)
                     continue;
 
-                std::function<callback_t> handler;
+                dispatch(completion_key, num_bytes, overlapped_ptr, ok);
+            }
+        }
 
-                {
-                    read_lock lock(handlers_lock_);
-                    const auto it = handlers_.find(completion_key);
-                    if (it != handlers_.end())
-                    {
-                        // Copy handler under lock to use it safely outside
-                        handler = it->second;
-                    }
-                }
+        // ********************************************************************************
+        /// <summary>
+        /// Batched working thread routine: one GetQueuedCompletionStatusEx call dequeues
+        /// up to batch_size_ completions, which are then dispatched in order.
+        /// </summary>
+        // ********************************************************************************
+        void run_batched() const
+        {
+            std::vector<OVERLAPPED_ENTRY> entries(batch_size_);
+
+            while (active_.load(std::memory_order_acquire))
+            {
+                ULONG removed = 0;
+
+                const auto ok = GetQueuedCompletionStatusEx(get(), entries.data(), batch_size_, &removed,
+                                                            shutdown_timeout_ms, FALSE);
+
+                // Check after the wait as well, to exit promptly once stopped
+                if (!active_.load(std::memory_order_acquire))
+                    break;
 
-                if (handler)
+                if (!ok)
                 {
-                    try
-                    {
-                        handler(num_bytes, overlapped_ptr, ok);
-                    }
-                    catch (const std::exception& e)
-                    {
 #ifdef _DEBUG
+                    if (const auto err = GetLastError(); err != WAIT_TIMEOUT)
+                    {
                         try
                         {
-                            OutputDebugStringA(std::format("IOCP handler exception: {}\n", e.what()).c_str());
+                            OutputDebugStringA(std::format("GetQueuedCompletionStatusEx failed: {}\n", err).c_str());
                         }
                         catch (...)
                         {
-                            OutputDebugStringA("IOCP handler exception (format failed)\n");
+                            OutputDebugStringA("GetQueuedCompletionStatusEx failed (format error)\n");
                         }
-#endif
                     }
-                    catch (...)
-                    {
-#ifdef _DEBUG
-                        OutputDebugStringA("IOCP handler threw unknown exception\n");
 #endif
-                    }
+                    continue;
+                }
+
+                for (ULONG i = 0; i < removed; ++i)
+                {
+                    const auto& entry = entries[i];
+
+                    // Key == 0 is used as a wake-up / stop signal; its OVERLAPPED may already be gone
+                    if (entry.lpCompletionKey == 0)
+                        continue;
+
+                    // The I/O status is left in OVERLAPPED::Internal as an NTSTATUS; failure and
+                    // warning codes are negative, matching GetQueuedCompletionStatus returning FALSE
+                    const auto status = entry.lpOverlapped != nullptr
+                                            ? static_cast<NTSTATUS>(entry.lpOverlapped->Internal)
+                                            : NTSTATUS{ 0 };
+                    const BOOL io_ok = status >= 0;
+
+                    // Handlers read the error with GetLastError(), as after GetQueuedCompletionStatus
+                    SetLastError(io_ok ? ERROR_SUCCESS : RtlNtStatusToDosError(status));
+
+                    dispatch(entry.lpCompletionKey, entry.dwNumberOfBytesTransferred, entry.lpOverlapped, io_ok);
                 }
-                // else: handler was unregistered; ignore
             }
         }
 
@@ -386,12 +620,16 @@ namespace netlib::winsys
         /// <param name="handle">Existing I/O completion port handle.</param>
         /// <param name="concurrent_threads">Number of concurrent threads
         /// (0 means std::thread::hardware_concurrency()).</param>
+        /// <param name="batch_size">Maximum number of completions dequeued per wait
+        /// (1 means one GetQueuedCompletionStatus call per completion).</param>
         ///
         /// NOTE: Callers should check valid() after construction to ensure handle is valid.
         // ********************************************************************************
-        explicit io_completion_port(const HANDLE handle, const size_t concurrent_threads = 0)
+        explicit io_completion_port(const HANDLE handle, const size_t concurrent_threads = 0,
+                                    const ULONG batch_size = default_batch_size)
             : safe_object_handle(handle)
             , thread_pool(concurrent_threads)
+            , batch_size_(std::max<ULONG>(batch_size, 1))
         {
         }
 
@@ -400,18 +638,22 @@ namespace netlib::winsys
         /// Constructs a new I/O completion port.
         /// </summary>
         /// <param name="concurrent_threads">Number of concurrent threads for I/O completion port.</param>
+        /// <param name="batch_size">Maximum number of completions dequeued per wait
+        /// (1 means one GetQueuedCompletionStatus call per completion).</param>
         ///
         /// NOTE: Callers MUST check valid() after construction to ensure the IOCP was created successfully.
         ///       If CreateIoCompletionPort fails, the object will be constructed with an invalid handle.
         // ********************************************************************************
-        explicit io_completion_port(const size_t concurrent_threads = 0)
+        explicit io_completion_port(const size_t concurrent_threads = 0,
+                                    const ULONG batch_size = default_batch_size)
             : io_completion_port(
                 CreateIoCompletionPort(
                     INVALID_HANDLE_VALUE,
                     nullptr,
                     0,
                     static_cast<DWORD>(concurrent_threads)),
-                concurrent_threads)
+                concurrent_threads,
+                batch_size)
         {
         }
 
@@ -447,8 +689,15 @@ namespace netlib::winsys
 
             // Clear handlers after threads are stopped to prevent resource leaks
             {
-                write_lock lock(handlers_lock_);
-                handlers_.clear();
+                std::scoped_lock lock(handlers_lock_);
+                for (const auto& chunk : chunk_storage_)
+                {
+                    for (size_t i = 0; i < slots_per_chunk; ++i)
+                    {
+                        chunk[i].key.store(0, std::memory_order_relaxed);
+                        chunk[i].handler = nullptr;
+                    }
+                }
             }
         }
 
@@ -472,6 +721,35 @@ namespace netlib::winsys
             return get_worker_threads();
         }
 
+        // ********************************************************************************
+        /// <summary>
+        /// Restricts the worker threads to the given processors. Takes effect for the
+        /// threads created by the next start_thread_pool() call.
+        /// </summary>
+        /// <param name="affinity">Processor group and mask for the worker threads.</param>
+        // ********************************************************************************
+        void set_thread_affinity(const GROUP_AFFINITY& affinity) noexcept
+        {
+            thread_affinity_ = affinity;
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Registers a completion handler without associating a device with it. The returned
+        /// key can be bound to devices later with associate_device(file_object, key).
+        /// </summary>
+        /// <param name="io_handler">Callback handler for the I/O completions posted with the key.</param>
+        /// <returns>Registered I/O completion port key value, or 0 if the handler is empty.</returns>
+        // ********************************************************************************
+        [[nodiscard]] ULONG_PTR register_handler(const std::function<callback_t>& io_handler)
+        {
+            if (!io_handler)
+                return 0;
+
+            std::scoped_lock lock(handlers_lock_);
+            return acquire_slot(io_handler);
+        }
+
         // ********************************************************************************
         /// <summary>
         /// Associates the device with I/O completion port.
@@ -482,8 +760,8 @@ namespace netlib::winsys
         ///
         /// THREAD SAFETY:
         /// - This method is thread-safe with respect to other associate/unregister calls.
-        /// - Key generation and handler insertion are performed atomically under a single
-        ///   write lock to prevent TOCTOU race conditions.
+        /// - Slot allocation and handler publication are performed under the registration
+        ///   lock; workers never take it.
         /// - The handler is stored BEFORE device association to prevent race conditions
         ///   where a completion arrives before the handler is registered.
         /// - If association fails, the handler is automatically cleaned up. This cleanup
@@ -509,36 +787,10 @@ namespace netlib::winsys
 
             ULONG_PTR handler_key = 0;
 
-            // Generate unique key AND insert handler atomically under single write lock.
-            // This eliminates the TOCTOU race between key generation and insertion.
+            // Publish the handler in a free slot; the returned key encodes slot index and generation
             {
-                write_lock lock(handlers_lock_);
-
-                constexpr size_t max_attempts = 1000;
-
-                for (size_t attempts = 0; attempts < max_attempts; ++attempts)
-                {
-                    const ULONG_PTR candidate_key = next_key_.fetch_add(1, std::memory_order_relaxed);
-
-                    // Skip reserved key 0
-                    if (candidate_key == 0)
-                        continue;
-
-                    // Check for collision and insert atomically
-                    if (!handlers_.contains(candidate_key))
-                    {
-                        handlers_.emplace(candidate_key, io_handler);
-                        handler_key = candidate_key;
-                        break;
-                    }
-                }
-
-                if (handler_key == 0)
-                {
-                    throw std::runtime_error(
-                        "io_completion_port: unable to generate unique key after " +
-                        std::to_string(max_attempts) + " attempts");
-                }
+                std::scoped_lock lock(handlers_lock_);
+                handler_key = acquire_slot(io_handler);
             }
 
             // Associate the device with the IOCP
@@ -551,8 +803,8 @@ namespace netlib::winsys
             // Association failed - cleanup is safe because CreateIoCompletionPort failed,
             // meaning no I/O completions can ever be queued for this handler_key.
             {
-                write_lock lock(handlers_lock_);
-                handlers_.erase(handler_key);
+                std::scoped_lock lock(handlers_lock_);
+                release_slot(handler_key);
             }
 
             return { false, 0 };
@@ -570,11 +822,8 @@ namespace netlib::winsys
         [[nodiscard]] bool associate_device(const HANDLE file_object, const ULONG_PTR key) const
         {
             // Only associate if we know about this key
-            {
-                read_lock lock(handlers_lock_);
-                if (!handlers_.contains(key))
-                    return false;
-            }
+            if (!is_handler_registered(key))
+                return false;
 
             if (const auto h = CreateIoCompletionPort(file_object, get(), key, 0);
                 h == get())
@@ -618,20 +867,16 @@ namespace netlib::winsys
         /// <summary>
         /// Unregisters a handler associated with the given completion key.
         /// This prevents future IOCP completions from invoking the handler.
-        /// In-flight callbacks may still run once if they already copied the handler.
+        /// In-flight callbacks that passed the key check before the call still run to completion;
+        /// the handler object is released once no worker is running it.
         /// </summary>
         /// <param name="key">I/O completion port key value to unregister.</param>
         /// <returns>true if the handler was found and removed, false otherwise.</returns>
         // ********************************************************************************
         [[nodiscard]] bool unregister_handler(const ULONG_PTR key)
         {
-            write_lock lock(handlers_lock_);
-            const auto it = handlers_.find(key);
-            if (it == handlers_.end())
-                return false;
-
-            handlers_.erase(it);
-            return true;
+            std::scoped_lock lock(handlers_lock_);
+            return release_slot(key);
         }
 
         // ********************************************************************************
@@ -641,10 +886,10 @@ namespace netlib::winsys
         /// <param name="key">I/O completion port key value to check.</param>
         /// <returns>true if the handler is registered and active, false otherwise.</returns>
         // ********************************************************************************
-        [[nodiscard]] bool is_handler_registered(const ULONG_PTR key) const
+        [[nodiscard]] bool is_handler_registered(const ULONG_PTR key) const noexcept
         {
-            read_lock lock(handlers_lock_);
-            return handlers_.contains(key);
+            const auto* const slot = find_slot(key);
+            return slot != nullptr && slot->key.load(std::memory_order_acquire) == key;
         }
     };
 }
\ No newline at end of file
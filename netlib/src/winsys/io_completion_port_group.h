@@ -0,0 +1,253 @@
+#pragma once
+
+namespace netlib::winsys
+{
+    // --------------------------------------------------------------------------------
+    /// <summary>
+    /// Set of I/O completion ports, one per core group, with the worker threads of
+    /// each port pinned to the processors of its group.
+    ///
+    /// A core group is the set of logical processors sharing a last-level (L3) cache, so
+    /// that a session whose sockets are bound to one port is always served from the same
+    /// cache and NUMA node. If the cache topology is unavailable, NUMA nodes are used as
+    /// core groups instead. An unsharded group holds a single port with unpinned workers,
+    /// which is equivalent to a plain io_completion_port.
+    ///
+    /// CONCURRENCY CONTRACT:
+    /// - start_thread_pool() and stop_thread_pool() follow the thread_pool constraints.
+    /// - next_shard() and the accessors are thread-safe.
+    /// </summary>
+    // --------------------------------------------------------------------------------
+    class io_completion_port_group
+    {
+        // ********************************************************************************
+        /// <summary>
+        /// Completion port serving one core group.
+        /// </summary>
+        // ********************************************************************************
+        struct shard
+        {
+            /// <summary>completion port of the core group</summary>
+            std::unique_ptr<io_completion_port> port;
+            /// <summary>NUMA node of the core group (NUMA_NO_PREFERRED_NODE if unsharded)</summary>
+            DWORD numa_node;
+        };
+
+        /// <summary>completion ports, one per core group</summary>
+        std::vector<shard> shards_;
+
+        /// <summary>round-robin counter used by next_shard()</summary>
+        std::atomic<size_t> next_{ 0 };
+
+        // ********************************************************************************
+        /// <summary>
+        /// Queries the processor topology entries of the given relationship type.
+        /// </summary>
+        /// <returns>Buffer of variable-sized SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX entries.</returns>
+        // ********************************************************************************
+        static std::vector<uint8_t> query_topology(const LOGICAL_PROCESSOR_RELATIONSHIP relationship)
+        {
+            DWORD length = 0;
+            if (GetLogicalProcessorInformationEx(relationship, nullptr, &length) ||
+                GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+            {
+                return {};
+            }
+
+            std::vector<uint8_t> buffer(length);
+            if (!GetLogicalProcessorInformationEx(
+                relationship, reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data()), &length))
+            {
+                return {};
+            }
+
+            buffer.resize(length);
+            return buffer;
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Calls fn for every entry of a buffer returned by query_topology().
+        /// </summary>
+        // ********************************************************************************
+        template <typename F>
+        static void for_each_entry(const std::vector<uint8_t>& buffer, F fn)
+        {
+            for (size_t offset = 0; offset < buffer.size();)
+            {
+                const auto* const entry = reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(
+                    buffer.data() + offset);
+                fn(*entry);
+                offset += entry->Size;
+            }
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Returns the processors of every core group, with the NUMA node each belongs to.
+        /// </summary>
+        // ********************************************************************************
+        static std::vector<std::pair<GROUP_AFFINITY, DWORD>> query_core_groups()
+        {
+            std::vector<std::pair<GROUP_AFFINITY, DWORD>> nodes;
+            for_each_entry(query_topology(RelationNumaNode), [&nodes](const auto& entry)
+            {
+                nodes.emplace_back(entry.NumaNode.GroupMask, entry.NumaNode.NodeNumber);
+            });
+
+            std::vector<std::pair<GROUP_AFFINITY, DWORD>> groups;
+            for_each_entry(query_topology(RelationCache), [&nodes, &groups](const auto& entry)
+            {
+                if (entry.Cache.Level != 3)
+                    return;
+
+                // The NUMA node is the one containing the cache's processors
+                DWORD node = NUMA_NO_PREFERRED_NODE;
+                for (const auto& [mask, number] : nodes)
+                {
+                    if (mask.Group == entry.Cache.GroupMask.Group && (mask.Mask & entry.Cache.GroupMask.Mask) != 0)
+                    {
+                        node = number;
+                        break;
+                    }
+                }
+
+                groups.emplace_back(entry.Cache.GroupMask, node);
+            });
+
+            return groups.empty() ? nodes : groups;
+        }
+
+    public:
+        // ********************************************************************************
+        /// <summary>
+        /// Creates the completion ports.
+        /// </summary>
+        /// <param name="sharded">Creates one port per core group if true, a single unpinned
+        /// port otherwise (also used when the machine has a single core group).</param>
+        /// <param name="batch_size">Maximum number of completions dequeued per wait.</param>
+        ///
+        /// NOTE: Callers MUST check valid() after construction.
+        // ********************************************************************************
+        explicit io_completion_port_group(const bool sharded = false,
+                                          const ULONG batch_size = io_completion_port::default_batch_size)
+        {
+            if (sharded)
+            {
+                for (const auto& [affinity, node] : query_core_groups())
+                {
+                    const auto processors = static_cast<size_t>(std::popcount(static_cast<uint64_t>(affinity.Mask)));
+                    auto port = std::make_unique<io_completion_port>(processors, batch_size);
+                    port->set_thread_affinity(affinity);
+                    shards_.push_back({ std::move(port), node });
+                }
+
+                if (shards_.size() == 1)
+                    shards_.clear();
+            }
+
+            if (shards_.empty())
+            {
+                shards_.push_back({ std::make_unique<io_completion_port>(size_t{ 0 }, batch_size), NUMA_NO_PREFERRED_NODE });
+            }
+        }
+
+        io_completion_port_group(const io_completion_port_group& other) = delete;
+        io_completion_port_group& operator=(const io_completion_port_group& other) = delete;
+        io_completion_port_group(io_completion_port_group&&) = delete;
+        io_completion_port_group& operator=(io_completion_port_group&&) = delete;
+        ~io_completion_port_group() = default;
+
+        // ********************************************************************************
+        /// <summary>
+        /// Returns true if every completion port was created successfully.
+        /// </summary>
+        // ********************************************************************************
+        [[nodiscard]] bool valid() const noexcept
+        {
+            return std::ranges::all_of(shards_, [](const auto& s) { return s.port->valid(); });
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Returns the number of completion ports.
+        /// </summary>
+        // ********************************************************************************
+        [[nodiscard]] size_t size() const noexcept
+        {
+            return shards_.size();
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Returns the completion port of a shard.
+        /// </summary>
+        /// <param name="index">Shard index in [0, size()).</param>
+        // ********************************************************************************
+        [[nodiscard]] io_completion_port& port(const size_t index) const noexcept
+        {
+            return *shards_[index].port;
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Returns the NUMA node of a shard (NUMA_NO_PREFERRED_NODE if not pinned).
+        /// </summary>
+        /// <param name="index">Shard index in [0, size()).</param>
+        // ********************************************************************************
+        [[nodiscard]] DWORD numa_node(const size_t index) const noexcept
+        {
+            return shards_[index].numa_node;
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Creates a shared object in the memory of a shard's NUMA node (or on the regular
+        /// heap if the shard is not pinned to a node).
+        /// </summary>
+        /// <param name="index">Shard index in [0, size()).</param>
+        /// <param name="args">Constructor arguments.</param>
+        // ********************************************************************************
+        template <typename U, typename... Args>
+        [[nodiscard]] std::shared_ptr<U> make_shared(const size_t index, Args&&... args) const
+        {
+            if (const auto node = numa_node(index); node != NUMA_NO_PREFERRED_NODE)
+                return std::allocate_shared<U>(numa_allocator<U>(node), std::forward<Args>(args)...);
+
+            return std::make_shared<U>(std::forward<Args>(args)...);
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Picks the shard for a new session (round-robin over the core groups).
+        /// </summary>
+        // ********************************************************************************
+        [[nodiscard]] size_t next_shard() noexcept
+        {
+            return next_.fetch_add(1, std::memory_order_relaxed) % shards_.size();
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Starts the worker threads of every completion port.
+        /// </summary>
+        /// <exception cref="std::system_error">Thrown if thread creation fails.</exception>
+        // ********************************************************************************
+        void start_thread_pool() const
+        {
+            for (const auto& s : shards_)
+                s.port->start_thread_pool();
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Stops the worker threads of every completion port.
+        /// </summary>
+        // ********************************************************************************
+        void stop_thread_pool() const
+        {
+            for (const auto& s : shards_)
+                s.port->stop_thread_pool();
+        }
+    };
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+namespace netlib::winsys
+{
+    // --------------------------------------------------------------------------------
+    /// <summary>
+    /// Standard allocator placing its allocations in the memory of a given NUMA node.
+    /// Memory is taken directly from VirtualAllocExNuma, so the allocator is meant for
+    /// large, long-lived objects (e.g. proxy sessions with embedded relay buffers) rather
+    /// than for small, frequent allocations.
+    /// \tparam T Allocated value type.
+    /// </summary>
+    // --------------------------------------------------------------------------------
+    template <typename T>
+    class numa_allocator
+    {
+        template <typename U>
+        friend class numa_allocator;
+
+        /// <summary>preferred NUMA node of the allocated memory</summary>
+        DWORD node_;
+
+    public:
+        using value_type = T;
+
+        // ********************************************************************************
+        /// <summary>
+        /// Constructs an allocator for the given NUMA node.
+        /// </summary>
+        /// <param name="node">Preferred NUMA node.</param>
+        // ********************************************************************************
+        explicit numa_allocator(const DWORD node) noexcept
+            : node_(node)
+        {
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Rebinding constructor (required by std::allocate_shared and containers).
+        /// </summary>
+        // ********************************************************************************
+        template <typename U>
+        numa_allocator(const numa_allocator<U>& other) noexcept  // NOLINT(google-explicit-constructor)
+            : node_(other.node_)
+        {
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Returns the preferred NUMA node of the allocator.
+        /// </summary>
+        // ********************************************************************************
+        [[nodiscard]] DWORD node() const noexcept
+        {
+            return node_;
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Allocates committed memory for n objects on the allocator's NUMA node.
+        /// </summary>
+        /// <exception cref="std::bad_alloc">Thrown if the allocation fails.</exception>
+        // ********************************************************************************
+        [[nodiscard]] T* allocate(const size_t n)
+        {
+            if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+                throw std::bad_array_new_length();
+
+            auto* const memory = VirtualAllocExNuma(GetCurrentProcess(), nullptr, n * sizeof(T),
+                                                    MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, node_);
+            if (memory == nullptr)
+                throw std::bad_alloc();
+
+            return static_cast<T*>(memory);
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Releases memory returned by allocate().
+        /// </summary>
+        // ********************************************************************************
+        void deallocate(T* p, size_t) noexcept
+        {
+            VirtualFree(p, 0, MEM_RELEASE);
+        }
+
+        template <typename U>
+        bool operator==(const numa_allocator<U>& other) const noexcept
+        {
+            return node_ == other.node_;
+        }
+    };
+}
@@ -0,0 +1,269 @@
+#pragma once
+
+namespace netlib::winsys
+{
+    // --------------------------------------------------------------------------------
+    /// <summary>
+    /// Registered I/O (RIO) receive queue for a datagram socket.
+    ///
+    /// Keeps a fixed number of RIOReceiveEx operations posted into a pre-registered
+    /// buffer, so receiving a datagram costs neither a buffer probe/lock-down nor a
+    /// system call per datagram. Completions are collected in a RIO completion queue
+    /// that signals an existing I/O completion port: when the queue is armed, the next
+    /// completion posts one packet with the given key and notification() as its
+    /// OVERLAPPED, and process_completions() then drains every finished receive.
+    ///
+    /// The socket must be created with WSA_FLAG_REGISTERED_IO. Other (classic) Winsock
+    /// operations on the socket, e.g. WSASendTo, are not affected.
+    ///
+    /// CONCURRENCY CONTRACT:
+    /// - arm() and process_completions() must not run concurrently (the RIO request and
+    ///   completion queues are not synchronized).
+    /// - The socket must be closed before the object is destroyed.
+    ///
+    /// NOTE: Callers MUST check valid() after construction.
+    /// </summary>
+    // --------------------------------------------------------------------------------
+    class rio_receive_queue
+    {
+        /// <summary>RIO extension function table of the socket's provider</summary>
+        RIO_EXTENSION_FUNCTION_TABLE rio_{};
+
+        /// <summary>number of receives kept posted</summary>
+        ULONG depth_;
+
+        /// <summary>size of each receive slot in bytes</summary>
+        ULONG slot_size_;
+
+        /// <summary>receive slots (depth_ * slot_size_ bytes)</summary>
+        char* data_{ nullptr };
+
+        /// <summary>source address of each slot</summary>
+        SOCKADDR_INET* addresses_{ nullptr };
+
+        /// <summary>registration of data_</summary>
+        RIO_BUFFERID data_id_{ RIO_INVALID_BUFFERID };
+
+        /// <summary>registration of addresses_</summary>
+        RIO_BUFFERID addresses_id_{ RIO_INVALID_BUFFERID };
+
+        /// <summary>completion queue of the receives</summary>
+        RIO_CQ completion_queue_{ RIO_INVALID_CQ };
+
+        /// <summary>request queue of the socket</summary>
+        RIO_RQ request_queue_{ RIO_INVALID_RQ };
+
+        /// <summary>true once all the receives were posted</summary>
+        bool posted_{ false };
+
+        /// <summary>OVERLAPPED posted to the completion port when the completion queue signals</summary>
+        OVERLAPPED notification_{};
+
+        // ********************************************************************************
+        /// <summary>
+        /// Posts the receive of a slot.
+        /// </summary>
+        /// <param name="slot">Slot index.</param>
+        /// <param name="flags">RIO_MSG_* flags (RIO_MSG_DEFER to batch with a later commit).</param>
+        // ********************************************************************************
+        bool post_receive(const ULONG slot, const DWORD flags) noexcept
+        {
+            RIO_BUF data{ data_id_, slot * slot_size_, slot_size_ };
+            RIO_BUF address{ addresses_id_, slot * static_cast<ULONG>(sizeof(SOCKADDR_INET)), sizeof(SOCKADDR_INET) };
+
+            return rio_.RIOReceiveEx(request_queue_, &data, 1, nullptr, &address, nullptr, nullptr, flags,
+                                     reinterpret_cast<PVOID>(static_cast<ULONG_PTR>(slot))) != FALSE;
+        }
+
+    public:
+        // ********************************************************************************
+        /// <summary>
+        /// Creates the queues, registers the buffers and posts depth receives.
+        /// </summary>
+        /// <param name="socket">Datagram socket created with WSA_FLAG_REGISTERED_IO.</param>
+        /// <param name="completion_port">Completion port signalled by the completion queue.</param>
+        /// <param name="completion_key">Completion key of the notification packets.</param>
+        /// <param name="depth">Number of receives kept posted.</param>
+        /// <param name="slot_size">Size of each receive slot (largest datagram accepted).</param>
+        // ********************************************************************************
+        rio_receive_queue(const SOCKET socket, const HANDLE completion_port, const ULONG_PTR completion_key,
+                          const ULONG depth = 64, const ULONG slot_size = 65536) noexcept
+            : depth_(depth), slot_size_(slot_size)
+        {
+            GUID id = WSAID_MULTIPLE_RIO;
+            DWORD bytes = 0;
+            rio_.cbSize = sizeof(rio_);
+
+            if (WSAIoctl(socket, SIO_GET_MULTIPLE_EXTENSION_FUNCTION_POINTER, &id, sizeof(id), &rio_, sizeof(rio_),
+                         &bytes, nullptr, nullptr) == SOCKET_ERROR)
+            {
+                rio_ = {};
+                return;
+            }
+
+            data_ = static_cast<char*>(VirtualAlloc(nullptr, static_cast<size_t>(depth_) * slot_size_,
+                                                    MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+            addresses_ = static_cast<SOCKADDR_INET*>(VirtualAlloc(nullptr, depth_ * sizeof(SOCKADDR_INET),
+                                                                  MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+            if (data_ == nullptr || addresses_ == nullptr)
+                return;
+
+            data_id_ = rio_.RIORegisterBuffer(data_, depth_ * slot_size_);
+            addresses_id_ = rio_.RIORegisterBuffer(reinterpret_cast<PCHAR>(addresses_),
+                                                   depth_ * static_cast<DWORD>(sizeof(SOCKADDR_INET)));
+            if (data_id_ == RIO_INVALID_BUFFERID || addresses_id_ == RIO_INVALID_BUFFERID)
+                return;
+
+            RIO_NOTIFICATION_COMPLETION notification{};
+            notification.Type = RIO_IOCP_COMPLETION;
+            notification.Iocp.IocpHandle = completion_port;
+            notification.Iocp.CompletionKey = reinterpret_cast<PVOID>(completion_key);
+            notification.Iocp.Overlapped = &notification_;
+
+            completion_queue_ = rio_.RIOCreateCompletionQueue(depth_, &notification);
+            if (completion_queue_ == RIO_INVALID_CQ)
+                return;
+
+            // Nothing is sent through RIO, but the request queue needs a send capacity of at least one
+            request_queue_ = rio_.RIOCreateRequestQueue(socket, depth_, 1, 1, 1, completion_queue_, completion_queue_,
+                                                        nullptr);
+            if (request_queue_ == RIO_INVALID_RQ)
+                return;
+
+            for (ULONG slot = 0; slot < depth_; ++slot)
+            {
+                if (!post_receive(slot, RIO_MSG_DEFER))
+                    return;
+            }
+
+            posted_ = rio_.RIOReceiveEx(request_queue_, nullptr, 0, nullptr, nullptr, nullptr, nullptr,
+                                        RIO_MSG_COMMIT_ONLY, nullptr) != FALSE;
+        }
+
+        rio_receive_queue(const rio_receive_queue& other) = delete;
+        rio_receive_queue& operator=(const rio_receive_queue& other) = delete;
+        rio_receive_queue(rio_receive_queue&&) = delete;
+        rio_receive_queue& operator=(rio_receive_queue&&) = delete;
+
+        // ********************************************************************************
+        /// <summary>
+        /// Closes the completion queue and releases the registered buffers. The request
+        /// queue is released together with the socket.
+        /// </summary>
+        // ********************************************************************************
+        ~rio_receive_queue()
+        {
+            if (completion_queue_ != RIO_INVALID_CQ)
+                rio_.RIOCloseCompletionQueue(completion_queue_);
+
+            if (addresses_id_ != RIO_INVALID_BUFFERID)
+                rio_.RIODeregisterBuffer(addresses_id_);
+
+            if (data_id_ != RIO_INVALID_BUFFERID)
+                rio_.RIODeregisterBuffer(data_id_);
+
+            if (addresses_ != nullptr)
+                VirtualFree(addresses_, 0, MEM_RELEASE);
+
+            if (data_ != nullptr)
+                VirtualFree(data_, 0, MEM_RELEASE);
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Returns true if the receives were posted successfully.
+        /// </summary>
+        // ********************************************************************************
+        [[nodiscard]] bool valid() const noexcept
+        {
+            return posted_;
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Returns true if the socket has been bound to a RIO request queue. Such a socket
+        /// cannot fall back to classic receives, as the request queue lives as long as the
+        /// socket and must keep its completion queue.
+        /// </summary>
+        // ********************************************************************************
+        [[nodiscard]] bool bound() const noexcept
+        {
+            return request_queue_ != RIO_INVALID_RQ;
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Returns the OVERLAPPED of the notification packets, used to tell them apart from
+        /// the completions of classic overlapped operations with the same key.
+        /// </summary>
+        // ********************************************************************************
+        [[nodiscard]] const OVERLAPPED* notification() const noexcept
+        {
+            return &notification_;
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Requests a notification packet for the next completion (or immediately if
+        /// completions are already queued).
+        /// </summary>
+        /// <returns>true if the queue is armed.</returns>
+        // ********************************************************************************
+        bool arm() noexcept
+        {
+            const auto result = rio_.RIONotify(completion_queue_);
+            return result == ERROR_SUCCESS || result == WSAEALREADY;
+        }
+
+        // ********************************************************************************
+        /// <summary>
+        /// Dequeues every finished receive, calls fn for each successful one and reposts
+        /// the receives. The queue must be re-armed with arm() afterwards.
+        /// </summary>
+        /// <param name="fn">Callable as fn(const char* data, DWORD length, const SOCKADDR_STORAGE&amp; from);
+        /// the data is only valid for the duration of the call.</param>
+        /// <returns>false if the completion queue is corrupted or a receive could not be reposted.</returns>
+        // ********************************************************************************
+        template <typename F>
+        bool process_completions(F fn)
+        {
+            constexpr ULONG batch_size = 64;
+            std::array<RIORESULT, batch_size> results;
+            auto healthy = true;
+
+            for (;;)
+            {
+                const auto count = rio_.RIODequeueCompletion(completion_queue_, results.data(), batch_size);
+
+                if (count == RIO_CORRUPT_CQ)
+                    return false;
+
+                if (count == 0)
+                    break;
+
+                for (ULONG i = 0; i < count; ++i)
+                {
+                    const auto slot = static_cast<ULONG>(results[i].RequestContext);
+
+                    if (results[i].Status == NO_ERROR && results[i].BytesTransferred != 0)
+                    {
+                        SOCKADDR_STORAGE from{};
+                        std::memcpy(&from, &addresses_[slot], sizeof(SOCKADDR_INET));
+
+                        fn(data_ + static_cast<size_t>(slot) * slot_size_, results[i].BytesTransferred, from);
+                    }
+
+                    healthy = post_receive(slot, RIO_MSG_DEFER) && healthy;
+                }
+
+                healthy = rio_.RIOReceiveEx(request_queue_, nullptr, 0, nullptr, nullptr, nullptr, nullptr,
+                                            RIO_MSG_COMMIT_ONLY, nullptr) && healthy;
+
+                if (count < batch_size)
+                    break;
+            }
+
+            return healthy;
+        }
+    };
+}
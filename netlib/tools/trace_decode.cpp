@@ -0,0 +1,348 @@
+// --------------------------------------------------------------------------------
+/// <summary>
+/// Module Name:  trace_decode.cpp
+/// Abstract: Decodes binary trace files written by netlib::log::binary_trace into text
+/// </summary>
+/// Build (x64 Native Tools Command Prompt, from this directory):
+///   cl /O2 /std:c++20 /EHsc trace_decode.cpp ws2_32.lib
+/// Usage:
+///   trace_decode trace_file [last_records]
+/// The file can be decoded while the traced process is still running or after it crashed,
+/// records only partially written at that time are skipped.
+// --------------------------------------------------------------------------------
+
+#define NOMINMAX 1
+
+#include <WinSock2.h>
+#include <ws2tcpip.h>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "../src/log/log.h"
+#include "../src/log/binary_trace.h"
+
+namespace
+{
+    namespace tf = netlib::log::trace_format;
+
+    /// A decoded argument, std::monostate if it was not recorded.
+    using value = std::variant<std::monostate, std::int64_t, std::uint64_t, float, double, bool, char, const void*, std::string>;
+
+    /// FILETIME of the Unix epoch.
+    constexpr std::uint64_t unix_epoch_filetime = 116444736000000000ULL;
+
+    /// Reads a raw value from the payload.
+    template <typename T>
+    bool read_raw(std::span<const std::byte>& payload, T& out)
+    {
+        if (payload.size() < sizeof(T))
+            return false;
+
+        std::memcpy(&out, payload.data(), sizeof(T));
+        payload = payload.subspan(sizeof(T));
+        return true;
+    }
+
+    /// Reads a raw integer and widens it to the decoded integer type.
+    template <typename Raw, typename Wide>
+    bool read_integer(std::span<const std::byte>& payload, value& out)
+    {
+        Raw raw{};
+        if (!read_raw(payload, raw))
+            return false;
+
+        out = static_cast<Wide>(raw);
+        return true;
+    }
+
+    /// Reads an IPv4 or IPv6 address and converts it to text the way net::ip_address_v4/v6 do.
+    bool read_address(std::span<const std::byte>& payload, const int family, value& out)
+    {
+        const std::size_t size = family == AF_INET ? 4 : 16;
+        if (payload.size() < size)
+            return false;
+
+        std::byte address[16]{};
+        std::memcpy(address, payload.data(), size);
+        payload = payload.subspan(size);
+
+        char text[INET6_ADDRSTRLEN]{};
+        out = std::string(InetNtopA(family, address, text, sizeof(text)) != nullptr ? text : "<invalid address>");
+        return true;
+    }
+
+    /// Decodes one argument, returns false if the payload is exhausted.
+    bool read_arg(const tf::arg_type type, std::span<const std::byte>& payload, value& out)
+    {
+        using enum tf::arg_type;
+
+        switch (type)
+        {
+        case i8: return read_integer<std::int8_t, std::int64_t>(payload, out);
+        case i16: return read_integer<std::int16_t, std::int64_t>(payload, out);
+        case i32: return read_integer<std::int32_t, std::int64_t>(payload, out);
+        case i64: return read_integer<std::int64_t, std::int64_t>(payload, out);
+        case u8: return read_integer<std::uint8_t, std::uint64_t>(payload, out);
+        case u16: return read_integer<std::uint16_t, std::uint64_t>(payload, out);
+        case u32: return read_integer<std::uint32_t, std::uint64_t>(payload, out);
+        case u64: return read_integer<std::uint64_t, std::uint64_t>(payload, out);
+        case f32:
+        {
+            float raw{};
+            if (!read_raw(payload, raw))
+                return false;
+            out = raw;
+            return true;
+        }
+        case f64:
+        {
+            double raw{};
+            if (!read_raw(payload, raw))
+                return false;
+            out = raw;
+            return true;
+        }
+        case boolean:
+        {
+            std::uint8_t raw{};
+            if (!read_raw(payload, raw))
+                return false;
+            out = raw != 0;
+            return true;
+        }
+        case character:
+        {
+            char raw{};
+            if (!read_raw(payload, raw))
+                return false;
+            out = raw;
+            return true;
+        }
+        case pointer:
+        {
+            std::uint64_t raw{};
+            if (!read_raw(payload, raw))
+                return false;
+            out = reinterpret_cast<const void*>(static_cast<std::uintptr_t>(raw));
+            return true;
+        }
+        case string:
+        {
+            std::uint8_t length{};
+            if (!read_raw(payload, length) || payload.size() < length)
+                return false;
+            out = std::string(reinterpret_cast<const char*>(payload.data()), length);
+            payload = payload.subspan(length);
+            return true;
+        }
+        case ipv4: return read_address(payload, AF_INET, out);
+        case ipv6: return read_address(payload, AF_INET6, out);
+        case ip_address:
+        {
+            std::uint8_t family{};
+            if (!read_raw(payload, family))
+                return false;
+            return read_address(payload, family == 4 ? AF_INET : AF_INET6, out);
+        }
+        case none:
+            break;
+        }
+
+        return false;
+    }
+
+    /// Formats one argument with the format spec of its replacement field.
+    std::string format_value(const value& argument, const std::string_view spec)
+    {
+        if (std::holds_alternative<std::monostate>(argument))
+            return "<not recorded>";
+
+        const auto field = std::format("{{:{}}}", spec);
+
+        return std::visit([&field]<typename T>(const T& v) -> std::string
+        {
+            if constexpr (std::is_same_v<T, std::monostate>)
+            {
+                return {};
+            }
+            else
+            {
+                try
+                {
+                    return std::vformat(field, std::make_format_args(v));
+                }
+                catch (const std::format_error&)
+                {
+                    return "<bad format>";
+                }
+            }
+        }, argument);
+    }
+
+    /// Substitutes the decoded arguments into a std::format format string.
+    std::string render(const std::string_view format, const std::vector<value>& args)
+    {
+        std::string out;
+        std::size_t next_index = 0;
+
+        for (std::size_t i = 0; i < format.size(); ++i)
+        {
+            const auto c = format[i];
+
+            if ((c == '{' || c == '}') && i + 1 < format.size() && format[i + 1] == c)
+            {
+                out += c;
+                ++i;
+                continue;
+            }
+
+            if (c != '{')
+            {
+                out += c;
+                continue;
+            }
+
+            const auto close = format.find('}', i);
+            if (close == std::string_view::npos)
+            {
+                out += format.substr(i);
+                break;
+            }
+
+            const auto field = format.substr(i + 1, close - i - 1);
+            const auto colon = field.find(':');
+            const auto id = field.substr(0, colon);
+            const auto spec = colon == std::string_view::npos ? std::string_view{} : field.substr(colon + 1);
+
+            auto index = next_index++;
+            if (!id.empty())
+                std::from_chars(id.data(), id.data() + id.size(), index);
+
+            out += format_value(index < args.size() ? args[index] : value{}, spec);
+            i = close;
+        }
+
+        return out;
+    }
+
+    /// Returns a NUL-terminated field of a site entry as a string_view.
+    template <std::size_t N>
+    std::string_view field_text(const char (&field)[N])
+    {
+        return { field, strnlen(field, N) };
+    }
+}
+
+int main(const int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: trace_decode trace_file [last_records]\n";
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream input(argv[1], std::ios::binary);
+    const std::vector<char> file((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    if (!input.eof() && !input)
+    {
+        std::cerr << "Cannot read " << argv[1] << '\n';
+        return EXIT_FAILURE;
+    }
+
+    tf::file_header header{};
+    if (file.size() < tf::header_size)
+    {
+        std::cerr << "Not a trace file (too short)\n";
+        return EXIT_FAILURE;
+    }
+
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    if (header.magic != tf::magic || header.version != tf::version || !std::has_single_bit(header.record_capacity) ||
+        header.records_offset + header.record_capacity * sizeof(tf::record) > file.size() ||
+        header.sites_offset + std::uint64_t{ header.site_capacity } * sizeof(tf::site_entry) > header.records_offset ||
+        header.qpc_frequency == 0)
+    {
+        std::cerr << "Not a trace file (bad header)\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector<tf::site_entry> sites(std::min(header.site_count, header.site_capacity));
+    std::memcpy(sites.data(), file.data() + header.sites_offset, sites.size() * sizeof(tf::site_entry));
+
+    const auto head = header.head;
+    auto first = head > header.record_capacity ? head - header.record_capacity : 0;
+
+    if (argc > 2)
+    {
+        std::uint64_t last = 0;
+        std::from_chars(argv[2], argv[2] + std::strlen(argv[2]), last);
+        first = std::max(first, head > last ? head - last : 0);
+    }
+
+    std::uint64_t decoded = 0;
+    std::uint64_t skipped = 0;
+    std::vector<value> args;
+
+    for (auto ticket = first; ticket < head; ++ticket)
+    {
+        tf::record record{};
+        std::memcpy(&record, file.data() + header.records_offset + (ticket & (header.record_capacity - 1)) * sizeof(tf::record),
+                    sizeof(record));
+
+        // Being written when the file was read, or already overwritten by a newer record
+        if (record.sequence != ticket + 1 || record.site == 0 || record.site > sites.size() ||
+            sites[record.site - 1].line == 0)
+        {
+            ++skipped;
+            continue;
+        }
+
+        const auto& site = sites[record.site - 1];
+        std::span<const std::byte> payload(record.payload, std::min<std::size_t>(record.size, sizeof(record.payload)));
+
+        args.assign(std::min<std::size_t>(site.arg_count, tf::max_args), value{});
+
+        for (std::size_t i = 0; i < args.size() && i < record.arg_count; ++i)
+        {
+            if (!read_arg(static_cast<tf::arg_type>(site.arg_types[i]), payload, args[i]))
+                break;
+        }
+
+        // QPC ticks since the start of the trace converted to 100 ns units and added to the start time
+        const auto elapsed = record.timestamp - header.start_qpc;
+        const auto elapsed_100ns = elapsed / header.qpc_frequency * 10'000'000 +
+            elapsed % header.qpc_frequency * 10'000'000 / header.qpc_frequency;
+        const auto time = std::chrono::sys_time<std::chrono::microseconds>(
+            std::chrono::microseconds((header.start_time + elapsed_100ns - unix_epoch_filetime) / 10));
+
+        const auto file_name = field_text(site.file);
+        const auto base_name = file_name.substr(file_name.find_last_of("/\\") + 1);
+
+        std::cout << std::format("[{}] {:%Y-%m-%dT%H:%M:%S}Z [TID {}] [{}:{}:{}] {}\n",
+                                 netlib::log::to_string(static_cast<netlib::log::log_level>(site.level)), time,
+                                 record.thread_id, base_name, site.line, field_text(site.function),
+                                 render(field_text(site.format), args));
+        ++decoded;
+    }
+
+    std::cerr << std::format("{} records decoded, {} skipped (incomplete or overwritten), {} written in total by process {}\n",
+                             decoded, skipped, head, header.process_id);
+    return EXIT_SUCCESS;
+}
@@ -60,39 +60,70 @@ void Socksifier::Socksifier::log_thread()
         if (!logger_thread_active_)
             break;
 
-        if (unmanaged_ptr_)
+        if (!unmanaged_ptr_)
+            continue;
+
+        // Records are read in place from the native log ring, only the managed entries are allocated
+        Collections::Generic::List<LogEntry^>^ managed_log_list = nullptr;
+
+        auto span = unmanaged_ptr_->acquire_log();
+
+        // One pass drains the records queued when it started, so that a sustained burst is still
+        // delivered in batches instead of growing a single list for as long as it lasts
+        for (auto remaining = span.queued; span.size != 0 || span.dropped != 0; span = unmanaged_ptr_->acquire_log())
         {
-            if (auto log = unmanaged_ptr_->read_log(); !log.empty())
+            if (span.size > remaining)
+                span.size = static_cast<size_t>(remaining);
+
+            if (managed_log_list == nullptr)
+                managed_log_list = gcnew Collections::Generic::List<LogEntry^>;
+
+            if (span.dropped != 0)
+            {
+                managed_log_list->Add(gcnew LogEntry(DateTimeOffset::UtcNow.ToUnixTimeMilliseconds(),
+                    ProxyGatewayEvent::Message,
+                    String::Format("{0} log entries were dropped because the log buffer was full", span.dropped)));
+            }
+
+            for (size_t offset = 0; offset < span.size;)
             {
-                auto managed_log_list = gcnew Collections::Generic::List<LogEntry^>;
-                for (auto& [fst, snd] : log)
+                const auto* record = reinterpret_cast<const log_record_mx*>(span.data + offset);
+                offset += record->size();
+
+                if (record->kind == log_record_kind_mx::message)
+                {
+                    managed_log_list->Add(gcnew LogEntry(record->time_stamp, ProxyGatewayEvent::Message,
+                        gcnew String(const_cast<char*>(record->text()), 0, static_cast<int>(record->length))));
+                }
+                else if (record->kind == log_record_kind_mx::event)
                 {
-                    if (std::holds_alternative<std::string>(snd))
-                        managed_log_list->Add(gcnew LogEntry(fst, ProxyGatewayEvent::Message,
-                            gcnew String(std::get<std::string>(snd).c_str())));
-                    else
+                    switch (static_cast<event_type_mx>(record->event))
                     {
-                        switch (std::get<event_mx>(snd).type)
-                        {
-                        case event_type_mx::connected:
-                            managed_log_list->Add(gcnew LogEntry(fst, ProxyGatewayEvent::Connected, nullptr));
-                            break;
-                        case event_type_mx::disconnected:
-                            managed_log_list->Add(gcnew LogEntry(fst, ProxyGatewayEvent::Disconnected, nullptr));
-                            break;
-                        case event_type_mx::address_error:
-                            managed_log_list->Add(gcnew LogEntry(fst, ProxyGatewayEvent::AddressError, nullptr));
-                            break;
-                        default:
-                            break;
-                        }
+                    case event_type_mx::connected:
+                        managed_log_list->Add(gcnew LogEntry(record->time_stamp, ProxyGatewayEvent::Connected, nullptr));
+                        break;
+                    case event_type_mx::disconnected:
+                        managed_log_list->Add(gcnew LogEntry(record->time_stamp, ProxyGatewayEvent::Disconnected, nullptr));
+                        break;
+                    case event_type_mx::address_error:
+                        managed_log_list->Add(gcnew LogEntry(record->time_stamp, ProxyGatewayEvent::AddressError, nullptr));
+                        break;
+                    default:
+                        break;
                     }
                 }
-
-                // In C++/CLI, invoking the event directly is correct; its safe if there are no subscribers.
-                LogEvent(this, gcnew LogEventArgs(managed_log_list));
             }
+
+            unmanaged_ptr_->release_log(span);
+
+            remaining -= span.size;
+            if (remaining == 0)
+                break;
         }
+
+        // In C++/CLI, invoking the event directly is correct; its safe if there are no subscribers.
+        if (managed_log_list != nullptr && managed_log_list->Count != 0)
+            LogEvent(this, gcnew LogEventArgs(managed_log_list));
     } while (logger_thread_active_);
 }
 
@@ -106,6 +137,11 @@ void Socksifier::Socksifier::SetLogLimit(const UInt32 value)
     unmanaged_ptr_->set_log_limit(value);
 }
 
+UInt64 Socksifier::Socksifier::GetLogDropped()
+{
+    return unmanaged_ptr_ ? unmanaged_ptr_->get_log_dropped() : 0;
+}
+
 Socksifier::Socksifier^ Socksifier::Socksifier::GetInstance(const LogLevel log_level)
 {
     if (instance_ == nullptr)
@@ -151,6 +187,79 @@ void Socksifier::Socksifier::SetBypassLan()
     }
 }
 
+/// <summary>
+/// Enables or disables kernel bypass of busy unproxied flows.
+/// </summary>
+bool Socksifier::Socksifier::SetKernelBypass(const bool enable)
+{
+    return unmanaged_ptr_ && unmanaged_ptr_->set_kernel_bypass(enable);
+}
+
+/// <summary>
+/// Enables or disables DNS forwarding through a SOCKS5 proxy.
+/// </summary>
+bool Socksifier::Socksifier::SetDnsForwarding(IntPtr proxy, String^ resolver, const bool useTcp)
+{
+    if (!unmanaged_ptr_)
+        return false;
+
+    const auto resolver_mx = resolver != nullptr ? msclr::interop::marshal_as<std::string>(resolver) : std::string{};
+
+#if _WIN64
+    return unmanaged_ptr_->set_dns_forwarding(proxy.ToInt64(), resolver_mx, useTcp);
+#else
+    return unmanaged_ptr_->set_dns_forwarding(proxy.ToInt32(), resolver_mx, useTcp);
+#endif //_WIN64
+}
+
+/// <summary>
+/// Adds an alternative endpoint to a SOCKS5 proxy.
+/// </summary>
+/// <param name="proxy">The proxy handle.</param>
+/// <param name="endpoint">The alternative endpoint (IP:Port).</param>
+/// <returns>True if the endpoint was added.</returns>
+bool Socksifier::Socksifier::AddSocks5ProxyEndpoint(IntPtr proxy, String^ endpoint)
+{
+    if (!unmanaged_ptr_ || endpoint == nullptr)
+        return false;
+
+#if _WIN64
+    return unmanaged_ptr_->add_socks5_proxy_endpoint(proxy.ToInt64(), msclr::interop::marshal_as<std::string>(endpoint));
+#else
+    return unmanaged_ptr_->add_socks5_proxy_endpoint(proxy.ToInt32(), msclr::interop::marshal_as<std::string>(endpoint));
+#endif //_WIN64
+}
+
+/// <summary>
+/// Sets how new sessions of a SOCKS5 proxy choose among its endpoints.
+/// </summary>
+/// <param name="proxy">The proxy handle.</param>
+/// <param name="leastSessions">Prefer the endpoint with the fewest active sessions.</param>
+/// <returns>True if the setting was applied.</returns>
+bool Socksifier::Socksifier::SetProxySelection(IntPtr proxy, const bool leastSessions)
+{
+    if (!unmanaged_ptr_)
+        return false;
+
+#if _WIN64
+    return unmanaged_ptr_->set_proxy_selection(proxy.ToInt64(), leastSessions);
+#else
+    return unmanaged_ptr_->set_proxy_selection(proxy.ToInt32(), leastSessions);
+#endif //_WIN64
+}
+
+/// <summary>
+/// Returns a snapshot of the data path metrics.
+/// </summary>
+/// <returns>The metrics in the Prometheus text exposition format.</returns>
+String^ Socksifier::Socksifier::GetMetrics()
+{
+    if (!unmanaged_ptr_)
+        return String::Empty;
+
+    return gcnew String(unmanaged_ptr_->get_metrics().c_str());
+}
+
 /// <summary>
 /// Adds a SOCKS5 proxy to the gateway.
 /// </summary>
@@ -215,6 +324,76 @@ bool Socksifier::Socksifier::ExcludeProcessName(String^ excludedEntry)
     return unmanaged_ptr_->exclude_process_name(msclr::interop::marshal_as<std::wstring>(excludedEntry));
 }
 
+/// <summary>
+/// Converts the non-null strings of a managed array, which may be null.
+/// </summary>
+template <typename T>
+static std::vector<T> marshal_strings(array<String^>^ values)
+{
+    std::vector<T> result;
+
+    if (values != nullptr)
+    {
+        for each (String^ value in values)
+        {
+            if (value != nullptr)
+                result.push_back(msclr::interop::marshal_as<T>(value));
+        }
+    }
+
+    return result;
+}
+
+array<IntPtr>^ Socksifier::Socksifier::Reconfigure(array<Socks5ProxyConfiguration^>^ proxies,
+    array<String^>^ excludes, const bool bypassLan)
+{
+    if (!unmanaged_ptr_ || proxies == nullptr)
+        return nullptr;
+
+    std::vector<proxy_configuration_mx> proxies_mx;
+    proxies_mx.reserve(proxies->Length);
+
+    for each (Socks5ProxyConfiguration^ proxy in proxies)
+    {
+        if (proxy == nullptr || proxy->Endpoint == nullptr)
+            return nullptr;
+
+        auto& proxy_mx = proxies_mx.emplace_back();
+        proxy_mx.endpoint = msclr::interop::marshal_as<std::string>(proxy->Endpoint);
+        proxy_mx.alternative_endpoints = marshal_strings<std::string>(proxy->AlternativeEndpoints);
+        proxy_mx.process_names = marshal_strings<std::wstring>(proxy->ProcessNames);
+
+        switch (proxy->Protocols)
+        {
+        case SupportedProtocolsEnum::TCP:
+            proxy_mx.protocols = supported_protocols_mx::tcp;
+            break;
+        case SupportedProtocolsEnum::UDP:
+            proxy_mx.protocols = supported_protocols_mx::udp;
+            break;
+        default:
+            proxy_mx.protocols = supported_protocols_mx::both;
+            break;
+        }
+
+        if (proxy->Username != nullptr && proxy->Password != nullptr)
+        {
+            proxy_mx.login = msclr::interop::marshal_as<std::string>(proxy->Username);
+            proxy_mx.password = msclr::interop::marshal_as<std::string>(proxy->Password);
+        }
+    }
+
+    const auto handles = unmanaged_ptr_->reconfigure(proxies_mx, marshal_strings<std::wstring>(excludes), bypassLan);
+    if (!handles)
+        return nullptr;
+
+    auto result = gcnew array<IntPtr>(static_cast<int>(handles->size()));
+    for (int i = 0; i < result->Length; ++i)
+        result[i] = static_cast<IntPtr>(handles->at(i));
+
+    return result;
+}
+
 // --- NEW: tiny forwards to unmanaged wrappers -------------------------------
 bool Socksifier::Socksifier::IncludeProcessDestinationCidr(String^ processName, String^ cidr)
 {
@@ -231,4 +410,40 @@ bool Socksifier::Socksifier::RemoveProcessDestinationCidr(String^ processName, S
         msclr::interop::marshal_as<std::wstring>(processName),
         msclr::interop::marshal_as<std::string>(cidr));
 }
+
+Int32 Socksifier::Socksifier::IncludeProcessDestinationCidrs(String^ processName, array<String^>^ cidrs)
+{
+    if (!unmanaged_ptr_ || cidrs == nullptr) return -1;
+
+    // One native list, so the whole array costs a single transition and policy rebuild
+    std::string list;
+    for each (String^ cidr in cidrs)
+    {
+        if (cidr == nullptr) continue;
+        list += msclr::interop::marshal_as<std::string>(cidr);
+        list += '\n';
+    }
+
+    return unmanaged_ptr_->include_process_dst_cidrs(
+        msclr::interop::marshal_as<std::wstring>(processName), list);
+}
+
+Int32 Socksifier::Socksifier::IncludeProcessDestinationCidrList(String^ processName, array<Byte>^ utf8List)
+{
+    if (!unmanaged_ptr_ || utf8List == nullptr) return -1;
+    if (utf8List->Length == 0) return 0;
+
+    const pin_ptr<Byte> bytes = &utf8List[0];
+    return unmanaged_ptr_->include_process_dst_cidrs(
+        msclr::interop::marshal_as<std::wstring>(processName),
+        std::string_view(reinterpret_cast<const char*>(bytes), utf8List->Length));
+}
+
+Int32 Socksifier::Socksifier::IncludeProcessDestinationCidrFile(String^ processName, String^ path)
+{
+    if (!unmanaged_ptr_ || path == nullptr) return -1;
+    return unmanaged_ptr_->include_process_dst_cidr_file(
+        msclr::interop::marshal_as<std::wstring>(processName),
+        msclr::interop::marshal_as<std::wstring>(path));
+}
 // ---------------------------------------------------------------------------
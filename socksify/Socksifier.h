@@ -135,6 +135,26 @@ namespace Socksifier
         }
     };
 
+    /// <summary>
+    /// A SOCKS5 proxy and the processes routed through it, see Socksifier::Reconfigure.
+    /// </summary>
+    public ref class Socks5ProxyConfiguration sealed
+    {
+    public:
+        /// <summary>Primary endpoint (IP:Port).</summary>
+        property String^ Endpoint;
+        /// <summary>Alternative endpoints accepting the same credentials, may be null.</summary>
+        property array<String^>^ AlternativeEndpoints;
+        /// <summary>Username, null without authentication.</summary>
+        property String^ Username;
+        /// <summary>Password, null without authentication.</summary>
+        property String^ Password;
+        /// <summary>Proxied protocols.</summary>
+        property SupportedProtocolsEnum Protocols;
+        /// <summary>Processes routed through the proxy, may be null.</summary>
+        property array<String^>^ ProcessNames;
+    };
+
     /// <summary>
     /// Main entry point for managing SOCKS proxying and process association.
     /// </summary>
@@ -170,6 +190,31 @@ namespace Socksifier
         /// </remarks>
         void SetBypassLan();
 
+        /// <summary>
+        /// Enables or disables kernel bypass of busy unproxied flows.
+        /// When enabled, flows that are passed without proxying are handed to the driver as
+        /// pass-through filters once established, so their packets no longer reach user mode.
+        /// </summary>
+        /// <remarks>
+        /// This must be called while the gateway is stopped. Bypassed packets are not captured.
+        /// </remarks>
+        /// <returns>True if the setting was applied.</returns>
+        bool SetKernelBypass(bool enable);
+
+        /// <summary>
+        /// Enables or disables DNS forwarding through a SOCKS5 proxy.
+        /// When enabled, the DNS queries of the processes associated with the proxy are resolved
+        /// through the proxy and repeated lookups are answered from a local cache.
+        /// </summary>
+        /// <param name="proxy">The proxy handle.</param>
+        /// <param name="resolver">The upstream resolver (IP:Port) reached through the proxy, null or empty to disable.</param>
+        /// <param name="useTcp">Send the queries as DNS over TCP instead of over the proxy UDP relay.</param>
+        /// <remarks>
+        /// This must be called while the gateway is stopped.
+        /// </remarks>
+        /// <returns>True if the setting was applied.</returns>
+        bool SetDnsForwarding(IntPtr proxy, String^ resolver, bool useTcp);
+
         /// <summary>
         /// Adds a SOCKS5 proxy to the gateway.
         /// </summary>
@@ -182,6 +227,31 @@ namespace Socksifier
         IntPtr AddSocks5Proxy(String^ endpoint, String^ username, String^ password, SupportedProtocolsEnum protocols,
             bool start);
 
+        /// <summary>
+        /// Adds an alternative endpoint to a SOCKS5 proxy.
+        /// The endpoints of a proxy are probed in the background and new sessions skip the failed ones.
+        /// </summary>
+        /// <param name="proxy">The proxy handle.</param>
+        /// <param name="endpoint">The alternative endpoint (IP:Port), accepting the proxy credentials.</param>
+        /// <returns>True if the endpoint was added.</returns>
+        bool AddSocks5ProxyEndpoint(IntPtr proxy, String^ endpoint);
+
+        /// <summary>
+        /// Sets how new sessions of a SOCKS5 proxy choose among its endpoints.
+        /// </summary>
+        /// <param name="proxy">The proxy handle.</param>
+        /// <param name="leastSessions">Prefer the endpoint with the fewest active sessions instead of the lowest latency.</param>
+        /// <returns>True if the setting was applied.</returns>
+        bool SetProxySelection(IntPtr proxy, bool leastSessions);
+
+        /// <summary>
+        /// Returns a snapshot of the data path metrics: packet filter queue depths and processing time,
+        /// flow cache hit rate, process table refreshes, per-proxy sessions, bytes and handshake latency,
+        /// and buffer pool occupancy.
+        /// </summary>
+        /// <returns>The metrics in the Prometheus text exposition format.</returns>
+        String^ GetMetrics();
+
         /// <summary>
         /// Associates a process name with a specific proxy.
         /// </summary>
@@ -191,9 +261,27 @@ namespace Socksifier
         bool AssociateProcessNameToProxy(String^ processName, IntPtr proxy);
         bool ExcludeProcessName(String^ excludedEntry);
 
+        /// <summary>
+        /// Replaces the proxies, process associations, exclusions and LAN bypass while the gateway
+        /// keeps running. Proxies whose endpoint, credentials and protocols are unchanged keep their
+        /// sessions, the sessions of removed proxies are closed.
+        /// </summary>
+        /// <param name="proxies">The proxies and their processes.</param>
+        /// <param name="excludes">The excluded process names, may be null.</param>
+        /// <param name="bypassLan">Whether local network traffic bypasses the proxies.</param>
+        /// <returns>The proxy handle of each entry of proxies, or null if nothing was changed.</returns>
+        array<IntPtr>^ Reconfigure(array<Socks5ProxyConfiguration^>^ proxies, array<String^>^ excludes, bool bypassLan);
+
         // --- NEW: per-process destination CIDR include helpers (used by Program.cs) ---
         bool IncludeProcessDestinationCidr(String^ processName, String^ cidr);
         bool RemoveProcessDestinationCidr(String^ processName, String^ cidr);
+
+        // Bulk loading (IPv4 and IPv6 prefixes, policy rebuilt once per call). Lists are text with
+        // entries separated by whitespace, ',' or ';' and '#' comments; each returns the number of
+        // prefixes accepted (entries that fail to parse are skipped) or -1 on error.
+        Int32 IncludeProcessDestinationCidrs(String^ processName, array<String^>^ cidrs);
+        Int32 IncludeProcessDestinationCidrList(String^ processName, array<Byte>^ utf8List);
+        Int32 IncludeProcessDestinationCidrFile(String^ processName, String^ path);
         // ------------------------------------------------------------------------------
 
         property Int32 LogEventInterval
@@ -208,10 +296,24 @@ namespace Socksifier
             void set(const UInt32 value) { SetLogLimit(value); };
         }
 
+        /// <summary>
+        /// Number of log entries dropped because the native log buffer was full.
+        /// </summary>
+        /// <remarks>
+        /// The native log buffer is bounded; when the log handlers cannot keep up, new entries are
+        /// dropped and counted instead of being buffered. Each LogEvent batch following a loss
+        /// starts with a message reporting the number of entries lost.
+        /// </remarks>
+        property UInt64 LogDropped
+        {
+            UInt64 get() { return GetLogDropped(); }
+        }
+
     private:
         void log_thread();
         UInt32 GetLogLimit();
         void SetLogLimit(UInt32 value);
+        UInt64 GetLogDropped();
 
         static Socksifier^ instance_;
         socksify_unmanaged* unmanaged_ptr_{ nullptr };
@@ -4,17 +4,31 @@
  * @brief Thread-safe singleton logger for storing and managing log messages and events.
  *
  * The logger class provides a thread-safe mechanism for logging messages and events,
- * storing them in an internal buffer with a configurable limit. It supports log event
- * notification via a Windows event handle and provides a custom stream buffer for
- * integration with standard C++ streams.
+ * storing them in a bounded ring of log_record_mx records owned by the logger. The
+ * consumer reads the records in place with acquire_log()/release_log(), so draining the
+ * log neither copies nor allocates on the native side. When the consumer falls behind and
+ * the ring is full, new entries are dropped and counted instead of growing the buffer.
+ * It supports log event notification via a Windows event handle and provides a custom
+ * stream buffer for integration with standard C++ streams.
  */
 class logger
 {
-    static constexpr auto default_log_limit = 100; ///< Default maximum number of log entries to keep.
-    log_storage_mx_t log_storage_;                 ///< Container for storing log entries.
-    std::mutex log_storage_lock_;                  ///< Mutex for synchronizing access to log storage.
-    size_t log_limit_{ default_log_limit };          ///< Maximum number of log entries before signaling event.
-    HANDLE log_event_{ nullptr };                    ///< Windows event handle for log notifications.
+    static constexpr auto default_log_limit = 100;         ///< Default number of new log entries before signaling event.
+    static constexpr size_t log_buffer_size = 1024 * 1024;  ///< Size of the log ring in bytes.
+    static constexpr size_t max_message_length = 4096;      ///< Longer messages are truncated.
+
+    static_assert(log_buffer_size % log_record_mx::alignment == 0);
+    static_assert(log_record_mx::alignment >= sizeof(log_record_mx));
+
+    std::unique_ptr<char[]> log_buffer_{ std::make_unique<char[]>(log_buffer_size) }; ///< Log ring storage.
+    std::atomic<uint64_t> log_head_{ 0 };           ///< Ring position of the oldest record, advanced by the consumer.
+    std::atomic<uint64_t> log_tail_{ 0 };           ///< Ring position after the newest record, advanced by the producers.
+    std::atomic<uint64_t> log_dropped_{ 0 };        ///< Entries dropped because the ring was full.
+    uint64_t log_dropped_reported_{ 0 };            ///< Value of log_dropped_ reported with the previous span (consumer only).
+    std::mutex log_storage_lock_;                   ///< Serializes the producers.
+    size_t unsignaled_entries_{ 0 };                ///< Entries written since the event was last signaled.
+    size_t log_limit_{ default_log_limit };         ///< Number of new log entries before signaling event.
+    HANDLE log_event_{ nullptr };                   ///< Windows event handle for log notifications.
 
     /**
      * @brief Custom stream buffer for logging.
@@ -82,22 +96,17 @@ public:
      * @brief Logs a message.
      * @param log The message to log.
      *
-     * The message is timestamped and added to the log storage. If the log storage exceeds
-     * the configured limit and a log event handle is set, the event is signaled.
+     * The message is timestamped and added to the log ring. If more entries than the configured
+     * limit were added since the last notification, or the ring is half full, and a log event
+     * handle is set, the event is signaled.
      */
     void log_printer(const char* log)
     {
-        using namespace std::chrono;
-        const auto ms = duration_cast<milliseconds>(
-            system_clock::now().time_since_epoch()
-        );
+        const auto length = std::min(std::strlen(log), max_message_length);
 
         std::lock_guard lock(log_storage_lock_);
 
-        log_storage_.emplace_back(ms.count(), log);
-
-        if (log_event_ && log_storage_.size() > log_limit_)
-            ::SetEvent(log_event_);
+        write_record(log_record_kind_mx::message, 0, 0, log, length);
     }
 
     /**
@@ -105,64 +114,131 @@ public:
      * @param log_event The event to log.
      *
      * Supported event types are address_error, connected, and disconnected.
-     * The event is timestamped and added to the log storage. If the log storage exceeds
-     * the configured limit and a log event handle is set, the event is signaled.
+     * The event is timestamped and added to the log ring, see log_printer().
      */
     void log_event(const event_mx log_event)
     {
-        using namespace std::chrono;
-
         switch (log_event.type)
         {
         case event_type_mx::address_error:
         case event_type_mx::connected:
         case event_type_mx::disconnected:
         {
-            const auto ms = duration_cast<milliseconds>(
-                system_clock::now().time_since_epoch()
-            );
-
             std::lock_guard lock(log_storage_lock_);
 
-            log_storage_.emplace_back(ms.count(), log_event);
+            write_record(log_record_kind_mx::event, static_cast<uint16_t>(log_event.type), log_event.data, nullptr, 0);
         }
         break;
         }
+    }
 
-        if (log_event_ && log_storage_.size() > log_limit_)
-            ::SetEvent(log_event_);
+    /**
+     * @brief Returns the oldest contiguous run of records without copying them.
+     * @return Span of records, empty (with the drop count) if nothing is queued.
+     *
+     * The records stay in the ring until release_log() is called with the span. A wrapped
+     * ring is returned in two spans by consecutive calls. There must be a single consumer.
+     * A consumer that only drains span.queued bytes per pass stops at the records queued
+     * when the pass started, even while producers keep writing.
+     */
+    log_span_mx acquire_log()
+    {
+        const auto dropped = log_dropped_.load(std::memory_order_relaxed);
+        log_span_mx span{ nullptr, 0, dropped - log_dropped_reported_, 0 };
+        log_dropped_reported_ = dropped;
+
+        const auto head = log_head_.load(std::memory_order_relaxed);
+        const auto tail = log_tail_.load(std::memory_order_acquire);
+
+        if (head == tail)
+            return span;
+
+        const auto offset = head % log_buffer_size;
+
+        span.data = log_buffer_.get() + offset;
+        span.size = static_cast<size_t>(std::min<uint64_t>(tail - head, log_buffer_size - offset));
+        span.queued = tail - head;
+
+        return span;
+    }
+
+    /**
+     * @brief Returns the records of a span acquired with acquire_log() to the ring.
+     * @param span The span, its records must not be accessed afterwards.
+     */
+    void release_log(const log_span_mx& span)
+    {
+        log_head_.fetch_add(span.size, std::memory_order_release);
     }
 
     /**
      * @brief Reads and clears the log storage.
-     * @return Optional containing the log storage if not empty, otherwise std::nullopt.
+     * @return Optional containing the copied log entries if not empty, otherwise std::nullopt.
      *
-     * The returned log storage is moved out of the logger, clearing the internal buffer.
+     * Convenience for native callers, see acquire_log() for reading without copies. Dropped
+     * entries are reported as a message.
      */
     std::optional<log_storage_mx_t> read_log()
     {
-        using namespace std::chrono;
+        log_storage_mx_t log_storage;
 
-        std::lock_guard lock(log_storage_lock_);
+        auto span = acquire_log();
+
+        // Only the records queued on entry are read, so that busy producers cannot keep the caller here
+        for (auto remaining = span.queued; span.size != 0 || span.dropped != 0; span = acquire_log())
+        {
+            span.size = static_cast<size_t>(std::min<uint64_t>(span.size, remaining));
+
+            if (span.dropped != 0)
+            {
+                log_storage.emplace_back(now(),
+                    std::to_string(span.dropped) + " log entries were dropped because the log buffer was full\n");
+            }
+
+            for (size_t offset = 0; offset < span.size;)
+            {
+                const auto* record = reinterpret_cast<const log_record_mx*>(span.data + offset);
+                offset += record->size();
+
+                if (record->kind == log_record_kind_mx::message)
+                    log_storage.emplace_back(record->time_stamp, std::string(record->text(), record->length));
+                else if (record->kind == log_record_kind_mx::event)
+                    log_storage.emplace_back(record->time_stamp,
+                        event_mx{ static_cast<event_type_mx>(record->event), static_cast<size_t>(record->data) });
+            }
 
-        return log_storage_.empty() ? std::nullopt : std::make_optional(std::move(log_storage_));
+            release_log(span);
+
+            remaining -= span.size;
+            if (remaining == 0)
+                break;
+        }
+
+        return log_storage.empty() ? std::nullopt : std::make_optional(std::move(log_storage));
     }
 
     /**
-     * @brief Gets the size of the log storage.
-     * @return The number of log entries currently stored.
+     * @brief Gets the number of bytes queued in the log ring.
      */
-    size_t size()
+    size_t size() const
     {
-        std::lock_guard lock(log_storage_lock_);
-        return log_storage_.size();
+        return static_cast<size_t>(log_tail_.load(std::memory_order_acquire) - log_head_.load(std::memory_order_acquire));
+    }
+
+    /**
+     * @brief Gets the number of log entries dropped because the ring was full.
+     */
+    [[nodiscard]] uint64_t get_dropped() const
+    {
+        return log_dropped_.load(std::memory_order_relaxed);
     }
 
     /**
      * @brief Sets the log limit.
      * @param log_limit The new log limit.
      *
-     * When the number of log entries exceeds this limit, the log event is signaled (if set).
+     * When more entries than this limit were logged since the last notification, the log event
+     * is signaled (if set).
      */
     void set_log_limit(const uint32_t log_limit)
     {
@@ -182,7 +258,8 @@ public:
      * @brief Sets the log event handle.
      * @param log_event The log event handle.
      *
-     * The event is signaled when the log storage exceeds the configured limit.
+     * The event is signaled when the log limit is exceeded, when the ring passes half full and
+     * when an entry is dropped.
      */
     void set_log_event(const HANDLE log_event)
     {
@@ -205,4 +282,75 @@ public:
             }
         };
     }
+
+private:
+    /**
+     * @brief Returns the current time in milliseconds since the Unix epoch.
+     */
+    static long long now()
+    {
+        using namespace std::chrono;
+        return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief Appends a record to the ring or counts it as dropped. Called under log_storage_lock_.
+     */
+    void write_record(const log_record_kind_mx kind, const uint16_t event, const uint64_t data, const char* text,
+        const size_t length)
+    {
+        const auto size = log_record_mx::size_for(length);
+
+        const auto tail = log_tail_.load(std::memory_order_relaxed);
+        const auto head = log_head_.load(std::memory_order_acquire);
+
+        // A record never wraps: the end of the ring is filled with a padding record instead
+        const auto offset = tail % log_buffer_size;
+        const auto contiguous = log_buffer_size - offset;
+        const auto skip = contiguous < size ? contiguous : 0;
+
+        if (tail + skip + size - head > log_buffer_size)
+        {
+            log_dropped_.fetch_add(1, std::memory_order_relaxed);
+
+            // Signaled already unless entries were written since
+            if (unsignaled_entries_ != 0)
+                signal();
+
+            return;
+        }
+
+        if (skip != 0)
+        {
+            new (log_buffer_.get() + offset) log_record_mx{
+                0, 0, log_record_kind_mx::padding, 0, static_cast<uint32_t>(skip - sizeof(log_record_mx)) };
+        }
+
+        auto* record = new (log_buffer_.get() + (tail + skip) % log_buffer_size) log_record_mx{
+            now(), data, kind, event, static_cast<uint32_t>(length) };
+
+        if (length != 0)
+            std::memcpy(record + 1, text, length);
+
+        log_tail_.store(tail + skip + size, std::memory_order_release);
+
+        // Wake the consumer early once the ring passes half full
+        const auto used = tail + skip + size - head;
+
+        if (++unsignaled_entries_ > log_limit_ ||
+            (used > log_buffer_size / 2 && used - skip - size <= log_buffer_size / 2))
+            signal();
+    }
+
+    /**
+     * @brief Wakes the consumer. Called under log_storage_lock_.
+     */
+    void signal()
+    {
+        if (!log_event_)
+            return;
+
+        unsignaled_entries_ = 0;
+        ::SetEvent(log_event_);
+    }
 };
\ No newline at end of file
@@ -48,6 +48,19 @@ enum class supported_protocols_mx : uint8_t
     both = 2
 };
 
+/**
+ * @brief A SOCKS5 proxy and the processes routed through it, see socksify_unmanaged::reconfigure().
+ */
+struct proxy_configuration_mx
+{
+    std::string endpoint;                           ///< Primary endpoint in "IP:Port" format
+    std::vector<std::string> alternative_endpoints; ///< Alternative endpoints
+    supported_protocols_mx protocols;               ///< Proxied protocols
+    std::string login;                              ///< Username, empty without authentication
+    std::string password;                           ///< Password
+    std::vector<std::wstring> process_names;        ///< Processes routed through the proxy
+};
+
 /**
  * @brief Enumerates the types of events that can occur in the proxy gateway.
  */
@@ -71,4 +84,73 @@ struct event_mx
 };
 
 using log_entry_mx_t = std::variant<std::string, event_mx>;
-using log_storage_mx_t = std::vector<std::pair<long long, log_entry_mx_t>>;
\ No newline at end of file
+using log_storage_mx_t = std::vector<std::pair<long long, log_entry_mx_t>>;
+
+/**
+ * @brief Kinds of records in the native log ring.
+ */
+enum class log_record_kind_mx : uint16_t
+{
+    /// <summary>A text message.</summary>
+    message = 0,
+    /// <summary>A gateway event, see log_record_mx::event.</summary>
+    event = 1,
+    /// <summary>Unused space up to the end of the ring, to be skipped.</summary>
+    padding = 2,
+};
+
+/**
+ * @brief Header of a record in the native log ring, followed by length bytes of message text.
+ *
+ * Records are aligned to log_record_mx::alignment and stored back to back, see log_span_mx.
+ */
+struct log_record_mx
+{
+    long long time_stamp;       ///< Milliseconds since the Unix epoch
+    uint64_t data;              ///< Event data
+    log_record_kind_mx kind;    ///< Record kind
+    uint16_t event;             ///< event_type_mx of an event record
+    uint32_t length;            ///< Message length in bytes, not terminated
+
+    /// <summary>Alignment of the records in the ring, not smaller than the header so that the
+    /// unused end of the ring always has room for a padding record.</summary>
+    static constexpr size_t alignment = 32;
+
+    /**
+     * @brief Returns the size of a record with a message of the given length.
+     */
+    static constexpr size_t size_for(const size_t length) noexcept
+    {
+        return (sizeof(log_record_mx) + length + alignment - 1) & ~(alignment - 1);
+    }
+
+    /**
+     * @brief Returns the size of the record including its message and alignment padding.
+     */
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return size_for(length);
+    }
+
+    /**
+     * @brief Returns the message text (length bytes, not terminated).
+     */
+    [[nodiscard]] const char* text() const noexcept
+    {
+        return reinterpret_cast<const char*>(this + 1);
+    }
+};
+
+/**
+ * @brief Contiguous run of records acquired from the native log ring.
+ *
+ * The memory belongs to the ring and stays valid until the span is released; size is a multiple
+ * of log_record_mx::alignment and every record starts at the end of the previous one.
+ */
+struct log_span_mx
+{
+    const char* data;       ///< First record, nullptr if the span is empty
+    size_t size;            ///< Size of the records in bytes
+    uint64_t dropped;       ///< Entries dropped because the ring was full since the previous span
+    uint64_t queued;        ///< Size of all records queued when the span was acquired, including its own
+};
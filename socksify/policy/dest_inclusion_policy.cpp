@@ -14,14 +14,50 @@
 #include <unordered_map>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <iterator>    // prev, istreambuf_iterator
 #include <cstring>     // memcpy
-#include <cstdlib>     // atoi
+#include <charconv>    // from_chars
+#include <compare>
+#include <filesystem>
+#include <fstream>
 
 namespace {
-    struct CidrV4 {
-        uint32_t network; // host order
-        uint32_t mask;    // host order
+    // 128-bit IPv6 address in host order, compared as an unsigned integer
+    struct AddrV6 {
+        uint64_t hi;
+        uint64_t lo;
+
+        auto operator<=>(const AddrV6&) const = default;
+
+        AddrV6 operator~() const { return { ~hi, ~lo }; }
+        AddrV6 operator&(const AddrV6& o) const { return { hi & o.hi, lo & o.lo }; }
+        AddrV6 operator|(const AddrV6& o) const { return { hi | o.hi, lo | o.lo }; }
+    };
+
+    // a + 1, callers make sure a is not the all-ones address
+    uint32_t successor(uint32_t a) { return a + 1; }
+    AddrV6 successor(const AddrV6& a) { return { a.lo == ~0ull ? a.hi + 1 : a.hi, a.lo + 1 }; }
+
+    template <typename Addr>
+    struct Cidr {
+        Addr network; // host order
+        Addr mask;    // host order
+
+        bool operator==(const Cidr&) const = default;
+    };
+
+    using CidrV4 = Cidr<uint32_t>;
+    using CidrV6 = Cidr<AddrV6>;
+
+    // One parsed prefix of either family
+    struct AnyCidr {
+        int family{ AF_UNSPEC };
+        CidrV4 v4{};
+        CidrV6 v6{};
     };
 
     // lower-case exe name ("chrome.exe")
@@ -35,25 +71,58 @@ namespace {
 
     // keep only the file name (no path)
     std::wstring basename_exe(const std::wstring& full) {
-        size_t p = full.find_last_of(L"\\/"); 
+        size_t p = full.find_last_of(L"\\/");
         if (p == std::wstring::npos) return to_lower(full);
         return to_lower(full.substr(p + 1));
     }
 
-    bool parse_cidr_v4(const char* cidr, CidrV4& out) {
-        if (!cidr || !*cidr) return false;
+    AddrV6 addr_v6_from_bytes(const unsigned char (&bytes)[16]) {
+        AddrV6 a{};
+        for (int i = 0; i < 8; ++i) a.hi = (a.hi << 8) | bytes[i];
+        for (int i = 8; i < 16; ++i) a.lo = (a.lo << 8) | bytes[i];
+        return a;
+    }
+
+    AddrV6 mask_v6(int prefix) {
+        if (prefix == 0) return { 0, 0 };
+        if (prefix <= 64) return { ~0ull << (64 - prefix), 0 };
+        if (prefix == 128) return { ~0ull, ~0ull };
+        return { ~0ull, ~0ull << (128 - prefix) };
+    }
 
-        const char* slash = std::strchr(cidr, '/');
-        if (!slash) return false;
+    // "a.b.c.d/n" or "x:y::z/n"; an address without a prefix length is a host (/32, /128)
+    bool parse_cidr(std::string_view cidr, AnyCidr& out) {
+        if (cidr.empty()) return false;
+
+        const size_t slash = cidr.find('/');
+        const std::string_view ip = cidr.substr(0, slash);
 
         char ipbuf[64] = {0};
-        size_t iplen = static_cast<size_t>(slash - cidr);
-        if (iplen >= sizeof ipbuf) return false;
-        std::memcpy(ipbuf, cidr, iplen);
-        ipbuf[iplen] = '\0';
+        if (ip.empty() || ip.size() >= sizeof ipbuf) return false;
+        std::memcpy(ipbuf, ip.data(), ip.size());
+
+        const bool v6 = ip.find(':') != std::string_view::npos;
+        const int max_prefix = v6 ? 128 : 32;
+
+        int prefix = max_prefix;
+        if (slash != std::string_view::npos) {
+            const char* first = cidr.data() + slash + 1;
+            const char* last = cidr.data() + cidr.size();
+            auto [end, ec] = std::from_chars(first, last, prefix);
+            if (ec != std::errc{} || end != last || first == last) return false;
+            if (prefix < 0 || prefix > max_prefix) return false;
+        }
+
+        if (v6) {
+            IN6_ADDR ia{};
+            if (InetPtonA(AF_INET6, ipbuf, &ia) != 1) return false;
 
-        int prefix = std::atoi(slash + 1);
-        if (prefix < 0 || prefix > 32) return false;
+            const AddrV6 mask = mask_v6(prefix);
+            out.family = AF_INET6;
+            out.v6.network = addr_v6_from_bytes(ia.u.Byte) & mask;
+            out.v6.mask    = mask;
+            return true;
+        }
 
         IN_ADDR ia{};
         if (InetPtonA(AF_INET, ipbuf, &ia) != 1) return false;
@@ -62,90 +131,331 @@ namespace {
         uint32_t net    = ntohl(net_be);      // host order
 
         uint32_t mask = (prefix == 0) ? 0u : (0xFFFFFFFFu << (32 - prefix));
-        out.network = net & mask;
-        out.mask    = mask;
+        out.family     = AF_INET;
+        out.v4.network = net & mask;
+        out.v4.mask    = mask;
         return true;
     }
 
-    bool ipv4_from_sockaddr(const sockaddr* sa, int salen, uint32_t& ip_out_host) {
-        if (!sa || salen < static_cast<int>(sizeof(sockaddr_in))) return false;
-        if (sa->sa_family != AF_INET) return false;
-        auto sin = reinterpret_cast<const sockaddr_in*>(sa);
-        ip_out_host = ntohl(sin->sin_addr.S_un.S_addr);
+    bool parse_cidr(const char* cidr, AnyCidr& out) {
+        return cidr && parse_cidr(std::string_view(cidr), out);
+    }
+
+    // Destination of either family; IPv4-mapped IPv6 addresses (::ffff:a.b.c.d) are read as IPv4
+    bool address_from_sockaddr(const sockaddr* sa, int salen, int& family, uint32_t& v4_host, AddrV6& v6_host) {
+        if (!sa) return false;
+
+        if (sa->sa_family == AF_INET && salen >= static_cast<int>(sizeof(sockaddr_in))) {
+            auto sin = reinterpret_cast<const sockaddr_in*>(sa);
+            family = AF_INET;
+            v4_host = ntohl(sin->sin_addr.S_un.S_addr);
+            return true;
+        }
+
+        if (sa->sa_family == AF_INET6 && salen >= static_cast<int>(sizeof(sockaddr_in6))) {
+            auto sin6 = reinterpret_cast<const sockaddr_in6*>(sa);
+            v6_host = addr_v6_from_bytes(sin6->sin6_addr.u.Byte);
+            if (v6_host.hi == 0 && (v6_host.lo >> 32) == 0xFFFFu) {
+                family = AF_INET;
+                v4_host = static_cast<uint32_t>(v6_host.lo);
+            } else {
+                family = AF_INET6;
+            }
+            return true;
+        }
+
+        return false;
+    }
+
+    // ordering of the rule lists: by network, wider prefix first
+    template <typename Addr>
+    bool cidr_less(const Cidr<Addr>& a, const Cidr<Addr>& b) {
+        return a.network != b.network ? a.network < b.network : a.mask < b.mask;
+    }
+
+    // Address range [first, last] covered by one or more CIDRs (host order)
+    template <typename Addr>
+    struct Range {
+        Addr first;
+        Addr last;
+    };
+
+    // Sorted, disjoint, non-adjacent ranges: a lookup is one binary search
+    template <typename Addr>
+    using RangeSet = std::vector<Range<Addr>>;
+
+    // rules must be sorted with cidr_less; overlapping and adjacent prefixes are merged
+    template <typename Addr>
+    std::shared_ptr<const RangeSet<Addr>> compile_ranges(const std::vector<Cidr<Addr>>& rules) {
+        if (rules.empty()) return nullptr;
+
+        auto ranges = std::make_shared<RangeSet<Addr>>();
+        ranges->reserve(rules.size());
+
+        for (const auto& c : rules) {
+            const Addr first = c.network;
+            const Addr last  = c.network | ~c.mask;
+
+            if (!ranges->empty()) {
+                auto& back = ranges->back();
+                if (back.last == ~Addr{}) break; // covers every later rule
+                if (first <= successor(back.last)) {
+                    back.last = std::max(back.last, last);
+                    continue;
+                }
+            }
+
+            ranges->push_back({ first, last });
+        }
+
+        ranges->shrink_to_fit();
+        return ranges;
+    }
+
+    template <typename Addr>
+    bool contains(const RangeSet<Addr>& ranges, const Addr& ip_host) {
+        // first range starting above ip; the one before it is the only candidate
+        auto it = std::upper_bound(ranges.begin(), ranges.end(), ip_host,
+                                   [](const Addr& ip, const Range<Addr>& r){ return ip < r.first; });
+        return it != ranges.begin() && ip_host <= std::prev(it)->last;
+    }
+
+    // Rule lists of one process (or the globals), sorted with cidr_less and unique
+    struct RuleLists {
+        std::vector<CidrV4> v4;
+        std::vector<CidrV6> v6;
+    };
+
+    // Compiled rule lists, null: no rules of that family
+    struct CompiledRules {
+        std::shared_ptr<const RangeSet<uint32_t>> v4;
+        std::shared_ptr<const RangeSet<AddrV6>> v6;
+    };
+
+    // Immutable lookup structure, replaced as a whole on every change
+    struct CompiledPolicy {
+        CompiledRules globals;
+        std::vector<CompiledRules> by_key;                       // index: process key
+    };
+
+    template <typename Addr>
+    bool insert_rule(std::vector<Cidr<Addr>>& vec, const Cidr<Addr>& c) {
+        auto it = std::lower_bound(vec.begin(), vec.end(), c, cidr_less<Addr>);
+        if (it != vec.end() && *it == c) return false;
+        vec.insert(it, c);
         return true;
     }
 
+    template <typename Addr>
+    bool erase_rule(std::vector<Cidr<Addr>>& vec, const Cidr<Addr>& c) {
+        auto it = std::lower_bound(vec.begin(), vec.end(), c, cidr_less<Addr>);
+        if (it == vec.end() || !(*it == c)) return false;
+        vec.erase(it);
+        return true;
+    }
+
+    // Appends a batch and restores the order once; returns true if the list changed
+    template <typename Addr>
+    bool merge_rules(std::vector<Cidr<Addr>>& vec, const std::vector<Cidr<Addr>>& batch) {
+        if (batch.empty()) return false;
+        const size_t before = vec.size();
+        vec.insert(vec.end(), batch.begin(), batch.end());
+        std::sort(vec.begin(), vec.end(), cidr_less<Addr>);
+        vec.erase(std::unique(vec.begin(), vec.end()), vec.end());
+        return vec.size() != before;
+    }
+
+    bool insert_rule(RuleLists& lists, const AnyCidr& c) {
+        return c.family == AF_INET6 ? insert_rule(lists.v6, c.v6) : insert_rule(lists.v4, c.v4);
+    }
+
+    bool erase_rule(RuleLists& lists, const AnyCidr& c) {
+        return c.family == AF_INET6 ? erase_rule(lists.v6, c.v6) : erase_rule(lists.v4, c.v4);
+    }
+
+    // Parses a prefix list: entries separated by whitespace, ',' or ';', '#' comments to end of line
+    RuleLists parse_list(std::string_view text, int& accepted, int& rejected) {
+        RuleLists batch;
+
+        // UTF-8 BOM of files saved by Notepad et al.
+        if (text.size() >= 3 && text.substr(0, 3) == "\xEF\xBB\xBF") text.remove_prefix(3);
+
+        const auto is_separator = [](char c) {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',' || c == ';';
+        };
+
+        size_t i = 0;
+        while (i < text.size()) {
+            if (is_separator(text[i])) { ++i; continue; }
+
+            if (text[i] == '#') {
+                const size_t eol = text.find('\n', i);
+                i = eol == std::string_view::npos ? text.size() : eol + 1;
+                continue;
+            }
+
+            size_t end = i;
+            while (end < text.size() && !is_separator(text[end]) && text[end] != '#') ++end;
+
+            AnyCidr c{};
+            if (parse_cidr(text.substr(i, end - i), c)) {
+                if (c.family == AF_INET6) batch.v6.push_back(c.v6);
+                else batch.v4.push_back(c.v4);
+                ++accepted;
+            } else {
+                ++rejected;
+            }
+            i = end;
+        }
+
+        return batch;
+    }
+
     struct PolicyStore {
+        // Serializes changes and key assignment; lookups by key never take it
         std::mutex m;
-        std::unordered_map<std::wstring, std::vector<CidrV4>> by_proc; // key: "chrome.exe"
-        std::vector<CidrV4> globals;
+        std::unordered_map<std::wstring, int> keys;              // "chrome.exe" -> key, never reused
+        std::vector<RuleLists> by_key;                           // rule lists, index: key (0 unused)
+        RuleLists globals;
+
+        std::atomic<std::shared_ptr<const CompiledPolicy>> compiled{ std::make_shared<const CompiledPolicy>() };
+        std::atomic<uint64_t> version{ 1 };                      // bumped after each publish
+
+        PolicyStore() : by_key(1) {}
+
+        // m must be held
+        int intern(const std::wstring& exe) {
+            auto [it, inserted] = keys.try_emplace(exe, static_cast<int>(by_key.size()));
+            if (inserted) by_key.emplace_back();
+            return it->second;
+        }
+
+        // m must be held; key 0: globals
+        RuleLists& lists_for(int key) {
+            return key == 0 ? globals : by_key[key];
+        }
+
+        // m must be held; recompiles the changed rule lists (key 0: globals), shares the others
+        void publish(int changed_key) {
+            auto next = std::make_shared<CompiledPolicy>(*compiled.load(std::memory_order_acquire));
+
+            const RuleLists& lists = lists_for(changed_key);
+            CompiledRules rules{ compile_ranges(lists.v4), compile_ranges(lists.v6) };
+
+            if (changed_key == 0) {
+                next->globals = std::move(rules);
+            } else {
+                next->by_key.resize(by_key.size());
+                next->by_key[changed_key] = std::move(rules);
+            }
+
+            compiled.store(std::move(next), std::memory_order_release);
+            version.fetch_add(1, std::memory_order_release);
+        }
+
+        // Returns the current snapshot, refreshing the calling thread's reference (one locked
+        // shared_ptr copy) only after a change, so a steady-state lookup is a plain atomic load
+        const CompiledPolicy& current() const {
+            struct thread_cache {
+                uint64_t version{ 0 };
+                std::shared_ptr<const CompiledPolicy> snapshot;
+            };
+            thread_local thread_cache cache;
+
+            if (const auto v = version.load(std::memory_order_acquire); cache.version != v) {
+                cache.snapshot = compiled.load(std::memory_order_acquire);
+                cache.version = v;
+            }
+            return *cache.snapshot;
+        }
 
         bool add_proc(const std::wstring& exe, const char* cidr) {
-            CidrV4 c{};
-            if (!parse_cidr_v4(cidr, c)) return false;
+            AnyCidr c{};
+            if (!parse_cidr(cidr, c)) return false;
             std::lock_guard<std::mutex> g(m);
-            by_proc[exe].push_back(c);
+            const int key = intern(exe);
+            if (insert_rule(by_key[key], c)) publish(key);
             return true;
         }
         bool rem_proc(const std::wstring& exe, const char* cidr) {
-            CidrV4 c{};
-            if (!parse_cidr_v4(cidr, c)) return false;
+            AnyCidr c{};
+            if (!parse_cidr(cidr, c)) return false;
             std::lock_guard<std::mutex> g(m);
-            auto it = by_proc.find(exe);
-            if (it == by_proc.end()) return false;
-            auto& vec = it->second;
-            vec.erase(std::remove_if(vec.begin(), vec.end(),
-                        [&](const CidrV4& x){ return x.network==c.network && x.mask==c.mask; }),
-                      vec.end());
-            if (vec.empty()) by_proc.erase(it);
+            auto it = keys.find(exe);
+            if (it == keys.end()) return false;
+            auto& lists = by_key[it->second];
+            if (lists.v4.empty() && lists.v6.empty()) return false;
+            if (erase_rule(lists, c)) publish(it->second);
             return true;
         }
         bool add_global(const char* cidr) {
-            CidrV4 c{};
-            if (!parse_cidr_v4(cidr, c)) return false;
+            AnyCidr c{};
+            if (!parse_cidr(cidr, c)) return false;
             std::lock_guard<std::mutex> g(m);
-            globals.push_back(c);
+            if (insert_rule(globals, c)) publish(0);
             return true;
         }
         bool rem_global(const char* cidr) {
-            CidrV4 c{};
-            if (!parse_cidr_v4(cidr, c)) return false;
+            AnyCidr c{};
+            if (!parse_cidr(cidr, c)) return false;
             std::lock_guard<std::mutex> g(m);
-            auto& vec = globals;
-            vec.erase(std::remove_if(vec.begin(), vec.end(),
-                        [&](const CidrV4& x){ return x.network==c.network && x.mask==c.mask; }),
-                      vec.end());
+            if (erase_rule(globals, c)) publish(0);
             return true;
         }
 
-        static bool match_any(const std::vector<CidrV4>& list, uint32_t ip_host) {
-            for (const auto& c : list) {
-                if ((ip_host & c.mask) == c.network) return true;
-            }
-            return false;
+        // Parses outside the lock, then merges and recompiles once; exe empty: globals
+        int add_list(const std::wstring* exe, std::string_view text, int* rejected_out) {
+            int accepted = 0, rejected = 0;
+            const RuleLists batch = parse_list(text, accepted, rejected);
+            if (rejected_out) *rejected_out = rejected;
+
+            std::lock_guard<std::mutex> g(m);
+            const int key = exe ? intern(*exe) : 0;
+            auto& lists = lists_for(key);
+            const bool changed_v4 = merge_rules(lists.v4, batch.v4);
+            const bool changed_v6 = merge_rules(lists.v6, batch.v6);
+            if (changed_v4 || changed_v6) publish(key);
+            return accepted;
         }
 
-        // returns 1 = redirect, 0 = passthrough
-        int should_redirect(const wchar_t* process_name_or_null,
-                            const sockaddr* dst, int dstlen) {
-            uint32_t ip_host{};
-            // If we can't read IPv4 from sockaddr, keep current behavior: redirect.
-            if (!ipv4_from_sockaddr(dst, dstlen, ip_host)) return 1;
+        int key_for(const std::wstring& exe) {
+            std::lock_guard<std::mutex> g(m);
+            return intern(exe);
+        }
 
+        int find_key(const std::wstring& exe) {
             std::lock_guard<std::mutex> g(m);
+            auto it = keys.find(exe);
+            return it != keys.end() ? it->second : 0;
+        }
+
+        // returns 1 = redirect, 0 = passthrough; key 0 = no (known) process
+        int should_redirect(int key, const sockaddr* dst, int dstlen) const {
+            int family = AF_UNSPEC;
+            uint32_t v4_host{};
+            AddrV6 v6_host{};
+            // If we can't read an address from sockaddr, keep current behavior: redirect.
+            if (!address_from_sockaddr(dst, dstlen, family, v4_host, v6_host)) return 1;
+
+            const auto& policy = current();
+            const CompiledRules* process = (key > 0 && static_cast<size_t>(key) < policy.by_key.size())
+                ? &policy.by_key[key] : nullptr;
+
+            if (family == AF_INET)
+                return decide(policy.globals.v4.get(), process ? process->v4.get() : nullptr, v4_host);
 
+            return decide(policy.globals.v6.get(), process ? process->v6.get() : nullptr, v6_host);
+        }
+
+        // Rules of the destination's family only: a process with IPv4 rules alone keeps
+        // redirecting its IPv6 traffic, as before IPv6 prefixes were accepted
+        template <typename Addr>
+        static int decide(const RangeSet<Addr>* globals_set, const RangeSet<Addr>* process_set, const Addr& ip_host) {
             // Global rules first (you said you won't use them; this is harmless if empty)
-            if (!globals.empty() && match_any(globals, ip_host)) return 1;
-
-            // Per-process rules
-            if (process_name_or_null && *process_name_or_null) {
-                auto key = basename_exe(process_name_or_null);
-                auto it = by_proc.find(key);
-                if (it != by_proc.end()) {
-                    // match => redirect, no match => passthrough
-                    return match_any(it->second, ip_host) ? 1 : 0;
-                }
-            }
+            if (globals_set && contains(*globals_set, ip_host)) return 1;
+
+            // Per-process rules: match => redirect, no match => passthrough
+            if (process_set) return contains(*process_set, ip_host) ? 1 : 0;
 
             // No specific rules found: keep existing behavior (redirect).
             return 1;
@@ -156,6 +466,14 @@ namespace {
         static PolicyStore s;
         return s;
     }
+
+    // Whole file as bytes; false if it cannot be read
+    bool read_file(const wchar_t* path, std::string& out) {
+        std::ifstream in(std::filesystem::path(path), std::ios::binary);
+        if (!in) return false;
+        out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        return !in.bad();
+    }
 } // namespace
 
 // ---- C exports -------------------------------------------------------------
@@ -180,7 +498,41 @@ int DIP_CALL dip_remove_global(const char* cidr) {
     return store().rem_global(cidr) ? 1 : 0;
 }
 
+int DIP_CALL dip_add_process_list(const wchar_t* process_name, const char* text, size_t length, int* rejected) {
+    if (rejected) *rejected = 0;
+    if (!process_name || !*process_name || (!text && length != 0)) return -1;
+    const std::wstring exe = basename_exe(process_name);
+    return store().add_list(&exe, std::string_view(text ? text : "", length), rejected);
+}
+
+int DIP_CALL dip_add_process_file(const wchar_t* process_name, const wchar_t* path, int* rejected) {
+    if (rejected) *rejected = 0;
+    if (!process_name || !*process_name || !path) return -1;
+    std::string text;
+    if (!read_file(path, text)) return -1;
+    const std::wstring exe = basename_exe(process_name);
+    return store().add_list(&exe, text, rejected);
+}
+
+int DIP_CALL dip_add_global_list(const char* text, size_t length, int* rejected) {
+    if (rejected) *rejected = 0;
+    if (!text && length != 0) return -1;
+    return store().add_list(nullptr, std::string_view(text ? text : "", length), rejected);
+}
+
+int DIP_CALL dip_process_key(const wchar_t* process_name) {
+    if (!process_name || !*process_name) return 0;
+    return store().key_for(basename_exe(process_name));
+}
+
+int DIP_CALL dip_should_redirect_for_key(int process_key, const sockaddr* dst, int dstlen) {
+    return store().should_redirect(process_key, dst, dstlen);
+}
+
 int DIP_CALL dip_should_redirect_for(const wchar_t* process_name_or_null,
                                      const sockaddr* dst, int dstlen) {
-    return store().should_redirect(process_name_or_null, dst, dstlen);
+    // Looked up without interning, so arbitrary names cannot grow the key table
+    const int key = (process_name_or_null && *process_name_or_null)
+        ? store().find_key(basename_exe(process_name_or_null)) : 0;
+    return store().should_redirect(key, dst, dstlen);
 }
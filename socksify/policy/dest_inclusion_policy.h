@@ -3,6 +3,8 @@
 // Windows-light header for a tiny C API.
 // NOTE: Do NOT include Windows headers here; the .cpp will pull in Winsock.
 
+#include <stddef.h>
+
 struct sockaddr;
 
 #if defined(_WIN32)
@@ -13,6 +15,7 @@ struct sockaddr;
   #define DIP_CALL
 #endif
 
+// Prefixes are IPv4 ("10.0.0.0/8") or IPv6 ("2001:db8::/32"); a bare address is a host prefix.
 // Returns 1 on success, 0 on failure.
 DIP_API int DIP_CALL dip_add_process(const wchar_t* process_name, const char* cidr);
 DIP_API int DIP_CALL dip_remove_process(const wchar_t* process_name, const char* cidr);
@@ -21,7 +24,23 @@ DIP_API int DIP_CALL dip_remove_process(const wchar_t* process_name, const char*
 DIP_API int DIP_CALL dip_add_global(const char* cidr);
 DIP_API int DIP_CALL dip_remove_global(const char* cidr);
 
+// Bulk loading: a list of prefixes separated by whitespace, ',' or ';' with '#' comments to the
+// end of the line (one prefix per line GeoIP exports load as is). The whole list is added under
+// one lock and the lookup index is rebuilt once. Returns the number of prefixes accepted (already
+// present ones included) or -1 on invalid arguments/unreadable file; if rejected is not null it
+// receives the number of entries that failed to parse, which are skipped.
+DIP_API int DIP_CALL dip_add_process_list(const wchar_t* process_name, const char* text, size_t length,
+                                          int* rejected);
+DIP_API int DIP_CALL dip_add_process_file(const wchar_t* process_name, const wchar_t* path, int* rejected);
+DIP_API int DIP_CALL dip_add_global_list(const char* text, size_t length, int* rejected);
+
 // Decision hook (kept for completeness if you ever wire it in the router).
 // Return 1 to redirect, 0 to passthrough.
 DIP_API int DIP_CALL dip_should_redirect_for(const wchar_t* process_name_or_null,
                                              const sockaddr* dst, int dstlen);
+
+// Per-packet variant: resolve the key once per process with dip_process_key(), then decide
+// with dip_should_redirect_for_key(), which takes no lock and does no string work.
+// Keys are never reused; 0 means no process (invalid name).
+DIP_API int DIP_CALL dip_process_key(const wchar_t* process_name);
+DIP_API int DIP_CALL dip_should_redirect_for_key(int process_key, const sockaddr* dst, int dstlen);
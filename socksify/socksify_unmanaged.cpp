@@ -97,13 +97,17 @@ socksify_unmanaged::socksify_unmanaged(const log_level_mx log_level) :
 
     // Wire destination-policy decider (optional gate).
     // Normalizes process name to match policy keys added from Program.cs (e.g., "rdcman", "mstsc").
-    proxy_->set_redirect_decider([](const std::wstring& proc,
-                                    const sockaddr* sa,
-                                    int salen) -> bool
-    {
-        const std::wstring key = normalize_process_key(proc);
-        return dip_should_redirect_for(key.c_str(), sa, salen) == 1;
-    });
+    // The router memoizes the interned key per process, so packets skip the string work.
+    proxy_->set_redirect_decider(
+        [](const std::wstring& proc) -> uint32_t
+        {
+            const std::wstring key = normalize_process_key(proc);
+            return static_cast<uint32_t>(dip_process_key(key.c_str()));
+        },
+        [](const uint32_t key, const sockaddr* sa, int salen) -> bool
+        {
+            return dip_should_redirect_for_key(static_cast<int>(key), sa, salen) == 1;
+        });
 
     print_log(log_level_mx::info, "SOCKS5 Local Router instance successfully created."s);
 }
@@ -137,8 +141,12 @@ bool socksify_unmanaged::start() const
     using namespace std::string_literals;
     std::lock_guard lock(lock_->lock);
 
+    // Move netlib log formatting and output off the packet and I/O threads while running
+    netlib::log::async_log_backend::instance().start();
+
     if (!proxy_->start())
     {
+        netlib::log::async_log_backend::instance().stop();
         print_log(log_level_mx::info, "[ERROR]: Failed to start the SOCKS5 Local Router instance!"s);
         return false;
     }
@@ -169,6 +177,9 @@ bool socksify_unmanaged::stop() const
         return false;
     }
 
+    // Write out the queued netlib messages and return to synchronous logging
+    netlib::log::async_log_backend::instance().stop();
+
     print_log(log_level_mx::info, "SOCKS5 Local Router instance stopped successfully."s);
 
     return true;
@@ -186,6 +197,47 @@ void socksify_unmanaged::set_bypass_lan() const
     }
 }
 
+/**
+ * @brief Enables or disables passing busy unproxied flows in the driver.
+ * Must be called while the gateway is stopped.
+ */
+bool socksify_unmanaged::set_kernel_bypass(const bool enable) const
+{
+    if (!proxy_)
+        return false;
+
+    return proxy_->set_kernel_bypass(enable
+        ? std::optional(proxy::kernel_bypass_table<net::ip_address_v4>::options{})
+        : std::nullopt);
+}
+
+/**
+ * @brief Enables or disables DNS forwarding through a SOCKS5 proxy.
+ * Must be called while the gateway is stopped.
+ */
+bool socksify_unmanaged::set_dns_forwarding(const LONG_PTR proxy_id, const std::string& resolver,
+    const bool use_tcp) const
+{
+    using dns_forwarder = proxy::socks5_dns_forwarder<net::ip_address_v4>;
+
+    if (!proxy_)
+        return false;
+
+    if (resolver.empty())
+        return proxy_->set_dns_forwarding(static_cast<size_t>(proxy_id), std::nullopt);
+
+    const auto endpoint = proxy::socks_local_router::parse_endpoint(resolver);
+    if (!endpoint)
+        return false;
+
+    dns_forwarder::options options;
+    options.resolver = endpoint->ip;
+    options.resolver_port = endpoint->port;
+    options.upstream = use_tcp ? dns_forwarder::transport::tcp : dns_forwarder::transport::udp;
+
+    return proxy_->set_dns_forwarding(static_cast<size_t>(proxy_id), options);
+}
+
 /**
  * @brief Adds a SOCKS5 proxy to the gateway.
  */
@@ -226,6 +278,44 @@ LONG_PTR socksify_unmanaged::add_socks5_proxy(
     return -1;
 }
 
+/**
+ * @brief Adds an alternative endpoint to a SOCKS5 proxy.
+ */
+bool socksify_unmanaged::add_socks5_proxy_endpoint(const LONG_PTR proxy_id, const std::string& endpoint) const
+{
+    if (!proxy_)
+        return false;
+
+    return proxy_->add_socks5_proxy_endpoint(static_cast<size_t>(proxy_id), endpoint);
+}
+
+/**
+ * @brief Sets how new sessions of a SOCKS5 proxy choose among its endpoints.
+ */
+bool socksify_unmanaged::set_proxy_selection(const LONG_PTR proxy_id, const bool least_sessions) const
+{
+    using proxy_group = proxy::proxy_group;
+
+    if (!proxy_)
+        return false;
+
+    proxy_group::options options;
+    options.policy = least_sessions ? proxy_group::selection::least_sessions : proxy_group::selection::lowest_latency;
+
+    return proxy_->set_proxy_selection(static_cast<size_t>(proxy_id), options);
+}
+
+/**
+ * @brief Returns a snapshot of the data path metrics in the Prometheus text format.
+ */
+std::string socksify_unmanaged::get_metrics() const
+{
+    if (!proxy_)
+        return {};
+
+    return proxy_->get_prometheus_metrics();
+}
+
 /**
  * @brief Associates a process name with a specific proxy.
  */
@@ -244,7 +334,56 @@ bool socksify_unmanaged::exclude_process_name(const std::wstring& process_name)
 }
 
 /**
- * @brief Sets the maximum number of log entries to keep.
+ * @brief Replaces the configuration of the running gateway, see socks_local_router::reconfigure().
+ */
+std::optional<std::vector<LONG_PTR>> socksify_unmanaged::reconfigure(
+    const std::vector<proxy_configuration_mx>& proxies,
+    const std::vector<std::wstring>& excludes,
+    const bool bypass_lan) const
+{
+    using router = proxy::socks_local_router;
+
+    if (!proxy_)
+        return std::nullopt;
+
+    router::configuration config;
+    config.excluded_process_names = excludes;
+    config.bypass_lan = bypass_lan;
+    config.proxies.reserve(proxies.size());
+
+    for (const auto& proxy : proxies)
+    {
+        auto& entry = config.proxies.emplace_back();
+        entry.endpoint = proxy.endpoint;
+        entry.alternative_endpoints = proxy.alternative_endpoints;
+        entry.process_names = proxy.process_names;
+
+        switch (proxy.protocols)
+        {
+        case supported_protocols_mx::tcp:
+            entry.protocols = router::supported_protocols::tcp;
+            break;
+        case supported_protocols_mx::udp:
+            entry.protocols = router::supported_protocols::udp;
+            break;
+        case supported_protocols_mx::both:
+            entry.protocols = router::supported_protocols::both;
+            break;
+        }
+
+        if (!proxy.login.empty())
+            entry.credentials = std::make_pair(proxy.login, proxy.password);
+    }
+
+    const auto proxy_ids = proxy_->reconfigure(config);
+    if (!proxy_ids)
+        return std::nullopt;
+
+    return std::vector<LONG_PTR>(proxy_ids->begin(), proxy_ids->end());
+}
+
+/**
+ * @brief Sets the number of new log entries that signals the log event.
  */
 void socksify_unmanaged::set_log_limit(const uint32_t log_limit)
 {
@@ -275,6 +414,30 @@ log_storage_mx_t socksify_unmanaged::read_log()
     return logger::get_instance()->read_log().value_or(log_storage_mx_t{});
 }
 
+/**
+ * @brief Returns the oldest contiguous run of queued log records.
+ */
+log_span_mx socksify_unmanaged::acquire_log()
+{
+    return logger::get_instance()->acquire_log();
+}
+
+/**
+ * @brief Frees the log records of a span returned by acquire_log().
+ */
+void socksify_unmanaged::release_log(const log_span_mx& span)
+{
+    logger::get_instance()->release_log(span);
+}
+
+/**
+ * @brief Gets the number of dropped log entries.
+ */
+uint64_t socksify_unmanaged::get_log_dropped()
+{
+    return logger::get_instance()->get_dropped();
+}
+
 /**
  * @brief Static helper for printing log messages.
  */
@@ -304,16 +467,59 @@ void socksify_unmanaged::print_log(const log_level_mx level, const std::string&
 }
 
 // ---------- per-process CIDR policy forwards ----------
+/**
+ * @brief Drops the routing decisions cached by the router after a change of the destination
+ * policy, which feeds its redirect decider.
+ */
+void socksify_unmanaged::on_destination_policy_changed() const
+{
+    if (proxy_)
+        proxy_->invalidate_flow_cache();
+}
+
 bool socksify_unmanaged::include_process_dst_cidr(const std::wstring& process_name,
                                                   const std::string& cidr) const
 {
-    return dip_add_process(process_name.c_str(), cidr.c_str()) == 1;
+    if (dip_add_process(process_name.c_str(), cidr.c_str()) != 1)
+        return false;
+
+    on_destination_policy_changed();
+
+    return true;
 }
 
 bool socksify_unmanaged::remove_process_dst_cidr(const std::wstring& process_name,
                                                  const std::string& cidr) const
 {
-    return dip_remove_process(process_name.c_str(), cidr.c_str()) == 1;
+    if (dip_remove_process(process_name.c_str(), cidr.c_str()) != 1)
+        return false;
+
+    on_destination_policy_changed();
+
+    return true;
+}
+
+int socksify_unmanaged::include_process_dst_cidrs(const std::wstring& process_name,
+                                                  const std::string_view cidr_list, int* rejected) const
+{
+    const auto accepted = dip_add_process_list(process_name.c_str(), cidr_list.data(), cidr_list.size(),
+                                               rejected);
+
+    if (accepted > 0)
+        on_destination_policy_changed();
+
+    return accepted;
+}
+
+int socksify_unmanaged::include_process_dst_cidr_file(const std::wstring& process_name,
+                                                      const std::wstring& path, int* rejected) const
+{
+    const auto accepted = dip_add_process_file(process_name.c_str(), path.c_str(), rejected);
+
+    if (accepted > 0)
+        on_destination_policy_changed();
+
+    return accepted;
 }
 // -----------------------------------------------------
 
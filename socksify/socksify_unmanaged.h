@@ -50,6 +50,16 @@ public:
      *       currently running instance.
      */
     void set_bypass_lan() const;
+    [[nodiscard]] bool set_kernel_bypass(bool enable) const;
+
+    /**
+     * @brief Enables or disables DNS forwarding through a SOCKS5 proxy for its associated processes.
+     * @param proxy_id The proxy handle returned by add_socks5_proxy().
+     * @param resolver The upstream resolver in "IP:Port" format, reached through the proxy; empty to disable.
+     * @param use_tcp Send the queries as DNS over TCP instead of over the proxy UDP relay.
+     * @return true if the setting was applied. Must be called while the gateway is stopped.
+     */
+    [[nodiscard]] bool set_dns_forwarding(LONG_PTR proxy_id, const std::string& resolver, bool use_tcp) const;
 
     /**
      * @brief Adds a SOCKS5 proxy to the gateway.
@@ -68,27 +78,87 @@ public:
         const std::string& password = ""
     ) const;
 
+    /**
+     * @brief Adds an alternative endpoint to a SOCKS5 proxy. New sessions start on a healthy endpoint.
+     * @param proxy_id The proxy handle returned by add_socks5_proxy().
+     * @param endpoint The alternative endpoint in "IP:Port" format, accepting the proxy credentials.
+     * @return true if the endpoint was added.
+     */
+    [[nodiscard]] bool add_socks5_proxy_endpoint(LONG_PTR proxy_id, const std::string& endpoint) const;
+
+    /**
+     * @brief Sets how new sessions of a SOCKS5 proxy choose among its endpoints.
+     * @param proxy_id The proxy handle returned by add_socks5_proxy().
+     * @param least_sessions Prefer the endpoint with the fewest active sessions instead of the lowest latency.
+     * @return true if the setting was applied.
+     */
+    [[nodiscard]] bool set_proxy_selection(LONG_PTR proxy_id, bool least_sessions) const;
+
+    /**
+     * @brief Returns a snapshot of the data path metrics: filter stage depths and block times,
+     *        flow cache hit rate, process table refreshes, per-proxy sessions, bytes and handshake
+     *        latency, and buffer pool occupancy.
+     * @return The metrics in the Prometheus text exposition format, empty if the gateway is not initialized.
+     */
+    [[nodiscard]] std::string get_metrics() const;
+
     [[nodiscard]] bool associate_process_name_to_proxy(
         const std::wstring& process_name,
         LONG_PTR proxy_id) const;
     [[nodiscard]] bool exclude_process_name(const std::wstring& process_name) const;
 
+    /**
+     * @brief Replaces the proxies, process associations, exclusions and LAN bypass without stopping
+     *        the gateway. Unchanged proxies keep their sessions, see socks_local_router::reconfigure().
+     * @param proxies The proxies and their processes.
+     * @param excludes The excluded process names.
+     * @param bypass_lan Whether local network traffic bypasses the proxies.
+     * @return The proxy handle of each entry of proxies, std::nullopt if nothing was changed.
+     */
+    [[nodiscard]] std::optional<std::vector<LONG_PTR>> reconfigure(
+        const std::vector<proxy_configuration_mx>& proxies,
+        const std::vector<std::wstring>& excludes,
+        bool bypass_lan) const;
+
     void set_log_limit(uint32_t log_limit);
     [[nodiscard]] uint32_t get_log_limit();
     void set_log_event(HANDLE log_event);
     log_storage_mx_t read_log();
 
+    /**
+     * @brief Returns the oldest contiguous run of queued log records, read in place.
+     * @return Span of log_record_mx records owned by the logger, empty if nothing is queued.
+     *         Must be handed back to release_log(); there must be a single reader.
+     */
+    [[nodiscard]] log_span_mx acquire_log();
+
+    /**
+     * @brief Frees the log records of a span returned by acquire_log().
+     */
+    void release_log(const log_span_mx& span);
+
+    /**
+     * @brief Gets the number of log entries dropped because the reader fell behind.
+     */
+    [[nodiscard]] uint64_t get_log_dropped();
+
     // --- NEW: wrappers for per-process destination CIDR management -----------
     [[nodiscard]] bool include_process_dst_cidr(const std::wstring& process_name,
                                                 const std::string& cidr) const;
     [[nodiscard]] bool remove_process_dst_cidr(const std::wstring& process_name,
                                                const std::string& cidr) const;
+    // Bulk variants: one policy rebuild per call; return the number of prefixes accepted, -1 on error
+    [[nodiscard]] int include_process_dst_cidrs(const std::wstring& process_name,
+                                                std::string_view cidr_list, int* rejected = nullptr) const;
+    [[nodiscard]] int include_process_dst_cidr_file(const std::wstring& process_name,
+                                                    const std::wstring& path, int* rejected = nullptr) const;
     // -------------------------------------------------------------------------
 
 private:
     static void log_printer(const char* log);
     static void log_event(event_mx log);
     void print_log(log_level_mx level, const std::string& message) const;
+    void on_destination_policy_changed() const;
 
     std::string address_; ///< The address for the proxy (if applicable).
     std::unique_ptr<proxy::socks_local_router> proxy_; ///< The core proxy router instance.
@@ -3,6 +3,7 @@
 #define NOMINMAX 1
 
 #include <WinSock2.h>
+#include <MSWSock.h>
 #include <ws2tcpip.h>
 #include <in6addr.h>
 #include <tchar.h>
@@ -10,8 +11,11 @@
 #include <IPHlpApi.h>
 #include <Mstcpip.h>
 #include <WinDNS.h>
+#include <winternl.h>
 #include <conio.h>
 #include <stdlib.h>
+#include <cstring>
+#include <cctype>
 #include <vector>
 #include <array>
 #include <map>
@@ -19,6 +23,8 @@
 #include <optional>
 #include <functional>
 #include <bitset>
+#include <bit>
+#include <span>
 #include <variant>
 #include <algorithm>
 #include <mutex>
@@ -28,26 +34,42 @@
 #include <stack>
 #include <charconv>
 #include <unordered_set>
+#include <unordered_map>
 #include <queue>
+#include <deque>
 #include <regex>
 #include <syncstream>
 #include <chrono>
+#include <filesystem>
 #include <cassert>
+#include <intrin.h>
 #include <gsl/gsl>
 
 #include "../include/common.h"
 #include "../include/ndisapi.h"
 #include "../netlib/src/tools/generic.h"
 #include "../netlib/src/tools/strings.h"
+#include "../netlib/src/tools/spsc_ring.h"
+#include "../netlib/src/tools/mpsc_queue.h"
+#include "../netlib/src/tools/flat_hash_map.h"
+#include "../netlib/src/tools/timing_wheel.h"
+#include "../netlib/src/tools/metrics.h"
 #include "../netlib/src/log/log.h"
+#include "../netlib/src/log/binary_trace.h"
 #include "../netlib/src/iphlp.h"
 #include "../netlib/src/winsys/object.h"
 #include "../netlib/src/winsys/event.h"
+#include "../netlib/src/winsys/numa_allocator.h"
 #include "../netlib/src/winsys/io_completion_port.h"
+#include "../netlib/src/winsys/io_completion_port_group.h"
+#include "../netlib/src/winsys/rio_receive_queue.h"
 #include "../netlib/src/net/mac_address.h"
 #include "../netlib/src/net/ip_address.h"
 #include "../netlib/src/net/ip_subnet.h"
+#include "../netlib/src/net/port_bitmap.h"
+#include "../netlib/src/net/port_activity_table.h"
 #include "../netlib/src/net/ip_endpoint.h"
+#include "../netlib/src/net/checksum.h"
 #include "../netlib/src/net/ipv6_helper.h"
 #include "../netlib/src/pcap/pcap.h"
 #include "../netlib/src/iphelper/network_adapter_info.h"
@@ -58,19 +80,34 @@
 #include "../netlib/src/ndisapi/static_filters.h"
 #include "../netlib/src/pcap/pcap.h"
 #include "../netlib/src/pcap/pcap_stream_logger.h"
+#include "../netlib/src/pcap/pcapng.h"
+#include "../netlib/src/pcap/pcap_async_writer.h"
+#include "../netlib/src/pcap/pcap_file_reader.h"
 #include "../netlib/src/ndisapi/tcp_local_redirect.h"
 #include "../netlib/src/proxy/proxy_common.h"
 #include "../netlib/src/proxy/socks5_common.h"
+#include "../netlib/src/proxy/socks5_connection_pool.h"
 #include "../netlib/src/ndisapi/socks5_udp_local_redirect.h"
 #include "../netlib/src/winsys/io_completion_port.h"
 #include "../netlib/src/proxy/packet_pool.h"
+#include "../netlib/src/proxy/relay_buffer_pool.h"
 #include "../netlib/src/proxy/tcp_proxy_socket.h"
 #include "../netlib/src/proxy/socks5_tcp_proxy_socket.h"
 #include "../netlib/src/proxy/tcp_proxy_server.h"
 #include "../netlib/src/proxy/socks5_udp_proxy_socket.h"
 #include "../netlib/src/proxy/socks5_local_udp_proxy_server.h"
+#include "../netlib/src/proxy/flow_verdict_cache.h"
+#include "../netlib/src/proxy/flow_hold_table.h"
+#include "../netlib/src/proxy/tcp_port_map.h"
+#include "../netlib/src/proxy/app_name_matcher.h"
 #include "../netlib/src/iphelper/network_adapter_info.h"
 #include "../netlib/src/iphelper/process_lookup.h"
+#include "../netlib/src/iphelper/interface_change_queue.h"
+#include "../netlib/src/proxy/pcap_capture_filter.h"
+#include "../netlib/src/proxy/kernel_bypass_table.h"
+#include "../netlib/src/proxy/dns_cache.h"
+#include "../netlib/src/proxy/socks5_dns_forwarder.h"
+#include "../netlib/src/proxy/proxy_group.h"
 #include "../netlib/src/proxy/socks_local_router.h"
 #include "mixed_types.h"
 #include "logger.h"